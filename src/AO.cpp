@@ -0,0 +1,556 @@
+#include "AO.hpp"
+#include "Jobs.hpp"
+
+#include <math.h>
+#include <string.h>
+
+// Rays start this far in front of their face and inside of it, so that they do not hit the face or its neighbors at the corner
+#define AO_RAY_OFFSET 1e-3f
+
+// Regions around more edited faces than this are merged into one
+#define AO_MAX_NUM_DIRTY_REGIONS 256
+
+// Vertices per task when the rays are generated and resolved
+#define AO_NUM_VERTICES_PER_TASK 64
+
+struct AO_Batch
+{
+    AO*          ao;
+    const Scene* scene;
+
+    const uint32_t* vertex_indices;
+
+    // Every vertex has settings.num_rays consecutive rays, so that packets of them start at the same point
+    Scene_Ray*    rays;
+    Scene_RayHit* hits;
+};
+
+bool32_t AO_Init(AO* ao, const AO_Settings* settings)
+{
+    memset(ao, 0, sizeof(AO));
+
+    ASSERT(settings->num_rays > 0 && settings->num_rays <= AO_MAX_NUM_RAYS_PER_VERTEX);
+
+    if (!Arena_CreateReserved(&ao->vertex_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(AO_Vertex)) ||
+        !Arena_CreateReserved(&ao->value_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(float)) ||
+        !Arena_CreateReserved(&ao->pending_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(bool32_t)) ||
+        !Scene_FaceTracker_Init(&ao->face_tracker))
+    {
+        AO_Destroy(ao);
+        return FALSE;
+    }
+
+    ao->settings = *settings;
+
+    ao->vertices = (AO_Vertex*)ao->vertex_arena.memory;
+    ao->values = (float*)ao->value_arena.memory;
+    ao->pending_flags = (bool32_t*)ao->pending_arena.memory;
+
+    return TRUE;
+}
+
+void AO_Destroy(AO* ao)
+{
+    Scene_FaceTracker_Destroy(&ao->face_tracker);
+    Arena_Destroy(&ao->pending_arena);
+    Arena_Destroy(&ao->value_arena);
+    Arena_Destroy(&ao->vertex_arena);
+
+    memset(ao, 0, sizeof(AO));
+}
+
+void AO_ClearDirty(AO* ao)
+{
+    ao->dirty_vertex_begin = 0;
+    ao->dirty_vertex_end = 0;
+}
+
+static void AO_MarkVerticesDirty(AO* ao, uint32_t vertex_begin, uint32_t vertex_end)
+{
+    if (ao->dirty_vertex_begin == ao->dirty_vertex_end)
+    {
+        ao->dirty_vertex_begin = vertex_begin;
+        ao->dirty_vertex_end = vertex_end;
+        return;
+    }
+
+    ao->dirty_vertex_begin = glm::min(ao->dirty_vertex_begin, vertex_begin);
+    ao->dirty_vertex_end = glm::max(ao->dirty_vertex_end, vertex_end);
+}
+
+static void AO_SetPending(AO* ao, uint32_t vertex_index, bool32_t is_pending)
+{
+    if (ao->pending_flags[vertex_index] == is_pending)
+        return;
+
+    ao->pending_flags[vertex_index] = is_pending;
+
+    if (is_pending)
+        ++ao->num_pending_vertices;
+    else
+        --ao->num_pending_vertices;
+}
+
+// Small hash based generator, every vertex starts from the hash of its position and normal, so that its value depends on
+// neither the threads nor its index
+static uint32_t AO_NextRandom(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+    return x;
+}
+
+static float AO_NextRandomFloat(uint32_t* state)
+{
+    return (float)(AO_NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+static uint32_t AO_MixHash(uint32_t hash, uint32_t value)
+{
+    hash = (hash ^ value) * 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+// Never 0, which the generator would never leave
+static uint32_t AO_GetVertexHash(const AO_Vertex* vertex)
+{
+    uint32_t bits[6];
+    memcpy(bits + 0, &vertex->position, sizeof(glm::vec3));
+    memcpy(bits + 3, &vertex->normal, sizeof(glm::vec3));
+
+    uint32_t hash = 0x9E3779B9u;
+
+    for (uint32_t i = 0; i < ARRAY_SIZE_U32(bits); ++i)
+        hash = AO_MixHash(hash, bits[i]);
+
+    return hash | 1;
+}
+
+static void AO_Resize(AO* ao, uint32_t num_vertices)
+{
+    if (num_vertices < ao->num_vertices)
+    {
+        for (uint32_t i = num_vertices; i < ao->num_vertices; ++i)
+            AO_SetPending(ao, i, FALSE);
+
+        Arena_Rewind(&ao->vertex_arena, (uint64_t)num_vertices * sizeof(AO_Vertex));
+        Arena_Rewind(&ao->value_arena, (uint64_t)num_vertices * sizeof(float));
+        Arena_Rewind(&ao->pending_arena, (uint64_t)num_vertices * sizeof(bool32_t));
+    }
+    else if (num_vertices > ao->num_vertices)
+    {
+        uint32_t num_added_vertices = num_vertices - ao->num_vertices;
+
+        AO_Vertex* vertices = ARENA_ALLOCATE_ARRAY(&ao->vertex_arena, AO_Vertex, num_added_vertices);
+        float* values = ARENA_ALLOCATE_ARRAY(&ao->value_arena, float, num_added_vertices);
+        bool32_t* pending_flags = ARENA_ALLOCATE_ARRAY(&ao->pending_arena, bool32_t, num_added_vertices);
+
+        ASSERT(vertices == ao->vertices + ao->num_vertices && values == ao->values + ao->num_vertices && pending_flags == ao->pending_flags + ao->num_vertices);
+
+        for (uint32_t i = 0; i < num_added_vertices; ++i)
+        {
+            vertices[i].position = glm::vec3(0.0f);
+            vertices[i].normal = glm::vec3(0.0f);
+            vertices[i].face_index = SCENE_ID_NONE;
+
+            values[i] = 1.0f;
+        }
+
+        memset(pending_flags, 0, (uint64_t)num_added_vertices * sizeof(bool32_t));
+    }
+
+    ao->num_vertices = num_vertices;
+
+    if (ao->next_vertex >= num_vertices)
+        ao->next_vertex = 0;
+}
+
+static bool32_t AO_IsInsideBounds(glm::vec3 point, glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    return point.x >= bounds_min.x && point.y >= bounds_min.y && point.z >= bounds_min.z &&
+           point.x <= bounds_max.x && point.y <= bounds_max.y && point.z <= bounds_max.z;
+}
+
+static void AO_AddRegion(glm::vec3* regions, uint32_t* num_regions, glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    if (*num_regions == AO_MAX_NUM_DIRTY_REGIONS)
+    {
+        regions[0] = glm::min(regions[0], bounds_min);
+        regions[1] = glm::max(regions[1], bounds_max);
+        return;
+    }
+
+    regions[2 * *num_regions + 0] = bounds_min;
+    regions[2 * *num_regions + 1] = bounds_max;
+    ++*num_regions;
+}
+
+void AO_Update(AO* ao, Scene* scene, AO_UpdateStats* out_stats)
+{
+    AO_UpdateStats stats;
+    memset(&stats, 0, sizeof(AO_UpdateStats));
+
+    Scene_UpdateFacePlanes(scene);
+
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t num_changes;
+    const Scene_FaceChange* changes = Scene_FaceTracker_Update(&ao->face_tracker, scene, &num_changes);
+
+    if (num_changes == 0 && num_vertices == ao->num_vertices)
+    {
+        Arena_Rewind(scratch_arena, scratch_offset);
+
+        stats.num_vertices = num_vertices;
+
+        if (out_stats)
+            *out_stats = stats;
+
+        return;
+    }
+
+    // Values are read from the old corners of the faces that only moved before any of them is overwritten
+    uint32_t num_matched_vertices = 0;
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        if (changes[i].matched_change != SCENE_ID_NONE)
+            num_matched_vertices += scene->faces[changes[i].face_index].num_half_edges;
+    }
+
+    uint32_t* first_matched_vertices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_changes);
+    float* matched_values = ARENA_ALLOCATE_ARRAY(scratch_arena, float, num_matched_vertices);
+    bool32_t* matched_pending_flags = ARENA_ALLOCATE_ARRAY(scratch_arena, bool32_t, num_matched_vertices);
+    glm::vec3* regions = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec3, 2 * AO_MAX_NUM_DIRTY_REGIONS);
+
+    ASSERT((first_matched_vertices || num_changes == 0) && ((matched_values && matched_pending_flags) || num_matched_vertices == 0) && regions);
+
+    uint32_t num_regions = 0;
+    num_matched_vertices = 0;
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        const Scene_FaceChange* change = changes + i;
+
+        // Old faces that no face took changed or are gone
+        if (change->old_face.signature != 0 && !change->is_old_face_taken)
+            AO_AddRegion(regions, &num_regions, change->old_face.bounds_min, change->old_face.bounds_max);
+
+        if (change->matched_change == SCENE_ID_NONE)
+            continue;
+
+        const Scene_TrackedFace* old_face = &changes[change->matched_change].old_face;
+        first_matched_vertices[i] = num_matched_vertices;
+
+        for (uint32_t corner = 0; corner < old_face->num_half_edges; ++corner)
+        {
+            matched_values[num_matched_vertices] = ao->values[old_face->first_half_edge + corner];
+            matched_pending_flags[num_matched_vertices] = ao->pending_flags[old_face->first_half_edge + corner];
+            ++num_matched_vertices;
+        }
+    }
+
+    AO_Resize(ao, num_vertices);
+
+    // Corners are written in the order of the faces, the ones of deleted faces are cleared
+    AO_Vertex deleted_vertex;
+    deleted_vertex.position = glm::vec3(0.0f);
+    deleted_vertex.normal = glm::vec3(0.0f);
+    deleted_vertex.face_index = SCENE_ID_NONE;
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        const Scene_FaceChange* change = changes + i;
+        uint32_t face_index = change->face_index;
+
+        if (face_index >= scene->num_faces)
+            continue;
+
+        const Scene_Face* face = scene->faces + face_index;
+        uint32_t first_vertex = face->first_half_edge;
+
+        AO_MarkVerticesDirty(ao, first_vertex, first_vertex + face->num_half_edges);
+
+        // NOTE: The half-edges of deleted faces are not linked anymore
+        if (change->signature == 0)
+        {
+            for (uint32_t corner = 0; corner < face->num_half_edges; ++corner)
+            {
+                ao->vertices[first_vertex + corner] = deleted_vertex;
+                ao->values[first_vertex + corner] = 1.0f;
+                AO_SetPending(ao, first_vertex + corner, FALSE);
+            }
+
+            continue;
+        }
+
+        uint32_t half_edge_index = face->first_half_edge;
+
+        for (uint32_t corner = 0; corner < face->num_half_edges; ++corner)
+        {
+            const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+            AO_Vertex* vertex = ao->vertices + first_vertex + corner;
+
+            vertex->position = scene->vertices[half_edge->origin_vertex].position;
+            vertex->normal = face->normal;
+            vertex->face_index = face_index;
+
+            half_edge_index = half_edge->next_half_edge;
+        }
+
+        if (change->matched_change != SCENE_ID_NONE)
+        {
+            for (uint32_t corner = 0; corner < face->num_half_edges; ++corner)
+            {
+                ao->values[first_vertex + corner] = matched_values[first_matched_vertices[i] + corner];
+                AO_SetPending(ao, first_vertex + corner, matched_pending_flags[first_matched_vertices[i] + corner]);
+            }
+
+            stats.num_moved_vertices += face->num_half_edges;
+            continue;
+        }
+
+        // NOTE: The value the slot had is shown until the corner is baked, dragged corners stay close to it
+        for (uint32_t corner = 0; corner < face->num_half_edges; ++corner)
+        {
+            if (!ao->pending_flags[first_vertex + corner])
+                ++stats.num_reset_vertices;
+
+            AO_SetPending(ao, first_vertex + corner, TRUE);
+        }
+
+        stats.num_new_vertices += face->num_half_edges;
+
+        const Scene_TrackedFace* tracked_face = ao->face_tracker.faces + face_index;
+        AO_AddRegion(regions, &num_regions, tracked_face->bounds_min, tracked_face->bounds_max);
+    }
+
+    // Rays reach the radius past the regions
+    for (uint32_t i = 0; i < num_regions; ++i)
+    {
+        regions[2 * i + 0] -= glm::vec3(ao->settings.radius);
+        regions[2 * i + 1] += glm::vec3(ao->settings.radius);
+    }
+
+    for (uint32_t i = 0; i < num_vertices && num_regions > 0; ++i)
+    {
+        const AO_Vertex* vertex = ao->vertices + i;
+
+        if (vertex->face_index == SCENE_ID_NONE || ao->pending_flags[i])
+            continue;
+
+        for (uint32_t j = 0; j < num_regions; ++j)
+        {
+            if (AO_IsInsideBounds(vertex->position, regions[2 * j + 0], regions[2 * j + 1]))
+            {
+                AO_SetPending(ao, i, TRUE);
+                ++stats.num_reset_vertices;
+                break;
+            }
+        }
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    stats.num_vertices = num_vertices;
+
+    if (out_stats)
+        *out_stats = stats;
+}
+
+static void AO_GenerateRaysTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const AO_Batch* batch = (const AO_Batch*)user_data;
+    const AO* ao = batch->ao;
+    const Scene* scene = batch->scene;
+
+    uint32_t num_rays = ao->settings.num_rays;
+
+    // Center of the face the last vertex belonged to
+    glm::vec3 center = glm::vec3(0.0f);
+    uint32_t center_face_index = SCENE_ID_NONE;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const AO_Vertex* vertex = ao->vertices + batch->vertex_indices[i];
+        Scene_Ray* rays = batch->rays + (uint64_t)i * num_rays;
+
+        // Rays of degenerate faces are empty, they end where they start and leave the vertex open
+        if (!(glm::dot(vertex->normal, vertex->normal) > 0.5f))
+        {
+            Scene_Ray empty_ray = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), 0.0f };
+
+            for (uint32_t j = 0; j < num_rays; ++j)
+                rays[j] = empty_ray;
+
+            continue;
+        }
+
+        if (vertex->face_index != center_face_index)
+        {
+            const Scene_Face* face = scene->faces + vertex->face_index;
+
+            center = glm::vec3(0.0f);
+            center_face_index = vertex->face_index;
+
+            uint32_t half_edge_index = face->first_half_edge;
+
+            do
+            {
+                const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+                center += scene->vertices[half_edge->origin_vertex].position;
+
+                half_edge_index = half_edge->next_half_edge;
+            }
+            while (half_edge_index != face->first_half_edge);
+
+            center /= (float)face->num_half_edges;
+        }
+
+        glm::vec3 normal = vertex->normal;
+        glm::vec3 inward = center - vertex->position;
+        float inward_length = glm::length(inward);
+
+        glm::vec3 origin = vertex->position + normal * AO_RAY_OFFSET;
+
+        if (inward_length > 0.0f)
+            origin += inward * (glm::min(AO_RAY_OFFSET, inward_length * 0.5f) / inward_length);
+
+        glm::vec3 helper_axis = (fabsf(normal.y) < 0.9f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 axis_u = glm::normalize(glm::cross(helper_axis, normal));
+        glm::vec3 axis_v = glm::cross(normal, axis_u);
+
+        uint32_t random_state = AO_GetVertexHash(vertex);
+
+        for (uint32_t j = 0; j < num_rays; ++j)
+        {
+            // Cosine weighted and stratified in angle, so that the fraction of open rays is the ambient light the vertex gets
+            float random_radius_squared = AO_NextRandomFloat(&random_state);
+            float radius = sqrtf(random_radius_squared);
+            float phi = 6.28318530718f * ((float)j + AO_NextRandomFloat(&random_state)) / (float)num_rays;
+
+            glm::vec3 direction = radius * cosf(phi) * axis_u + radius * sinf(phi) * axis_v +
+                sqrtf(glm::max(0.0f, 1.0f - random_radius_squared)) * normal;
+
+            rays[j].origin = origin;
+            rays[j].min_length = 0.0f;
+            rays[j].direction = glm::normalize(direction);
+            rays[j].max_length = ao->settings.radius;
+        }
+    }
+}
+
+static void AO_ResolveTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const AO_Batch* batch = (const AO_Batch*)user_data;
+    AO* ao = batch->ao;
+
+    uint32_t num_rays = ao->settings.num_rays;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const Scene_RayHit* hits = batch->hits + (uint64_t)i * num_rays;
+        uint32_t num_open_rays = 0;
+
+        for (uint32_t j = 0; j < num_rays; ++j)
+            num_open_rays += (hits[j].index == SCENE_ID_NONE);
+
+        // NOTE: Every vertex is in the batch once, so the tasks write disjoint values
+        ao->values[batch->vertex_indices[i]] = (float)num_open_rays / (float)num_rays;
+    }
+}
+
+uint32_t AO_Bake(AO* ao, Scene* scene, uint32_t max_num_vertices, AO_BakeStats* out_stats)
+{
+    AO_BakeStats stats;
+    memset(&stats, 0, sizeof(AO_BakeStats));
+
+    uint32_t num_vertices = glm::min(max_num_vertices, ao->num_pending_vertices);
+
+    if (num_vertices == 0)
+    {
+        stats.num_pending_vertices = ao->num_pending_vertices;
+
+        if (out_stats)
+            *out_stats = stats;
+
+        return ao->num_pending_vertices;
+    }
+
+    // NOTE: The rays start at the corners of the faces, which have to be the ones the rays can hit
+    ASSERT(Scene_GetNumGeometryVertices(scene) == ao->num_vertices);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t* vertex_indices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_vertices);
+
+    AO_Batch batch;
+    batch.ao = ao;
+    batch.scene = scene;
+
+    uint64_t num_batch_rays = (uint64_t)AO_NUM_VERTICES_PER_BATCH * ao->settings.num_rays;
+
+    batch.rays = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_Ray, num_batch_rays);
+    batch.hits = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_RayHit, num_batch_rays);
+
+    ASSERT(vertex_indices && batch.rays && batch.hits);
+
+    // Pending vertices round-robin, so that an edit does not wait for the vertices that an earlier one left pending
+    uint32_t num_collected_vertices = 0;
+    uint32_t first_vertex_index = ao->next_vertex;
+
+    for (uint32_t i = 0; i < ao->num_vertices && num_collected_vertices < num_vertices; ++i)
+    {
+        uint32_t vertex_index = (first_vertex_index + i) % ao->num_vertices;
+
+        if (ao->pending_flags[vertex_index])
+        {
+            vertex_indices[num_collected_vertices++] = vertex_index;
+            ao->next_vertex = (vertex_index + 1) % ao->num_vertices;
+        }
+    }
+
+    ASSERT(num_collected_vertices == num_vertices);
+
+    for (uint32_t first_vertex = 0; first_vertex < num_vertices; first_vertex += AO_NUM_VERTICES_PER_BATCH)
+    {
+        uint32_t num_batch_vertices = glm::min(num_vertices - first_vertex, (uint32_t)AO_NUM_VERTICES_PER_BATCH);
+
+        batch.vertex_indices = vertex_indices + first_vertex;
+
+        Jobs_ParallelFor(num_batch_vertices, AO_NUM_VERTICES_PER_TASK, AO_GenerateRaysTask, &batch);
+        Scene_RayCast_FindNearestIntersectingFaces(scene, batch.rays, num_batch_vertices * ao->settings.num_rays, batch.hits);
+        Jobs_ParallelFor(num_batch_vertices, AO_NUM_VERTICES_PER_TASK, AO_ResolveTask, &batch);
+
+        for (uint32_t i = 0; i < num_batch_vertices; ++i)
+        {
+            uint32_t vertex_index = batch.vertex_indices[i];
+
+            AO_SetPending(ao, vertex_index, FALSE);
+            AO_MarkVerticesDirty(ao, vertex_index, vertex_index + 1);
+        }
+
+        stats.num_rays += (uint64_t)num_batch_vertices * ao->settings.num_rays;
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    stats.num_vertices = num_vertices;
+    stats.num_pending_vertices = ao->num_pending_vertices;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return ao->num_pending_vertices;
+}
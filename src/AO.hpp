@@ -0,0 +1,93 @@
+#ifndef AO_HPP_
+#define AO_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+// Rays of this many vertices are cast in one batch across the job threads
+#define AO_NUM_VERTICES_PER_BATCH 1024
+
+// Vertices cast at most this many rays, all of them in the call that bakes the vertex
+#define AO_MAX_NUM_RAYS_PER_VERTEX 64
+
+struct AO_Settings
+{
+    // Geometry farther away than this does not occlude, edits re-bake the vertices this close to the edited faces
+    float    radius;
+    uint32_t num_rays; // Per vertex, up to AO_MAX_NUM_RAYS_PER_VERTEX
+};
+
+// Corner of a face as it was when its value was baked
+struct AO_Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;     // Of the face
+    uint32_t  face_index; // SCENE_ID_NONE for the corners of deleted faces
+};
+
+// Ambient occlusion of every geometry vertex of a scene, one value per corner of every face in the order the geometry is
+// written in, so that the vertex shader finds the value of a vertex by its index
+struct AO
+{
+    AO_Settings settings;
+
+    // Grown in place as faces are added
+    Arena      vertex_arena;
+    AO_Vertex* vertices;
+
+    // Fraction of the hemisphere above the vertex that is open, 1 until the vertex is baked
+    Arena  value_arena;
+    float* values;
+
+    // Vertices that need to be baked, baked round-robin starting at next_vertex
+    Arena     pending_arena;
+    bool32_t* pending_flags;
+    uint32_t  num_pending_vertices;
+    uint32_t  next_vertex;
+
+    uint32_t num_vertices;
+
+    // Faces as they were when their corners were written, to find the ones that changed
+    Scene_FaceTracker face_tracker;
+
+    // Values changed since the last AO_ClearDirty
+    uint32_t dirty_vertex_begin;
+    uint32_t dirty_vertex_end;
+};
+
+struct AO_UpdateStats
+{
+    uint32_t num_vertices;
+    uint32_t num_new_vertices;   // Corners of faces that were added or changed
+    uint32_t num_moved_vertices; // Corners of faces that moved to another index without changing, they keep their values
+    uint32_t num_reset_vertices; // Vertices that are baked again, the new ones included
+};
+
+struct AO_BakeStats
+{
+    uint32_t num_vertices;
+    uint64_t num_rays;
+    uint32_t num_pending_vertices; // Left after the call
+};
+
+bool32_t AO_Init(AO* ao, const AO_Settings* settings);
+
+void AO_Destroy(AO* ao);
+
+// Finds the faces that changed since the last update with Scene_FaceTracker_Update and marks their corners for baking,
+// together with every vertex within the radius of the faces as they are now and as they were. Faces are recognized by their
+// corners and color, so the ones that only got another index keep their values.
+void AO_Update(AO* ao, Scene* scene, AO_UpdateStats* out_stats);
+
+// Bakes up to max_num_vertices pending vertices, casting their hemisphere rays across the job threads.
+// NOTE: The faces of the scene have to be the ones of the last AO_Update
+// Returns the number of vertices that still need to be baked.
+uint32_t AO_Bake(AO* ao, Scene* scene, uint32_t max_num_vertices, AO_BakeStats* out_stats);
+
+// Marks every value as uploaded
+void AO_ClearDirty(AO* ao);
+
+#endif // !AO_HPP_
@@ -2,11 +2,176 @@
 
 #include <string.h>
 
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
 void Arena_CreateFromUserMemory(Arena* arena, void* memory, uint64_t capacity)
 {
 	arena->capacity = capacity;
 	arena->offset = 0;
 	arena->memory = memory;
+	arena->committed = capacity;
+	arena->is_reserved = FALSE;
+}
+
+bool32_t Arena_CreateReserved(Arena* arena, uint64_t capacity)
+{
+	capacity = (capacity + ARENA_COMMIT_GRANULARITY - 1) & ~(ARENA_COMMIT_GRANULARITY - 1);
+
+#if defined(_WIN32)
+	void* memory = VirtualAlloc(NULL, capacity, MEM_RESERVE, PAGE_NOACCESS);
+	if (!memory) return FALSE;
+#else
+	void* memory = mmap(NULL, capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == MAP_FAILED) return FALSE;
+#endif
+
+	arena->capacity = capacity;
+	arena->offset = 0;
+	arena->memory = memory;
+	arena->committed = 0;
+	arena->is_reserved = TRUE;
+
+	return TRUE;
+}
+
+void Arena_Destroy(Arena* arena)
+{
+	if (arena->is_reserved && arena->memory)
+	{
+#if defined(_WIN32)
+		VirtualFree(arena->memory, 0, MEM_RELEASE);
+#else
+		munmap(arena->memory, arena->capacity);
+#endif
+	}
+
+	arena->capacity = 0;
+	arena->offset = 0;
+	arena->memory = NULL;
+	arena->committed = 0;
+	arena->is_reserved = FALSE;
+}
+
+void Arena_Reset(Arena* arena)
+{
+	arena->offset = 0;
+}
+
+void Arena_Rewind(Arena* arena, uint64_t offset)
+{
+	ASSERT(offset <= arena->offset);
+	arena->offset = offset;
+}
+
+static bool32_t Arena_Commit(Arena* arena, uint64_t size)
+{
+	ASSERT(arena->is_reserved);
+	ASSERT(size <= arena->capacity);
+
+	uint64_t new_committed = (size + ARENA_COMMIT_GRANULARITY - 1) & ~(ARENA_COMMIT_GRANULARITY - 1);
+
+	// Grow by at least an eighth of what is committed already, to keep the number of system calls logarithmic
+	uint64_t min_committed = arena->committed + (arena->committed >> 3);
+	min_committed = (min_committed + ARENA_COMMIT_GRANULARITY - 1) & ~(ARENA_COMMIT_GRANULARITY - 1);
+
+	if (new_committed < min_committed) new_committed = min_committed;
+	if (new_committed > arena->capacity) new_committed = arena->capacity;
+
+	uint8_t* commit_start = (uint8_t*)arena->memory + arena->committed;
+	uint64_t commit_size = new_committed - arena->committed;
+
+#if defined(_WIN32)
+	if (!VirtualAlloc(commit_start, commit_size, MEM_COMMIT, PAGE_READWRITE))
+		return FALSE;
+#else
+	if (mprotect(commit_start, commit_size, PROT_READ | PROT_WRITE) != 0)
+		return FALSE;
+#endif
+
+	arena->committed = new_committed;
+	return TRUE;
+}
+
+bool32_t Arena_MapFile(Arena* arena, const char* path, uint64_t offset, uint64_t size)
+{
+	ASSERT(arena->is_reserved);
+	ASSERT(arena->offset == 0);
+	ASSERT((offset & (ARENA_COMMIT_GRANULARITY - 1)) == 0);
+
+	uint64_t mapped_size = (size + ARENA_COMMIT_GRANULARITY - 1) & ~(ARENA_COMMIT_GRANULARITY - 1);
+
+	if (mapped_size > arena->capacity)
+		return FALSE;
+
+	if (size == 0)
+		return TRUE;
+
+#if defined(_WIN32)
+	// NOTE: Views can only be mapped into reserved memory through placeholders, so the region is read instead
+	if (mapped_size > arena->committed && !Arena_Commit(arena, mapped_size))
+		return FALSE;
+
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	LARGE_INTEGER file_offset;
+	file_offset.QuadPart = (LONGLONG)offset;
+
+	bool32_t read_result = SetFilePointerEx(file, file_offset, NULL, FILE_BEGIN) != 0;
+
+	for (uint64_t read_offset = 0; read_offset < size && read_result; )
+	{
+		uint64_t remaining = size - read_offset;
+		DWORD chunk_size = (remaining > ((uint64_t)1 << 30)) ? ((DWORD)1 << 30) : (DWORD)remaining;
+
+		DWORD num_read = 0;
+		read_result = ReadFile(file, (uint8_t*)arena->memory + read_offset, chunk_size, &num_read, NULL) && num_read == chunk_size;
+
+		read_offset += num_read;
+	}
+
+	CloseHandle(file);
+
+	if (!read_result)
+		return FALSE;
+#else
+	int file = open(path, O_RDONLY);
+	if (file < 0)
+		return FALSE;
+
+	// Pages past the end of the file would fault on access, so the padding has to be there
+	struct stat file_stat;
+	if (fstat(file, &file_stat) != 0 || (uint64_t)file_stat.st_size < offset + mapped_size)
+	{
+		close(file);
+		return FALSE;
+	}
+
+	void* memory = mmap(arena->memory, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file, (off_t)offset);
+
+	// NOTE: The mapping keeps its own reference to the file
+	close(file);
+
+	if (memory == MAP_FAILED)
+		return FALSE;
+
+	ASSERT(memory == arena->memory);
+
+	if (mapped_size > arena->committed)
+		arena->committed = mapped_size;
+#endif
+
+	arena->offset = size;
+	return TRUE;
 }
 
 static bool32_t Arena_IsPowerOfTwo(uint64_t x)
@@ -56,6 +221,9 @@ void* Arena_AllocateRegion(Arena* arena, uint64_t size, uint64_t alignment)
 
 	if (new_offset > arena->capacity) return NULL;
 
+	if (new_offset > arena->committed && !Arena_Commit(arena, new_offset))
+		return NULL;
+
 	arena->offset = new_offset;
 	return (void*)aligned_start;
 }
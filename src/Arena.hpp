@@ -3,20 +3,47 @@
 
 #include "Common.hpp"
 
+// Reserved arenas commit memory in steps of this many bytes
+#define ARENA_COMMIT_GRANULARITY ((uint64_t)1 << 16)
+
 struct Arena
 {
 	uint64_t capacity;
 	uint64_t offset;
 
 	void* memory;
+
+	// For reserved arenas only the first committed bytes are backed by memory, the rest is address space
+	uint64_t committed;
+	bool32_t is_reserved;
 };
 
 void Arena_CreateFromUserMemory(Arena* arena, void* memory, uint64_t capacity);
 
+// Reserves address space for capacity bytes that gets committed as the arena grows, so allocations never move
+bool32_t Arena_CreateReserved(Arena* arena, uint64_t capacity);
+
+// Places size bytes of the file at offset at the start of an empty reserved arena, as if they were allocated from it.
+// Where the platform allows it the pages are mapped as private copies on write, so nothing is read until it is touched.
+// NOTE: The offset has to be a multiple of ARENA_COMMIT_GRANULARITY and the file has to be padded up to the next one after
+// the region.
+bool32_t Arena_MapFile(Arena* arena, const char* path, uint64_t offset, uint64_t size);
+
+// Releases the memory of reserved arenas, user memory is left to the user
+void Arena_Destroy(Arena* arena);
+
+// Frees all allocations, reserved arenas keep their memory committed
+void Arena_Reset(Arena* arena);
+
+// Frees every allocation made after the offset was read from the arena
+void Arena_Rewind(Arena* arena, uint64_t offset);
+
 bool32_t Arena_CanAllocateRegion(Arena* arena, uint64_t size, uint64_t alignment);
 
 void* Arena_AllocateRegion(Arena* arena, uint64_t size, uint64_t alignment);
 
 void* Arena_PushRegion(Arena* arena, void* data, uint64_t size, uint64_t alignment);
 
-#endif
\ No newline at end of file
+#define ARENA_ALLOCATE_ARRAY(arena, type, count) ((type*)Arena_AllocateRegion((arena), (uint64_t)(count) * sizeof(type), alignof(type)))
+
+#endif
@@ -0,0 +1,4185 @@
+#include "Benchmark.hpp"
+#include "Scene.hpp"
+#include "CSG.hpp"
+#include "PVS.hpp"
+#include "Lightmap.hpp"
+#include "AO.hpp"
+#include "NavMesh.hpp"
+#include "Jobs.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+typedef void (*Benchmark_Function)(void);
+
+struct Benchmark_Entry
+{
+    const char*        name;
+    const char*        description;
+    Benchmark_Function function;
+};
+
+static double Benchmark_GetTime(void)
+{
+    using Clock = std::chrono::steady_clock;
+    return std::chrono::duration<double>(Clock::now().time_since_epoch()).count();
+}
+
+// Small deterministic generator, so that every run sees the same inputs
+static uint32_t Benchmark_RandomState = 0x9E3779B9u;
+
+static float Benchmark_RandomFloat(void)
+{
+    Benchmark_RandomState ^= Benchmark_RandomState << 13;
+    Benchmark_RandomState ^= Benchmark_RandomState >> 17;
+    Benchmark_RandomState ^= Benchmark_RandomState << 5;
+
+    return (Benchmark_RandomState >> 8) * (1.0f / 16777216.0f);
+}
+
+// Builds a terrain like grid of quads, every column of vertices has its own height so all faces stay planar.
+// Vertex (x, z) ends up at index x * (num_cells_per_side + 1) + z.
+static void Benchmark_BuildGridScene(Scene* scene, uint32_t num_cells_per_side)
+{
+    uint32_t num_vertices_per_side = num_cells_per_side + 1;
+    uint32_t base_vertex = scene->num_vertices;
+
+    for (uint32_t x = 0; x < num_vertices_per_side; ++x)
+    {
+        float height = Benchmark_RandomFloat();
+
+        for (uint32_t z = 0; z < num_vertices_per_side; ++z)
+        {
+            uint32_t vertex_index = Scene_AddVertex(scene, { (float)x, height, (float)z });
+            ASSERT(vertex_index == base_vertex + x * num_vertices_per_side + z);
+            UNUSED(vertex_index);
+        }
+    }
+
+    for (uint32_t x = 0; x < num_cells_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_cells_per_side; ++z)
+        {
+            uint32_t face_vertices[4] = {
+                base_vertex + x * num_vertices_per_side + z,
+                base_vertex + x * num_vertices_per_side + z + 1,
+                base_vertex + (x + 1) * num_vertices_per_side + z + 1,
+                base_vertex + (x + 1) * num_vertices_per_side + z,
+            };
+
+            glm::vec4 color = { Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat(), 1.0f };
+
+            uint32_t face_index = Scene_ConstructFace(scene, face_vertices, ARRAY_SIZE_U32(face_vertices), color);
+            ASSERT(face_index != SCENE_ID_NONE);
+            UNUSED(face_index);
+        }
+    }
+}
+
+#define BENCHMARK_RAYCAST_NUM_RAYS 20000
+#define BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE 32
+
+static glm::vec3 Benchmark_RayCast_Origins[BENCHMARK_RAYCAST_NUM_RAYS];
+static glm::vec3 Benchmark_RayCast_Directions[BENCHMARK_RAYCAST_NUM_RAYS];
+static uint32_t  Benchmark_RayCast_ReferenceHits[BENCHMARK_RAYCAST_NUM_RAYS];
+
+static void Benchmark_RayCast_Report(const char* label, double seconds, double reference_seconds, uint32_t num_mismatches)
+{
+    printf(
+        "  %-28s %10.1f ns/ray %8.2fx   mismatches: %u\n",
+        label,
+        seconds * 1e9 / BENCHMARK_RAYCAST_NUM_RAYS,
+        reference_seconds / seconds,
+        num_mismatches
+    );
+}
+
+#define BENCHMARK_RAYCAST_NUM_STAR_POINTS 5
+
+// Flat star shaped faces on a grid, all of them concave. The grid is laid out in x and z, then turned by frame.
+static void Benchmark_RayCast_BuildStarScene(Scene* scene, uint32_t num_cells_per_side, const glm::mat3* frame)
+{
+    const uint32_t num_corners = 2 * BENCHMARK_RAYCAST_NUM_STAR_POINTS;
+
+    for (uint32_t x = 0; x < num_cells_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_cells_per_side; ++z)
+        {
+            uint32_t face_vertices[num_corners];
+
+            for (uint32_t i = 0; i < num_corners; ++i)
+            {
+                float angle = -2.0f * 3.14159265f * i / num_corners;
+                float radius = (i % 2 == 0) ? 0.45f : 0.2f;
+
+                face_vertices[i] = Scene_AddVertex(scene, *frame * glm::vec3(x + 0.5f + radius * cosf(angle), 0.0f, z + 0.5f + radius * sinf(angle)));
+            }
+
+            uint32_t face_index = Scene_ConstructFace(scene, face_vertices, num_corners, { 1.0f, 1.0f, 1.0f, 1.0f });
+            ASSERT(face_index != SCENE_ID_NONE);
+            UNUSED(face_index);
+        }
+    }
+}
+
+// Two sided ray triangle test
+static bool32_t Benchmark_RayCast_IntersectTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec3 ray_origin, glm::vec3 ray_direction, float* out_ray_length)
+{
+    glm::vec3 edge_ab = b - a;
+    glm::vec3 edge_ac = c - a;
+
+    glm::vec3 p = glm::cross(ray_direction, edge_ac);
+    float determinant = glm::dot(edge_ab, p);
+
+    if (fabsf(determinant) < 1e-12f)
+        return FALSE;
+
+    float inverse_determinant = 1.0f / determinant;
+
+    glm::vec3 offset = ray_origin - a;
+    float u = glm::dot(offset, p) * inverse_determinant;
+    if (u < 0.0f || u > 1.0f)
+        return FALSE;
+
+    glm::vec3 q = glm::cross(offset, edge_ab);
+    float v = glm::dot(ray_direction, q) * inverse_determinant;
+    if (v < 0.0f || u + v > 1.0f)
+        return FALSE;
+
+    *out_ray_length = glm::dot(edge_ac, q) * inverse_determinant;
+    return TRUE;
+}
+
+// Rays that come down onto a grid of the given size before it is turned by frame
+static void Benchmark_RayCast_GenerateRays(float grid_size, const glm::mat3* frame)
+{
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_RAYS; ++i)
+    {
+        Benchmark_RayCast_Origins[i] = *frame * glm::vec3(Benchmark_RandomFloat() * grid_size, 5.0f, Benchmark_RandomFloat() * grid_size);
+        Benchmark_RayCast_Directions[i] = glm::normalize(*frame * glm::vec3(Benchmark_RandomFloat() - 0.5f, -1.0f, Benchmark_RandomFloat() - 0.5f));
+    }
+}
+
+// The reference walks every face through its half-edges, which only works for convex faces, so scenes with concave faces
+// are tested against the triangles of their geometry instead, which are passed in then
+static void Benchmark_RayCast_FindReferenceHits(const Scene* scene, const SVertex* vertices, const uint32_t* indices)
+{
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_RAYS; ++i)
+    {
+        float    hit_distance = 100.0f;
+        uint32_t hit_face_index = SCENE_ID_NONE;
+
+        for (uint32_t j = 0; j < scene->num_faces; ++j)
+        {
+            float distance;
+
+            if (!indices)
+            {
+                if (Scene_Face_IntersectRay(scene, j, Benchmark_RayCast_Origins[i], Benchmark_RayCast_Directions[i], 0.01f, hit_distance, &distance))
+                {
+                    hit_distance = distance;
+                    hit_face_index = j;
+                }
+
+                continue;
+            }
+
+            const uint32_t* face_indices = indices + Scene_Face_GetFirstGeometryIndex(scene, j);
+
+            for (uint32_t k = 0; k < 3 * (scene->faces[j].num_half_edges - 2); k += 3)
+            {
+                if (Benchmark_RayCast_IntersectTriangle(
+                        vertices[face_indices[k + 0]].position,
+                        vertices[face_indices[k + 1]].position,
+                        vertices[face_indices[k + 2]].position,
+                        Benchmark_RayCast_Origins[i],
+                        Benchmark_RayCast_Directions[i],
+                        &distance
+                    ) && distance >= 0.01f && distance <= hit_distance)
+                {
+                    hit_distance = distance;
+                    hit_face_index = j;
+                }
+            }
+        }
+
+        Benchmark_RayCast_ReferenceHits[i] = hit_face_index;
+    }
+}
+
+// Generates the triangles the reference needs for concave faces, the arrays are freed by the caller
+static void Benchmark_RayCast_GenerateTriangles(Scene* scene, SVertex** out_vertices, uint32_t** out_indices)
+{
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
+
+    *out_vertices = (SVertex*)malloc((uint64_t)num_vertices * sizeof(SVertex));
+    *out_indices  = (uint32_t*)malloc((uint64_t)num_indices * sizeof(uint32_t));
+
+    uint32_t num_generated_vertices, num_generated_indices;
+    bool32_t generate_result = Scene_GenerateGeometry(scene, *out_vertices, num_vertices, *out_indices, num_indices, &num_generated_vertices, &num_generated_indices);
+    ASSERT(generate_result == TRUE);
+    UNUSED(generate_result);
+}
+
+// Times every ray cast path on the scene and counts where it disagrees with the reference
+static void Benchmark_RayCast_Run(Scene* scene, const char* name, float grid_size, bool32_t has_concave_faces, const glm::mat3* frame)
+{
+    Benchmark_RayCast_GenerateRays(grid_size, frame);
+
+    printf("  %s: %u faces\n", name, scene->num_faces);
+
+    SVertex*  vertices = NULL;
+    uint32_t* indices = NULL;
+
+    if (has_concave_faces)
+        Benchmark_RayCast_GenerateTriangles(scene, &vertices, &indices);
+
+    double start_time = Benchmark_GetTime();
+    Benchmark_RayCast_FindReferenceHits(scene, vertices, indices);
+    double reference_seconds = Benchmark_GetTime() - start_time;
+
+    Benchmark_RayCast_Report(has_concave_faces ? "triangle brute force" : "half-edge brute force", reference_seconds, reference_seconds, 0);
+
+    // Face plane mirror with every kernel the CPU supports
+
+    Scene_FacePlanes_Update(scene);
+
+    const char* kernel_labels[] = { "planes brute force (scalar)", "planes brute force (SSE)", "planes brute force (AVX)" };
+
+    uint32_t best_kernel = Scene_FacePlanes_GetBestKernel();
+
+    for (uint32_t kernel = SCENE_FACE_PLANES_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+    {
+        uint32_t num_mismatches = 0;
+
+        start_time = Benchmark_GetTime();
+
+        for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_RAYS; ++i)
+        {
+            uint32_t hit_face_index = SCENE_ID_NONE;
+            float    hit_distance;
+
+            Scene_FacePlanes_RayCast(scene, kernel, Benchmark_RayCast_Origins[i], Benchmark_RayCast_Directions[i], 0.01f, 100.0f, &hit_face_index, &hit_distance);
+
+            num_mismatches += (hit_face_index != Benchmark_RayCast_ReferenceHits[i]);
+        }
+
+        Benchmark_RayCast_Report(kernel_labels[kernel], Benchmark_GetTime() - start_time, reference_seconds, num_mismatches);
+    }
+
+    // Full ray cast API, which goes through the BVH
+
+    {
+        uint32_t num_mismatches = 0;
+
+        start_time = Benchmark_GetTime();
+
+        for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_RAYS; ++i)
+        {
+            uint32_t hit_face_index = SCENE_ID_NONE;
+            Scene_RayCast_FindNearestIntersectingFace(scene, Benchmark_RayCast_Origins[i], Benchmark_RayCast_Directions[i], 0.01f, 100.0f, &hit_face_index, NULL);
+
+            num_mismatches += (hit_face_index != Benchmark_RayCast_ReferenceHits[i]);
+        }
+
+        Benchmark_RayCast_Report("bvh", Benchmark_GetTime() - start_time, reference_seconds, num_mismatches);
+    }
+
+    free(indices);
+    free(vertices);
+}
+
+// A terrain grid and a grid of concave stars, whose arms the edge planes alone would miss. The stars are tested a second
+// time on a wall at 45 degrees, whose normal is exactly as large along x as along z.
+#define BENCHMARK_RAYCAST_NUM_SCENES 3
+
+static const char* Benchmark_RayCast_SceneNames[BENCHMARK_RAYCAST_NUM_SCENES] = { "grid", "concave stars", "concave stars on a 45 degree wall" };
+
+// Columns are where x, y and z of the grid end up, the grid plane of the wall goes to x = -z, exactly for every corner
+static const glm::mat3 Benchmark_RayCast_FlatFrame(1.0f);
+static const glm::mat3 Benchmark_RayCast_WallFrame(glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+
+static const glm::mat3* Benchmark_RayCast_BuildScene(Scene* scene, uint32_t scene_index, uint32_t num_cells_per_side)
+{
+    const glm::mat3* frame = (scene_index == 2) ? &Benchmark_RayCast_WallFrame : &Benchmark_RayCast_FlatFrame;
+
+    if (scene_index == 0)
+        Benchmark_BuildGridScene(scene, num_cells_per_side);
+    else
+        Benchmark_RayCast_BuildStarScene(scene, num_cells_per_side, frame);
+
+    return frame;
+}
+
+static void Benchmark_RayCast(void)
+{
+    printf("raycast: %u rays\n", BENCHMARK_RAYCAST_NUM_RAYS);
+
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_SCENES; ++i)
+    {
+        Scene scene_storage;
+        bool32_t scene_init_result = Scene_Init(&scene_storage);
+        ASSERT(scene_init_result == TRUE);
+        UNUSED(scene_init_result);
+
+        Scene* scene = &scene_storage;
+
+        const glm::mat3* frame = Benchmark_RayCast_BuildScene(scene, i, BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE);
+        Benchmark_RayCast_Run(scene, Benchmark_RayCast_SceneNames[i], (float)BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE, i > 0, frame);
+
+        Scene_Destroy(scene);
+    }
+}
+
+#define BENCHMARK_RAYCAST_BATCH_RESOLUTION 256
+#define BENCHMARK_RAYCAST_BATCH_NUM_RAYS (BENCHMARK_RAYCAST_BATCH_RESOLUTION * BENCHMARK_RAYCAST_BATCH_RESOLUTION)
+
+static Scene_Ray    Benchmark_RayCastBatch_Rays[BENCHMARK_RAYCAST_BATCH_NUM_RAYS];
+static Scene_Ray    Benchmark_RayCastBatch_ShuffledRays[BENCHMARK_RAYCAST_BATCH_NUM_RAYS];
+static Scene_RayHit Benchmark_RayCastBatch_Hits[BENCHMARK_RAYCAST_BATCH_NUM_RAYS];
+static uint32_t     Benchmark_RayCastBatch_ReferenceHits[BENCHMARK_RAYCAST_BATCH_NUM_RAYS];
+
+static void Benchmark_RayCastBatch(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE);
+
+    // A camera above the grid looking down at it, so neighbouring rays are coherent
+
+    const glm::vec3 eye = { 0.5f * BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE, 8.0f, -4.0f };
+    const glm::vec3 target = { 0.5f * BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE, 0.0f, 0.5f * BENCHMARK_RAYCAST_NUM_CELLS_PER_SIDE };
+
+    glm::vec3 forward = glm::normalize(target - eye);
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::cross(right, forward);
+
+    for (uint32_t y = 0; y < BENCHMARK_RAYCAST_BATCH_RESOLUTION; ++y)
+    {
+        for (uint32_t x = 0; x < BENCHMARK_RAYCAST_BATCH_RESOLUTION; ++x)
+        {
+            float u = 2.0f * (x + 0.5f) / BENCHMARK_RAYCAST_BATCH_RESOLUTION - 1.0f;
+            float v = 2.0f * (y + 0.5f) / BENCHMARK_RAYCAST_BATCH_RESOLUTION - 1.0f;
+
+            Scene_Ray* ray = Benchmark_RayCastBatch_Rays + y * BENCHMARK_RAYCAST_BATCH_RESOLUTION + x;
+            ray->origin = eye;
+            ray->min_length = 0.01f;
+            ray->direction = glm::normalize(forward + 0.8f * u * right + 0.8f * v * up);
+            ray->max_length = 100.0f;
+        }
+    }
+
+    // The same rays in random order, to show what packets gain from coherence
+
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_BATCH_NUM_RAYS; ++i)
+        Benchmark_RayCastBatch_ShuffledRays[i] = Benchmark_RayCastBatch_Rays[i];
+
+    for (uint32_t i = BENCHMARK_RAYCAST_BATCH_NUM_RAYS - 1; i > 0; --i)
+    {
+        uint32_t j = (uint32_t)(Benchmark_RandomFloat() * (i + 1));
+        if (j > i) j = i;
+
+        Scene_Ray ray = Benchmark_RayCastBatch_ShuffledRays[i];
+        Benchmark_RayCastBatch_ShuffledRays[i] = Benchmark_RayCastBatch_ShuffledRays[j];
+        Benchmark_RayCastBatch_ShuffledRays[j] = ray;
+    }
+
+    printf(
+        "raycast-batch: %u rays against %u faces, %u job threads\n",
+        BENCHMARK_RAYCAST_BATCH_NUM_RAYS,
+        scene->num_faces,
+        Jobs_GetNumThreads()
+    );
+
+    double start_time = Benchmark_GetTime();
+
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_BATCH_NUM_RAYS; ++i)
+    {
+        const Scene_Ray* ray = Benchmark_RayCastBatch_Rays + i;
+
+        uint32_t hit_face_index = SCENE_ID_NONE;
+        Scene_RayCast_FindNearestIntersectingFace(scene, ray->origin, ray->direction, ray->min_length, ray->max_length, &hit_face_index, NULL);
+
+        Benchmark_RayCastBatch_ReferenceHits[i] = hit_face_index;
+    }
+
+    double single_seconds = Benchmark_GetTime() - start_time;
+    printf("  %-28s %10.2f Mrays/s\n", "single ray calls", BENCHMARK_RAYCAST_BATCH_NUM_RAYS * 1e-6 / single_seconds);
+
+    start_time = Benchmark_GetTime();
+    Scene_RayCast_FindNearestIntersectingFaces(scene, Benchmark_RayCastBatch_Rays, BENCHMARK_RAYCAST_BATCH_NUM_RAYS, Benchmark_RayCastBatch_Hits);
+    double batch_seconds = Benchmark_GetTime() - start_time;
+
+    uint32_t num_mismatches = 0;
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_BATCH_NUM_RAYS; ++i)
+        num_mismatches += (Benchmark_RayCastBatch_Hits[i].index != Benchmark_RayCastBatch_ReferenceHits[i]);
+
+    printf(
+        "  %-28s %10.2f Mrays/s %8.2fx   mismatches: %u\n",
+        "batch (coherent)",
+        BENCHMARK_RAYCAST_BATCH_NUM_RAYS * 1e-6 / batch_seconds,
+        single_seconds / batch_seconds,
+        num_mismatches
+    );
+
+    start_time = Benchmark_GetTime();
+    Scene_RayCast_FindNearestIntersectingFaces(scene, Benchmark_RayCastBatch_ShuffledRays, BENCHMARK_RAYCAST_BATCH_NUM_RAYS, Benchmark_RayCastBatch_Hits);
+    batch_seconds = Benchmark_GetTime() - start_time;
+
+    printf(
+        "  %-28s %10.2f Mrays/s %8.2fx\n",
+        "batch (shuffled)",
+        BENCHMARK_RAYCAST_BATCH_NUM_RAYS * 1e-6 / batch_seconds,
+        single_seconds / batch_seconds
+    );
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_SCENE_STORAGE_NUM_CELLS_PER_SIDE 1024
+
+static void Benchmark_SceneStorage_ReportArena(const char* label, const Arena* arena, uint32_t num_elements)
+{
+    printf(
+        "  %-12s %10u elements %8.2f MB committed %8.1f bytes/element\n",
+        label,
+        num_elements,
+        arena->committed / (1024.0 * 1024.0),
+        num_elements ? (double)arena->committed / num_elements : 0.0
+    );
+}
+
+static void Benchmark_SceneStorage(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+
+    printf(
+        "scene-storage: %ux%u grid, element sizes vertex %u B, half-edge %u B, face %u B\n",
+        BENCHMARK_SCENE_STORAGE_NUM_CELLS_PER_SIDE,
+        BENCHMARK_SCENE_STORAGE_NUM_CELLS_PER_SIDE,
+        (uint32_t)sizeof(Scene_Vertex),
+        (uint32_t)sizeof(Scene_HalfEdge),
+        (uint32_t)sizeof(Scene_Face)
+    );
+
+    double start_time = Benchmark_GetTime();
+    Benchmark_BuildGridScene(scene, BENCHMARK_SCENE_STORAGE_NUM_CELLS_PER_SIDE);
+    double build_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-12s %10.2f ms, %.1f ns/face\n", "build", build_seconds * 1e3, build_seconds * 1e9 / scene->num_faces);
+
+    Benchmark_SceneStorage_ReportArena("vertices", &scene->vertex_arena, scene->num_vertices);
+    Benchmark_SceneStorage_ReportArena("half-edges", &scene->half_edge_arena, scene->num_half_edges);
+    Benchmark_SceneStorage_ReportArena("faces", &scene->face_arena, scene->num_faces);
+
+    start_time = Benchmark_GetTime();
+    Scene_FacePlanes_Update(scene);
+    Scene_BVH_Update(scene);
+    double acceleration_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-12s %10.2f ms\n", "bvh + planes", acceleration_seconds * 1e3);
+
+    Benchmark_SceneStorage_ReportArena("bvh", &scene->bvh.arena, scene->num_faces);
+    Benchmark_SceneStorage_ReportArena("face planes", &scene->face_planes.arena, scene->num_faces);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_SCENE_BUILD_NUM_FAN_TRIANGLES 16384
+
+// Face lists of the scene-build benchmark, in the layout taken by Scene_ConstructFaces
+struct Benchmark_SceneBuild_Faces
+{
+    uint32_t*  vertex_indices;
+    uint32_t*  num_vertices;
+    glm::vec4* colors;
+    uint32_t   num_faces;
+    uint32_t   num_vertex_indices;
+};
+
+static void Benchmark_SceneBuild_AddFace(Benchmark_SceneBuild_Faces* faces, const uint32_t* vertex_indices, uint32_t num_vertices)
+{
+    for (uint32_t i = 0; i < num_vertices; ++i)
+        faces->vertex_indices[faces->num_vertex_indices + i] = vertex_indices[i];
+
+    faces->num_vertices[faces->num_faces] = num_vertices;
+    faces->colors[faces->num_faces] = { Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat(), 1.0f };
+
+    faces->num_vertex_indices += num_vertices;
+    faces->num_faces += 1;
+}
+
+static void Benchmark_SceneBuild_Compare(const char* label, Scene* scenes, const Benchmark_SceneBuild_Faces* faces, uint32_t num_vertices)
+{
+    // Both scenes get the same vertices, so only the face construction differs
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        for (uint32_t j = 0; j < num_vertices; ++j)
+            Scene_AddVertex(scenes + i, { (float)j, 0.0f, 0.0f });
+    }
+
+    double start_time = Benchmark_GetTime();
+
+    for (uint32_t i = 0, first_vertex_index = 0; i < faces->num_faces; ++i)
+    {
+        Scene_ConstructFace(scenes + 0, faces->vertex_indices + first_vertex_index, faces->num_vertices[i], faces->colors[i]);
+        first_vertex_index += faces->num_vertices[i];
+    }
+
+    double single_seconds = Benchmark_GetTime() - start_time;
+
+    start_time = Benchmark_GetTime();
+    uint32_t first_face_index = Scene_ConstructFaces(scenes + 1, faces->vertex_indices, faces->num_vertices, faces->colors, faces->num_faces);
+    double bulk_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(first_face_index != SCENE_ID_NONE);
+    UNUSED(first_face_index);
+
+    bool32_t identical = scenes[0].num_half_edges == scenes[1].num_half_edges &&
+        scenes[0].num_faces == scenes[1].num_faces &&
+        memcmp(scenes[0].vertices, scenes[1].vertices, scenes[0].num_vertices * sizeof(Scene_Vertex)) == 0 &&
+        memcmp(scenes[0].half_edges, scenes[1].half_edges, scenes[0].num_half_edges * sizeof(Scene_HalfEdge)) == 0 &&
+        memcmp(scenes[0].faces, scenes[1].faces, scenes[0].num_faces * sizeof(Scene_Face)) == 0;
+
+    printf("  %s: %u faces, %u half-edges\n", label, scenes[1].num_faces, scenes[1].num_half_edges);
+    printf("    %-22s %10.2f ms\n", "Scene_ConstructFace", single_seconds * 1e3);
+    printf("    %-22s %10.2f ms %6.2fx %s\n", "Scene_ConstructFaces", bulk_seconds * 1e3, single_seconds / bulk_seconds, identical ? "identical" : "MISMATCH");
+}
+
+static void Benchmark_SceneBuild(void)
+{
+    uint32_t num_vertices_per_side = BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE + 1;
+    uint32_t max_num_faces = BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE * BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE;
+
+    Arena arena;
+    bool32_t arena_result = Arena_CreateReserved(&arena, (uint64_t)max_num_faces * (4 * sizeof(uint32_t) + sizeof(uint32_t) + sizeof(glm::vec4)) + 1024);
+    ASSERT(arena_result == TRUE);
+    UNUSED(arena_result);
+
+    Benchmark_SceneBuild_Faces faces = {};
+    faces.vertex_indices = ARENA_ALLOCATE_ARRAY(&arena, uint32_t, 4 * max_num_faces);
+    faces.num_vertices   = ARENA_ALLOCATE_ARRAY(&arena, uint32_t, max_num_faces);
+    faces.colors         = ARENA_ALLOCATE_ARRAY(&arena, glm::vec4, max_num_faces);
+
+    printf("scene-build: per-face construction vs. bulk construction on %u job threads\n", Jobs_GetNumThreads());
+
+    for (uint32_t x = 0; x < BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE; ++x)
+    {
+        for (uint32_t z = 0; z < BENCHMARK_SCENE_BUILD_NUM_CELLS_PER_SIDE; ++z)
+        {
+            uint32_t face_vertices[4] = {
+                x * num_vertices_per_side + z,
+                x * num_vertices_per_side + z + 1,
+                (x + 1) * num_vertices_per_side + z + 1,
+                (x + 1) * num_vertices_per_side + z,
+            };
+
+            Benchmark_SceneBuild_AddFace(&faces, face_vertices, ARRAY_SIZE_U32(face_vertices));
+        }
+    }
+
+    Scene scenes[2];
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        bool32_t scene_init_result = Scene_Init(scenes + i);
+        ASSERT(scene_init_result == TRUE);
+        UNUSED(scene_init_result);
+    }
+
+    Benchmark_SceneBuild_Compare("grid", scenes, &faces, num_vertices_per_side * num_vertices_per_side);
+
+    for (uint32_t i = 0; i < 2; ++i)
+        Scene_Destroy(scenes + i);
+
+    // A closed fan around vertex 0, its outgoing list grows with every triangle so matching one edge at a time gets quadratic
+    faces.num_faces = 0;
+    faces.num_vertex_indices = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_SCENE_BUILD_NUM_FAN_TRIANGLES; ++i)
+    {
+        uint32_t face_vertices[3] = { 0, 1 + i, 1 + (i + 1) % BENCHMARK_SCENE_BUILD_NUM_FAN_TRIANGLES };
+        Benchmark_SceneBuild_AddFace(&faces, face_vertices, ARRAY_SIZE_U32(face_vertices));
+    }
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        bool32_t scene_init_result = Scene_Init(scenes + i);
+        ASSERT(scene_init_result == TRUE);
+        UNUSED(scene_init_result);
+    }
+
+    Benchmark_SceneBuild_Compare("fan", scenes, &faces, 1 + BENCHMARK_SCENE_BUILD_NUM_FAN_TRIANGLES);
+
+    for (uint32_t i = 0; i < 2; ++i)
+        Scene_Destroy(scenes + i);
+
+    Arena_Destroy(&arena);
+}
+
+#define BENCHMARK_GEOMETRY_UPDATE_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS 1000
+
+// Moves single vertices of a million face grid and regenerates only the dirty runs, compared with full regeneration.
+// Full regeneration is split across the job threads while the small runs are written by one, so they have to match.
+static void Benchmark_GeometryUpdate(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_GEOMETRY_UPDATE_NUM_CELLS_PER_SIDE);
+
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
+
+    // Stand-ins for the mapped GPU buffers, the incremental ones are only ever written where runs land
+    Arena arena;
+    bool32_t arena_result = Arena_CreateReserved(&arena, 2 * ((uint64_t)num_vertices * sizeof(SVertex) + (uint64_t)num_indices * sizeof(uint32_t)) + 1024);
+    ASSERT(arena_result == TRUE);
+    UNUSED(arena_result);
+
+    SVertex*  full_vertices        = ARENA_ALLOCATE_ARRAY(&arena, SVertex, num_vertices);
+    uint32_t* full_indices         = ARENA_ALLOCATE_ARRAY(&arena, uint32_t, num_indices);
+    SVertex*  incremental_vertices = ARENA_ALLOCATE_ARRAY(&arena, SVertex, num_vertices);
+    uint32_t* incremental_indices  = ARENA_ALLOCATE_ARRAY(&arena, uint32_t, num_indices);
+
+    // The first update uploads every face
+    uint32_t num_runs = Scene_Geometry_CollectDirtyRuns(scene);
+    ASSERT(num_runs == 1);
+
+    for (uint32_t i = 0; i < num_runs; ++i)
+    {
+        const Scene_Geometry_Run* run = scene->geometry.runs + i;
+        Scene_Geometry_WriteFaces(scene, run->first_face, run->num_faces, incremental_vertices + run->first_vertex, incremental_indices + run->first_index);
+    }
+
+    Scene_Geometry_ClearDirty(scene);
+
+    double full_seconds = 0.0;
+    double incremental_seconds = 0.0;
+    uint64_t num_uploaded_bytes = 0;
+
+    for (uint32_t edit = 0; edit < BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS; ++edit)
+    {
+        uint32_t vertex_index = (uint32_t)(Benchmark_RandomFloat() * scene->num_vertices);
+
+        Scene_SetVertexPosition(scene, vertex_index, scene->vertices[vertex_index].position + glm::vec3(0.0f, 0.25f, 0.0f));
+
+        double start_time = Benchmark_GetTime();
+
+        num_runs = Scene_Geometry_CollectDirtyRuns(scene);
+
+        for (uint32_t i = 0; i < num_runs; ++i)
+        {
+            const Scene_Geometry_Run* run = scene->geometry.runs + i;
+            Scene_Geometry_WriteFaces(scene, run->first_face, run->num_faces, incremental_vertices + run->first_vertex, incremental_indices + run->first_index);
+
+            num_uploaded_bytes += (uint64_t)run->num_vertices * sizeof(SVertex) + (uint64_t)run->num_indices * sizeof(uint32_t);
+        }
+
+        Scene_Geometry_ClearDirty(scene);
+
+        incremental_seconds += Benchmark_GetTime() - start_time;
+
+        // Full regeneration is expensive, so only every hundredth edit is timed with it, including the last one
+        if (edit % 100 == 99)
+        {
+            start_time = Benchmark_GetTime();
+
+            uint32_t num_generated_vertices, num_generated_indices;
+            bool32_t generate_result = Scene_GenerateGeometry(
+                scene,
+                full_vertices,
+                num_vertices,
+                full_indices,
+                num_indices,
+                &num_generated_vertices,
+                &num_generated_indices
+            );
+
+            full_seconds += Benchmark_GetTime() - start_time;
+
+            ASSERT(generate_result == TRUE);
+            UNUSED(generate_result);
+        }
+    }
+
+    full_seconds /= BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS / 100;
+
+    bool32_t identical =
+        memcmp(full_vertices, incremental_vertices, (uint64_t)num_vertices * sizeof(SVertex)) == 0 &&
+        memcmp(full_indices, incremental_indices, (uint64_t)num_indices * sizeof(uint32_t)) == 0;
+
+    uint64_t full_bytes = (uint64_t)num_vertices * sizeof(SVertex) + (uint64_t)num_indices * sizeof(uint32_t);
+
+    printf("geometry-update: %u faces, %u single vertex edits, %u threads\n", scene->num_faces, BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS, Jobs_GetNumThreads());
+    printf("  %-12s %10.3f ms/edit %12.1f KB/edit\n", "full", full_seconds * 1e3, full_bytes / 1024.0);
+    printf(
+        "  %-12s %10.3f ms/edit %12.1f KB/edit %8.1fx %s\n",
+        "dirty runs",
+        incremental_seconds * 1e3 / BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS,
+        num_uploaded_bytes / 1024.0 / BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS,
+        full_seconds * BENCHMARK_GEOMETRY_UPDATE_NUM_EDITS / incremental_seconds,
+        identical ? "identical" : "MISMATCH"
+    );
+
+    Arena_Destroy(&arena);
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_TRIANGULATION_NUM_CELLS_PER_SIDE 512
+#define BENCHMARK_TRIANGULATION_NUM_STAR_POINTS 5
+#define BENCHMARK_TRIANGULATION_NUM_FRAMES 10
+
+// Twice the area of the triangles of a face when seen along its normal, and whether any of them is flipped
+static float Benchmark_Triangulation_MeasureFace(const Scene* scene, const SVertex* vertices, const uint32_t* indices, uint32_t face_index, bool32_t* out_flipped)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    float area = 0.0f;
+    *out_flipped = FALSE;
+
+    for (uint32_t i = 0; i < 3 * (face->num_half_edges - 2); i += 3)
+    {
+        glm::vec3 a = vertices[indices[i + 0]].position;
+        glm::vec3 b = vertices[indices[i + 1]].position;
+        glm::vec3 c = vertices[indices[i + 2]].position;
+
+        float triangle_area = glm::dot(glm::cross(b - a, c - a), face->normal);
+        if (triangle_area < 0.0f) *out_flipped = TRUE;
+
+        area += fabsf(triangle_area);
+    }
+
+    return area;
+}
+
+// Fills a grid with slightly bent star shaped faces, then compares the cached triangulations with the fans that were drawn
+// before and times geometry generation with and without the cache
+static void Benchmark_Triangulation(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+
+    const uint32_t num_corners = 2 * BENCHMARK_TRIANGULATION_NUM_STAR_POINTS;
+
+    for (uint32_t x = 0; x < BENCHMARK_TRIANGULATION_NUM_CELLS_PER_SIDE; ++x)
+    {
+        for (uint32_t z = 0; z < BENCHMARK_TRIANGULATION_NUM_CELLS_PER_SIDE; ++z)
+        {
+            uint32_t face_vertices[num_corners];
+
+            for (uint32_t i = 0; i < num_corners; ++i)
+            {
+                // Clockwise seen from above, like the grid faces, so the star faces up
+                float angle = -2.0f * 3.14159265f * i / num_corners;
+                float radius = (i % 2 == 0) ? 0.45f : 0.2f;
+                float height = 0.02f * (Benchmark_RandomFloat() - 0.5f);
+
+                face_vertices[i] = Scene_AddVertex(scene, { x + 0.5f + radius * cosf(angle), height, z + 0.5f + radius * sinf(angle) });
+            }
+
+            uint32_t face_index = Scene_ConstructFace(scene, face_vertices, num_corners, { 1.0f, 1.0f, 1.0f, 1.0f });
+            ASSERT(face_index != SCENE_ID_NONE);
+            UNUSED(face_index);
+        }
+    }
+
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
+
+    SVertex*  vertices = (SVertex*)malloc((uint64_t)num_vertices * sizeof(SVertex));
+    uint32_t* indices  = (uint32_t*)malloc((uint64_t)num_indices * sizeof(uint32_t));
+
+    uint32_t num_generated_vertices, num_generated_indices;
+
+    double start_time = Benchmark_GetTime();
+    bool32_t generate_result = Scene_GenerateGeometry(scene, vertices, num_vertices, indices, num_indices, &num_generated_vertices, &num_generated_indices);
+    double first_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(generate_result == TRUE);
+
+    // Ear clipping has to cover every face exactly, the fans the faces used to get overlap and fold over
+    uint32_t num_flipped_faces = 0;
+    uint32_t num_flipped_fan_faces = 0;
+    uint32_t num_wrong_area_faces = 0;
+
+    uint32_t fan_indices[3 * (num_corners - 2)];
+
+    for (uint32_t face_index = 0; face_index < scene->num_faces; ++face_index)
+    {
+        uint32_t first_vertex = Scene_Face_GetFirstGeometryVertex(scene, face_index);
+
+        for (uint32_t i = 2; i < num_corners; ++i)
+        {
+            fan_indices[3 * (i - 2) + 0] = first_vertex;
+            fan_indices[3 * (i - 2) + 1] = first_vertex + i - 1;
+            fan_indices[3 * (i - 2) + 2] = first_vertex + i;
+        }
+
+        bool32_t flipped, fan_flipped;
+        float area = Benchmark_Triangulation_MeasureFace(scene, vertices, indices + Scene_Face_GetFirstGeometryIndex(scene, face_index), face_index, &flipped);
+        Benchmark_Triangulation_MeasureFace(scene, vertices, fan_indices, face_index, &fan_flipped);
+
+        // The outline encloses twice the area of the star along the normal
+        float outline_area = 0.0f;
+
+        for (uint32_t i = 0; i < num_corners; ++i)
+        {
+            glm::vec3 a = vertices[first_vertex].position;
+            glm::vec3 b = vertices[first_vertex + i].position;
+            glm::vec3 c = vertices[first_vertex + (i + 1) % num_corners].position;
+
+            outline_area += glm::dot(glm::cross(b - a, c - a), scene->faces[face_index].normal);
+        }
+
+        num_flipped_faces += flipped;
+        num_flipped_fan_faces += fan_flipped;
+        num_wrong_area_faces += fabsf(area - outline_area) > 1e-3f * outline_area;
+    }
+
+    double cached_seconds = 0.0;
+    double uncached_seconds = 0.0;
+
+    for (uint32_t frame = 0; frame < BENCHMARK_TRIANGULATION_NUM_FRAMES; ++frame)
+    {
+        start_time = Benchmark_GetTime();
+        generate_result = Scene_GenerateGeometry(scene, vertices, num_vertices, indices, num_indices, &num_generated_vertices, &num_generated_indices);
+        cached_seconds += Benchmark_GetTime() - start_time;
+
+        // Every face going stale is what triangulating on every call would cost
+        start_time = Benchmark_GetTime();
+
+        for (uint32_t face_index = 0; face_index < scene->num_faces; ++face_index)
+            Scene_Geometry_MarkFaceDirty(scene, face_index);
+
+        generate_result = generate_result && Scene_GenerateGeometry(scene, vertices, num_vertices, indices, num_indices, &num_generated_vertices, &num_generated_indices);
+        uncached_seconds += Benchmark_GetTime() - start_time;
+
+        ASSERT(generate_result == TRUE);
+    }
+
+    UNUSED(generate_result);
+
+    // A moved vertex only makes its own face stale
+    Scene_SetVertexPosition(scene, 1, scene->vertices[1].position + glm::vec3(0.0f, 0.1f, 0.0f));
+    uint32_t num_stale_faces = scene->geometry.num_stale_faces;
+
+    printf("triangulation: %u star faces of %u corners\n", scene->num_faces, num_corners);
+    printf("  %-24s %10.1f ms\n", "first generation", first_seconds * 1e3);
+    printf("  %-24s %10.1f ms per frame\n", "cached", cached_seconds * 1e3 / BENCHMARK_TRIANGULATION_NUM_FRAMES);
+    printf("  %-24s %10.1f ms per frame\n", "triangulated every call", uncached_seconds * 1e3 / BENCHMARK_TRIANGULATION_NUM_FRAMES);
+    printf("  %-24s %10u faces flipped, %u with the wrong area (fans: %u flipped)\n", "ear clipping", num_flipped_faces, num_wrong_area_faces, num_flipped_fan_faces);
+    printf("  %-24s %10u stale face after moving a vertex\n", "invalidation", num_stale_faces);
+
+    free(indices);
+    free(vertices);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_VERTEX_FORMAT_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_VERTEX_FORMAT_NUM_REPEATS 5
+
+// Mirrors the decoding in OpenGL_Shader_Scene_Packed_VertexSource
+static glm::vec3 Benchmark_VertexFormat_DecodePosition(const SPackedVertex* vertex)
+{
+    glm::vec3 position;
+
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        uint32_t chunk = (vertex->chunk >> (5 * axis)) & 31u;
+        float steps = (float)(chunk * 65536u + vertex->position[axis]) - (float)(GEOMETRY_PACKED_POSITION_NUM_CHUNKS_PER_AXIS * 32768u);
+
+        position[axis] = steps / GEOMETRY_PACKED_POSITION_STEPS_PER_UNIT;
+    }
+
+    return position;
+}
+
+static glm::vec3 Benchmark_VertexFormat_DecodeNormal(const SPackedVertex* vertex)
+{
+    glm::vec2 encoded = glm::max(glm::vec2(vertex->normal[0], vertex->normal[1]) / 32767.0f, glm::vec2(-1.0f));
+    glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+
+    float fold = glm::max(-normal.z, 0.0f);
+    normal.x += (normal.x >= 0.0f) ? -fold : fold;
+    normal.y += (normal.y >= 0.0f) ? -fold : fold;
+
+    return glm::normalize(normal);
+}
+
+// Writes the geometry of a million face grid in both vertex formats and copies it to a stand-in for the mapped buffers,
+// then checks how much the packed vertices lost
+static void Benchmark_VertexFormat(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_VERTEX_FORMAT_NUM_CELLS_PER_SIDE);
+
+    // Bent faces give normals in every direction, and positions off the fixed point steps
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+        Scene_SetVertexPosition(scene, i, scene->vertices[i].position + glm::vec3(Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat()) * 0.3f);
+
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
+
+    SVertex*       vertices        = (SVertex*)malloc((uint64_t)num_vertices * sizeof(SVertex));
+    SPackedVertex* packed_vertices = (SPackedVertex*)malloc((uint64_t)num_vertices * sizeof(SPackedVertex));
+    uint32_t*      indices         = (uint32_t*)malloc((uint64_t)num_indices * sizeof(uint32_t));
+    uint8_t*       mapped_buffer   = (uint8_t*)malloc((uint64_t)num_vertices * sizeof(SVertex));
+
+    double write_seconds[2] = {};
+    double upload_seconds[2] = {};
+
+    for (uint32_t repeat = 0; repeat < BENCHMARK_VERTEX_FORMAT_NUM_REPEATS; ++repeat)
+    {
+        double start_time = Benchmark_GetTime();
+        Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+        write_seconds[0] += Benchmark_GetTime() - start_time;
+
+        start_time = Benchmark_GetTime();
+        memcpy(mapped_buffer, vertices, (uint64_t)num_vertices * sizeof(SVertex));
+        upload_seconds[0] += Benchmark_GetTime() - start_time;
+
+        start_time = Benchmark_GetTime();
+        Scene_Geometry_WritePackedFaces(scene, 0, scene->num_faces, packed_vertices, indices);
+        write_seconds[1] += Benchmark_GetTime() - start_time;
+
+        start_time = Benchmark_GetTime();
+        memcpy(mapped_buffer, packed_vertices, (uint64_t)num_vertices * sizeof(SPackedVertex));
+        upload_seconds[1] += Benchmark_GetTime() - start_time;
+    }
+
+    float max_position_error = 0.0f;
+    float min_normal_cosine = 1.0f;
+    uint32_t num_mismatches = 0;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        const SVertex* vertex = vertices + i;
+        const SPackedVertex* packed_vertex = packed_vertices + i;
+
+        glm::vec3 position_error = glm::abs(Benchmark_VertexFormat_DecodePosition(packed_vertex) - vertex->position);
+        max_position_error = glm::max(max_position_error, glm::max(position_error.x, glm::max(position_error.y, position_error.z)));
+
+        min_normal_cosine = glm::min(min_normal_cosine, glm::dot(Benchmark_VertexFormat_DecodeNormal(packed_vertex), vertex->normal));
+
+        for (uint32_t channel = 0; channel < 4; ++channel)
+            num_mismatches += fabsf(packed_vertex->color[channel] / 255.0f - vertex->color[channel]) > 0.5f / 255.0f + 1e-6f;
+
+        num_mismatches += packed_vertex->corner_id != vertex->cell_ids.y || packed_vertex->face_id != vertex->cell_ids.z;
+    }
+
+    const char* labels[2] = { "SVertex", "SPackedVertex" };
+    uint32_t vertex_sizes[2] = { sizeof(SVertex), sizeof(SPackedVertex) };
+
+    printf("vertex-format: %u faces, %u vertices, %u threads\n", scene->num_faces, num_vertices, Jobs_GetNumThreads());
+
+    for (uint32_t format = 0; format < 2; ++format)
+    {
+        printf(
+            "  %-14s %3u bytes/vertex %8.1f MB   write %8.2f ms   upload %8.2f ms\n",
+            labels[format],
+            vertex_sizes[format],
+            (uint64_t)num_vertices * vertex_sizes[format] / (1024.0 * 1024.0),
+            write_seconds[format] * 1e3 / BENCHMARK_VERTEX_FORMAT_NUM_REPEATS,
+            upload_seconds[format] * 1e3 / BENCHMARK_VERTEX_FORMAT_NUM_REPEATS
+        );
+    }
+
+    printf(
+        "  position error %.5f, normal error %.4f degrees, %u mismatched colors or ids\n",
+        max_position_error,
+        acosf(glm::min(min_normal_cosine, 1.0f)) * 180.0f / 3.14159265f,
+        num_mismatches
+    );
+
+    free(mapped_buffer);
+    free(indices);
+    free(packed_vertices);
+    free(vertices);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_REORDER_NUM_CELLS_PER_SIDE 512
+#define BENCHMARK_REORDER_RAY_RESOLUTION 512
+#define BENCHMARK_REORDER_NUM_RAYS (BENCHMARK_REORDER_RAY_RESOLUTION * BENCHMARK_REORDER_RAY_RESOLUTION)
+#define BENCHMARK_REORDER_NUM_REPEATS 5
+
+// Simulated direct mapped cache of 512 lines of 64 bytes, about the size of an L1 data cache
+#define BENCHMARK_REORDER_CACHE_NUM_LINES 512
+
+struct Benchmark_Reorder_Cache
+{
+    uintptr_t line_tags[BENCHMARK_REORDER_CACHE_NUM_LINES];
+    uint64_t  num_misses;
+};
+
+static void Benchmark_Reorder_Touch(Benchmark_Reorder_Cache* cache, const void* address, uint64_t size)
+{
+    for (uintptr_t line = (uintptr_t)address >> 6; line <= ((uintptr_t)address + size - 1) >> 6; ++line)
+    {
+        uintptr_t* tag = cache->line_tags + (line % BENCHMARK_REORDER_CACHE_NUM_LINES);
+
+        if (*tag != line)
+        {
+            *tag = line;
+            ++cache->num_misses;
+        }
+    }
+}
+
+// Replays the topology reads of writing the geometry of a face, which ray casts repeat for the faces in the tree leaves
+static void Benchmark_Reorder_TouchFace(Benchmark_Reorder_Cache* cache, const Scene* scene, uint32_t face_index)
+{
+    const Scene_Face* face = scene->faces + face_index;
+    Benchmark_Reorder_Touch(cache, face, sizeof(Scene_Face));
+
+    for (uint32_t i = 0; i < face->num_half_edges; ++i)
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + face->first_half_edge + i;
+
+        Benchmark_Reorder_Touch(cache, half_edge, sizeof(Scene_HalfEdge));
+        Benchmark_Reorder_Touch(cache, scene->vertices + half_edge->origin_vertex, sizeof(Scene_Vertex));
+    }
+}
+
+static void Benchmark_Reorder_Measure(const char* label, Scene* scene, const Scene_Ray* rays, Scene_RayHit* hits, SVertex* vertices, uint32_t* indices)
+{
+    // The first calls build the tree and the triangulations
+    Scene_Geometry_UpdateTriangulations(scene);
+    Scene_RayCast_FindNearestIntersectingFaces(scene, rays, BENCHMARK_REORDER_NUM_RAYS, hits);
+
+    double start_time = Benchmark_GetTime();
+
+    for (uint32_t repeat = 0; repeat < BENCHMARK_REORDER_NUM_REPEATS; ++repeat)
+        Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+
+    double write_seconds = (Benchmark_GetTime() - start_time) / BENCHMARK_REORDER_NUM_REPEATS;
+
+    start_time = Benchmark_GetTime();
+
+    for (uint32_t repeat = 0; repeat < BENCHMARK_REORDER_NUM_REPEATS; ++repeat)
+        Scene_RayCast_FindNearestIntersectingFaces(scene, rays, BENCHMARK_REORDER_NUM_RAYS, hits);
+
+    double ray_seconds = (Benchmark_GetTime() - start_time) / BENCHMARK_REORDER_NUM_REPEATS;
+
+    // Misses of walking the faces in geometry order and in the order of the tree leaves
+    Benchmark_Reorder_Cache* cache = (Benchmark_Reorder_Cache*)calloc(1, sizeof(Benchmark_Reorder_Cache));
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+        Benchmark_Reorder_TouchFace(cache, scene, i);
+
+    double write_misses = (double)cache->num_misses / scene->num_faces;
+    cache->num_misses = 0;
+
+    for (uint32_t i = 0; i < scene->bvh.num_faces; ++i)
+        Benchmark_Reorder_TouchFace(cache, scene, scene->bvh.face_indices[i]);
+
+    double leaf_misses = (double)cache->num_misses / scene->bvh.num_faces;
+    free(cache);
+
+    printf(
+        "  %-10s write %7.2f ms %5.2f misses/face   ray casts %7.1f ns/ray %5.2f misses/leaf face\n",
+        label,
+        write_seconds * 1e3,
+        write_misses,
+        ray_seconds * 1e9 / BENCHMARK_REORDER_NUM_RAYS,
+        leaf_misses
+    );
+}
+
+// Builds a grid whose vertices and faces were created in random order, like meshes edited for a long time or imported
+// from tools that do not care about locality, then measures geometry writes and ray casts before and after reordering
+static void Benchmark_Reorder(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+
+    uint32_t num_vertices_per_side = BENCHMARK_REORDER_NUM_CELLS_PER_SIDE + 1;
+    uint32_t num_grid_vertices = num_vertices_per_side * num_vertices_per_side;
+    uint32_t num_cells = BENCHMARK_REORDER_NUM_CELLS_PER_SIDE * BENCHMARK_REORDER_NUM_CELLS_PER_SIDE;
+
+    uint32_t* order = (uint32_t*)malloc((uint64_t)glm::max(num_grid_vertices, num_cells) * sizeof(uint32_t));
+    uint32_t* grid_vertex_indices = (uint32_t*)malloc((uint64_t)num_grid_vertices * sizeof(uint32_t));
+    float* column_heights = (float*)malloc((uint64_t)num_vertices_per_side * sizeof(float));
+
+    // Every column of vertices has its own height, so all faces stay planar
+    for (uint32_t x = 0; x < num_vertices_per_side; ++x)
+        column_heights[x] = Benchmark_RandomFloat();
+
+    for (uint32_t i = 0; i < num_grid_vertices; ++i)
+        order[i] = i;
+
+    for (uint32_t i = num_grid_vertices - 1; i > 0; --i)
+    {
+        uint32_t j = (uint32_t)(Benchmark_RandomFloat() * (i + 1));
+        if (j > i) j = i;
+
+        uint32_t swap = order[i]; order[i] = order[j]; order[j] = swap;
+    }
+
+    for (uint32_t i = 0; i < num_grid_vertices; ++i)
+    {
+        uint32_t x = order[i] / num_vertices_per_side;
+        uint32_t z = order[i] % num_vertices_per_side;
+
+        grid_vertex_indices[order[i]] = Scene_AddVertex(scene, { (float)x, column_heights[x], (float)z });
+    }
+
+    for (uint32_t i = 0; i < num_cells; ++i)
+        order[i] = i;
+
+    for (uint32_t i = num_cells - 1; i > 0; --i)
+    {
+        uint32_t j = (uint32_t)(Benchmark_RandomFloat() * (i + 1));
+        if (j > i) j = i;
+
+        uint32_t swap = order[i]; order[i] = order[j]; order[j] = swap;
+    }
+
+    for (uint32_t i = 0; i < num_cells; ++i)
+    {
+        uint32_t x = order[i] / BENCHMARK_REORDER_NUM_CELLS_PER_SIDE;
+        uint32_t z = order[i] % BENCHMARK_REORDER_NUM_CELLS_PER_SIDE;
+
+        uint32_t face_vertices[4] = {
+            grid_vertex_indices[x * num_vertices_per_side + z],
+            grid_vertex_indices[x * num_vertices_per_side + z + 1],
+            grid_vertex_indices[(x + 1) * num_vertices_per_side + z + 1],
+            grid_vertex_indices[(x + 1) * num_vertices_per_side + z],
+        };
+
+        glm::vec4 color = { Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat(), 1.0f };
+
+        uint32_t face_index = Scene_ConstructFace(scene, face_vertices, ARRAY_SIZE_U32(face_vertices), color);
+        ASSERT(face_index != SCENE_ID_NONE);
+        UNUSED(face_index);
+    }
+
+    free(column_heights);
+    free(grid_vertex_indices);
+    free(order);
+
+    // Rays straight down through a camera like raster over the grid, so neighbouring rays hit neighbouring faces
+
+    Scene_Ray* rays = (Scene_Ray*)malloc((uint64_t)BENCHMARK_REORDER_NUM_RAYS * sizeof(Scene_Ray));
+    Scene_RayHit* hits = (Scene_RayHit*)malloc((uint64_t)BENCHMARK_REORDER_NUM_RAYS * sizeof(Scene_RayHit));
+    Scene_RayHit* reference_hits = (Scene_RayHit*)malloc((uint64_t)BENCHMARK_REORDER_NUM_RAYS * sizeof(Scene_RayHit));
+
+    const float ray_spacing = (float)BENCHMARK_REORDER_NUM_CELLS_PER_SIDE / BENCHMARK_REORDER_RAY_RESOLUTION;
+
+    for (uint32_t i = 0; i < BENCHMARK_REORDER_NUM_RAYS; ++i)
+    {
+        float x = (i % BENCHMARK_REORDER_RAY_RESOLUTION + 0.5f) * ray_spacing;
+        float z = (i / BENCHMARK_REORDER_RAY_RESOLUTION + 0.5f) * ray_spacing;
+
+        rays[i].origin     = { x, 5.0f, z };
+        rays[i].min_length = 0.01f;
+        rays[i].direction  = { 0.0f, -1.0f, 0.0f };
+        rays[i].max_length = 100.0f;
+    }
+
+    SVertex* vertices = (SVertex*)malloc((uint64_t)Scene_GetNumGeometryVertices(scene) * sizeof(SVertex));
+    uint32_t* indices = (uint32_t*)malloc((uint64_t)Scene_GetNumGeometryIndices(scene) * sizeof(uint32_t));
+
+    printf("reorder: %u faces, %u vertices, %u rays, %u threads\n", scene->num_faces, scene->num_vertices, BENCHMARK_REORDER_NUM_RAYS, Jobs_GetNumThreads());
+
+    Benchmark_Reorder_Measure("shuffled", scene, rays, reference_hits, vertices, indices);
+
+    double start_time = Benchmark_GetTime();
+    Scene_Reorder(scene);
+    double reorder_seconds = Benchmark_GetTime() - start_time;
+
+    Benchmark_Reorder_Measure("reordered", scene, rays, hits, vertices, indices);
+
+    // Face indices changed, but every ray still has to hit the same spot
+    uint32_t num_mismatches = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_REORDER_NUM_RAYS; ++i)
+    {
+        bool32_t is_hit = (hits[i].index != SCENE_ID_NONE);
+        bool32_t is_reference_hit = (reference_hits[i].index != SCENE_ID_NONE);
+
+        num_mismatches += (is_hit != is_reference_hit) || (is_hit && fabsf(hits[i].length - reference_hits[i].length) > 1e-4f);
+    }
+
+    printf("  reordering took %.2f ms, %u mismatched ray hits\n", reorder_seconds * 1e3, num_mismatches);
+
+    free(indices);
+    free(vertices);
+    free(reference_hits);
+    free(hits);
+    free(rays);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_PICK_NUM_RAYS 1000
+#define BENCHMARK_PICK_NUM_EDITS 1000
+#define BENCHMARK_PICK_RADIUS_PER_LENGTH 0.01f
+
+// The brute force edge test takes milliseconds per ray on the large grid, only the first rays are checked against it
+#define BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS 100
+
+static glm::vec3 Benchmark_Pick_Origins[BENCHMARK_PICK_NUM_RAYS];
+static glm::vec3 Benchmark_Pick_Directions[BENCHMARK_PICK_NUM_RAYS];
+static uint32_t  Benchmark_Pick_ReferenceHits[BENCHMARK_PICK_NUM_RAYS];
+static uint32_t  Benchmark_Pick_ReferenceEdgeHits[BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS];
+static float     Benchmark_Pick_ReferenceEdgeLengths[BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS];
+
+// Same cone test as the pick grid: the vertex nearest along the ray wins, ties go to the one nearer to the ray
+static uint32_t Benchmark_Pick_FindNearestVertexBruteForce(const Scene* scene, glm::vec3 ray_origin, glm::vec3 ray_direction, float ray_max_length)
+{
+    uint32_t nearest_vertex = SCENE_ID_NONE;
+    float nearest_length = FLT_MAX;
+    float nearest_distance_squared = FLT_MAX;
+
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+    {
+        glm::vec3 offset = scene->vertices[i].position - ray_origin;
+
+        float length = glm::dot(offset, ray_direction);
+        if (length <= 0.0f || length > ray_max_length || length > nearest_length)
+            continue;
+
+        float distance_squared = glm::dot(offset, offset) - length * length;
+        float radius = length * BENCHMARK_PICK_RADIUS_PER_LENGTH;
+
+        if (distance_squared > radius * radius)
+            continue;
+
+        if (length == nearest_length && distance_squared >= nearest_distance_squared)
+            continue;
+
+        nearest_vertex = i;
+        nearest_length = length;
+        nearest_distance_squared = distance_squared;
+    }
+
+    return nearest_vertex;
+}
+
+// Same test as the pick grid on the half-edge that represents every edge, the point of the edge closest to the ray is
+// tested like a vertex
+static uint32_t Benchmark_Pick_FindNearestEdgeBruteForce(const Scene* scene, glm::vec3 ray_origin, glm::vec3 ray_direction, float ray_max_length, float* out_length)
+{
+    uint32_t nearest_half_edge = SCENE_ID_NONE;
+    float nearest_length = FLT_MAX;
+    float nearest_distance_squared = FLT_MAX;
+
+    for (uint32_t i = 0; i < scene->num_half_edges; ++i)
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + i;
+
+        if (half_edge->face == SCENE_ID_DELETED || (half_edge->opposite_half_edge != SCENE_ID_NONE && half_edge->opposite_half_edge < i))
+            continue;
+
+        glm::vec3 start = scene->vertices[half_edge->origin_vertex].position;
+        glm::vec3 edge = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, i)].position - start;
+
+        glm::vec3 start_offset = start - ray_origin;
+        glm::vec3 start_perpendicular = start_offset - glm::dot(start_offset, ray_direction) * ray_direction;
+        glm::vec3 edge_perpendicular = edge - glm::dot(edge, ray_direction) * ray_direction;
+
+        float edge_perpendicular_length_squared = glm::dot(edge_perpendicular, edge_perpendicular);
+
+        float s = 0.5f;
+        if (edge_perpendicular_length_squared > FLT_EPSILON * glm::dot(edge, edge))
+            s = glm::clamp(-glm::dot(start_perpendicular, edge_perpendicular) / edge_perpendicular_length_squared, 0.0f, 1.0f);
+
+        glm::vec3 offset = start + s * edge - ray_origin;
+
+        float length = glm::dot(offset, ray_direction);
+        if (length <= 0.0f || length > ray_max_length || length > nearest_length)
+            continue;
+
+        float distance_squared = glm::dot(offset, offset) - length * length;
+        float radius = length * BENCHMARK_PICK_RADIUS_PER_LENGTH;
+
+        if (distance_squared > radius * radius)
+            continue;
+
+        if (length == nearest_length && distance_squared >= nearest_distance_squared)
+            continue;
+
+        nearest_half_edge = i;
+        nearest_length = length;
+        nearest_distance_squared = distance_squared;
+    }
+
+    *out_length = nearest_length;
+
+    return nearest_half_edge;
+}
+
+static void Benchmark_Pick_Run(uint32_t num_cells_per_side)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, num_cells_per_side);
+
+    const float grid_size = (float)num_cells_per_side;
+
+    // Hover rays from a camera above the grid, each aimed at a point of the grid in view of the camera
+    for (uint32_t i = 0; i < BENCHMARK_PICK_NUM_RAYS; ++i)
+    {
+        glm::vec3 origin = { Benchmark_RandomFloat() * grid_size, 10.0f, Benchmark_RandomFloat() * grid_size };
+
+        glm::vec3 target = origin + glm::vec3(20.0f * Benchmark_RandomFloat() - 10.0f, 0.0f, 20.0f * Benchmark_RandomFloat() - 10.0f);
+        target = glm::clamp(target, glm::vec3(0.0f), glm::vec3(grid_size));
+        target.y = 0.5f;
+
+        Benchmark_Pick_Origins[i] = origin;
+        Benchmark_Pick_Directions[i] = glm::normalize(target - origin);
+    }
+
+    double build_start_time = Benchmark_GetTime();
+    Scene_PickGrid_Update(scene);
+    double build_seconds = Benchmark_GetTime() - build_start_time;
+
+    printf("  %u vertices, grid built in %.1f ms\n", scene->num_vertices, build_seconds * 1e3);
+
+    // The second round runs after edits, which the grid relinks incrementally
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        double start_time = Benchmark_GetTime();
+
+        for (uint32_t i = 0; i < BENCHMARK_PICK_NUM_RAYS; ++i)
+            Benchmark_Pick_ReferenceHits[i] = Benchmark_Pick_FindNearestVertexBruteForce(scene, Benchmark_Pick_Origins[i], Benchmark_Pick_Directions[i], 1000.0f);
+
+        double brute_force_seconds = Benchmark_GetTime() - start_time;
+
+        uint32_t num_mismatches = 0;
+        uint32_t num_hits = 0;
+
+        double vertex_seconds = 0.0;
+
+        for (uint32_t i = 0; i < BENCHMARK_PICK_NUM_RAYS; ++i)
+        {
+            Scene_RayHit hit;
+
+            start_time = Benchmark_GetTime();
+            bool32_t is_hit = Scene_Pick_FindNearestVertex(scene, Benchmark_Pick_Origins[i], Benchmark_Pick_Directions[i], 1000.0f, BENCHMARK_PICK_RADIUS_PER_LENGTH, &hit);
+            vertex_seconds += Benchmark_GetTime() - start_time;
+
+            num_hits += is_hit;
+            num_mismatches += (hit.index != Benchmark_Pick_ReferenceHits[i]);
+        }
+
+        start_time = Benchmark_GetTime();
+
+        for (uint32_t i = 0; i < BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS; ++i)
+        {
+            Benchmark_Pick_ReferenceEdgeHits[i] = Benchmark_Pick_FindNearestEdgeBruteForce(
+                scene, Benchmark_Pick_Origins[i], Benchmark_Pick_Directions[i], 1000.0f, &Benchmark_Pick_ReferenceEdgeLengths[i]
+            );
+        }
+
+        double brute_force_edge_seconds = Benchmark_GetTime() - start_time;
+
+        uint32_t num_edge_mismatches = 0;
+        uint32_t num_edge_hits = 0;
+
+        double edge_seconds = 0.0;
+
+        for (uint32_t i = 0; i < BENCHMARK_PICK_NUM_RAYS; ++i)
+        {
+            Scene_RayHit hit;
+
+            start_time = Benchmark_GetTime();
+            bool32_t is_hit = Scene_Pick_FindNearestEdge(scene, Benchmark_Pick_Origins[i], Benchmark_Pick_Directions[i], 1000.0f, BENCHMARK_PICK_RADIUS_PER_LENGTH, &hit);
+            edge_seconds += Benchmark_GetTime() - start_time;
+
+            num_edge_hits += is_hit;
+
+            // Edges meeting at the picked point tie, any of them is right
+            if (i < BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS && hit.index != Benchmark_Pick_ReferenceEdgeHits[i])
+                num_edge_mismatches += (!is_hit || Benchmark_Pick_ReferenceEdgeHits[i] == SCENE_ID_NONE || hit.length != Benchmark_Pick_ReferenceEdgeLengths[i]);
+        }
+
+        const char* label = (round == 0) ? "built" : "after edits";
+
+        printf("  %-12s %-12s %10.1f ns/ray\n", label, "brute force", brute_force_seconds * 1e9 / BENCHMARK_PICK_NUM_RAYS);
+        printf("  %-12s %-12s %10.1f ns/ray   hits: %u   mismatches: %u\n", label, "grid vertex", vertex_seconds * 1e9 / BENCHMARK_PICK_NUM_RAYS, num_hits, num_mismatches);
+        printf("  %-12s %-12s %10.1f ns/ray\n", label, "brute edge", brute_force_edge_seconds * 1e9 / BENCHMARK_PICK_NUM_EDGE_REFERENCE_RAYS);
+        printf("  %-12s %-12s %10.1f ns/ray   hits: %u   mismatches: %u   long edges: %u\n", label, "grid edge", edge_seconds * 1e9 / BENCHMARK_PICK_NUM_RAYS, num_edge_hits, num_edge_mismatches, scene->pick_grid.num_long_edges);
+
+        if (round == 0)
+        {
+            start_time = Benchmark_GetTime();
+
+            for (uint32_t edit = 0; edit < BENCHMARK_PICK_NUM_EDITS; ++edit)
+            {
+                uint32_t vertex_index = (uint32_t)(Benchmark_RandomFloat() * scene->num_vertices);
+
+                glm::vec3 offset = { Benchmark_RandomFloat() - 0.5f, Benchmark_RandomFloat() - 0.5f, Benchmark_RandomFloat() - 0.5f };
+                Scene_SetVertexPosition(scene, vertex_index, scene->vertices[vertex_index].position + offset);
+
+                Scene_PickGrid_Update(scene);
+            }
+
+            printf("  %u edits relinked in %.1f us/edit\n", BENCHMARK_PICK_NUM_EDITS, (Benchmark_GetTime() - start_time) * 1e6 / BENCHMARK_PICK_NUM_EDITS);
+        }
+    }
+
+    Scene_Destroy(scene);
+}
+
+// Hover picking on a small and a large grid, the grid queries should cost about the same on both
+static void Benchmark_Pick(void)
+{
+    printf("pick: %u hover rays, cone of %.3f radius per length\n", BENCHMARK_PICK_NUM_RAYS, BENCHMARK_PICK_RADIUS_PER_LENGTH);
+
+    Benchmark_Pick_Run(22);
+    Benchmark_Pick_Run(707);
+}
+
+#define BENCHMARK_LEVEL_IO_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_LEVEL_IO_PATH "fps_benchmark_level.fpsl"
+
+// Saves a million face grid, loads it back and touches every page of the loaded topology
+static void Benchmark_LevelIO(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+
+    double start_time = Benchmark_GetTime();
+    Benchmark_BuildGridScene(scene, BENCHMARK_LEVEL_IO_NUM_CELLS_PER_SIDE);
+    double build_seconds = Benchmark_GetTime() - start_time;
+
+    uint64_t num_bytes =
+        (uint64_t)scene->num_vertices * sizeof(Scene_Vertex) +
+        (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge) +
+        (uint64_t)scene->num_faces * sizeof(Scene_Face);
+
+    printf("level-io: %u faces, %.1f MB of topology\n", scene->num_faces, num_bytes / (1024.0 * 1024.0));
+    printf("  %-16s %10.1f ms\n", "build", build_seconds * 1e3);
+
+    start_time = Benchmark_GetTime();
+    bool32_t save_result = Scene_Save(scene, BENCHMARK_LEVEL_IO_PATH);
+    double save_seconds = Benchmark_GetTime() - start_time;
+
+    if (!save_result)
+    {
+        printf("  could not save %s\n", BENCHMARK_LEVEL_IO_PATH);
+        Scene_Destroy(scene);
+        return;
+    }
+
+    printf("  %-16s %10.1f ms %10.1f MB/s\n", "save", save_seconds * 1e3, num_bytes / (1024.0 * 1024.0) / save_seconds);
+
+    Scene loaded_scene;
+
+    start_time = Benchmark_GetTime();
+    bool32_t load_result = Scene_Load(&loaded_scene, BENCHMARK_LEVEL_IO_PATH);
+    double load_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(load_result == TRUE);
+    UNUSED(load_result);
+
+    printf("  %-16s %10.3f ms\n", "load", load_seconds * 1e3);
+
+    // Reading one word per page faults every page in
+    start_time = Benchmark_GetTime();
+
+    uint32_t checksum = 0;
+
+    for (uint64_t offset = 0; offset < loaded_scene.half_edge_arena.offset; offset += 4096)
+        checksum += *(const uint32_t*)((const uint8_t*)loaded_scene.half_edges + offset);
+
+    for (uint64_t offset = 0; offset < loaded_scene.vertex_arena.offset; offset += 4096)
+        checksum += *(const uint32_t*)((const uint8_t*)loaded_scene.vertices + offset);
+
+    for (uint64_t offset = 0; offset < loaded_scene.face_arena.offset; offset += 4096)
+        checksum += *(const uint32_t*)((const uint8_t*)loaded_scene.faces + offset);
+
+    double touch_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-16s %10.1f ms   (checksum %08x)\n", "touch all pages", touch_seconds * 1e3, checksum);
+
+    bool32_t identical =
+        loaded_scene.num_vertices == scene->num_vertices &&
+        loaded_scene.num_half_edges == scene->num_half_edges &&
+        loaded_scene.num_faces == scene->num_faces &&
+        memcmp(loaded_scene.vertices, scene->vertices, (uint64_t)scene->num_vertices * sizeof(Scene_Vertex)) == 0 &&
+        memcmp(loaded_scene.half_edges, scene->half_edges, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge)) == 0 &&
+        memcmp(loaded_scene.faces, scene->faces, (uint64_t)scene->num_faces * sizeof(Scene_Face)) == 0;
+
+    // The loaded scene has to keep working like a built one, edits and new faces included
+    Scene_SetVertexPosition(&loaded_scene, 0, loaded_scene.vertices[0].position + glm::vec3(0.0f, 1.0f, 0.0f));
+
+    uint32_t new_vertex = Scene_AddVertex(&loaded_scene, { -1.0f, 0.0f, 0.0f });
+    uint32_t new_face_vertices[3] = { 1, 0, new_vertex };
+    uint32_t new_face = Scene_ConstructFace(&loaded_scene, new_face_vertices, ARRAY_SIZE_U32(new_face_vertices), { 1.0f, 1.0f, 1.0f, 1.0f });
+
+    uint32_t hit_face_index = SCENE_ID_NONE;
+    Scene_RayCast_FindNearestIntersectingFace(&loaded_scene, { -0.5f, 5.0f, 0.25f }, { 0.0f, -1.0f, 0.0f }, 0.01f, 100.0f, &hit_face_index, NULL);
+
+    bool32_t editable = new_face != SCENE_ID_NONE && hit_face_index == new_face;
+
+    printf("  %s, %s\n", identical ? "identical" : "MISMATCH", editable ? "editable" : "NOT EDITABLE");
+
+    Scene_Destroy(&loaded_scene);
+    Scene_Destroy(scene);
+
+    remove(BENCHMARK_LEVEL_IO_PATH);
+}
+
+#define BENCHMARK_IMPORT_NUM_CELLS_PER_SIDE 512
+#define BENCHMARK_IMPORT_OBJ_PATH "fps_benchmark_import.obj"
+#define BENCHMARK_IMPORT_PLY_PATH "fps_benchmark_import.ply"
+
+static uint32_t Benchmark_Import_CountPairedHalfEdges(const Scene* scene)
+{
+    uint32_t num_paired_half_edges = 0;
+
+    for (uint32_t i = 0; i < scene->num_half_edges; ++i)
+        num_paired_half_edges += (scene->half_edges[i].opposite_half_edge != SCENE_ID_NONE);
+
+    return num_paired_half_edges;
+}
+
+static void Benchmark_Import_Run(const char* label, const char* path, const Scene* reference_scene)
+{
+    Scene scene;
+    bool32_t scene_init_result = Scene_Init(&scene);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene_ImportStats stats;
+
+    double start_time = Benchmark_GetTime();
+    bool32_t import_result = Scene_Import(&scene, path, { 1.0f, 1.0f, 1.0f, 1.0f }, &stats);
+    double import_seconds = Benchmark_GetTime() - start_time;
+
+    if (!import_result)
+    {
+        printf("  %-4s could not import %s\n", label, path);
+        Scene_Destroy(&scene);
+        return;
+    }
+
+    bool32_t matches =
+        scene.num_vertices == reference_scene->num_vertices &&
+        scene.num_half_edges == reference_scene->num_half_edges &&
+        scene.num_faces == reference_scene->num_faces &&
+        Benchmark_Import_CountPairedHalfEdges(&scene) == Benchmark_Import_CountPairedHalfEdges(reference_scene);
+
+    printf(
+        "  %-4s %8.1f MB %10.1f ms %8.1f MB/s %8.1f MB scratch   %u -> %u vertices, %u faces, %s\n",
+        label,
+        stats.num_bytes / (1024.0 * 1024.0),
+        import_seconds * 1e3,
+        stats.num_bytes / (1024.0 * 1024.0) / import_seconds,
+        stats.num_scratch_bytes / (1024.0 * 1024.0),
+        stats.num_input_vertices,
+        stats.num_vertices,
+        stats.num_faces,
+        matches ? "matches" : "MISMATCH"
+    );
+
+    Scene_Destroy(&scene);
+}
+
+// Writes a grid as an OBJ triangle soup where every face has its own corners, and as an indexed binary PLY, then
+// imports both. Welding has to turn either one back into the connected grid.
+static void Benchmark_Import(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_IMPORT_NUM_CELLS_PER_SIDE);
+
+    FILE* obj_file = fopen(BENCHMARK_IMPORT_OBJ_PATH, "wb");
+    FILE* ply_file = fopen(BENCHMARK_IMPORT_PLY_PATH, "wb");
+
+    if (!obj_file || !ply_file)
+    {
+        printf("import: could not write the input files\n");
+
+        if (obj_file) fclose(obj_file);
+        if (ply_file) fclose(ply_file);
+
+        Scene_Destroy(scene);
+        return;
+    }
+
+    fprintf(obj_file, "# %u faces\n", scene->num_faces);
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        const Scene_Face* face = scene->faces + i;
+        uint32_t half_edge_index = face->first_half_edge;
+        uint32_t num_face_vertices = 0;
+
+        do
+        {
+            glm::vec3 position = scene->vertices[scene->half_edges[half_edge_index].origin_vertex].position;
+            fprintf(obj_file, "v %.9g %.9g %.9g\n", position.x, position.y, position.z);
+
+            half_edge_index = scene->half_edges[half_edge_index].next_half_edge;
+            ++num_face_vertices;
+        } while (half_edge_index != face->first_half_edge);
+
+        fprintf(obj_file, "f");
+
+        for (uint32_t j = 0; j < num_face_vertices; ++j)
+            fprintf(obj_file, " %d", (int32_t)j - (int32_t)num_face_vertices);
+
+        fprintf(obj_file, "\n");
+    }
+
+    fprintf(
+        ply_file,
+        "ply\nformat binary_little_endian 1.0\nelement vertex %u\nproperty float x\nproperty float y\nproperty float z\n"
+        "element face %u\nproperty list uchar int vertex_indices\nend_header\n",
+        scene->num_vertices,
+        scene->num_faces
+    );
+
+    // NOTE: Written as it is in memory, which is little endian on every platform the editor runs on
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+        fwrite(&scene->vertices[i].position, sizeof(glm::vec3), 1, ply_file);
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        const Scene_Face* face = scene->faces + i;
+
+        uint8_t num_face_vertices = 0;
+        int32_t face_vertices[255];
+
+        uint32_t half_edge_index = face->first_half_edge;
+
+        do
+        {
+            face_vertices[num_face_vertices++] = (int32_t)scene->half_edges[half_edge_index].origin_vertex;
+            half_edge_index = scene->half_edges[half_edge_index].next_half_edge;
+        } while (half_edge_index != face->first_half_edge);
+
+        fwrite(&num_face_vertices, 1, 1, ply_file);
+        fwrite(face_vertices, sizeof(int32_t), num_face_vertices, ply_file);
+    }
+
+    fclose(obj_file);
+    fclose(ply_file);
+
+    printf("import: %u faces, %u job threads\n", scene->num_faces, Jobs_GetNumThreads());
+
+    Benchmark_Import_Run("obj", BENCHMARK_IMPORT_OBJ_PATH, scene);
+    Benchmark_Import_Run("ply", BENCHMARK_IMPORT_PLY_PATH, scene);
+
+    remove(BENCHMARK_IMPORT_OBJ_PATH);
+    remove(BENCHMARK_IMPORT_PLY_PATH);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_JOURNAL_NUM_CELLS_PER_SIDE 512
+#define BENCHMARK_JOURNAL_NUM_DRAGS 200000
+#define BENCHMARK_JOURNAL_NUM_FRAMES_PER_DRAG 60
+#define BENCHMARK_JOURNAL_NUM_DRAGS_PER_FACE 200
+#define BENCHMARK_JOURNAL_NUM_UNDOS 1000
+
+struct Benchmark_Journal_Snapshot
+{
+    Scene_Vertex*   vertices;
+    Scene_HalfEdge* half_edges;
+    Scene_Face*     faces;
+    uint32_t        num_vertices;
+    uint32_t        num_half_edges;
+    uint32_t        num_faces;
+};
+
+static void Benchmark_Journal_TakeSnapshot(Scene* scene, Benchmark_Journal_Snapshot* snapshot)
+{
+    Scene_UpdateFacePlanes(scene);
+
+    snapshot->num_vertices   = scene->num_vertices;
+    snapshot->num_half_edges = scene->num_half_edges;
+    snapshot->num_faces      = scene->num_faces;
+
+    snapshot->vertices   = (Scene_Vertex*)malloc((uint64_t)scene->num_vertices * sizeof(Scene_Vertex));
+    snapshot->half_edges = (Scene_HalfEdge*)malloc((uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge));
+    snapshot->faces      = (Scene_Face*)malloc((uint64_t)scene->num_faces * sizeof(Scene_Face));
+
+    memcpy(snapshot->vertices, scene->vertices, (uint64_t)scene->num_vertices * sizeof(Scene_Vertex));
+    memcpy(snapshot->half_edges, scene->half_edges, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge));
+    memcpy(snapshot->faces, scene->faces, (uint64_t)scene->num_faces * sizeof(Scene_Face));
+}
+
+static bool32_t Benchmark_Journal_MatchesSnapshot(Scene* scene, const Benchmark_Journal_Snapshot* snapshot)
+{
+    Scene_UpdateFacePlanes(scene);
+
+    return
+        scene->num_vertices == snapshot->num_vertices &&
+        scene->num_half_edges == snapshot->num_half_edges &&
+        scene->num_faces == snapshot->num_faces &&
+        memcmp(scene->vertices, snapshot->vertices, (uint64_t)scene->num_vertices * sizeof(Scene_Vertex)) == 0 &&
+        memcmp(scene->half_edges, snapshot->half_edges, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge)) == 0 &&
+        memcmp(scene->faces, snapshot->faces, (uint64_t)scene->num_faces * sizeof(Scene_Face)) == 0;
+}
+
+static void Benchmark_Journal_FreeSnapshot(Benchmark_Journal_Snapshot* snapshot)
+{
+    free(snapshot->vertices);
+    free(snapshot->half_edges);
+    free(snapshot->faces);
+}
+
+// Simulates a long session of dragging faces, with a face added now and then, and checks that seeking through the history
+// reproduces the scene exactly
+static void Benchmark_Journal(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_JOURNAL_NUM_CELLS_PER_SIDE);
+
+    uint32_t num_grid_faces = scene->num_faces;
+
+    Scene_Journal journal;
+    bool32_t journal_init_result = Scene_Journal_Init(&journal, SCENE_JOURNAL_DEFAULT_CAPACITY);
+    ASSERT(journal_init_result == TRUE);
+    UNUSED(journal_init_result);
+
+    // The check point is taken late enough that the ring still holds it at the end
+    uint32_t check_drag = BENCHMARK_JOURNAL_NUM_DRAGS - SCENE_JOURNAL_MAX_NUM_GROUPS / 2;
+    uint64_t check_group = 0;
+
+    Benchmark_Journal_Snapshot check_snapshot = {};
+    Benchmark_Journal_Snapshot final_snapshot = {};
+
+    uint32_t num_constructed_faces = 0;
+    uint64_t num_moves = 0;
+
+    double start_time = Benchmark_GetTime();
+    double snapshot_seconds = 0.0;
+
+    for (uint32_t drag = 0; drag < BENCHMARK_JOURNAL_NUM_DRAGS; ++drag)
+    {
+        if (drag == check_drag)
+        {
+            double snapshot_start_time = Benchmark_GetTime();
+
+            check_group = journal.current_group;
+            Benchmark_Journal_TakeSnapshot(scene, &check_snapshot);
+
+            snapshot_seconds += Benchmark_GetTime() - snapshot_start_time;
+        }
+
+        // Triangles are added against the boundary edges at x = 0, which belong to the faces of the first column
+        if (drag % BENCHMARK_JOURNAL_NUM_DRAGS_PER_FACE == 0 && num_constructed_faces < BENCHMARK_JOURNAL_NUM_CELLS_PER_SIDE)
+        {
+            uint32_t z = num_constructed_faces++;
+
+            Scene_Journal_BeginGroup(&journal);
+
+            uint32_t new_vertex = Scene_Journal_AddVertex(&journal, scene, { -1.0f, 0.0f, (float)z + 0.5f });
+            uint32_t face_vertices[3] = { z + 1, z, new_vertex };
+            uint32_t face_index = Scene_Journal_ConstructFace(&journal, scene, face_vertices, ARRAY_SIZE_U32(face_vertices), { 1.0f, 1.0f, 1.0f, 1.0f });
+
+            ASSERT(face_index != SCENE_ID_NONE);
+            UNUSED(face_index);
+
+            Scene_Journal_EndGroup(&journal);
+        }
+
+        const Scene_Face* face = scene->faces + (uint32_t)(Benchmark_RandomFloat() * (num_grid_faces - 1));
+        float speed = Benchmark_RandomFloat() - 0.5f;
+
+        Scene_Journal_BeginGroup(&journal);
+
+        for (uint32_t frame = 0; frame < BENCHMARK_JOURNAL_NUM_FRAMES_PER_DRAG; ++frame)
+        {
+            uint32_t half_edge_index = face->first_half_edge;
+
+            do
+            {
+                uint32_t vertex_index = scene->half_edges[half_edge_index].origin_vertex;
+                Scene_Journal_SetVertexPosition(&journal, scene, vertex_index, scene->vertices[vertex_index].position + glm::vec3(0.0f, speed * 0.016f, 0.0f));
+
+                half_edge_index = scene->half_edges[half_edge_index].next_half_edge;
+                ++num_moves;
+            } while (half_edge_index != face->first_half_edge);
+        }
+
+        Scene_Journal_EndGroup(&journal);
+    }
+
+    double edit_seconds = Benchmark_GetTime() - start_time - snapshot_seconds;
+
+    Benchmark_Journal_TakeSnapshot(scene, &final_snapshot);
+
+    uint64_t num_history_bytes =
+        journal.group_starts[journal.current_group % SCENE_JOURNAL_MAX_NUM_GROUPS] -
+        journal.group_starts[journal.first_group % SCENE_JOURNAL_MAX_NUM_GROUPS];
+    uint64_t num_journal_bytes = journal.arena.committed + journal.merge_serial_arena.committed + journal.merge_position_arena.committed + journal.scratch_arena.committed;
+    uint64_t num_scene_bytes =
+        (uint64_t)scene->num_vertices * sizeof(Scene_Vertex) +
+        (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge) +
+        (uint64_t)scene->num_faces * sizeof(Scene_Face);
+
+    printf("journal: %u drags of %u frames and %u added faces on a %u face grid\n", BENCHMARK_JOURNAL_NUM_DRAGS, BENCHMARK_JOURNAL_NUM_FRAMES_PER_DRAG, num_constructed_faces, num_grid_faces);
+    printf("  %-24s %10.1f ns per move, %llu moves\n", "record", edit_seconds * 1e9 / num_moves, (unsigned long long)num_moves);
+    printf("  %-24s %10llu steps in %.1f MB of records\n", "history", (unsigned long long)(journal.current_group - journal.first_group), num_history_bytes / (1024.0 * 1024.0));
+    printf("  %-24s %10.1f MB committed, one copy of the scene is %.1f MB\n", "memory", num_journal_bytes / (1024.0 * 1024.0), num_scene_bytes / (1024.0 * 1024.0));
+
+    start_time = Benchmark_GetTime();
+
+    for (uint32_t i = 0; i < BENCHMARK_JOURNAL_NUM_UNDOS; ++i)
+        Scene_Journal_Undo(&journal, scene);
+
+    double undo_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-24s %10.3f us per step\n", "undo", undo_seconds * 1e6 / BENCHMARK_JOURNAL_NUM_UNDOS);
+
+    uint64_t num_seek_steps = journal.current_group - check_group;
+
+    start_time = Benchmark_GetTime();
+    Scene_Journal_Seek(&journal, scene, check_group);
+    double seek_seconds = Benchmark_GetTime() - start_time;
+
+    bool32_t check_matches = Benchmark_Journal_MatchesSnapshot(scene, &check_snapshot);
+
+    printf(
+        "  %-24s %10.1f ms for %llu steps, %s\n",
+        "seek back",
+        seek_seconds * 1e3,
+        (unsigned long long)num_seek_steps,
+        check_matches ? "matches" : "MISMATCH"
+    );
+
+    start_time = Benchmark_GetTime();
+    Scene_Journal_Seek(&journal, scene, journal.end_group);
+    seek_seconds = Benchmark_GetTime() - start_time;
+
+    bool32_t final_matches = Benchmark_Journal_MatchesSnapshot(scene, &final_snapshot);
+
+    printf("  %-24s %10.1f ms, %s\n", "seek to the end", seek_seconds * 1e3, final_matches ? "matches" : "MISMATCH");
+
+    Benchmark_Journal_FreeSnapshot(&final_snapshot);
+    Benchmark_Journal_FreeSnapshot(&check_snapshot);
+
+    Scene_Journal_Destroy(&journal);
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_SNAPSHOT_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_SNAPSHOT_NUM_DRAGS 2000
+#define BENCHMARK_SNAPSHOT_NUM_DRAGGED_COLUMNS 32
+#define BENCHMARK_SNAPSHOT_NUM_REPLACED_FACES 64
+#define BENCHMARK_SNAPSHOT_PATH "fps_benchmark_snapshot.fpsl"
+
+// Same kind of drags as in the journal benchmark, one frame each, in the part of the level that is being worked on
+static uint64_t Benchmark_Snapshot_Drag(Scene* scene)
+{
+    uint64_t num_moves = 0;
+
+    for (uint32_t drag = 0; drag < BENCHMARK_SNAPSHOT_NUM_DRAGS; ++drag)
+    {
+        uint32_t num_dragged_faces = BENCHMARK_SNAPSHOT_NUM_DRAGGED_COLUMNS * BENCHMARK_SNAPSHOT_NUM_CELLS_PER_SIDE;
+
+        const Scene_Face* face = scene->faces + (uint32_t)(Benchmark_RandomFloat() * (num_dragged_faces - 1));
+        float speed = Benchmark_RandomFloat() - 0.5f;
+
+        uint32_t half_edge_index = face->first_half_edge;
+
+        do
+        {
+            uint32_t vertex_index = scene->half_edges[half_edge_index].origin_vertex;
+            Scene_SetVertexPosition(scene, vertex_index, scene->vertices[vertex_index].position + glm::vec3(0.0f, speed * 0.016f, 0.0f));
+
+            half_edge_index = scene->half_edges[half_edge_index].next_half_edge;
+            ++num_moves;
+        } while (half_edge_index != face->first_half_edge);
+
+        Scene_UpdateFacePlanes(scene);
+    }
+
+    return num_moves;
+}
+
+struct Benchmark_Snapshot_Save
+{
+    const Scene_Snapshot* snapshot;
+    bool32_t result;
+    double seconds;
+};
+
+static void Benchmark_Snapshot_SaveThread(Benchmark_Snapshot_Save* save)
+{
+    double start_time = Benchmark_GetTime();
+    save->result = Scene_Snapshot_Save(save->snapshot, BENCHMARK_SNAPSHOT_PATH);
+    save->seconds = Benchmark_GetTime() - start_time;
+}
+
+// Drags vertices and replaces the last faces while a snapshot of the scene is saved on another thread, then checks that the
+// snapshot and the file still hold the scene from before the edits
+static void Benchmark_Snapshot(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_SNAPSHOT_NUM_CELLS_PER_SIDE);
+
+    uint64_t num_scene_bytes =
+        (uint64_t)scene->num_vertices * sizeof(Scene_Vertex) +
+        (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge) +
+        (uint64_t)scene->num_faces * sizeof(Scene_Face);
+
+    printf("snapshot: %u faces, %.1f MB of topology\n", scene->num_faces, num_scene_bytes / (1024.0 * 1024.0));
+
+    double start_time = Benchmark_GetTime();
+    uint64_t num_moves = Benchmark_Snapshot_Drag(scene);
+    double drag_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-24s %10.1f ns per move\n", "drag", drag_seconds * 1e9 / num_moves);
+
+    // Copying everything is what a consumer without snapshots would have to do
+    Benchmark_Journal_Snapshot reference;
+
+    start_time = Benchmark_GetTime();
+    Benchmark_Journal_TakeSnapshot(scene, &reference);
+    double copy_seconds = Benchmark_GetTime() - start_time;
+
+    Scene_Snapshot snapshot;
+    bool32_t snapshot_init_result = Scene_Snapshot_Init(&snapshot);
+    ASSERT(snapshot_init_result == TRUE);
+    UNUSED(snapshot_init_result);
+
+    start_time = Benchmark_GetTime();
+    bool32_t take_result = Scene_Snapshot_Take(&snapshot, scene);
+    double take_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(take_result == TRUE);
+    UNUSED(take_result);
+
+    printf("  %-24s %10.3f ms\n", "copy the scene", copy_seconds * 1e3);
+    printf("  %-24s %10.3f ms\n", "take a snapshot", take_seconds * 1e3);
+
+    Benchmark_Snapshot_Save save = {};
+    save.snapshot = &snapshot;
+
+    std::thread save_thread(Benchmark_Snapshot_SaveThread, &save);
+
+    start_time = Benchmark_GetTime();
+    num_moves = Benchmark_Snapshot_Drag(scene);
+    drag_seconds = Benchmark_GetTime() - start_time;
+
+    // Faces that are removed and constructed again reuse the indices of the snapshot
+    start_time = Benchmark_GetTime();
+
+    for (uint32_t i = 0; i < BENCHMARK_SNAPSHOT_NUM_REPLACED_FACES; ++i)
+        Scene_RemoveLastFace(scene);
+
+    for (uint32_t i = 0; i < BENCHMARK_SNAPSHOT_NUM_REPLACED_FACES; ++i)
+    {
+        uint32_t face_vertices[3] = { i, i + 1, i + BENCHMARK_SNAPSHOT_NUM_CELLS_PER_SIDE + 1 };
+        uint32_t face_index = Scene_ConstructFace(scene, face_vertices, ARRAY_SIZE_U32(face_vertices), { 1.0f, 0.0f, 0.0f, 1.0f });
+
+        ASSERT(face_index != SCENE_ID_NONE);
+        UNUSED(face_index);
+    }
+
+    double replace_seconds = Benchmark_GetTime() - start_time;
+
+    save_thread.join();
+
+    printf("  %-24s %10.1f ns per move while saving\n", "drag", drag_seconds * 1e9 / num_moves);
+    printf("  %-24s %10.3f ms for %u faces\n", "replace faces", replace_seconds * 1e3, BENCHMARK_SNAPSHOT_NUM_REPLACED_FACES);
+    printf("  %-24s %10.1f ms, %s\n", "save on another thread", save.seconds * 1e3, save.result ? "written" : "FAILED");
+    printf("  %-24s %10.1f MB of %.1f MB\n", "chunks copied", snapshot.copy_arena.offset / (1024.0 * 1024.0), num_scene_bytes / (1024.0 * 1024.0));
+
+    Scene snapshot_scene;
+    bool32_t snapshot_scene_init_result = Scene_Init(&snapshot_scene);
+    ASSERT(snapshot_scene_init_result == TRUE);
+    UNUSED(snapshot_scene_init_result);
+
+    snapshot_scene.vertices   = ARENA_ALLOCATE_ARRAY(&snapshot_scene.vertex_arena, Scene_Vertex, snapshot.num_vertices);
+    snapshot_scene.half_edges = ARENA_ALLOCATE_ARRAY(&snapshot_scene.half_edge_arena, Scene_HalfEdge, snapshot.num_half_edges);
+    snapshot_scene.faces      = ARENA_ALLOCATE_ARRAY(&snapshot_scene.face_arena, Scene_Face, snapshot.num_faces);
+
+    snapshot_scene.num_vertices   = snapshot.num_vertices;
+    snapshot_scene.num_half_edges = snapshot.num_half_edges;
+    snapshot_scene.num_faces      = snapshot.num_faces;
+
+    Scene_Snapshot_ReadVertices(&snapshot, 0, snapshot.num_vertices, snapshot_scene.vertices);
+    Scene_Snapshot_ReadHalfEdges(&snapshot, 0, snapshot.num_half_edges, snapshot_scene.half_edges);
+    Scene_Snapshot_ReadFaces(&snapshot, 0, snapshot.num_faces, snapshot_scene.faces);
+
+    bool32_t snapshot_matches = Benchmark_Journal_MatchesSnapshot(&snapshot_scene, &reference);
+
+    Scene loaded_scene;
+    bool32_t file_matches = save.result && Scene_Load(&loaded_scene, BENCHMARK_SNAPSHOT_PATH);
+
+    if (file_matches)
+    {
+        file_matches = Benchmark_Journal_MatchesSnapshot(&loaded_scene, &reference);
+        Scene_Destroy(&loaded_scene);
+    }
+
+    printf("  snapshot %s, file %s\n", snapshot_matches ? "matches" : "MISMATCH", file_matches ? "matches" : "MISMATCH");
+
+    Scene_Destroy(&snapshot_scene);
+    Benchmark_Journal_FreeSnapshot(&reference);
+
+    Scene_Snapshot_Release(&snapshot);
+    Scene_Snapshot_Destroy(&snapshot);
+    Scene_Destroy(scene);
+
+    remove(BENCHMARK_SNAPSHOT_PATH);
+}
+
+#define BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_DEFRAG_NUM_DELETED_FACES (BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE * BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE / 2)
+#define BENCHMARK_DEFRAG_NUM_DELETED_VERTICES 20000
+#define BENCHMARK_DEFRAG_NUM_REBUILT_FACES 10000
+#define BENCHMARK_DEFRAG_NUM_MOVES_PER_STEP 4096
+
+// Visits the live faces and their corners like any pass over the whole scene does. The sum of the fixed point heights does
+// not depend on the order of the faces, so it shows whether compacting lost or changed any of them.
+static double Benchmark_Defrag_Iterate(const Scene* scene, uint64_t* out_sum)
+{
+    double start_time = Benchmark_GetTime();
+    uint64_t sum = 0;
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        if (Scene_Face_IsDeleted(scene, i))
+            continue;
+
+        const Scene_Face* face = scene->faces + i;
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+            sum += (uint64_t)(scene->vertices[scene->half_edges[face->first_half_edge + j].origin_vertex].position.y * 65536.0f);
+    }
+
+    *out_sum = sum;
+    return Benchmark_GetTime() - start_time;
+}
+
+static void Benchmark_Defrag_Measure(const char* label, Scene* scene, SVertex* vertices, uint32_t* indices, uint64_t* out_sum)
+{
+    double iterate_seconds = Benchmark_Defrag_Iterate(scene, out_sum);
+
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    double start_time = Benchmark_GetTime();
+    Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+    double write_seconds = Benchmark_GetTime() - start_time;
+
+    printf(
+        "  %-16s %8u faces %8u vertices %10.3f ms iterate %10.3f ms geometry %10.1f MB\n",
+        label,
+        scene->num_faces,
+        scene->num_vertices,
+        iterate_seconds * 1e3,
+        write_seconds * 1e3,
+        ((uint64_t)Scene_GetNumGeometryVertices(scene) * sizeof(SVertex) + (uint64_t)Scene_GetNumGeometryIndices(scene) * sizeof(uint32_t)) / (1024.0 * 1024.0)
+    );
+}
+
+// Deletes half of a grid in random order, rebuilds a few of the faces into the freed slots and then compacts the rest in
+// steps sized like the ones the editor takes per frame
+static void Benchmark_Defrag(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE);
+
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
+
+    SVertex*  vertices = (SVertex*)malloc((uint64_t)num_vertices * sizeof(SVertex));
+    uint32_t* indices  = (uint32_t*)malloc((uint64_t)num_indices * sizeof(uint32_t));
+    uint32_t* deleted_faces = (uint32_t*)malloc((uint64_t)BENCHMARK_DEFRAG_NUM_DELETED_FACES * sizeof(uint32_t));
+
+    printf("defrag: %u faces, %u moves per step, %u threads\n", scene->num_faces, BENCHMARK_DEFRAG_NUM_MOVES_PER_STEP, Jobs_GetNumThreads());
+
+    uint64_t dense_sum;
+    Benchmark_Defrag_Measure("dense", scene, vertices, indices, &dense_sum);
+    UNUSED(dense_sum);
+
+    // Faces first, then vertices, which take the faces around them along
+    uint32_t num_deleted_faces = 0;
+
+    double start_time = Benchmark_GetTime();
+
+    while (num_deleted_faces < BENCHMARK_DEFRAG_NUM_DELETED_FACES)
+    {
+        uint32_t face_index = (uint32_t)(Benchmark_RandomFloat() * scene->num_faces);
+
+        if (!Scene_Face_IsDeleted(scene, face_index))
+        {
+            Scene_DeleteFace(scene, face_index);
+            deleted_faces[num_deleted_faces++] = face_index;
+        }
+    }
+
+    double delete_face_seconds = Benchmark_GetTime() - start_time;
+
+    uint32_t num_deleted_vertices = 0;
+
+    start_time = Benchmark_GetTime();
+
+    while (num_deleted_vertices < BENCHMARK_DEFRAG_NUM_DELETED_VERTICES)
+    {
+        uint32_t vertex_index = (uint32_t)(Benchmark_RandomFloat() * scene->num_vertices);
+
+        if (!Scene_Vertex_IsDeleted(scene, vertex_index))
+        {
+            Scene_DeleteVertex(scene, vertex_index);
+            ++num_deleted_vertices;
+        }
+    }
+
+    double delete_vertex_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-16s %10.1f ns per face\n", "delete faces", delete_face_seconds * 1e9 / num_deleted_faces);
+    printf("  %-16s %10.1f ns per vertex\n", "delete vertices", delete_vertex_seconds * 1e9 / num_deleted_vertices);
+
+    // Deleted cells whose corners are all still there are rebuilt, the quads fit the slots the deletion freed
+    uint32_t num_faces_before_rebuild = scene->num_faces;
+    uint32_t num_rebuilt_faces = 0;
+
+    start_time = Benchmark_GetTime();
+
+    for (uint32_t i = 0; i < num_deleted_faces && num_rebuilt_faces < BENCHMARK_DEFRAG_NUM_REBUILT_FACES; ++i)
+    {
+        uint32_t x = deleted_faces[i] / BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE;
+        uint32_t z = deleted_faces[i] % BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE;
+        uint32_t num_vertices_per_side = BENCHMARK_DEFRAG_NUM_CELLS_PER_SIDE + 1;
+
+        uint32_t face_vertices[4] = {
+            x * num_vertices_per_side + z,
+            x * num_vertices_per_side + z + 1,
+            (x + 1) * num_vertices_per_side + z + 1,
+            (x + 1) * num_vertices_per_side + z,
+        };
+
+        bool32_t has_corners = TRUE;
+
+        for (uint32_t j = 0; j < 4; ++j)
+            has_corners &= !Scene_Vertex_IsDeleted(scene, face_vertices[j]);
+
+        if (has_corners && Scene_ConstructFace(scene, face_vertices, 4, { 1.0f, 0.0f, 0.0f, 1.0f }) != SCENE_ID_NONE)
+            ++num_rebuilt_faces;
+    }
+
+    double rebuild_seconds = Benchmark_GetTime() - start_time;
+
+    printf(
+        "  %-16s %10.1f ns per face, %u of %u faces in freed slots\n",
+        "rebuild faces",
+        rebuild_seconds * 1e9 / num_rebuilt_faces,
+        num_rebuilt_faces - (scene->num_faces - num_faces_before_rebuild),
+        num_rebuilt_faces
+    );
+
+    uint32_t num_live_faces = scene->num_faces - scene->num_deleted_faces;
+    uint32_t num_live_vertices = scene->num_vertices - scene->num_deleted_vertices;
+
+    uint64_t sparse_sum;
+    Benchmark_Defrag_Measure("sparse", scene, vertices, indices, &sparse_sum);
+
+    uint32_t num_steps = 0;
+    double total_step_seconds = 0.0;
+    double max_step_seconds = 0.0;
+
+    bool32_t is_done = FALSE;
+
+    while (!is_done)
+    {
+        start_time = Benchmark_GetTime();
+        is_done = Scene_Defragment(scene, BENCHMARK_DEFRAG_NUM_MOVES_PER_STEP);
+        double step_seconds = Benchmark_GetTime() - start_time;
+
+        total_step_seconds += step_seconds;
+        max_step_seconds = glm::max(max_step_seconds, step_seconds);
+        ++num_steps;
+    }
+
+    printf(
+        "  %-16s %10u steps %10.3f ms per step %10.3f ms at most\n",
+        "defragment",
+        num_steps,
+        total_step_seconds * 1e3 / num_steps,
+        max_step_seconds * 1e3
+    );
+
+    uint64_t compact_sum;
+    Benchmark_Defrag_Measure("compact", scene, vertices, indices, &compact_sum);
+
+    bool32_t is_compact =
+        scene->num_faces == num_live_faces && scene->num_vertices == num_live_vertices &&
+        scene->num_deleted_faces == 0 && scene->num_deleted_vertices == 0;
+
+    printf("  arrays %s, live faces %s\n", is_compact ? "compact" : "NOT COMPACT", (sparse_sum == compact_sum) ? "unchanged" : "CHANGED");
+
+    free(deleted_faces);
+    free(indices);
+    free(vertices);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_OPTIMIZE_NUM_CELLS_PER_SIDE 512
+#define BENCHMARK_OPTIMIZE_PATCH_SIZE 8
+#define BENCHMARK_OPTIMIZE_WELD_DISTANCE 0.0001f
+#define BENCHMARK_OPTIMIZE_PLANE_DISTANCE 0.001f
+
+// Flat floor in square patches of three colors with a few raised blocks, stored as a triangle soup the way exporters write
+// it: every triangle has its own slightly jittered copies of its corners
+static void Benchmark_Optimize_BuildSoup(Scene* scene)
+{
+    const uint32_t num_cells_per_side = BENCHMARK_OPTIMIZE_NUM_CELLS_PER_SIDE;
+
+    for (uint32_t x = 0; x < num_cells_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_cells_per_side; ++z)
+        {
+            glm::vec3 corners[4] = {
+                { (float)x,        0.0f, (float)z },
+                { (float)x,        0.0f, (float)(z + 1) },
+                { (float)(x + 1),  0.0f, (float)(z + 1) },
+                { (float)(x + 1),  0.0f, (float)z },
+            };
+
+            // Every fourth patch has a block on it
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                uint32_t corner_x = (uint32_t)corners[i].x % (4 * BENCHMARK_OPTIMIZE_PATCH_SIZE);
+                uint32_t corner_z = (uint32_t)corners[i].z % (4 * BENCHMARK_OPTIMIZE_PATCH_SIZE);
+
+                if (corner_x >= 2 && corner_x <= 6 && corner_z >= 2 && corner_z <= 6)
+                    corners[i].y = 1.0f;
+            }
+
+            uint32_t patch = x / BENCHMARK_OPTIMIZE_PATCH_SIZE + z / BENCHMARK_OPTIMIZE_PATCH_SIZE;
+            glm::vec4 color = { (float)(patch % 3) * 0.25f + 0.25f, 0.5f, 0.5f, 1.0f };
+
+            uint32_t triangles[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+
+            for (uint32_t t = 0; t < 2; ++t)
+            {
+                glm::vec3 positions[3];
+
+                for (uint32_t i = 0; i < 3; ++i)
+                    positions[i] = corners[triangles[t][i]] + glm::vec3(Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat()) * 1e-5f;
+
+                uint32_t first_vertex = Scene_AddVertices(scene, positions, 3);
+                ASSERT(first_vertex != SCENE_ID_NONE);
+
+                uint32_t face_vertices[3] = { first_vertex, first_vertex + 1, first_vertex + 2 };
+
+                uint32_t face_index = Scene_ConstructFace(scene, face_vertices, ARRAY_SIZE_U32(face_vertices), color);
+                ASSERT(face_index != SCENE_ID_NONE);
+                UNUSED(face_index);
+            }
+        }
+    }
+}
+
+static double Benchmark_Optimize_MeasureGeometryWrite(Scene* scene)
+{
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    SVertex*  vertices = (SVertex*)malloc((uint64_t)Scene_GetNumGeometryVertices(scene) * sizeof(SVertex));
+    uint32_t* indices  = (uint32_t*)malloc((uint64_t)Scene_GetNumGeometryIndices(scene) * sizeof(uint32_t));
+
+    // The first write pays for the page faults, the second one is timed
+    Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+
+    double start_time = Benchmark_GetTime();
+    Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+    double seconds = Benchmark_GetTime() - start_time;
+
+    free(indices);
+    free(vertices);
+
+    return seconds;
+}
+
+// Welds and merges a triangle soup level and reports how much less the GPU gets
+static void Benchmark_Optimize(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_Optimize_BuildSoup(scene);
+
+    double soup_write_seconds = Benchmark_Optimize_MeasureGeometryWrite(scene);
+
+    Scene_OptimizeStats stats;
+
+    double start_time = Benchmark_GetTime();
+    bool32_t optimize_result = Scene_Optimize(scene, BENCHMARK_OPTIMIZE_WELD_DISTANCE, BENCHMARK_OPTIMIZE_PLANE_DISTANCE, &stats);
+    double optimize_seconds = Benchmark_GetTime() - start_time;
+
+    double optimized_write_seconds = Benchmark_Optimize_MeasureGeometryWrite(scene);
+
+    // A second pass finds nothing left to do
+    Scene_OptimizeStats second_stats;
+    bool32_t second_result = Scene_Optimize(scene, BENCHMARK_OPTIMIZE_WELD_DISTANCE, BENCHMARK_OPTIMIZE_PLANE_DISTANCE, &second_stats);
+
+    printf("optimize: %u triangle soup faces, %u threads, %s\n", stats.num_input_faces, Jobs_GetNumThreads(), optimize_result ? "rebuilt" : "UNCHANGED");
+    printf("  %-18s %10.1f ms\n", "weld and merge", optimize_seconds * 1e3);
+    printf("  %-18s %10u -> %10u (%u welded)\n", "vertices", stats.num_input_vertices, stats.num_vertices, stats.num_welded_vertices);
+    printf("  %-18s %10u -> %10u (%u merged)\n", "faces", stats.num_input_faces, stats.num_faces, stats.num_merged_faces);
+    printf("  %-18s %10u -> %10u %8.1fx\n", "triangles", stats.num_input_triangles, stats.num_triangles, (double)stats.num_input_triangles / stats.num_triangles);
+    printf("  %-18s %10u -> %10u %8.1fx\n", "geometry vertices", stats.num_input_geometry_vertices, stats.num_geometry_vertices, (double)stats.num_input_geometry_vertices / stats.num_geometry_vertices);
+    printf("  %-18s %10.3f -> %10.3f ms\n", "geometry write", soup_write_seconds * 1e3, optimized_write_seconds * 1e3);
+    printf("  second pass %s\n", second_result ? "CHANGED THE SCENE" : "left the scene alone");
+
+    UNUSED(second_stats);
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_VERTEX_CACHE_NUM_FACES_PER_SIDE 256
+#define BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH 24
+#define BENCHMARK_VERTEX_CACHE_NUM_FACES_PER_CHUNK 16384
+
+// Comb shaped faces like the outlines of rooms along a corridor, which are concave and ear clipped
+static void Benchmark_VertexCache_BuildCombs(Scene* scene)
+{
+    const uint32_t num_faces_per_side = BENCHMARK_VERTEX_CACHE_NUM_FACES_PER_SIDE;
+
+    for (uint32_t x = 0; x < num_faces_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_faces_per_side; ++z)
+        {
+            uint32_t num_teeth = 1 + (uint32_t)(Benchmark_RandomFloat() * BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH);
+            if (num_teeth > BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH) num_teeth = BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH;
+
+            glm::vec3 origin = { (float)x * 64.0f, 0.0f, (float)z * 8.0f };
+            glm::vec3 positions[4 * BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH + 2];
+            uint32_t num_corners = 0;
+
+            // Up the first tooth, then down and up every gap, the last tooth comes back along the back of the comb
+            positions[num_corners++] = origin;
+            positions[num_corners++] = origin + glm::vec3(0.0f, 0.0f, 5.0f);
+
+            for (uint32_t i = 0; i < num_teeth; ++i)
+            {
+                float tooth_x = (float)(2 * i);
+
+                positions[num_corners++] = origin + glm::vec3(tooth_x + 1.0f, 0.0f, 5.0f);
+                positions[num_corners++] = origin + glm::vec3(tooth_x + 1.0f, 0.0f, 1.0f);
+                positions[num_corners++] = origin + glm::vec3(tooth_x + 2.0f, 0.0f, 1.0f);
+                positions[num_corners++] = origin + glm::vec3(tooth_x + 2.0f, 0.0f, (i + 1 < num_teeth) ? 5.0f : 0.0f);
+            }
+
+            uint32_t first_vertex = Scene_AddVertices(scene, positions, num_corners);
+            ASSERT(first_vertex != SCENE_ID_NONE);
+
+            uint32_t face_vertices[4 * BENCHMARK_VERTEX_CACHE_MAX_NUM_TEETH + 2];
+
+            for (uint32_t i = 0; i < num_corners; ++i)
+                face_vertices[i] = first_vertex + i;
+
+            uint32_t face_index = Scene_ConstructFace(scene, face_vertices, num_corners, { 0.5f, 0.5f, 0.5f, 1.0f });
+            ASSERT(face_index != SCENE_ID_NONE);
+            UNUSED(face_index);
+        }
+    }
+}
+
+// Reorders the triangles of concave faces for the vertex cache in chunks, the way the editor spreads the pass over frames
+static void Benchmark_VertexCache(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_VertexCache_BuildCombs(scene);
+
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    Scene_VertexCacheStats stats;
+    memset(&stats, 0, sizeof(Scene_VertexCacheStats));
+
+    uint32_t num_chunks = 0;
+    double max_chunk_seconds = 0.0;
+
+    double start_time = Benchmark_GetTime();
+
+    for (uint32_t first_face = 0; first_face < scene->num_faces; first_face += BENCHMARK_VERTEX_CACHE_NUM_FACES_PER_CHUNK)
+    {
+        uint32_t num_faces = glm::min(scene->num_faces - first_face, (uint32_t)BENCHMARK_VERTEX_CACHE_NUM_FACES_PER_CHUNK);
+
+        double chunk_start_time = Benchmark_GetTime();
+        Scene_OptimizeVertexCache(scene, first_face, num_faces, &stats);
+        max_chunk_seconds = glm::max(max_chunk_seconds, Benchmark_GetTime() - chunk_start_time);
+
+        ++num_chunks;
+    }
+
+    double seconds = Benchmark_GetTime() - start_time;
+
+    // A second pass finds every face in its best known order already
+    Scene_VertexCacheStats second_stats;
+    memset(&second_stats, 0, sizeof(Scene_VertexCacheStats));
+    Scene_OptimizeVertexCache(scene, 0, scene->num_faces, &second_stats);
+
+    printf("vertex-cache: %u concave faces, %u triangles, FIFO cache of %u vertices\n", scene->num_faces, stats.num_triangles, SCENE_VERTEX_CACHE_SIZE);
+    printf("  %-18s %10.1f ms (%u chunks, %.2f ms max)\n", "pass", seconds * 1e3, num_chunks, max_chunk_seconds * 1e3);
+    printf("  %-18s %10.3f -> %10.3f\n", "ACMR", (double)stats.num_input_transforms / stats.num_triangles, (double)stats.num_transforms / stats.num_triangles);
+    printf("  %-18s %10.3f -> %10.3f\n", "ATVR", (double)stats.num_input_transforms / stats.num_vertices, (double)stats.num_transforms / stats.num_vertices);
+    printf("  %-18s %10u faces\n", "reordered", stats.num_reordered_faces);
+    printf("  second pass %s\n", (second_stats.num_reordered_faces == 0) ? "left the triangles alone" : "REORDERED AGAIN");
+
+    Scene_Destroy(scene);
+}
+
+#define BENCHMARK_CSG_NUM_ROOMS_PER_SIDE 5
+#define BENCHMARK_CSG_ROOM_SPACING 10.0f
+#define BENCHMARK_CSG_NUM_EDITS 20
+
+static uint32_t Benchmark_CSG_CountBoundaryEdges(const Scene* scene)
+{
+    uint32_t num_boundary_edges = 0;
+
+    for (uint32_t i = 0; i < scene->num_half_edges; ++i)
+        num_boundary_edges += (scene->half_edges[i].face != SCENE_ID_NONE && scene->half_edges[i].opposite_half_edge == SCENE_ID_NONE);
+
+    return num_boundary_edges;
+}
+
+// A solid block with a grid of rooms carved out, corridors between them, a pillar in every room and a ramp in every other.
+// Returns the brush of the pillar in the middle room.
+static uint32_t Benchmark_CSG_BuildMap(CSG_Map* map, uint32_t num_rooms_per_side)
+{
+    const float spacing = BENCHMARK_CSG_ROOM_SPACING;
+    const float extent = (float)num_rooms_per_side * spacing;
+
+    glm::vec4 wall_color = { 0.6f, 0.6f, 0.6f, 1.0f };
+    glm::vec4 floor_color = { 0.4f, 0.3f, 0.2f, 1.0f };
+    glm::vec4 pillar_color = { 0.7f, 0.6f, 0.4f, 1.0f };
+
+    uint32_t middle_pillar_index = SCENE_ID_NONE;
+
+    uint32_t brush_index = CSG_AddBoxBrush(map, { -1.0f, -1.0f, -1.0f }, { extent + 1.0f, 6.0f, extent + 1.0f }, wall_color, CSG_OPERATION_ADD);
+    ASSERT(brush_index != SCENE_ID_NONE);
+
+    for (uint32_t x = 0; x < num_rooms_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_rooms_per_side; ++z)
+        {
+            glm::vec3 origin = { (float)x * spacing, 0.0f, (float)z * spacing };
+
+            brush_index = CSG_AddBoxBrush(map, origin, origin + glm::vec3(8.0f, 5.0f, 8.0f), floor_color, CSG_OPERATION_SUBTRACT);
+            ASSERT(brush_index != SCENE_ID_NONE);
+
+            if (x + 1 < num_rooms_per_side)
+            {
+                brush_index = CSG_AddBoxBrush(map, origin + glm::vec3(7.0f, 0.0f, 3.0f), origin + glm::vec3(11.0f, 3.0f, 5.0f), floor_color, CSG_OPERATION_SUBTRACT);
+                ASSERT(brush_index != SCENE_ID_NONE);
+            }
+
+            if (z + 1 < num_rooms_per_side)
+            {
+                brush_index = CSG_AddBoxBrush(map, origin + glm::vec3(3.0f, 0.0f, 7.0f), origin + glm::vec3(5.0f, 3.0f, 11.0f), floor_color, CSG_OPERATION_SUBTRACT);
+                ASSERT(brush_index != SCENE_ID_NONE);
+            }
+        }
+    }
+
+    for (uint32_t x = 0; x < num_rooms_per_side; ++x)
+    {
+        for (uint32_t z = 0; z < num_rooms_per_side; ++z)
+        {
+            glm::vec3 origin = { (float)x * spacing, 0.0f, (float)z * spacing };
+
+            brush_index = CSG_AddBoxBrush(map, origin + glm::vec3(5.5f, 0.0f, 5.5f), origin + glm::vec3(6.5f, 5.0f, 6.5f), pillar_color, CSG_OPERATION_ADD);
+            ASSERT(brush_index != SCENE_ID_NONE);
+
+            if (x == num_rooms_per_side / 2 && z == num_rooms_per_side / 2)
+                middle_pillar_index = brush_index;
+
+            if ((x + z) % 2 != 0)
+                continue;
+
+            // Rises from the floor towards the wall behind it
+            CSG_BrushPlane ramp_planes[5] = {
+                { {  0.0f, -1.0f,  0.0f },  0.0f, floor_color },
+                { { -1.0f,  0.0f,  0.0f },  origin.x + 0.5f, wall_color },
+                { {  1.0f,  0.0f,  0.0f }, -(origin.x + 2.5f), wall_color },
+                { {  0.0f,  0.0f,  1.0f }, -(origin.z + 8.0f), wall_color },
+                { {  0.0f,  1.0f, -0.5f },  0.5f * (origin.z + 4.0f), floor_color },
+            };
+
+            brush_index = CSG_AddBrush(map, ramp_planes, ARRAY_SIZE_U32(ramp_planes), CSG_OPERATION_ADD);
+            ASSERT(brush_index != SCENE_ID_NONE);
+        }
+    }
+
+    return middle_pillar_index;
+}
+
+// Compiles a map of about a hundred brushes, then drags a pillar around and compiles only what the drag touched
+static void Benchmark_CSG(void)
+{
+    Scene scene_storage[2];
+    CSG_Map map_storage[2];
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        bool32_t init_result = Scene_Init(scene_storage + i) && CSG_Map_Init(map_storage + i);
+        ASSERT(init_result == TRUE);
+        UNUSED(init_result);
+    }
+
+    Scene* scene = scene_storage + 0;
+    CSG_Map* map = map_storage + 0;
+
+    uint32_t pillar_index = Benchmark_CSG_BuildMap(map, BENCHMARK_CSG_NUM_ROOMS_PER_SIDE);
+
+    CSG_CompileStats stats;
+
+    double start_time = Benchmark_GetTime();
+    CSG_Compile(map, scene, &stats);
+    double full_seconds = Benchmark_GetTime() - start_time;
+
+    printf("csg: %u brushes on %u threads\n", stats.num_brushes, Jobs_GetNumThreads());
+    printf("  %-18s %10.2f ms (%u polygons, %u T-junctions fixed, %u vertices, %u faces, %u boundary edges)\n", "full compile", full_seconds * 1e3,
+        stats.num_polygons, stats.num_tjunctions, stats.num_vertices, stats.num_faces, Benchmark_CSG_CountBoundaryEdges(scene));
+
+    // The pillar in the middle room is dragged around in it
+    double edit_seconds = 0.0;
+    double max_edit_seconds = 0.0;
+    uint64_t num_compiled_brushes = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_CSG_NUM_EDITS; ++i)
+    {
+        glm::vec3 offset = { (Benchmark_RandomFloat() - 0.5f) * 0.5f, 0.0f, (Benchmark_RandomFloat() - 0.5f) * 0.5f };
+
+        double edit_start_time = Benchmark_GetTime();
+
+        CSG_MoveBrush(map, pillar_index, offset);
+        CSG_Compile(map, scene, &stats);
+
+        double seconds = Benchmark_GetTime() - edit_start_time;
+
+        edit_seconds += seconds;
+        max_edit_seconds = glm::max(max_edit_seconds, seconds);
+        num_compiled_brushes += stats.num_compiled_brushes;
+    }
+
+    printf("  %-18s %10.2f ms (%.1f brushes compiled per edit, %.2f ms max)\n", "incremental", edit_seconds * 1e3 / BENCHMARK_CSG_NUM_EDITS,
+        (double)num_compiled_brushes / BENCHMARK_CSG_NUM_EDITS, max_edit_seconds * 1e3);
+
+    // A map that only ever sees full compiles has to end up with the same polygons
+    Scene* reference_scene = scene_storage + 1;
+    CSG_Map* reference_map = map_storage + 1;
+
+    Benchmark_CSG_BuildMap(reference_map, BENCHMARK_CSG_NUM_ROOMS_PER_SIDE);
+    memcpy(reference_map->brushes + pillar_index, map->brushes + pillar_index, sizeof(CSG_Brush));
+
+    CSG_CompileStats reference_stats;
+    CSG_Compile(reference_map, reference_scene, &reference_stats);
+
+    const CSG_PolygonStore* store = map->stores + map->current_store;
+    const CSG_PolygonStore* reference_store = reference_map->stores + reference_map->current_store;
+
+    bool32_t is_identical =
+        store->num_polygons == reference_store->num_polygons &&
+        store->num_points == reference_store->num_points &&
+        memcmp(store->points, reference_store->points, (uint64_t)store->num_points * sizeof(glm::vec3)) == 0 &&
+        stats.num_faces == reference_stats.num_faces &&
+        Benchmark_CSG_CountBoundaryEdges(scene) == 0;
+
+    printf("  incremental result %s\n", is_identical ? "matches a full compile" : "DIFFERS FROM A FULL COMPILE");
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        CSG_Map_Destroy(map_storage + i);
+        Scene_Destroy(scene_storage + i);
+    }
+}
+
+#define BENCHMARK_PVS_NUM_ROOMS_PER_SIDE 16
+#define BENCHMARK_PVS_CELL_SIZE 4.0f
+#define BENCHMARK_PVS_NUM_RAYS_PER_CELL 256
+#define BENCHMARK_PVS_NUM_SAMPLES 65536
+
+static bool32_t Benchmark_PVS_IsVisible(const uint8_t* row, uint32_t cluster_index)
+{
+    return (row[cluster_index / 8] & (1 << (cluster_index % 8))) != 0;
+}
+
+// Builds the set of a large room map, then looks from random points in the rooms at how much of the map is left to draw
+// and how often a ray from there hits a cluster that the set left out
+static void Benchmark_PVS(void)
+{
+    Scene scene;
+    CSG_Map map;
+    PVS pvs;
+
+    bool32_t init_result = Scene_Init(&scene) && CSG_Map_Init(&map) && PVS_Init(&pvs);
+    ASSERT(init_result == TRUE);
+    UNUSED(init_result);
+
+    Benchmark_CSG_BuildMap(&map, BENCHMARK_PVS_NUM_ROOMS_PER_SIDE);
+
+    CSG_CompileStats compile_stats;
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    // Clusters are runs of faces, which only stay together in space once the scene is reordered
+    Scene_Reorder(&scene);
+
+    PVS_BuildStats stats;
+
+    double start_time = Benchmark_GetTime();
+    bool32_t build_result = PVS_Build(&pvs, &scene, BENCHMARK_PVS_CELL_SIZE, BENCHMARK_PVS_NUM_RAYS_PER_CELL, &stats);
+    double seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(build_result == TRUE);
+    UNUSED(build_result);
+
+    uint32_t num_indices = Scene_GetNumGeometryIndices(&scene);
+
+    printf("pvs: %u faces (%u triangles) of %u brushes on %u threads\n", scene.num_faces, num_indices / 3, compile_stats.num_brushes, Jobs_GetNumThreads());
+    printf("  %-18s %10.1f ms (%u cells of size %.2f, %u clusters, %.1f M rays/s)\n", "build", seconds * 1e3, stats.num_cells, stats.cell_size,
+        stats.num_clusters, (double)stats.num_rays / seconds * 1e-6);
+    printf("  %-18s %10.1f KB (%.1f KB uncompressed, %.1f%% of the clusters visible per cell)\n", "rows", stats.num_data_bytes / 1024.0,
+        stats.num_row_bytes / 1024.0, 100.0 * (double)stats.num_visible_clusters / ((double)stats.num_cells * (double)stats.num_clusters));
+
+    // Cameras stand in the rooms, not inside the walls
+    uint8_t* row = (uint8_t*)malloc(pvs.num_row_bytes);
+    ASSERT(row != NULL);
+
+    uint64_t num_visible_indices = 0;
+    uint32_t num_hits = 0;
+    uint32_t num_misses = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_PVS_NUM_SAMPLES; ++i)
+    {
+        uint32_t room_x = (uint32_t)(Benchmark_RandomFloat() * BENCHMARK_PVS_NUM_ROOMS_PER_SIDE);
+        uint32_t room_z = (uint32_t)(Benchmark_RandomFloat() * BENCHMARK_PVS_NUM_ROOMS_PER_SIDE);
+
+        glm::vec3 position = {
+            (float)room_x * BENCHMARK_CSG_ROOM_SPACING + 0.2f + 7.6f * Benchmark_RandomFloat(),
+            0.2f + 4.6f * Benchmark_RandomFloat(),
+            (float)room_z * BENCHMARK_CSG_ROOM_SPACING + 0.2f + 7.6f * Benchmark_RandomFloat(),
+        };
+
+        uint32_t cell_index = PVS_FindCell(&pvs, position);
+        ASSERT(cell_index != SCENE_ID_NONE);
+
+        PVS_DecompressRow(&pvs, cell_index, row);
+
+        for (uint32_t j = 0; j < pvs.num_clusters; ++j)
+        {
+            uint32_t first_index, num_cluster_indices;
+            Scene_Cluster_GetGeometryIndices(&scene, j, &first_index, &num_cluster_indices);
+
+            if (Benchmark_PVS_IsVisible(row, j))
+                num_visible_indices += num_cluster_indices;
+        }
+
+        glm::vec3 direction = glm::normalize(glm::vec3(Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat()) - 0.5f);
+
+        uint32_t hit_face_index;
+        if (!Scene_RayCast_FindNearestIntersectingFace(&scene, position, direction, 0.0f, 1000.0f, &hit_face_index, NULL))
+            continue;
+
+        ++num_hits;
+        num_misses += !Benchmark_PVS_IsVisible(row, hit_face_index / SCENE_CLUSTER_NUM_FACES);
+    }
+
+    printf("  %-18s %10.1f%% of the triangles (%u random points in the rooms)\n", "drawn", 100.0 * (double)num_visible_indices / ((double)num_indices * BENCHMARK_PVS_NUM_SAMPLES),
+        BENCHMARK_PVS_NUM_SAMPLES);
+    printf("  %-18s %10.3f%% (%u of %u random rays hit a cluster the set left out)\n", "misses", 100.0 * num_misses / glm::max(num_hits, 1u), num_misses, num_hits);
+
+    free(row);
+
+    PVS_Destroy(&pvs);
+    CSG_Map_Destroy(&map);
+    Scene_Destroy(&scene);
+}
+
+#define BENCHMARK_CULL_NUM_CELLS_PER_SIDE 1024
+#define BENCHMARK_CULL_NUM_VIEWS 1024
+#define BENCHMARK_CULL_NUM_CHECKED_VIEWS 4
+#define BENCHMARK_CULL_NUM_MOVED_VERTICES 1000
+
+static const char* Benchmark_Cull_KernelLabels[] = { "frustum cull (scalar)", "frustum cull (SSE)", "frustum cull (AVX)" };
+
+// Camera above the grid that looks along a random direction and a little down, like someone walking around in it
+static glm::mat4 Benchmark_Cull_GetViewProjection(const glm::mat4* projection, uint32_t num_cells_per_side)
+{
+    float half_size = 0.5f * (float)num_cells_per_side;
+    glm::vec3 position = { half_size * (0.5f + Benchmark_RandomFloat()), 2.0f, half_size * (0.5f + Benchmark_RandomFloat()) };
+
+    float yaw = 6.28318530718f * Benchmark_RandomFloat();
+    glm::vec3 forward = glm::normalize(glm::vec3(cosf(yaw), -0.2f, sinf(yaw)));
+
+    return *projection * glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// Counts faces with a corner inside of the frustum whose cluster was culled, which must never happen
+static uint32_t Benchmark_Cull_CountMissedFaces(const Scene* scene, const glm::mat4* view_projection, const uint32_t* cluster_indices, uint32_t num_visible_clusters)
+{
+    bool32_t* cluster_visible_flags = (bool32_t*)calloc(Scene_GetNumClusters(scene), sizeof(bool32_t));
+
+    for (uint32_t i = 0; i < num_visible_clusters; ++i)
+        cluster_visible_flags[cluster_indices[i]] = TRUE;
+
+    uint32_t num_missed_faces = 0;
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        if (cluster_visible_flags[i / SCENE_CLUSTER_NUM_FACES])
+            continue;
+
+        const Scene_Face* face = scene->faces + i;
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+        {
+            glm::vec4 clip = *view_projection * glm::vec4(scene->vertices[scene->half_edges[face->first_half_edge + j].origin_vertex].position, 1.0f);
+
+            if (fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && fabsf(clip.z) <= clip.w)
+            {
+                ++num_missed_faces;
+                break;
+            }
+        }
+    }
+
+    free(cluster_visible_flags);
+
+    return num_missed_faces;
+}
+
+// Culls the clusters of a reordered million face grid against the frustum of cameras walking around in it with every
+// kernel, then refits the clusters after a drag
+static void Benchmark_Cull(void)
+{
+    Scene scene;
+    bool32_t scene_init_result = Scene_Init(&scene);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Benchmark_BuildGridScene(&scene, BENCHMARK_CULL_NUM_CELLS_PER_SIDE);
+    Scene_Reorder(&scene);
+
+    double start_time = Benchmark_GetTime();
+    Scene_Clusters_Update(&scene);
+    double build_seconds = Benchmark_GetTime() - start_time;
+
+    uint32_t num_clusters = Scene_GetNumClusters(&scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(&scene);
+
+    printf("cull: %u faces in %u clusters of %u faces, %u job threads\n", scene.num_faces, num_clusters, SCENE_CLUSTER_NUM_FACES, Jobs_GetNumThreads());
+    printf("  %-22s %10.2f ms\n", "cluster build", build_seconds * 1e3);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+
+    glm::mat4* view_projections = (glm::mat4*)malloc(BENCHMARK_CULL_NUM_VIEWS * sizeof(glm::mat4));
+
+    for (uint32_t i = 0; i < BENCHMARK_CULL_NUM_VIEWS; ++i)
+        view_projections[i] = Benchmark_Cull_GetViewProjection(&projection, BENCHMARK_CULL_NUM_CELLS_PER_SIDE);
+
+    uint32_t* cluster_indices = (uint32_t*)malloc((uint64_t)num_clusters * sizeof(uint32_t));
+    uint32_t* reference_cluster_indices = (uint32_t*)malloc((uint64_t)num_clusters * sizeof(uint32_t));
+
+    uint32_t best_kernel = Scene_Clusters_GetBestKernel();
+    double reference_seconds = 0.0;
+
+    for (uint32_t kernel = SCENE_CLUSTERS_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+    {
+        double kernel_start_time = Benchmark_GetTime();
+
+        for (uint32_t i = 0; i < BENCHMARK_CULL_NUM_VIEWS; ++i)
+            Scene_Clusters_CullFrustum(&scene, kernel, view_projections + i, cluster_indices);
+
+        double seconds = Benchmark_GetTime() - kernel_start_time;
+
+        uint64_t num_visible_clusters = 0;
+        uint64_t num_visible_indices = 0;
+        uint32_t num_mismatches = 0;
+
+        for (uint32_t i = 0; i < BENCHMARK_CULL_NUM_VIEWS; ++i)
+        {
+            uint32_t num_view_clusters = Scene_Clusters_CullFrustum(&scene, kernel, view_projections + i, cluster_indices);
+
+            // Every kernel has to keep the same clusters as the scalar one
+            uint32_t num_reference_clusters = Scene_Clusters_CullFrustum(&scene, SCENE_CLUSTERS_KERNEL_SCALAR, view_projections + i, reference_cluster_indices);
+
+            if (num_view_clusters != num_reference_clusters ||
+                memcmp(cluster_indices, reference_cluster_indices, num_view_clusters * sizeof(uint32_t)) != 0)
+            {
+                ++num_mismatches;
+            }
+
+            num_visible_clusters += num_view_clusters;
+
+            for (uint32_t j = 0; j < num_view_clusters; ++j)
+            {
+                uint32_t first_index, num_cluster_indices;
+                Scene_Cluster_GetGeometryIndices(&scene, cluster_indices[j], &first_index, &num_cluster_indices);
+
+                num_visible_indices += num_cluster_indices;
+            }
+        }
+
+        if (kernel == SCENE_CLUSTERS_KERNEL_SCALAR)
+            reference_seconds = seconds;
+
+        printf("  %-22s %10.3f ms %8.2fx  %.2f%% of the clusters, %.2f%% of the triangles kept, mismatches: %u\n",
+            Benchmark_Cull_KernelLabels[kernel], seconds * 1e3 / BENCHMARK_CULL_NUM_VIEWS, reference_seconds / seconds,
+            100.0 * (double)num_visible_clusters / ((double)num_clusters * BENCHMARK_CULL_NUM_VIEWS),
+            100.0 * (double)num_visible_indices / ((double)num_indices * BENCHMARK_CULL_NUM_VIEWS), num_mismatches);
+    }
+
+    uint32_t num_missed_faces = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_CULL_NUM_CHECKED_VIEWS; ++i)
+    {
+        uint32_t num_view_clusters = Scene_Clusters_CullFrustum(&scene, best_kernel, view_projections + i, cluster_indices);
+        num_missed_faces += Benchmark_Cull_CountMissedFaces(&scene, view_projections + i, cluster_indices, num_view_clusters);
+    }
+
+    printf("  %-22s %10u faces in the frustum were culled (%u views checked)\n", "brute force check", num_missed_faces, BENCHMARK_CULL_NUM_CHECKED_VIEWS);
+
+    // A drag only refits the clusters around the moved vertices
+    for (uint32_t i = 0; i < BENCHMARK_CULL_NUM_MOVED_VERTICES; ++i)
+    {
+        uint32_t vertex_index = (uint32_t)(Benchmark_RandomFloat() * scene.num_vertices);
+        Scene_SetVertexPosition(&scene, vertex_index, scene.vertices[vertex_index].position + glm::vec3(0.0f, 0.5f, 0.0f));
+    }
+
+    uint32_t num_dirty_clusters = scene.clusters.num_dirty_clusters;
+
+    start_time = Benchmark_GetTime();
+    Scene_Clusters_Update(&scene);
+    double update_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-22s %10.3f ms (%u vertices moved, %u clusters refit)\n", "incremental update", update_seconds * 1e3, BENCHMARK_CULL_NUM_MOVED_VERTICES, num_dirty_clusters);
+
+    // Refitting has to end up with the bounds that a build computes
+    uint64_t groups_size = (uint64_t)scene.clusters.num_groups * sizeof(Scene_Clusters_Group);
+    Scene_Clusters_Group* refit_groups = (Scene_Clusters_Group*)malloc(groups_size);
+    memcpy(refit_groups, scene.clusters.groups, groups_size);
+
+    scene.clusters.needs_rebuild = TRUE;
+    Scene_Clusters_Update(&scene);
+
+    printf("  refit bounds %s\n", (memcmp(refit_groups, scene.clusters.groups, groups_size) == 0) ? "match a rebuild" : "DIFFER FROM A REBUILD");
+
+    free(refit_groups);
+
+    free(reference_cluster_indices);
+    free(cluster_indices);
+    free(view_projections);
+
+    Scene_Destroy(&scene);
+}
+
+#define BENCHMARK_LIGHTMAP_NUM_ROOMS_PER_SIDE 5
+#define BENCHMARK_LIGHTMAP_NUM_SAMPLES 16
+
+static uint32_t Benchmark_Lightmap_GetChecksum(const Lightmap* lightmap)
+{
+    uint32_t checksum = 0;
+
+    for (uint64_t i = 0; i < (uint64_t)LIGHTMAP_ATLAS_SIZE * LIGHTMAP_ATLAS_SIZE; ++i)
+    {
+        if (lightmap->texel_faces[i] != SCENE_ID_NONE)
+            checksum = (checksum ^ lightmap->texel_colors[i]) * 0x01000193u;
+    }
+
+    return checksum;
+}
+
+// Bakes every pending tile until all texels have their samples, returns the number of rounds over the atlas
+static uint32_t Benchmark_Lightmap_BakeAll(Lightmap* lightmap, Scene* scene, uint64_t* out_num_rays, double* out_first_round_seconds)
+{
+    uint32_t num_rounds = 0;
+    uint64_t num_rays = 0;
+
+    double start_time = Benchmark_GetTime();
+
+    for (;;)
+    {
+        Lightmap_BakeStats stats;
+        uint32_t num_pending_tiles = Lightmap_Bake(lightmap, scene, LIGHTMAP_NUM_TILES, &stats);
+
+        if (stats.num_tiles == 0)
+            break;
+
+        if (num_rounds++ == 0)
+            *out_first_round_seconds = Benchmark_GetTime() - start_time;
+
+        num_rays += stats.num_rays;
+
+        if (num_pending_tiles == 0)
+            break;
+    }
+
+    *out_num_rays = num_rays;
+    return num_rounds;
+}
+
+// Sums the differences of the texel values of every face between two lightmaps of the same scene, separately for the faces
+// that were baked again and the ones that kept their light. Charts are compared texel by texel wherever they were packed.
+static void Benchmark_Lightmap_Compare(
+    const Lightmap* lightmap,
+    const Lightmap* reference_lightmap,
+    const bool32_t* face_reset_flags,
+    double          out_difference_sums[2],
+    uint64_t        out_num_texels[2],
+    uint32_t*       out_num_mismatched_charts
+)
+{
+    out_difference_sums[0] = out_difference_sums[1] = 0.0;
+    out_num_texels[0] = out_num_texels[1] = 0;
+    *out_num_mismatched_charts = 0;
+
+    for (uint32_t i = 0; i < lightmap->num_faces && i < reference_lightmap->num_faces; ++i)
+    {
+        const Lightmap_Chart* chart = lightmap->charts + i;
+        const Lightmap_Chart* reference_chart = reference_lightmap->charts + i;
+
+        if (chart->width != reference_chart->width || chart->height != reference_chart->height || chart->texel_size != reference_chart->texel_size)
+        {
+            ++*out_num_mismatched_charts;
+            continue;
+        }
+
+        uint32_t kind = face_reset_flags[i] ? 1 : 0;
+
+        for (uint32_t y = 0; y < chart->height; ++y)
+        {
+            for (uint32_t x = 0; x < chart->width; ++x)
+            {
+                uint64_t texel_index = (uint64_t)(chart->y + y) * LIGHTMAP_ATLAS_SIZE + chart->x + x;
+                uint64_t reference_texel_index = (uint64_t)(reference_chart->y + y) * LIGHTMAP_ATLAS_SIZE + reference_chart->x + x;
+
+                if (lightmap->texel_faces[texel_index] != i || reference_lightmap->texel_faces[reference_texel_index] != i)
+                    continue;
+
+                glm::vec3 difference = glm::abs(lightmap->texel_values[texel_index] - reference_lightmap->texel_values[reference_texel_index]);
+
+                out_difference_sums[kind] += (double)(difference.x + difference.y + difference.z) / 3.0;
+                ++out_num_texels[kind];
+            }
+        }
+    }
+}
+
+// Bakes a room map with a skylight in every room from scratch, then drags a pillar around and bakes only what it touched
+static void Benchmark_Lightmap(void)
+{
+    Scene scene;
+    CSG_Map map;
+    Lightmap lightmap;
+
+    Lightmap_Settings settings;
+    settings.texel_size = 0.25f;
+    settings.num_samples = BENCHMARK_LIGHTMAP_NUM_SAMPLES;
+    settings.sun_direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+    settings.sun_color = { 1.0f, 0.95f, 0.85f };
+    settings.sky_color = { 0.3f, 0.35f, 0.45f };
+    settings.bounce_albedo = 0.8f;
+    settings.influence_distance = 4.0f;
+
+    bool32_t init_result = Scene_Init(&scene) && CSG_Map_Init(&map) && Lightmap_Init(&lightmap, &settings);
+    ASSERT(init_result == TRUE);
+    UNUSED(init_result);
+
+    uint32_t pillar_index = Benchmark_CSG_BuildMap(&map, BENCHMARK_LIGHTMAP_NUM_ROOMS_PER_SIDE);
+
+    for (uint32_t x = 0; x < BENCHMARK_LIGHTMAP_NUM_ROOMS_PER_SIDE; ++x)
+    {
+        for (uint32_t z = 0; z < BENCHMARK_LIGHTMAP_NUM_ROOMS_PER_SIDE; ++z)
+        {
+            glm::vec3 origin = { (float)x * BENCHMARK_CSG_ROOM_SPACING, 0.0f, (float)z * BENCHMARK_CSG_ROOM_SPACING };
+
+            uint32_t brush_index = CSG_AddBoxBrush(&map, origin + glm::vec3(1.5f, 4.5f, 1.5f), origin + glm::vec3(4.5f, 7.0f, 4.0f), glm::vec4(0.6f, 0.6f, 0.6f, 1.0f), CSG_OPERATION_SUBTRACT);
+            ASSERT(brush_index != SCENE_ID_NONE);
+            UNUSED(brush_index);
+        }
+    }
+
+    CSG_CompileStats compile_stats;
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    double start_time = Benchmark_GetTime();
+
+    Lightmap_UpdateStats update_stats;
+    bool32_t update_result = Lightmap_Update(&lightmap, &scene, &update_stats);
+    ASSERT(update_result == TRUE);
+    UNUSED(update_result);
+
+    double pack_seconds = Benchmark_GetTime() - start_time;
+
+    printf("lightmap: %u faces, %u samples per texel on %u threads\n", scene.num_faces, BENCHMARK_LIGHTMAP_NUM_SAMPLES, Jobs_GetNumThreads());
+    printf("  %-18s %10.2f ms (%u charts in %u of %u rows, texels of %.3f)\n", "pack", pack_seconds * 1e3, update_stats.num_charts,
+        update_stats.num_used_rows, LIGHTMAP_ATLAS_SIZE, update_stats.texel_size);
+
+    uint64_t num_rays;
+    double first_round_seconds = 0.0;
+
+    start_time = Benchmark_GetTime();
+    uint32_t num_rounds = Benchmark_Lightmap_BakeAll(&lightmap, &scene, &num_rays, &first_round_seconds);
+    double bake_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-18s %10.1f ms (%u rounds, first one after %.1f ms, %.2f M rays/s, checksum %08x)\n", "full bake", bake_seconds * 1e3, num_rounds,
+        first_round_seconds * 1e3, (double)num_rays / bake_seconds * 1e-6, Benchmark_Lightmap_GetChecksum(&lightmap));
+
+    // The pillar in the middle room is moved, only the charts around it and in the shadow it casts are baked again
+    CSG_MoveBrush(&map, pillar_index, glm::vec3(-1.0f, 0.0f, -1.0f));
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    start_time = Benchmark_GetTime();
+
+    update_result = Lightmap_Update(&lightmap, &scene, &update_stats);
+    ASSERT(update_result == TRUE);
+
+    // Charts that were baked again have no samples left until the bake
+    bool32_t* face_reset_flags = (bool32_t*)calloc(scene.num_faces, sizeof(bool32_t));
+    uint64_t num_chart_texels = 0;
+
+    for (uint64_t i = 0; i < (uint64_t)LIGHTMAP_ATLAS_SIZE * LIGHTMAP_ATLAS_SIZE; ++i)
+    {
+        uint32_t face_index = lightmap.texel_faces[i];
+
+        if (face_index == SCENE_ID_NONE)
+            continue;
+
+        face_reset_flags[face_index] |= (lightmap.texel_sums[i].w == 0.0f);
+        ++num_chart_texels;
+    }
+
+    num_rounds = Benchmark_Lightmap_BakeAll(&lightmap, &scene, &num_rays, &first_round_seconds);
+    double edit_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-18s %10.1f ms (%u new and %u moved charts, %u of %u charts baked again%s, %u rounds, %.2f M rays/s)\n", "incremental bake",
+        edit_seconds * 1e3, update_stats.num_new_charts, update_stats.num_moved_charts, update_stats.num_reset_charts, update_stats.num_charts,
+        update_stats.was_rebuilt ? " after repacking" : "", num_rounds, (double)num_rays / edit_seconds * 1e-6);
+
+    printf("  %-18s %10.2f %% of the charted texels (%llu of %llu)\n", "baked again", 100.0 * (double)update_stats.num_reset_texels / (double)num_chart_texels,
+        (unsigned long long)update_stats.num_reset_texels, (unsigned long long)num_chart_texels);
+
+    // Light that stays from before the edit is compared with a bake of the edited map from scratch. The samples of both bakes
+    // start from the texel index, so the faces that were baked again differ by the noise alone.
+    Lightmap reference_lightmap;
+
+    init_result = Lightmap_Init(&reference_lightmap, &settings);
+    ASSERT(init_result == TRUE);
+
+    update_result = Lightmap_Update(&reference_lightmap, &scene, NULL);
+    ASSERT(update_result == TRUE);
+
+    Benchmark_Lightmap_BakeAll(&reference_lightmap, &scene, &num_rays, &first_round_seconds);
+
+    double difference_sums[2];
+    uint64_t num_compared_texels[2];
+    uint32_t num_mismatched_charts;
+    Benchmark_Lightmap_Compare(&lightmap, &reference_lightmap, face_reset_flags, difference_sums, num_compared_texels, &num_mismatched_charts);
+
+    printf("  %-18s %10.4f mean difference to a bake from scratch where the light was kept, %.4f where it was baked again (checksum %08x, %u charts not compared)\n",
+        "from scratch", difference_sums[0] / (double)glm::max(num_compared_texels[0], (uint64_t)1), difference_sums[1] / (double)glm::max(num_compared_texels[1], (uint64_t)1),
+        Benchmark_Lightmap_GetChecksum(&reference_lightmap), num_mismatched_charts);
+
+    free(face_reset_flags);
+
+    Lightmap_Destroy(&reference_lightmap);
+    Lightmap_Destroy(&lightmap);
+    CSG_Map_Destroy(&map);
+    Scene_Destroy(&scene);
+}
+
+#define BENCHMARK_AO_NUM_ROOMS_PER_SIDE 10
+#define BENCHMARK_AO_RADIUS 2.0f
+#define BENCHMARK_AO_NUM_RAYS 32
+
+static uint32_t Benchmark_AO_GetChecksum(const AO* ao)
+{
+    uint32_t checksum = 0x811C9DC5u;
+
+    // NOTE: Byte by byte, the values are multiples of a power of two with their low bits all zero
+    const uint8_t* bytes = (const uint8_t*)ao->values;
+
+    for (uint64_t i = 0; i < (uint64_t)ao->num_vertices * sizeof(float); ++i)
+        checksum = (checksum ^ bytes[i]) * 0x01000193u;
+
+    return checksum;
+}
+
+// Bakes the occlusion of every corner of a room map, then moves a pillar and bakes only the corners around it
+static void Benchmark_AO(void)
+{
+    Scene scene;
+    CSG_Map map;
+    AO ao;
+    AO reference_ao;
+
+    AO_Settings settings;
+    settings.radius = BENCHMARK_AO_RADIUS;
+    settings.num_rays = BENCHMARK_AO_NUM_RAYS;
+
+    bool32_t init_result = Scene_Init(&scene) && CSG_Map_Init(&map) && AO_Init(&ao, &settings) && AO_Init(&reference_ao, &settings);
+    ASSERT(init_result == TRUE);
+    UNUSED(init_result);
+
+    uint32_t pillar_index = Benchmark_CSG_BuildMap(&map, BENCHMARK_AO_NUM_ROOMS_PER_SIDE);
+
+    CSG_CompileStats compile_stats;
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    printf("ao: %u faces, %u vertices, %u rays per vertex within %.1f on %u threads\n", scene.num_faces, Scene_GetNumGeometryVertices(&scene),
+        BENCHMARK_AO_NUM_RAYS, BENCHMARK_AO_RADIUS, Jobs_GetNumThreads());
+
+    AO_UpdateStats update_stats;
+    AO_BakeStats bake_stats;
+
+    double start_time = Benchmark_GetTime();
+
+    AO_Update(&ao, &scene, &update_stats);
+    AO_Bake(&ao, &scene, UINT32_MAX, &bake_stats);
+
+    double bake_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-18s %10.2f ms (%u vertices, %.2f M rays/s, checksum %08x)\n", "full bake", bake_seconds * 1e3, bake_stats.num_vertices,
+        (double)bake_stats.num_rays / bake_seconds * 1e-6, Benchmark_AO_GetChecksum(&ao));
+
+    // The pillar in the middle room is moved, only the corners within the radius of the faces it changed are baked again
+    CSG_MoveBrush(&map, pillar_index, glm::vec3(-1.0f, 0.0f, -1.0f));
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    start_time = Benchmark_GetTime();
+
+    AO_Update(&ao, &scene, &update_stats);
+    double update_seconds = Benchmark_GetTime() - start_time;
+
+    AO_Bake(&ao, &scene, UINT32_MAX, &bake_stats);
+    double edit_seconds = Benchmark_GetTime() - start_time;
+
+    printf("  %-18s %10.2f ms (update %.2f ms, %u new and %u moved vertices, %u of %u vertices baked again, %.2f M rays/s)\n", "incremental bake",
+        edit_seconds * 1e3, update_seconds * 1e3, update_stats.num_new_vertices, update_stats.num_moved_vertices, update_stats.num_reset_vertices,
+        update_stats.num_vertices, (double)bake_stats.num_rays / edit_seconds * 1e-6);
+
+    // Vertices outside of the radius see none of the changed faces, so what is left of the old bake matches a bake from scratch
+    AO_Update(&reference_ao, &scene, NULL);
+    AO_Bake(&reference_ao, &scene, UINT32_MAX, NULL);
+
+    bool32_t is_matching = ao.num_vertices == reference_ao.num_vertices && memcmp(ao.values, reference_ao.values, (uint64_t)ao.num_vertices * sizeof(float)) == 0;
+    printf("  incremental values %s\n", is_matching ? "match a full bake" : "DIFFER FROM A FULL BAKE");
+
+    AO_Destroy(&reference_ao);
+    AO_Destroy(&ao);
+    CSG_Map_Destroy(&map);
+    Scene_Destroy(&scene);
+}
+
+#define BENCHMARK_NAVMESH_NUM_ROOMS_PER_SIDE 10
+#define BENCHMARK_NAVMESH_NUM_QUERIES 4096
+#define BENCHMARK_NAVMESH_NUM_GOALS 16
+
+static uint32_t Benchmark_NavMesh_GetChecksum(const NavMesh* navmesh)
+{
+    uint32_t checksum = 0x811C9DC5u;
+
+    const uint8_t* regions[3] = { (const uint8_t*)navmesh->spans, (const uint8_t*)navmesh->polygons, (const uint8_t*)navmesh->links };
+    uint64_t region_sizes[3] = {
+        (uint64_t)navmesh->num_spans * sizeof(NavMesh_Span),
+        (uint64_t)navmesh->num_polygons * sizeof(NavMesh_Polygon),
+        (uint64_t)navmesh->num_links * sizeof(NavMesh_Link),
+    };
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        for (uint64_t j = 0; j < region_sizes[i]; ++j)
+            checksum = (checksum ^ regions[i][j]) * 0x01000193u;
+    }
+
+    return checksum;
+}
+
+// Point above the floor of a random room, high enough to be on the ramps as well
+static glm::vec3 Benchmark_NavMesh_GetRandomPoint(void)
+{
+    uint32_t room_x = (uint32_t)(Benchmark_RandomFloat() * BENCHMARK_NAVMESH_NUM_ROOMS_PER_SIDE);
+    uint32_t room_z = (uint32_t)(Benchmark_RandomFloat() * BENCHMARK_NAVMESH_NUM_ROOMS_PER_SIDE);
+
+    return {
+        (float)room_x * BENCHMARK_CSG_ROOM_SPACING + 1.0f + 6.0f * Benchmark_RandomFloat(),
+        2.5f,
+        (float)room_z * BENCHMARK_CSG_ROOM_SPACING + 1.0f + 6.0f * Benchmark_RandomFloat(),
+    };
+}
+
+// Runs the queries and reports how many paths were found, and how many of the points sampled along them are off the navmesh
+static void Benchmark_NavMesh_FindPaths(NavMesh* navmesh, const NavMesh_Query* queries, NavMesh_Path* paths, const char* label)
+{
+    NavMesh_QueryStats stats;
+
+    double start_time = Benchmark_GetTime();
+    NavMesh_FindPaths(navmesh, queries, BENCHMARK_NAVMESH_NUM_QUERIES, paths, &stats);
+    double seconds = Benchmark_GetTime() - start_time;
+
+    uint64_t num_samples = 0;
+    uint64_t num_off_samples = 0;
+    uint64_t num_points = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_NAVMESH_NUM_QUERIES; ++i)
+    {
+        const glm::vec3* points = navmesh->path_points + paths[i].first_point;
+        num_points += paths[i].num_points;
+
+        for (uint32_t j = 0; j + 1 < paths[i].num_points; ++j)
+        {
+            float length = glm::distance(glm::vec2(points[j].x, points[j].z), glm::vec2(points[j + 1].x, points[j + 1].z));
+            uint32_t num_steps = (uint32_t)(length / (0.5f * navmesh->settings.cell_size)) + 1;
+
+            for (uint32_t k = 0; k < num_steps; ++k)
+            {
+                glm::vec3 sample = glm::mix(points[j], points[j + 1], (float)k / (float)num_steps);
+                glm::vec3 snapped_sample;
+
+                // NOTE: Ramps are interpolated in a straight line, so the sample may be a little above the surface
+                sample.y += navmesh->settings.max_climb;
+
+                num_off_samples += (NavMesh_FindPolygon(navmesh, sample, 0, &snapped_sample) == SCENE_ID_NONE);
+                ++num_samples;
+            }
+        }
+    }
+
+    printf("  %-18s %10.2f ms (%u of %u found, %u cached, %u searches expanding %llu polygons, %.1f points per path, %.2f%% of %llu samples off the navmesh)\n",
+        label, seconds * 1e3, stats.num_found, stats.num_queries, stats.num_cached, stats.num_searches, (unsigned long long)stats.num_expanded_polygons,
+        (double)num_points / (double)glm::max(stats.num_found, 1u), 100.0 * (double)num_off_samples / (double)glm::max(num_samples, (uint64_t)1),
+        (unsigned long long)num_samples);
+}
+
+// Builds the navmesh of a room map and finds paths between random points of it, twice to hit the path cache, then moves
+// a pillar and rebuilds only the tiles around it
+static void Benchmark_NavMesh(void)
+{
+    Scene scene;
+    CSG_Map map;
+    NavMesh navmesh;
+    NavMesh reference_navmesh;
+
+    NavMesh_Settings settings;
+    settings.cell_size = 0.25f;
+    settings.agent_radius = 0.3f;
+    settings.agent_height = 1.8f;
+    settings.max_climb = 0.4f;
+    settings.max_slope = glm::radians(45.0f);
+
+    bool32_t init_result = Scene_Init(&scene) && CSG_Map_Init(&map) && NavMesh_Init(&navmesh, &settings) && NavMesh_Init(&reference_navmesh, &settings);
+    ASSERT(init_result == TRUE);
+    UNUSED(init_result);
+
+    uint32_t pillar_index = Benchmark_CSG_BuildMap(&map, BENCHMARK_NAVMESH_NUM_ROOMS_PER_SIDE);
+
+    CSG_CompileStats compile_stats;
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    printf("navmesh: %u faces, cells of %.2f, agent %.2f by %.2f on %u threads\n", scene.num_faces, settings.cell_size, settings.agent_radius,
+        settings.agent_height, Jobs_GetNumThreads());
+
+    NavMesh_UpdateStats update_stats;
+
+    double start_time = Benchmark_GetTime();
+    bool32_t update_result = NavMesh_Update(&navmesh, &scene, &update_stats);
+    double build_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(update_result == TRUE);
+    UNUSED(update_result);
+
+    printf("  %-18s %10.2f ms (%u tiles, %llu rays, %u spans, %u polygons, %u links)\n", "full build", build_seconds * 1e3, update_stats.num_tiles,
+        (unsigned long long)update_stats.num_rays, update_stats.num_spans, update_stats.num_polygons, update_stats.num_links);
+
+    // Agents spread over the rooms that head for a few goals
+    NavMesh_Query* queries = (NavMesh_Query*)malloc(BENCHMARK_NAVMESH_NUM_QUERIES * sizeof(NavMesh_Query));
+    NavMesh_Path* paths = (NavMesh_Path*)malloc(BENCHMARK_NAVMESH_NUM_QUERIES * sizeof(NavMesh_Path));
+    ASSERT(queries && paths);
+
+    glm::vec3 goals[BENCHMARK_NAVMESH_NUM_GOALS];
+
+    for (uint32_t i = 0; i < BENCHMARK_NAVMESH_NUM_GOALS; ++i)
+        goals[i] = Benchmark_NavMesh_GetRandomPoint();
+
+    for (uint32_t i = 0; i < BENCHMARK_NAVMESH_NUM_QUERIES; ++i)
+    {
+        queries[i].start = Benchmark_NavMesh_GetRandomPoint();
+        queries[i].goal = goals[(uint32_t)(Benchmark_RandomFloat() * BENCHMARK_NAVMESH_NUM_GOALS)];
+    }
+
+    Benchmark_NavMesh_FindPaths(&navmesh, queries, paths, "cold queries");
+    Benchmark_NavMesh_FindPaths(&navmesh, queries, paths, "cached queries");
+
+    // The pillar in the middle room is moved, only the tiles around the faces it changed are built again
+    CSG_MoveBrush(&map, pillar_index, glm::vec3(-1.0f, 0.0f, -1.0f));
+    CSG_Compile(&map, &scene, &compile_stats);
+
+    start_time = Benchmark_GetTime();
+    update_result = NavMesh_Update(&navmesh, &scene, &update_stats);
+    double update_seconds = Benchmark_GetTime() - start_time;
+
+    ASSERT(update_result == TRUE);
+
+    printf("  %-18s %10.2f ms (%u added and %u removed faces, %u of %u tiles rebuilt, %llu rays)\n", "incremental build", update_seconds * 1e3,
+        update_stats.num_added_faces, update_stats.num_removed_faces, update_stats.num_rebuilt_tiles, update_stats.num_tiles,
+        (unsigned long long)update_stats.num_rays);
+
+    // Tiles outside of the reach of the changed faces are copied as they were, so the result matches a build from scratch
+    NavMesh_Update(&reference_navmesh, &scene, NULL);
+
+    bool32_t is_matching = Benchmark_NavMesh_GetChecksum(&navmesh) == Benchmark_NavMesh_GetChecksum(&reference_navmesh);
+    printf("  incremental navmesh %s\n", is_matching ? "matches a full build" : "DIFFERS FROM A FULL BUILD");
+
+    Benchmark_NavMesh_FindPaths(&navmesh, queries, paths, "queries after edit");
+
+    free(paths);
+    free(queries);
+
+    NavMesh_Destroy(&reference_navmesh);
+    NavMesh_Destroy(&navmesh);
+    CSG_Map_Destroy(&map);
+    Scene_Destroy(&scene);
+}
+
+static const Benchmark_Entry Benchmark_Entries[] = {
+    { "raycast",       "Nearest face ray casts: half-edge walk vs. face plane kernels vs. BVH", Benchmark_RayCast },
+    { "raycast-batch", "Batched ray casts in packets across the job threads vs. single ray calls", Benchmark_RayCastBatch },
+    { "scene-storage", "Builds a million face grid and reports the memory of the topology arrays", Benchmark_SceneStorage },
+    { "scene-build",   "Per-face vs. bulk mesh construction of a million face grid and a high valence fan", Benchmark_SceneBuild },
+    { "geometry-update", "Regenerates only the faces around moved vertices vs. the whole million face grid", Benchmark_GeometryUpdate },
+    { "triangulation", "Ear clips a grid of concave star faces once and generates geometry from the cached triangles", Benchmark_Triangulation },
+    { "vertex-format", "Writes and uploads the geometry of a million face grid as full and as packed vertices", Benchmark_VertexFormat },
+    { "reorder",       "Geometry writes and ray casts of a grid built in random order, before and after reordering it along a Morton curve", Benchmark_Reorder },
+    { "pick",          "Nearest vertex and edge picking through the pick grid vs. a brute force cone test, before and after edits", Benchmark_Pick },
+    { "level-io",      "Saves a million face grid to a level file and maps it back, including the page faults", Benchmark_LevelIO },
+    { "import",        "Streams a grid in from an OBJ triangle soup and an indexed binary PLY, welding both back together", Benchmark_Import },
+    { "journal",       "Records hours of drags in the undo journal, then undoes steps and seeks through the history", Benchmark_Journal },
+    { "snapshot",      "Drags and replaces faces of a million face grid while a snapshot of it is saved on another thread", Benchmark_Snapshot },
+    { "defrag",        "Deletes half of a million face grid, reuses freed slots and compacts the rest in per frame steps", Benchmark_Defrag },
+    { "optimize",      "Welds a triangle soup level and merges its coplanar faces, reporting what the GPU gets before and after", Benchmark_Optimize },
+    { "vertex-cache",  "Reorders the triangles of concave faces for the post-transform vertex cache, reporting ACMR and ATVR", Benchmark_VertexCache },
+    { "csg",           "Compiles a map of about a hundred brushes, then moves one and compiles only the brushes it touched", Benchmark_CSG },
+    { "pvs",           "Samples the visible clusters of every cell of a large room map, reporting the rows and what is culled", Benchmark_PVS },
+    { "cull",          "Culls the clusters of a million face grid against camera frustums with the scalar, SSE and AVX kernels", Benchmark_Cull },
+    { "lightmap",      "Bakes the lightmap of a room map from scratch, then again after moving a pillar", Benchmark_Lightmap },
+    { "ao",            "Bakes per vertex ambient occlusion of a room map, then again around a moved pillar", Benchmark_AO },
+    { "navmesh",       "Builds the navmesh of a room map and runs batched path queries, then rebuilds the tiles around a moved pillar", Benchmark_NavMesh },
+};
+
+bool32_t Benchmark_Run(const char* name)
+{
+    for (uint32_t i = 0; i < ARRAY_SIZE_U32(Benchmark_Entries); ++i)
+    {
+        if (strcmp(Benchmark_Entries[i].name, name) == 0)
+        {
+            Benchmark_Entries[i].function();
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void Benchmark_PrintAvailable(void)
+{
+    fprintf(stderr, "Available benchmarks:\n");
+
+    for (uint32_t i = 0; i < ARRAY_SIZE_U32(Benchmark_Entries); ++i)
+        fprintf(stderr, " - %-12s %s\n", Benchmark_Entries[i].name, Benchmark_Entries[i].description);
+}
+
+// Checks reuse the scenes of the benchmarks, but time nothing and fail when a result is wrong
+
+typedef bool32_t (*Benchmark_CheckFunction)(void);
+
+struct Benchmark_CheckEntry
+{
+    const char*             name;
+    const char*             description;
+    Benchmark_CheckFunction function;
+};
+
+// Every check starts from the same random state, so it sees the same inputs whether it runs alone or with the others
+#define BENCHMARK_CHECK_RANDOM_SEED 0x9E3779B9u
+
+static bool32_t Benchmark_Check_Report(const char* label, bool32_t is_passed)
+{
+    printf("  %-56s %s\n", label, is_passed ? "ok" : "FAILED");
+    return is_passed;
+}
+
+// Walks the links of every live face, a broken link or a miscounted deletion makes the scene invalid
+static bool32_t Benchmark_Check_IsSceneValid(const Scene* scene)
+{
+    uint32_t num_deleted_faces = 0;
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        if (Scene_Face_IsDeleted(scene, i))
+        {
+            ++num_deleted_faces;
+            continue;
+        }
+
+        const Scene_Face* face = scene->faces + i;
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+        {
+            uint32_t half_edge_index = face->first_half_edge + j;
+            const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+
+            if (half_edge->face != i ||
+                scene->half_edges[half_edge->next_half_edge].prev_half_edge != half_edge_index ||
+                Scene_Vertex_IsDeleted(scene, half_edge->origin_vertex))
+            {
+                return FALSE;
+            }
+
+            if (half_edge->opposite_half_edge != SCENE_ID_NONE && scene->half_edges[half_edge->opposite_half_edge].opposite_half_edge != half_edge_index)
+                return FALSE;
+
+            uint32_t outgoing_half_edge_index = scene->vertices[half_edge->origin_vertex].first_outgoing_half_edge;
+
+            while (outgoing_half_edge_index != SCENE_ID_NONE && outgoing_half_edge_index != half_edge_index)
+                outgoing_half_edge_index = scene->half_edges[outgoing_half_edge_index].next_outgoing_half_edge;
+
+            if (outgoing_half_edge_index == SCENE_ID_NONE)
+                return FALSE;
+        }
+    }
+
+    return num_deleted_faces == scene->num_deleted_faces;
+}
+
+// FNV-1a
+static uint64_t Benchmark_Check_Hash(uint64_t hash, const void* data, uint64_t size)
+{
+    for (uint64_t i = 0; i < size; ++i)
+        hash = (hash ^ ((const uint8_t*)data)[i]) * 0x100000001B3ull;
+
+    return hash;
+}
+
+static int Benchmark_Check_CompareHashes(const void* a, const void* b)
+{
+    uint64_t hash_a = *(const uint64_t*)a;
+    uint64_t hash_b = *(const uint64_t*)b;
+
+    return (hash_a > hash_b) - (hash_a < hash_b);
+}
+
+static bool32_t Benchmark_Check_IsPositionLess(glm::vec3 a, glm::vec3 b)
+{
+    if (a.x != b.x) return a.x < b.x;
+    if (a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+}
+
+// Digest of what the scene looks like, no matter which slots its elements are in: live faces are hashed by their color and
+// their corner positions from the smallest one on, then the face and vertex hashes are sorted before they are combined
+static uint64_t Benchmark_Check_HashScene(const Scene* scene)
+{
+    uint64_t* hashes = (uint64_t*)malloc(((uint64_t)scene->num_faces + scene->num_vertices + 1) * sizeof(uint64_t));
+    uint32_t num_face_hashes = 0;
+
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        if (Scene_Face_IsDeleted(scene, i))
+            continue;
+
+        const Scene_Face* face = scene->faces + i;
+
+        uint32_t first_corner = 0;
+
+        for (uint32_t j = 1; j < face->num_half_edges; ++j)
+        {
+            glm::vec3 position = scene->vertices[scene->half_edges[face->first_half_edge + j].origin_vertex].position;
+            glm::vec3 first_position = scene->vertices[scene->half_edges[face->first_half_edge + first_corner].origin_vertex].position;
+
+            if (Benchmark_Check_IsPositionLess(position, first_position))
+                first_corner = j;
+        }
+
+        uint64_t hash = Benchmark_Check_Hash(0xCBF29CE484222325ull, &face->color, sizeof(face->color));
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+        {
+            uint32_t half_edge_index = face->first_half_edge + (first_corner + j) % face->num_half_edges;
+            hash = Benchmark_Check_Hash(hash, &scene->vertices[scene->half_edges[half_edge_index].origin_vertex].position, sizeof(glm::vec3));
+        }
+
+        hashes[num_face_hashes++] = hash;
+    }
+
+    // The count keeps the face and vertex hashes apart
+    hashes[num_face_hashes] = num_face_hashes;
+
+    uint32_t num_hashes = num_face_hashes + 1;
+
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+    {
+        if (!Scene_Vertex_IsDeleted(scene, i))
+            hashes[num_hashes++] = Benchmark_Check_Hash(0xCBF29CE484222325ull, &scene->vertices[i].position, sizeof(glm::vec3));
+    }
+
+    qsort(hashes, num_face_hashes, sizeof(uint64_t), Benchmark_Check_CompareHashes);
+    qsort(hashes + num_face_hashes + 1, num_hashes - num_face_hashes - 1, sizeof(uint64_t), Benchmark_Check_CompareHashes);
+
+    uint64_t hash = Benchmark_Check_Hash(0xCBF29CE484222325ull, hashes, (uint64_t)num_hashes * sizeof(uint64_t));
+
+    free(hashes);
+
+    return hash;
+}
+
+#define BENCHMARK_CHECK_CSG_NUM_ROOMS_PER_SIDE 3
+#define BENCHMARK_CHECK_CSG_NUM_EDITS 8
+
+// Compiles a small room map, then moves its middle pillar with incremental compiles, which have to keep the scene closed and
+// end up with what a full compile of the moved map gives
+static bool32_t Benchmark_Check_CSG(void)
+{
+    Scene scene_storage[2];
+    CSG_Map map_storage[2];
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        bool32_t init_result = Scene_Init(scene_storage + i) && CSG_Map_Init(map_storage + i);
+        ASSERT(init_result == TRUE);
+        UNUSED(init_result);
+    }
+
+    Scene* scene = scene_storage + 0;
+    CSG_Map* map = map_storage + 0;
+
+    uint32_t pillar_index = Benchmark_CSG_BuildMap(map, BENCHMARK_CHECK_CSG_NUM_ROOMS_PER_SIDE);
+
+    CSG_CompileStats stats;
+    CSG_Compile(map, scene, &stats);
+
+    bool32_t is_passed = Benchmark_Check_Report("full compile gives a valid scene", scene->num_faces > 0 && Benchmark_Check_IsSceneValid(scene));
+    is_passed &= Benchmark_Check_Report("full compile leaves no boundary edges", Benchmark_CSG_CountBoundaryEdges(scene) == 0);
+
+    bool32_t is_valid = TRUE;
+    uint32_t num_boundary_edges = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_CSG_NUM_EDITS; ++i)
+    {
+        glm::vec3 offset = { (Benchmark_RandomFloat() - 0.5f) * 0.5f, 0.0f, (Benchmark_RandomFloat() - 0.5f) * 0.5f };
+
+        CSG_MoveBrush(map, pillar_index, offset);
+        CSG_Compile(map, scene, &stats);
+
+        is_valid &= Benchmark_Check_IsSceneValid(scene);
+        num_boundary_edges += Benchmark_CSG_CountBoundaryEdges(scene);
+    }
+
+    is_passed &= Benchmark_Check_Report("incremental compiles give valid scenes", is_valid);
+    is_passed &= Benchmark_Check_Report("incremental compiles leave no boundary edges", num_boundary_edges == 0);
+
+    Scene* reference_scene = scene_storage + 1;
+    CSG_Map* reference_map = map_storage + 1;
+
+    Benchmark_CSG_BuildMap(reference_map, BENCHMARK_CHECK_CSG_NUM_ROOMS_PER_SIDE);
+    memcpy(reference_map->brushes + pillar_index, map->brushes + pillar_index, sizeof(CSG_Brush));
+
+    CSG_CompileStats reference_stats;
+    CSG_Compile(reference_map, reference_scene, &reference_stats);
+
+    const CSG_PolygonStore* store = map->stores + map->current_store;
+    const CSG_PolygonStore* reference_store = reference_map->stores + reference_map->current_store;
+
+    bool32_t is_identical =
+        store->num_polygons == reference_store->num_polygons &&
+        store->num_points == reference_store->num_points &&
+        memcmp(store->points, reference_store->points, (uint64_t)store->num_points * sizeof(glm::vec3)) == 0;
+
+    is_passed &= Benchmark_Check_Report("incremental polygons match a full compile", is_identical);
+    is_passed &= Benchmark_Check_Report("incremental scene matches a full compile", Benchmark_Check_HashScene(scene) == Benchmark_Check_HashScene(reference_scene));
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        CSG_Map_Destroy(map_storage + i);
+        Scene_Destroy(scene_storage + i);
+    }
+
+    return is_passed;
+}
+
+#define BENCHMARK_CHECK_JOURNAL_NUM_CELLS_PER_SIDE 24
+#define BENCHMARK_CHECK_JOURNAL_NUM_STEPS 600
+#define BENCHMARK_CHECK_JOURNAL_MAX_NUM_EDITS_PER_GROUP 4
+#define BENCHMARK_CHECK_JOURNAL_MAX_NUM_MOVES_PER_DEFRAG 64
+
+static uint32_t Benchmark_Check_RandomIndex(uint32_t count)
+{
+    return (uint32_t)(Benchmark_RandomFloat() * (float)count);
+}
+
+// One group of random edits: deleted faces and vertices, raised vertices and new polygons away from the grid
+static void Benchmark_Check_EditJournaled(Scene_Journal* journal, Scene* scene, uint32_t step)
+{
+    Scene_Journal_BeginGroup(journal);
+
+    uint32_t num_edits = 1 + Benchmark_Check_RandomIndex(BENCHMARK_CHECK_JOURNAL_MAX_NUM_EDITS_PER_GROUP);
+
+    for (uint32_t i = 0; i < num_edits; ++i)
+    {
+        uint32_t edit = Benchmark_Check_RandomIndex(5);
+
+        if (edit == 0 && scene->num_faces > 0)
+        {
+            uint32_t face_index = Benchmark_Check_RandomIndex(scene->num_faces);
+
+            if (!Scene_Face_IsDeleted(scene, face_index))
+                Scene_Journal_DeleteFace(journal, scene, face_index);
+        }
+        else if (edit <= 2 && scene->num_vertices > 0)
+        {
+            uint32_t vertex_index = Benchmark_Check_RandomIndex(scene->num_vertices);
+
+            if (Scene_Vertex_IsDeleted(scene, vertex_index))
+                continue;
+
+            if (edit == 1)
+                Scene_Journal_DeleteVertex(journal, scene, vertex_index);
+            else
+                Scene_Journal_SetVertexPosition(journal, scene, vertex_index, scene->vertices[vertex_index].position + glm::vec3(0.0f, 0.25f, 0.0f));
+        }
+        else
+        {
+            glm::vec3 center = { 100.0f + (float)Benchmark_Check_RandomIndex(100), (float)step, (float)Benchmark_Check_RandomIndex(100) };
+
+            uint32_t vertex_indices[6];
+            uint32_t num_corners = 3 + Benchmark_Check_RandomIndex(4);
+
+            for (uint32_t j = 0; j < num_corners; ++j)
+            {
+                float angle = 6.28318530718f * (float)j / (float)num_corners;
+                vertex_indices[j] = Scene_Journal_AddVertex(journal, scene, center + glm::vec3(cosf(angle), 0.0f, sinf(angle)));
+            }
+
+            glm::vec4 color = { Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat(), 1.0f };
+            Scene_Journal_ConstructFace(journal, scene, vertex_indices, num_corners, color);
+        }
+    }
+
+    Scene_Journal_EndGroup(journal);
+}
+
+// Mixes journaled edits with defrag steps that the journal follows and with seeks through the history. Every seek has to bring
+// back the scene that the group left behind, however the defrag moved things around in between.
+static bool32_t Benchmark_Check_JournalDefrag(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_CHECK_JOURNAL_NUM_CELLS_PER_SIDE);
+
+    Scene_Journal journal;
+    bool32_t journal_init_result = Scene_Journal_Init(&journal, SCENE_JOURNAL_DEFAULT_CAPACITY);
+    ASSERT(journal_init_result == TRUE);
+    UNUSED(journal_init_result);
+
+    // Hash of the scene after every group, a group never leaves more than one behind
+    uint64_t* group_hashes = (uint64_t*)malloc((BENCHMARK_CHECK_JOURNAL_NUM_STEPS + 1) * sizeof(uint64_t));
+    group_hashes[journal.current_group] = Benchmark_Check_HashScene(scene);
+
+    uint32_t num_defrag_changes = 0;
+    uint32_t num_seek_mismatches = 0;
+    uint32_t num_invalid_steps = 0;
+    uint64_t num_defrag_moves = 0;
+
+    for (uint32_t step = 0; step < BENCHMARK_CHECK_JOURNAL_NUM_STEPS; ++step)
+    {
+        uint32_t action = Benchmark_Check_RandomIndex(10);
+
+        if (action < 6)
+        {
+            Benchmark_Check_EditJournaled(&journal, scene, step);
+
+            ASSERT(journal.current_group <= BENCHMARK_CHECK_JOURNAL_NUM_STEPS);
+            group_hashes[journal.current_group] = Benchmark_Check_HashScene(scene);
+        }
+        else if (action < 8)
+        {
+            Scene_Defragment(scene, 1 + Benchmark_Check_RandomIndex(BENCHMARK_CHECK_JOURNAL_MAX_NUM_MOVES_PER_DEFRAG));
+            Scene_Journal_FollowDefrag(&journal, scene);
+
+            num_defrag_moves += scene->defrag.num_moves;
+            num_defrag_changes += (Benchmark_Check_HashScene(scene) != group_hashes[journal.current_group]);
+        }
+        else
+        {
+            uint64_t group = journal.first_group + Benchmark_Check_RandomIndex((uint32_t)(journal.end_group - journal.first_group + 1));
+
+            Scene_Journal_Seek(&journal, scene, group);
+            num_seek_mismatches += (Benchmark_Check_HashScene(scene) != group_hashes[group]);
+        }
+
+        num_invalid_steps += !Benchmark_Check_IsSceneValid(scene);
+    }
+
+    // Undoes everything with a few defrag steps on the way, then redoes it all again
+    uint32_t num_undo_mismatches = 0;
+    uint32_t num_redo_mismatches = 0;
+
+    for (uint64_t group = journal.end_group + 1; group-- > journal.first_group;)
+    {
+        Scene_Journal_Seek(&journal, scene, group);
+        num_undo_mismatches += (Benchmark_Check_HashScene(scene) != group_hashes[group] || !Benchmark_Check_IsSceneValid(scene));
+
+        if (group % 5 == 0)
+        {
+            Scene_Defragment(scene, 7);
+            Scene_Journal_FollowDefrag(&journal, scene);
+
+            num_defrag_moves += scene->defrag.num_moves;
+        }
+    }
+
+    for (uint64_t group = journal.first_group; group <= journal.end_group; ++group)
+    {
+        Scene_Journal_Seek(&journal, scene, group);
+        num_redo_mismatches += (Benchmark_Check_HashScene(scene) != group_hashes[group] || !Benchmark_Check_IsSceneValid(scene));
+    }
+
+    bool32_t is_passed = Benchmark_Check_Report("history has groups and defrag moved elements", journal.end_group > journal.first_group && num_defrag_moves > 0);
+    is_passed &= Benchmark_Check_Report("scene stays valid through edits, defrags and seeks", num_invalid_steps == 0);
+    is_passed &= Benchmark_Check_Report("defrag leaves the scene as it was", num_defrag_changes == 0);
+    is_passed &= Benchmark_Check_Report("seeks bring back the scene of their group", num_seek_mismatches == 0);
+    is_passed &= Benchmark_Check_Report("undoing everything across defrags", num_undo_mismatches == 0);
+    is_passed &= Benchmark_Check_Report("redoing everything afterwards", num_redo_mismatches == 0);
+
+    free(group_hashes);
+
+    Scene_Journal_Destroy(&journal);
+    Scene_Destroy(scene);
+
+    return is_passed;
+}
+
+#define BENCHMARK_CHECK_SNAPSHOT_NUM_CELLS_PER_SIDE 64
+#define BENCHMARK_CHECK_SNAPSHOT_NUM_MOVED_VERTICES 1000
+#define BENCHMARK_CHECK_SNAPSHOT_NUM_DELETED_FACES 1000
+#define BENCHMARK_CHECK_SNAPSHOT_NUM_DELETED_VERTICES 100
+#define BENCHMARK_CHECK_SNAPSHOT_NUM_ADDED_FACES 500
+#define BENCHMARK_CHECK_SNAPSHOT_PATH "fps_check_snapshot.fpsl"
+
+// Moves, deletes, compacts and appends after a snapshot was taken, the snapshot and the file saved from it still have to hold
+// the scene from before, byte for byte
+static bool32_t Benchmark_Check_Snapshot(void)
+{
+    Scene scene_storage;
+    bool32_t scene_init_result = Scene_Init(&scene_storage);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Scene* scene = &scene_storage;
+    Benchmark_BuildGridScene(scene, BENCHMARK_CHECK_SNAPSHOT_NUM_CELLS_PER_SIDE);
+
+    Benchmark_Journal_Snapshot reference;
+    Benchmark_Journal_TakeSnapshot(scene, &reference);
+
+    Scene_Snapshot snapshot;
+    bool32_t snapshot_init_result = Scene_Snapshot_Init(&snapshot);
+    ASSERT(snapshot_init_result == TRUE);
+    UNUSED(snapshot_init_result);
+
+    bool32_t take_result = Scene_Snapshot_Take(&snapshot, scene);
+    ASSERT(take_result == TRUE);
+    UNUSED(take_result);
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_SNAPSHOT_NUM_MOVED_VERTICES; ++i)
+    {
+        uint32_t vertex_index = Benchmark_Check_RandomIndex(scene->num_vertices);
+        Scene_SetVertexPosition(scene, vertex_index, scene->vertices[vertex_index].position + glm::vec3(0.0f, 0.5f, 0.0f));
+    }
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_SNAPSHOT_NUM_DELETED_FACES; ++i)
+    {
+        uint32_t face_index = Benchmark_Check_RandomIndex(scene->num_faces);
+
+        if (!Scene_Face_IsDeleted(scene, face_index))
+            Scene_DeleteFace(scene, face_index);
+    }
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_SNAPSHOT_NUM_DELETED_VERTICES; ++i)
+    {
+        uint32_t vertex_index = Benchmark_Check_RandomIndex(scene->num_vertices);
+
+        if (!Scene_Vertex_IsDeleted(scene, vertex_index))
+            Scene_DeleteVertex(scene, vertex_index);
+    }
+
+    while (!Scene_Defragment(scene, BENCHMARK_DEFRAG_NUM_MOVES_PER_STEP))
+        ;
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_SNAPSHOT_NUM_ADDED_FACES; ++i)
+    {
+        uint32_t face_vertices[3];
+
+        for (uint32_t j = 0; j < 3; ++j)
+            face_vertices[j] = Scene_AddVertex(scene, { Benchmark_RandomFloat(), Benchmark_RandomFloat(), Benchmark_RandomFloat() });
+
+        uint32_t face_index = Scene_ConstructFace(scene, face_vertices, ARRAY_SIZE_U32(face_vertices), { 1.0f, 0.0f, 0.0f, 1.0f });
+        ASSERT(face_index != SCENE_ID_NONE);
+        UNUSED(face_index);
+    }
+
+    bool32_t save_result = Scene_Snapshot_Save(&snapshot, BENCHMARK_CHECK_SNAPSHOT_PATH);
+
+    Scene snapshot_scene;
+    bool32_t snapshot_scene_init_result = Scene_Init(&snapshot_scene);
+    ASSERT(snapshot_scene_init_result == TRUE);
+    UNUSED(snapshot_scene_init_result);
+
+    snapshot_scene.vertices   = ARENA_ALLOCATE_ARRAY(&snapshot_scene.vertex_arena, Scene_Vertex, snapshot.num_vertices);
+    snapshot_scene.half_edges = ARENA_ALLOCATE_ARRAY(&snapshot_scene.half_edge_arena, Scene_HalfEdge, snapshot.num_half_edges);
+    snapshot_scene.faces      = ARENA_ALLOCATE_ARRAY(&snapshot_scene.face_arena, Scene_Face, snapshot.num_faces);
+
+    snapshot_scene.num_vertices   = snapshot.num_vertices;
+    snapshot_scene.num_half_edges = snapshot.num_half_edges;
+    snapshot_scene.num_faces      = snapshot.num_faces;
+
+    Scene_Snapshot_ReadVertices(&snapshot, 0, snapshot.num_vertices, snapshot_scene.vertices);
+    Scene_Snapshot_ReadHalfEdges(&snapshot, 0, snapshot.num_half_edges, snapshot_scene.half_edges);
+    Scene_Snapshot_ReadFaces(&snapshot, 0, snapshot.num_faces, snapshot_scene.faces);
+
+    bool32_t is_passed = Benchmark_Check_Report("snapshot reads match the scene it was taken of", Benchmark_Journal_MatchesSnapshot(&snapshot_scene, &reference));
+
+    Scene loaded_scene;
+    bool32_t file_matches = save_result && Scene_Load(&loaded_scene, BENCHMARK_CHECK_SNAPSHOT_PATH);
+
+    if (file_matches)
+    {
+        file_matches = Benchmark_Journal_MatchesSnapshot(&loaded_scene, &reference);
+        Scene_Destroy(&loaded_scene);
+    }
+
+    is_passed &= Benchmark_Check_Report("file saved from the snapshot matches too", file_matches);
+    is_passed &= Benchmark_Check_Report("edited scene stays valid", Benchmark_Check_IsSceneValid(scene));
+
+    Scene_Destroy(&snapshot_scene);
+    Benchmark_Journal_FreeSnapshot(&reference);
+
+    Scene_Snapshot_Release(&snapshot);
+    Scene_Snapshot_Destroy(&snapshot);
+    Scene_Destroy(scene);
+
+    remove(BENCHMARK_CHECK_SNAPSHOT_PATH);
+
+    return is_passed;
+}
+
+#define BENCHMARK_CHECK_KERNELS_NUM_CELLS_PER_SIDE 256
+#define BENCHMARK_CHECK_KERNELS_NUM_VIEWS 256
+#define BENCHMARK_CHECK_KERNELS_NUM_MOVED_VERTICES 1000
+#define BENCHMARK_CHECK_KERNELS_NUM_STAR_CELLS_PER_SIDE 16
+
+// Counts the views for which a cull kernel keeps other clusters than the scalar one, and adds up the faces in the frustum that
+// the best kernel culled
+static uint32_t Benchmark_Check_CountCullMismatches(const Scene* scene, uint32_t kernel, const glm::mat4* view_projections, uint32_t* out_num_missed_faces)
+{
+    uint32_t num_clusters = Scene_GetNumClusters(scene);
+
+    uint32_t* cluster_indices = (uint32_t*)malloc((uint64_t)num_clusters * sizeof(uint32_t));
+    uint32_t* reference_cluster_indices = (uint32_t*)malloc((uint64_t)num_clusters * sizeof(uint32_t));
+
+    uint32_t num_mismatches = 0;
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_KERNELS_NUM_VIEWS; ++i)
+    {
+        uint32_t num_view_clusters = Scene_Clusters_CullFrustum(scene, kernel, view_projections + i, cluster_indices);
+        uint32_t num_reference_clusters = Scene_Clusters_CullFrustum(scene, SCENE_CLUSTERS_KERNEL_SCALAR, view_projections + i, reference_cluster_indices);
+
+        if (num_view_clusters != num_reference_clusters ||
+            memcmp(cluster_indices, reference_cluster_indices, num_view_clusters * sizeof(uint32_t)) != 0)
+        {
+            ++num_mismatches;
+        }
+
+        if (out_num_missed_faces)
+            *out_num_missed_faces += Benchmark_Cull_CountMissedFaces(scene, view_projections + i, cluster_indices, num_view_clusters);
+    }
+
+    free(reference_cluster_indices);
+    free(cluster_indices);
+
+    return num_mismatches;
+}
+
+// Every SIMD kernel has to give what its scalar counterpart gives: the cull kernels the same clusters of a reordered grid,
+// before and after a refit, and the face plane kernels the same hit faces on concave stars
+static bool32_t Benchmark_Check_Kernels(void)
+{
+    Scene scene;
+    bool32_t scene_init_result = Scene_Init(&scene);
+    ASSERT(scene_init_result == TRUE);
+    UNUSED(scene_init_result);
+
+    Benchmark_BuildGridScene(&scene, BENCHMARK_CHECK_KERNELS_NUM_CELLS_PER_SIDE);
+    Scene_Reorder(&scene);
+    Scene_Clusters_Update(&scene);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view_projections[BENCHMARK_CHECK_KERNELS_NUM_VIEWS];
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_KERNELS_NUM_VIEWS; ++i)
+        view_projections[i] = Benchmark_Cull_GetViewProjection(&projection, BENCHMARK_CHECK_KERNELS_NUM_CELLS_PER_SIDE);
+
+    uint32_t best_kernel = Scene_Clusters_GetBestKernel();
+    bool32_t is_passed = TRUE;
+
+    for (uint32_t kernel = SCENE_CLUSTERS_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+    {
+        uint32_t num_missed_faces = 0;
+        uint32_t num_mismatches = Benchmark_Check_CountCullMismatches(&scene, kernel, view_projections, &num_missed_faces);
+
+        is_passed &= Benchmark_Check_Report(Benchmark_Cull_KernelLabels[kernel], num_mismatches == 0 && num_missed_faces == 0);
+    }
+
+    for (uint32_t i = 0; i < BENCHMARK_CHECK_KERNELS_NUM_MOVED_VERTICES; ++i)
+    {
+        uint32_t vertex_index = Benchmark_Check_RandomIndex(scene.num_vertices);
+        Scene_SetVertexPosition(&scene, vertex_index, scene.vertices[vertex_index].position + glm::vec3(0.0f, 0.5f, 0.0f));
+    }
+
+    Scene_Clusters_Update(&scene);
+
+    uint32_t num_refit_mismatches = 0;
+    uint32_t num_refit_missed_faces = 0;
+
+    for (uint32_t kernel = SCENE_CLUSTERS_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+        num_refit_mismatches += Benchmark_Check_CountCullMismatches(&scene, kernel, view_projections, &num_refit_missed_faces);
+
+    is_passed &= Benchmark_Check_Report("frustum cull after a refit", num_refit_mismatches == 0 && num_refit_missed_faces == 0);
+
+    uint64_t groups_size = (uint64_t)scene.clusters.num_groups * sizeof(Scene_Clusters_Group);
+    Scene_Clusters_Group* refit_groups = (Scene_Clusters_Group*)malloc(groups_size);
+    memcpy(refit_groups, scene.clusters.groups, groups_size);
+
+    scene.clusters.needs_rebuild = TRUE;
+    Scene_Clusters_Update(&scene);
+
+    is_passed &= Benchmark_Check_Report("refit bounds match a rebuild", memcmp(refit_groups, scene.clusters.groups, groups_size) == 0);
+
+    free(refit_groups);
+    Scene_Destroy(&scene);
+
+    // The stars stand on the 45 degree wall, where the face plane kernels pick the axes to project onto from a tie
+    bool32_t star_scene_init_result = Scene_Init(&scene);
+    ASSERT(star_scene_init_result == TRUE);
+    UNUSED(star_scene_init_result);
+
+    const glm::mat3* frame = Benchmark_RayCast_BuildScene(&scene, 2, BENCHMARK_CHECK_KERNELS_NUM_STAR_CELLS_PER_SIDE);
+    Benchmark_RayCast_GenerateRays((float)BENCHMARK_CHECK_KERNELS_NUM_STAR_CELLS_PER_SIDE, frame);
+
+    Scene_FacePlanes_Update(&scene);
+
+    const char* kernel_labels[] = { "face plane ray casts (scalar)", "face plane ray casts (SSE)", "face plane ray casts (AVX)" };
+
+    best_kernel = Scene_FacePlanes_GetBestKernel();
+
+    for (uint32_t kernel = SCENE_FACE_PLANES_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+    {
+        uint32_t num_mismatches = 0;
+
+        for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_RAYS; ++i)
+        {
+            uint32_t hit_face_index = SCENE_ID_NONE;
+            uint32_t reference_hit_face_index = SCENE_ID_NONE;
+            float    hit_distance;
+
+            Scene_FacePlanes_RayCast(&scene, kernel, Benchmark_RayCast_Origins[i], Benchmark_RayCast_Directions[i], 0.01f, 100.0f, &hit_face_index, &hit_distance);
+            Scene_FacePlanes_RayCast(&scene, SCENE_FACE_PLANES_KERNEL_SCALAR, Benchmark_RayCast_Origins[i], Benchmark_RayCast_Directions[i], 0.01f, 100.0f,
+                &reference_hit_face_index, &hit_distance);
+
+            num_mismatches += (hit_face_index != reference_hit_face_index);
+        }
+
+        is_passed &= Benchmark_Check_Report(kernel_labels[kernel], num_mismatches == 0);
+    }
+
+    Scene_Destroy(&scene);
+
+    return is_passed;
+}
+
+#define BENCHMARK_CHECK_RAYCAST_NUM_CELLS_PER_SIDE 16
+
+// The scenes of the ray cast benchmark at a smaller size, every face plane kernel and the BVH have to hit exactly the faces
+// that the brute force reference hits, the concave arms of the stars included
+static bool32_t Benchmark_Check_RayCast(void)
+{
+    bool32_t is_passed = TRUE;
+
+    for (uint32_t i = 0; i < BENCHMARK_RAYCAST_NUM_SCENES; ++i)
+    {
+        Scene scene;
+        bool32_t scene_init_result = Scene_Init(&scene);
+        ASSERT(scene_init_result == TRUE);
+        UNUSED(scene_init_result);
+
+        const glm::mat3* frame = Benchmark_RayCast_BuildScene(&scene, i, BENCHMARK_CHECK_RAYCAST_NUM_CELLS_PER_SIDE);
+        Benchmark_RayCast_GenerateRays((float)BENCHMARK_CHECK_RAYCAST_NUM_CELLS_PER_SIDE, frame);
+
+        SVertex*  vertices = NULL;
+        uint32_t* indices = NULL;
+
+        if (i > 0)
+            Benchmark_RayCast_GenerateTriangles(&scene, &vertices, &indices);
+
+        Benchmark_RayCast_FindReferenceHits(&scene, vertices, indices);
+
+        Scene_FacePlanes_Update(&scene);
+
+        uint32_t best_kernel = Scene_FacePlanes_GetBestKernel();
+        uint32_t num_reference_hits = 0;
+        uint32_t num_mismatches = 0;
+
+        for (uint32_t j = 0; j < BENCHMARK_RAYCAST_NUM_RAYS; ++j)
+        {
+            num_reference_hits += (Benchmark_RayCast_ReferenceHits[j] != SCENE_ID_NONE);
+
+            for (uint32_t kernel = SCENE_FACE_PLANES_KERNEL_SCALAR; kernel <= best_kernel; ++kernel)
+            {
+                uint32_t hit_face_index = SCENE_ID_NONE;
+                float    hit_distance;
+
+                Scene_FacePlanes_RayCast(&scene, kernel, Benchmark_RayCast_Origins[j], Benchmark_RayCast_Directions[j], 0.01f, 100.0f, &hit_face_index, &hit_distance);
+                num_mismatches += (hit_face_index != Benchmark_RayCast_ReferenceHits[j]);
+            }
+
+            uint32_t hit_face_index = SCENE_ID_NONE;
+            Scene_RayCast_FindNearestIntersectingFace(&scene, Benchmark_RayCast_Origins[j], Benchmark_RayCast_Directions[j], 0.01f, 100.0f, &hit_face_index, NULL);
+
+            num_mismatches += (hit_face_index != Benchmark_RayCast_ReferenceHits[j]);
+        }
+
+        char label[128];
+        snprintf(label, sizeof(label), "%s hit like the reference", Benchmark_RayCast_SceneNames[i]);
+
+        is_passed &= Benchmark_Check_Report(label, num_reference_hits > 0 && num_mismatches == 0);
+
+        free(indices);
+        free(vertices);
+
+        Scene_Destroy(&scene);
+    }
+
+    return is_passed;
+}
+
+static const Benchmark_CheckEntry Benchmark_CheckEntries[] = {
+    { "csg",            "Full and incremental compiles of a room map give valid closed scenes that agree", Benchmark_Check_CSG },
+    { "journal-defrag", "Random edits, defrag steps and seeks, every group comes back as it was", Benchmark_Check_JournalDefrag },
+    { "snapshot",       "A snapshot and the file saved from it keep the scene through edits and a defrag", Benchmark_Check_Snapshot },
+    { "kernels",        "SSE and AVX cull and face plane kernels give what the scalar ones give", Benchmark_Check_Kernels },
+    { "raycast",        "Face plane kernels and the BVH hit what a brute force test hits, concave stars included", Benchmark_Check_RayCast },
+};
+
+bool32_t Benchmark_Check(const char* name)
+{
+    bool32_t is_found = FALSE;
+    bool32_t is_passed = TRUE;
+
+    for (uint32_t i = 0; i < ARRAY_SIZE_U32(Benchmark_CheckEntries); ++i)
+    {
+        if (name && strcmp(Benchmark_CheckEntries[i].name, name) != 0)
+            continue;
+
+        printf("%s:\n", Benchmark_CheckEntries[i].name);
+
+        Benchmark_RandomState = BENCHMARK_CHECK_RANDOM_SEED;
+
+        is_found = TRUE;
+        is_passed &= Benchmark_CheckEntries[i].function();
+    }
+
+    if (!is_found)
+    {
+        fprintf(stderr, "Available checks:\n");
+
+        for (uint32_t i = 0; i < ARRAY_SIZE_U32(Benchmark_CheckEntries); ++i)
+            fprintf(stderr, " - %-14s %s\n", Benchmark_CheckEntries[i].name, Benchmark_CheckEntries[i].description);
+
+        return FALSE;
+    }
+
+    printf("%s\n", is_passed ? "all checks passed" : "SOME CHECKS FAILED");
+
+    return is_passed;
+}
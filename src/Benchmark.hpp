@@ -0,0 +1,15 @@
+#ifndef BENCHMARK_HPP_
+#define BENCHMARK_HPP_
+
+#include "Common.hpp"
+
+// Runs the named benchmark and prints its results to stdout, returns FALSE for unknown names
+bool32_t Benchmark_Run(const char* name);
+
+void Benchmark_PrintAvailable(void);
+
+// Runs the named check, or all of them for NULL. Checks time nothing and fail when a result is wrong, returns FALSE when one
+// failed or the name is unknown, which lists the available checks.
+bool32_t Benchmark_Check(const char* name);
+
+#endif // !BENCHMARK_HPP_
@@ -0,0 +1,1193 @@
+#include "CSG.hpp"
+#include "Jobs.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#define CSG_SIDE_FRONT 0
+#define CSG_SIDE_BACK 1
+#define CSG_SIDE_ON 2
+#define CSG_SIDE_SPLIT 3
+
+#define CSG_MIN_CELL_CAPACITY ((uint32_t)1 << 6)
+
+// Cell coordinates are clamped to this range, far away corners then share the outermost cells
+#define CSG_MAX_CELL_COORDINATE (1 << 28)
+
+// Corners found along a single edge, more are not inserted
+#define CSG_MAX_EDGE_CORNERS 256
+
+// Edges are searched for corners in at most this many steps, longer edges take longer steps over larger cells
+#define CSG_MAX_EDGE_STEPS ((uint32_t)1 << 16)
+
+// Planes of polygons that are merged after the compile may be this far apart, the corners are welded already
+#define CSG_MERGE_PLANE_DISTANCE 0.0005f
+
+struct CSG_Cell
+{
+    int32_t  x;
+    int32_t  y;
+    int32_t  z;
+    uint32_t first_vertex; // Head of the vertices in the cell, SCENE_ID_NONE for empty slots
+};
+
+// Vertices in cells of a fixed size, kept at most half full so that probing always ends
+struct CSG_Grid
+{
+    CSG_Cell* cells;
+    uint32_t  capacity;
+    uint32_t* next_vertices;
+
+    float inverse_cell_size;
+};
+
+struct CSG_CompileBatch
+{
+    CSG_Map*        map;
+    const uint32_t* brush_indices;
+    uint32_t*       first_fragments; // Of the output of the task that compiled the brush
+    uint32_t*       num_fragments;
+    uint32_t        num_brushes_per_task;
+};
+
+// Polygons of the scene that is built, face i uses the num_corners[i] entries of corner_vertices from first_corners[i] on
+struct CSG_Faces
+{
+    uint32_t*  first_corners;
+    uint32_t*  num_corners;
+    glm::vec4* colors;
+    uint32_t   num_faces;
+
+    uint32_t* corner_vertices;
+    uint32_t  num_total_corners;
+};
+
+// Maps and lists
+
+static bool32_t CSG_FragmentList_Init(CSG_FragmentList* list)
+{
+    memset(list, 0, sizeof(CSG_FragmentList));
+
+    if (!Arena_CreateReserved(&list->fragment_arena, (uint64_t)CSG_MAX_NUM_TASK_FRAGMENTS * sizeof(CSG_Fragment)) ||
+        !Arena_CreateReserved(&list->point_arena, (uint64_t)CSG_MAX_NUM_TASK_FRAGMENT_POINTS * sizeof(glm::dvec3)))
+    {
+        return FALSE;
+    }
+
+    list->fragments = (CSG_Fragment*)list->fragment_arena.memory;
+    list->points    = (glm::dvec3*)list->point_arena.memory;
+
+    return TRUE;
+}
+
+static void CSG_FragmentList_Destroy(CSG_FragmentList* list)
+{
+    Arena_Destroy(&list->point_arena);
+    Arena_Destroy(&list->fragment_arena);
+
+    memset(list, 0, sizeof(CSG_FragmentList));
+}
+
+static void CSG_FragmentList_Reset(CSG_FragmentList* list)
+{
+    Arena_Reset(&list->fragment_arena);
+    Arena_Reset(&list->point_arena);
+
+    list->num_fragments = 0;
+    list->num_points = 0;
+}
+
+static void CSG_FragmentList_Push(CSG_FragmentList* list, const glm::dvec3* points, uint32_t num_points, uint32_t plane)
+{
+    CSG_Fragment* fragment = ARENA_ALLOCATE_ARRAY(&list->fragment_arena, CSG_Fragment, 1);
+    glm::dvec3* fragment_points = ARENA_ALLOCATE_ARRAY(&list->point_arena, glm::dvec3, num_points);
+
+    ASSERT(fragment == list->fragments + list->num_fragments);
+    ASSERT(fragment_points == list->points + list->num_points);
+
+    memcpy(fragment_points, points, num_points * sizeof(glm::dvec3));
+
+    fragment->first_point = list->num_points;
+    fragment->num_points  = num_points;
+    fragment->plane       = plane;
+
+    ++list->num_fragments;
+    list->num_points += num_points;
+}
+
+static bool32_t CSG_PolygonStore_Init(CSG_PolygonStore* store)
+{
+    memset(store, 0, sizeof(CSG_PolygonStore));
+
+    if (!Arena_CreateReserved(&store->polygon_arena, (uint64_t)CSG_MAX_NUM_POLYGONS * sizeof(CSG_Polygon)) ||
+        !Arena_CreateReserved(&store->point_arena, (uint64_t)CSG_MAX_NUM_POLYGON_POINTS * sizeof(glm::vec3)))
+    {
+        return FALSE;
+    }
+
+    store->polygons = (CSG_Polygon*)store->polygon_arena.memory;
+    store->points   = (glm::vec3*)store->point_arena.memory;
+
+    return TRUE;
+}
+
+static void CSG_PolygonStore_Destroy(CSG_PolygonStore* store)
+{
+    Arena_Destroy(&store->point_arena);
+    Arena_Destroy(&store->polygon_arena);
+
+    memset(store, 0, sizeof(CSG_PolygonStore));
+}
+
+// Returns the points of the new polygon, which the caller fills in
+static glm::vec3* CSG_PolygonStore_Push(CSG_PolygonStore* store, uint32_t num_points, glm::vec4 color)
+{
+    CSG_Polygon* polygon = ARENA_ALLOCATE_ARRAY(&store->polygon_arena, CSG_Polygon, 1);
+    glm::vec3* points = ARENA_ALLOCATE_ARRAY(&store->point_arena, glm::vec3, num_points);
+
+    ASSERT(polygon == store->polygons + store->num_polygons);
+    ASSERT(points == store->points + store->num_points);
+
+    polygon->first_point = store->num_points;
+    polygon->num_points  = num_points;
+    polygon->color       = color;
+
+    ++store->num_polygons;
+    store->num_points += num_points;
+
+    return points;
+}
+
+bool32_t CSG_Map_Init(CSG_Map* map)
+{
+    memset(map, 0, sizeof(CSG_Map));
+
+    bool32_t init_result =
+        Arena_CreateReserved(&map->brush_arena, (uint64_t)CSG_MAX_NUM_BRUSHES * sizeof(CSG_Brush)) &&
+        Arena_CreateReserved(&map->dirty_arena, (uint64_t)CSG_MAX_NUM_BRUSHES * 2 * sizeof(CSG_DirtyRegion)) &&
+        CSG_PolygonStore_Init(&map->stores[0]) &&
+        CSG_PolygonStore_Init(&map->stores[1]);
+
+    for (uint32_t i = 0; i < CSG_MAX_NUM_TASKS && init_result; ++i)
+    {
+        CSG_Task* task = map->tasks + i;
+
+        init_result =
+            CSG_FragmentList_Init(&task->lists[0]) &&
+            CSG_FragmentList_Init(&task->lists[1]) &&
+            CSG_FragmentList_Init(&task->output) &&
+            Arena_CreateReserved(&task->brush_index_arena, (uint64_t)CSG_MAX_NUM_BRUSHES * sizeof(uint32_t));
+
+        task->brush_indices = (uint32_t*)task->brush_index_arena.memory;
+    }
+
+    if (!init_result)
+    {
+        CSG_Map_Destroy(map);
+        return FALSE;
+    }
+
+    map->brushes       = (CSG_Brush*)map->brush_arena.memory;
+    map->dirty_regions = (CSG_DirtyRegion*)map->dirty_arena.memory;
+
+    return TRUE;
+}
+
+void CSG_Map_Destroy(CSG_Map* map)
+{
+    for (uint32_t i = 0; i < CSG_MAX_NUM_TASKS; ++i)
+    {
+        CSG_Task* task = map->tasks + i;
+
+        Arena_Destroy(&task->brush_index_arena);
+
+        CSG_FragmentList_Destroy(&task->output);
+        CSG_FragmentList_Destroy(&task->lists[1]);
+        CSG_FragmentList_Destroy(&task->lists[0]);
+    }
+
+    CSG_PolygonStore_Destroy(&map->stores[1]);
+    CSG_PolygonStore_Destroy(&map->stores[0]);
+
+    Arena_Destroy(&map->dirty_arena);
+    Arena_Destroy(&map->brush_arena);
+
+    memset(map, 0, sizeof(CSG_Map));
+}
+
+// Polygons
+
+// Splits a convex polygon by the plane, corners in the plane go to both sides. Returns CSG_SIDE_SPLIT only when there are
+// corners on both sides, the pieces are written then.
+static uint32_t CSG_SplitPolygon(
+    const glm::dvec3* points,
+    uint32_t          num_points,
+    glm::dvec3        normal,
+    double            offset,
+    glm::dvec3*       front_points,
+    uint32_t*         out_num_front_points,
+    glm::dvec3*       back_points,
+    uint32_t*         out_num_back_points
+)
+{
+    double distances[CSG_MAX_FRAGMENT_POINTS];
+    uint32_t num_front = 0;
+    uint32_t num_back = 0;
+
+    for (uint32_t i = 0; i < num_points; ++i)
+    {
+        distances[i] = glm::dot(normal, points[i]) + offset;
+
+        num_front += (distances[i] > CSG_PLANE_EPSILON);
+        num_back += (distances[i] < -CSG_PLANE_EPSILON);
+    }
+
+    if (num_front == 0 && num_back == 0) return CSG_SIDE_ON;
+    if (num_back == 0) return CSG_SIDE_FRONT;
+    if (num_front == 0) return CSG_SIDE_BACK;
+
+    uint32_t num_front_points = 0;
+    uint32_t num_back_points = 0;
+
+    for (uint32_t i = 0; i < num_points; ++i)
+    {
+        uint32_t next = (i + 1 < num_points) ? i + 1 : 0;
+
+        double distance = distances[i];
+        double next_distance = distances[next];
+
+        if (distance >= -CSG_PLANE_EPSILON) front_points[num_front_points++] = points[i];
+        if (distance <= CSG_PLANE_EPSILON) back_points[num_back_points++] = points[i];
+
+        // Edges that cross the plane get a corner in it on both sides
+        if ((distance > CSG_PLANE_EPSILON && next_distance < -CSG_PLANE_EPSILON) ||
+            (distance < -CSG_PLANE_EPSILON && next_distance > CSG_PLANE_EPSILON))
+        {
+            glm::dvec3 point = points[i] + (points[next] - points[i]) * (distance / (distance - next_distance));
+
+            front_points[num_front_points++] = point;
+            back_points[num_back_points++] = point;
+        }
+    }
+
+    ASSERT(num_front_points <= CSG_MAX_FRAGMENT_POINTS && num_back_points <= CSG_MAX_FRAGMENT_POINTS);
+
+    *out_num_front_points = num_front_points;
+    *out_num_back_points = num_back_points;
+
+    return CSG_SIDE_SPLIT;
+}
+
+// Cuts the face of the brush in the plane out of a large square, returns the number of corners or 0 when the plane does
+// not touch the brush
+static uint32_t CSG_BuildBrushFace(const CSG_Brush* brush, uint32_t plane, glm::dvec3* out_points)
+{
+    glm::dvec3 normal = glm::dvec3(brush->planes[plane].normal);
+    double offset = (double)brush->planes[plane].offset;
+
+    glm::dvec3 tangent = (fabs(normal.x) > fabs(normal.z)) ? glm::dvec3(-normal.y, normal.x, 0.0) : glm::dvec3(0.0, -normal.z, normal.y);
+    tangent = glm::normalize(tangent) * CSG_MAX_EXTENT;
+    glm::dvec3 bitangent = glm::normalize(glm::cross(normal, tangent)) * CSG_MAX_EXTENT;
+
+    // Counterclockwise around the normal, like the corners of the faces of a scene
+    glm::dvec3 center = -normal * offset;
+
+    glm::dvec3 points[2][CSG_MAX_FRAGMENT_POINTS];
+    points[0][0] = center - tangent - bitangent;
+    points[0][1] = center + tangent - bitangent;
+    points[0][2] = center + tangent + bitangent;
+    points[0][3] = center - tangent + bitangent;
+
+    uint32_t num_points = 4;
+    uint32_t current = 0;
+
+    glm::dvec3 front_points[CSG_MAX_FRAGMENT_POINTS];
+    uint32_t num_front_points;
+
+    for (uint32_t i = 0; i < brush->num_planes; ++i)
+    {
+        if (i == plane)
+            continue;
+
+        glm::dvec3 clip_normal = glm::dvec3(brush->planes[i].normal);
+        double clip_offset = (double)brush->planes[i].offset;
+
+        uint32_t side = CSG_SplitPolygon(points[current], num_points, clip_normal, clip_offset, front_points, &num_front_points, points[1 - current], &num_points);
+
+        if (side == CSG_SIDE_SPLIT)
+        {
+            current = 1 - current;
+            continue;
+        }
+
+        // Planes that coincide are kept once, the first of them gets the face
+        bool32_t is_hidden_by_plane = (side == CSG_SIDE_ON) && (glm::dot(normal, clip_normal) < 0.0 || i < plane);
+
+        if (side == CSG_SIDE_FRONT || is_hidden_by_plane)
+            return 0;
+    }
+
+    memcpy(out_points, points[current], num_points * sizeof(glm::dvec3));
+
+    return num_points;
+}
+
+// Normalizes the planes into the brush and computes its bounds, returns FALSE when the planes enclose no space
+static bool32_t CSG_SetPlanes(CSG_Brush* brush, const CSG_BrushPlane* planes, uint32_t num_planes)
+{
+    if (num_planes < 4 || num_planes > CSG_MAX_NUM_BRUSH_PLANES)
+        return FALSE;
+
+    CSG_Brush new_brush = *brush;
+    new_brush.num_planes = num_planes;
+
+    for (uint32_t i = 0; i < num_planes; ++i)
+    {
+        float length = glm::length(planes[i].normal);
+
+        if (!(length > 0.0f))
+            return FALSE;
+
+        new_brush.planes[i] = planes[i];
+        new_brush.planes[i].normal = planes[i].normal / length;
+        new_brush.planes[i].offset = planes[i].offset / length;
+    }
+
+    glm::dvec3 bounds_min = glm::dvec3(CSG_MAX_EXTENT);
+    glm::dvec3 bounds_max = glm::dvec3(-CSG_MAX_EXTENT);
+    uint32_t num_faces = 0;
+
+    for (uint32_t i = 0; i < num_planes; ++i)
+    {
+        glm::dvec3 points[CSG_MAX_FRAGMENT_POINTS];
+        uint32_t num_points = CSG_BuildBrushFace(&new_brush, i, points);
+
+        for (uint32_t j = 0; j < num_points; ++j)
+        {
+            bounds_min = glm::min(bounds_min, points[j]);
+            bounds_max = glm::max(bounds_max, points[j]);
+        }
+
+        num_faces += (num_points >= 3);
+    }
+
+    // Brushes that are cut off by the extent would get faces where nothing is
+    glm::dvec3 extent = glm::max(glm::abs(bounds_min), glm::abs(bounds_max));
+
+    if (num_faces < 4 || extent.x >= CSG_MAX_EXTENT || extent.y >= CSG_MAX_EXTENT || extent.z >= CSG_MAX_EXTENT)
+        return FALSE;
+
+    new_brush.bounds_min = glm::vec3(bounds_min);
+    new_brush.bounds_max = glm::vec3(bounds_max);
+
+    *brush = new_brush;
+
+    return TRUE;
+}
+
+static void CSG_AddDirtyRegion(CSG_Map* map, glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    // Regions are merged into one once there are as many as brushes, which then compiles everything in their bounds
+    if (map->num_dirty_regions >= 2 * CSG_MAX_NUM_BRUSHES)
+    {
+        CSG_DirtyRegion* merged_region = map->dirty_regions;
+
+        for (uint32_t i = 1; i < map->num_dirty_regions; ++i)
+        {
+            merged_region->bounds_min = glm::min(merged_region->bounds_min, map->dirty_regions[i].bounds_min);
+            merged_region->bounds_max = glm::max(merged_region->bounds_max, map->dirty_regions[i].bounds_max);
+        }
+
+        map->num_dirty_regions = 1;
+        Arena_Rewind(&map->dirty_arena, sizeof(CSG_DirtyRegion));
+    }
+
+    CSG_DirtyRegion* region = ARENA_ALLOCATE_ARRAY(&map->dirty_arena, CSG_DirtyRegion, 1);
+    ASSERT(region == map->dirty_regions + map->num_dirty_regions);
+
+    region->bounds_min = bounds_min;
+    region->bounds_max = bounds_max;
+
+    ++map->num_dirty_regions;
+}
+
+static bool32_t CSG_DoBoundsOverlap(glm::vec3 a_min, glm::vec3 a_max, glm::vec3 b_min, glm::vec3 b_max)
+{
+    return
+        a_min.x <= b_max.x + CSG_BOUNDS_MARGIN && b_min.x <= a_max.x + CSG_BOUNDS_MARGIN &&
+        a_min.y <= b_max.y + CSG_BOUNDS_MARGIN && b_min.y <= a_max.y + CSG_BOUNDS_MARGIN &&
+        a_min.z <= b_max.z + CSG_BOUNDS_MARGIN && b_min.z <= a_max.z + CSG_BOUNDS_MARGIN;
+}
+
+uint32_t CSG_AddBrush(CSG_Map* map, const CSG_BrushPlane* planes, uint32_t num_planes, uint32_t operation)
+{
+    if (map->num_brushes >= CSG_MAX_NUM_BRUSHES)
+        return SCENE_ID_NONE;
+
+    CSG_Brush* brush = ARENA_ALLOCATE_ARRAY(&map->brush_arena, CSG_Brush, 1);
+    ASSERT(brush == map->brushes + map->num_brushes);
+
+    memset(brush, 0, sizeof(CSG_Brush));
+
+    if (!CSG_SetPlanes(brush, planes, num_planes))
+    {
+        Arena_Rewind(&map->brush_arena, (uint64_t)map->num_brushes * sizeof(CSG_Brush));
+        return SCENE_ID_NONE;
+    }
+
+    brush->operation = operation;
+    brush->is_dirty = TRUE;
+
+    CSG_AddDirtyRegion(map, brush->bounds_min, brush->bounds_max);
+
+    return map->num_brushes++;
+}
+
+uint32_t CSG_AddBoxBrush(CSG_Map* map, glm::vec3 bounds_min, glm::vec3 bounds_max, glm::vec4 color, uint32_t operation)
+{
+    CSG_BrushPlane planes[6] = {
+        { {  1.0f,  0.0f,  0.0f }, -bounds_max.x, color },
+        { { -1.0f,  0.0f,  0.0f },  bounds_min.x, color },
+        { {  0.0f,  1.0f,  0.0f }, -bounds_max.y, color },
+        { {  0.0f, -1.0f,  0.0f },  bounds_min.y, color },
+        { {  0.0f,  0.0f,  1.0f }, -bounds_max.z, color },
+        { {  0.0f,  0.0f, -1.0f },  bounds_min.z, color },
+    };
+
+    return CSG_AddBrush(map, planes, ARRAY_SIZE_U32(planes), operation);
+}
+
+bool32_t CSG_SetBrushPlanes(CSG_Map* map, uint32_t brush_index, const CSG_BrushPlane* planes, uint32_t num_planes)
+{
+    CSG_Brush* brush = map->brushes + brush_index;
+
+    glm::vec3 old_bounds_min = brush->bounds_min;
+    glm::vec3 old_bounds_max = brush->bounds_max;
+
+    if (!CSG_SetPlanes(brush, planes, num_planes))
+        return FALSE;
+
+    // Brushes around the old place lose what the brush covered, the ones around the new place get it
+    CSG_AddDirtyRegion(map, old_bounds_min, old_bounds_max);
+    CSG_AddDirtyRegion(map, brush->bounds_min, brush->bounds_max);
+
+    brush->is_dirty = TRUE;
+
+    return TRUE;
+}
+
+void CSG_MoveBrush(CSG_Map* map, uint32_t brush_index, glm::vec3 offset)
+{
+    const CSG_Brush* brush = map->brushes + brush_index;
+
+    CSG_BrushPlane planes[CSG_MAX_NUM_BRUSH_PLANES];
+
+    for (uint32_t i = 0; i < brush->num_planes; ++i)
+    {
+        planes[i] = brush->planes[i];
+        planes[i].offset -= glm::dot(planes[i].normal, offset);
+    }
+
+    bool32_t set_result = CSG_SetBrushPlanes(map, brush_index, planes, brush->num_planes);
+    ASSERT(set_result == TRUE);
+    UNUSED(set_result);
+}
+
+void CSG_RemoveBrush(CSG_Map* map, uint32_t brush_index)
+{
+    ASSERT(brush_index < map->num_brushes);
+
+    CSG_Brush* brush = map->brushes + brush_index;
+    CSG_AddDirtyRegion(map, brush->bounds_min, brush->bounds_max);
+
+    // The order of the others stays the same, so their polygons stay valid where nothing else changed
+    memmove(brush, brush + 1, (uint64_t)(map->num_brushes - brush_index - 1) * sizeof(CSG_Brush));
+
+    --map->num_brushes;
+    Arena_Rewind(&map->brush_arena, (uint64_t)map->num_brushes * sizeof(CSG_Brush));
+}
+
+// Compiling brushes
+
+// Clips the polygon to the brush, returns FALSE when nothing of it is inside. The pieces cut off on the way go to outside
+// unless that is NULL. The polygon lies in a plane with the given normal, and whether a piece is inside is decided for the
+// point right behind it (side -1) or right in front of it (side 1). That decides polygons in planes of the brush.
+static bool32_t CSG_ClipToBrush(
+    const glm::dvec3* points,
+    uint32_t          num_points,
+    glm::dvec3        polygon_normal,
+    double            side,
+    const CSG_Brush*  brush,
+    CSG_FragmentList* outside,
+    uint32_t          plane,
+    glm::dvec3*       out_points,
+    uint32_t*         out_num_points
+)
+{
+    glm::dvec3 clipped_points[2][CSG_MAX_FRAGMENT_POINTS];
+    memcpy(clipped_points[0], points, num_points * sizeof(glm::dvec3));
+
+    uint32_t current = 0;
+
+    glm::dvec3 front_points[CSG_MAX_FRAGMENT_POINTS];
+    uint32_t num_front_points;
+
+    for (uint32_t i = 0; i < brush->num_planes; ++i)
+    {
+        glm::dvec3 normal = glm::dvec3(brush->planes[i].normal);
+        double offset = (double)brush->planes[i].offset;
+
+        uint32_t plane_side = CSG_SplitPolygon(clipped_points[current], num_points, normal, offset, front_points, &num_front_points, clipped_points[1 - current], &num_points);
+
+        if (plane_side == CSG_SIDE_SPLIT)
+        {
+            if (outside)
+                CSG_FragmentList_Push(outside, front_points, num_front_points, plane);
+
+            current = 1 - current;
+            continue;
+        }
+
+        // NOTE: A polygon in the plane has the point that decides on the side it is moved to along the normal of the polygon
+        if (plane_side == CSG_SIDE_ON)
+            plane_side = ((glm::dot(normal, polygon_normal) > 0.0) == (side > 0.0)) ? CSG_SIDE_FRONT : CSG_SIDE_BACK;
+
+        if (plane_side == CSG_SIDE_FRONT)
+            return FALSE;
+    }
+
+    memcpy(out_points, clipped_points[current], num_points * sizeof(glm::dvec3));
+    *out_num_points = num_points;
+
+    return TRUE;
+}
+
+// Splits the fragment into the pieces outside of the brush, which go to outside, and the piece inside of it, which goes to
+// inside unless that is NULL. Fragments that do not reach into the brush go to outside whole, cutting them along the planes
+// of the brush would only leave more pieces for the brushes after it.
+static void CSG_SplitByBrush(
+    const CSG_FragmentList* list,
+    uint32_t                fragment_index,
+    glm::dvec3              fragment_normal,
+    double                  side,
+    const CSG_Brush*        brush,
+    CSG_FragmentList*       outside,
+    CSG_FragmentList*       inside
+)
+{
+    const CSG_Fragment* fragment = list->fragments + fragment_index;
+    const glm::dvec3* fragment_points = list->points + fragment->first_point;
+
+    glm::dvec3 bounds_min = fragment_points[0];
+    glm::dvec3 bounds_max = fragment_points[0];
+
+    for (uint32_t i = 1; i < fragment->num_points; ++i)
+    {
+        bounds_min = glm::min(bounds_min, fragment_points[i]);
+        bounds_max = glm::max(bounds_max, fragment_points[i]);
+    }
+
+    glm::dvec3 inside_points[CSG_MAX_FRAGMENT_POINTS];
+    uint32_t num_inside_points;
+
+    if (!CSG_DoBoundsOverlap(glm::vec3(bounds_min), glm::vec3(bounds_max), brush->bounds_min, brush->bounds_max) ||
+        !CSG_ClipToBrush(fragment_points, fragment->num_points, fragment_normal, side, brush, NULL, fragment->plane, inside_points, &num_inside_points))
+    {
+        CSG_FragmentList_Push(outside, fragment_points, fragment->num_points, fragment->plane);
+        return;
+    }
+
+    bool32_t clip_result = CSG_ClipToBrush(fragment_points, fragment->num_points, fragment_normal, side, brush, outside, fragment->plane, inside_points, &num_inside_points);
+    ASSERT(clip_result == TRUE);
+    UNUSED(clip_result);
+
+    if (inside)
+        CSG_FragmentList_Push(inside, inside_points, num_inside_points, fragment->plane);
+}
+
+static void CSG_CompileBrush(CSG_Map* map, uint32_t brush_index, CSG_Task* task)
+{
+    const CSG_Brush* brush = map->brushes + brush_index;
+
+    Arena_Reset(&task->brush_index_arena);
+
+    uint32_t* brush_indices = ARENA_ALLOCATE_ARRAY(&task->brush_index_arena, uint32_t, map->num_brushes);
+    ASSERT(brush_indices == task->brush_indices);
+    UNUSED(brush_indices);
+
+    // Only brushes that reach the brush can change its faces
+    uint32_t num_earlier_brushes = 0;
+    uint32_t num_overlapping_brushes = 0;
+
+    for (uint32_t i = 0; i < map->num_brushes; ++i)
+    {
+        const CSG_Brush* other_brush = map->brushes + i;
+
+        if (i == brush_index || !CSG_DoBoundsOverlap(brush->bounds_min, brush->bounds_max, other_brush->bounds_min, other_brush->bounds_max))
+            continue;
+
+        task->brush_indices[num_overlapping_brushes++] = i;
+        num_earlier_brushes += (i < brush_index);
+    }
+
+    CSG_FragmentList* current = task->lists + 0;
+    CSG_FragmentList* next = task->lists + 1;
+
+    CSG_FragmentList_Reset(current);
+
+    for (uint32_t i = 0; i < brush->num_planes; ++i)
+    {
+        glm::dvec3 points[CSG_MAX_FRAGMENT_POINTS];
+        uint32_t num_points = CSG_BuildBrushFace(brush, i, points);
+
+        if (num_points >= 3)
+            CSG_FragmentList_Push(current, points, num_points, i);
+    }
+
+    // Pieces whose inside is in a later brush are decided by that brush, whatever it does there
+    for (uint32_t i = num_earlier_brushes; i < num_overlapping_brushes && current->num_fragments > 0; ++i)
+    {
+        const CSG_Brush* other_brush = map->brushes + task->brush_indices[i];
+
+        CSG_FragmentList_Reset(next);
+
+        for (uint32_t j = 0; j < current->num_fragments; ++j)
+        {
+            glm::dvec3 normal = glm::dvec3(brush->planes[current->fragments[j].plane].normal);
+            CSG_SplitByBrush(current, j, normal, -1.0, other_brush, next, NULL);
+        }
+
+        CSG_FragmentList* swap = current;
+        current = next;
+        next = swap;
+    }
+
+    // The brush decides the inside of the pieces that are left, they are part of the surface where the last brush that
+    // contains their outside does something else
+    CSG_FragmentList* output = &task->output;
+
+    for (uint32_t i = num_overlapping_brushes; i-- > 0 && current->num_fragments > 0; )
+    {
+        const CSG_Brush* other_brush = map->brushes + task->brush_indices[i];
+
+        CSG_FragmentList_Reset(next);
+
+        for (uint32_t j = 0; j < current->num_fragments; ++j)
+        {
+            glm::dvec3 normal = glm::dvec3(brush->planes[current->fragments[j].plane].normal);
+            CSG_SplitByBrush(current, j, normal, 1.0, other_brush, next, (other_brush->operation != brush->operation) ? output : NULL);
+        }
+
+        CSG_FragmentList* swap = current;
+        current = next;
+        next = swap;
+    }
+
+    // Outside of all brushes is empty
+    if (brush->operation == CSG_OPERATION_ADD)
+    {
+        for (uint32_t i = 0; i < current->num_fragments; ++i)
+        {
+            const CSG_Fragment* fragment = current->fragments + i;
+            CSG_FragmentList_Push(output, current->points + fragment->first_point, fragment->num_points, fragment->plane);
+        }
+    }
+}
+
+static void CSG_CompileTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const CSG_CompileBatch* batch = (const CSG_CompileBatch*)user_data;
+
+    // NOTE: The range may span several tasks when it runs on the calling thread, every task uses the memory given by its
+    // first brush either way
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        CSG_Task* task = batch->map->tasks + i / batch->num_brushes_per_task;
+
+        if (i % batch->num_brushes_per_task == 0)
+            CSG_FragmentList_Reset(&task->output);
+
+        batch->first_fragments[i] = task->output.num_fragments;
+        CSG_CompileBrush(batch->map, batch->brush_indices[i], task);
+        batch->num_fragments[i] = task->output.num_fragments - batch->first_fragments[i];
+    }
+}
+
+// Assembling the scene
+
+static int32_t CSG_GetCellCoordinate(float position, float inverse_cell_size)
+{
+    float coordinate = floorf(position * inverse_cell_size);
+
+    if (!(coordinate > (float)-CSG_MAX_CELL_COORDINATE)) return -CSG_MAX_CELL_COORDINATE;
+    if (!(coordinate < (float)CSG_MAX_CELL_COORDINATE)) return CSG_MAX_CELL_COORDINATE;
+
+    return (int32_t)coordinate;
+}
+
+static uint32_t CSG_HashCell(int32_t x, int32_t y, int32_t z)
+{
+    uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+// Returns the slot of the cell or the empty slot where it would go
+static CSG_Cell* CSG_Grid_FindCell(const CSG_Grid* grid, int32_t x, int32_t y, int32_t z)
+{
+    uint32_t mask = grid->capacity - 1;
+
+    for (uint32_t slot = CSG_HashCell(x, y, z) & mask; ; slot = (slot + 1) & mask)
+    {
+        CSG_Cell* cell = grid->cells + slot;
+
+        if (cell->first_vertex == SCENE_ID_NONE || (cell->x == x && cell->y == y && cell->z == z))
+            return cell;
+    }
+}
+
+static void CSG_Grid_Init(CSG_Grid* grid, Arena* arena, uint32_t num_vertices, float cell_size)
+{
+    grid->capacity = CSG_MIN_CELL_CAPACITY;
+    while (grid->capacity < 2 * num_vertices)
+        grid->capacity *= 2;
+
+    grid->cells = ARENA_ALLOCATE_ARRAY(arena, CSG_Cell, grid->capacity);
+    grid->next_vertices = ARENA_ALLOCATE_ARRAY(arena, uint32_t, num_vertices);
+    grid->inverse_cell_size = 1.0f / cell_size;
+
+    ASSERT(grid->cells && (grid->next_vertices || num_vertices == 0));
+
+    memset(grid->cells, 0xFF, (uint64_t)grid->capacity * sizeof(CSG_Cell));
+}
+
+static void CSG_Grid_Insert(CSG_Grid* grid, uint32_t vertex_index, glm::vec3 position)
+{
+    int32_t x = CSG_GetCellCoordinate(position.x, grid->inverse_cell_size);
+    int32_t y = CSG_GetCellCoordinate(position.y, grid->inverse_cell_size);
+    int32_t z = CSG_GetCellCoordinate(position.z, grid->inverse_cell_size);
+
+    CSG_Cell* cell = CSG_Grid_FindCell(grid, x, y, z);
+
+    cell->x = x;
+    cell->y = y;
+    cell->z = z;
+
+    grid->next_vertices[vertex_index] = cell->first_vertex;
+    cell->first_vertex = vertex_index;
+}
+
+// Returns the nearest vertex within the weld distance, SCENE_ID_NONE when there is none
+static uint32_t CSG_Grid_FindNearestVertex(const CSG_Grid* grid, const glm::vec3* positions, glm::vec3 position)
+{
+    int32_t x = CSG_GetCellCoordinate(position.x, grid->inverse_cell_size);
+    int32_t y = CSG_GetCellCoordinate(position.y, grid->inverse_cell_size);
+    int32_t z = CSG_GetCellCoordinate(position.z, grid->inverse_cell_size);
+
+    uint32_t nearest_vertex = SCENE_ID_NONE;
+    float nearest_distance_squared = CSG_WELD_DISTANCE * CSG_WELD_DISTANCE;
+
+    for (int32_t dx = -1; dx <= 1; ++dx)
+    {
+        for (int32_t dy = -1; dy <= 1; ++dy)
+        {
+            for (int32_t dz = -1; dz <= 1; ++dz)
+            {
+                const CSG_Cell* cell = CSG_Grid_FindCell(grid, x + dx, y + dy, z + dz);
+
+                for (uint32_t vertex_index = cell->first_vertex; vertex_index != SCENE_ID_NONE; vertex_index = grid->next_vertices[vertex_index])
+                {
+                    glm::vec3 offset = positions[vertex_index] - position;
+                    float distance_squared = glm::dot(offset, offset);
+
+                    if (distance_squared <= nearest_distance_squared)
+                    {
+                        nearest_vertex = vertex_index;
+                        nearest_distance_squared = distance_squared;
+                    }
+                }
+            }
+        }
+    }
+
+    return nearest_vertex;
+}
+
+struct CSG_EdgeCorner
+{
+    float    t; // Position along the edge
+    uint32_t vertex_index;
+};
+
+// Collects the vertices that lie on the edge between its ends, sorted along the edge. The edge is walked in pieces of at most
+// a cell, only the cells within the weld distance of a piece are searched.
+static uint32_t CSG_FindEdgeCorners(const CSG_Grid* grid, const glm::vec3* positions, uint32_t v0, uint32_t v1, CSG_EdgeCorner* corners)
+{
+    glm::vec3 p0 = positions[v0];
+    glm::vec3 edge = positions[v1] - p0;
+
+    float length_squared = glm::dot(edge, edge);
+    float length = sqrtf(length_squared);
+
+    if (!(length > 2.0f * CSG_WELD_DISTANCE))
+        return 0;
+
+    float cell_size = 1.0f / grid->inverse_cell_size;
+    uint32_t num_steps = (uint32_t)glm::min(ceilf(length / cell_size), (float)CSG_MAX_EDGE_STEPS);
+    uint32_t num_corners = 0;
+
+    for (uint32_t step = 0; step < num_steps; ++step)
+    {
+        glm::vec3 a = p0 + edge * ((float)step / (float)num_steps);
+        glm::vec3 b = p0 + edge * ((float)(step + 1) / (float)num_steps);
+
+        glm::vec3 bounds_min = glm::min(a, b) - glm::vec3(CSG_WELD_DISTANCE);
+        glm::vec3 bounds_max = glm::max(a, b) + glm::vec3(CSG_WELD_DISTANCE);
+
+        int32_t min_x = CSG_GetCellCoordinate(bounds_min.x, grid->inverse_cell_size);
+        int32_t min_y = CSG_GetCellCoordinate(bounds_min.y, grid->inverse_cell_size);
+        int32_t min_z = CSG_GetCellCoordinate(bounds_min.z, grid->inverse_cell_size);
+        int32_t max_x = CSG_GetCellCoordinate(bounds_max.x, grid->inverse_cell_size);
+        int32_t max_y = CSG_GetCellCoordinate(bounds_max.y, grid->inverse_cell_size);
+        int32_t max_z = CSG_GetCellCoordinate(bounds_max.z, grid->inverse_cell_size);
+
+        for (int32_t x = min_x; x <= max_x; ++x)
+        {
+            for (int32_t y = min_y; y <= max_y; ++y)
+            {
+                for (int32_t z = min_z; z <= max_z; ++z)
+                {
+                    const CSG_Cell* cell = CSG_Grid_FindCell(grid, x, y, z);
+
+                    for (uint32_t vertex_index = cell->first_vertex; vertex_index != SCENE_ID_NONE; vertex_index = grid->next_vertices[vertex_index])
+                    {
+                        if (vertex_index == v0 || vertex_index == v1)
+                            continue;
+
+                        glm::vec3 offset = positions[vertex_index] - p0;
+                        float t = glm::dot(offset, edge) / length_squared;
+
+                        // Corners right at the ends would be welded to them
+                        if (t * length <= CSG_WELD_DISTANCE || (1.0f - t) * length <= CSG_WELD_DISTANCE)
+                            continue;
+
+                        glm::vec3 distance = offset - edge * t;
+
+                        if (glm::dot(distance, distance) > CSG_WELD_DISTANCE * CSG_WELD_DISTANCE)
+                            continue;
+
+                        // Neighboring pieces share cells, insertion sort drops the corners that were found already
+                        uint32_t position_index = num_corners;
+                        bool32_t is_known = FALSE;
+
+                        for (uint32_t i = 0; i < num_corners && !is_known; ++i)
+                            is_known = (corners[i].vertex_index == vertex_index);
+
+                        if (is_known || num_corners >= CSG_MAX_EDGE_CORNERS)
+                            continue;
+
+                        while (position_index > 0 && corners[position_index - 1].t > t)
+                        {
+                            corners[position_index] = corners[position_index - 1];
+                            --position_index;
+                        }
+
+                        corners[position_index].t = t;
+                        corners[position_index].vertex_index = vertex_index;
+                        ++num_corners;
+                    }
+                }
+            }
+        }
+    }
+
+    return num_corners;
+}
+
+static void CSG_Assemble(CSG_Map* map, Scene* scene, CSG_CompileStats* stats)
+{
+    const CSG_PolygonStore* store = map->stores + map->current_store;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+
+    uint32_t num_points = store->num_points;
+    uint32_t num_polygons = store->num_polygons;
+
+    glm::vec3* positions        = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec3, num_points);
+    uint32_t* vertex_new_indices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_points);
+
+    CSG_Faces welded_faces = {};
+    welded_faces.first_corners   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_polygons);
+    welded_faces.num_corners     = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_polygons);
+    welded_faces.colors          = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec4, num_polygons);
+    welded_faces.corner_vertices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_points);
+
+    CSG_Faces faces = {};
+    faces.first_corners = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_polygons);
+    faces.num_corners   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_polygons);
+    faces.colors        = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec4, num_polygons);
+
+    ASSERT((positions && vertex_new_indices && welded_faces.corner_vertices) || num_points == 0);
+    ASSERT((welded_faces.first_corners && welded_faces.num_corners && welded_faces.colors) || num_polygons == 0);
+    ASSERT((faces.first_corners && faces.num_corners && faces.colors) || num_polygons == 0);
+
+    uint64_t grid_offset = scratch_arena->offset;
+
+    // Corners are welded to the first vertex within reach, and corners that welding made repeat are dropped
+    uint32_t num_vertices = 0;
+
+    CSG_Grid weld_grid;
+    CSG_Grid_Init(&weld_grid, scratch_arena, num_points, CSG_WELD_DISTANCE);
+
+    for (uint32_t i = 0; i < num_polygons; ++i)
+    {
+        const CSG_Polygon* polygon = store->polygons + i;
+        uint32_t* corner_vertices = welded_faces.corner_vertices + welded_faces.num_total_corners;
+
+        uint32_t num_distinct_corners = 0;
+
+        for (uint32_t j = 0; j < polygon->num_points; ++j)
+        {
+            glm::vec3 position = store->points[polygon->first_point + j];
+            uint32_t vertex_index = CSG_Grid_FindNearestVertex(&weld_grid, positions, position);
+
+            if (vertex_index == SCENE_ID_NONE)
+            {
+                vertex_index = num_vertices++;
+                positions[vertex_index] = position;
+
+                CSG_Grid_Insert(&weld_grid, vertex_index, position);
+            }
+
+            if (num_distinct_corners == 0 || corner_vertices[num_distinct_corners - 1] != vertex_index)
+                corner_vertices[num_distinct_corners++] = vertex_index;
+        }
+
+        while (num_distinct_corners > 1 && corner_vertices[num_distinct_corners - 1] == corner_vertices[0])
+            --num_distinct_corners;
+
+        if (num_distinct_corners < 3)
+            continue;
+
+        welded_faces.first_corners[welded_faces.num_faces] = welded_faces.num_total_corners;
+        welded_faces.num_corners[welded_faces.num_faces]   = num_distinct_corners;
+        welded_faces.colors[welded_faces.num_faces]        = polygon->color;
+
+        ++welded_faces.num_faces;
+        welded_faces.num_total_corners += num_distinct_corners;
+    }
+
+    Arena_Rewind(scratch_arena, grid_offset);
+
+    // Faces meet other faces along parts of their edges wherever brushes overlap, the corners of the neighbors are inserted
+    // into those edges so that every edge has a twin. The cells are about as large as the edges.
+    double total_edge_length = 0.0;
+
+    for (uint32_t i = 0; i < welded_faces.num_faces; ++i)
+    {
+        const uint32_t* corner_vertices = welded_faces.corner_vertices + welded_faces.first_corners[i];
+        uint32_t num_corners = welded_faces.num_corners[i];
+
+        for (uint32_t j = 0; j < num_corners; ++j)
+            total_edge_length += glm::length(positions[corner_vertices[(j + 1) % num_corners]] - positions[corner_vertices[j]]);
+    }
+
+    float cell_size = (welded_faces.num_total_corners > 0) ? (float)(total_edge_length / welded_faces.num_total_corners) : 1.0f;
+    cell_size = glm::max(cell_size, 4.0f * CSG_WELD_DISTANCE);
+
+    CSG_Grid edge_grid;
+    CSG_Grid_Init(&edge_grid, scratch_arena, num_vertices, cell_size);
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+        CSG_Grid_Insert(&edge_grid, i, positions[i]);
+
+    // NOTE: The corners grow at the end of the arena while the faces are walked, nothing else is allocated in between
+    faces.corner_vertices = (uint32_t*)((uint8_t*)scratch_arena->memory + scratch_arena->offset);
+
+    for (uint32_t i = 0; i < welded_faces.num_faces; ++i)
+    {
+        const uint32_t* corner_vertices = welded_faces.corner_vertices + welded_faces.first_corners[i];
+        uint32_t num_corners = welded_faces.num_corners[i];
+
+        faces.first_corners[i] = faces.num_total_corners;
+        faces.colors[i] = welded_faces.colors[i];
+
+        for (uint32_t j = 0; j < num_corners; ++j)
+        {
+            CSG_EdgeCorner edge_corners[CSG_MAX_EDGE_CORNERS];
+
+            uint32_t v0 = corner_vertices[j];
+            uint32_t v1 = corner_vertices[(j + 1) % num_corners];
+            uint32_t num_edge_corners = CSG_FindEdgeCorners(&edge_grid, positions, v0, v1, edge_corners);
+
+            uint32_t* new_corners = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, 1 + num_edge_corners);
+            ASSERT(new_corners == faces.corner_vertices + faces.num_total_corners);
+
+            new_corners[0] = v0;
+
+            for (uint32_t k = 0; k < num_edge_corners; ++k)
+                new_corners[1 + k] = edge_corners[k].vertex_index;
+
+            faces.num_total_corners += 1 + num_edge_corners;
+            stats->num_tjunctions += num_edge_corners;
+        }
+
+        faces.num_corners[i] = faces.num_total_corners - faces.first_corners[i];
+    }
+
+    faces.num_faces = welded_faces.num_faces;
+
+    // Vertices that no face uses anymore are dropped
+    memset(vertex_new_indices, 0xFF, (uint64_t)num_vertices * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < faces.num_total_corners; ++i)
+        vertex_new_indices[faces.corner_vertices[i]] = 0;
+
+    uint32_t new_num_vertices = 0;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (vertex_new_indices[i] != SCENE_ID_NONE)
+        {
+            positions[new_num_vertices] = positions[i];
+            vertex_new_indices[i] = new_num_vertices++;
+        }
+    }
+
+    for (uint32_t i = 0; i < faces.num_total_corners; ++i)
+        faces.corner_vertices[i] = vertex_new_indices[faces.corner_vertices[i]];
+
+    Scene_Clear(scene);
+
+    if (new_num_vertices > 0)
+    {
+        uint32_t first_vertex_index = Scene_AddVertices(scene, positions, new_num_vertices);
+        ASSERT(first_vertex_index == 0);
+        UNUSED(first_vertex_index);
+    }
+
+    if (faces.num_faces > 0)
+    {
+        uint32_t first_face_index = Scene_ConstructFaces(scene, faces.corner_vertices, faces.num_corners, faces.colors, faces.num_faces);
+        ASSERT(first_face_index == 0);
+        UNUSED(first_face_index);
+    }
+
+    Arena_Reset(scratch_arena);
+
+    // Faces were split wherever a brush reached into them, the pieces in a common plane become one face again
+    Scene_Optimize(scene, 0.0f, CSG_MERGE_PLANE_DISTANCE, NULL);
+}
+
+void CSG_Compile(CSG_Map* map, Scene* scene, CSG_CompileStats* out_stats)
+{
+    CSG_CompileStats stats = {};
+    stats.num_brushes = map->num_brushes;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+
+    uint32_t* brush_indices   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, map->num_brushes);
+    uint32_t* first_fragments = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, map->num_brushes);
+    uint32_t* num_fragments   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, map->num_brushes);
+
+    ASSERT((brush_indices && first_fragments && num_fragments) || map->num_brushes == 0);
+
+    // Brushes that changed or overlap a place where something changed
+    uint32_t num_compiled_brushes = 0;
+
+    for (uint32_t i = 0; i < map->num_brushes; ++i)
+    {
+        const CSG_Brush* brush = map->brushes + i;
+        bool32_t is_dirty = brush->is_dirty;
+
+        for (uint32_t j = 0; j < map->num_dirty_regions && !is_dirty; ++j)
+            is_dirty = CSG_DoBoundsOverlap(brush->bounds_min, brush->bounds_max, map->dirty_regions[j].bounds_min, map->dirty_regions[j].bounds_max);
+
+        if (is_dirty)
+            brush_indices[num_compiled_brushes++] = i;
+    }
+
+    stats.num_compiled_brushes = num_compiled_brushes;
+
+    // Every task compiles consecutive brushes with the memory given by its first brush
+    uint32_t num_brushes_per_task = (num_compiled_brushes + CSG_MAX_NUM_TASKS - 1) / CSG_MAX_NUM_TASKS;
+    if (num_brushes_per_task == 0) num_brushes_per_task = 1;
+
+    CSG_CompileBatch batch = { map, brush_indices, first_fragments, num_fragments, num_brushes_per_task };
+    Jobs_ParallelFor(num_compiled_brushes, num_brushes_per_task, CSG_CompileTask, &batch);
+
+    // The new store takes the polygons of the other brushes over from the last one
+    const CSG_PolygonStore* old_store = map->stores + map->current_store;
+    CSG_PolygonStore* store = map->stores + (1 - map->current_store);
+
+    Arena_Reset(&store->polygon_arena);
+    Arena_Reset(&store->point_arena);
+
+    store->num_polygons = 0;
+    store->num_points = 0;
+
+    uint32_t next_compiled_brush = 0;
+
+    for (uint32_t i = 0; i < map->num_brushes; ++i)
+    {
+        CSG_Brush* brush = map->brushes + i;
+        uint32_t first_polygon = store->num_polygons;
+
+        if (next_compiled_brush < num_compiled_brushes && brush_indices[next_compiled_brush] == i)
+        {
+            const CSG_FragmentList* output = &map->tasks[next_compiled_brush / num_brushes_per_task].output;
+
+            for (uint32_t j = 0; j < num_fragments[next_compiled_brush]; ++j)
+            {
+                const CSG_Fragment* fragment = output->fragments + first_fragments[next_compiled_brush] + j;
+                const glm::dvec3* fragment_points = output->points + fragment->first_point;
+
+                glm::vec3* points = CSG_PolygonStore_Push(store, fragment->num_points, brush->planes[fragment->plane].color);
+
+                // Faces of subtracted brushes look into the space they carve out
+                for (uint32_t k = 0; k < fragment->num_points; ++k)
+                {
+                    uint32_t point = (brush->operation == CSG_OPERATION_SUBTRACT) ? fragment->num_points - 1 - k : k;
+                    points[k] = glm::vec3(fragment_points[point]);
+                }
+            }
+
+            brush->is_dirty = FALSE;
+            ++next_compiled_brush;
+        }
+        else
+        {
+            for (uint32_t j = 0; j < brush->num_polygons; ++j)
+            {
+                const CSG_Polygon* polygon = old_store->polygons + brush->first_polygon + j;
+
+                glm::vec3* points = CSG_PolygonStore_Push(store, polygon->num_points, polygon->color);
+                memcpy(points, old_store->points + polygon->first_point, polygon->num_points * sizeof(glm::vec3));
+            }
+        }
+
+        brush->first_polygon = first_polygon;
+        brush->num_polygons = store->num_polygons - first_polygon;
+    }
+
+    map->current_store = 1 - map->current_store;
+
+    map->num_dirty_regions = 0;
+    Arena_Reset(&map->dirty_arena);
+
+    Arena_Reset(scratch_arena);
+
+    stats.num_polygons = store->num_polygons;
+
+    CSG_Assemble(map, scene, &stats);
+
+    stats.num_vertices = scene->num_vertices;
+    stats.num_faces = scene->num_faces;
+
+    if (out_stats)
+        *out_stats = stats;
+}
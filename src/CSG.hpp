@@ -0,0 +1,176 @@
+#ifndef CSG_HPP_
+#define CSG_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+#define CSG_MAX_NUM_BRUSHES ((uint32_t)1 << 16)
+#define CSG_MAX_NUM_BRUSH_PLANES 32
+
+// Brushes have to lie within this distance of the origin, the faces of a brush are cut out of squares this large
+#define CSG_MAX_EXTENT 65536.0
+
+// Polygons of all brushes together
+#define CSG_MAX_NUM_POLYGONS ((uint32_t)1 << 24)
+#define CSG_MAX_NUM_POLYGON_POINTS ((uint32_t)1 << 26)
+
+// Brushes are compiled across the job threads in at most this many tasks, every task splits fragments in memory of its own
+#define CSG_MAX_NUM_TASKS 32
+#define CSG_MAX_NUM_TASK_FRAGMENTS ((uint32_t)1 << 20)
+#define CSG_MAX_NUM_TASK_FRAGMENT_POINTS ((uint32_t)1 << 22)
+
+// Every edge of a fragment lies in a different plane, so fragments never get close to this many corners
+#define CSG_MAX_FRAGMENT_POINTS 256
+
+// Points closer than this to a plane lie in it
+#define CSG_PLANE_EPSILON 0.0005
+
+// Brushes whose bounds are this close are compiled against each other, so that touching faces are found
+#define CSG_BOUNDS_MARGIN 0.01f
+
+// Corners closer than this are welded, and corners this close to an edge of another polygon are inserted into the edge
+#define CSG_WELD_DISTANCE 0.001f
+
+#define CSG_OPERATION_ADD 0
+#define CSG_OPERATION_SUBTRACT 1
+
+// Plane of a brush in the form of Scene_Face, dot(normal, p) + offset = 0, with the normal pointing out of the brush
+struct CSG_BrushPlane
+{
+    glm::vec3 normal;
+    float     offset;
+    glm::vec4 color; // Of the faces that come out of the plane
+};
+
+// Convex brush, the space behind all of its planes
+struct CSG_Brush
+{
+    CSG_BrushPlane planes[CSG_MAX_NUM_BRUSH_PLANES];
+    uint32_t       num_planes;
+    uint32_t       operation;
+
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    // Polygons that the brush adds to the surface, in the store of the last compile
+    uint32_t first_polygon;
+    uint32_t num_polygons;
+
+    bool32_t is_dirty;
+};
+
+struct CSG_Polygon
+{
+    uint32_t  first_point;
+    uint32_t  num_points;
+    glm::vec4 color;
+};
+
+// Polygons of all brushes, every array grows in its own reserved arena
+struct CSG_PolygonStore
+{
+    Arena polygon_arena;
+    Arena point_arena;
+
+    CSG_Polygon* polygons;
+    glm::vec3*   points;
+    uint32_t     num_polygons;
+    uint32_t     num_points;
+};
+
+// Piece of a face of the brush that is compiled, split in double precision
+struct CSG_Fragment
+{
+    uint32_t first_point;
+    uint32_t num_points;
+    uint32_t plane; // Plane of the brush that the fragment lies in
+};
+
+struct CSG_FragmentList
+{
+    Arena fragment_arena;
+    Arena point_arena;
+
+    CSG_Fragment* fragments;
+    glm::dvec3*   points;
+    uint32_t      num_fragments;
+    uint32_t      num_points;
+};
+
+// Memory of a compile task: the fragments are split back and forth between two lists, the ones that are kept go to output
+struct CSG_Task
+{
+    CSG_FragmentList lists[2];
+    CSG_FragmentList output;
+
+    Arena     brush_index_arena;
+    uint32_t* brush_indices; // Brushes that overlap the brush that is compiled
+};
+
+// Bounds of something that changed since the last compile
+struct CSG_DirtyRegion
+{
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+};
+
+// Brushes are applied in order: a point is solid when the last brush that contains it adds, and empty when that brush
+// subtracts or no brush contains it. The surface between solid and empty space is compiled into a scene.
+struct CSG_Map
+{
+    Arena      brush_arena;
+    CSG_Brush* brushes;
+    uint32_t   num_brushes;
+
+    Arena            dirty_arena;
+    CSG_DirtyRegion* dirty_regions;
+    uint32_t         num_dirty_regions;
+
+    // The polygons of the last compile and the ones of the next, which takes the polygons of unchanged brushes over
+    CSG_PolygonStore stores[2];
+    uint32_t         current_store;
+
+    CSG_Task tasks[CSG_MAX_NUM_TASKS];
+};
+
+struct CSG_CompileStats
+{
+    uint32_t num_brushes;
+    uint32_t num_compiled_brushes; // Brushes whose polygons were computed again, the others kept them from the last compile
+    uint32_t num_polygons;         // Polygons of all brushes, before they were welded and merged
+    uint32_t num_tjunctions;       // Corners inserted into the edges of neighboring polygons
+
+    uint32_t num_vertices;
+    uint32_t num_faces;
+};
+
+bool32_t CSG_Map_Init(CSG_Map* map);
+
+void CSG_Map_Destroy(CSG_Map* map);
+
+// Appends a brush, which is applied after all others. The normals are normalized.
+// Returns the index of the new brush or SCENE_ID_NONE when the map is full or the planes enclose no space.
+uint32_t CSG_AddBrush(CSG_Map* map, const CSG_BrushPlane* planes, uint32_t num_planes, uint32_t operation);
+
+// Appends an axis aligned box with the same color on every side
+uint32_t CSG_AddBoxBrush(CSG_Map* map, glm::vec3 bounds_min, glm::vec3 bounds_max, glm::vec4 color, uint32_t operation);
+
+// Returns FALSE when the planes enclose no space, the brush is left alone then
+bool32_t CSG_SetBrushPlanes(CSG_Map* map, uint32_t brush_index, const CSG_BrushPlane* planes, uint32_t num_planes);
+
+void CSG_MoveBrush(CSG_Map* map, uint32_t brush_index, glm::vec3 offset);
+
+// Later brushes move down by one index
+void CSG_RemoveBrush(CSG_Map* map, uint32_t brush_index);
+
+// Computes the polygons of every brush that overlaps something that changed since the last compile, across the job threads,
+// and keeps the polygons of all other brushes. The scene is then rebuilt from the polygons of all brushes: corners are
+// welded, corners on the edges of neighboring polygons are inserted into them, and the polygons in a common plane are
+// merged with Scene_Optimize.
+// NOTE: Every index of the scene changes, so journals have to be cleared afterwards
+void CSG_Compile(CSG_Map* map, Scene* scene, CSG_CompileStats* out_stats);
+
+#endif // !CSG_HPP_
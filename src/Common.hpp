@@ -15,6 +15,26 @@
 #	define FPS_DEBUG_BUILD 1
 #endif
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define FPS_ARCH_X86 1
+#endif
+
+// Allows single functions to use instruction sets that are not enabled for the whole build (MSVC does not need it)
+#if defined(__GNUC__) || defined(__clang__)
+#	define FPS_TARGET_AVX __attribute__((target("avx")))
+#else
+#	define FPS_TARGET_AVX
+#endif
+
+// Inlined helpers are compiled for the instruction set of their caller
+#if defined(__GNUC__) || defined(__clang__)
+#	define FPS_FORCE_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#	define FPS_FORCE_INLINE __forceinline
+#else
+#	define FPS_FORCE_INLINE inline
+#endif
+
 #if FPS_DEBUG_BUILD
 #	define ASSERT(...) assert(__VA_ARGS__)
 #else
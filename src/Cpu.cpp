@@ -0,0 +1,68 @@
+#include "Cpu.hpp"
+
+#if FPS_ARCH_X86
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       include <immintrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#endif
+
+#if FPS_ARCH_X86
+static void Cpu_Query(uint32_t leaf, uint32_t registers[4])
+{
+#if defined(_MSC_VER)
+    int values[4];
+    __cpuid(values, (int)leaf);
+
+    for (uint32_t i = 0; i < 4; ++i)
+        registers[i] = (uint32_t)values[i];
+#else
+    __cpuid(leaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static uint64_t Cpu_GetExtendedControlRegister(void)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+bool32_t Cpu_IsSSE2Supported(void)
+{
+#if FPS_ARCH_X86
+    uint32_t registers[4];
+    Cpu_Query(1, registers);
+
+    return (registers[3] & (1u << 26)) != 0;
+#else
+    return FALSE;
+#endif
+}
+
+bool32_t Cpu_IsAVXSupported(void)
+{
+#if FPS_ARCH_X86
+    uint32_t registers[4];
+    Cpu_Query(1, registers);
+
+    const uint32_t osxsave_bit = 1u << 27;
+    const uint32_t avx_bit = 1u << 28;
+
+    if ((registers[2] & (osxsave_bit | avx_bit)) != (osxsave_bit | avx_bit))
+        return FALSE;
+
+    // Both the XMM and the YMM state have to be enabled by the operating system
+    return (Cpu_GetExtendedControlRegister() & 0x6) == 0x6;
+#else
+    return FALSE;
+#endif
+}
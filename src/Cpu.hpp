@@ -0,0 +1,11 @@
+#ifndef CPU_HPP_
+#define CPU_HPP_
+
+#include "Common.hpp"
+
+bool32_t Cpu_IsSSE2Supported(void);
+
+// NOTE: Also checks that the operating system saves the AVX registers
+bool32_t Cpu_IsAVXSupported(void);
+
+#endif // !CPU_HPP_
@@ -23,6 +23,25 @@ struct SVertex
     glm::uvec3 cell_ids;
 };
 
+// Positions of packed vertices are fixed point numbers with this many steps per unit, split into the chunk of space they are in
+// and their offset inside the chunk. Chunks are 65536 steps wide, and the packed space spans this many chunks along each axis,
+// centered on the origin.
+#define GEOMETRY_PACKED_POSITION_STEPS_PER_UNIT 256.0f
+#define GEOMETRY_PACKED_POSITION_NUM_CHUNKS_PER_AXIS 32
+
+// SVertex in 24 instead of 56 bytes, for large levels
+struct SPackedVertex
+{
+    uint16_t position[3]; // Offset inside the chunk
+    uint16_t chunk;       // Chunk coordinates with 5 bits per axis, x in the lowest bits
+
+    int16_t normal[2];    // Octahedral encoding as signed normalized values
+    uint8_t color[4];     // RGBA as unsigned normalized values
+
+    uint32_t corner_id;
+    uint32_t face_id;
+};
+
 struct PVertex
 {
     glm::vec3 position;
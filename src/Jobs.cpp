@@ -0,0 +1,188 @@
+#include "Jobs.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define JOBS_MAX_NUM_WORKER_THREADS 63
+
+struct Jobs_ParallelForJob
+{
+    Jobs_Function function;
+    void*         user_data;
+    uint32_t      num_items;
+    uint32_t      items_per_task;
+    uint32_t      num_tasks;
+};
+
+struct Jobs_State
+{
+    std::thread workers[JOBS_MAX_NUM_WORKER_THREADS];
+    uint32_t    num_workers;
+
+    // Serializes parallel fors issued by different threads
+    std::mutex submit_mutex;
+
+    std::mutex              mutex;
+    std::condition_variable work_condition;
+    std::condition_variable done_condition;
+
+    Jobs_ParallelForJob job;
+    uint64_t            job_generation;
+    uint32_t            num_active_workers;
+    bool32_t            shutdown;
+
+    std::atomic<uint32_t> next_task;
+};
+
+static Jobs_State Jobs_GlobalState;
+
+static thread_local bool32_t Jobs_IsInsideTask = FALSE;
+
+static void Jobs_RunTasks(const Jobs_ParallelForJob* job)
+{
+    Jobs_State* state = &Jobs_GlobalState;
+
+    for (;;)
+    {
+        uint32_t task_index = state->next_task.fetch_add(1, std::memory_order_relaxed);
+        if (task_index >= job->num_tasks)
+            break;
+
+        uint32_t begin = task_index * job->items_per_task;
+        uint32_t end = begin + job->items_per_task;
+        if (end > job->num_items) end = job->num_items;
+
+        job->function(job->user_data, begin, end);
+    }
+}
+
+static void Jobs_WorkerMain(void)
+{
+    Jobs_State* state = &Jobs_GlobalState;
+
+    Jobs_IsInsideTask = TRUE;
+
+    uint64_t seen_generation = 0;
+
+    for (;;)
+    {
+        Jobs_ParallelForJob job;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->work_condition.wait(lock, [&] { return state->shutdown || state->job_generation != seen_generation; });
+
+            if (state->shutdown)
+                return;
+
+            // The job can only be replaced after every worker that joined it has left again
+            seen_generation = state->job_generation;
+            job = state->job;
+
+            ++state->num_active_workers;
+        }
+
+        Jobs_RunTasks(&job);
+
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+
+            if (--state->num_active_workers == 0)
+                state->done_condition.notify_all();
+        }
+    }
+}
+
+bool32_t Jobs_Init(uint32_t num_worker_threads)
+{
+    Jobs_State* state = &Jobs_GlobalState;
+
+    ASSERT(state->num_workers == 0);
+
+    if (num_worker_threads == 0)
+    {
+        uint32_t num_hardware_threads = std::thread::hardware_concurrency();
+        num_worker_threads = (num_hardware_threads > 1) ? num_hardware_threads - 1 : 0;
+    }
+
+    if (num_worker_threads > JOBS_MAX_NUM_WORKER_THREADS)
+        num_worker_threads = JOBS_MAX_NUM_WORKER_THREADS;
+
+    state->job_generation = 0;
+    state->num_active_workers = 0;
+    state->shutdown = FALSE;
+
+    for (uint32_t i = 0; i < num_worker_threads; ++i)
+        state->workers[i] = std::thread(Jobs_WorkerMain);
+
+    state->num_workers = num_worker_threads;
+
+    return TRUE;
+}
+
+void Jobs_Shutdown(void)
+{
+    Jobs_State* state = &Jobs_GlobalState;
+
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->shutdown = TRUE;
+    }
+
+    state->work_condition.notify_all();
+
+    for (uint32_t i = 0; i < state->num_workers; ++i)
+        state->workers[i].join();
+
+    state->num_workers = 0;
+}
+
+uint32_t Jobs_GetNumThreads(void)
+{
+    return Jobs_GlobalState.num_workers + 1;
+}
+
+void Jobs_ParallelFor(uint32_t num_items, uint32_t items_per_task, Jobs_Function function, void* user_data)
+{
+    Jobs_State* state = &Jobs_GlobalState;
+
+    ASSERT(items_per_task > 0);
+
+    if (num_items == 0)
+        return;
+
+    if (state->num_workers == 0 || Jobs_IsInsideTask || num_items <= items_per_task)
+    {
+        function(user_data, 0, num_items);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(state->submit_mutex);
+
+    Jobs_ParallelForJob job;
+    job.function = function;
+    job.user_data = user_data;
+    job.num_items = num_items;
+    job.items_per_task = items_per_task;
+    job.num_tasks = (num_items + items_per_task - 1) / items_per_task;
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done_condition.wait(lock, [&] { return state->num_active_workers == 0; });
+
+        state->job = job;
+        state->next_task.store(0, std::memory_order_relaxed);
+        ++state->job_generation;
+    }
+
+    state->work_condition.notify_all();
+
+    Jobs_IsInsideTask = TRUE;
+    Jobs_RunTasks(&job);
+    Jobs_IsInsideTask = FALSE;
+
+    // Every task has been handed out at this point, wait for the workers that are still running theirs
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done_condition.wait(lock, [&] { return state->num_active_workers == 0; });
+}
@@ -0,0 +1,22 @@
+#ifndef JOBS_HPP_
+#define JOBS_HPP_
+
+#include "Common.hpp"
+
+// Processes the items [begin, end) of a parallel for
+typedef void (*Jobs_Function)(void* user_data, uint32_t begin, uint32_t end);
+
+// Starts the worker threads, passing 0 uses one thread per hardware thread (the calling thread included)
+bool32_t Jobs_Init(uint32_t num_worker_threads);
+
+void Jobs_Shutdown(void);
+
+// Number of threads that take part in a parallel for, the calling thread included
+uint32_t Jobs_GetNumThreads(void);
+
+// Splits the items into tasks of items_per_task items and runs them on the workers and the calling thread,
+// returns after all of them are done.
+// NOTE: Runs everything on the calling thread when there are no workers or when called from inside a task
+void Jobs_ParallelFor(uint32_t num_items, uint32_t items_per_task, Jobs_Function function, void* user_data);
+
+#endif // !JOBS_HPP_
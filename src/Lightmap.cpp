@@ -0,0 +1,1027 @@
+#include "Lightmap.hpp"
+#include "Jobs.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define LIGHTMAP_NUM_TEXELS ((uint64_t)LIGHTMAP_ATLAS_SIZE * LIGHTMAP_ATLAS_SIZE)
+#define LIGHTMAP_NUM_TILE_TEXELS (LIGHTMAP_TILE_SIZE * LIGHTMAP_TILE_SIZE)
+
+#define LIGHTMAP_ARENA_CAPACITY (LIGHTMAP_NUM_TEXELS * (2 * sizeof(uint32_t) + sizeof(glm::vec4) + sizeof(glm::vec3)) + LIGHTMAP_NUM_TILES * sizeof(bool32_t) + 5 * ARENA_COMMIT_GRANULARITY)
+
+// Samples start this far in front of their face, so that their rays do not hit the face again
+#define LIGHTMAP_RAY_OFFSET 1e-3f
+
+// Regions around more edited faces than this are merged into one
+#define LIGHTMAP_MAX_NUM_DIRTY_REGIONS 256
+
+struct Lightmap_Batch
+{
+    Lightmap*    lightmap;
+    const Scene* scene;
+
+    const uint32_t* tiles;
+    float           max_ray_length;
+
+    // Every tile has LIGHTMAP_NUM_RAYS_PER_TEXEL rays per texel, the sun rays of all its texels first, so that packets of
+    // them travel together
+    Scene_Ray*    rays;
+    Scene_RayHit* hits;
+
+    uint32_t* tile_num_rays;
+    uint32_t* tile_num_samples;
+    bool32_t* tile_pending_flags;
+};
+
+bool32_t Lightmap_Init(Lightmap* lightmap, const Lightmap_Settings* settings)
+{
+    memset(lightmap, 0, sizeof(Lightmap));
+
+    if (!Arena_CreateReserved(&lightmap->chart_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(Lightmap_Chart)) ||
+        !Arena_CreateReserved(&lightmap->chart_plane_arena, (uint64_t)SCENE_MAX_NUM_FACES * 2 * sizeof(glm::vec4)) ||
+        !Arena_CreateReserved(&lightmap->arena, LIGHTMAP_ARENA_CAPACITY) ||
+        !Scene_FaceTracker_Init(&lightmap->face_tracker))
+    {
+        Lightmap_Destroy(lightmap);
+        return FALSE;
+    }
+
+    lightmap->settings = *settings;
+    lightmap->texel_size = settings->texel_size;
+
+    lightmap->charts = (Lightmap_Chart*)lightmap->chart_arena.memory;
+    lightmap->chart_planes = (glm::vec4*)lightmap->chart_plane_arena.memory;
+
+    lightmap->needs_rebuild = TRUE;
+
+    return TRUE;
+}
+
+void Lightmap_Destroy(Lightmap* lightmap)
+{
+    Scene_FaceTracker_Destroy(&lightmap->face_tracker);
+    Arena_Destroy(&lightmap->arena);
+    Arena_Destroy(&lightmap->chart_plane_arena);
+    Arena_Destroy(&lightmap->chart_arena);
+
+    memset(lightmap, 0, sizeof(Lightmap));
+}
+
+void Lightmap_Invalidate(Lightmap* lightmap)
+{
+    lightmap->needs_rebuild = TRUE;
+}
+
+void Lightmap_ClearDirty(Lightmap* lightmap)
+{
+    lightmap->dirty_row_begin = 0;
+    lightmap->dirty_row_end = 0;
+    lightmap->dirty_face_begin = 0;
+    lightmap->dirty_face_end = 0;
+}
+
+static void Lightmap_MarkRowsDirty(Lightmap* lightmap, uint32_t row_begin, uint32_t row_end)
+{
+    if (lightmap->dirty_row_begin == lightmap->dirty_row_end)
+    {
+        lightmap->dirty_row_begin = row_begin;
+        lightmap->dirty_row_end = row_end;
+        return;
+    }
+
+    lightmap->dirty_row_begin = glm::min(lightmap->dirty_row_begin, row_begin);
+    lightmap->dirty_row_end = glm::max(lightmap->dirty_row_end, row_end);
+}
+
+static void Lightmap_MarkFacesDirty(Lightmap* lightmap, uint32_t face_begin, uint32_t face_end)
+{
+    if (lightmap->dirty_face_begin == lightmap->dirty_face_end)
+    {
+        lightmap->dirty_face_begin = face_begin;
+        lightmap->dirty_face_end = face_end;
+        return;
+    }
+
+    lightmap->dirty_face_begin = glm::min(lightmap->dirty_face_begin, face_begin);
+    lightmap->dirty_face_end = glm::max(lightmap->dirty_face_end, face_end);
+}
+
+// Small hash based generator, every texel starts from its index and sample count so the result does not depend on the threads
+static uint32_t Lightmap_NextRandom(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+    return x;
+}
+
+static float Lightmap_NextRandomFloat(uint32_t* state)
+{
+    return (float)(Lightmap_NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+static uint32_t Lightmap_MixHash(uint32_t hash, uint32_t value)
+{
+    hash = (hash ^ value) * 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+static uint32_t Lightmap_EncodeColor(glm::vec3 value)
+{
+    glm::vec3 scaled = glm::clamp(value * (255.0f / LIGHTMAP_MAX_VALUE), 0.0f, 255.0f) + 0.5f;
+
+    return (uint32_t)scaled.x | ((uint32_t)scaled.y << 8) | ((uint32_t)scaled.z << 16) | 0xFF000000u;
+}
+
+// Projects the face onto its plane and sizes the chart for it, the chart is not placed in the atlas yet
+static void Lightmap_MakeChart(const Lightmap* lightmap, const Scene* scene, uint32_t face_index, Lightmap_Chart* out_chart)
+{
+    memset(out_chart, 0, sizeof(Lightmap_Chart));
+
+    const Scene_Face* face = scene->faces + face_index;
+    glm::vec3 normal = face->normal;
+
+    // Deleted faces have a zero normal and degenerate ones a NaN normal, neither gets a chart
+    if (Scene_Face_IsDeleted(scene, face_index) || !(glm::dot(normal, normal) > 0.5f))
+        return;
+
+    // The texel rows run along the world axis that is closest to lying in the plane
+    glm::vec3 helper = (fabsf(normal.y) < 0.9f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 axis_u = glm::normalize(glm::cross(helper, normal));
+    glm::vec3 axis_v = glm::cross(normal, axis_u);
+
+    glm::vec3 base = scene->vertices[scene->half_edges[face->first_half_edge].origin_vertex].position;
+
+    glm::vec2 extent_min( FLT_MAX);
+    glm::vec2 extent_max(-FLT_MAX);
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    do
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+        glm::vec3 corner = scene->vertices[half_edge->origin_vertex].position - base;
+
+        glm::vec2 projected = { glm::dot(corner, axis_u), glm::dot(corner, axis_v) };
+        extent_min = glm::min(extent_min, projected);
+        extent_max = glm::max(extent_max, projected);
+
+        half_edge_index = half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
+
+    glm::vec2 extent = extent_max - extent_min;
+
+    const uint32_t max_num_inner_texels = LIGHTMAP_MAX_CHART_SIZE - 2 * LIGHTMAP_CHART_PADDING;
+    float texel_size = glm::max(lightmap->texel_size, glm::max(extent.x, extent.y) / (float)max_num_inner_texels);
+
+    uint32_t num_inner_texels_u = glm::clamp((uint32_t)ceilf(extent.x / texel_size), 1u, max_num_inner_texels);
+    uint32_t num_inner_texels_v = glm::clamp((uint32_t)ceilf(extent.y / texel_size), 1u, max_num_inner_texels);
+
+    out_chart->origin = base + extent_min.x * axis_u + extent_min.y * axis_v;
+    out_chart->axis_u = axis_u;
+    out_chart->axis_v = axis_v;
+    out_chart->normal = normal;
+    out_chart->texel_size = texel_size;
+
+    Scene_Face_GetBounds(scene, face_index, &out_chart->bounds_min, &out_chart->bounds_max);
+
+    out_chart->width = (uint16_t)(num_inner_texels_u + 2 * LIGHTMAP_CHART_PADDING);
+    out_chart->height = (uint16_t)(num_inner_texels_v + 2 * LIGHTMAP_CHART_PADDING);
+}
+
+static void Lightmap_UpdateChartPlanes(Lightmap* lightmap, uint32_t face_index)
+{
+    const Lightmap_Chart* chart = lightmap->charts + face_index;
+    glm::vec4* planes = lightmap->chart_planes + 2 * (uint64_t)face_index;
+
+    if (chart->width == 0)
+    {
+        planes[0] = glm::vec4(0.0f);
+        planes[1] = glm::vec4(0.0f);
+    }
+    else
+    {
+        float inverse_texel_size = 1.0f / chart->texel_size;
+
+        glm::vec3 scaled_axis_u = chart->axis_u * inverse_texel_size;
+        glm::vec3 scaled_axis_v = chart->axis_v * inverse_texel_size;
+
+        planes[0] = glm::vec4(scaled_axis_u, (float)(chart->x + LIGHTMAP_CHART_PADDING) - glm::dot(chart->origin, scaled_axis_u));
+        planes[1] = glm::vec4(scaled_axis_v, (float)(chart->y + LIGHTMAP_CHART_PADDING) - glm::dot(chart->origin, scaled_axis_v));
+    }
+
+    Lightmap_MarkFacesDirty(lightmap, face_index, face_index + 1);
+}
+
+static bool32_t Lightmap_AllocateRect(Lightmap* lightmap, uint32_t width, uint32_t height, uint16_t* out_x, uint16_t* out_y)
+{
+    if (lightmap->shelf_x + width > LIGHTMAP_ATLAS_SIZE)
+    {
+        lightmap->shelf_x = 0;
+        lightmap->shelf_y += lightmap->shelf_height;
+        lightmap->shelf_height = 0;
+    }
+
+    if (lightmap->shelf_y + height > LIGHTMAP_ATLAS_SIZE)
+        return FALSE;
+
+    *out_x = (uint16_t)lightmap->shelf_x;
+    *out_y = (uint16_t)lightmap->shelf_y;
+
+    lightmap->shelf_x += width;
+    lightmap->shelf_height = glm::max(lightmap->shelf_height, height);
+
+    return TRUE;
+}
+
+// Gives the texels of the rectangle that belong to from_face_index to to_face_index
+static void Lightmap_SetRectFaces(Lightmap* lightmap, const Lightmap_Chart* chart, uint32_t from_face_index, uint32_t to_face_index)
+{
+    for (uint32_t y = chart->y; y < (uint32_t)chart->y + chart->height; ++y)
+    {
+        uint32_t* texel_faces = lightmap->texel_faces + (uint64_t)y * LIGHTMAP_ATLAS_SIZE;
+
+        for (uint32_t x = chart->x; x < (uint32_t)chart->x + chart->width; ++x)
+        {
+            if (texel_faces[x] == from_face_index)
+                texel_faces[x] = to_face_index;
+        }
+    }
+}
+
+// Drops the samples of the chart so that it is baked again. Charts in a new place also drop the light they show, they
+// are shown unlit until their first sample.
+// Returns the number of texels that were reset.
+static uint32_t Lightmap_ResetChart(Lightmap* lightmap, uint32_t face_index, bool32_t is_moved)
+{
+    const Lightmap_Chart* chart = lightmap->charts + face_index;
+
+    uint32_t unlit_color = Lightmap_EncodeColor(glm::vec3(1.0f));
+    uint32_t num_reset_texels = 0;
+
+    for (uint32_t y = chart->y; y < (uint32_t)chart->y + chart->height; ++y)
+    {
+        uint64_t row_offset = (uint64_t)y * LIGHTMAP_ATLAS_SIZE;
+
+        for (uint32_t x = chart->x; x < (uint32_t)chart->x + chart->width; ++x)
+        {
+            uint64_t texel_index = row_offset + x;
+
+            if (lightmap->texel_faces[texel_index] != face_index)
+                continue;
+
+            lightmap->texel_sums[texel_index] = glm::vec4(0.0f);
+            ++num_reset_texels;
+
+            if (is_moved)
+            {
+                lightmap->texel_values[texel_index] = glm::vec3(0.0f);
+                lightmap->texel_colors[texel_index] = unlit_color;
+            }
+        }
+    }
+
+    if (is_moved)
+        Lightmap_MarkRowsDirty(lightmap, chart->y, chart->y + chart->height);
+
+    for (uint32_t tile_y = chart->y / LIGHTMAP_TILE_SIZE; tile_y <= (chart->y + chart->height - 1u) / LIGHTMAP_TILE_SIZE; ++tile_y)
+    {
+        for (uint32_t tile_x = chart->x / LIGHTMAP_TILE_SIZE; tile_x <= (chart->x + chart->width - 1u) / LIGHTMAP_TILE_SIZE; ++tile_x)
+        {
+            uint32_t tile_index = tile_y * LIGHTMAP_NUM_TILES_PER_SIDE + tile_x;
+
+            if (!lightmap->tile_pending_flags[tile_index])
+            {
+                lightmap->tile_pending_flags[tile_index] = TRUE;
+                ++lightmap->num_pending_tiles;
+            }
+        }
+    }
+
+    return num_reset_texels;
+}
+
+static void Lightmap_ResizeCharts(Lightmap* lightmap, uint32_t num_faces)
+{
+    if (num_faces < lightmap->num_faces)
+    {
+        Arena_Rewind(&lightmap->chart_arena, (uint64_t)num_faces * sizeof(Lightmap_Chart));
+        Arena_Rewind(&lightmap->chart_plane_arena, (uint64_t)num_faces * 2 * sizeof(glm::vec4));
+    }
+    else if (num_faces > lightmap->num_faces)
+    {
+        uint32_t num_added_faces = num_faces - lightmap->num_faces;
+
+        Lightmap_Chart* charts = ARENA_ALLOCATE_ARRAY(&lightmap->chart_arena, Lightmap_Chart, num_added_faces);
+        glm::vec4* chart_planes = ARENA_ALLOCATE_ARRAY(&lightmap->chart_plane_arena, glm::vec4, 2 * (uint64_t)num_added_faces);
+
+        ASSERT(charts == lightmap->charts + lightmap->num_faces && chart_planes == lightmap->chart_planes + 2 * (uint64_t)lightmap->num_faces);
+
+        memset(charts, 0, (uint64_t)num_added_faces * sizeof(Lightmap_Chart));
+        memset(chart_planes, 0, (uint64_t)num_added_faces * 2 * sizeof(glm::vec4));
+    }
+
+    lightmap->num_faces = num_faces;
+}
+
+// Charts every face and packs all of them, tallest first, growing the texels until they fit
+static bool32_t Lightmap_Rebuild(Lightmap* lightmap, Scene* scene, Lightmap_UpdateStats* stats)
+{
+    if (!lightmap->texel_faces)
+    {
+        lightmap->texel_faces = ARENA_ALLOCATE_ARRAY(&lightmap->arena, uint32_t, LIGHTMAP_NUM_TEXELS);
+        lightmap->texel_sums = ARENA_ALLOCATE_ARRAY(&lightmap->arena, glm::vec4, LIGHTMAP_NUM_TEXELS);
+        lightmap->texel_values = ARENA_ALLOCATE_ARRAY(&lightmap->arena, glm::vec3, LIGHTMAP_NUM_TEXELS);
+        lightmap->texel_colors = ARENA_ALLOCATE_ARRAY(&lightmap->arena, uint32_t, LIGHTMAP_NUM_TEXELS);
+        lightmap->tile_pending_flags = ARENA_ALLOCATE_ARRAY(&lightmap->arena, bool32_t, LIGHTMAP_NUM_TILES);
+
+        ASSERT(lightmap->texel_faces && lightmap->texel_sums && lightmap->texel_values && lightmap->texel_colors && lightmap->tile_pending_flags);
+    }
+
+    Lightmap_ResizeCharts(lightmap, scene->num_faces);
+
+    uint32_t num_faces = scene->num_faces;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t* sorted_face_indices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+
+    ASSERT(sorted_face_indices || num_faces == 0);
+
+    lightmap->texel_size = lightmap->settings.texel_size;
+
+    bool32_t pack_result = FALSE;
+
+    for (;;)
+    {
+        uint32_t num_charts_per_height[LIGHTMAP_MAX_CHART_SIZE + 1] = {};
+        uint32_t max_height = 0;
+
+        for (uint32_t i = 0; i < num_faces; ++i)
+        {
+            Lightmap_MakeChart(lightmap, scene, i, lightmap->charts + i);
+
+            ++num_charts_per_height[lightmap->charts[i].height];
+            max_height = glm::max(max_height, (uint32_t)lightmap->charts[i].height);
+        }
+
+        // Counting sort by height, tallest first, faces of the same height stay in order
+        uint32_t first_sorted_per_height[LIGHTMAP_MAX_CHART_SIZE + 1];
+        uint32_t num_sorted = 0;
+
+        for (uint32_t height = LIGHTMAP_MAX_CHART_SIZE + 1; height-- > 0; )
+        {
+            first_sorted_per_height[height] = num_sorted;
+            num_sorted += num_charts_per_height[height];
+        }
+
+        for (uint32_t i = 0; i < num_faces; ++i)
+            sorted_face_indices[first_sorted_per_height[lightmap->charts[i].height]++] = i;
+
+        lightmap->shelf_x = 0;
+        lightmap->shelf_y = 0;
+        lightmap->shelf_height = 0;
+
+        pack_result = TRUE;
+
+        for (uint32_t i = 0; i < num_faces && pack_result; ++i)
+        {
+            Lightmap_Chart* chart = lightmap->charts + sorted_face_indices[i];
+
+            if (chart->width != 0)
+                pack_result = Lightmap_AllocateRect(lightmap, chart->width, chart->height, &chart->x, &chart->y);
+        }
+
+        // Charts of a single texel can not get any smaller
+        if (pack_result || max_height <= 1 + 2 * LIGHTMAP_CHART_PADDING)
+            break;
+
+        lightmap->texel_size *= 1.25f;
+    }
+
+    if (!pack_result)
+    {
+        for (uint32_t i = 0; i < num_faces; ++i)
+            memset(lightmap->charts + i, 0, sizeof(Lightmap_Chart));
+
+        lightmap->shelf_x = 0;
+        lightmap->shelf_y = 0;
+        lightmap->shelf_height = 0;
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    // Texels, every chart starts unlit
+
+    memset(lightmap->texel_faces, 0xFF, LIGHTMAP_NUM_TEXELS * sizeof(uint32_t));
+    memset(lightmap->tile_pending_flags, 0, LIGHTMAP_NUM_TILES * sizeof(bool32_t));
+    lightmap->num_pending_tiles = 0;
+    lightmap->next_tile = 0;
+
+    lightmap->bounds_min = glm::vec3( FLT_MAX);
+    lightmap->bounds_max = glm::vec3(-FLT_MAX);
+
+    uint32_t num_charts = 0;
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        const Lightmap_Chart* chart = lightmap->charts + i;
+
+        if (chart->width != 0)
+        {
+            Lightmap_SetRectFaces(lightmap, chart, SCENE_ID_NONE, i);
+            stats->num_reset_texels += Lightmap_ResetChart(lightmap, i, TRUE);
+
+            lightmap->bounds_min = glm::min(lightmap->bounds_min, chart->bounds_min);
+            lightmap->bounds_max = glm::max(lightmap->bounds_max, chart->bounds_max);
+
+            ++num_charts;
+        }
+
+        Lightmap_UpdateChartPlanes(lightmap, i);
+    }
+
+    lightmap->needs_rebuild = !pack_result;
+
+    stats->was_rebuilt = TRUE;
+    stats->num_new_charts = num_charts;
+    stats->num_reset_charts = num_charts;
+
+    return pack_result;
+}
+
+static bool32_t Lightmap_AreBoundsOverlapping(glm::vec3 a_min, glm::vec3 a_max, glm::vec3 b_min, glm::vec3 b_max)
+{
+    return a_min.x <= b_max.x && a_min.y <= b_max.y && a_min.z <= b_max.z &&
+           b_min.x <= a_max.x && b_min.y <= a_max.y && b_min.z <= a_max.z;
+}
+
+// Gives new charts to the changed faces and drops the samples of the charts around them. Faces that only moved to another
+// index, like the ones renumbered by a compile or a reorder, take their chart along with its light.
+// Returns FALSE when a new chart does not fit into the free space of the atlas.
+static bool32_t Lightmap_UpdateChangedFaces(Lightmap* lightmap, Scene* scene, const Scene_FaceChange* changes, uint32_t num_changes, Lightmap_UpdateStats* stats)
+{
+    if (num_changes == 0)
+        return TRUE;
+
+    uint32_t old_num_faces = lightmap->num_faces;
+    uint32_t num_faces = scene->num_faces;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    Lightmap_Chart* old_charts = ARENA_ALLOCATE_ARRAY(scratch_arena, Lightmap_Chart, num_changes);
+    glm::vec3* regions = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec3, 4 * (uint64_t)num_changes);
+
+    ASSERT(old_charts && regions);
+
+    // The old charts leave their texels, the ones of faces that only moved move back in below
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        uint32_t face_index = changes[i].face_index;
+
+        if (face_index < old_num_faces)
+            old_charts[i] = lightmap->charts[face_index];
+        else
+            memset(old_charts + i, 0, sizeof(Lightmap_Chart));
+
+        if (old_charts[i].width != 0)
+            Lightmap_SetRectFaces(lightmap, old_charts + i, face_index, SCENE_ID_NONE);
+    }
+
+    Lightmap_ResizeCharts(lightmap, num_faces);
+
+    uint32_t num_regions = 0;
+    bool32_t update_result = TRUE;
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        uint32_t face_index = changes[i].face_index;
+        uint32_t matched_change = changes[i].matched_change;
+
+        if (face_index >= num_faces)
+            continue;
+
+        Lightmap_Chart* chart = lightmap->charts + face_index;
+        memset(chart, 0, sizeof(Lightmap_Chart));
+
+        if (matched_change != SCENE_ID_NONE)
+        {
+            *chart = old_charts[matched_change];
+            Lightmap_SetRectFaces(lightmap, chart, SCENE_ID_NONE, face_index);
+
+            ++stats->num_moved_charts;
+        }
+
+        Lightmap_UpdateChartPlanes(lightmap, face_index);
+    }
+
+    // Old charts that no face took belonged to faces that changed or are gone
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        if (old_charts[i].width != 0 && !changes[i].is_old_face_taken)
+        {
+            regions[2 * num_regions + 0] = old_charts[i].bounds_min;
+            regions[2 * num_regions + 1] = old_charts[i].bounds_max;
+            ++num_regions;
+        }
+    }
+
+    // Every other face gets a new chart
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        uint32_t face_index = changes[i].face_index;
+
+        if (face_index >= num_faces || changes[i].signature == 0 || changes[i].matched_change != SCENE_ID_NONE)
+            continue;
+
+        Lightmap_Chart* chart = lightmap->charts + face_index;
+        Lightmap_MakeChart(lightmap, scene, face_index, chart);
+
+        ++stats->num_new_charts;
+
+        if (chart->width != 0)
+        {
+            regions[2 * num_regions + 0] = chart->bounds_min;
+            regions[2 * num_regions + 1] = chart->bounds_max;
+            ++num_regions;
+
+            // Charts that fit where the old chart of their face was stay there, the others go after the last chart
+            const Lightmap_Chart* old_chart = old_charts + i;
+
+            if (!changes[i].is_old_face_taken && old_chart->width != 0 && chart->width <= old_chart->width && chart->height <= old_chart->height)
+            {
+                chart->x = old_chart->x;
+                chart->y = old_chart->y;
+            }
+            else if (!Lightmap_AllocateRect(lightmap, chart->width, chart->height, &chart->x, &chart->y))
+            {
+                update_result = FALSE;
+                break;
+            }
+
+            Lightmap_SetRectFaces(lightmap, chart, SCENE_ID_NONE, face_index);
+            Lightmap_ResetChart(lightmap, face_index, TRUE);
+
+            lightmap->bounds_min = glm::min(lightmap->bounds_min, chart->bounds_min);
+            lightmap->bounds_max = glm::max(lightmap->bounds_max, chart->bounds_max);
+        }
+
+        Lightmap_UpdateChartPlanes(lightmap, face_index);
+    }
+
+    if (update_result && num_regions > 0)
+    {
+        // Light reaches influence_distance past the regions, and the shadows they cast reach until they leave the scene
+        glm::vec3 sun_direction = lightmap->settings.sun_direction;
+        glm::vec3 extent = lightmap->bounds_max - lightmap->bounds_min;
+
+        float shadow_length = FLT_MAX;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            if (sun_direction[axis] != 0.0f)
+                shadow_length = glm::min(shadow_length, extent[axis] / fabsf(sun_direction[axis]));
+        }
+
+        glm::vec3 shadow_offset = sun_direction * shadow_length;
+
+        if (num_regions > LIGHTMAP_MAX_NUM_DIRTY_REGIONS)
+        {
+            for (uint32_t i = 1; i < num_regions; ++i)
+            {
+                regions[0] = glm::min(regions[0], regions[2 * i + 0]);
+                regions[1] = glm::max(regions[1], regions[2 * i + 1]);
+            }
+
+            num_regions = 1;
+        }
+
+        for (uint32_t i = 0; i < num_regions; ++i)
+        {
+            glm::vec3 region_min = glm::min(regions[2 * i + 0], regions[2 * i + 0] + shadow_offset);
+            glm::vec3 region_max = glm::max(regions[2 * i + 1], regions[2 * i + 1] + shadow_offset);
+
+            regions[2 * i + 0] = region_min - glm::vec3(lightmap->settings.influence_distance);
+            regions[2 * i + 1] = region_max + glm::vec3(lightmap->settings.influence_distance);
+        }
+
+        for (uint32_t i = 0; i < num_faces; ++i)
+        {
+            const Lightmap_Chart* chart = lightmap->charts + i;
+
+            if (chart->width == 0)
+                continue;
+
+            for (uint32_t j = 0; j < num_regions; ++j)
+            {
+                if (Lightmap_AreBoundsOverlapping(chart->bounds_min, chart->bounds_max, regions[2 * j + 0], regions[2 * j + 1]))
+                {
+                    ++stats->num_reset_charts;
+                    stats->num_reset_texels += Lightmap_ResetChart(lightmap, i, FALSE);
+                    break;
+                }
+            }
+        }
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    return update_result;
+}
+
+bool32_t Lightmap_Update(Lightmap* lightmap, Scene* scene, Lightmap_UpdateStats* out_stats)
+{
+    Lightmap_UpdateStats stats;
+    memset(&stats, 0, sizeof(Lightmap_UpdateStats));
+
+    Scene_UpdateFacePlanes(scene);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t num_changes;
+    Scene_FaceChange* changes = Scene_FaceTracker_Update(&lightmap->face_tracker, scene, &num_changes);
+
+    // Without free space left everything is packed again
+    bool32_t update_result = FALSE;
+
+    if (!lightmap->needs_rebuild)
+        update_result = Lightmap_UpdateChangedFaces(lightmap, scene, changes, num_changes, &stats);
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    if (!update_result)
+    {
+        memset(&stats, 0, sizeof(Lightmap_UpdateStats));
+        update_result = Lightmap_Rebuild(lightmap, scene, &stats);
+    }
+
+    for (uint32_t i = 0; i < lightmap->num_faces; ++i)
+        stats.num_charts += (lightmap->charts[i].width != 0);
+
+    stats.texel_size = lightmap->texel_size;
+    stats.num_used_rows = glm::min(lightmap->shelf_y + lightmap->shelf_height, (uint32_t)LIGHTMAP_ATLAS_SIZE);
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return update_result;
+}
+
+// Moves the point to the nearest point of the outline of the polygon when it is outside of the polygon
+static glm::vec2 Lightmap_ClampToPolygon(const glm::vec2* corners, uint32_t num_corners, glm::vec2 point)
+{
+    bool32_t is_inside = FALSE;
+
+    glm::vec2 nearest_point = point;
+    float min_distance_squared = FLT_MAX;
+
+    for (uint32_t i = 0, j = num_corners - 1; i < num_corners; j = i++)
+    {
+        glm::vec2 a = corners[j];
+        glm::vec2 b = corners[i];
+
+        if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+            is_inside = !is_inside;
+
+        glm::vec2 edge = b - a;
+        float edge_length_squared = glm::dot(edge, edge);
+        float t = (edge_length_squared > 0.0f) ? glm::clamp(glm::dot(point - a, edge) / edge_length_squared, 0.0f, 1.0f) : 0.0f;
+
+        glm::vec2 edge_point = a + t * edge;
+        float distance_squared = glm::dot(point - edge_point, point - edge_point);
+
+        if (distance_squared < min_distance_squared)
+        {
+            min_distance_squared = distance_squared;
+            nearest_point = edge_point;
+        }
+    }
+
+    return is_inside ? point : nearest_point;
+}
+
+static bool32_t Lightmap_NeedsSample(const Lightmap* lightmap, uint64_t texel_index)
+{
+    return lightmap->texel_faces[texel_index] != SCENE_ID_NONE && lightmap->texel_sums[texel_index].w < (float)lightmap->settings.num_samples;
+}
+
+static void Lightmap_GenerateRaysTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Lightmap_Batch* batch = (const Lightmap_Batch*)user_data;
+    const Lightmap* lightmap = batch->lightmap;
+    const Scene* scene = batch->scene;
+
+    glm::vec3 light_direction = -lightmap->settings.sun_direction;
+
+    // Corners of the face the last texel belonged to, in its chart, no corners when it has too many of them
+    glm::vec2 corners[LIGHTMAP_MAX_CLAMPED_CORNERS];
+    uint32_t num_corners = 0;
+    uint32_t corners_face_index = SCENE_ID_NONE;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t tile_index = batch->tiles[i];
+        uint32_t tile_x = (tile_index % LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+        uint32_t tile_y = (tile_index / LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+
+        Scene_Ray* sun_rays = batch->rays + (uint64_t)i * LIGHTMAP_NUM_TILE_TEXELS * LIGHTMAP_NUM_RAYS_PER_TEXEL;
+        Scene_Ray* bounce_rays = sun_rays + LIGHTMAP_NUM_TILE_TEXELS;
+
+        for (uint32_t j = 0; j < LIGHTMAP_NUM_TILE_TEXELS; ++j)
+        {
+            uint32_t x = tile_x + j % LIGHTMAP_TILE_SIZE;
+            uint32_t y = tile_y + j / LIGHTMAP_TILE_SIZE;
+            uint64_t texel_index = (uint64_t)y * LIGHTMAP_ATLAS_SIZE + x;
+
+            // Rays of texels that need no sample are empty, they end where they start
+            Scene_Ray empty_ray = { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f), 0.0f };
+            sun_rays[j] = empty_ray;
+            bounce_rays[j] = empty_ray;
+
+            if (!Lightmap_NeedsSample(lightmap, texel_index))
+                continue;
+
+            uint32_t face_index = lightmap->texel_faces[texel_index];
+            const Lightmap_Chart* chart = lightmap->charts + face_index;
+
+            if (face_index != corners_face_index)
+            {
+                const Scene_Face* face = scene->faces + face_index;
+
+                corners_face_index = face_index;
+                num_corners = 0;
+
+                if (face->num_half_edges <= LIGHTMAP_MAX_CLAMPED_CORNERS)
+                {
+                    uint32_t half_edge_index = face->first_half_edge;
+
+                    do
+                    {
+                        const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+                        glm::vec3 corner = scene->vertices[half_edge->origin_vertex].position - chart->origin;
+
+                        corners[num_corners++] = { glm::dot(corner, chart->axis_u), glm::dot(corner, chart->axis_v) };
+
+                        half_edge_index = half_edge->next_half_edge;
+                    }
+                    while (half_edge_index != face->first_half_edge);
+                }
+            }
+
+            uint32_t random_state = Lightmap_MixHash((uint32_t)texel_index * 0x9E3779B9u, (uint32_t)lightmap->texel_sums[texel_index].w);
+            random_state = random_state ? random_state : 1;
+
+            // Samples are spread over the texel, and the ones of texels outside of the face are taken on its outline
+            glm::vec2 point = {
+                ((float)(x - chart->x) - (float)LIGHTMAP_CHART_PADDING + Lightmap_NextRandomFloat(&random_state)) * chart->texel_size,
+                ((float)(y - chart->y) - (float)LIGHTMAP_CHART_PADDING + Lightmap_NextRandomFloat(&random_state)) * chart->texel_size,
+            };
+
+            if (num_corners >= 3)
+                point = Lightmap_ClampToPolygon(corners, num_corners, point);
+
+            glm::vec3 position = chart->origin + point.x * chart->axis_u + point.y * chart->axis_v + chart->normal * LIGHTMAP_RAY_OFFSET;
+
+            if (glm::dot(chart->normal, light_direction) > 0.0f)
+            {
+                sun_rays[j].origin = position;
+                sun_rays[j].direction = light_direction;
+                sun_rays[j].max_length = batch->max_ray_length;
+            }
+
+            // Cosine weighted, so that the average of the light the rays bring in is the light falling onto the texel
+            float random_radius_squared = Lightmap_NextRandomFloat(&random_state);
+            float radius = sqrtf(random_radius_squared);
+            float phi = 6.28318530718f * Lightmap_NextRandomFloat(&random_state);
+
+            glm::vec3 direction = radius * cosf(phi) * chart->axis_u + radius * sinf(phi) * chart->axis_v +
+                sqrtf(glm::max(0.0f, 1.0f - random_radius_squared)) * chart->normal;
+
+            bounce_rays[j].origin = position;
+            bounce_rays[j].direction = glm::normalize(direction);
+            bounce_rays[j].max_length = batch->max_ray_length;
+        }
+    }
+}
+
+// Light leaving the hit point of a ray towards where it came from
+static glm::vec3 Lightmap_GetBouncedLight(const Lightmap* lightmap, const Scene* scene, const Scene_Ray* ray, const Scene_RayHit* hit)
+{
+    if (hit->index == SCENE_ID_NONE)
+        return lightmap->settings.sky_color;
+
+    ASSERT(hit->index < lightmap->num_faces);
+
+    const Scene_Face* face = scene->faces + hit->index;
+    const Lightmap_Chart* chart = lightmap->charts + hit->index;
+
+    // Backs of faces are inside of the geometry
+    if (chart->width == 0 || glm::dot(ray->direction, face->normal) >= 0.0f)
+        return glm::vec3(0.0f);
+
+    const glm::vec4* planes = lightmap->chart_planes + 2 * (uint64_t)hit->index;
+    glm::vec4 intersection = glm::vec4(hit->intersection, 1.0f);
+
+    float u = glm::clamp(glm::dot(planes[0], intersection), (float)chart->x, (float)(chart->x + chart->width) - 1.0f);
+    float v = glm::clamp(glm::dot(planes[1], intersection), (float)chart->y, (float)(chart->y + chart->height) - 1.0f);
+
+    uint64_t texel_index = (uint64_t)v * LIGHTMAP_ATLAS_SIZE + (uint64_t)u;
+
+    return lightmap->settings.bounce_albedo * glm::vec3(face->color) * lightmap->texel_values[texel_index];
+}
+
+static void Lightmap_ShadeTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Lightmap_Batch* batch = (const Lightmap_Batch*)user_data;
+    Lightmap* lightmap = batch->lightmap;
+    const Scene* scene = batch->scene;
+
+    glm::vec3 light_direction = -lightmap->settings.sun_direction;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t tile_index = batch->tiles[i];
+        uint32_t tile_x = (tile_index % LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+        uint32_t tile_y = (tile_index / LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+
+        uint64_t first_ray = (uint64_t)i * LIGHTMAP_NUM_TILE_TEXELS * LIGHTMAP_NUM_RAYS_PER_TEXEL;
+
+        const Scene_Ray* sun_rays = batch->rays + first_ray;
+        const Scene_Ray* bounce_rays = sun_rays + LIGHTMAP_NUM_TILE_TEXELS;
+        const Scene_RayHit* sun_hits = batch->hits + first_ray;
+        const Scene_RayHit* bounce_hits = sun_hits + LIGHTMAP_NUM_TILE_TEXELS;
+
+        uint32_t num_rays = 0;
+        uint32_t num_samples = 0;
+        bool32_t is_pending = FALSE;
+
+        for (uint32_t j = 0; j < LIGHTMAP_NUM_TILE_TEXELS; ++j)
+        {
+            uint32_t x = tile_x + j % LIGHTMAP_TILE_SIZE;
+            uint32_t y = tile_y + j / LIGHTMAP_TILE_SIZE;
+            uint64_t texel_index = (uint64_t)y * LIGHTMAP_ATLAS_SIZE + x;
+
+            if (!Lightmap_NeedsSample(lightmap, texel_index))
+                continue;
+
+            glm::vec3 light = Lightmap_GetBouncedLight(lightmap, scene, bounce_rays + j, bounce_hits + j);
+            ++num_rays;
+
+            if (sun_rays[j].max_length > 0.0f)
+            {
+                if (sun_hits[j].index == SCENE_ID_NONE)
+                    light += lightmap->settings.sun_color * glm::dot(lightmap->charts[lightmap->texel_faces[texel_index]].normal, light_direction);
+
+                ++num_rays;
+            }
+
+            lightmap->texel_sums[texel_index] += glm::vec4(light, 1.0f);
+            ++num_samples;
+
+            is_pending |= Lightmap_NeedsSample(lightmap, texel_index);
+        }
+
+        batch->tile_num_rays[i] = num_rays;
+        batch->tile_num_samples[i] = num_samples;
+        batch->tile_pending_flags[i] = is_pending;
+    }
+}
+
+// Runs after all tiles of the batch are shaded, the values are read by the bounces of other tiles until then
+static void Lightmap_ResolveTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Lightmap_Batch* batch = (const Lightmap_Batch*)user_data;
+    Lightmap* lightmap = batch->lightmap;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t tile_index = batch->tiles[i];
+        uint32_t tile_x = (tile_index % LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+        uint32_t tile_y = (tile_index / LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+
+        for (uint32_t y = tile_y; y < tile_y + LIGHTMAP_TILE_SIZE; ++y)
+        {
+            for (uint32_t x = tile_x; x < tile_x + LIGHTMAP_TILE_SIZE; ++x)
+            {
+                uint64_t texel_index = (uint64_t)y * LIGHTMAP_ATLAS_SIZE + x;
+                glm::vec4 sum = lightmap->texel_sums[texel_index];
+
+                if (lightmap->texel_faces[texel_index] == SCENE_ID_NONE || sum.w == 0.0f)
+                    continue;
+
+                glm::vec3 value = glm::vec3(sum) / sum.w;
+
+                lightmap->texel_values[texel_index] = value;
+                lightmap->texel_colors[texel_index] = Lightmap_EncodeColor(value);
+            }
+        }
+    }
+}
+
+uint32_t Lightmap_Bake(Lightmap* lightmap, Scene* scene, uint32_t max_num_tiles, Lightmap_BakeStats* out_stats)
+{
+    Lightmap_BakeStats stats;
+    memset(&stats, 0, sizeof(Lightmap_BakeStats));
+
+    uint32_t num_tiles = glm::min(max_num_tiles, lightmap->num_pending_tiles);
+
+    if (num_tiles == 0)
+    {
+        stats.num_pending_tiles = lightmap->num_pending_tiles;
+
+        if (out_stats)
+            *out_stats = stats;
+
+        return lightmap->num_pending_tiles;
+    }
+
+    // NOTE: The hits are looked up in the charts, which have to belong to the faces the rays can hit
+    ASSERT(scene->num_faces == lightmap->num_faces);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t* tiles = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_tiles);
+
+    Lightmap_Batch batch;
+    batch.lightmap = lightmap;
+    batch.scene = scene;
+    batch.max_ray_length = 2.0f * glm::length(lightmap->bounds_max - lightmap->bounds_min) + 1.0f;
+
+    uint64_t num_batch_rays = (uint64_t)LIGHTMAP_NUM_TILES_PER_BATCH * LIGHTMAP_NUM_TILE_TEXELS * LIGHTMAP_NUM_RAYS_PER_TEXEL;
+
+    batch.rays               = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_Ray, num_batch_rays);
+    batch.hits               = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_RayHit, num_batch_rays);
+    batch.tile_num_rays      = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, LIGHTMAP_NUM_TILES_PER_BATCH);
+    batch.tile_num_samples   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, LIGHTMAP_NUM_TILES_PER_BATCH);
+    batch.tile_pending_flags = ARENA_ALLOCATE_ARRAY(scratch_arena, bool32_t, LIGHTMAP_NUM_TILES_PER_BATCH);
+
+    ASSERT(tiles && batch.rays && batch.hits && batch.tile_num_rays && batch.tile_num_samples && batch.tile_pending_flags);
+
+    // Pending tiles round-robin, so that every part of the atlas gets its next sample before any part gets two more
+    uint32_t num_collected_tiles = 0;
+    uint32_t first_tile_index = lightmap->next_tile;
+
+    for (uint32_t i = 0; i < LIGHTMAP_NUM_TILES && num_collected_tiles < num_tiles; ++i)
+    {
+        uint32_t tile_index = (first_tile_index + i) % LIGHTMAP_NUM_TILES;
+
+        if (lightmap->tile_pending_flags[tile_index])
+        {
+            tiles[num_collected_tiles++] = tile_index;
+            lightmap->next_tile = (tile_index + 1) % LIGHTMAP_NUM_TILES;
+        }
+    }
+
+    ASSERT(num_collected_tiles == num_tiles);
+
+    for (uint32_t first_tile = 0; first_tile < num_tiles; first_tile += LIGHTMAP_NUM_TILES_PER_BATCH)
+    {
+        uint32_t num_batch_tiles = glm::min(num_tiles - first_tile, (uint32_t)LIGHTMAP_NUM_TILES_PER_BATCH);
+
+        batch.tiles = tiles + first_tile;
+
+        Jobs_ParallelFor(num_batch_tiles, 1, Lightmap_GenerateRaysTask, &batch);
+        Scene_RayCast_FindNearestIntersectingFaces(scene, batch.rays, num_batch_tiles * LIGHTMAP_NUM_TILE_TEXELS * LIGHTMAP_NUM_RAYS_PER_TEXEL, batch.hits);
+        Jobs_ParallelFor(num_batch_tiles, 1, Lightmap_ShadeTask, &batch);
+        Jobs_ParallelFor(num_batch_tiles, 1, Lightmap_ResolveTask, &batch);
+
+        for (uint32_t i = 0; i < num_batch_tiles; ++i)
+        {
+            uint32_t tile_index = batch.tiles[i];
+
+            if (!batch.tile_pending_flags[i])
+            {
+                lightmap->tile_pending_flags[tile_index] = FALSE;
+                --lightmap->num_pending_tiles;
+            }
+
+            uint32_t tile_y = (tile_index / LIGHTMAP_NUM_TILES_PER_SIDE) * LIGHTMAP_TILE_SIZE;
+            Lightmap_MarkRowsDirty(lightmap, tile_y, tile_y + LIGHTMAP_TILE_SIZE);
+
+            stats.num_rays += batch.tile_num_rays[i];
+            stats.num_texel_samples += batch.tile_num_samples[i];
+        }
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    stats.num_tiles = num_tiles;
+    stats.num_pending_tiles = lightmap->num_pending_tiles;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return lightmap->num_pending_tiles;
+}
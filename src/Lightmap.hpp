@@ -0,0 +1,170 @@
+#ifndef LIGHTMAP_HPP_
+#define LIGHTMAP_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+// Width and height of the atlas in texels
+#define LIGHTMAP_ATLAS_SIZE 1024
+
+// The atlas is baked in square tiles of this many texels per side, every tile is one task
+#define LIGHTMAP_TILE_SIZE 16
+#define LIGHTMAP_NUM_TILES_PER_SIDE (LIGHTMAP_ATLAS_SIZE / LIGHTMAP_TILE_SIZE)
+#define LIGHTMAP_NUM_TILES (LIGHTMAP_NUM_TILES_PER_SIDE * LIGHTMAP_NUM_TILES_PER_SIDE)
+
+// Rays of this many tiles are cast in one batch across the job threads
+#define LIGHTMAP_NUM_TILES_PER_BATCH 64
+
+// Every texel casts a ray towards the sun and one that gathers the light bouncing in from the hemisphere
+#define LIGHTMAP_NUM_RAYS_PER_TEXEL 2
+
+// Charts get a border of texels around the face, so that filtering never reads the texels of another chart
+#define LIGHTMAP_CHART_PADDING 1
+
+// Charts of large faces get larger texels instead of growing beyond this many texels per side, the padding included
+#define LIGHTMAP_MAX_CHART_SIZE 64
+
+// Faces with more corners are not clamped to, their texels outside of the face are sampled where they are
+#define LIGHTMAP_MAX_CLAMPED_CORNERS 64
+
+// Texel colors store the light divided by this, so that surfaces can be lit brighter than their color
+#define LIGHTMAP_MAX_VALUE 2.0f
+
+struct Lightmap_Settings
+{
+    float    texel_size;  // World units per texel, grows when the charts do not fit into the atlas
+    uint32_t num_samples; // Per texel, baking stops once every texel has that many
+
+    glm::vec3 sun_direction; // Direction the light travels in, must be a unit vector
+    glm::vec3 sun_color;
+    glm::vec3 sky_color;
+
+    // Scales the face colors for the light they pass on, below one so that the bounces converge
+    float bounce_albedo;
+
+    // Edits re-bake the charts this close to the edited faces, and the ones in the shadow the faces cast or used to cast.
+    // NOTE: Light that bounces in from farther away stays as it was baked until Lightmap_Invalidate
+    float influence_distance;
+};
+
+// Planar projection of a face into its rectangle of the atlas
+struct Lightmap_Chart
+{
+    // World position of the corner of the texel after the padding, and unit axes along the texel rows and columns
+    glm::vec3 origin;
+    glm::vec3 axis_u;
+    glm::vec3 axis_v;
+    glm::vec3 normal;
+    float     texel_size;
+
+    // Of the face when the chart was made
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    // Rectangle of the atlas with the padding, width is 0 for faces without a chart
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+};
+
+// Baked lighting for every face of a scene, with the faces packed into one atlas as a chart each. Baking is progressive:
+// every call adds a sample to the texels of some tiles, the light that bounces off other faces is read from what they
+// have baked so far, so every round over the atlas adds a bounce.
+struct Lightmap
+{
+    Lightmap_Settings settings;
+    float             texel_size;
+
+    // One chart per face, grown in place as faces are added
+    Arena           chart_arena;
+    Lightmap_Chart* charts;
+
+    // Two planes per face that map world positions on the face to texels of the atlas, zero for faces without a chart
+    Arena      chart_plane_arena;
+    glm::vec4* chart_planes;
+
+    uint32_t num_faces;
+
+    // Faces as they were charted, to find the ones that changed
+    Scene_FaceTracker face_tracker;
+
+    // Shelves are filled from the left, the last one grows as higher charts are added to it
+    uint32_t shelf_x;
+    uint32_t shelf_y;
+    uint32_t shelf_height;
+
+    // Holds the texel and tile arrays, allocated with the first build
+    Arena arena;
+
+    uint32_t*  texel_faces;  // SCENE_ID_NONE for texels outside of every chart
+    glm::vec4* texel_sums;   // Light summed over the samples, w counts them
+    glm::vec3* texel_values; // Average of the samples, what bounces read
+    uint32_t*  texel_colors; // RGBA8 of the values divided by LIGHTMAP_MAX_VALUE, for the texture
+
+    // Tiles with texels that need more samples, baked round-robin starting at next_tile
+    bool32_t* tile_pending_flags;
+    uint32_t  num_pending_tiles;
+    uint32_t  next_tile;
+
+    // Rays are long enough to cross the scene
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    // Texel rows and chart planes changed since the last Lightmap_ClearDirty
+    uint32_t dirty_row_begin;
+    uint32_t dirty_row_end;
+    uint32_t dirty_face_begin;
+    uint32_t dirty_face_end;
+
+    // Set until the first build and by Lightmap_Invalidate, the faces alone can not tell that
+    bool32_t needs_rebuild;
+};
+
+struct Lightmap_UpdateStats
+{
+    bool32_t was_rebuilt;
+    float    texel_size;
+
+    uint32_t num_charts;
+    uint32_t num_new_charts;   // Made for faces that were added or changed
+    uint32_t num_moved_charts; // Taken along by faces that moved to another index without changing
+    uint32_t num_reset_charts; // Charts that are baked again, the new ones included
+    uint64_t num_reset_texels; // Of those charts
+    uint32_t num_used_rows;    // Of the atlas
+};
+
+struct Lightmap_BakeStats
+{
+    uint32_t num_tiles;
+    uint64_t num_texel_samples;
+    uint64_t num_rays;
+    uint32_t num_pending_tiles; // Left after the call
+};
+
+bool32_t Lightmap_Init(Lightmap* lightmap, const Lightmap_Settings* settings);
+
+void Lightmap_Destroy(Lightmap* lightmap);
+
+// Makes the next Lightmap_Update pack every chart again and bake everything from scratch
+void Lightmap_Invalidate(Lightmap* lightmap);
+
+// Finds the faces that changed since the last update and gives them new charts, packing them into free space of the atlas
+// or repacking everything when there is none. The charts of changed faces and the ones they may cast light or shadow on
+// are baked again. Faces are recognized by their corners and color (see Scene_FaceTracker_Update), so faces that only got
+// another index keep their light.
+// Returns FALSE when the charts do not fit into the atlas even with the largest texels, nothing is baked then.
+bool32_t Lightmap_Update(Lightmap* lightmap, Scene* scene, Lightmap_UpdateStats* out_stats);
+
+// Adds a sample to every texel that needs one in up to max_num_tiles pending tiles, casting the rays across the job threads.
+// NOTE: The faces of the scene have to be the ones of the last Lightmap_Update
+// Returns the number of tiles that still need samples.
+uint32_t Lightmap_Bake(Lightmap* lightmap, Scene* scene, uint32_t max_num_tiles, Lightmap_BakeStats* out_stats);
+
+// Marks every texel row and chart plane as uploaded
+void Lightmap_ClearDirty(Lightmap* lightmap);
+
+#endif // !LIGHTMAP_HPP_
@@ -0,0 +1,2007 @@
+#include "NavMesh.hpp"
+#include "Jobs.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define NAVMESH_TILE_ARENA_CAPACITY ((uint64_t)NAVMESH_MAX_NUM_TILES * (sizeof(NavMesh_Tile) + NAVMESH_NUM_TILE_CELLS * sizeof(uint16_t)) + 2 * ARENA_COMMIT_GRANULARITY)
+
+// Every span has at most one link per side
+#define NAVMESH_MAX_NUM_LINKS ((uint64_t)NAVMESH_MAX_NUM_SPANS * 4)
+
+#define NAVMESH_PATH_CACHE_NUM_ENTRIES (NAVMESH_PATH_CACHE_NUM_SETS * NAVMESH_PATH_CACHE_NUM_WAYS)
+#define NAVMESH_CACHE_ARENA_CAPACITY ((uint64_t)NAVMESH_PATH_CACHE_NUM_ENTRIES * (sizeof(NavMesh_PathCacheEntry) + NAVMESH_MAX_CORRIDOR_LENGTH * sizeof(uint32_t)) + 2 * ARENA_COMMIT_GRANULARITY)
+
+// Every query needs less than 256 bytes besides the corridor of its search and its points and portals
+#define NAVMESH_QUERY_ARENA_CAPACITY \
+    ((uint64_t)NAVMESH_MAX_NUM_QUERIES * (256 + NAVMESH_MAX_CORRIDOR_LENGTH * sizeof(uint32_t) + 3 * (NAVMESH_MAX_CORRIDOR_LENGTH + 1) * sizeof(glm::vec3)) + \
+     16 * ARENA_COMMIT_GRANULARITY)
+
+// Six arrays with an entry per polygon, see NavMesh_SearchState
+#define NAVMESH_SEARCH_STATE_CAPACITY ((uint64_t)NAVMESH_MAX_NUM_SPANS * 6 * sizeof(uint32_t) + 6 * 64)
+
+// Searches are split into this many tasks per thread, every task with its own search state
+#define NAVMESH_NUM_SEARCH_TASKS_PER_THREAD 2
+
+#define NAVMESH_NUM_QUERIES_PER_TASK 64
+
+// Clearance rays start this far above their span, so that they do not hit the face the span is on
+#define NAVMESH_RAY_OFFSET 1e-3f
+
+// Samples of a cell closer than this are the same surface, like the shared edge of two faces
+#define NAVMESH_SPAN_MERGE_DISTANCE 0.01f
+
+// Erosion reaches at most this many cells into the neighboring tiles
+#define NAVMESH_MAX_BORDER_SIZE 16
+
+#define NAVMESH_NO_SPAN ((uint32_t)-1)
+#define NAVMESH_NO_LAYER 0xFF
+#define NAVMESH_NO_POLYGON 0xFFFF
+
+// Directions to the neighboring cells: -x, +z, +x, -z
+static const int32_t NavMesh_DirectionX[4] = { -1, 0, 1, 0 };
+static const int32_t NavMesh_DirectionZ[4] = { 0, 1, 0, -1 };
+
+// A tile with a border of cells around it, so that erosion and the connections at its edges see the cells of its neighbors
+struct NavMesh_TileBuild
+{
+    uint32_t tile_index;
+
+    const uint32_t* face_indices; // Walkable faces that reach into the tile or its border
+    uint32_t        num_faces;
+
+    // NAVMESH_MAX_NUM_LAYERS spans per cell, ordered by height
+    uint8_t*  cell_num_spans;
+    float*    span_heights;
+    uint8_t*  span_neighbors; // Layer of the connected span in the neighboring cell in every direction, NAVMESH_NO_LAYER for none
+    uint16_t* span_distances; // To the nearest span with a missing neighbor, 2 per cell and 3 per diagonal
+    uint16_t* span_polygons;
+
+    glm::vec2* corners; // Of the face that is rasterized, projected onto the ground
+
+    uint32_t first_ray;
+    uint32_t num_rays;
+
+    // Of the cells of the tile without the border
+    NavMesh_Span*    spans;
+    uint16_t*        cell_first_spans;
+    NavMesh_Polygon* polygons;
+    uint32_t         num_spans;
+    uint32_t         num_polygons;
+};
+
+struct NavMesh_Batch
+{
+    const NavMesh* navmesh;
+    const Scene*   scene;
+
+    NavMesh_TileBuild* builds;
+
+    uint32_t border_size;
+    uint32_t build_size;   // Cells per side of a tile with its border
+    uint16_t min_distance; // Spans closer to a missing neighbor are eroded
+
+    // One clearance ray per span, in the order of the builds and their spans
+    Scene_Ray*    rays;
+    Scene_RayHit* hits;
+};
+
+struct NavMesh_Search
+{
+    uint32_t  start_polygon;
+    uint32_t  goal_polygon;
+    uint32_t* corridor;
+    uint32_t  num_polygons; // 0 when there is no path
+    uint32_t  num_expanded_polygons;
+};
+
+// Slot of the table that finds the search of a pair of polygons among the queries of a batch
+struct NavMesh_SearchSlot
+{
+    uint32_t start_polygon; // SCENE_ID_NONE for empty slots
+    uint32_t goal_polygon;
+    uint32_t search_index;
+};
+
+struct NavMesh_QueryBatch
+{
+    const NavMesh*       navmesh;
+    const NavMesh_Query* queries;
+    NavMesh_Path*        paths;
+
+    glm::vec3* start_points;
+    glm::vec3* goal_points;
+    uint32_t*  start_polygons;
+    uint32_t*  goal_polygons;
+
+    // Corridor of every query, from the cache or from its search
+    const uint32_t** corridors;
+    uint32_t*        corridor_lengths;
+
+    NavMesh_Search*      searches;
+    NavMesh_SearchState* search_states;
+    uint32_t             num_searches_per_task;
+
+    // Every query has as many portals as it has room for points
+    glm::vec3* portal_lefts;
+    glm::vec3* portal_rights;
+    glm::vec3* points;
+};
+
+bool32_t NavMesh_Init(NavMesh* navmesh, const NavMesh_Settings* settings)
+{
+    memset(navmesh, 0, sizeof(NavMesh));
+
+    ASSERT(settings->cell_size > 0.0f);
+
+    uint32_t num_search_states = Jobs_GetNumThreads() * NAVMESH_NUM_SEARCH_TASKS_PER_THREAD;
+
+    if (!Scene_FaceTracker_Init(&navmesh->face_tracker) ||
+        !Arena_CreateReserved(&navmesh->tile_arena, NAVMESH_TILE_ARENA_CAPACITY) ||
+        !Arena_CreateReserved(&navmesh->span_arenas[0], (uint64_t)NAVMESH_MAX_NUM_SPANS * sizeof(NavMesh_Span)) ||
+        !Arena_CreateReserved(&navmesh->span_arenas[1], (uint64_t)NAVMESH_MAX_NUM_SPANS * sizeof(NavMesh_Span)) ||
+        !Arena_CreateReserved(&navmesh->polygon_arenas[0], (uint64_t)NAVMESH_MAX_NUM_SPANS * sizeof(NavMesh_Polygon)) ||
+        !Arena_CreateReserved(&navmesh->polygon_arenas[1], (uint64_t)NAVMESH_MAX_NUM_SPANS * sizeof(NavMesh_Polygon)) ||
+        !Arena_CreateReserved(&navmesh->link_arenas[0], NAVMESH_MAX_NUM_LINKS * sizeof(NavMesh_Link)) ||
+        !Arena_CreateReserved(&navmesh->link_arenas[1], NAVMESH_MAX_NUM_LINKS * sizeof(NavMesh_Link)) ||
+        !Arena_CreateReserved(&navmesh->cache_arena, NAVMESH_CACHE_ARENA_CAPACITY) ||
+        !Arena_CreateReserved(&navmesh->query_arena, NAVMESH_QUERY_ARENA_CAPACITY) ||
+        !Arena_CreateReserved(&navmesh->search_arena, num_search_states * (sizeof(NavMesh_SearchState) + NAVMESH_SEARCH_STATE_CAPACITY)))
+    {
+        NavMesh_Destroy(navmesh);
+        return FALSE;
+    }
+
+    navmesh->settings = *settings;
+
+    navmesh->cache_entries = ARENA_ALLOCATE_ARRAY(&navmesh->cache_arena, NavMesh_PathCacheEntry, NAVMESH_PATH_CACHE_NUM_ENTRIES);
+    navmesh->cache_polygons = ARENA_ALLOCATE_ARRAY(&navmesh->cache_arena, uint32_t, (uint64_t)NAVMESH_PATH_CACHE_NUM_ENTRIES * NAVMESH_MAX_CORRIDOR_LENGTH);
+
+    // The states get their arrays with the first search
+    navmesh->search_states = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, NavMesh_SearchState, num_search_states);
+    navmesh->num_search_states = num_search_states;
+
+    ASSERT(navmesh->cache_entries && navmesh->cache_polygons && navmesh->search_states);
+
+    memset(navmesh->search_states, 0, num_search_states * sizeof(NavMesh_SearchState));
+
+    for (uint32_t i = 0; i < NAVMESH_PATH_CACHE_NUM_ENTRIES; ++i)
+        navmesh->cache_entries[i].start_polygon = SCENE_ID_NONE;
+
+    navmesh->needs_rebuild = TRUE;
+
+    return TRUE;
+}
+
+void NavMesh_Destroy(NavMesh* navmesh)
+{
+    Arena_Destroy(&navmesh->search_arena);
+    Arena_Destroy(&navmesh->query_arena);
+    Arena_Destroy(&navmesh->cache_arena);
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        Arena_Destroy(&navmesh->link_arenas[i]);
+        Arena_Destroy(&navmesh->polygon_arenas[i]);
+        Arena_Destroy(&navmesh->span_arenas[i]);
+    }
+
+    Arena_Destroy(&navmesh->tile_arena);
+    Scene_FaceTracker_Destroy(&navmesh->face_tracker);
+
+    memset(navmesh, 0, sizeof(NavMesh));
+}
+
+void NavMesh_Invalidate(NavMesh* navmesh)
+{
+    navmesh->needs_rebuild = TRUE;
+}
+
+static void NavMesh_ClearPathCache(NavMesh* navmesh)
+{
+    for (uint32_t i = 0; i < NAVMESH_PATH_CACHE_NUM_ENTRIES; ++i)
+        navmesh->cache_entries[i].start_polygon = SCENE_ID_NONE;
+}
+
+// Drops every tile, nothing is found until the next rebuild
+static void NavMesh_Clear(NavMesh* navmesh)
+{
+    Arena_Reset(&navmesh->tile_arena);
+
+    navmesh->tiles = NULL;
+    navmesh->cell_first_spans = NULL;
+    navmesh->num_tiles_x = 0;
+    navmesh->num_tiles_z = 0;
+
+    navmesh->num_spans = 0;
+    navmesh->num_polygons = 0;
+    navmesh->num_links = 0;
+
+    NavMesh_ClearPathCache(navmesh);
+
+    navmesh->needs_rebuild = TRUE;
+}
+
+static uint32_t NavMesh_MixHash(uint32_t hash, uint32_t value)
+{
+    hash = (hash ^ value) * 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+static float NavMesh_GetMinNormalY(const NavMesh* navmesh)
+{
+    // NOTE: Walls are never walkable, even with a slope of 90 degrees
+    return glm::max(cosf(navmesh->settings.max_slope), 1e-3f);
+}
+
+static bool32_t NavMesh_IsFaceWalkable(const Scene* scene, uint32_t face_index, float min_normal_y)
+{
+    return !Scene_Face_IsDeleted(scene, face_index) && scene->faces[face_index].normal.y >= min_normal_y;
+}
+
+// Cells that erosion removes next to a missing neighbor
+static uint32_t NavMesh_GetErosionSize(const NavMesh* navmesh)
+{
+    uint32_t erosion_size = (uint32_t)ceilf(navmesh->settings.agent_radius / navmesh->settings.cell_size);
+    return glm::min(erosion_size, (uint32_t)NAVMESH_MAX_BORDER_SIZE - 1);
+}
+
+// Faces closer than this to a tile in x and z reach into the border of the tile
+static float NavMesh_GetTileMargin(const NavMesh* navmesh)
+{
+    return (float)(NavMesh_GetErosionSize(navmesh) + 2) * navmesh->settings.cell_size;
+}
+
+// Finds the tiles within margin of the bounds in x and z, returns FALSE when there are none
+static bool32_t NavMesh_GetTileRange(
+    const NavMesh* navmesh,
+    glm::vec3      bounds_min,
+    glm::vec3      bounds_max,
+    float          margin,
+    uint32_t*      out_min_x,
+    uint32_t*      out_min_z,
+    uint32_t*      out_max_x,
+    uint32_t*      out_max_z
+)
+{
+    float tile_size = NAVMESH_TILE_SIZE * navmesh->settings.cell_size;
+
+    float min_x = (bounds_min.x - margin - navmesh->origin_x) / tile_size;
+    float min_z = (bounds_min.z - margin - navmesh->origin_z) / tile_size;
+    float max_x = (bounds_max.x + margin - navmesh->origin_x) / tile_size;
+    float max_z = (bounds_max.z + margin - navmesh->origin_z) / tile_size;
+
+    if (max_x < 0.0f || max_z < 0.0f || min_x >= (float)navmesh->num_tiles_x || min_z >= (float)navmesh->num_tiles_z)
+        return FALSE;
+
+    *out_min_x = (uint32_t)glm::max(min_x, 0.0f);
+    *out_min_z = (uint32_t)glm::max(min_z, 0.0f);
+    *out_max_x = (uint32_t)glm::min(max_x, (float)(navmesh->num_tiles_x - 1));
+    *out_max_z = (uint32_t)glm::min(max_z, (float)(navmesh->num_tiles_z - 1));
+
+    return TRUE;
+}
+
+static void NavMesh_MarkTilesDirty(const NavMesh* navmesh, glm::vec3 bounds_min, glm::vec3 bounds_max, bool32_t* tile_dirty_flags)
+{
+    uint32_t min_x, min_z, max_x, max_z;
+
+    if (!NavMesh_GetTileRange(navmesh, bounds_min, bounds_max, NavMesh_GetTileMargin(navmesh), &min_x, &min_z, &max_x, &max_z))
+        return;
+
+    for (uint32_t z = min_z; z <= max_z; ++z)
+    {
+        for (uint32_t x = min_x; x <= max_x; ++x)
+            tile_dirty_flags[z * navmesh->num_tiles_x + x] = TRUE;
+    }
+}
+
+static bool32_t NavMesh_IsInsideGrid(const NavMesh* navmesh, glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    float tile_size = NAVMESH_TILE_SIZE * navmesh->settings.cell_size;
+
+    return bounds_min.x >= navmesh->origin_x && bounds_max.x <= navmesh->origin_x + (float)navmesh->num_tiles_x * tile_size &&
+           bounds_min.z >= navmesh->origin_z && bounds_max.z <= navmesh->origin_z + (float)navmesh->num_tiles_z * tile_size;
+}
+
+// Finds the spans of a cell of the grid, returns FALSE when the cell is outside of it
+static bool32_t NavMesh_GetCellSpans(const NavMesh* navmesh, int32_t cell_x, int32_t cell_z, uint32_t* out_tile_index, uint32_t* out_first_span, uint32_t* out_end_span)
+{
+    if (cell_x < 0 || cell_z < 0 || cell_x >= (int32_t)(navmesh->num_tiles_x * NAVMESH_TILE_SIZE) || cell_z >= (int32_t)(navmesh->num_tiles_z * NAVMESH_TILE_SIZE))
+        return FALSE;
+
+    uint32_t tile_index = ((uint32_t)cell_z / NAVMESH_TILE_SIZE) * navmesh->num_tiles_x + (uint32_t)cell_x / NAVMESH_TILE_SIZE;
+    uint32_t tile_cell = ((uint32_t)cell_z % NAVMESH_TILE_SIZE) * NAVMESH_TILE_SIZE + (uint32_t)cell_x % NAVMESH_TILE_SIZE;
+
+    const NavMesh_Tile* tile = navmesh->tiles + tile_index;
+    const uint16_t* cell_first_spans = navmesh->cell_first_spans + (uint64_t)tile_index * NAVMESH_NUM_TILE_CELLS;
+
+    *out_tile_index = tile_index;
+    *out_first_span = tile->first_span + cell_first_spans[tile_cell];
+    *out_end_span = tile->first_span + ((tile_cell + 1 < NAVMESH_NUM_TILE_CELLS) ? cell_first_spans[tile_cell + 1] : tile->num_spans);
+
+    return TRUE;
+}
+
+static glm::vec2 NavMesh_GetCellCenter(const NavMesh* navmesh, int32_t cell_x, int32_t cell_z)
+{
+    float cell_size = navmesh->settings.cell_size;
+    return { navmesh->origin_x + ((float)cell_x + 0.5f) * cell_size, navmesh->origin_z + ((float)cell_z + 0.5f) * cell_size };
+}
+
+// First cell of the border of the build of a tile, in cells of the grid
+static void NavMesh_GetBuildFirstCell(const NavMesh_Batch* batch, uint32_t tile_index, int32_t* out_cell_x, int32_t* out_cell_z)
+{
+    uint32_t num_tiles_x = batch->navmesh->num_tiles_x;
+
+    *out_cell_x = (int32_t)((tile_index % num_tiles_x) * NAVMESH_TILE_SIZE) - (int32_t)batch->border_size;
+    *out_cell_z = (int32_t)((tile_index / num_tiles_x) * NAVMESH_TILE_SIZE) - (int32_t)batch->border_size;
+}
+
+// Even-odd test of the point against the corners of the face, on the ground
+static bool32_t NavMesh_IsInsidePolygon(const glm::vec2* corners, uint32_t num_corners, glm::vec2 point)
+{
+    bool32_t is_inside = FALSE;
+
+    for (uint32_t i = 0, j = num_corners - 1; i < num_corners; j = i++)
+    {
+        glm::vec2 a = corners[j];
+        glm::vec2 b = corners[i];
+
+        if ((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+            is_inside = !is_inside;
+    }
+
+    return is_inside;
+}
+
+static void NavMesh_AddSample(NavMesh_TileBuild* build, uint32_t cell_index, float height)
+{
+    float* heights = build->span_heights + (uint64_t)cell_index * NAVMESH_MAX_NUM_LAYERS;
+    uint32_t num_spans = build->cell_num_spans[cell_index];
+
+    uint32_t insert_index = 0;
+
+    while (insert_index < num_spans && heights[insert_index] < height)
+        ++insert_index;
+
+    // The same surface keeps the higher sample, so that the order of the faces does not matter
+    if (insert_index > 0 && height - heights[insert_index - 1] < NAVMESH_SPAN_MERGE_DISTANCE)
+    {
+        heights[insert_index - 1] = height;
+        return;
+    }
+
+    if (insert_index < num_spans && heights[insert_index] - height < NAVMESH_SPAN_MERGE_DISTANCE)
+        return;
+
+    if (num_spans == NAVMESH_MAX_NUM_LAYERS)
+    {
+        if (insert_index == NAVMESH_MAX_NUM_LAYERS)
+            return;
+
+        --num_spans;
+    }
+
+    memmove(heights + insert_index + 1, heights + insert_index, (num_spans - insert_index) * sizeof(float));
+    heights[insert_index] = height;
+
+    build->cell_num_spans[cell_index] = (uint8_t)(num_spans + 1);
+}
+
+// Samples the height of the walkable faces at the center of every cell of the tile and its border
+static void NavMesh_RasterizeTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_Batch* batch = (const NavMesh_Batch*)user_data;
+    const NavMesh* navmesh = batch->navmesh;
+    const Scene* scene = batch->scene;
+
+    float cell_size = navmesh->settings.cell_size;
+    int32_t build_size = (int32_t)batch->build_size;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        NavMesh_TileBuild* build = batch->builds + i;
+
+        memset(build->cell_num_spans, 0, (uint64_t)build_size * build_size);
+
+        int32_t first_cell_x, first_cell_z;
+        NavMesh_GetBuildFirstCell(batch, build->tile_index, &first_cell_x, &first_cell_z);
+
+        for (uint32_t j = 0; j < build->num_faces; ++j)
+        {
+            uint32_t face_index = build->face_indices[j];
+            const Scene_Face* face = scene->faces + face_index;
+
+            uint32_t num_corners = 0;
+            uint32_t half_edge_index = face->first_half_edge;
+
+            do
+            {
+                const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+                glm::vec3 position = scene->vertices[half_edge->origin_vertex].position;
+
+                build->corners[num_corners++] = { position.x, position.z };
+
+                half_edge_index = half_edge->next_half_edge;
+            }
+            while (half_edge_index != face->first_half_edge);
+
+            glm::vec3 bounds_min = navmesh->face_tracker.faces[face_index].bounds_min;
+            glm::vec3 bounds_max = navmesh->face_tracker.faces[face_index].bounds_max;
+
+            // Cells with their center within the bounds
+            int32_t min_x = glm::max((int32_t)ceilf((bounds_min.x - navmesh->origin_x) / cell_size - 0.5f) - first_cell_x, 0);
+            int32_t min_z = glm::max((int32_t)ceilf((bounds_min.z - navmesh->origin_z) / cell_size - 0.5f) - first_cell_z, 0);
+            int32_t max_x = glm::min((int32_t)floorf((bounds_max.x - navmesh->origin_x) / cell_size - 0.5f) - first_cell_x, build_size - 1);
+            int32_t max_z = glm::min((int32_t)floorf((bounds_max.z - navmesh->origin_z) / cell_size - 0.5f) - first_cell_z, build_size - 1);
+
+            for (int32_t z = min_z; z <= max_z; ++z)
+            {
+                for (int32_t x = min_x; x <= max_x; ++x)
+                {
+                    glm::vec2 center = NavMesh_GetCellCenter(navmesh, first_cell_x + x, first_cell_z + z);
+
+                    if (!NavMesh_IsInsidePolygon(build->corners, num_corners, center))
+                        continue;
+
+                    float height = -(face->offset + face->normal.x * center.x + face->normal.z * center.y) / face->normal.y;
+                    NavMesh_AddSample(build, (uint32_t)(z * build_size + x), height);
+                }
+            }
+        }
+
+        build->num_rays = 0;
+
+        for (int32_t j = 0; j < build_size * build_size; ++j)
+            build->num_rays += build->cell_num_spans[j];
+    }
+}
+
+static void NavMesh_GenerateRaysTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_Batch* batch = (const NavMesh_Batch*)user_data;
+    const NavMesh* navmesh = batch->navmesh;
+
+    int32_t build_size = (int32_t)batch->build_size;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const NavMesh_TileBuild* build = batch->builds + i;
+        Scene_Ray* ray = batch->rays + build->first_ray;
+
+        int32_t first_cell_x, first_cell_z;
+        NavMesh_GetBuildFirstCell(batch, build->tile_index, &first_cell_x, &first_cell_z);
+
+        for (int32_t z = 0; z < build_size; ++z)
+        {
+            for (int32_t x = 0; x < build_size; ++x)
+            {
+                uint32_t cell_index = (uint32_t)(z * build_size + x);
+                glm::vec2 center = NavMesh_GetCellCenter(navmesh, first_cell_x + x, first_cell_z + z);
+
+                for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+                {
+                    float height = build->span_heights[cell_index * NAVMESH_MAX_NUM_LAYERS + layer];
+
+                    ray->origin = { center.x, height + NAVMESH_RAY_OFFSET, center.y };
+                    ray->min_length = 0.0f;
+                    ray->direction = { 0.0f, 1.0f, 0.0f };
+                    ray->max_length = navmesh->settings.agent_height - NAVMESH_RAY_OFFSET;
+
+                    ++ray;
+                }
+            }
+        }
+    }
+}
+
+// Returns the span the span connects to in the direction, NAVMESH_NO_SPAN for none
+static uint32_t NavMesh_GetNeighborSpan(const NavMesh_Batch* batch, const NavMesh_TileBuild* build, uint32_t span_index, uint32_t direction)
+{
+    if (span_index == NAVMESH_NO_SPAN)
+        return NAVMESH_NO_SPAN;
+
+    uint8_t layer = build->span_neighbors[span_index * 4 + direction];
+
+    if (layer == NAVMESH_NO_LAYER)
+        return NAVMESH_NO_SPAN;
+
+    int32_t cell_index = (int32_t)(span_index / NAVMESH_MAX_NUM_LAYERS) + NavMesh_DirectionZ[direction] * (int32_t)batch->build_size + NavMesh_DirectionX[direction];
+
+    return (uint32_t)cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+}
+
+// Connects every span to the span of each neighboring cell that is closest in height, if it is within the climb
+static void NavMesh_ConnectSpans(const NavMesh_Batch* batch, NavMesh_TileBuild* build)
+{
+    float max_climb = batch->navmesh->settings.max_climb;
+    int32_t build_size = (int32_t)batch->build_size;
+
+    for (int32_t z = 0; z < build_size; ++z)
+    {
+        for (int32_t x = 0; x < build_size; ++x)
+        {
+            uint32_t cell_index = (uint32_t)(z * build_size + x);
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t span_index = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+                float height = build->span_heights[span_index];
+
+                for (uint32_t direction = 0; direction < 4; ++direction)
+                {
+                    int32_t neighbor_x = x + NavMesh_DirectionX[direction];
+                    int32_t neighbor_z = z + NavMesh_DirectionZ[direction];
+
+                    uint8_t best_layer = NAVMESH_NO_LAYER;
+                    float best_difference = FLT_MAX;
+
+                    if (neighbor_x >= 0 && neighbor_z >= 0 && neighbor_x < build_size && neighbor_z < build_size)
+                    {
+                        uint32_t neighbor_cell_index = (uint32_t)(neighbor_z * build_size + neighbor_x);
+
+                        for (uint32_t neighbor_layer = 0; neighbor_layer < build->cell_num_spans[neighbor_cell_index]; ++neighbor_layer)
+                        {
+                            float difference = fabsf(build->span_heights[neighbor_cell_index * NAVMESH_MAX_NUM_LAYERS + neighbor_layer] - height);
+
+                            if (difference <= max_climb && difference < best_difference)
+                            {
+                                best_layer = (uint8_t)neighbor_layer;
+                                best_difference = difference;
+                            }
+                        }
+                    }
+
+                    build->span_neighbors[span_index * 4 + direction] = best_layer;
+                }
+            }
+        }
+    }
+}
+
+static uint32_t NavMesh_GetNeighborDistance(const NavMesh_TileBuild* build, uint32_t span_index, uint32_t distance)
+{
+    return (span_index == NAVMESH_NO_SPAN) ? 0xFFFF : build->span_distances[span_index] + distance;
+}
+
+// Distance of every span to the edge of the walkable area with a chamfer pass forward and one backward
+static void NavMesh_ErodeSpans(const NavMesh_Batch* batch, NavMesh_TileBuild* build)
+{
+    int32_t build_size = (int32_t)batch->build_size;
+
+    // Spans with a missing neighbor are at the edge, the cells outside of the build are not known and count as connected
+    for (int32_t z = 0; z < build_size; ++z)
+    {
+        for (int32_t x = 0; x < build_size; ++x)
+        {
+            uint32_t cell_index = (uint32_t)(z * build_size + x);
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t span_index = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+                bool32_t is_edge = FALSE;
+
+                for (uint32_t direction = 0; direction < 4; ++direction)
+                {
+                    int32_t neighbor_x = x + NavMesh_DirectionX[direction];
+                    int32_t neighbor_z = z + NavMesh_DirectionZ[direction];
+
+                    if (neighbor_x >= 0 && neighbor_z >= 0 && neighbor_x < build_size && neighbor_z < build_size)
+                        is_edge |= (build->span_neighbors[span_index * 4 + direction] == NAVMESH_NO_LAYER);
+                }
+
+                build->span_distances[span_index] = is_edge ? 0 : 0xFFFF;
+            }
+        }
+    }
+
+    for (int32_t z = 0; z < build_size; ++z)
+    {
+        for (int32_t x = 0; x < build_size; ++x)
+        {
+            uint32_t cell_index = (uint32_t)(z * build_size + x);
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t span_index = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+                uint32_t distance = build->span_distances[span_index];
+
+                // -x and -x -z, then -z and +x -z
+                uint32_t neighbor = NavMesh_GetNeighborSpan(batch, build, span_index, 0);
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, neighbor, 2));
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, NavMesh_GetNeighborSpan(batch, build, neighbor, 3), 3));
+
+                neighbor = NavMesh_GetNeighborSpan(batch, build, span_index, 3);
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, neighbor, 2));
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, NavMesh_GetNeighborSpan(batch, build, neighbor, 2), 3));
+
+                build->span_distances[span_index] = (uint16_t)distance;
+            }
+        }
+    }
+
+    for (int32_t z = build_size - 1; z >= 0; --z)
+    {
+        for (int32_t x = build_size - 1; x >= 0; --x)
+        {
+            uint32_t cell_index = (uint32_t)(z * build_size + x);
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t span_index = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+                uint32_t distance = build->span_distances[span_index];
+
+                // +x and +x +z, then +z and -x +z
+                uint32_t neighbor = NavMesh_GetNeighborSpan(batch, build, span_index, 2);
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, neighbor, 2));
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, NavMesh_GetNeighborSpan(batch, build, neighbor, 1), 3));
+
+                neighbor = NavMesh_GetNeighborSpan(batch, build, span_index, 1);
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, neighbor, 2));
+                distance = glm::min(distance, NavMesh_GetNeighborDistance(build, NavMesh_GetNeighborSpan(batch, build, neighbor, 0), 3));
+
+                build->span_distances[span_index] = (uint16_t)distance;
+            }
+        }
+    }
+}
+
+// Walkable spans that are not part of a polygon yet
+static bool32_t NavMesh_IsFreeSpan(const NavMesh_Batch* batch, const NavMesh_TileBuild* build, uint32_t span_index)
+{
+    return span_index != NAVMESH_NO_SPAN && build->span_distances[span_index] >= batch->min_distance &&
+           build->span_polygons[span_index] == NAVMESH_NO_POLYGON;
+}
+
+// Merges the walkable spans of the tile into rectangles, and writes the spans with their polygon
+static void NavMesh_BuildPolygons(const NavMesh_Batch* batch, NavMesh_TileBuild* build)
+{
+    const NavMesh* navmesh = batch->navmesh;
+
+    uint32_t build_size = batch->build_size;
+    uint32_t border_size = batch->border_size;
+    float cell_size = navmesh->settings.cell_size;
+
+    memset(build->span_polygons, 0xFF, (uint64_t)build_size * build_size * NAVMESH_MAX_NUM_LAYERS * sizeof(uint16_t));
+
+    float tile_cell_x = (float)((build->tile_index % navmesh->num_tiles_x) * NAVMESH_TILE_SIZE);
+    float tile_cell_z = (float)((build->tile_index / navmesh->num_tiles_x) * NAVMESH_TILE_SIZE);
+
+    uint32_t rect_spans[NAVMESH_MAX_POLYGON_SIZE * NAVMESH_MAX_POLYGON_SIZE];
+
+    build->num_polygons = 0;
+
+    for (uint32_t z = 0; z < NAVMESH_TILE_SIZE; ++z)
+    {
+        for (uint32_t x = 0; x < NAVMESH_TILE_SIZE; ++x)
+        {
+            uint32_t cell_index = (z + border_size) * build_size + x + border_size;
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t first_span = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+
+                if (!NavMesh_IsFreeSpan(batch, build, first_span))
+                    continue;
+
+                // Grows along x first, then adds rows for as long as every span of a row connects to the one before it and to
+                // the one on its left
+                uint32_t width = 1;
+                rect_spans[0] = first_span;
+
+                while (x + width < NAVMESH_TILE_SIZE && width < NAVMESH_MAX_POLYGON_SIZE)
+                {
+                    uint32_t next_span = NavMesh_GetNeighborSpan(batch, build, rect_spans[width - 1], 2);
+
+                    if (!NavMesh_IsFreeSpan(batch, build, next_span))
+                        break;
+
+                    rect_spans[width++] = next_span;
+                }
+
+                uint32_t height = 1;
+
+                while (z + height < NAVMESH_TILE_SIZE && height < NAVMESH_MAX_POLYGON_SIZE)
+                {
+                    uint32_t* row = rect_spans + height * NAVMESH_MAX_POLYGON_SIZE;
+                    const uint32_t* previous_row = row - NAVMESH_MAX_POLYGON_SIZE;
+
+                    bool32_t is_row_free = TRUE;
+
+                    for (uint32_t k = 0; k < width && is_row_free; ++k)
+                    {
+                        row[k] = NavMesh_GetNeighborSpan(batch, build, previous_row[k], 1);
+
+                        is_row_free = NavMesh_IsFreeSpan(batch, build, row[k]) &&
+                                      (k == 0 || NavMesh_GetNeighborSpan(batch, build, row[k - 1], 2) == row[k]);
+                    }
+
+                    if (!is_row_free)
+                        break;
+
+                    ++height;
+                }
+
+                uint32_t polygon_index = build->num_polygons++;
+                float height_sum = 0.0f;
+
+                for (uint32_t row = 0; row < height; ++row)
+                {
+                    for (uint32_t column = 0; column < width; ++column)
+                    {
+                        uint32_t span_index = rect_spans[row * NAVMESH_MAX_POLYGON_SIZE + column];
+
+                        build->span_polygons[span_index] = (uint16_t)polygon_index;
+                        height_sum += build->span_heights[span_index];
+                    }
+                }
+
+                NavMesh_Polygon* polygon = build->polygons + polygon_index;
+
+                polygon->center.x = navmesh->origin_x + (tile_cell_x + (float)x + 0.5f * (float)width) * cell_size;
+                polygon->center.y = height_sum / (float)(width * height);
+                polygon->center.z = navmesh->origin_z + (tile_cell_z + (float)z + 0.5f * (float)height) * cell_size;
+                polygon->tile_index = build->tile_index;
+
+                polygon->min_x = (uint8_t)x;
+                polygon->min_z = (uint8_t)z;
+                polygon->max_x = (uint8_t)(x + width - 1);
+                polygon->max_z = (uint8_t)(z + height - 1);
+
+                // Linked once the neighboring tiles are built as well
+                polygon->first_link = 0;
+                polygon->num_links = 0;
+            }
+        }
+    }
+
+    build->num_spans = 0;
+
+    for (uint32_t z = 0; z < NAVMESH_TILE_SIZE; ++z)
+    {
+        for (uint32_t x = 0; x < NAVMESH_TILE_SIZE; ++x)
+        {
+            uint32_t cell_index = (z + border_size) * build_size + x + border_size;
+
+            build->cell_first_spans[z * NAVMESH_TILE_SIZE + x] = (uint16_t)build->num_spans;
+
+            for (uint32_t layer = 0; layer < build->cell_num_spans[cell_index]; ++layer)
+            {
+                uint32_t span_index = cell_index * NAVMESH_MAX_NUM_LAYERS + layer;
+
+                if (build->span_polygons[span_index] == NAVMESH_NO_POLYGON)
+                    continue;
+
+                NavMesh_Span* span = build->spans + build->num_spans++;
+                span->height = build->span_heights[span_index];
+                span->polygon = build->span_polygons[span_index];
+            }
+        }
+    }
+}
+
+static void NavMesh_FinishTilesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_Batch* batch = (const NavMesh_Batch*)user_data;
+    const NavMesh_Settings* settings = &batch->navmesh->settings;
+
+    uint32_t num_build_cells = batch->build_size * batch->build_size;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        NavMesh_TileBuild* build = batch->builds + i;
+
+        // Spans without room for the agent above them are dropped, the rays are in the order of the spans
+        const Scene_RayHit* hits = batch->hits + build->first_ray;
+        uint32_t ray_index = 0;
+
+        for (uint32_t cell_index = 0; cell_index < num_build_cells; ++cell_index)
+        {
+            float* heights = build->span_heights + (uint64_t)cell_index * NAVMESH_MAX_NUM_LAYERS;
+
+            uint32_t num_spans = build->cell_num_spans[cell_index];
+            uint32_t num_kept_spans = 0;
+
+            for (uint32_t layer = 0; layer < num_spans; ++layer)
+            {
+                bool32_t is_blocked = (hits[ray_index++].index != SCENE_ID_NONE);
+
+                // NOTE: The rays hit the faces of the spans above as well, unless they pass exactly along an edge
+                if (layer + 1 < num_spans && heights[layer + 1] - heights[layer] < settings->agent_height)
+                    is_blocked = TRUE;
+
+                if (!is_blocked)
+                    heights[num_kept_spans++] = heights[layer];
+            }
+
+            build->cell_num_spans[cell_index] = (uint8_t)num_kept_spans;
+        }
+
+        NavMesh_ConnectSpans(batch, build);
+        NavMesh_ErodeSpans(batch, build);
+        NavMesh_BuildPolygons(batch, build);
+    }
+}
+
+// Appends the tile as it was to the other buffers
+static bool32_t NavMesh_CopyTile(NavMesh* navmesh, uint32_t tile_index, Arena* span_arena, Arena* polygon_arena)
+{
+    NavMesh_Tile* tile = navmesh->tiles + tile_index;
+
+    const NavMesh_Span* spans = navmesh->spans + tile->first_span;
+    const NavMesh_Polygon* polygons = navmesh->polygons + tile->first_polygon;
+
+    tile->first_span = (uint32_t)(span_arena->offset / sizeof(NavMesh_Span));
+    tile->first_polygon = (uint32_t)(polygon_arena->offset / sizeof(NavMesh_Polygon));
+
+    return Arena_PushRegion(span_arena, (void*)spans, (uint64_t)tile->num_spans * sizeof(NavMesh_Span), alignof(NavMesh_Span)) &&
+           Arena_PushRegion(polygon_arena, (void*)polygons, (uint64_t)tile->num_polygons * sizeof(NavMesh_Polygon), alignof(NavMesh_Polygon));
+}
+
+static bool32_t NavMesh_WriteTile(NavMesh* navmesh, const NavMesh_TileBuild* build, Arena* span_arena, Arena* polygon_arena)
+{
+    NavMesh_Tile* tile = navmesh->tiles + build->tile_index;
+
+    tile->first_span = (uint32_t)(span_arena->offset / sizeof(NavMesh_Span));
+    tile->num_spans = build->num_spans;
+    tile->first_polygon = (uint32_t)(polygon_arena->offset / sizeof(NavMesh_Polygon));
+    tile->num_polygons = build->num_polygons;
+
+    memcpy(navmesh->cell_first_spans + (uint64_t)build->tile_index * NAVMESH_NUM_TILE_CELLS, build->cell_first_spans, NAVMESH_NUM_TILE_CELLS * sizeof(uint16_t));
+
+    return Arena_PushRegion(span_arena, build->spans, (uint64_t)build->num_spans * sizeof(NavMesh_Span), alignof(NavMesh_Span)) &&
+           Arena_PushRegion(polygon_arena, build->polygons, (uint64_t)build->num_polygons * sizeof(NavMesh_Polygon), alignof(NavMesh_Polygon));
+}
+
+// Returns the polygon of the span of a cell closest in height within the climb as tile index and index in the tile, and
+// the height of the span. SCENE_ID_NONE when there is none.
+static uint32_t NavMesh_FindConnectedPolygon(const NavMesh* navmesh, int32_t cell_x, int32_t cell_z, float height, float* out_height)
+{
+    uint32_t tile_index, first_span, end_span;
+
+    if (!NavMesh_GetCellSpans(navmesh, cell_x, cell_z, &tile_index, &first_span, &end_span))
+        return SCENE_ID_NONE;
+
+    uint32_t polygon = SCENE_ID_NONE;
+    float best_difference = FLT_MAX;
+
+    for (uint32_t i = first_span; i < end_span; ++i)
+    {
+        float difference = fabsf(navmesh->spans[i].height - height);
+
+        if (difference <= navmesh->settings.max_climb && difference < best_difference)
+        {
+            polygon = (tile_index << NAVMESH_TILE_POLYGON_BITS) | navmesh->spans[i].polygon;
+            best_difference = difference;
+            *out_height = navmesh->spans[i].height;
+        }
+    }
+
+    return polygon;
+}
+
+// Appends a link for every run of cells along the sides of the polygon that connect to the same polygon
+static bool32_t NavMesh_LinkPolygon(NavMesh* navmesh, uint32_t tile_index, uint32_t polygon_index, Arena* link_arena)
+{
+    const NavMesh_Tile* tile = navmesh->tiles + tile_index;
+    NavMesh_Polygon* polygon = navmesh->polygons + tile->first_polygon + polygon_index;
+
+    float cell_size = navmesh->settings.cell_size;
+
+    int32_t tile_cell_x = (int32_t)((tile_index % navmesh->num_tiles_x) * NAVMESH_TILE_SIZE);
+    int32_t tile_cell_z = (int32_t)((tile_index / navmesh->num_tiles_x) * NAVMESH_TILE_SIZE);
+
+    uint32_t first_link = (uint32_t)(link_arena->offset / sizeof(NavMesh_Link));
+
+    for (uint32_t direction = 0; direction < 4; ++direction)
+    {
+        bool32_t is_along_z = (NavMesh_DirectionX[direction] != 0);
+
+        uint32_t num_cells = is_along_z ? (polygon->max_z - polygon->min_z + 1u) : (polygon->max_x - polygon->min_x + 1u);
+
+        NavMesh_Link link;
+        link.polygon = SCENE_ID_NONE;
+
+        for (uint32_t i = 0; i <= num_cells; ++i)
+        {
+            uint32_t neighbor_polygon = SCENE_ID_NONE;
+            glm::vec3 portal_point;
+
+            if (i < num_cells)
+            {
+                int32_t x = is_along_z ? ((NavMesh_DirectionX[direction] < 0) ? polygon->min_x : polygon->max_x) : (int32_t)(polygon->min_x + i);
+                int32_t z = is_along_z ? (int32_t)(polygon->min_z + i) : ((NavMesh_DirectionZ[direction] < 0) ? polygon->min_z : polygon->max_z);
+
+                // The span of the polygon in the cell
+                uint32_t first_span = tile->first_span + navmesh->cell_first_spans[(uint64_t)tile_index * NAVMESH_NUM_TILE_CELLS + z * NAVMESH_TILE_SIZE + x];
+                while (navmesh->spans[first_span].polygon != polygon_index)
+                    ++first_span;
+
+                float height = navmesh->spans[first_span].height;
+                float neighbor_height = height;
+
+                neighbor_polygon = NavMesh_FindConnectedPolygon(
+                    navmesh,
+                    tile_cell_x + x + NavMesh_DirectionX[direction],
+                    tile_cell_z + z + NavMesh_DirectionZ[direction],
+                    height,
+                    &neighbor_height
+                );
+
+                glm::vec2 center = NavMesh_GetCellCenter(navmesh, tile_cell_x + x, tile_cell_z + z);
+
+                portal_point.x = center.x + 0.5f * cell_size * (float)NavMesh_DirectionX[direction];
+                portal_point.y = 0.5f * (height + neighbor_height);
+                portal_point.z = center.y + 0.5f * cell_size * (float)NavMesh_DirectionZ[direction];
+            }
+
+            if (neighbor_polygon == link.polygon && neighbor_polygon != SCENE_ID_NONE)
+            {
+                link.portal_end = portal_point;
+                continue;
+            }
+
+            if (link.polygon != SCENE_ID_NONE && !Arena_PushRegion(link_arena, &link, sizeof(NavMesh_Link), alignof(NavMesh_Link)))
+                return FALSE;
+
+            link.polygon = neighbor_polygon;
+            link.portal_start = portal_point;
+            link.portal_end = portal_point;
+        }
+    }
+
+    polygon->first_link = first_link - tile->first_link;
+    polygon->num_links = (uint32_t)(link_arena->offset / sizeof(NavMesh_Link)) - first_link;
+
+    return TRUE;
+}
+
+// Links the polygons of the rebuilt tiles and of their neighbors again, the other tiles keep their links
+static bool32_t NavMesh_BuildLinks(NavMesh* navmesh, const bool32_t* tile_dirty_flags)
+{
+    Arena* link_arena = navmesh->link_arenas + navmesh->buffer_index;
+    Arena_Reset(link_arena);
+
+    const NavMesh_Link* old_links = navmesh->links;
+
+    for (uint32_t z = 0; z < navmesh->num_tiles_z; ++z)
+    {
+        for (uint32_t x = 0; x < navmesh->num_tiles_x; ++x)
+        {
+            uint32_t tile_index = z * navmesh->num_tiles_x + x;
+            NavMesh_Tile* tile = navmesh->tiles + tile_index;
+
+            bool32_t needs_links = tile_dirty_flags[tile_index] ||
+                (x > 0 && tile_dirty_flags[tile_index - 1]) || (x + 1 < navmesh->num_tiles_x && tile_dirty_flags[tile_index + 1]) ||
+                (z > 0 && tile_dirty_flags[tile_index - navmesh->num_tiles_x]) || (z + 1 < navmesh->num_tiles_z && tile_dirty_flags[tile_index + navmesh->num_tiles_x]);
+
+            uint32_t first_link = (uint32_t)(link_arena->offset / sizeof(NavMesh_Link));
+
+            if (!needs_links)
+            {
+                if (!Arena_PushRegion(link_arena, (void*)(old_links + tile->first_link), (uint64_t)tile->num_links * sizeof(NavMesh_Link), alignof(NavMesh_Link)))
+                    return FALSE;
+
+                tile->first_link = first_link;
+                continue;
+            }
+
+            tile->first_link = first_link;
+
+            for (uint32_t i = 0; i < tile->num_polygons; ++i)
+            {
+                if (!NavMesh_LinkPolygon(navmesh, tile_index, i, link_arena))
+                    return FALSE;
+            }
+
+            tile->num_links = (uint32_t)(link_arena->offset / sizeof(NavMesh_Link)) - first_link;
+        }
+    }
+
+    navmesh->links = (NavMesh_Link*)link_arena->memory;
+    navmesh->num_links = (uint32_t)(link_arena->offset / sizeof(NavMesh_Link));
+
+    return TRUE;
+}
+
+// Builds the dirty tiles in batches and writes all tiles into the other buffers, the dirty ones new and the others as they
+// were, then links them. Returns FALSE when the spans or links do not fit.
+static bool32_t NavMesh_BuildTiles(NavMesh* navmesh, Scene* scene, const bool32_t* tile_dirty_flags, NavMesh_UpdateStats* stats)
+{
+    uint32_t num_tiles = navmesh->num_tiles_x * navmesh->num_tiles_z;
+    float min_normal_y = NavMesh_GetMinNormalY(navmesh);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    NavMesh_Batch batch;
+    batch.navmesh = navmesh;
+    batch.scene = scene;
+    batch.border_size = NavMesh_GetErosionSize(navmesh) + 1;
+    batch.build_size = NAVMESH_TILE_SIZE + 2 * batch.border_size;
+    batch.min_distance = (uint16_t)(2 * NavMesh_GetErosionSize(navmesh));
+
+    uint32_t* dirty_tiles = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_tiles);
+    uint32_t* tile_first_faces = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_tiles + 1);
+    uint32_t* tile_num_faces = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_tiles);
+
+    ASSERT(dirty_tiles && tile_first_faces && tile_num_faces);
+
+    uint32_t num_dirty_tiles = 0;
+
+    for (uint32_t i = 0; i < num_tiles; ++i)
+    {
+        if (tile_dirty_flags[i])
+            dirty_tiles[num_dirty_tiles++] = i;
+    }
+
+    // The walkable faces of every dirty tile, counted first
+    memset(tile_num_faces, 0, (uint64_t)num_tiles * sizeof(uint32_t));
+
+    uint32_t max_num_corners = 0;
+    uint32_t num_face_refs = 0;
+    uint32_t* face_refs = NULL;
+
+    float margin = NavMesh_GetTileMargin(navmesh);
+
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint32_t i = 0; i < navmesh->face_tracker.num_faces; ++i)
+        {
+            if (!NavMesh_IsFaceWalkable(scene, i, min_normal_y))
+                continue;
+
+            const Scene_TrackedFace* tracked_face = navmesh->face_tracker.faces + i;
+            uint32_t min_x, min_z, max_x, max_z;
+
+            if (!NavMesh_GetTileRange(navmesh, tracked_face->bounds_min, tracked_face->bounds_max, margin, &min_x, &min_z, &max_x, &max_z))
+                continue;
+
+            max_num_corners = glm::max(max_num_corners, scene->faces[i].num_half_edges);
+
+            for (uint32_t z = min_z; z <= max_z; ++z)
+            {
+                for (uint32_t x = min_x; x <= max_x; ++x)
+                {
+                    uint32_t tile_index = z * navmesh->num_tiles_x + x;
+
+                    if (!tile_dirty_flags[tile_index])
+                        continue;
+
+                    if (pass == 1)
+                        face_refs[tile_first_faces[tile_index] + tile_num_faces[tile_index]] = i;
+
+                    ++tile_num_faces[tile_index];
+                }
+            }
+        }
+
+        if (pass == 1)
+            break;
+
+        for (uint32_t i = 0; i < num_tiles; ++i)
+        {
+            tile_first_faces[i] = num_face_refs;
+            num_face_refs += tile_num_faces[i];
+            tile_num_faces[i] = 0;
+        }
+
+        tile_first_faces[num_tiles] = num_face_refs;
+
+        face_refs = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_face_refs);
+
+        ASSERT(face_refs || num_face_refs == 0);
+    }
+
+    uint32_t back_index = 1 - navmesh->buffer_index;
+
+    Arena* span_arena = navmesh->span_arenas + back_index;
+    Arena* polygon_arena = navmesh->polygon_arenas + back_index;
+
+    Arena_Reset(span_arena);
+    Arena_Reset(polygon_arena);
+
+    uint32_t num_build_cells = batch.build_size * batch.build_size;
+    uint32_t next_tile = 0;
+    bool32_t build_result = TRUE;
+
+    for (uint32_t first_dirty_tile = 0; first_dirty_tile < num_dirty_tiles && build_result; first_dirty_tile += NAVMESH_NUM_TILES_PER_BATCH)
+    {
+        uint32_t num_builds = glm::min(num_dirty_tiles - first_dirty_tile, (uint32_t)NAVMESH_NUM_TILES_PER_BATCH);
+        uint64_t batch_offset = scratch_arena->offset;
+
+        batch.builds = ARENA_ALLOCATE_ARRAY(scratch_arena, NavMesh_TileBuild, num_builds);
+
+        ASSERT(batch.builds);
+
+        for (uint32_t i = 0; i < num_builds; ++i)
+        {
+            NavMesh_TileBuild* build = batch.builds + i;
+
+            build->tile_index = dirty_tiles[first_dirty_tile + i];
+            build->face_indices = face_refs + tile_first_faces[build->tile_index];
+            build->num_faces = tile_first_faces[build->tile_index + 1] - tile_first_faces[build->tile_index];
+
+            build->cell_num_spans = ARENA_ALLOCATE_ARRAY(scratch_arena, uint8_t, num_build_cells);
+            build->span_heights = ARENA_ALLOCATE_ARRAY(scratch_arena, float, num_build_cells * NAVMESH_MAX_NUM_LAYERS);
+            build->span_neighbors = ARENA_ALLOCATE_ARRAY(scratch_arena, uint8_t, num_build_cells * NAVMESH_MAX_NUM_LAYERS * 4);
+            build->span_distances = ARENA_ALLOCATE_ARRAY(scratch_arena, uint16_t, num_build_cells * NAVMESH_MAX_NUM_LAYERS);
+            build->span_polygons = ARENA_ALLOCATE_ARRAY(scratch_arena, uint16_t, num_build_cells * NAVMESH_MAX_NUM_LAYERS);
+            build->corners = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec2, glm::max(max_num_corners, 1u));
+
+            build->spans = ARENA_ALLOCATE_ARRAY(scratch_arena, NavMesh_Span, NAVMESH_NUM_TILE_CELLS * NAVMESH_MAX_NUM_LAYERS);
+            build->cell_first_spans = ARENA_ALLOCATE_ARRAY(scratch_arena, uint16_t, NAVMESH_NUM_TILE_CELLS);
+            build->polygons = ARENA_ALLOCATE_ARRAY(scratch_arena, NavMesh_Polygon, NAVMESH_NUM_TILE_CELLS * NAVMESH_MAX_NUM_LAYERS);
+
+            ASSERT(build->cell_num_spans && build->span_heights && build->span_neighbors && build->span_distances && build->span_polygons && build->corners);
+            ASSERT(build->spans && build->cell_first_spans && build->polygons);
+        }
+
+        Jobs_ParallelFor(num_builds, 1, NavMesh_RasterizeTask, &batch);
+
+        uint32_t num_rays = 0;
+
+        for (uint32_t i = 0; i < num_builds; ++i)
+        {
+            batch.builds[i].first_ray = num_rays;
+            num_rays += batch.builds[i].num_rays;
+        }
+
+        batch.rays = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_Ray, num_rays);
+        batch.hits = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_RayHit, num_rays);
+
+        ASSERT((batch.rays && batch.hits) || num_rays == 0);
+
+        Jobs_ParallelFor(num_builds, 1, NavMesh_GenerateRaysTask, &batch);
+        Scene_RayCast_FindNearestIntersectingFaces(scene, batch.rays, num_rays, batch.hits);
+        Jobs_ParallelFor(num_builds, 1, NavMesh_FinishTilesTask, &batch);
+
+        stats->num_rays += num_rays;
+
+        // The tiles before every rebuilt one are copied, so that the buffers stay in the order of the tiles
+        for (uint32_t i = 0; i < num_builds && build_result; ++i)
+        {
+            const NavMesh_TileBuild* build = batch.builds + i;
+
+            for (; next_tile < build->tile_index && build_result; ++next_tile)
+                build_result = NavMesh_CopyTile(navmesh, next_tile, span_arena, polygon_arena);
+
+            build_result = build_result && NavMesh_WriteTile(navmesh, build, span_arena, polygon_arena);
+            next_tile = build->tile_index + 1;
+        }
+
+        Arena_Rewind(scratch_arena, batch_offset);
+    }
+
+    for (; next_tile < num_tiles && build_result; ++next_tile)
+        build_result = NavMesh_CopyTile(navmesh, next_tile, span_arena, polygon_arena);
+
+    if (build_result)
+    {
+        navmesh->buffer_index = back_index;
+
+        navmesh->spans = (NavMesh_Span*)span_arena->memory;
+        navmesh->polygons = (NavMesh_Polygon*)polygon_arena->memory;
+        navmesh->num_spans = (uint32_t)(span_arena->offset / sizeof(NavMesh_Span));
+        navmesh->num_polygons = (uint32_t)(polygon_arena->offset / sizeof(NavMesh_Polygon));
+
+        build_result = NavMesh_BuildLinks(navmesh, tile_dirty_flags);
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    stats->num_rebuilt_tiles += num_dirty_tiles;
+
+    // Rebuilt tiles can open shorter paths or close cached ones
+    if (num_dirty_tiles > 0)
+        NavMesh_ClearPathCache(navmesh);
+
+    return build_result;
+}
+
+// Lays the grid of tiles over the walkable faces and builds every tile
+static bool32_t NavMesh_Rebuild(NavMesh* navmesh, Scene* scene, NavMesh_UpdateStats* stats)
+{
+    stats->was_rebuilt = TRUE;
+
+    NavMesh_Clear(navmesh);
+
+    float min_normal_y = NavMesh_GetMinNormalY(navmesh);
+
+    glm::vec3 walkable_min = glm::vec3(FLT_MAX);
+    glm::vec3 walkable_max = glm::vec3(-FLT_MAX);
+
+    for (uint32_t i = 0; i < navmesh->face_tracker.num_faces; ++i)
+    {
+        const Scene_TrackedFace* tracked_face = navmesh->face_tracker.faces + i;
+
+        if (tracked_face->signature == 0)
+            continue;
+
+        ++stats->num_added_faces;
+
+        if (NavMesh_IsFaceWalkable(scene, i, min_normal_y))
+        {
+            walkable_min = glm::min(walkable_min, tracked_face->bounds_min);
+            walkable_max = glm::max(walkable_max, tracked_face->bounds_max);
+        }
+    }
+
+    if (walkable_min.x <= walkable_max.x)
+    {
+        float cell_size = navmesh->settings.cell_size;
+        float tile_size = NAVMESH_TILE_SIZE * cell_size;
+
+        // A tile of margin on every side, so that the walkable faces can grow a little without a rebuild
+        navmesh->origin_x = floorf((walkable_min.x - tile_size) / cell_size) * cell_size;
+        navmesh->origin_z = floorf((walkable_min.z - tile_size) / cell_size) * cell_size;
+
+        uint64_t num_tiles_x = (uint64_t)ceilf((walkable_max.x + tile_size - navmesh->origin_x) / tile_size);
+        uint64_t num_tiles_z = (uint64_t)ceilf((walkable_max.z + tile_size - navmesh->origin_z) / tile_size);
+
+        if (num_tiles_x * num_tiles_z > NAVMESH_MAX_NUM_TILES)
+            return FALSE;
+
+        navmesh->num_tiles_x = (uint32_t)num_tiles_x;
+        navmesh->num_tiles_z = (uint32_t)num_tiles_z;
+    }
+
+    uint32_t num_tiles = navmesh->num_tiles_x * navmesh->num_tiles_z;
+
+    navmesh->tiles = ARENA_ALLOCATE_ARRAY(&navmesh->tile_arena, NavMesh_Tile, num_tiles);
+    navmesh->cell_first_spans = ARENA_ALLOCATE_ARRAY(&navmesh->tile_arena, uint16_t, (uint64_t)num_tiles * NAVMESH_NUM_TILE_CELLS);
+
+    ASSERT(navmesh->tiles && navmesh->cell_first_spans);
+
+    memset(navmesh->tiles, 0, (uint64_t)num_tiles * sizeof(NavMesh_Tile));
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    bool32_t* tile_dirty_flags = ARENA_ALLOCATE_ARRAY(scratch_arena, bool32_t, num_tiles);
+
+    ASSERT(tile_dirty_flags || num_tiles == 0);
+
+    for (uint32_t i = 0; i < num_tiles; ++i)
+        tile_dirty_flags[i] = TRUE;
+
+    bool32_t build_result = NavMesh_BuildTiles(navmesh, scene, tile_dirty_flags, stats);
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    if (!build_result)
+    {
+        NavMesh_Clear(navmesh);
+        return FALSE;
+    }
+
+    navmesh->needs_rebuild = FALSE;
+
+    return TRUE;
+}
+
+// Rebuilds the tiles around the faces that changed. Faces that only moved to another index, like the ones renumbered by a
+// compile or a reorder, are matched with their old face and change nothing.
+// Returns FALSE when a walkable face is outside of the grid or the tiles do not fit, everything is rebuilt then.
+static bool32_t NavMesh_UpdateChangedFaces(NavMesh* navmesh, Scene* scene, const Scene_FaceChange* changes, uint32_t num_changes, NavMesh_UpdateStats* stats)
+{
+    if (num_changes == 0)
+        return TRUE;
+
+    uint32_t num_tiles = navmesh->num_tiles_x * navmesh->num_tiles_z;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    bool32_t* tile_dirty_flags = ARENA_ALLOCATE_ARRAY(scratch_arena, bool32_t, num_tiles);
+
+    ASSERT(tile_dirty_flags || num_tiles == 0);
+
+    memset(tile_dirty_flags, 0, (uint64_t)num_tiles * sizeof(bool32_t));
+
+    float min_normal_y = NavMesh_GetMinNormalY(navmesh);
+    bool32_t update_result = TRUE;
+
+    // Faces that moved without changing are left alone, the others change the tiles they reach into now and used to
+    for (uint32_t i = 0; i < num_changes && update_result; ++i)
+    {
+        const Scene_FaceChange* change = changes + i;
+
+        if (change->old_face.signature != 0 && !change->is_old_face_taken)
+        {
+            ++stats->num_removed_faces;
+            NavMesh_MarkTilesDirty(navmesh, change->old_face.bounds_min, change->old_face.bounds_max, tile_dirty_flags);
+        }
+
+        if (change->signature == 0 || change->matched_change != SCENE_ID_NONE)
+            continue;
+
+        const Scene_TrackedFace* tracked_face = navmesh->face_tracker.faces + change->face_index;
+        ++stats->num_added_faces;
+
+        if (NavMesh_IsFaceWalkable(scene, change->face_index, min_normal_y) && !NavMesh_IsInsideGrid(navmesh, tracked_face->bounds_min, tracked_face->bounds_max))
+            update_result = FALSE;
+
+        NavMesh_MarkTilesDirty(navmesh, tracked_face->bounds_min, tracked_face->bounds_max, tile_dirty_flags);
+    }
+
+    if (update_result)
+        update_result = NavMesh_BuildTiles(navmesh, scene, tile_dirty_flags, stats);
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    return update_result;
+}
+
+bool32_t NavMesh_Update(NavMesh* navmesh, Scene* scene, NavMesh_UpdateStats* out_stats)
+{
+    NavMesh_UpdateStats stats;
+    memset(&stats, 0, sizeof(NavMesh_UpdateStats));
+
+    Scene_UpdateFacePlanes(scene);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t num_changes;
+    const Scene_FaceChange* changes = Scene_FaceTracker_Update(&navmesh->face_tracker, scene, &num_changes);
+
+    // Walkable faces outside of the grid need a new one
+    bool32_t update_result = FALSE;
+
+    if (!navmesh->needs_rebuild)
+        update_result = NavMesh_UpdateChangedFaces(navmesh, scene, changes, num_changes, &stats);
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    if (!update_result)
+    {
+        memset(&stats, 0, sizeof(NavMesh_UpdateStats));
+        update_result = NavMesh_Rebuild(navmesh, scene, &stats);
+    }
+
+    stats.num_tiles = navmesh->num_tiles_x * navmesh->num_tiles_z;
+    stats.num_spans = navmesh->num_spans;
+    stats.num_polygons = navmesh->num_polygons;
+    stats.num_links = navmesh->num_links;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return update_result;
+}
+
+uint32_t NavMesh_FindPolygon(const NavMesh* navmesh, glm::vec3 point, uint32_t max_snap_cells, glm::vec3* out_point)
+{
+    if (navmesh->num_tiles_x == 0)
+        return SCENE_ID_NONE;
+
+    float cell_size = navmesh->settings.cell_size;
+
+    int32_t cell_x = (int32_t)floorf((point.x - navmesh->origin_x) / cell_size);
+    int32_t cell_z = (int32_t)floorf((point.z - navmesh->origin_z) / cell_size);
+
+    uint32_t best_polygon = SCENE_ID_NONE;
+    float best_distance = FLT_MAX;
+
+    // Rings of cells around the cell of the point, the nearest span below the point or within the climb above it wins
+    for (int32_t ring = 0; ring <= (int32_t)max_snap_cells; ++ring)
+    {
+        for (int32_t z = cell_z - ring; z <= cell_z + ring; ++z)
+        {
+            for (int32_t x = cell_x - ring; x <= cell_x + ring; ++x)
+            {
+                if (glm::max(abs(x - cell_x), abs(z - cell_z)) != ring)
+                    continue;
+
+                uint32_t tile_index, first_span, end_span;
+
+                if (!NavMesh_GetCellSpans(navmesh, x, z, &tile_index, &first_span, &end_span))
+                    continue;
+
+                glm::vec2 center = NavMesh_GetCellCenter(navmesh, x, z);
+
+                for (uint32_t i = first_span; i < end_span; ++i)
+                {
+                    const NavMesh_Span* span = navmesh->spans + i;
+
+                    if (span->height > point.y + navmesh->settings.max_climb)
+                        break;
+
+                    glm::vec3 position = (ring == 0) ? glm::vec3(point.x, span->height, point.z) : glm::vec3(center.x, span->height, center.y);
+                    glm::vec3 offset = position - point;
+                    float distance = glm::dot(offset, offset);
+
+                    if (distance < best_distance)
+                    {
+                        best_polygon = navmesh->tiles[tile_index].first_polygon + span->polygon;
+                        best_distance = distance;
+                        *out_point = position;
+                    }
+                }
+            }
+        }
+
+        if (best_polygon != SCENE_ID_NONE)
+            break;
+    }
+
+    return best_polygon;
+}
+
+static uint32_t NavMesh_GetCacheSet(uint32_t start_polygon, uint32_t goal_polygon)
+{
+    return NavMesh_MixHash(NavMesh_MixHash(0x9E3779B9u, start_polygon), goal_polygon) & (NAVMESH_PATH_CACHE_NUM_SETS - 1);
+}
+
+static uint32_t NavMesh_FindCacheEntry(const NavMesh* navmesh, uint32_t start_polygon, uint32_t goal_polygon)
+{
+    uint32_t first_entry = NavMesh_GetCacheSet(start_polygon, goal_polygon) * NAVMESH_PATH_CACHE_NUM_WAYS;
+
+    for (uint32_t i = first_entry; i < first_entry + NAVMESH_PATH_CACHE_NUM_WAYS; ++i)
+    {
+        const NavMesh_PathCacheEntry* entry = navmesh->cache_entries + i;
+
+        if (entry->start_polygon == start_polygon && entry->goal_polygon == goal_polygon)
+            return i;
+    }
+
+    return SCENE_ID_NONE;
+}
+
+// Replaces an empty entry of the set or the least recently used one, the entries the batch reads from are kept
+static void NavMesh_InsertCacheEntry(NavMesh* navmesh, const NavMesh_Search* search)
+{
+    uint32_t first_entry = NavMesh_GetCacheSet(search->start_polygon, search->goal_polygon) * NAVMESH_PATH_CACHE_NUM_WAYS;
+    uint32_t entry_index = SCENE_ID_NONE;
+
+    for (uint32_t i = first_entry; i < first_entry + NAVMESH_PATH_CACHE_NUM_WAYS; ++i)
+    {
+        const NavMesh_PathCacheEntry* entry = navmesh->cache_entries + i;
+
+        if (entry->start_polygon == SCENE_ID_NONE)
+        {
+            entry_index = i;
+            break;
+        }
+
+        if (entry->last_use != navmesh->cache_tick && (entry_index == SCENE_ID_NONE || entry->last_use < navmesh->cache_entries[entry_index].last_use))
+            entry_index = i;
+    }
+
+    if (entry_index == SCENE_ID_NONE)
+        return;
+
+    NavMesh_PathCacheEntry* entry = navmesh->cache_entries + entry_index;
+
+    entry->start_polygon = search->start_polygon;
+    entry->goal_polygon = search->goal_polygon;
+    entry->num_polygons = search->num_polygons;
+    entry->last_use = navmesh->cache_tick;
+
+    memcpy(navmesh->cache_polygons + (uint64_t)entry_index * NAVMESH_MAX_CORRIDOR_LENGTH, search->corridor, search->num_polygons * sizeof(uint32_t));
+}
+
+// Gives the search states room for every polygon
+static void NavMesh_PrepareSearchStates(NavMesh* navmesh)
+{
+    if (navmesh->num_polygons <= navmesh->search_capacity)
+        return;
+
+    uint32_t capacity = glm::min(glm::max(navmesh->num_polygons, 2 * navmesh->search_capacity), NAVMESH_MAX_NUM_SPANS);
+
+    Arena_Rewind(&navmesh->search_arena, (uint64_t)navmesh->num_search_states * sizeof(NavMesh_SearchState));
+
+    for (uint32_t i = 0; i < navmesh->num_search_states; ++i)
+    {
+        NavMesh_SearchState* state = navmesh->search_states + i;
+
+        state->costs = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, float, capacity);
+        state->scores = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, float, capacity);
+        state->parents = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, uint32_t, capacity);
+        state->stamps = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, uint32_t, capacity);
+        state->heap_slots = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, uint32_t, capacity);
+        state->heap = ARENA_ALLOCATE_ARRAY(&navmesh->search_arena, uint32_t, capacity);
+
+        ASSERT(state->costs && state->scores && state->parents && state->stamps && state->heap_slots && state->heap);
+
+        memset(state->stamps, 0, (uint64_t)capacity * sizeof(uint32_t));
+        state->stamp = 0;
+    }
+
+    navmesh->search_capacity = capacity;
+}
+
+static void NavMesh_SiftUp(NavMesh_SearchState* state, uint32_t slot)
+{
+    uint32_t polygon = state->heap[slot];
+    float score = state->scores[polygon];
+
+    while (slot > 0)
+    {
+        uint32_t parent_slot = (slot - 1) / 2;
+        uint32_t parent_polygon = state->heap[parent_slot];
+
+        if (state->scores[parent_polygon] <= score)
+            break;
+
+        state->heap[slot] = parent_polygon;
+        state->heap_slots[parent_polygon] = slot;
+        slot = parent_slot;
+    }
+
+    state->heap[slot] = polygon;
+    state->heap_slots[polygon] = slot;
+}
+
+static void NavMesh_SiftDown(NavMesh_SearchState* state, uint32_t slot, uint32_t heap_size)
+{
+    uint32_t polygon = state->heap[slot];
+    float score = state->scores[polygon];
+
+    for (;;)
+    {
+        uint32_t child_slot = 2 * slot + 1;
+
+        if (child_slot >= heap_size)
+            break;
+
+        if (child_slot + 1 < heap_size && state->scores[state->heap[child_slot + 1]] < state->scores[state->heap[child_slot]])
+            ++child_slot;
+
+        uint32_t child_polygon = state->heap[child_slot];
+
+        if (state->scores[child_polygon] >= score)
+            break;
+
+        state->heap[slot] = child_polygon;
+        state->heap_slots[child_polygon] = slot;
+        slot = child_slot;
+    }
+
+    state->heap[slot] = polygon;
+    state->heap_slots[polygon] = slot;
+}
+
+// A* from the start polygon to the goal polygon, with the distances between polygon centers as costs
+static void NavMesh_RunSearch(const NavMesh* navmesh, NavMesh_SearchState* state, NavMesh_Search* search)
+{
+    search->num_polygons = 0;
+    search->num_expanded_polygons = 0;
+
+    if (++state->stamp == 0)
+    {
+        memset(state->stamps, 0, (uint64_t)navmesh->search_capacity * sizeof(uint32_t));
+        state->stamp = 1;
+    }
+
+    uint32_t stamp = state->stamp;
+    uint32_t start = search->start_polygon;
+    uint32_t goal = search->goal_polygon;
+
+    glm::vec3 goal_center = navmesh->polygons[goal].center;
+
+    state->costs[start] = 0.0f;
+    state->scores[start] = glm::distance(navmesh->polygons[start].center, goal_center);
+    state->parents[start] = SCENE_ID_NONE;
+    state->stamps[start] = stamp;
+    state->heap[0] = start;
+    state->heap_slots[start] = 0;
+
+    uint32_t heap_size = 1;
+    bool32_t is_found = FALSE;
+
+    while (heap_size > 0)
+    {
+        uint32_t polygon_index = state->heap[0];
+        state->heap_slots[polygon_index] = SCENE_ID_NONE;
+
+        if (--heap_size > 0)
+        {
+            state->heap[0] = state->heap[heap_size];
+            NavMesh_SiftDown(state, 0, heap_size);
+        }
+
+        ++search->num_expanded_polygons;
+
+        if (polygon_index == goal)
+        {
+            is_found = TRUE;
+            break;
+        }
+
+        const NavMesh_Polygon* polygon = navmesh->polygons + polygon_index;
+        const NavMesh_Link* links = navmesh->links + navmesh->tiles[polygon->tile_index].first_link + polygon->first_link;
+
+        for (uint32_t i = 0; i < polygon->num_links; ++i)
+        {
+            uint32_t neighbor_index = navmesh->tiles[links[i].polygon >> NAVMESH_TILE_POLYGON_BITS].first_polygon + (links[i].polygon & NAVMESH_TILE_POLYGON_MASK);
+            glm::vec3 neighbor_center = navmesh->polygons[neighbor_index].center;
+
+            float cost = state->costs[polygon_index] + glm::distance(polygon->center, neighbor_center);
+
+            bool32_t is_reached = (state->stamps[neighbor_index] == stamp);
+
+            // Closed polygons are final, the distances between centers never overestimate
+            if (is_reached && (state->heap_slots[neighbor_index] == SCENE_ID_NONE || cost >= state->costs[neighbor_index]))
+                continue;
+
+            state->stamps[neighbor_index] = stamp;
+            state->costs[neighbor_index] = cost;
+            state->scores[neighbor_index] = cost + glm::distance(neighbor_center, goal_center);
+            state->parents[neighbor_index] = polygon_index;
+
+            if (!is_reached)
+            {
+                state->heap[heap_size] = neighbor_index;
+                state->heap_slots[neighbor_index] = heap_size;
+                ++heap_size;
+            }
+
+            NavMesh_SiftUp(state, state->heap_slots[neighbor_index]);
+        }
+    }
+
+    if (!is_found)
+        return;
+
+    uint32_t num_polygons = 0;
+
+    for (uint32_t i = goal; i != SCENE_ID_NONE; i = state->parents[i])
+        ++num_polygons;
+
+    if (num_polygons > NAVMESH_MAX_CORRIDOR_LENGTH)
+        return;
+
+    uint32_t corridor_index = num_polygons;
+
+    for (uint32_t i = goal; i != SCENE_ID_NONE; i = state->parents[i])
+        search->corridor[--corridor_index] = i;
+
+    search->num_polygons = num_polygons;
+}
+
+static void NavMesh_LocateTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_QueryBatch* batch = (const NavMesh_QueryBatch*)user_data;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        batch->start_polygons[i] = NavMesh_FindPolygon(batch->navmesh, batch->queries[i].start, NAVMESH_MAX_SNAP_CELLS, batch->start_points + i);
+        batch->goal_polygons[i] = NavMesh_FindPolygon(batch->navmesh, batch->queries[i].goal, NAVMESH_MAX_SNAP_CELLS, batch->goal_points + i);
+    }
+}
+
+static void NavMesh_SearchTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_QueryBatch* batch = (const NavMesh_QueryBatch*)user_data;
+
+    // NOTE: Tasks cover num_searches_per_task searches each, so no two running tasks share a state
+    NavMesh_SearchState* state = batch->search_states + begin / batch->num_searches_per_task;
+
+    for (uint32_t i = begin; i < end; ++i)
+        NavMesh_RunSearch(batch->navmesh, state, batch->searches + i);
+}
+
+// Portal from one polygon of a corridor into the next one, with left and right as seen when walking through it
+static void NavMesh_GetPortal(const NavMesh* navmesh, uint32_t from_index, uint32_t to_index, glm::vec3* out_left, glm::vec3* out_right)
+{
+    const NavMesh_Polygon* from = navmesh->polygons + from_index;
+    const NavMesh_Polygon* to = navmesh->polygons + to_index;
+
+    uint32_t to_polygon = (to->tile_index << NAVMESH_TILE_POLYGON_BITS) | (to_index - navmesh->tiles[to->tile_index].first_polygon);
+    const NavMesh_Link* links = navmesh->links + navmesh->tiles[from->tile_index].first_link + from->first_link;
+
+    glm::vec3 portal_start = 0.5f * (from->center + to->center);
+    glm::vec3 portal_end = portal_start;
+    float best_length = -1.0f;
+
+    // The widest run between the two
+    for (uint32_t i = 0; i < from->num_links; ++i)
+    {
+        if (links[i].polygon != to_polygon)
+            continue;
+
+        glm::vec3 offset = links[i].portal_end - links[i].portal_start;
+        float length = glm::dot(offset, offset);
+
+        if (length > best_length)
+        {
+            portal_start = links[i].portal_start;
+            portal_end = links[i].portal_end;
+            best_length = length;
+        }
+    }
+
+    // The right end is further along the normal on the right of the direction from one center to the other
+    glm::vec3 direction = to->center - from->center;
+
+    float start_side = (portal_start.x - from->center.x) * direction.z - direction.x * (portal_start.z - from->center.z);
+    float end_side = (portal_end.x - from->center.x) * direction.z - direction.x * (portal_end.z - from->center.z);
+
+    *out_left = (start_side > end_side) ? portal_end : portal_start;
+    *out_right = (start_side > end_side) ? portal_start : portal_end;
+}
+
+// Twice the signed area of the triangle on the ground, positive when c is on the right of the line from a to b
+static float NavMesh_GetTriangleArea2(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    return (c.x - a.x) * (b.z - a.z) - (b.x - a.x) * (c.z - a.z);
+}
+
+static bool32_t NavMesh_ArePointsEqual(glm::vec3 a, glm::vec3 b)
+{
+    float x = b.x - a.x;
+    float z = b.z - a.z;
+
+    return x * x + z * z < 1e-6f;
+}
+
+// Pulls the path taut through the portals, the first and the last of which are the start and the goal, with the simple
+// stupid funnel algorithm: the funnel narrows portal by portal until one side crosses the other, where the side it crossed
+// becomes a corner of the path and the funnel starts again from there.
+// Returns the number of points, at most one per portal.
+static uint32_t NavMesh_PullPath(const glm::vec3* lefts, const glm::vec3* rights, uint32_t num_portals, glm::vec3* out_points)
+{
+    glm::vec3 apex = lefts[0];
+    glm::vec3 left = lefts[0];
+    glm::vec3 right = rights[0];
+
+    uint32_t apex_index = 0;
+    uint32_t left_index = 0;
+    uint32_t right_index = 0;
+
+    uint32_t num_points = 0;
+    out_points[num_points++] = apex;
+
+    for (uint32_t i = 1; i < num_portals; ++i)
+    {
+        if (NavMesh_GetTriangleArea2(apex, right, rights[i]) <= 0.0f)
+        {
+            if (NavMesh_ArePointsEqual(apex, right) || NavMesh_GetTriangleArea2(apex, left, rights[i]) > 0.0f)
+            {
+                right = rights[i];
+                right_index = i;
+            }
+            else
+            {
+                apex = left;
+                apex_index = left_index;
+                out_points[num_points++] = apex;
+
+                left = apex;
+                right = apex;
+                left_index = apex_index;
+                right_index = apex_index;
+
+                i = apex_index;
+                continue;
+            }
+        }
+
+        if (NavMesh_GetTriangleArea2(apex, left, lefts[i]) >= 0.0f)
+        {
+            if (NavMesh_ArePointsEqual(apex, left) || NavMesh_GetTriangleArea2(apex, right, lefts[i]) < 0.0f)
+            {
+                left = lefts[i];
+                left_index = i;
+            }
+            else
+            {
+                apex = right;
+                apex_index = right_index;
+                out_points[num_points++] = apex;
+
+                left = apex;
+                right = apex;
+                left_index = apex_index;
+                right_index = apex_index;
+
+                i = apex_index;
+                continue;
+            }
+        }
+    }
+
+    if (apex_index != num_portals - 1)
+        out_points[num_points++] = lefts[num_portals - 1];
+
+    return num_points;
+}
+
+static void NavMesh_PullPathsTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const NavMesh_QueryBatch* batch = (const NavMesh_QueryBatch*)user_data;
+    const NavMesh* navmesh = batch->navmesh;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        NavMesh_Path* path = batch->paths + i;
+
+        const uint32_t* corridor = batch->corridors[i];
+        uint32_t num_polygons = batch->corridor_lengths[i];
+
+        if (num_polygons == 0)
+            continue;
+
+        glm::vec3* lefts = batch->portal_lefts + path->first_point;
+        glm::vec3* rights = batch->portal_rights + path->first_point;
+
+        lefts[0] = batch->start_points[i];
+        rights[0] = batch->start_points[i];
+
+        for (uint32_t j = 0; j + 1 < num_polygons; ++j)
+            NavMesh_GetPortal(navmesh, corridor[j], corridor[j + 1], lefts + j + 1, rights + j + 1);
+
+        lefts[num_polygons] = batch->goal_points[i];
+        rights[num_polygons] = batch->goal_points[i];
+
+        path->num_points = NavMesh_PullPath(lefts, rights, num_polygons + 1, batch->points + path->first_point);
+    }
+}
+
+uint32_t NavMesh_FindPaths(NavMesh* navmesh, const NavMesh_Query* queries, uint32_t num_queries, NavMesh_Path* out_paths, NavMesh_QueryStats* out_stats)
+{
+    ASSERT(num_queries <= NAVMESH_MAX_NUM_QUERIES);
+
+    NavMesh_QueryStats stats;
+    memset(&stats, 0, sizeof(NavMesh_QueryStats));
+
+    stats.num_queries = num_queries;
+
+    Arena* query_arena = &navmesh->query_arena;
+    Arena_Reset(query_arena);
+
+    uint32_t table_capacity = 1;
+
+    while (table_capacity < 2 * num_queries)
+        table_capacity *= 2;
+
+    NavMesh_QueryBatch batch;
+    batch.navmesh = navmesh;
+    batch.queries = queries;
+    batch.paths = out_paths;
+
+    batch.start_points = ARENA_ALLOCATE_ARRAY(query_arena, glm::vec3, num_queries);
+    batch.goal_points = ARENA_ALLOCATE_ARRAY(query_arena, glm::vec3, num_queries);
+    batch.start_polygons = ARENA_ALLOCATE_ARRAY(query_arena, uint32_t, num_queries);
+    batch.goal_polygons = ARENA_ALLOCATE_ARRAY(query_arena, uint32_t, num_queries);
+    batch.corridors = ARENA_ALLOCATE_ARRAY(query_arena, const uint32_t*, num_queries);
+    batch.corridor_lengths = ARENA_ALLOCATE_ARRAY(query_arena, uint32_t, num_queries);
+    batch.searches = ARENA_ALLOCATE_ARRAY(query_arena, NavMesh_Search, num_queries);
+
+    uint32_t* search_indices = ARENA_ALLOCATE_ARRAY(query_arena, uint32_t, num_queries);
+    NavMesh_SearchSlot* table = ARENA_ALLOCATE_ARRAY(query_arena, NavMesh_SearchSlot, table_capacity);
+
+    ASSERT(batch.start_points && batch.goal_points && batch.start_polygons && batch.goal_polygons && batch.corridors);
+    ASSERT(batch.corridor_lengths && batch.searches && search_indices && table);
+
+    Jobs_ParallelFor(num_queries, NAVMESH_NUM_QUERIES_PER_TASK, NavMesh_LocateTask, &batch);
+
+    memset(table, 0xFF, (uint64_t)table_capacity * sizeof(NavMesh_SearchSlot));
+
+    uint32_t table_mask = table_capacity - 1;
+    uint32_t num_searches = 0;
+
+    ++navmesh->cache_tick;
+
+    // Every pair of polygons that is not cached is searched once for all queries that need it
+    for (uint32_t i = 0; i < num_queries; ++i)
+    {
+        NavMesh_Path* path = out_paths + i;
+        path->first_point = 0;
+        path->num_points = 0;
+        path->is_cached = FALSE;
+
+        batch.corridors[i] = NULL;
+        batch.corridor_lengths[i] = 0;
+        search_indices[i] = SCENE_ID_NONE;
+
+        uint32_t start_polygon = batch.start_polygons[i];
+        uint32_t goal_polygon = batch.goal_polygons[i];
+
+        if (start_polygon == SCENE_ID_NONE || goal_polygon == SCENE_ID_NONE)
+            continue;
+
+        uint32_t entry_index = NavMesh_FindCacheEntry(navmesh, start_polygon, goal_polygon);
+
+        if (entry_index != SCENE_ID_NONE)
+        {
+            NavMesh_PathCacheEntry* entry = navmesh->cache_entries + entry_index;
+            entry->last_use = navmesh->cache_tick;
+
+            batch.corridors[i] = navmesh->cache_polygons + (uint64_t)entry_index * NAVMESH_MAX_CORRIDOR_LENGTH;
+            batch.corridor_lengths[i] = entry->num_polygons;
+
+            path->is_cached = TRUE;
+            ++stats.num_cached;
+            continue;
+        }
+
+        uint32_t slot = NavMesh_MixHash(NavMesh_MixHash(0x9E3779B9u, start_polygon), goal_polygon) & table_mask;
+
+        while (table[slot].start_polygon != SCENE_ID_NONE && (table[slot].start_polygon != start_polygon || table[slot].goal_polygon != goal_polygon))
+            slot = (slot + 1) & table_mask;
+
+        if (table[slot].start_polygon != SCENE_ID_NONE)
+        {
+            search_indices[i] = table[slot].search_index;
+
+            path->is_cached = TRUE;
+            ++stats.num_cached;
+            continue;
+        }
+
+        NavMesh_Search* search = batch.searches + num_searches;
+        search->start_polygon = start_polygon;
+        search->goal_polygon = goal_polygon;
+        search->corridor = ARENA_ALLOCATE_ARRAY(query_arena, uint32_t, NAVMESH_MAX_CORRIDOR_LENGTH);
+
+        ASSERT(search->corridor);
+
+        table[slot].start_polygon = start_polygon;
+        table[slot].goal_polygon = goal_polygon;
+        table[slot].search_index = num_searches;
+
+        search_indices[i] = num_searches++;
+    }
+
+    if (num_searches > 0)
+    {
+        NavMesh_PrepareSearchStates(navmesh);
+
+        uint32_t num_tasks = glm::min(num_searches, navmesh->num_search_states);
+
+        batch.search_states = navmesh->search_states;
+        batch.num_searches_per_task = (num_searches + num_tasks - 1) / num_tasks;
+
+        Jobs_ParallelFor(num_searches, batch.num_searches_per_task, NavMesh_SearchTask, &batch);
+    }
+
+    for (uint32_t i = 0; i < num_searches; ++i)
+    {
+        NavMesh_InsertCacheEntry(navmesh, batch.searches + i);
+        stats.num_expanded_polygons += batch.searches[i].num_expanded_polygons;
+    }
+
+    // Room for a point per portal, the start and the goal included
+    uint32_t num_points = 0;
+
+    for (uint32_t i = 0; i < num_queries; ++i)
+    {
+        if (search_indices[i] != SCENE_ID_NONE)
+        {
+            batch.corridors[i] = batch.searches[search_indices[i]].corridor;
+            batch.corridor_lengths[i] = batch.searches[search_indices[i]].num_polygons;
+        }
+
+        out_paths[i].first_point = num_points;
+
+        if (batch.corridor_lengths[i] > 0)
+            num_points += batch.corridor_lengths[i] + 1;
+    }
+
+    batch.points = ARENA_ALLOCATE_ARRAY(query_arena, glm::vec3, num_points);
+    batch.portal_lefts = ARENA_ALLOCATE_ARRAY(query_arena, glm::vec3, num_points);
+    batch.portal_rights = ARENA_ALLOCATE_ARRAY(query_arena, glm::vec3, num_points);
+
+    ASSERT((batch.points && batch.portal_lefts && batch.portal_rights) || num_points == 0);
+
+    Jobs_ParallelFor(num_queries, NAVMESH_NUM_QUERIES_PER_TASK, NavMesh_PullPathsTask, &batch);
+
+    navmesh->path_points = batch.points;
+
+    for (uint32_t i = 0; i < num_queries; ++i)
+        stats.num_found += (out_paths[i].num_points > 0);
+
+    stats.num_searches = num_searches;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return stats.num_found;
+}
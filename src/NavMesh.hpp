@@ -0,0 +1,235 @@
+#ifndef NAVMESH_HPP_
+#define NAVMESH_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+// Cells per side of a tile, edits rebuild the tiles around the faces they changed
+#define NAVMESH_TILE_SIZE 32
+#define NAVMESH_NUM_TILE_CELLS (NAVMESH_TILE_SIZE * NAVMESH_TILE_SIZE)
+
+// Walkable surfaces above each other in one cell, the highest ones are dropped past this many
+#define NAVMESH_MAX_NUM_LAYERS 4
+
+// Polygons are rectangles of cells, with at most this many cells per side
+#define NAVMESH_MAX_POLYGON_SIZE 16
+
+// Links name polygons by their tile and their index in it, which fits into this many bits as a tile has at most
+// NAVMESH_NUM_TILE_CELLS * NAVMESH_MAX_NUM_LAYERS polygons
+#define NAVMESH_TILE_POLYGON_BITS 12
+#define NAVMESH_TILE_POLYGON_MASK (((uint32_t)1 << NAVMESH_TILE_POLYGON_BITS) - 1)
+
+#define NAVMESH_MAX_NUM_TILES ((uint32_t)1 << 16)
+#define NAVMESH_MAX_NUM_SPANS ((uint32_t)1 << 22)
+
+// Tiles rebuilt in one batch, their clearance rays are cast together across the job threads
+#define NAVMESH_NUM_TILES_PER_BATCH 16
+
+// Paths through more polygons than this are not found
+#define NAVMESH_MAX_CORRIDOR_LENGTH 512
+
+// Queries of one NavMesh_FindPaths call
+#define NAVMESH_MAX_NUM_QUERIES ((uint32_t)1 << 16)
+
+// Query points that are not above a walkable cell are moved onto the nearest one within this many cells
+#define NAVMESH_MAX_SNAP_CELLS 4
+
+// Searched corridors are kept in a set associative cache, the least recently used one of a set is replaced
+#define NAVMESH_PATH_CACHE_NUM_SETS 256
+#define NAVMESH_PATH_CACHE_NUM_WAYS 4
+
+struct NavMesh_Settings
+{
+    float cell_size;    // Width of the columns the walkable surfaces are sampled in
+    float agent_radius; // Cells closer than this to a wall or a ledge are not walkable
+    float agent_height; // Free space needed above a walkable cell
+    float max_climb;    // Neighboring cells connect when their heights differ by at most this much
+    float max_slope;    // In radians, steeper faces are not walkable
+};
+
+// Walkable surface in a cell
+struct NavMesh_Span
+{
+    float    height;
+    uint32_t polygon; // Index in its tile
+};
+
+// Rectangle of connected spans of one tile, the nodes of the graph that paths are searched in
+struct NavMesh_Polygon
+{
+    glm::vec3 center;
+    uint32_t  tile_index;
+
+    // Cells of the tile it covers, inclusive
+    uint8_t min_x;
+    uint8_t min_z;
+    uint8_t max_x;
+    uint8_t max_z;
+
+    // Relative to the first link of the tile
+    uint32_t first_link;
+    uint32_t num_links;
+};
+
+// Edge of the graph, one for every run of cells along a side of the polygon that connect to the same polygon
+struct NavMesh_Link
+{
+    uint32_t polygon; // Tile index << NAVMESH_TILE_POLYGON_BITS | index in the tile
+
+    // Halfway between the first and the last cell of the run and the cells they connect to
+    glm::vec3 portal_start;
+    glm::vec3 portal_end;
+};
+
+struct NavMesh_Tile
+{
+    uint32_t first_span;
+    uint32_t num_spans;
+    uint32_t first_polygon; // Polygons are numbered tile after tile in the searches
+    uint32_t num_polygons;
+    uint32_t first_link;
+    uint32_t num_links;
+};
+
+struct NavMesh_PathCacheEntry
+{
+    uint32_t start_polygon; // SCENE_ID_NONE for empty entries
+    uint32_t goal_polygon;
+    uint32_t num_polygons;  // Of the corridor, 0 when there is no path
+    uint32_t last_use;
+};
+
+// What a search task knows about every polygon, entries with another stamp than the search are left from earlier ones
+struct NavMesh_SearchState
+{
+    float*    costs;      // From the start
+    float*    scores;     // Cost plus the distance to the goal
+    uint32_t* parents;
+    uint32_t* stamps;
+    uint32_t* heap_slots; // Where the polygon is in the heap, SCENE_ID_NONE once it is closed
+    uint32_t* heap;       // Open polygons ordered by score
+    uint32_t  stamp;
+};
+
+// Navigation mesh of the walkable faces of a scene. Faces that are flat enough are sampled in a grid of columns, the samples
+// without room for the agent above them or within its radius of a wall or a ledge are dropped, and the rest are merged into
+// rectangles per tile. Paths are searched with A* over the rectangles and pulled straight through the portals between them.
+struct NavMesh
+{
+    NavMesh_Settings settings;
+
+    // Faces and their bounds as of the last update, to find the ones that changed
+    Scene_FaceTracker face_tracker;
+
+    // Tiles cover the walkable faces with a margin, a walkable face outside of them makes the next update rebuild everything
+    float    origin_x;
+    float    origin_z;
+    uint32_t num_tiles_x;
+    uint32_t num_tiles_z;
+
+    // Holds the tiles and the first span of every cell, sized at build time
+    Arena         tile_arena;
+    NavMesh_Tile* tiles;
+    uint16_t*     cell_first_spans; // NAVMESH_NUM_TILE_CELLS per tile, relative to the first span of the tile
+
+    // Updates copy the tiles that stay from one buffer into the other one, with the rebuilt tiles written in between
+    Arena            span_arenas[2];
+    Arena            polygon_arenas[2];
+    Arena            link_arenas[2];
+    uint32_t         buffer_index;
+    NavMesh_Span*    spans;
+    NavMesh_Polygon* polygons;
+    NavMesh_Link*    links;
+    uint32_t         num_spans;
+    uint32_t         num_polygons;
+    uint32_t         num_links;
+
+    // Corridors of recent searches, cleared whenever a tile is rebuilt
+    Arena                   cache_arena;
+    NavMesh_PathCacheEntry* cache_entries;  // NAVMESH_PATH_CACHE_NUM_WAYS per set
+    uint32_t*               cache_polygons; // NAVMESH_MAX_CORRIDOR_LENGTH per entry
+    uint32_t                cache_tick;
+
+    // Holds the paths of the last NavMesh_FindPaths and what its queries need until they are done
+    Arena      query_arena;
+    glm::vec3* path_points;
+
+    // One search state per task, created again with more room when the polygons outgrow them
+    Arena                search_arena;
+    NavMesh_SearchState* search_states;
+    uint32_t             num_search_states;
+    uint32_t             search_capacity;
+
+    // Set until the first build and by NavMesh_Invalidate, the faces alone can not tell that
+    bool32_t needs_rebuild;
+};
+
+struct NavMesh_UpdateStats
+{
+    bool32_t was_rebuilt;
+
+    // A face that changed was removed and added again, faces that only moved to another index are neither
+    uint32_t num_added_faces;
+    uint32_t num_removed_faces;
+
+    uint32_t num_tiles;
+    uint32_t num_rebuilt_tiles;
+    uint64_t num_rays;          // Clearance rays of the rebuilt tiles
+
+    uint32_t num_spans;
+    uint32_t num_polygons;
+    uint32_t num_links;
+};
+
+struct NavMesh_Query
+{
+    glm::vec3 start;
+    glm::vec3 goal;
+};
+
+// Points of the path in path_points of the navmesh, num_points is 0 when there is none
+struct NavMesh_Path
+{
+    uint32_t first_point;
+    uint32_t num_points;
+    bool32_t is_cached; // The corridor came from the cache or from another query of the batch
+};
+
+struct NavMesh_QueryStats
+{
+    uint32_t num_queries;
+    uint32_t num_found;
+    uint32_t num_cached;
+    uint32_t num_searches;
+    uint64_t num_expanded_polygons;
+};
+
+// NOTE: Reserves search states for the threads of the job system, which has to be started first
+bool32_t NavMesh_Init(NavMesh* navmesh, const NavMesh_Settings* settings);
+
+void NavMesh_Destroy(NavMesh* navmesh);
+
+// Makes the next NavMesh_Update rebuild every tile, after the settings were changed
+void NavMesh_Invalidate(NavMesh* navmesh);
+
+// Finds the faces that changed since the last update and rebuilds the tiles they reach into, the radius of the agent
+// included. Faces are recognized by their corners, so faces that only got another index change nothing.
+// Returns FALSE when the grid needs more than NAVMESH_MAX_NUM_TILES tiles or the walkable cells more than
+// NAVMESH_MAX_NUM_SPANS spans, the navmesh is left empty then.
+bool32_t NavMesh_Update(NavMesh* navmesh, Scene* scene, NavMesh_UpdateStats* out_stats);
+
+// Returns the polygon under the point, or the one of the nearest walkable cell within max_snap_cells cells of it, and the
+// point moved onto it. SCENE_ID_NONE when there is none.
+uint32_t NavMesh_FindPolygon(const NavMesh* navmesh, glm::vec3 point, uint32_t max_snap_cells, glm::vec3* out_point);
+
+// Finds the paths of up to NAVMESH_MAX_NUM_QUERIES queries, searching every pair of start and goal polygons that is not
+// cached once, across the job threads. Paths start and end at the query points, moved onto the navmesh within
+// NAVMESH_MAX_SNAP_CELLS cells.
+// NOTE: The points are valid until the next call
+// Returns the number of paths found.
+uint32_t NavMesh_FindPaths(NavMesh* navmesh, const NavMesh_Query* queries, uint32_t num_queries, NavMesh_Path* out_paths, NavMesh_QueryStats* out_stats);
+
+#endif // !NAVMESH_HPP_
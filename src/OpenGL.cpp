@@ -40,6 +40,7 @@ PFN_glBufferData glBufferData;
 PFN_glMapBufferRange glMapBufferRange;
 PFN_glFlushMappedBufferRange glFlushMappedBufferRange;
 PFN_glDrawElements glDrawElements;
+PFN_glMultiDrawElements glMultiDrawElements;
 PFN_glPolygonMode glPolygonMode;
 PFN_glCreateVertexArrays glCreateVertexArrays;
 PFN_glVertexArrayVertexBuffer glVertexArrayVertexBuffer;
@@ -61,8 +62,17 @@ PFN_glVertexAttribIPointer glVertexAttribIPointer;
 PFN_glDrawElementsBaseVertex glDrawElementsBaseVertex;
 PFN_glUniform3fv glUniform3fv;
 PFN_glUniform1f glUniform1f;
+PFN_glUniform4uiv glUniform4uiv;
 PFN_glBindBufferBase glBindBufferBase;
 PFN_glDrawElementsInstancedBaseVertexBaseInstance glDrawElementsInstancedBaseVertexBaseInstance;
+PFN_glNamedBufferSubData glNamedBufferSubData;
+PFN_glDeleteBuffers glDeleteBuffers;
+PFN_glCreateTextures glCreateTextures;
+PFN_glTextureStorage2D glTextureStorage2D;
+PFN_glTextureSubImage2D glTextureSubImage2D;
+PFN_glTextureParameteri glTextureParameteri;
+PFN_glBindTextureUnit glBindTextureUnit;
+PFN_glDeleteTextures glDeleteTextures;
 
 #define OPENGL_LOAD_FUNCTION(get_proc_address, name) \
 {                                                    \
@@ -108,6 +118,7 @@ bool32_t OpenGL_LoadFunctions(OpenGL_PFN_GetProcAddress get_opengl_proc_address)
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glMapBufferRange);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glFlushMappedBufferRange);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glDrawElements);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glMultiDrawElements);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glPolygonMode);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glCreateVertexArrays);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glVertexArrayVertexBuffer);
@@ -129,8 +140,17 @@ bool32_t OpenGL_LoadFunctions(OpenGL_PFN_GetProcAddress get_opengl_proc_address)
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glDrawElementsBaseVertex);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glUniform3fv);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glUniform1f);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glUniform4uiv);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glBindBufferBase);
     OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glDrawElementsInstancedBaseVertexBaseInstance);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glNamedBufferSubData);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glDeleteBuffers);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glCreateTextures);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glTextureStorage2D);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glTextureSubImage2D);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glTextureParameteri);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glBindTextureUnit);
+    OPENGL_LOAD_FUNCTION(get_opengl_proc_address, glDeleteTextures);
 
     return TRUE;
 }
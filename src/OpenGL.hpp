@@ -46,6 +46,9 @@ typedef void (APIENTRYP GLDEBUGPROC)(GLenum source, GLenum type, GLuint id, GLen
 #define GL_VERSION 0x1F02
 #define GL_EXTENSIONS 0x1F03
 #define GL_NUM_EXTENSIONS 0x821D
+#define GL_UNSIGNED_BYTE 0x1401
+#define GL_SHORT 0x1402
+#define GL_UNSIGNED_SHORT 0x1403
 #define GL_UNSIGNED_INT 0x1405
 #define GL_FLOAT 0x1406
 #define GL_DEBUG_SOURCE_API 0x8246
@@ -94,6 +97,16 @@ typedef void (APIENTRYP GLDEBUGPROC)(GLenum source, GLenum type, GLuint id, GLen
 #define GL_INT 0x1404
 #define GL_LINES 0x0001
 #define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_TEXTURE_2D 0x0DE1
+#define GL_RGBA 0x1908
+#define GL_RGBA8 0x8058
+#define GL_TEXTURE_MAG_FILTER 0x2800
+#define GL_TEXTURE_MIN_FILTER 0x2801
+#define GL_TEXTURE_WRAP_S 0x2802
+#define GL_TEXTURE_WRAP_T 0x2803
+#define GL_LINEAR 0x2601
+#define GL_CLAMP_TO_EDGE 0x812F
 
 typedef const GLubyte* (APIENTRYP PFN_glGetString)(GLenum name);
 typedef const GLubyte* (APIENTRYP PFN_glGetStringi)(GLenum name, GLuint index);
@@ -131,6 +144,7 @@ typedef void (APIENTRYP PFN_glBufferData)(GLenum target, GLsizeiptr size, const
 typedef void* (APIENTRYP PFN_glMapBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
 typedef void (APIENTRYP PFN_glFlushMappedBufferRange)(GLenum target, GLintptr offset, GLsizeiptr length);
 typedef void (APIENTRYP PFN_glDrawElements)(GLenum mode, GLsizei count, GLenum type, const void* indices);
+typedef void (APIENTRYP PFN_glMultiDrawElements)(GLenum mode, const GLsizei* count, GLenum type, const void* const* indices, GLsizei drawcount);
 typedef void (APIENTRYP PFN_glPolygonMode)(GLenum face, GLenum mode);
 typedef void (APIENTRYP PFN_glCreateVertexArrays)(GLsizei n, GLuint* arrays);
 typedef void (APIENTRYP PFN_glVertexArrayVertexBuffer)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
@@ -152,8 +166,17 @@ typedef void (APIENTRYP PFN_glVertexAttribIPointer)(GLuint index, GLint size, GL
 typedef void (APIENTRYP PFN_glDrawElementsBaseVertex)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint basevertex);
 typedef void (APIENTRYP PFN_glUniform3fv)(GLint location, GLsizei count, const GLfloat* value);
 typedef void (APIENTRYP PFN_glUniform1f)(GLint location, GLfloat v0);
+typedef void (APIENTRYP PFN_glUniform4uiv)(GLint location, GLsizei count, const GLuint* value);
 typedef void (APIENTRYP PFN_glBindBufferBase)(GLenum target, GLuint index, GLuint buffer);
 typedef void (APIENTRYP PFN_glDrawElementsInstancedBaseVertexBaseInstance)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+typedef void (APIENTRYP PFN_glNamedBufferSubData)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+typedef void (APIENTRYP PFN_glDeleteBuffers)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRYP PFN_glCreateTextures)(GLenum target, GLsizei n, GLuint* textures);
+typedef void (APIENTRYP PFN_glTextureStorage2D)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP PFN_glTextureSubImage2D)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels);
+typedef void (APIENTRYP PFN_glTextureParameteri)(GLuint texture, GLenum pname, GLint param);
+typedef void (APIENTRYP PFN_glBindTextureUnit)(GLuint unit, GLuint texture);
+typedef void (APIENTRYP PFN_glDeleteTextures)(GLsizei n, const GLuint* textures);
 
 extern PFN_glGetString glGetString;
 extern PFN_glGetStringi glGetStringi;
@@ -191,6 +214,7 @@ extern PFN_glBufferData glBufferData;
 extern PFN_glMapBufferRange glMapBufferRange;
 extern PFN_glFlushMappedBufferRange glFlushMappedBufferRange;
 extern PFN_glDrawElements glDrawElements;
+extern PFN_glMultiDrawElements glMultiDrawElements;
 extern PFN_glPolygonMode glPolygonMode;
 extern PFN_glCreateVertexArrays glCreateVertexArrays;
 extern PFN_glVertexArrayVertexBuffer glVertexArrayVertexBuffer;
@@ -212,8 +236,17 @@ extern PFN_glVertexAttribIPointer glVertexAttribIPointer;
 extern PFN_glDrawElementsBaseVertex glDrawElementsBaseVertex;
 extern PFN_glUniform3fv glUniform3fv;
 extern PFN_glUniform1f glUniform1f;
+extern PFN_glUniform4uiv glUniform4uiv;
 extern PFN_glBindBufferBase glBindBufferBase;
 extern PFN_glDrawElementsInstancedBaseVertexBaseInstance glDrawElementsInstancedBaseVertexBaseInstance;
+extern PFN_glNamedBufferSubData glNamedBufferSubData;
+extern PFN_glDeleteBuffers glDeleteBuffers;
+extern PFN_glCreateTextures glCreateTextures;
+extern PFN_glTextureStorage2D glTextureStorage2D;
+extern PFN_glTextureSubImage2D glTextureSubImage2D;
+extern PFN_glTextureParameteri glTextureParameteri;
+extern PFN_glBindTextureUnit glBindTextureUnit;
+extern PFN_glDeleteTextures glDeleteTextures;
 
 bool32_t OpenGL_LoadFunctions(OpenGL_PFN_GetProcAddress get_opengl_proc_address);
 
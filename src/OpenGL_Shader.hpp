@@ -2,6 +2,8 @@
 #define OPENGL_SHADER_HPP_
 
 #include "OpenGL.hpp"
+#include "Geometry.hpp"
+#include "Lightmap.hpp"
 
 // TODO: Use glShaderSource for concating the shader source strings
 
@@ -22,18 +24,36 @@ layout (location = 1) uniform mat4 u_view;
 layout (location = 2) uniform mat4 u_model;
 
 layout (location = 3) uniform uint u_selected_face_id;
+layout (location = 4) uniform uvec4 u_selected_edge_corner_ids; // Corners at both ends of the edge on both of its sides
+
+layout (location = 6) uniform uint u_ao_num_vertices; // Zero when the ambient occlusion is off
+
+// One value per geometry vertex, in the order the vertices are written in
+layout (std430, binding = 2) readonly buffer AOValues
+{
+	float ao_values[];
+};
 
 out vec3 v_normal;
 out vec4 v_color;
+out vec3 v_position; // Before u_model, where the lightmap charts are
+flat out uint v_face_id;
+out float v_ambient_occlusion;
 
 void main()
 {
 	uint vertex_id = a_cell_ids.x;
+	uint corner_id = a_cell_ids.y;
 	uint face_id = a_cell_ids.z;
 
 	vec4 pick_color = vec4(0.0, 0.7, 0.7, 1.0);
+	vec4 edge_pick_color = vec4(0.9, 0.6, 0.0, 1.0);
 
-	if (u_selected_face_id == face_id)
+	if (any(equal(uvec4(corner_id), u_selected_edge_corner_ids)))
+	{
+		v_color = edge_pick_color;
+	}
+	else if (u_selected_face_id == face_id)
 	{
 		v_color = pick_color;
 	}
@@ -43,17 +63,121 @@ void main()
 	}
 
 	v_normal = (u_model * vec4(a_normal.xyz, 0.0)).xyz; // NOTE: This is technically not correct
+	v_position = a_position.xyz;
+	v_face_id = face_id;
+
+	// NOTE: The scene is drawn without a base vertex, so the vertex id is the index of the geometry vertex
+	v_ambient_occlusion = (uint(gl_VertexID) < u_ao_num_vertices) ? ao_values[gl_VertexID] : 1.0;
+
+	gl_Position = u_projection * u_view * u_model * vec4(a_position.xyz, 1.0);
+}
+
+)sh";
+
+// Same as OpenGL_Shader_Scene_VertexSource for SPackedVertex
+inline const char* const OpenGL_Shader_Scene_Packed_VertexSource = OPENGL_SHADER_GLSL_VERSION_STR OPENGL_SHADER_GLSL_EXTENSIONS_STR
+"const float packed_position_steps_per_unit = " STR(GEOMETRY_PACKED_POSITION_STEPS_PER_UNIT) ";\n"
+"const uint packed_position_num_chunks_per_axis = " STR(GEOMETRY_PACKED_POSITION_NUM_CHUNKS_PER_AXIS) ";\n"
+R"sh(
+
+layout (location = 0) in uvec4 a_position; // Offset inside the chunk and the chunk
+layout (location = 1) in vec2  a_normal;
+layout (location = 2) in vec4  a_color;
+layout (location = 3) in uvec2 a_cell_ids;
+
+layout (location = 0) uniform mat4 u_projection;
+layout (location = 1) uniform mat4 u_view;
+layout (location = 2) uniform mat4 u_model;
+
+layout (location = 3) uniform uint u_selected_face_id;
+layout (location = 4) uniform uvec4 u_selected_edge_corner_ids; // Corners at both ends of the edge on both of its sides
+
+layout (location = 6) uniform uint u_ao_num_vertices; // Zero when the ambient occlusion is off
+
+// One value per geometry vertex, in the order the vertices are written in
+layout (std430, binding = 2) readonly buffer AOValues
+{
+	float ao_values[];
+};
+
+out vec3 v_normal;
+out vec4 v_color;
+out vec3 v_position; // Before u_model, where the lightmap charts are
+flat out uint v_face_id;
+out float v_ambient_occlusion;
+
+vec3 DecodePosition(uvec4 packed_position)
+{
+	uvec3 chunk = (uvec3(packed_position.w) >> uvec3(0, 5, 10)) & 31u;
+	vec3 steps = vec3(chunk * 65536u + packed_position.xyz) - float(packed_position_num_chunks_per_axis * 32768u);
+
+	return steps / packed_position_steps_per_unit;
+}
+
+vec3 DecodeNormal(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	// Unfolds the lower half of the octahedron
+	float fold = max(-normal.z, 0.0);
+	normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
 
-	gl_Position = u_projection * u_view * u_model * vec4(a_position.xyz + vec3(float(gl_DrawIDARB), 0.0, 0.0), 1.0);
+	return normalize(normal);
+}
+
+void main()
+{
+	uint corner_id = a_cell_ids.x;
+	uint face_id = a_cell_ids.y;
+
+	vec4 pick_color = vec4(0.0, 0.7, 0.7, 1.0);
+	vec4 edge_pick_color = vec4(0.9, 0.6, 0.0, 1.0);
+
+	if (any(equal(uvec4(corner_id), u_selected_edge_corner_ids)))
+	{
+		v_color = edge_pick_color;
+	}
+	else if (u_selected_face_id == face_id)
+	{
+		v_color = pick_color;
+	}
+	else
+	{
+		v_color = a_color;
+	}
+
+	v_normal = (u_model * vec4(DecodeNormal(a_normal), 0.0)).xyz; // NOTE: This is technically not correct
+	v_position = DecodePosition(a_position);
+	v_face_id = face_id;
+
+	// NOTE: The scene is drawn without a base vertex, so the vertex id is the index of the geometry vertex
+	v_ambient_occlusion = (uint(gl_VertexID) < u_ao_num_vertices) ? ao_values[gl_VertexID] : 1.0;
+
+	gl_Position = u_projection * u_view * u_model * vec4(v_position, 1.0);
 }
 
 )sh";
 
 inline const char* const OpenGL_Shader_Scene_FragmentSource = OPENGL_SHADER_GLSL_VERSION_STR OPENGL_SHADER_GLSL_EXTENSIONS_STR
+"const float lightmap_atlas_size = " STR(LIGHTMAP_ATLAS_SIZE) ";\n"
+"const float lightmap_max_value = " STR(LIGHTMAP_MAX_VALUE) ";\n"
 R"sh(
 
 in vec4 v_color;
 in vec3 v_normal;
+in vec3 v_position;
+flat in uint v_face_id;
+in float v_ambient_occlusion;
+
+layout (location = 5) uniform uint u_lightmap_num_faces; // Zero when the lightmap is off
+
+layout (binding = 0) uniform sampler2D u_lightmap;
+
+// Two planes per face that map positions on the face to texels of the lightmap
+layout (std430, binding = 1) readonly buffer LightmapCharts
+{
+	vec4 lightmap_chart_planes[];
+};
 
 out vec4 o_color;
 
@@ -62,8 +186,22 @@ const vec3 light_direction = vec3(0.0, 0.0, -1.0);
 
 void main()
 {
-	float light_factor = max(0.0, -dot(v_normal, light_direction)) * (1 - light_bias) + light_bias;
-	o_color = light_factor * v_color;
+	vec3 light = vec3(max(0.0, -dot(v_normal, light_direction)) * (1 - light_bias) + light_bias);
+
+	if (v_face_id < u_lightmap_num_faces)
+	{
+		vec4 plane_u = lightmap_chart_planes[v_face_id * 2u + 0u];
+		vec4 plane_v = lightmap_chart_planes[v_face_id * 2u + 1u];
+
+		// Faces without a chart have zero planes
+		if (plane_u != vec4(0.0))
+		{
+			vec2 texel = vec2(dot(plane_u, vec4(v_position, 1.0)), dot(plane_v, vec4(v_position, 1.0)));
+			light = texture(u_lightmap, texel / lightmap_atlas_size).rgb * lightmap_max_value;
+		}
+	}
+
+	o_color = vec4(light * v_ambient_occlusion * v_color.rgb, v_color.a);
 }
 
 )sh";
@@ -151,6 +289,12 @@ void main()
 	}
 	
 	gl_Position = u_projection * position;
+
+	// Deleted vertices have a zero w and are put past the far plane
+	if (base_position.w == 0.0)
+	{
+		gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+	}
 }
 
 )sh";
@@ -0,0 +1,465 @@
+#include "PVS.hpp"
+#include "Jobs.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define PVS_ARENA_CAPACITY ((uint64_t)SCENE_MAX_NUM_CLUSTERS / 8 + 1 + ((uint64_t)PVS_MAX_NUM_CELLS + 1) * sizeof(uint64_t) + ARENA_COMMIT_GRANULARITY)
+
+struct PVS_Batch
+{
+    PVS*         pvs;
+    uint32_t     first_cell;
+    uint32_t     num_rays_per_cell;
+    float        max_ray_length;
+
+    Scene_Ray*    rays;
+    Scene_RayHit* hits;
+
+    // Every cell of the batch builds its row and compresses it into slots of its own
+    uint8_t*  rows;
+    uint8_t*  compressed_rows;
+    uint32_t* compressed_row_sizes;
+    uint32_t* num_visible_clusters;
+
+    // Range of cells every cluster reaches into
+    const uint32_t* cluster_cell_ranges;
+};
+
+bool32_t PVS_Init(PVS* pvs)
+{
+    memset(pvs, 0, sizeof(PVS));
+
+    if (!Arena_CreateReserved(&pvs->arena, PVS_ARENA_CAPACITY) ||
+        !Arena_CreateReserved(&pvs->data_arena, PVS_MAX_DATA_SIZE))
+    {
+        PVS_Destroy(pvs);
+        return FALSE;
+    }
+
+    pvs->data = (uint8_t*)pvs->data_arena.memory;
+    pvs->visible_cell = SCENE_ID_NONE;
+
+    return TRUE;
+}
+
+void PVS_Destroy(PVS* pvs)
+{
+    Arena_Destroy(&pvs->data_arena);
+    Arena_Destroy(&pvs->arena);
+
+    memset(pvs, 0, sizeof(PVS));
+}
+
+void PVS_Clear(PVS* pvs)
+{
+    Arena_Reset(&pvs->arena);
+    Arena_Reset(&pvs->data_arena);
+
+    pvs->num_clusters = 0;
+    pvs->num_row_bytes = 0;
+
+    pvs->num_cells_x = 0;
+    pvs->num_cells_y = 0;
+    pvs->num_cells_z = 0;
+    pvs->num_cells = 0;
+
+    pvs->cell_offsets = NULL;
+    pvs->visible_clusters = NULL;
+    pvs->visible_cell = SCENE_ID_NONE;
+
+    pvs->num_faces = 0;
+}
+
+// Small hash based generator, every cell starts from its own index so the result does not depend on the threads
+static uint32_t PVS_NextRandom(uint32_t* state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+    return x;
+}
+
+static float PVS_NextRandomFloat(uint32_t* state)
+{
+    return (float)(PVS_NextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Returns the size of the compressed row, which is num_row_bytes when the row is stored as it is because compressing it
+// would not make it smaller
+static uint32_t PVS_CompressRow(const uint8_t* row, uint32_t num_row_bytes, uint8_t* out_data)
+{
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < num_row_bytes; )
+    {
+        // NOTE: Compressed rows stay below num_row_bytes, which is how they are told apart from the others
+        if (size + ((row[i] != 0) ? 1 : 2) >= num_row_bytes)
+        {
+            memcpy(out_data, row, num_row_bytes);
+            return num_row_bytes;
+        }
+
+        if (row[i] != 0)
+        {
+            out_data[size++] = row[i++];
+            continue;
+        }
+
+        uint32_t run_length = 0;
+
+        while (i < num_row_bytes && row[i] == 0 && run_length < 255)
+        {
+            ++run_length;
+            ++i;
+        }
+
+        out_data[size++] = 0;
+        out_data[size++] = (uint8_t)run_length;
+    }
+
+    return size;
+}
+
+static void PVS_GenerateRaysTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const PVS_Batch* batch = (const PVS_Batch*)user_data;
+    const PVS* pvs = batch->pvs;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t cell_index = batch->first_cell + i;
+
+        uint32_t x = cell_index % pvs->num_cells_x;
+        uint32_t y = (cell_index / pvs->num_cells_x) % pvs->num_cells_y;
+        uint32_t z = cell_index / (pvs->num_cells_x * pvs->num_cells_y);
+
+        glm::vec3 cell_min = pvs->bounds_min + glm::vec3((float)x, (float)y, (float)z) * pvs->cell_size;
+
+        uint32_t random_state = (cell_index + 1) * 0x9E3779B9u;
+        random_state ^= random_state >> 16;
+        random_state = random_state ? random_state : 1;
+
+        Scene_Ray* rays = batch->rays + (uint64_t)i * batch->num_rays_per_cell;
+
+        // Directions are stratified over the sphere, each stratum jittered, so that few rays already cover every direction
+        for (uint32_t j = 0; j < batch->num_rays_per_cell; ++j)
+        {
+            glm::vec3 offset = { PVS_NextRandomFloat(&random_state), PVS_NextRandomFloat(&random_state), PVS_NextRandomFloat(&random_state) };
+
+            float cos_theta = 1.0f - 2.0f * ((float)j + PVS_NextRandomFloat(&random_state)) / (float)batch->num_rays_per_cell;
+            float sin_theta = sqrtf(glm::max(0.0f, 1.0f - cos_theta * cos_theta));
+            float phi = 6.28318530718f * fmodf((float)j * 0.61803398875f + PVS_NextRandomFloat(&random_state), 1.0f);
+
+            Scene_Ray* ray = rays + j;
+            ray->origin = cell_min + offset * pvs->cell_size;
+            ray->min_length = 0.0f;
+            ray->direction = glm::vec3(sin_theta * cosf(phi), cos_theta, sin_theta * sinf(phi));
+            ray->max_length = batch->max_ray_length;
+        }
+    }
+}
+
+static void PVS_CompressRowsTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const PVS_Batch* batch = (const PVS_Batch*)user_data;
+    const PVS* pvs = batch->pvs;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t cell_index = batch->first_cell + i;
+
+        uint32_t x = cell_index % pvs->num_cells_x;
+        uint32_t y = (cell_index / pvs->num_cells_x) % pvs->num_cells_y;
+        uint32_t z = cell_index / (pvs->num_cells_x * pvs->num_cells_y);
+
+        uint8_t* row = batch->rows + (uint64_t)i * pvs->num_row_bytes;
+        memset(row, 0, pvs->num_row_bytes);
+
+        // Geometry in the cell is always visible, no matter whether a ray happened to hit it
+        for (uint32_t j = 0; j < pvs->num_clusters; ++j)
+        {
+            const uint32_t* range = batch->cluster_cell_ranges + 6 * j;
+
+            if (x >= range[0] && x <= range[3] && y >= range[1] && y <= range[4] && z >= range[2] && z <= range[5])
+                row[j >> 3] |= (uint8_t)(1u << (j & 7));
+        }
+
+        const Scene_RayHit* hits = batch->hits + (uint64_t)i * batch->num_rays_per_cell;
+
+        for (uint32_t j = 0; j < batch->num_rays_per_cell; ++j)
+        {
+            if (hits[j].index == SCENE_ID_NONE)
+                continue;
+
+            uint32_t cluster_index = hits[j].index / SCENE_CLUSTER_NUM_FACES;
+            row[cluster_index >> 3] |= (uint8_t)(1u << (cluster_index & 7));
+        }
+
+        uint32_t num_visible_clusters = 0;
+
+        for (uint32_t j = 0; j < pvs->num_row_bytes; ++j)
+        {
+            uint32_t bits = row[j];
+
+            for (; bits != 0; bits &= bits - 1)
+                ++num_visible_clusters;
+        }
+
+        uint8_t* compressed_row = batch->compressed_rows + (uint64_t)i * pvs->num_row_bytes;
+
+        batch->compressed_row_sizes[i] = PVS_CompressRow(row, pvs->num_row_bytes, compressed_row);
+        batch->num_visible_clusters[i] = num_visible_clusters;
+    }
+}
+
+bool32_t PVS_Build(PVS* pvs, Scene* scene, float cell_size, uint32_t num_rays_per_cell, PVS_BuildStats* out_stats)
+{
+    PVS_Clear(pvs);
+
+    PVS_BuildStats stats;
+    memset(&stats, 0, sizeof(PVS_BuildStats));
+
+    glm::vec3 scene_bounds_min( FLT_MAX);
+    glm::vec3 scene_bounds_max(-FLT_MAX);
+
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+    {
+        if (Scene_Vertex_IsDeleted(scene, i))
+            continue;
+
+        scene_bounds_min = glm::min(scene_bounds_min, scene->vertices[i].position);
+        scene_bounds_max = glm::max(scene_bounds_max, scene->vertices[i].position);
+    }
+
+    if (scene->num_faces == 0 || scene_bounds_min.x > scene_bounds_max.x || num_rays_per_cell == 0 || !(cell_size > 0.0f))
+    {
+        if (out_stats)
+            *out_stats = stats;
+
+        return FALSE;
+    }
+
+    // Clusters
+
+    Scene_Clusters_Update(scene);
+
+    uint32_t num_clusters = Scene_GetNumClusters(scene);
+
+    pvs->num_clusters = num_clusters;
+    pvs->num_row_bytes = (num_clusters + 7) / 8;
+
+    // Cells, the grid reaches half a cell past the scene so that cameras right at its edge still find a cell
+
+    glm::vec3 extent = scene_bounds_max - scene_bounds_min + glm::vec3(cell_size);
+
+    for (;;)
+    {
+        uint64_t num_cells_x = (uint64_t)ceilf(extent.x / cell_size);
+        uint64_t num_cells_y = (uint64_t)ceilf(extent.y / cell_size);
+        uint64_t num_cells_z = (uint64_t)ceilf(extent.z / cell_size);
+
+        if (num_cells_x * num_cells_y * num_cells_z <= PVS_MAX_NUM_CELLS)
+        {
+            pvs->num_cells_x = (uint32_t)num_cells_x;
+            pvs->num_cells_y = (uint32_t)num_cells_y;
+            pvs->num_cells_z = (uint32_t)num_cells_z;
+            break;
+        }
+
+        cell_size *= 1.25f;
+        extent = scene_bounds_max - scene_bounds_min + glm::vec3(cell_size);
+    }
+
+    pvs->cell_size = cell_size;
+    pvs->num_cells = pvs->num_cells_x * pvs->num_cells_y * pvs->num_cells_z;
+    pvs->bounds_min = scene_bounds_min - glm::vec3(0.5f * cell_size);
+
+    pvs->cell_offsets = ARENA_ALLOCATE_ARRAY(&pvs->arena, uint64_t, pvs->num_cells + 1);
+    pvs->visible_clusters = ARENA_ALLOCATE_ARRAY(&pvs->arena, uint8_t, pvs->num_row_bytes);
+
+    ASSERT(pvs->cell_offsets && pvs->visible_clusters);
+
+    // Rays are cast batch by batch, with the scratch memory of the scene reused for every batch
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    PVS_Batch batch;
+    batch.pvs = pvs;
+    batch.num_rays_per_cell = num_rays_per_cell;
+    batch.max_ray_length = 2.0f * glm::length(extent);
+
+    uint32_t* cluster_cell_ranges = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, 6 * (uint64_t)num_clusters);
+    batch.rays                 = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_Ray, (uint64_t)PVS_NUM_CELLS_PER_BATCH * num_rays_per_cell);
+    batch.hits                 = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_RayHit, (uint64_t)PVS_NUM_CELLS_PER_BATCH * num_rays_per_cell);
+    batch.rows                 = ARENA_ALLOCATE_ARRAY(scratch_arena, uint8_t, (uint64_t)PVS_NUM_CELLS_PER_BATCH * pvs->num_row_bytes);
+    batch.compressed_rows      = ARENA_ALLOCATE_ARRAY(scratch_arena, uint8_t, (uint64_t)PVS_NUM_CELLS_PER_BATCH * pvs->num_row_bytes);
+    batch.compressed_row_sizes = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, PVS_NUM_CELLS_PER_BATCH);
+    batch.num_visible_clusters = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, PVS_NUM_CELLS_PER_BATCH);
+
+    ASSERT(cluster_cell_ranges && batch.rays && batch.hits && batch.rows && batch.compressed_rows && batch.compressed_row_sizes && batch.num_visible_clusters);
+
+    batch.cluster_cell_ranges = cluster_cell_ranges;
+
+    float inverse_cell_size = 1.0f / cell_size;
+    glm::vec3 max_cell = glm::vec3((float)(pvs->num_cells_x - 1), (float)(pvs->num_cells_y - 1), (float)(pvs->num_cells_z - 1));
+
+    for (uint32_t i = 0; i < num_clusters; ++i)
+    {
+        uint32_t* range = cluster_cell_ranges + 6 * i;
+
+        glm::vec3 bounds_min, bounds_max;
+        Scene_Cluster_GetBounds(scene, i, &bounds_min, &bounds_max);
+
+        if (bounds_min.x > bounds_max.x)
+        {
+            // Empty ranges, the minimum is past the maximum
+            range[0] = range[1] = range[2] = 1;
+            range[3] = range[4] = range[5] = 0;
+            continue;
+        }
+
+        glm::vec3 cell_min = glm::clamp(glm::floor((bounds_min - pvs->bounds_min) * inverse_cell_size), glm::vec3(0.0f), max_cell);
+        glm::vec3 cell_max = glm::clamp(glm::floor((bounds_max - pvs->bounds_min) * inverse_cell_size), glm::vec3(0.0f), max_cell);
+
+        range[0] = (uint32_t)cell_min.x;
+        range[1] = (uint32_t)cell_min.y;
+        range[2] = (uint32_t)cell_min.z;
+        range[3] = (uint32_t)cell_max.x;
+        range[4] = (uint32_t)cell_max.y;
+        range[5] = (uint32_t)cell_max.z;
+    }
+
+    uint64_t data_size = 0;
+    bool32_t build_result = TRUE;
+
+    for (uint32_t first_cell = 0; first_cell < pvs->num_cells && build_result; first_cell += PVS_NUM_CELLS_PER_BATCH)
+    {
+        uint32_t num_batch_cells = glm::min(pvs->num_cells - first_cell, (uint32_t)PVS_NUM_CELLS_PER_BATCH);
+        uint32_t num_batch_rays = num_batch_cells * num_rays_per_cell;
+
+        batch.first_cell = first_cell;
+
+        Jobs_ParallelFor(num_batch_cells, PVS_NUM_CELLS_PER_TASK, PVS_GenerateRaysTask, &batch);
+        Scene_RayCast_FindNearestIntersectingFaces(scene, batch.rays, num_batch_rays, batch.hits);
+        Jobs_ParallelFor(num_batch_cells, PVS_NUM_CELLS_PER_TASK, PVS_CompressRowsTask, &batch);
+
+        for (uint32_t i = 0; i < num_batch_cells; ++i)
+        {
+            uint32_t compressed_row_size = batch.compressed_row_sizes[i];
+
+            if (!Arena_CanAllocateRegion(&pvs->data_arena, compressed_row_size, 1))
+            {
+                build_result = FALSE;
+                break;
+            }
+
+            uint8_t* compressed_row = ARENA_ALLOCATE_ARRAY(&pvs->data_arena, uint8_t, compressed_row_size);
+            ASSERT(compressed_row == pvs->data + data_size || compressed_row_size == 0);
+
+            memcpy(compressed_row, batch.compressed_rows + (uint64_t)i * pvs->num_row_bytes, compressed_row_size);
+
+            pvs->cell_offsets[first_cell + i] = data_size;
+            data_size += compressed_row_size;
+
+            stats.num_visible_clusters += batch.num_visible_clusters[i];
+        }
+
+        stats.num_rays += num_batch_rays;
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    if (!build_result)
+    {
+        PVS_Clear(pvs);
+
+        if (out_stats)
+            *out_stats = stats;
+
+        return FALSE;
+    }
+
+    pvs->cell_offsets[pvs->num_cells] = data_size;
+    pvs->num_faces = scene->num_faces;
+
+    stats.num_clusters = num_clusters;
+    stats.num_cells = pvs->num_cells;
+    stats.cell_size = cell_size;
+    stats.num_row_bytes = (uint64_t)pvs->num_cells * pvs->num_row_bytes;
+    stats.num_data_bytes = data_size;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    return TRUE;
+}
+
+uint32_t PVS_FindCell(const PVS* pvs, glm::vec3 position)
+{
+    if (pvs->num_cells == 0)
+        return SCENE_ID_NONE;
+
+    glm::vec3 cell = glm::floor((position - pvs->bounds_min) / pvs->cell_size);
+
+    // NOTE: The comparisons are written so that NaN positions fail them too
+    if (!(cell.x >= 0.0f && cell.y >= 0.0f && cell.z >= 0.0f) ||
+        !(cell.x < (float)pvs->num_cells_x && cell.y < (float)pvs->num_cells_y && cell.z < (float)pvs->num_cells_z))
+    {
+        return SCENE_ID_NONE;
+    }
+
+    return ((uint32_t)cell.z * pvs->num_cells_y + (uint32_t)cell.y) * pvs->num_cells_x + (uint32_t)cell.x;
+}
+
+void PVS_DecompressRow(const PVS* pvs, uint32_t cell_index, uint8_t* out_row)
+{
+    const uint8_t* data = pvs->data + pvs->cell_offsets[cell_index];
+    const uint8_t* data_end = pvs->data + pvs->cell_offsets[cell_index + 1];
+
+    if (data_end - data == pvs->num_row_bytes)
+    {
+        memcpy(out_row, data, pvs->num_row_bytes);
+        return;
+    }
+
+    uint32_t size = 0;
+
+    while (data < data_end)
+    {
+        if (*data != 0)
+        {
+            out_row[size++] = *data++;
+            continue;
+        }
+
+        uint32_t run_length = data[1];
+        data += 2;
+
+        memset(out_row + size, 0, run_length);
+        size += run_length;
+    }
+
+    ASSERT(size == pvs->num_row_bytes);
+}
+
+const uint8_t* PVS_GetVisibleClusters(PVS* pvs, glm::vec3 position)
+{
+    uint32_t cell_index = PVS_FindCell(pvs, position);
+
+    if (cell_index == SCENE_ID_NONE)
+        return NULL;
+
+    if (cell_index != pvs->visible_cell)
+    {
+        PVS_DecompressRow(pvs, cell_index, pvs->visible_clusters);
+        pvs->visible_cell = cell_index;
+    }
+
+    return pvs->visible_clusters;
+}
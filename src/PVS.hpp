@@ -0,0 +1,87 @@
+#ifndef PVS_HPP_
+#define PVS_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Scene.hpp"
+
+#include <glm/glm.hpp>
+
+// The cells grow beyond the requested size when the grid would get more of them than this
+#define PVS_MAX_NUM_CELLS ((uint32_t)1 << 16)
+
+// Compressed rows of all cells together
+#define PVS_MAX_DATA_SIZE ((uint64_t)1 << 32)
+
+// Rays of this many cells are cast in one batch across the job threads
+#define PVS_NUM_CELLS_PER_BATCH 256
+#define PVS_NUM_CELLS_PER_TASK 4
+
+// Potentially visible set: for every cell of a uniform grid over the scene, the clusters of the scene (see Scene_Clusters)
+// that can be seen from somewhere in the cell. Every cell has a row with one bit per cluster, stored run length encoded: bytes with a set bit are kept as they
+// are, and runs of zero bytes become a zero followed by the length of the run. Rows that would not get smaller that way are
+// stored as they are.
+struct PVS
+{
+    // Holds the row offsets and the row of the cell the camera is in, both sized at build time
+    Arena arena;
+
+    uint32_t num_clusters;
+    uint32_t num_row_bytes;
+
+    glm::vec3 bounds_min;
+    float     cell_size;
+    uint32_t  num_cells_x;
+    uint32_t  num_cells_y;
+    uint32_t  num_cells_z;
+    uint32_t  num_cells;
+
+    uint64_t* cell_offsets; // Where the row of each cell starts in data, the one after the last cell gives the size of data
+
+    Arena    data_arena;
+    uint8_t* data;
+
+    // Row of visible_cell, decompressed when the camera moves into another cell
+    uint8_t* visible_clusters;
+    uint32_t visible_cell;
+
+    // Faces of the scene the set was built for, it is stale once they change
+    uint32_t num_faces;
+};
+
+struct PVS_BuildStats
+{
+    uint32_t num_clusters;
+    uint32_t num_cells;
+    float    cell_size;
+    uint64_t num_rays;
+
+    uint64_t num_visible_clusters; // Summed over all cells
+    uint64_t num_row_bytes;        // Of all rows before compression
+    uint64_t num_data_bytes;       // After
+};
+
+bool32_t PVS_Init(PVS* pvs);
+
+void PVS_Destroy(PVS* pvs);
+
+// Drops the set, nothing is culled until it is built again
+void PVS_Clear(PVS* pvs);
+
+// Casts num_rays_per_cell rays from random points in every cell through the scene across the job threads, the clusters of
+// the faces they hit and the clusters that reach into the cell are visible from it.
+// NOTE: Visibility is sampled, so clusters that only show through gaps narrower than the rays are apart can be missed
+// Returns FALSE when the scene is empty or the rows do not fit, the set is left empty then.
+bool32_t PVS_Build(PVS* pvs, Scene* scene, float cell_size, uint32_t num_rays_per_cell, PVS_BuildStats* out_stats);
+
+// Returns the cell the position is in, SCENE_ID_NONE when it is outside of the grid
+uint32_t PVS_FindCell(const PVS* pvs, glm::vec3 position);
+
+// Writes the row of the cell, num_row_bytes bytes with bit i of byte i / 8 set for every visible cluster i
+void PVS_DecompressRow(const PVS* pvs, uint32_t cell_index, uint8_t* out_row);
+
+// Returns the row of the cell the position is in, NULL when every cluster has to be drawn because the position is outside
+// of the grid or nothing is built
+const uint8_t* PVS_GetVisibleClusters(PVS* pvs, glm::vec3 position);
+
+#endif // !PVS_HPP_
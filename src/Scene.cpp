@@ -1,261 +1,1058 @@
 #include "Scene.hpp"
+#include "Jobs.hpp"
 
-Scene_Vertex* Scene_AddVertex(Scene* scene, glm::vec3 position)
+#include <float.h>
+#include <string.h>
+
+bool32_t Scene_Init(Scene* scene)
+{
+    memset(scene, 0, sizeof(Scene));
+
+    if (!Arena_CreateReserved(&scene->vertex_arena, (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(Scene_Vertex)) ||
+        !Arena_CreateReserved(&scene->half_edge_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(Scene_HalfEdge)) ||
+        !Arena_CreateReserved(&scene->face_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(Scene_Face)) ||
+        !Arena_CreateReserved(&scene->scratch_arena, SCENE_SCRATCH_ARENA_CAPACITY) ||
+        !Arena_CreateReserved(&scene->plane_flag_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(bool32_t)) ||
+        !Arena_CreateReserved(&scene->plane_dirty_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&scene->face_change_arena, ((uint64_t)SCENE_MAX_NUM_FACES + SCENE_FACE_CHANGE_LOG_MIN_CAPACITY) * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&scene->free_vertex_arena, (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&scene->defrag.move_arena, ((uint64_t)SCENE_MAX_NUM_VERTICES + SCENE_MAX_NUM_FACES) * sizeof(Scene_DefragMove)) ||
+        !Scene_BVH_Init(&scene->bvh) ||
+        !Scene_FacePlanes_Init(&scene->face_planes) ||
+        !Scene_Geometry_Init(&scene->geometry) ||
+        !Scene_PickGrid_Init(&scene->pick_grid) ||
+        !Scene_Clusters_Init(&scene->clusters))
+    {
+        Scene_Destroy(scene);
+        return FALSE;
+    }
+
+    for (uint32_t i = 0; i < SCENE_NUM_FACE_FREE_LISTS; ++i)
+    {
+        if (!Arena_CreateReserved(&scene->free_face_arenas[i], (uint64_t)SCENE_MAX_NUM_FACES * sizeof(uint32_t)))
+        {
+            Scene_Destroy(scene);
+            return FALSE;
+        }
+
+        scene->free_faces[i] = (uint32_t*)scene->free_face_arenas[i].memory;
+    }
+
+    // NOTE: The arenas only hold their own array, so the arrays start at the beginning of the reserved memory
+    scene->vertices   = (Scene_Vertex*)scene->vertex_arena.memory;
+    scene->half_edges = (Scene_HalfEdge*)scene->half_edge_arena.memory;
+    scene->faces      = (Scene_Face*)scene->face_arena.memory;
+
+    scene->face_plane_dirty_flags   = (bool32_t*)scene->plane_flag_arena.memory;
+    scene->dirty_plane_face_indices = (uint32_t*)scene->plane_dirty_arena.memory;
+
+    scene->face_changes = (uint32_t*)scene->face_change_arena.memory;
+
+    scene->free_vertices = (uint32_t*)scene->free_vertex_arena.memory;
+
+    scene->defrag.moves = (Scene_DefragMove*)scene->defrag.move_arena.memory;
+
+    return TRUE;
+}
+
+void Scene_Destroy(Scene* scene)
+{
+    ASSERT(scene->num_snapshots == 0);
+
+    Scene_Clusters_Destroy(&scene->clusters);
+    Scene_PickGrid_Destroy(&scene->pick_grid);
+    Scene_Geometry_Destroy(&scene->geometry);
+    Scene_FacePlanes_Destroy(&scene->face_planes);
+    Scene_BVH_Destroy(&scene->bvh);
+
+    for (uint32_t i = 0; i < SCENE_NUM_FACE_FREE_LISTS; ++i)
+        Arena_Destroy(&scene->free_face_arenas[i]);
+
+    Arena_Destroy(&scene->defrag.move_arena);
+    Arena_Destroy(&scene->free_vertex_arena);
+    Arena_Destroy(&scene->face_change_arena);
+    Arena_Destroy(&scene->plane_dirty_arena);
+    Arena_Destroy(&scene->plane_flag_arena);
+    Arena_Destroy(&scene->scratch_arena);
+    Arena_Destroy(&scene->face_arena);
+    Arena_Destroy(&scene->half_edge_arena);
+    Arena_Destroy(&scene->vertex_arena);
+
+    memset(scene, 0, sizeof(Scene));
+}
+
+// Returns FALSE when the stack is full
+static bool32_t Scene_PushFreeSlot(Arena* arena, uint32_t* slots, uint32_t* num_slots, uint32_t index)
+{
+    uint32_t* slot = ARENA_ALLOCATE_ARRAY(arena, uint32_t, 1);
+    if (!slot)
+        return FALSE;
+
+    ASSERT(slot == slots + *num_slots);
+    UNUSED(slots);
+
+    *slot = index;
+    ++*num_slots;
+
+    return TRUE;
+}
+
+static uint32_t Scene_PopFreeSlot(Arena* arena, const uint32_t* slots, uint32_t* num_slots)
+{
+    uint32_t index = slots[--*num_slots];
+    Arena_Rewind(arena, (uint64_t)*num_slots * sizeof(uint32_t));
+
+    return index;
+}
+
+static void Scene_ClearFreeVertices(Scene* scene)
+{
+    Arena_Reset(&scene->free_vertex_arena);
+    scene->num_free_vertices = 0;
+}
+
+static void Scene_ClearFreeFaces(Scene* scene)
+{
+    for (uint32_t i = 0; i < SCENE_NUM_FACE_FREE_LISTS; ++i)
+    {
+        Arena_Reset(&scene->free_face_arenas[i]);
+        scene->num_free_faces[i] = 0;
+    }
+}
+
+// Every entry left is stale once nothing is deleted anymore
+static void Scene_TrimFreeLists(Scene* scene)
+{
+    if (scene->num_deleted_vertices == 0 && scene->num_free_vertices > 0)
+        Scene_ClearFreeVertices(scene);
+
+    if (scene->num_deleted_faces == 0)
+        Scene_ClearFreeFaces(scene);
+}
+
+void Scene_RebuildFreeLists(Scene* scene)
+{
+    Scene_ClearFreeVertices(scene);
+    Scene_ClearFreeFaces(scene);
+
+    // Slots are pushed from the end, so that the lowest ones are reused first.
+    // NOTE: The stacks have room for every element of the largest possible scene, so pushing fresh entries never fails
+    for (uint32_t i = scene->num_vertices; i-- > 0; )
+    {
+        if (!Scene_Vertex_IsDeleted(scene, i))
+            continue;
+
+        bool32_t push_result = Scene_PushFreeSlot(&scene->free_vertex_arena, scene->free_vertices, &scene->num_free_vertices, i);
+        ASSERT(push_result == TRUE);
+        UNUSED(push_result);
+    }
+
+    for (uint32_t i = scene->num_faces; i-- > 0; )
+    {
+        uint32_t num_corners = scene->faces[i].num_half_edges;
+
+        if (num_corners > SCENE_MAX_RECYCLED_FACE_CORNERS || !Scene_Face_IsDeleted(scene, i))
+            continue;
+
+        uint32_t list = num_corners - 3;
+
+        bool32_t push_result = Scene_PushFreeSlot(&scene->free_face_arenas[list], scene->free_faces[list], &scene->num_free_faces[list], i);
+        ASSERT(push_result == TRUE);
+        UNUSED(push_result);
+    }
+}
+
+// NOTE: The element has to be marked deleted already
+static void Scene_PushFreeVertex(Scene* scene, uint32_t vertex_index)
+{
+    // Slots that are deleted and restored over and over pile up stale entries, a rescan gets rid of them
+    if (!Scene_PushFreeSlot(&scene->free_vertex_arena, scene->free_vertices, &scene->num_free_vertices, vertex_index))
+        Scene_RebuildFreeLists(scene);
+}
+
+static void Scene_PushFreeFace(Scene* scene, uint32_t face_index)
+{
+    uint32_t num_corners = scene->faces[face_index].num_half_edges;
+    if (num_corners > SCENE_MAX_RECYCLED_FACE_CORNERS)
+        return;
+
+    uint32_t list = num_corners - 3;
+
+    if (!Scene_PushFreeSlot(&scene->free_face_arenas[list], scene->free_faces[list], &scene->num_free_faces[list], face_index))
+        Scene_RebuildFreeLists(scene);
+}
+
+uint32_t Scene_PopFreeVertex(Scene* scene)
+{
+    while (scene->num_free_vertices > 0)
+    {
+        uint32_t vertex_index = Scene_PopFreeSlot(&scene->free_vertex_arena, scene->free_vertices, &scene->num_free_vertices);
+
+        // Slots may have been reused or truncated since they were pushed
+        if (vertex_index < scene->num_vertices && Scene_Vertex_IsDeleted(scene, vertex_index))
+            return vertex_index;
+    }
+
+    return SCENE_ID_NONE;
+}
+
+uint32_t Scene_PopFreeFace(Scene* scene, uint32_t num_corners)
+{
+    if (num_corners < 3 || num_corners > SCENE_MAX_RECYCLED_FACE_CORNERS)
+        return SCENE_ID_NONE;
+
+    uint32_t list = num_corners - 3;
+    const Scene_Defrag* defrag = &scene->defrag;
+
+    while (scene->num_free_faces[list] > 0)
+    {
+        uint32_t face_index = Scene_PopFreeSlot(&scene->free_face_arenas[list], scene->free_faces[list], &scene->num_free_faces[list]);
+
+        // The deleted faces between the cursors of a running defragmentation belong to it, their ranges keep changing
+        if (face_index < scene->num_faces &&
+            Scene_Face_IsDeleted(scene, face_index) &&
+            scene->faces[face_index].num_half_edges == num_corners &&
+            !(defrag->is_running && face_index >= defrag->next_face && face_index < defrag->source_face))
+        {
+            return face_index;
+        }
+    }
+
+    return SCENE_ID_NONE;
+}
+
+static uint32_t Scene_AppendVertex(Scene* scene, glm::vec3 position)
 {
     if (scene->num_vertices >= SCENE_MAX_NUM_VERTICES)
-        return NULL;
+        return SCENE_ID_NONE;
 
-    uint32_t vertex_index = scene->num_vertices;
+    Scene_Vertex* vertex = (Scene_Vertex*)Arena_AllocateRegion(&scene->vertex_arena, sizeof(Scene_Vertex), alignof(Scene_Vertex));
+    if (!vertex)
+        return SCENE_ID_NONE;
 
-    Scene_Vertex* vertex = scene->vertices + vertex_index;
-    vertex->id                      = vertex_index;
-    vertex->position                = position;
-    vertex->num_outgoing_half_edges = 0;
-    vertex->num_ingoing_half_edges  = 0;
+    ASSERT(vertex == scene->vertices + scene->num_vertices);
+
+    // NOTE: Removed elements may still be part of a snapshot, so even appending has to keep the originals
+    Scene_PrepareVertexWrite(scene, scene->num_vertices, 1);
 
-    ++scene->num_vertices;
-    return vertex;
+    vertex->position                 = position;
+    vertex->first_outgoing_half_edge = SCENE_ID_NONE;
+
+    return scene->num_vertices++;
 }
 
-Scene_Face* Scene_ConstructFace(Scene* scene, Scene_Vertex** vertices, uint32_t num_vertices, glm::vec4 color)
+uint32_t Scene_AddVertex(Scene* scene, glm::vec3 position)
 {
-    ASSERT(num_vertices >= 3);
+    uint32_t vertex_index = Scene_PopFreeVertex(scene);
 
-    if (scene->num_half_edges + num_vertices > SCENE_MAX_NUM_HALF_EDGES)
-        return NULL;
+    if (vertex_index == SCENE_ID_NONE)
+        return Scene_AppendVertex(scene, position);
 
-    if (scene->num_faces >= SCENE_MAX_NUM_FACES)
-        return NULL;
+    Scene_RestoreVertex(scene, vertex_index, position);
 
-    uint32_t half_edge_index_base = scene->num_half_edges;
+    return vertex_index;
+}
 
-    Scene_Vertex* start_vertex = vertices[0];
-    Scene_Vertex* next_vertex  = vertices[1];
-    Scene_Vertex* prev_vertex  = vertices[num_vertices - 1];
+uint32_t Scene_AddVertices(Scene* scene, const glm::vec3* positions, uint32_t num_vertices)
+{
+    if (num_vertices > SCENE_MAX_NUM_VERTICES - scene->num_vertices)
+        return SCENE_ID_NONE;
 
-    glm::vec3 face_normal = glm::normalize(
-        glm::cross(
-            next_vertex->position - start_vertex->position,
-            prev_vertex->position - start_vertex->position
-        )
-    );
+    Scene_Vertex* vertices = ARENA_ALLOCATE_ARRAY(&scene->vertex_arena, Scene_Vertex, num_vertices);
+    if (!vertices)
+        return SCENE_ID_NONE;
 
-    Scene_Face* face = scene->faces + scene->num_faces;
-    face->id         = scene->num_faces;
-    face->half_edge  = scene->half_edges + half_edge_index_base;
-    face->color      = color;
-    face->normal     = face_normal;
-    face->offset     = -glm::dot(face_normal, start_vertex->position);
+    ASSERT(vertices == scene->vertices + scene->num_vertices);
+
+    Scene_PrepareVertexWrite(scene, scene->num_vertices, num_vertices);
 
     for (uint32_t i = 0; i < num_vertices; ++i)
     {
-        Scene_Vertex* v0 = vertices[i];
-        Scene_Vertex* v1 = vertices[(i + 1) % num_vertices];
+        vertices[i].position                 = positions[i];
+        vertices[i].first_outgoing_half_edge = SCENE_ID_NONE;
+    }
 
-        Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index_base + i;
-        Scene_HalfEdge* prev_half_edge    = scene->half_edges + half_edge_index_base + (i + num_vertices - 1) % num_vertices;
-        Scene_HalfEdge* next_half_edge    = scene->half_edges + half_edge_index_base + (i + 1) % num_vertices;
+    uint32_t first_vertex_index = scene->num_vertices;
+    scene->num_vertices += num_vertices;
 
-        current_half_edge->origin_vertex      = v0;
-        current_half_edge->end_vertex         = v1;
-        current_half_edge->opposite_half_edge = NULL;
-        current_half_edge->next_half_edge     = next_half_edge;
-        current_half_edge->prev_half_edge     = prev_half_edge;
-        current_half_edge->face               = face;
+    return first_vertex_index;
+}
 
-        ASSERT(v0->num_outgoing_half_edges < SCENE_VERTEX_MAX_NUM_OUTGOING_HALF_EDGES);
-        ASSERT(v1->num_ingoing_half_edges < SCENE_VERTEX_MAX_NUM_INGOING_HALF_EDGES);
+// Writes the ring of the face into its range of half-edges and links it to its twins and vertices
+static void Scene_LinkFace(Scene* scene, uint32_t face_index, const uint32_t* vertex_indices, glm::vec4 color)
+{
+    Scene_Face* face = scene->faces + face_index;
 
-        v0->outgoing_half_edges[v0->num_outgoing_half_edges++] = current_half_edge;
-        v1->ingoing_half_edges[v1->num_ingoing_half_edges++] = current_half_edge;
+    uint32_t half_edge_index_base = face->first_half_edge;
+    uint32_t num_vertices = face->num_half_edges;
 
-        for (uint32_t j = 0; j < v1->num_outgoing_half_edges; ++j)
-        {
-            Scene_HalfEdge* outgoing_half_edge = v1->outgoing_half_edges[j];
+    Scene_HalfEdge* half_edges = scene->half_edges + half_edge_index_base;
+
+    Scene_PrepareHalfEdgeWrite(scene, half_edge_index_base, num_vertices);
+    Scene_PrepareFaceWrite(scene, face_index, 1);
+
+    face->color = color;
 
-            if (outgoing_half_edge->end_vertex == v0)
+    // NOTE: The whole ring has to be written before looking for opposites, because the search follows next_half_edge
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        Scene_HalfEdge* current_half_edge = half_edges + i;
+
+        current_half_edge->origin_vertex           = vertex_indices[i];
+        current_half_edge->opposite_half_edge      = SCENE_ID_NONE;
+        current_half_edge->next_half_edge          = half_edge_index_base + (i + 1) % num_vertices;
+        current_half_edge->prev_half_edge          = half_edge_index_base + (i + num_vertices - 1) % num_vertices;
+        current_half_edge->face                    = face_index;
+        current_half_edge->next_outgoing_half_edge = SCENE_ID_NONE;
+    }
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        uint32_t v0 = vertex_indices[i];
+        uint32_t v1 = vertex_indices[(i + 1) % num_vertices];
+
+        uint32_t current_half_edge_index = half_edge_index_base + i;
+        Scene_HalfEdge* current_half_edge = half_edges + i;
+
+        for (uint32_t outgoing_half_edge_index = scene->vertices[v1].first_outgoing_half_edge;
+             outgoing_half_edge_index != SCENE_ID_NONE;
+             outgoing_half_edge_index = scene->half_edges[outgoing_half_edge_index].next_outgoing_half_edge)
+        {
+            if (Scene_HalfEdge_GetEndVertex(scene, outgoing_half_edge_index) == v0)
             {
-                current_half_edge->opposite_half_edge = outgoing_half_edge;
-                outgoing_half_edge->opposite_half_edge = current_half_edge;
+                current_half_edge->opposite_half_edge = outgoing_half_edge_index;
+
+                Scene_PrepareHalfEdgeWrite(scene, outgoing_half_edge_index, 1);
+                scene->half_edges[outgoing_half_edge_index].opposite_half_edge = current_half_edge_index;
 
                 break;
             }
         }
+
+        current_half_edge->next_outgoing_half_edge = scene->vertices[v0].first_outgoing_half_edge;
+
+        Scene_PrepareVertexWrite(scene, v0, 1);
+        scene->vertices[v0].first_outgoing_half_edge = current_half_edge_index;
+    }
+
+    Scene_Face_RecomputePlane(scene, face_index);
+}
+
+static uint32_t Scene_AppendFace(Scene* scene, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color)
+{
+    if (num_vertices > SCENE_MAX_NUM_HALF_EDGES - scene->num_half_edges)
+        return SCENE_ID_NONE;
+
+    if (scene->num_faces >= SCENE_MAX_NUM_FACES)
+        return SCENE_ID_NONE;
+
+    if (!Arena_CanAllocateRegion(&scene->face_arena, sizeof(Scene_Face), alignof(Scene_Face)))
+        return SCENE_ID_NONE;
+
+    Scene_HalfEdge* half_edges = (Scene_HalfEdge*)Arena_AllocateRegion(
+        &scene->half_edge_arena,
+        (uint64_t)num_vertices * sizeof(Scene_HalfEdge),
+        alignof(Scene_HalfEdge)
+    );
+
+    if (!half_edges)
+        return SCENE_ID_NONE;
+
+    Scene_Face* face = (Scene_Face*)Arena_AllocateRegion(&scene->face_arena, sizeof(Scene_Face), alignof(Scene_Face));
+    if (!face)
+    {
+        Arena_Rewind(&scene->half_edge_arena, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge));
+        return SCENE_ID_NONE;
     }
 
+    ASSERT(half_edges == scene->half_edges + scene->num_half_edges);
+    ASSERT(face == scene->faces + scene->num_faces);
+    UNUSED(half_edges);
+
+    uint32_t face_index = scene->num_faces;
+
+    Scene_PrepareFaceWrite(scene, face_index, 1);
+
+    face->first_half_edge = scene->num_half_edges;
+    face->num_half_edges  = num_vertices;
+
+    Scene_LinkFace(scene, face_index, vertex_indices, color);
+
     scene->num_half_edges += num_vertices;
     ++scene->num_faces;
 
-    return face;
+    return face_index;
 }
 
-bool32_t Scene_GenerateGeometry(
-    const Scene* scene,
-    SVertex*     vertices,
-    uint32_t     max_num_vertices,
-    uint32_t*    indices,
-    uint32_t     max_num_indices,
-    uint32_t*    out_num_vertices,
-    uint32_t*    out_num_indices
-)
+uint32_t Scene_ConstructFace(Scene* scene, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color)
+{
+    ASSERT(num_vertices >= 3);
+
+    uint32_t face_index = Scene_PopFreeFace(scene, num_vertices);
+
+    if (face_index == SCENE_ID_NONE)
+        return Scene_AppendFace(scene, vertex_indices, num_vertices, color);
+
+    Scene_RestoreFace(scene, face_index, vertex_indices, num_vertices, color);
+
+    return face_index;
+}
+
+// Clears the opposite of the twin and takes the half-edge out of the outgoing list of its origin
+static void Scene_UnlinkHalfEdge(Scene* scene, uint32_t half_edge_index)
 {
-    uint32_t vertex_index = 0;
-    uint32_t index_index = 0;
+    const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
 
-    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    if (half_edge->opposite_half_edge != SCENE_ID_NONE && scene->half_edges[half_edge->opposite_half_edge].opposite_half_edge == half_edge_index)
     {
-        uint32_t start_vertex_index = vertex_index;
+        Scene_PrepareHalfEdgeWrite(scene, half_edge->opposite_half_edge, 1);
+        scene->half_edges[half_edge->opposite_half_edge].opposite_half_edge = SCENE_ID_NONE;
+    }
 
-        const Scene_Face* current_face = scene->faces + i;
+    // Usually the half-edge is still the head of the list, unless faces were added around the vertex in bulk
+    uint32_t link_owner = SCENE_ID_NONE;
+    uint32_t* link = &scene->vertices[half_edge->origin_vertex].first_outgoing_half_edge;
 
-        const Scene_HalfEdge* current_half_edge = current_face->half_edge;
-        const Scene_Vertex*   current_vertex    = current_half_edge->origin_vertex;
+    while (*link != half_edge_index)
+    {
+        ASSERT(*link != SCENE_ID_NONE);
+        link_owner = *link;
+        link = &scene->half_edges[*link].next_outgoing_half_edge;
+    }
 
-        const Scene_Vertex* start_vertex = current_vertex;
+    if (link_owner == SCENE_ID_NONE)
+        Scene_PrepareVertexWrite(scene, half_edge->origin_vertex, 1);
+    else
+        Scene_PrepareHalfEdgeWrite(scene, link_owner, 1);
 
-        do
-        {
-            ASSERT(vertex_index < max_num_vertices);
+    *link = half_edge->next_outgoing_half_edge;
+}
 
-            SVertex* geometry_vertex = vertices + vertex_index;
-            geometry_vertex->position   = current_vertex->position;
-            geometry_vertex->normal     = current_face->normal;
-            geometry_vertex->color      = current_face->color;
-            geometry_vertex->cell_ids.x = current_vertex->id;
-            geometry_vertex->cell_ids.z = current_face->id;
+void Scene_RemoveLastVertex(Scene* scene)
+{
+    ASSERT(scene->num_vertices > 0);
+    ASSERT(scene->vertices[scene->num_vertices - 1].first_outgoing_half_edge == SCENE_ID_NONE);
 
-            ++vertex_index;
+    Scene_TruncateVertices(scene, scene->num_vertices - 1);
+}
 
-            current_vertex = current_half_edge->end_vertex;
-            current_half_edge = current_half_edge->next_half_edge;
-        }
-        while (current_vertex != start_vertex);
+void Scene_RemoveLastFace(Scene* scene)
+{
+    ASSERT(scene->num_faces > 0);
+
+    uint32_t face_index = scene->num_faces - 1;
+    const Scene_Face* face = scene->faces + face_index;
+
+    ASSERT(face->first_half_edge + face->num_half_edges == scene->num_half_edges);
+
+    for (uint32_t half_edge_index = face->first_half_edge; half_edge_index < scene->num_half_edges; ++half_edge_index)
+        Scene_UnlinkHalfEdge(scene, half_edge_index);
+
+    Scene_TruncateFaces(scene, face_index);
+}
+
+void Scene_DeleteFace(Scene* scene, uint32_t face_index)
+{
+    ASSERT(face_index < scene->num_faces && !Scene_Face_IsDeleted(scene, face_index));
+
+    Scene_Face* face = scene->faces + face_index;
+
+    uint32_t first_half_edge = face->first_half_edge;
+    uint32_t num_half_edges = face->num_half_edges;
+
+    // Twins that were represented by a half-edge of the face take over in the grid once their vertices are relinked
+    Scene_PickGrid_RemoveHalfEdges(scene, first_half_edge, num_half_edges);
+
+    for (uint32_t half_edge_index = first_half_edge; half_edge_index < first_half_edge + num_half_edges; ++half_edge_index)
+    {
+        Scene_PickGrid_MarkVertexDirty(scene, scene->half_edges[half_edge_index].origin_vertex);
+        Scene_UnlinkHalfEdge(scene, half_edge_index);
+    }
+
+    Scene_PrepareHalfEdgeWrite(scene, first_half_edge, num_half_edges);
+    Scene_PrepareFaceWrite(scene, face_index, 1);
+
+    for (uint32_t half_edge_index = first_half_edge; half_edge_index < first_half_edge + num_half_edges; ++half_edge_index)
+    {
+        Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+
+        half_edge->origin_vertex           = SCENE_ID_NONE;
+        half_edge->opposite_half_edge      = SCENE_ID_NONE;
+        half_edge->next_half_edge          = SCENE_ID_NONE;
+        half_edge->prev_half_edge          = SCENE_ID_NONE;
+        half_edge->face                    = SCENE_ID_DELETED;
+        half_edge->next_outgoing_half_edge = SCENE_ID_NONE;
+    }
+
+    // A zero normal makes every ray test reject the face as parallel, like the unused lanes of the face plane mirror
+    face->normal = glm::vec3(0.0f);
+    face->offset = 0.0f;
+
+    ++scene->num_deleted_faces;
+    scene->num_deleted_half_edges += num_half_edges;
+
+    Scene_PushFreeFace(scene, face_index);
+
+    Scene_BVH_MarkFaceDirty(scene, face_index);
+    Scene_FacePlanes_MarkFaceDirty(scene, face_index);
+    Scene_Geometry_MarkFaceDirty(scene, face_index);
+    Scene_Clusters_MarkFaceDirty(scene, face_index);
+    Scene_MarkFaceChanged(scene, face_index);
+}
+
+void Scene_DeleteEdge(Scene* scene, uint32_t half_edge_index)
+{
+    uint32_t opposite_half_edge_index = scene->half_edges[half_edge_index].opposite_half_edge;
+    uint32_t opposite_face_index = (opposite_half_edge_index != SCENE_ID_NONE) ? scene->half_edges[opposite_half_edge_index].face : SCENE_ID_NONE;
+
+    Scene_DeleteFace(scene, scene->half_edges[half_edge_index].face);
+
+    // NOTE: Faces that touch themselves can be on both sides of the edge
+    if (opposite_face_index != SCENE_ID_NONE && !Scene_Face_IsDeleted(scene, opposite_face_index))
+        Scene_DeleteFace(scene, opposite_face_index);
+}
+
+void Scene_DeleteVertex(Scene* scene, uint32_t vertex_index)
+{
+    ASSERT(vertex_index < scene->num_vertices && !Scene_Vertex_IsDeleted(scene, vertex_index));
+
+    // Every face around the vertex owns one of its outgoing half-edges, which deleting the face takes out of the list
+    while (scene->vertices[vertex_index].first_outgoing_half_edge != SCENE_ID_NONE)
+        Scene_DeleteFace(scene, scene->half_edges[scene->vertices[vertex_index].first_outgoing_half_edge].face);
+
+    Scene_PickGrid_RemoveVertex(scene, vertex_index);
+
+    Scene_PrepareVertexWrite(scene, vertex_index, 1);
+    scene->vertices[vertex_index].first_outgoing_half_edge = SCENE_ID_DELETED;
+
+    ++scene->num_deleted_vertices;
+
+    Scene_PushFreeVertex(scene, vertex_index);
+}
 
-        uint32_t v0i = start_vertex_index;
-        uint32_t v1i = start_vertex_index + 1;
+void Scene_RestoreVertex(Scene* scene, uint32_t vertex_index, glm::vec3 position)
+{
+    if (vertex_index == scene->num_vertices)
+    {
+        uint32_t appended_vertex_index = Scene_AppendVertex(scene, position);
+        ASSERT(appended_vertex_index == vertex_index);
+        UNUSED(appended_vertex_index);
+
+        return;
+    }
+
+    ASSERT(vertex_index < scene->num_vertices && Scene_Vertex_IsDeleted(scene, vertex_index));
+
+    Scene_PrepareVertexWrite(scene, vertex_index, 1);
+
+    Scene_Vertex* vertex = scene->vertices + vertex_index;
+    vertex->position                 = position;
+    vertex->first_outgoing_half_edge = SCENE_ID_NONE;
+
+    --scene->num_deleted_vertices;
+    Scene_TrimFreeLists(scene);
+
+    Scene_PickGrid_MarkVertexDirty(scene, vertex_index);
+}
+
+void Scene_RestoreFace(Scene* scene, uint32_t face_index, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color)
+{
+    if (face_index == scene->num_faces)
+    {
+        uint32_t appended_face_index = Scene_AppendFace(scene, vertex_indices, num_vertices, color);
+        ASSERT(appended_face_index == face_index);
+        UNUSED(appended_face_index);
+
+        return;
+    }
+
+    ASSERT(face_index < scene->num_faces && Scene_Face_IsDeleted(scene, face_index));
+    ASSERT(scene->faces[face_index].num_half_edges == num_vertices);
+
+    Scene_LinkFace(scene, face_index, vertex_indices, color);
+
+    --scene->num_deleted_faces;
+    scene->num_deleted_half_edges -= num_vertices;
+    Scene_TrimFreeLists(scene);
+
+    // The slot is in the derived structures already, so it only has to be refreshed like a moved face
+    Scene_BVH_MarkFaceDirty(scene, face_index);
+    Scene_FacePlanes_MarkFaceDirty(scene, face_index);
+    Scene_Geometry_MarkFaceDirty(scene, face_index);
+    Scene_Clusters_MarkFaceDirty(scene, face_index);
+    Scene_MarkFaceChanged(scene, face_index);
 
-        for (uint32_t vi = start_vertex_index + 2; vi < vertex_index; ++vi)
+    for (uint32_t i = 0; i < num_vertices; ++i)
+        Scene_PickGrid_MarkVertexDirty(scene, vertex_indices[i]);
+}
+
+void Scene_TruncateVertices(Scene* scene, uint32_t num_vertices)
+{
+    ASSERT(num_vertices <= scene->num_vertices);
+
+    for (uint32_t i = num_vertices; i < scene->num_vertices; ++i)
+    {
+        ASSERT(scene->vertices[i].first_outgoing_half_edge == SCENE_ID_NONE || Scene_Vertex_IsDeleted(scene, i));
+        scene->num_deleted_vertices -= Scene_Vertex_IsDeleted(scene, i);
+    }
+
+    scene->num_vertices = num_vertices;
+    Arena_Rewind(&scene->vertex_arena, (uint64_t)scene->num_vertices * sizeof(Scene_Vertex));
+
+    Scene_TrimFreeLists(scene);
+
+    // NOTE: The grid may still link the vertices, and vertices added before the next update would take their indices
+    scene->pick_grid.needs_rebuild = TRUE;
+}
+
+void Scene_TruncateFaces(Scene* scene, uint32_t num_faces)
+{
+    ASSERT(num_faces <= scene->num_faces);
+
+    if (num_faces == scene->num_faces)
+        return;
+
+    uint32_t num_half_edges = scene->faces[num_faces].first_half_edge;
+
+    for (uint32_t i = num_faces; i < scene->num_faces; ++i)
+    {
+        // Faces appended before the next update of a tracker take the same indices
+        Scene_MarkFaceChanged(scene, i);
+
+        if (Scene_Face_IsDeleted(scene, i))
         {
-            ASSERT(index_index < max_num_indices);
+            --scene->num_deleted_faces;
+            scene->num_deleted_half_edges -= scene->faces[i].num_half_edges;
+        }
+    }
+
+    scene->num_half_edges = num_half_edges;
+    scene->num_faces = num_faces;
+
+    Arena_Rewind(&scene->half_edge_arena, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge));
+    Arena_Rewind(&scene->face_arena, (uint64_t)scene->num_faces * sizeof(Scene_Face));
 
-            indices[index_index++] = v0i;
-            indices[index_index++] = v1i;
-            indices[index_index++] = vi;
+    Scene_TrimFreeLists(scene);
 
-            v1i = vi;
+    // The plane flags only cover the faces that are left
+    if (scene->num_plane_tracked_faces > scene->num_faces)
+    {
+        uint32_t num_dirty_faces = 0;
+
+        for (uint32_t i = 0; i < scene->num_dirty_plane_faces; ++i)
+        {
+            if (scene->dirty_plane_face_indices[i] < scene->num_faces)
+                scene->dirty_plane_face_indices[num_dirty_faces++] = scene->dirty_plane_face_indices[i];
         }
+
+        scene->num_dirty_plane_faces = num_dirty_faces;
+        scene->num_plane_tracked_faces = scene->num_faces;
+
+        Arena_Rewind(&scene->plane_flag_arena, (uint64_t)scene->num_faces * sizeof(bool32_t));
+        Arena_Rewind(&scene->plane_dirty_arena, (uint64_t)scene->num_faces * sizeof(uint32_t));
     }
 
-    *out_num_vertices = vertex_index;
-    *out_num_indices = index_index;
+    Scene_Geometry_RemoveFaces(scene);
 
-    return TRUE;
+    // A face constructed before the next update would bring the counts back, so the derived structures are told explicitly
+    scene->bvh.needs_rebuild = TRUE;
+    scene->face_planes.needs_rebuild = TRUE;
+    scene->pick_grid.needs_rebuild = TRUE;
+    scene->clusters.needs_rebuild = TRUE;
 }
 
-bool32_t Scene_RayCast_FindNearestIntersectingFace(
-    Scene*       scene,
+void Scene_Clear(Scene* scene)
+{
+    uint32_t num_vertices = scene->num_vertices;
+
+    Scene_TruncateFaces(scene, 0);
+
+    // The vertices have to let go of their half-edges before they can be dropped
+    Scene_PrepareVertexWrite(scene, 0, num_vertices);
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (!Scene_Vertex_IsDeleted(scene, i))
+            scene->vertices[i].first_outgoing_half_edge = SCENE_ID_NONE;
+    }
+
+    Scene_TruncateVertices(scene, 0);
+
+    // A pass that was running refers to the old indices, and there is nothing left to compact
+    scene->defrag.is_running = FALSE;
+}
+
+void Scene_SetVertexPosition(Scene* scene, uint32_t vertex_index, glm::vec3 position)
+{
+    Scene_PrepareVertexWrite(scene, vertex_index, 1);
+    scene->vertices[vertex_index].position = position;
+    Scene_MarkVertexMoved(scene, vertex_index);
+}
+
+static void Scene_MarkFacePlaneDirty(Scene* scene, uint32_t face_index)
+{
+    // The flags grow lazily, faces get their plane when they are constructed
+    if (face_index >= scene->num_plane_tracked_faces)
+    {
+        uint32_t num_new_faces = scene->num_faces - scene->num_plane_tracked_faces;
+
+        bool32_t* new_flags = ARENA_ALLOCATE_ARRAY(&scene->plane_flag_arena, bool32_t, num_new_faces);
+        uint32_t* new_dirty_face_indices = ARENA_ALLOCATE_ARRAY(&scene->plane_dirty_arena, uint32_t, num_new_faces);
+
+        ASSERT(new_flags == scene->face_plane_dirty_flags + scene->num_plane_tracked_faces);
+        ASSERT(new_dirty_face_indices == scene->dirty_plane_face_indices + scene->num_plane_tracked_faces);
+        UNUSED(new_dirty_face_indices);
+
+        memset(new_flags, 0, num_new_faces * sizeof(bool32_t));
+
+        scene->num_plane_tracked_faces = scene->num_faces;
+    }
+
+    if (scene->face_plane_dirty_flags[face_index])
+        return;
+
+    scene->face_plane_dirty_flags[face_index] = TRUE;
+    scene->dirty_plane_face_indices[scene->num_dirty_plane_faces++] = face_index;
+}
+
+void Scene_MarkVertexMoved(Scene* scene, uint32_t vertex_index)
+{
+    Scene_PickGrid_MarkVertexDirty(scene, vertex_index);
+
+    // Every face around the vertex owns exactly one of its outgoing half-edges
+    for (uint32_t half_edge_index = scene->vertices[vertex_index].first_outgoing_half_edge;
+         half_edge_index != SCENE_ID_NONE;
+         half_edge_index = scene->half_edges[half_edge_index].next_outgoing_half_edge)
+    {
+        uint32_t face_index = scene->half_edges[half_edge_index].face;
+
+        Scene_BVH_MarkFaceDirty(scene, face_index);
+        Scene_FacePlanes_MarkFaceDirty(scene, face_index);
+        Scene_Geometry_MarkFaceDirty(scene, face_index);
+        Scene_Clusters_MarkFaceDirty(scene, face_index);
+        Scene_MarkFacePlaneDirty(scene, face_index);
+        Scene_MarkFaceChanged(scene, face_index);
+    }
+}
+
+void Scene_MarkFaceChanged(Scene* scene, uint32_t face_index)
+{
+    if (scene->end_face_change - scene->first_face_change >= (uint64_t)scene->num_faces + SCENE_FACE_CHANGE_LOG_MIN_CAPACITY)
+        Scene_DropFaceChanges(scene);
+
+    uint32_t* entry = ARENA_ALLOCATE_ARRAY(&scene->face_change_arena, uint32_t, 1);
+
+    ASSERT(entry == scene->face_changes + (scene->end_face_change - scene->first_face_change));
+
+    *entry = face_index;
+    ++scene->end_face_change;
+}
+
+void Scene_DropFaceChanges(Scene* scene)
+{
+    // Skipping a position makes even the trackers that were up to date fall behind the log
+    scene->first_face_change = scene->end_face_change + 1;
+    scene->end_face_change = scene->first_face_change;
+
+    Arena_Reset(&scene->face_change_arena);
+}
+
+static void Scene_UpdateFacePlanes_Task(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene* scene = (Scene*)user_data;
+
+    for (uint32_t i = begin; i < end; ++i)
+        Scene_Face_RecomputePlane(scene, scene->dirty_plane_face_indices[i]);
+}
+
+void Scene_UpdateFacePlanes(Scene* scene)
+{
+    if (scene->num_dirty_plane_faces == 0)
+        return;
+
+    if (scene->num_snapshots > 0)
+    {
+        for (uint32_t i = 0; i < scene->num_dirty_plane_faces; ++i)
+            Scene_PrepareFaceWrite(scene, scene->dirty_plane_face_indices[i], 1);
+    }
+
+    // Every face is written by a single task, and only its own plane changes
+    Jobs_ParallelFor(scene->num_dirty_plane_faces, SCENE_FACE_PLANE_UPDATE_NUM_FACES_PER_TASK, Scene_UpdateFacePlanes_Task, scene);
+
+    for (uint32_t i = 0; i < scene->num_dirty_plane_faces; ++i)
+        scene->face_plane_dirty_flags[scene->dirty_plane_face_indices[i]] = FALSE;
+
+    scene->num_dirty_plane_faces = 0;
+}
+
+void Scene_Face_RecomputePlane(Scene* scene, uint32_t face_index)
+{
+    // Deleted faces keep the zero normal they got, their half-edges have no corners anymore
+    if (Scene_Face_IsDeleted(scene, face_index))
+        return;
+
+    Scene_Face* face = scene->faces + face_index;
+
+    // Corners are taken relative to the first one, which keeps the sums precise far away from the origin
+    glm::vec3 origin = scene->vertices[scene->half_edges[face->first_half_edge].origin_vertex].position;
+
+    glm::vec3 normal_sum(0.0f);
+    glm::vec3 corner_sum(0.0f);
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    do
+    {
+        const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
+
+        glm::vec3 current_corner = scene->vertices[current_half_edge->origin_vertex].position - origin;
+        glm::vec3 next_corner = scene->vertices[scene->half_edges[current_half_edge->next_half_edge].origin_vertex].position - origin;
+
+        normal_sum += glm::cross(current_corner, next_corner);
+        corner_sum += current_corner;
+
+        half_edge_index = current_half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
+
+    glm::vec3 normal = glm::normalize(normal_sum);
+
+    // The plane goes through the average corner, so bent faces are split evenly to both sides of it
+    face->normal = normal;
+    face->offset = -glm::dot(normal, origin + corner_sum / (float)face->num_half_edges);
+}
+
+void Scene_Face_GetBounds(const Scene* scene, uint32_t face_index, glm::vec3* out_bounds_min, glm::vec3* out_bounds_max)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    // Empty bounds, which grow to the other bounds when merged
+    if (Scene_Face_IsDeleted(scene, face_index))
+    {
+        *out_bounds_min = glm::vec3(FLT_MAX);
+        *out_bounds_max = glm::vec3(-FLT_MAX);
+        return;
+    }
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    glm::vec3 bounds_min = scene->vertices[scene->half_edges[half_edge_index].origin_vertex].position;
+    glm::vec3 bounds_max = bounds_min;
+
+    do
+    {
+        const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
+        glm::vec3 position = scene->vertices[current_half_edge->origin_vertex].position;
+
+        bounds_min = glm::min(bounds_min, position);
+        bounds_max = glm::max(bounds_max, position);
+
+        half_edge_index = current_half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
+
+    *out_bounds_min = bounds_min;
+    *out_bounds_max = bounds_max;
+}
+
+bool32_t Scene_Face_IntersectRay(
+    const Scene* scene,
+    uint32_t     face_index,
     glm::vec3    ray_origin,
     glm::vec3    ray_direction,
     float        ray_min_length,
     float        ray_max_length,
-    Scene_Face** out_intersecting_face,
-    glm::vec3*   out_intersection
+    float*       out_ray_length
 )
 {
     const float eps = 10e-5f;
 
-    float       hit_min_distance = FLT_MAX;
-    Scene_Face* hit_face         = NULL;
-    glm::vec3   hit_intersection = {};
-
-    for (uint32_t i = 0; i < scene->num_faces; ++i)
-    {
-        Scene_Face* current_face = scene->faces + i;
+    const Scene_Face* face = scene->faces + face_index;
 
-        float denom = glm::dot(current_face->normal, ray_direction);
+    float denom = glm::dot(face->normal, ray_direction);
 
-        if (denom > -eps && denom < eps)
-            continue;
+    if (denom > -eps && denom < eps)
+        return FALSE;
 
-        float t = -(current_face->offset + glm::dot(current_face->normal, ray_origin)) / denom;
-        if (t < ray_min_length || t > ray_max_length)
-            continue;
+    float t = -(face->offset + glm::dot(face->normal, ray_origin)) / denom;
+    if (t < ray_min_length || t > ray_max_length)
+        return FALSE;
 
-        if (t < hit_min_distance)
-        {
-            glm::vec3 intersection = ray_origin + t * ray_direction;
+    glm::vec3 intersection = ray_origin + t * ray_direction;
 
-            Scene_HalfEdge* current_half_edge = current_face->half_edge;
-            Scene_Vertex*   current_vertex    = current_half_edge->origin_vertex;
+    uint32_t half_edge_index = face->first_half_edge;
 
-            Scene_Vertex* start_vertex = current_vertex;
+    do
+    {
+        const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
 
-            do
-            {
-                Scene_Vertex* next_vertex = current_half_edge->end_vertex;
+        glm::vec3 current_position = scene->vertices[current_half_edge->origin_vertex].position;
+        glm::vec3 next_position    = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)].position;
 
-                glm::vec3 w = glm::cross(
-                    next_vertex->position - current_vertex->position,
-                    intersection - current_vertex->position
-                );
+        glm::vec3 w = glm::cross(
+            next_position - current_position,
+            intersection - current_position
+        );
 
-                if (glm::dot(w, current_face->normal) < 0.0f)
-                    goto fail;
+        if (glm::dot(w, face->normal) < 0.0f)
+            return FALSE;
 
-                current_vertex = next_vertex;
-                current_half_edge = current_half_edge->next_half_edge;
-            }
-            while (current_vertex != start_vertex);
+        half_edge_index = current_half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
 
-            hit_min_distance = t;
-            hit_face = current_face;
-            hit_intersection = intersection;
-        }
+    *out_ray_length = t;
+    return TRUE;
+}
 
-    fail:
-        continue;
-    }
+bool32_t Scene_GenerateGeometry(
+    Scene*       scene,
+    SVertex*     vertices,
+    uint32_t     max_num_vertices,
+    uint32_t*    indices,
+    uint32_t     max_num_indices,
+    uint32_t*    out_num_vertices,
+    uint32_t*    out_num_indices
+)
+{
+    uint32_t num_vertices = Scene_GetNumGeometryVertices(scene);
+    uint32_t num_indices = Scene_GetNumGeometryIndices(scene);
 
-    if (!hit_face)
+    if (num_vertices > max_num_vertices || num_indices > max_num_indices)
         return FALSE;
 
-    if (out_intersecting_face) *out_intersecting_face = hit_face;
-    if (out_intersection) *out_intersection = hit_intersection;
+    Scene_Geometry_UpdateTriangulations(scene);
+    Scene_Geometry_WriteFaces(scene, 0, scene->num_faces, vertices, indices);
+
+    *out_num_vertices = num_vertices;
+    *out_num_indices = num_indices;
 
     return TRUE;
 }
 
-Scene_Vertex* Scene_RayCast_FindNearestVertex(
-    Scene*    scene,
-    glm::vec3 ray_origin,
-    glm::vec3 ray_direction,
-    float     max_distance
-)
+struct Scene_RayCast_Batch
 {
-    const float max_distance_squared = max_distance * max_distance;
+    const Scene*     scene;
+    const Scene_Ray* rays;
+    Scene_RayHit*    hits;
+};
 
-    float min_distance_squared = FLT_MAX;
-    Scene_Vertex* nearest_vertex = NULL;
+static void Scene_RayCast_FindNearestIntersectingFaces_Task(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Scene_RayCast_Batch* batch = (const Scene_RayCast_Batch*)user_data;
 
-    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+    for (uint32_t i = begin; i < end; i += SCENE_RAY_PACKET_SIZE)
     {
-        Scene_Vertex* vertex = scene->vertices + i;
+        uint32_t num_packet_rays = end - i;
+        if (num_packet_rays > SCENE_RAY_PACKET_SIZE) num_packet_rays = SCENE_RAY_PACKET_SIZE;
 
-        glm::vec3 p = vertex->position - ray_origin;
-        float p_length_squared = glm::dot(p, p);
+        Scene_BVH_RayCastPacket(batch->scene, batch->rays + i, num_packet_rays, batch->hits + i);
+    }
+}
 
-        if (p_length_squared > max_distance_squared)
-            continue;
+uint32_t Scene_RayCast_FindNearestIntersectingFaces(
+    Scene*           scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
+)
+{
+    // The acceleration structures are only read from the job threads
+    Scene_UpdateFacePlanes(scene);
+    Scene_FacePlanes_Update(scene);
+    Scene_BVH_Update(scene);
+
+    Scene_RayCast_Batch batch = { scene, rays, out_hits };
+    Jobs_ParallelFor(num_rays, SCENE_RAY_BATCH_NUM_RAYS_PER_TASK, Scene_RayCast_FindNearestIntersectingFaces_Task, &batch);
+
+    uint32_t num_hits = 0;
+
+    for (uint32_t i = 0; i < num_rays; ++i)
+        num_hits += (out_hits[i].index != SCENE_ID_NONE);
+
+    return num_hits;
+}
+
+static void Scene_RayCast_FindNearestVertices_Task(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Scene_RayCast_Batch* batch = (const Scene_RayCast_Batch*)user_data;
+    const Scene* scene = batch->scene;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const Scene_Ray* ray = batch->rays + i;
+
+        const float max_distance_squared = ray->max_length * ray->max_length;
 
-        float t = glm::dot(ray_direction, p);
-        float distance_squared = p_length_squared - t * t;
+        float    min_distance_squared = FLT_MAX;
+        uint32_t nearest_vertex_index = SCENE_ID_NONE;
+        float    nearest_vertex_length = 0.0f;
 
-        if (distance_squared < min_distance_squared)
+        for (uint32_t j = 0; j < scene->num_vertices; ++j)
         {
-            min_distance_squared = distance_squared;
-            nearest_vertex = vertex;
+            if (Scene_Vertex_IsDeleted(scene, j))
+                continue;
+
+            glm::vec3 p = scene->vertices[j].position - ray->origin;
+            float p_length_squared = glm::dot(p, p);
+
+            if (p_length_squared > max_distance_squared)
+                continue;
+
+            float t = glm::dot(ray->direction, p);
+            float distance_squared = p_length_squared - t * t;
+
+            if (distance_squared < min_distance_squared)
+            {
+                min_distance_squared = distance_squared;
+                nearest_vertex_index = j;
+                nearest_vertex_length = t;
+            }
         }
+
+        Scene_RayHit* hit = batch->hits + i;
+        hit->index = nearest_vertex_index;
+        hit->length = nearest_vertex_length;
+        hit->intersection = (nearest_vertex_index != SCENE_ID_NONE) ? scene->vertices[nearest_vertex_index].position : glm::vec3(0.0f);
     }
+}
+
+uint32_t Scene_RayCast_FindNearestVertices(
+    const Scene*     scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
+)
+{
+    Scene_RayCast_Batch batch = { scene, rays, out_hits };
+    Jobs_ParallelFor(num_rays, SCENE_RAY_BATCH_NUM_RAYS_PER_TASK, Scene_RayCast_FindNearestVertices_Task, &batch);
 
-    return nearest_vertex;
+    uint32_t num_hits = 0;
+
+    for (uint32_t i = 0; i < num_rays; ++i)
+        num_hits += (out_hits[i].index != SCENE_ID_NONE);
+
+    return num_hits;
+}
+
+bool32_t Scene_RayCast_FindNearestIntersectingFace(
+    Scene*     scene,
+    glm::vec3  ray_origin,
+    glm::vec3  ray_direction,
+    float      ray_min_length,
+    float      ray_max_length,
+    uint32_t*  out_intersecting_face_index,
+    glm::vec3* out_intersection
+)
+{
+    Scene_Ray ray = { ray_origin, ray_min_length, ray_direction, ray_max_length };
+
+    Scene_RayHit hit;
+    if (Scene_RayCast_FindNearestIntersectingFaces(scene, &ray, 1, &hit) == 0)
+        return FALSE;
+
+    if (out_intersecting_face_index) *out_intersecting_face_index = hit.index;
+    if (out_intersection) *out_intersection = hit.intersection;
+
+    return TRUE;
 }
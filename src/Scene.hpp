@@ -2,77 +2,387 @@
 #define SCENE_HPP_
 
 #include "Common.hpp"
+#include "Arena.hpp"
 #include "Geometry.hpp"
 
-#include <glm/glm.hpp>
+#include "Scene_BVH.hpp"
+#include "Scene_FacePlanes.hpp"
+#include "Scene_Clusters.hpp"
+#include "Scene_PickGrid.hpp"
+#include "Scene_Geometry.hpp"
+#include "Scene_Snapshot.hpp"
+#include "Scene_Journal.hpp"
+#include "Scene_FaceTracker.hpp"
 
-#define SCENE_MAX_NUM_VERTICES 512
-#define SCENE_MAX_NUM_HALF_EDGES 512
-#define SCENE_MAX_NUM_FACES 512
+#include <glm/glm.hpp>
 
-#define SCENE_VERTEX_MAX_NUM_OUTGOING_HALF_EDGES 16
-#define SCENE_VERTEX_MAX_NUM_INGOING_HALF_EDGES 16
+// NOTE: The topology arrays reserve address space for this many elements and commit memory only as they grow
+#define SCENE_MAX_NUM_VERTICES ((uint32_t)1 << 28)
+#define SCENE_MAX_NUM_HALF_EDGES ((uint32_t)1 << 30)
+#define SCENE_MAX_NUM_FACES ((uint32_t)1 << 28)
 
 #define SCENE_ID_NONE ((uint32_t)-1)
 
-struct Scene_Vertex;
-struct Scene_HalfEdge;
-struct Scene_Face;
+// Marks deleted elements, see Scene_Vertex_IsDeleted and Scene_Face_IsDeleted
+#define SCENE_ID_DELETED ((uint32_t)-2)
+
+// Slots of deleted faces with up to this many corners are reused by new faces with as many corners, larger ones are only
+// reclaimed by the defragmenter
+#define SCENE_MAX_RECYCLED_FACE_CORNERS 8
+#define SCENE_NUM_FACE_FREE_LISTS (SCENE_MAX_RECYCLED_FACE_CORNERS - 2)
+
+// Dirty face planes are recomputed across the job threads in tasks of this many faces
+#define SCENE_FACE_PLANE_UPDATE_NUM_FACES_PER_TASK 1024
+
+// Post-transform vertex cache that triangle orders are measured with, a FIFO of this many vertices like on most GPUs
+#define SCENE_VERTEX_CACHE_SIZE 16
+
+// Size of the LRU cache that the triangle order is optimized for, the scores of later entries fall off towards it
+#define SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE 32
+
+// Triangles of faces with more corners are left in the order they were triangulated in
+#define SCENE_VERTEX_CACHE_MAX_FACE_CORNERS 4096
+
+// Temporary memory of bulk operations, which need at most 40 bytes per half-edge
+#define SCENE_SCRATCH_ARENA_CAPACITY ((uint64_t)SCENE_MAX_NUM_HALF_EDGES * 40)
+
+// Rays of a batch are traversed in packets of this many consecutive rays, so coherent rays should be next to each other
+#define SCENE_RAY_PACKET_SIZE 8
+#define SCENE_RAY_BATCH_NUM_RAYS_PER_TASK (32 * SCENE_RAY_PACKET_SIZE)
+
+// The log of changed faces is dropped once it holds this many entries more than there are faces, the face trackers compare
+// every face then, which costs about as much as reading the log
+#define SCENE_FACE_CHANGE_LOG_MIN_CAPACITY 4096
 
 struct Scene_Vertex
 {
-    uint32_t id;
-
     glm::vec3 position;
 
-    Scene_HalfEdge* outgoing_half_edges[SCENE_VERTEX_MAX_NUM_OUTGOING_HALF_EDGES];
-    uint32_t num_outgoing_half_edges;
-    
-    Scene_HalfEdge* ingoing_half_edges[SCENE_VERTEX_MAX_NUM_INGOING_HALF_EDGES];
-    uint32_t num_ingoing_half_edges;
+    // Head of the list of half-edges that start at the vertex, linked through Scene_HalfEdge::next_outgoing_half_edge
+    uint32_t first_outgoing_half_edge;
 };
 
 struct Scene_HalfEdge
 {
-    Scene_Vertex* origin_vertex;
-    Scene_Vertex* end_vertex;
+    uint32_t origin_vertex;
+
+    uint32_t opposite_half_edge;
+    uint32_t next_half_edge;
+    uint32_t prev_half_edge;
 
-    Scene_HalfEdge* opposite_half_edge;
-    Scene_HalfEdge* next_half_edge;
-    Scene_HalfEdge* prev_half_edge;
+    uint32_t face;
 
-    Scene_Face* face;
+    uint32_t next_outgoing_half_edge;
 };
 
 struct Scene_Face
 {
-    uint32_t id;
-
     glm::vec4 color;
     glm::vec3 normal;
     float offset;
 
-    Scene_HalfEdge* half_edge;
+    uint32_t first_half_edge;
+    uint32_t num_half_edges;
 };
 
-struct Scene
+struct Scene_ImportStats
 {
-    Scene_Vertex vertices[SCENE_MAX_NUM_VERTICES];
-    uint32_t num_vertices;
+    uint64_t num_bytes;          // Size of the file
+    uint64_t num_scratch_bytes;  // Memory the importer committed on top of the scene
 
-    Scene_HalfEdge half_edges[SCENE_MAX_NUM_HALF_EDGES];
-    uint32_t num_half_edges;
+    uint32_t num_input_vertices;
+    uint32_t num_vertices;       // Vertices added to the scene, what is left after welding
+    uint32_t num_faces;
+    uint32_t num_skipped_faces;  // Faces with less than three distinct corners after welding
+};
 
-    Scene_Face faces[SCENE_MAX_NUM_FACES];
+struct Scene_OptimizeStats
+{
+    uint32_t num_input_vertices;
+    uint32_t num_vertices;
+    uint32_t num_input_faces;
     uint32_t num_faces;
+
+    // What the faces send to the GPU, see Scene_GetNumGeometryVertices and Scene_GetNumGeometryIndices
+    uint32_t num_input_geometry_vertices;
+    uint32_t num_geometry_vertices;
+    uint32_t num_input_triangles;
+    uint32_t num_triangles;
+
+    uint32_t num_welded_vertices; // Vertices that were welded onto another one
+    uint32_t num_merged_faces;    // Faces that were merged into a neighbor
+    uint32_t num_skipped_faces;   // Faces with less than three distinct corners after welding
 };
 
-Scene_Vertex* Scene_AddVertex(Scene* scene, glm::vec3 position);
+// Totals of Scene_OptimizeVertexCache over the faces it looked at, in the cache of SCENE_VERTEX_CACHE_SIZE vertices.
+// The ACMR is num_transforms / num_triangles and the ATVR num_transforms / num_vertices, 1.0 is the best an order can do.
+struct Scene_VertexCacheStats
+{
+    uint32_t num_triangles;
+    uint32_t num_vertices; // Geometry vertices the triangles use
 
-Scene_Face* Scene_ConstructFace(Scene* scene, Scene_Vertex** vertices, uint32_t num_vertices, glm::vec4 color);
+    // Vertices transformed by the vertex shader before and after, every cache miss transforms one
+    uint64_t num_input_transforms;
+    uint64_t num_transforms;
 
-bool32_t Scene_GenerateGeometry(
+    uint32_t num_reordered_faces;
+};
+
+struct Scene_Ray
+{
+    glm::vec3 origin;
+    float     min_length;
+
+    glm::vec3 direction; // NOTE: Must be a unit vector
+    float     max_length;
+};
+
+struct Scene_RayHit
+{
+    glm::vec3 intersection;
+    float     length;
+
+    uint32_t index; // Index of the hit face or vertex, SCENE_ID_NONE when nothing was hit
+};
+
+// A live element moved into a deleted slot by Scene_Defragment, the deleted element takes the slot it left
+struct Scene_DefragMove
+{
+    uint32_t source;
+    uint32_t target;
+    bool32_t is_face;
+};
+
+// Progress of the pass of Scene_Defragment that is running
+struct Scene_Defrag
+{
+    bool32_t is_running;
+
+    // Vertices from this one on are not moved by the pass anymore
+    uint32_t vertex_end;
+
+    // Faces before next_face are compact and the ones from source_face on were not looked at yet, everything in between is
+    // deleted and covers the half-edges from next_half_edge to source_half_edge
+    uint32_t next_face;
+    uint32_t next_half_edge;
+    uint32_t source_face;
+    uint32_t source_half_edge;
+
+    // Moves of the last call in the order they were made, for the holders of element indices to follow them
+    Arena             move_arena;
+    Scene_DefragMove* moves;
+    uint32_t          num_moves;
+};
+
+struct Scene
+{
+    Scene_Vertex* vertices;
+    uint32_t      num_vertices;
+
+    Scene_HalfEdge* half_edges;
+    uint32_t        num_half_edges;
+
+    Scene_Face* faces;
+    uint32_t    num_faces;
+
+    // Every topology array lives in its own reserved arena, so it grows in place and indices stay valid
+    Arena vertex_arena;
+    Arena half_edge_arena;
+    Arena face_arena;
+
+    // Empty between calls.
+    // NOTE: This arena, like every reserved arena of the scene and of the modules built on it, reserves enough for the largest
+    // possible scene. Allocations from them only fail when the system is out of memory, so callers only ASSERT the result.
+    Arena scratch_arena;
+
+    // Faces around moved vertices, their planes are recomputed in one batch before the next query or upload
+    Arena plane_flag_arena;
+    Arena plane_dirty_arena;
+
+    bool32_t* face_plane_dirty_flags;
+    uint32_t* dirty_plane_face_indices;
+    uint32_t  num_dirty_plane_faces;
+    uint32_t  num_plane_tracked_faces; // The flags only cover the faces below this one
+
+    // Every face whose corners or color changed, in order, for the face trackers to catch up with. Positions count every entry
+    // ever logged, the ones before first_face_change were dropped.
+    Arena     face_change_arena;
+    uint32_t* face_changes;
+    uint64_t  first_face_change;
+    uint64_t  end_face_change;
+
+    // Deleted elements keep their slots until they are reused or the defragmenter compacts the arrays.
+    // NOTE: Only the faces know how many half-edges they have, deleted half-edges are counted with their faces
+    uint32_t num_deleted_vertices;
+    uint32_t num_deleted_half_edges;
+    uint32_t num_deleted_faces;
+
+    // Stacks of deleted slots, faces by their number of corners starting at three. Entries are checked when they are popped,
+    // so the ones that went stale since they were pushed are skipped.
+    Arena     free_vertex_arena;
+    uint32_t* free_vertices;
+    uint32_t  num_free_vertices;
+
+    Arena     free_face_arenas[SCENE_NUM_FACE_FREE_LISTS];
+    uint32_t* free_faces[SCENE_NUM_FACE_FREE_LISTS];
+    uint32_t  num_free_faces[SCENE_NUM_FACE_FREE_LISTS];
+
+    Scene_Defrag defrag;
+
+    Scene_BVH bvh;
+    Scene_FacePlanes face_planes;
+    Scene_Geometry geometry;
+    Scene_PickGrid pick_grid;
+    Scene_Clusters clusters;
+
+    // Snapshots that are taken, every change of existing elements has to keep their original first
+    Scene_Snapshot* snapshots[SCENE_MAX_NUM_SNAPSHOTS];
+    uint32_t        num_snapshots;
+};
+
+bool32_t Scene_Init(Scene* scene);
+
+void Scene_Destroy(Scene* scene);
+
+// Writes the topology arrays to a level file, the file is only replaced once the new one was written completely
+bool32_t Scene_Save(Scene* scene, const char* path);
+
+// Initializes the scene from a level file written by Scene_Save. The topology arrays are mapped from the file as they are,
+// so loading costs no parsing and every page is read when it is first touched. Edits stay private to the scene.
+bool32_t Scene_Load(Scene* scene, const char* path);
+
+// Have to be called before elements are changed in place, so that snapshots keep their original.
+// NOTE: Only called from the thread that edits the scene, parallel passes prepare everything they will write up front
+inline void Scene_PrepareVertexWrite(Scene* scene, uint32_t first_vertex, uint32_t num_vertices);
+inline void Scene_PrepareHalfEdgeWrite(Scene* scene, uint32_t first_half_edge, uint32_t num_half_edges);
+inline void Scene_PrepareFaceWrite(Scene* scene, uint32_t first_face, uint32_t num_faces);
+
+// Returns the index of the new vertex or SCENE_ID_NONE when the scene is full
+uint32_t Scene_AddVertex(Scene* scene, glm::vec3 position);
+
+// Appends the vertices in order, returns the index of the first one or SCENE_ID_NONE when they do not fit
+uint32_t Scene_AddVertices(Scene* scene, const glm::vec3* positions, uint32_t num_vertices);
+
+// Returns the index of the new face or SCENE_ID_NONE when the scene is full
+uint32_t Scene_ConstructFace(Scene* scene, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color);
+
+// Appends the faces in order, face i uses the next face_num_vertices[i] entries of face_vertex_indices.
+// The result is identical to calling Scene_ConstructFace for every face, but the faces are written across the job
+// threads and around vertices with many outgoing half-edges the twins are matched by sorting edge keys.
+// Returns the index of the first new face or SCENE_ID_NONE when the faces do not fit, nothing is added then.
+uint32_t Scene_ConstructFaces(
+    Scene*           scene,
+    const uint32_t*  face_vertex_indices,
+    const uint32_t*  face_num_vertices,
+    const glm::vec4* face_colors,
+    uint32_t         num_faces
+);
+
+// Appends the mesh of an OBJ or binary PLY file, the format is told apart by the PLY magic.
+// The file is read and parsed in chunks across the job threads, vertices with identical positions are welded and the faces
+// go through Scene_ConstructFaces in large batches. Every face gets the given color.
+// Returns FALSE when the file can not be read or is malformed, nothing is added then.
+bool32_t Scene_Import(Scene* scene, const char* path, glm::vec4 face_color, Scene_ImportStats* out_stats);
+
+// Removes the vertex added last, which must not be used by any face anymore
+void Scene_RemoveLastVertex(Scene* scene);
+
+// Undoes the construction of the face constructed last, its twins become boundary edges again
+void Scene_RemoveLastFace(Scene* scene);
+
+// Unlinks the face from its neighbors and vertices, its twins become boundary edges again. The slot keeps its range of
+// half-edges, so the indices of every other element stay valid, and is reused by the next face with as many corners.
+void Scene_DeleteFace(Scene* scene, uint32_t face_index);
+
+// Deletes the faces on both sides of the edge
+void Scene_DeleteEdge(Scene* scene, uint32_t half_edge_index);
+
+// Deletes every face around the vertex and then the vertex itself
+void Scene_DeleteVertex(Scene* scene, uint32_t vertex_index);
+
+// Put an element back into the given slot, which is either deleted or the next one that would be appended.
+// NOTE: A deleted face slot only takes a face with as many corners as it had
+void Scene_RestoreVertex(Scene* scene, uint32_t vertex_index, glm::vec3 position);
+void Scene_RestoreFace(Scene* scene, uint32_t face_index, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color);
+
+// Drop every element from the given count on, the vertices must not be used by any face and the faces must be deleted or
+// unlinked already
+void Scene_TruncateVertices(Scene* scene, uint32_t num_vertices);
+void Scene_TruncateFaces(Scene* scene, uint32_t num_faces);
+
+// Drops every vertex and face, the scene is empty afterwards like after Scene_Init but keeps its memory.
+// NOTE: Every index changes, so journals have to be cleared afterwards
+void Scene_Clear(Scene* scene);
+
+// Refills the free lists from the deleted elements, after loading or when the stacks filled up with stale entries
+void Scene_RebuildFreeLists(Scene* scene);
+
+// Pop deleted slots off the free lists, SCENE_ID_NONE when none is left
+uint32_t Scene_PopFreeVertex(Scene* scene);
+uint32_t Scene_PopFreeFace(Scene* scene, uint32_t num_corners);
+
+// Compacts the arrays over several calls, moving at most max_num_moves elements per call. Live vertices are moved from the
+// end into holes, while faces slide down over the deleted ones in order, so the half-edges stay packed.
+// Derived structures follow the moves without being rebuilt, apart from a single rebuild when the pass drops the freed tail.
+// Returns TRUE once there is no pass running anymore.
+// NOTE: Moved elements change their index, journals follow them with Scene_Journal_FollowDefrag after every call
+bool32_t Scene_Defragment(Scene* scene, uint32_t max_num_moves);
+
+// Welds vertices within weld_distance of each other, then merges neighboring faces of the same color whose corners are all
+// within plane_distance of the plane of the face the merge started from. Merged faces keep every corner that another face
+// uses, so no T-junctions appear, and are only grown while they stay a single polygon without holes.
+// Welded away and merged away vertices are dropped and the scene is rebuilt compactly, so every index changes. Returns FALSE
+// when there was nothing to do and the scene was left alone, journals have to be cleared otherwise.
+bool32_t Scene_Optimize(Scene* scene, float weld_distance, float plane_distance, Scene_OptimizeStats* out_stats);
+
+// Renumbers vertices, faces and half-edges along a Morton curve through the scene, so that elements close in space are close
+// in memory too. Deleted elements are dropped on the way. Every index changes, so journals have to be cleared afterwards and
+// the whole geometry is uploaded again.
+void Scene_Reorder(Scene* scene);
+
+// Moves the vertex and marks every face around it, so that planes, acceleration structures and geometry follow
+void Scene_SetVertexPosition(Scene* scene, uint32_t vertex_index, glm::vec3 position);
+
+// NOTE: Has to be called after changing the position of the vertex directly, Scene_SetVertexPosition does it already
+void Scene_MarkVertexMoved(Scene* scene, uint32_t vertex_index);
+
+// Logs the face for the face trackers.
+// NOTE: Has to be called whenever the corners, the color or the half-edges of an existing face change, the scene functions do
+void Scene_MarkFaceChanged(Scene* scene, uint32_t face_index);
+
+// Makes every face tracker compare every face in its next update, for changes that renumber the faces
+void Scene_DropFaceChanges(Scene* scene);
+
+// Recomputes the planes of the faces around moved vertices, ray casts and geometry updates do it on their own
+void Scene_UpdateFacePlanes(Scene* scene);
+
+inline uint32_t Scene_HalfEdge_GetEndVertex(const Scene* scene, uint32_t half_edge_index);
+
+// Deleted vertices have SCENE_ID_DELETED as their first outgoing half-edge, and the half-edges of deleted faces have it
+// as their face
+inline bool32_t Scene_Vertex_IsDeleted(const Scene* scene, uint32_t vertex_index);
+inline bool32_t Scene_Face_IsDeleted(const Scene* scene, uint32_t face_index);
+
+// Computes the plane with Newell's method from all corners, so concave and slightly bent faces get a stable normal
+void Scene_Face_RecomputePlane(Scene* scene, uint32_t face_index);
+
+void Scene_Face_GetBounds(const Scene* scene, uint32_t face_index, glm::vec3* out_bounds_min, glm::vec3* out_bounds_max);
+
+// NOTE: ray_direction must be a unit vector
+bool32_t Scene_Face_IntersectRay(
     const Scene* scene,
+    uint32_t     face_index,
+    glm::vec3    ray_origin,
+    glm::vec3    ray_direction,
+    float        ray_min_length,
+    float        ray_max_length,
+    float*       out_ray_length
+);
+
+// Writes the geometry of all faces, every face at the range given by Scene_Face_GetFirstGeometryVertex/Index.
+// Returns FALSE when the buffers are too small.
+bool32_t Scene_GenerateGeometry(
+    Scene*       scene,
     SVertex*     vertices,
     uint32_t     max_num_vertices,
     uint32_t*    indices,
@@ -81,23 +391,120 @@ bool32_t Scene_GenerateGeometry(
     uint32_t*    out_num_indices
 );
 
-// NOTE: ray_direction must be a unit vector
-bool32_t Scene_RayCast_FindNearestIntersectingFace(
-    Scene*       scene,
-    glm::vec3    ray_origin,
-    glm::vec3    ray_direction,
-    float        ray_min_length,
-    float        ray_max_length,
-    Scene_Face** out_intersecting_face,
-    glm::vec3*   out_intersection
+// Reorders the triangles of every face in the range for the post-transform vertex cache with Tom Forsyth's scores, keeping
+// the new order only where fewer vertices are transformed. The reordered faces are uploaded again with the next dirty runs.
+// Adds to stats, so that a pass over many calls, each with a chunk of the faces, gives the totals of the whole pass.
+// NOTE: Faces own their vertices, so only the order within a face matters. The order is kept until the face is triangulated again.
+void Scene_OptimizeVertexCache(Scene* scene, uint32_t first_face, uint32_t num_faces, Scene_VertexCacheStats* stats);
+
+// Finds the nearest face along every ray, splitting large batches across the job threads.
+// Returns the number of rays that hit a face.
+uint32_t Scene_RayCast_FindNearestIntersectingFaces(
+    Scene*           scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
+);
+
+// Finds the vertex closest to every ray among the ones within max_length of its origin (min_length is ignored).
+// Returns the number of rays that found a vertex.
+uint32_t Scene_RayCast_FindNearestVertices(
+    const Scene*     scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
 );
 
 // NOTE: ray_direction must be a unit vector
-Scene_Vertex* Scene_RayCast_FindNearestVertex(
-    Scene*    scene,
-    glm::vec3 ray_origin,
-    glm::vec3 ray_direction,
-    float     max_distance
+bool32_t Scene_RayCast_FindNearestIntersectingFace(
+    Scene*     scene,
+    glm::vec3  ray_origin,
+    glm::vec3  ray_direction,
+    float      ray_min_length,
+    float      ray_max_length,
+    uint32_t*  out_intersecting_face_index,
+    glm::vec3* out_intersection
 );
 
+// Implementation of inline functions
+
+inline void Scene_PrepareVertexWrite(Scene* scene, uint32_t first_vertex, uint32_t num_vertices)
+{
+    if (scene->num_snapshots > 0)
+        Scene_Snapshot_PreserveRange(scene, SCENE_SNAPSHOT_ARRAY_VERTICES, (uint64_t)first_vertex * sizeof(Scene_Vertex), (uint64_t)num_vertices * sizeof(Scene_Vertex));
+}
+
+inline void Scene_PrepareHalfEdgeWrite(Scene* scene, uint32_t first_half_edge, uint32_t num_half_edges)
+{
+    if (scene->num_snapshots > 0)
+        Scene_Snapshot_PreserveRange(scene, SCENE_SNAPSHOT_ARRAY_HALF_EDGES, (uint64_t)first_half_edge * sizeof(Scene_HalfEdge), (uint64_t)num_half_edges * sizeof(Scene_HalfEdge));
+}
+
+inline void Scene_PrepareFaceWrite(Scene* scene, uint32_t first_face, uint32_t num_faces)
+{
+    if (scene->num_snapshots > 0)
+        Scene_Snapshot_PreserveRange(scene, SCENE_SNAPSHOT_ARRAY_FACES, (uint64_t)first_face * sizeof(Scene_Face), (uint64_t)num_faces * sizeof(Scene_Face));
+}
+
+inline uint32_t Scene_HalfEdge_GetEndVertex(const Scene* scene, uint32_t half_edge_index)
+{
+    return scene->half_edges[scene->half_edges[half_edge_index].next_half_edge].origin_vertex;
+}
+
+inline bool32_t Scene_Vertex_IsDeleted(const Scene* scene, uint32_t vertex_index)
+{
+    return scene->vertices[vertex_index].first_outgoing_half_edge == SCENE_ID_DELETED;
+}
+
+inline bool32_t Scene_Face_IsDeleted(const Scene* scene, uint32_t face_index)
+{
+    return scene->half_edges[scene->faces[face_index].first_half_edge].face == SCENE_ID_DELETED;
+}
+
+inline uint32_t Scene_Face_GetFirstGeometryVertex(const Scene* scene, uint32_t face_index)
+{
+    return scene->faces[face_index].first_half_edge;
+}
+
+inline uint32_t Scene_Face_GetFirstGeometryIndex(const Scene* scene, uint32_t face_index)
+{
+    // Every earlier face is split into (num_half_edges - 2) triangles
+    return 3 * (scene->faces[face_index].first_half_edge - 2 * face_index);
+}
+
+inline uint32_t Scene_GetNumGeometryVertices(const Scene* scene)
+{
+    return scene->num_half_edges;
+}
+
+inline uint32_t Scene_GetNumGeometryIndices(const Scene* scene)
+{
+    return 3 * (scene->num_half_edges - 2 * scene->num_faces);
+}
+
+inline uint32_t Scene_GetNumClusters(const Scene* scene)
+{
+    return (scene->num_faces + SCENE_CLUSTER_NUM_FACES - 1) / SCENE_CLUSTER_NUM_FACES;
+}
+
+inline void Scene_Cluster_GetBounds(const Scene* scene, uint32_t cluster_index, glm::vec3* out_bounds_min, glm::vec3* out_bounds_max)
+{
+    const Scene_Clusters_Group* group = scene->clusters.groups + cluster_index / SCENE_CLUSTERS_NUM_LANES;
+    uint32_t lane = cluster_index % SCENE_CLUSTERS_NUM_LANES;
+
+    *out_bounds_min = glm::vec3(group->min_x[lane], group->min_y[lane], group->min_z[lane]);
+    *out_bounds_max = glm::vec3(group->max_x[lane], group->max_y[lane], group->max_z[lane]);
+}
+
+inline void Scene_Cluster_GetGeometryIndices(const Scene* scene, uint32_t cluster_index, uint32_t* out_first_index, uint32_t* out_num_indices)
+{
+    uint32_t first_face = cluster_index * SCENE_CLUSTER_NUM_FACES;
+    uint32_t end_face = first_face + SCENE_CLUSTER_NUM_FACES;
+
+    uint32_t end_index = (end_face < scene->num_faces) ? Scene_Face_GetFirstGeometryIndex(scene, end_face) : Scene_GetNumGeometryIndices(scene);
+
+    *out_first_index = Scene_Face_GetFirstGeometryIndex(scene, first_face);
+    *out_num_indices = end_index - *out_first_index;
+}
+
 #endif // !SCENE_HPP_
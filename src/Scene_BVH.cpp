@@ -0,0 +1,632 @@
+#include "Scene.hpp"
+
+#include <float.h>
+#include <string.h>
+
+// Every face needs at most two nodes, its references and dirty tracking, plus the build scratch of bounds and centroids
+#define SCENE_BVH_ARENA_BYTES_PER_FACE (2 * (sizeof(Scene_BVH_Node) + sizeof(uint32_t)) + 3 * sizeof(uint32_t) + sizeof(bool32_t) + 3 * sizeof(glm::vec3))
+#define SCENE_BVH_ARENA_CAPACITY ((uint64_t)SCENE_MAX_NUM_FACES * SCENE_BVH_ARENA_BYTES_PER_FACE + ARENA_COMMIT_GRANULARITY)
+
+// Relative costs of visiting an inner node and of testing a ray against a single face
+#define SCENE_BVH_TRAVERSAL_COST 1.0f
+#define SCENE_BVH_INTERSECTION_COST 2.0f
+
+struct Scene_BVH_Bin
+{
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    uint32_t  num_faces;
+};
+
+struct Scene_BVH_BuildTask
+{
+    uint32_t node_index;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t depth; // Of the node, the root is at 0
+};
+
+static float Scene_BVH_GetSurfaceArea(glm::vec3 bounds_min, glm::vec3 bounds_max)
+{
+    glm::vec3 extent = glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+    return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+static float Scene_BVH_GetWeightedNodeArea(const Scene_BVH_Node* node)
+{
+    float area = Scene_BVH_GetSurfaceArea(node->bounds_min, node->bounds_max);
+
+    if (node->num_faces > 0)
+        return area * node->num_faces * SCENE_BVH_INTERSECTION_COST;
+
+    return area * SCENE_BVH_TRAVERSAL_COST;
+}
+
+static void Scene_BVH_ComputeLeafBounds(const Scene* scene, Scene_BVH_Node* leaf)
+{
+    glm::vec3 bounds_min( FLT_MAX);
+    glm::vec3 bounds_max(-FLT_MAX);
+
+    for (uint32_t i = 0; i < leaf->num_faces; ++i)
+    {
+        glm::vec3 face_bounds_min, face_bounds_max;
+        Scene_Face_GetBounds(scene, scene->bvh.face_indices[leaf->first + i], &face_bounds_min, &face_bounds_max);
+
+        bounds_min = glm::min(bounds_min, face_bounds_min);
+        bounds_max = glm::max(bounds_max, face_bounds_max);
+    }
+
+    leaf->bounds_min = bounds_min;
+    leaf->bounds_max = bounds_max;
+}
+
+bool32_t Scene_BVH_Init(Scene_BVH* bvh)
+{
+    memset(bvh, 0, sizeof(Scene_BVH));
+    return Arena_CreateReserved(&bvh->arena, SCENE_BVH_ARENA_CAPACITY);
+}
+
+void Scene_BVH_Destroy(Scene_BVH* bvh)
+{
+    Arena_Destroy(&bvh->arena);
+    memset(bvh, 0, sizeof(Scene_BVH));
+}
+
+static void Scene_BVH_SwapReferences(
+    uint32_t*  face_indices,
+    glm::vec3* face_bounds_min,
+    glm::vec3* face_bounds_max,
+    glm::vec3* face_centroids,
+    uint32_t   a,
+    uint32_t   b
+)
+{
+    uint32_t  face_index = face_indices[a];
+    glm::vec3 bounds_min = face_bounds_min[a];
+    glm::vec3 bounds_max = face_bounds_max[a];
+    glm::vec3 centroid   = face_centroids[a];
+
+    face_indices[a]    = face_indices[b];
+    face_bounds_min[a] = face_bounds_min[b];
+    face_bounds_max[a] = face_bounds_max[b];
+    face_centroids[a]  = face_centroids[b];
+
+    face_indices[b]    = face_index;
+    face_bounds_min[b] = bounds_min;
+    face_bounds_max[b] = bounds_max;
+    face_centroids[b]  = centroid;
+}
+
+void Scene_BVH_Build(Scene* scene)
+{
+    Scene_BVH* bvh = &scene->bvh;
+
+    uint32_t num_faces = scene->num_faces;
+    uint32_t max_num_nodes = (num_faces > 0) ? 2 * num_faces - 1 : 0;
+
+    Arena_Reset(&bvh->arena);
+
+    bvh->nodes              = ARENA_ALLOCATE_ARRAY(&bvh->arena, Scene_BVH_Node, max_num_nodes);
+    bvh->node_parents       = ARENA_ALLOCATE_ARRAY(&bvh->arena, uint32_t, max_num_nodes);
+    bvh->face_indices       = ARENA_ALLOCATE_ARRAY(&bvh->arena, uint32_t, num_faces);
+    bvh->face_leaves        = ARENA_ALLOCATE_ARRAY(&bvh->arena, uint32_t, num_faces);
+    bvh->dirty_face_indices = ARENA_ALLOCATE_ARRAY(&bvh->arena, uint32_t, num_faces);
+    bvh->face_dirty_flags   = ARENA_ALLOCATE_ARRAY(&bvh->arena, bool32_t, num_faces);
+
+    ASSERT(bvh->nodes && bvh->node_parents && bvh->face_indices && bvh->face_leaves && bvh->dirty_face_indices && bvh->face_dirty_flags);
+
+    bvh->num_nodes = 0;
+    bvh->num_faces = num_faces;
+    bvh->num_dirty_faces = 0;
+    bvh->build_cost = 0.0f;
+    bvh->weighted_area_sum = 0.0f;
+    bvh->needs_rebuild = FALSE;
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+        bvh->face_dirty_flags[i] = FALSE;
+
+    if (num_faces == 0)
+        return;
+
+    // The per face bounds are only needed while building, so they are freed again at the end.
+    // NOTE: They are kept in the same order as face_indices and partitioned along with it, so every pass reads them sequentially.
+    uint64_t scratch_offset = bvh->arena.offset;
+
+    glm::vec3* face_bounds_min = ARENA_ALLOCATE_ARRAY(&bvh->arena, glm::vec3, num_faces);
+    glm::vec3* face_bounds_max = ARENA_ALLOCATE_ARRAY(&bvh->arena, glm::vec3, num_faces);
+    glm::vec3* face_centroids  = ARENA_ALLOCATE_ARRAY(&bvh->arena, glm::vec3, num_faces);
+
+    ASSERT(face_bounds_min && face_bounds_max && face_centroids);
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        Scene_Face_GetBounds(scene, i, face_bounds_min + i, face_bounds_max + i);
+        face_centroids[i] = 0.5f * (face_bounds_min[i] + face_bounds_max[i]);
+
+        bvh->face_indices[i] = i;
+    }
+
+    Scene_BVH_BuildTask tasks[SCENE_BVH_MAX_DEPTH];
+    uint32_t num_tasks = 0;
+
+    bvh->node_parents[0] = SCENE_ID_NONE;
+    bvh->num_nodes = 1;
+
+    tasks[num_tasks++] = { 0, 0, num_faces, 0 };
+
+    while (num_tasks > 0)
+    {
+        Scene_BVH_BuildTask task = tasks[--num_tasks];
+        Scene_BVH_Node* node = bvh->nodes + task.node_index;
+
+        glm::vec3 bounds_min( FLT_MAX), bounds_max(-FLT_MAX);
+        glm::vec3 centroid_min( FLT_MAX), centroid_max(-FLT_MAX);
+
+        for (uint32_t i = task.begin; i < task.end; ++i)
+        {
+            bounds_min = glm::min(bounds_min, face_bounds_min[i]);
+            bounds_max = glm::max(bounds_max, face_bounds_max[i]);
+
+            centroid_min = glm::min(centroid_min, face_centroids[i]);
+            centroid_max = glm::max(centroid_max, face_centroids[i]);
+        }
+
+        node->bounds_min = bounds_min;
+        node->bounds_max = bounds_max;
+
+        uint32_t num_task_faces = task.end - task.begin;
+
+        // Find the cheapest binned SAH split over all three axes
+
+        float    best_cost = FLT_MAX;
+        uint32_t best_axis = 0;
+        uint32_t best_split = 0;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float extent = centroid_max[axis] - centroid_min[axis];
+            if (extent <= 0.0f)
+                continue;
+
+            Scene_BVH_Bin bins[SCENE_BVH_NUM_BINS];
+            for (uint32_t b = 0; b < SCENE_BVH_NUM_BINS; ++b)
+                bins[b] = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX), 0 };
+
+            float bin_scale = SCENE_BVH_NUM_BINS / extent;
+
+            for (uint32_t i = task.begin; i < task.end; ++i)
+            {
+                uint32_t b = (uint32_t)((face_centroids[i][axis] - centroid_min[axis]) * bin_scale);
+                if (b >= SCENE_BVH_NUM_BINS) b = SCENE_BVH_NUM_BINS - 1;
+
+                bins[b].bounds_min = glm::min(bins[b].bounds_min, face_bounds_min[i]);
+                bins[b].bounds_max = glm::max(bins[b].bounds_max, face_bounds_max[i]);
+                ++bins[b].num_faces;
+            }
+
+            // Sweep from the right to get the cost of every right side, then from the left to combine it
+
+            float right_costs[SCENE_BVH_NUM_BINS];
+
+            glm::vec3 sweep_min(FLT_MAX), sweep_max(-FLT_MAX);
+            uint32_t  sweep_num_faces = 0;
+
+            for (uint32_t b = SCENE_BVH_NUM_BINS - 1; b > 0; --b)
+            {
+                sweep_min = glm::min(sweep_min, bins[b].bounds_min);
+                sweep_max = glm::max(sweep_max, bins[b].bounds_max);
+                sweep_num_faces += bins[b].num_faces;
+
+                right_costs[b] = sweep_num_faces * Scene_BVH_GetSurfaceArea(sweep_min, sweep_max);
+            }
+
+            sweep_min = glm::vec3( FLT_MAX);
+            sweep_max = glm::vec3(-FLT_MAX);
+            sweep_num_faces = 0;
+
+            for (uint32_t b = 0; b < SCENE_BVH_NUM_BINS - 1; ++b)
+            {
+                sweep_min = glm::min(sweep_min, bins[b].bounds_min);
+                sweep_max = glm::max(sweep_max, bins[b].bounds_max);
+                sweep_num_faces += bins[b].num_faces;
+
+                if (sweep_num_faces == 0 || sweep_num_faces == num_task_faces)
+                    continue;
+
+                float cost = sweep_num_faces * Scene_BVH_GetSurfaceArea(sweep_min, sweep_max) + right_costs[b + 1];
+
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b + 1;
+                }
+            }
+        }
+
+        float node_area = Scene_BVH_GetSurfaceArea(bounds_min, bounds_max);
+
+        float leaf_cost = num_task_faces * SCENE_BVH_INTERSECTION_COST;
+        float split_cost = (node_area > 0.0f)
+            ? SCENE_BVH_TRAVERSAL_COST + SCENE_BVH_INTERSECTION_COST * best_cost / node_area
+            : FLT_MAX;
+
+        bool32_t make_leaf = (num_task_faces == 1) || (num_task_faces <= SCENE_BVH_MAX_LEAF_SIZE && leaf_cost <= split_cost);
+
+        // NOTE: Nodes at the last level are leaves, so that the task stack and the traversal stacks, which hold at most one
+        // pending node per level, never overflow. Very deep trees fall back to fat leaves.
+        if (task.depth + 1 >= SCENE_BVH_MAX_DEPTH)
+            make_leaf = TRUE;
+
+        uint32_t mid = task.begin;
+
+        if (!make_leaf)
+        {
+            if (best_cost == FLT_MAX)
+            {
+                // All centroids coincide, split the range in half
+                mid = task.begin + num_task_faces / 2;
+            }
+            else
+            {
+                float extent = centroid_max[best_axis] - centroid_min[best_axis];
+                float bin_scale = SCENE_BVH_NUM_BINS / extent;
+
+                uint32_t left = task.begin;
+                uint32_t right = task.end;
+
+                while (left < right)
+                {
+                    uint32_t b = (uint32_t)((face_centroids[left][best_axis] - centroid_min[best_axis]) * bin_scale);
+                    if (b >= SCENE_BVH_NUM_BINS) b = SCENE_BVH_NUM_BINS - 1;
+
+                    if (b < best_split)
+                    {
+                        ++left;
+                    }
+                    else
+                    {
+                        --right;
+
+                        Scene_BVH_SwapReferences(bvh->face_indices, face_bounds_min, face_bounds_max, face_centroids, left, right);
+                    }
+                }
+
+                mid = left;
+            }
+        }
+
+        if (make_leaf || mid == task.begin || mid == task.end)
+        {
+            node->first = task.begin;
+            node->num_faces = num_task_faces;
+
+            for (uint32_t i = task.begin; i < task.end; ++i)
+                bvh->face_leaves[bvh->face_indices[i]] = task.node_index;
+        }
+        else
+        {
+            ASSERT(bvh->num_nodes + 2 <= max_num_nodes);
+
+            uint32_t left_child_index = bvh->num_nodes;
+            bvh->num_nodes += 2;
+
+            node->first = left_child_index;
+            node->num_faces = 0;
+
+            bvh->node_parents[left_child_index] = task.node_index;
+            bvh->node_parents[left_child_index + 1] = task.node_index;
+
+            ASSERT(num_tasks + 2 <= SCENE_BVH_MAX_DEPTH);
+
+            tasks[num_tasks++] = { left_child_index, task.begin, mid, task.depth + 1 };
+            tasks[num_tasks++] = { left_child_index + 1, mid, task.end, task.depth + 1 };
+        }
+
+        bvh->weighted_area_sum += Scene_BVH_GetWeightedNodeArea(node);
+    }
+
+    Arena_Rewind(&bvh->arena, scratch_offset);
+
+    bvh->build_cost = Scene_BVH_GetCost(scene);
+}
+
+void Scene_BVH_MarkFaceDirty(Scene* scene, uint32_t face_index)
+{
+    Scene_BVH* bvh = &scene->bvh;
+
+    // Faces that are not in the tree yet are picked up by the next rebuild
+    if (face_index >= bvh->num_faces || bvh->face_dirty_flags[face_index])
+        return;
+
+    bvh->face_dirty_flags[face_index] = TRUE;
+    bvh->dirty_face_indices[bvh->num_dirty_faces++] = face_index;
+}
+
+static uint32_t Scene_BVH_FindLeafSlot(const Scene_BVH* bvh, uint32_t face_index)
+{
+    const Scene_BVH_Node* leaf = bvh->nodes + bvh->face_leaves[face_index];
+
+    for (uint32_t i = leaf->first; i < leaf->first + leaf->num_faces; ++i)
+    {
+        if (bvh->face_indices[i] == face_index)
+            return i;
+    }
+
+    UNREACHABLE;
+    return SCENE_ID_NONE;
+}
+
+void Scene_BVH_SwapFaces(Scene* scene, uint32_t face_index_a, uint32_t face_index_b)
+{
+    Scene_BVH* bvh = &scene->bvh;
+
+    // A tree that is rebuilt anyway does not have to follow
+    if (bvh->needs_rebuild || bvh->num_nodes == 0 || bvh->num_faces != scene->num_faces)
+        return;
+
+    ASSERT(face_index_a < bvh->num_faces && face_index_b < bvh->num_faces);
+
+    uint32_t slot_a = Scene_BVH_FindLeafSlot(bvh, face_index_a);
+    uint32_t slot_b = Scene_BVH_FindLeafSlot(bvh, face_index_b);
+
+    bvh->face_indices[slot_a] = face_index_b;
+    bvh->face_indices[slot_b] = face_index_a;
+
+    uint32_t leaf = bvh->face_leaves[face_index_a];
+    bvh->face_leaves[face_index_a] = bvh->face_leaves[face_index_b];
+    bvh->face_leaves[face_index_b] = leaf;
+
+    // Pending refits belong to the faces, not to their old indices
+    if (bvh->face_dirty_flags[face_index_a] != bvh->face_dirty_flags[face_index_b])
+    {
+        Scene_BVH_MarkFaceDirty(scene, face_index_a);
+        Scene_BVH_MarkFaceDirty(scene, face_index_b);
+    }
+}
+
+void Scene_BVH_Update(Scene* scene)
+{
+    Scene_BVH* bvh = &scene->bvh;
+
+    if (bvh->needs_rebuild || bvh->num_nodes == 0 || bvh->num_faces != scene->num_faces)
+    {
+        Scene_BVH_Build(scene);
+        return;
+    }
+
+    if (bvh->num_dirty_faces == 0)
+        return;
+
+    for (uint32_t i = 0; i < bvh->num_dirty_faces; ++i)
+    {
+        uint32_t face_index = bvh->dirty_face_indices[i];
+        bvh->face_dirty_flags[face_index] = FALSE;
+
+        uint32_t node_index = bvh->face_leaves[face_index];
+
+        Scene_BVH_Node* leaf = bvh->nodes + node_index;
+
+        bvh->weighted_area_sum -= Scene_BVH_GetWeightedNodeArea(leaf);
+        Scene_BVH_ComputeLeafBounds(scene, leaf);
+        bvh->weighted_area_sum += Scene_BVH_GetWeightedNodeArea(leaf);
+
+        // Propagate towards the root, stopping as soon as a node does not change anymore
+        node_index = bvh->node_parents[node_index];
+
+        while (node_index != SCENE_ID_NONE)
+        {
+            Scene_BVH_Node* node = bvh->nodes + node_index;
+
+            const Scene_BVH_Node* left = bvh->nodes + node->first;
+            const Scene_BVH_Node* right = left + 1;
+
+            glm::vec3 bounds_min = glm::min(left->bounds_min, right->bounds_min);
+            glm::vec3 bounds_max = glm::max(left->bounds_max, right->bounds_max);
+
+            if (bounds_min == node->bounds_min && bounds_max == node->bounds_max)
+                break;
+
+            bvh->weighted_area_sum -= Scene_BVH_GetWeightedNodeArea(node);
+            node->bounds_min = bounds_min;
+            node->bounds_max = bounds_max;
+            bvh->weighted_area_sum += Scene_BVH_GetWeightedNodeArea(node);
+
+            node_index = bvh->node_parents[node_index];
+        }
+    }
+
+    bvh->num_dirty_faces = 0;
+
+    if (Scene_BVH_GetCost(scene) > bvh->build_cost * SCENE_BVH_REBUILD_COST_RATIO)
+        Scene_BVH_Build(scene);
+}
+
+float Scene_BVH_GetCost(const Scene* scene)
+{
+    const Scene_BVH* bvh = &scene->bvh;
+
+    if (bvh->num_nodes == 0)
+        return 0.0f;
+
+    float root_area = Scene_BVH_GetSurfaceArea(bvh->nodes[0].bounds_min, bvh->nodes[0].bounds_max);
+    if (root_area <= 0.0f)
+        return 0.0f;
+
+    return bvh->weighted_area_sum / root_area;
+}
+
+// Rays of a packet in structure-of-arrays form, lanes past the packet size repeat the first ray
+struct Scene_BVH_RayPacket
+{
+    float origin_x[SCENE_RAY_PACKET_SIZE];
+    float origin_y[SCENE_RAY_PACKET_SIZE];
+    float origin_z[SCENE_RAY_PACKET_SIZE];
+
+    float inverse_direction_x[SCENE_RAY_PACKET_SIZE];
+    float inverse_direction_y[SCENE_RAY_PACKET_SIZE];
+    float inverse_direction_z[SCENE_RAY_PACKET_SIZE];
+
+    float min_length[SCENE_RAY_PACKET_SIZE];
+    float hit_length[SCENE_RAY_PACKET_SIZE];
+};
+
+struct Scene_BVH_PacketStackEntry
+{
+    uint32_t node_index;
+    uint32_t ray_mask;
+};
+
+// Returns the mask of the rays in ray_mask that hit the bounds, the loop is written so that it vectorizes
+static uint32_t Scene_BVH_IntersectBoundsPacket(
+    const Scene_BVH_Node*      node,
+    const Scene_BVH_RayPacket* packet,
+    uint32_t                   ray_mask,
+    float*                     out_min_entry_length
+)
+{
+    uint32_t hit_mask = 0;
+    float    min_entry_length = FLT_MAX;
+
+    for (uint32_t lane = 0; lane < SCENE_RAY_PACKET_SIZE; ++lane)
+    {
+        float tx0 = (node->bounds_min.x - packet->origin_x[lane]) * packet->inverse_direction_x[lane];
+        float tx1 = (node->bounds_max.x - packet->origin_x[lane]) * packet->inverse_direction_x[lane];
+        float ty0 = (node->bounds_min.y - packet->origin_y[lane]) * packet->inverse_direction_y[lane];
+        float ty1 = (node->bounds_max.y - packet->origin_y[lane]) * packet->inverse_direction_y[lane];
+        float tz0 = (node->bounds_min.z - packet->origin_z[lane]) * packet->inverse_direction_z[lane];
+        float tz1 = (node->bounds_max.z - packet->origin_z[lane]) * packet->inverse_direction_z[lane];
+
+        float t_entry = glm::max(glm::max(glm::min(tx0, tx1), glm::min(ty0, ty1)), glm::max(glm::min(tz0, tz1), packet->min_length[lane]));
+        float t_exit = glm::min(glm::min(glm::max(tx0, tx1), glm::max(ty0, ty1)), glm::min(glm::max(tz0, tz1), packet->hit_length[lane]));
+
+        uint32_t lane_hit = (t_entry <= t_exit) ? 1u : 0u;
+        hit_mask |= lane_hit << lane;
+
+        if (lane_hit && (ray_mask & (1u << lane)) && t_entry < min_entry_length)
+            min_entry_length = t_entry;
+    }
+
+    *out_min_entry_length = min_entry_length;
+    return hit_mask & ray_mask;
+}
+
+void Scene_BVH_RayCastPacket(
+    const Scene*     scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
+)
+{
+    const Scene_BVH* bvh = &scene->bvh;
+
+    ASSERT(num_rays > 0 && num_rays <= SCENE_RAY_PACKET_SIZE);
+
+    Scene_BVH_RayPacket packet;
+    uint32_t            hit_face_indices[SCENE_RAY_PACKET_SIZE];
+
+    for (uint32_t lane = 0; lane < SCENE_RAY_PACKET_SIZE; ++lane)
+    {
+        const Scene_Ray* ray = rays + ((lane < num_rays) ? lane : 0);
+
+        packet.origin_x[lane] = ray->origin.x;
+        packet.origin_y[lane] = ray->origin.y;
+        packet.origin_z[lane] = ray->origin.z;
+
+        packet.inverse_direction_x[lane] = 1.0f / ray->direction.x;
+        packet.inverse_direction_y[lane] = 1.0f / ray->direction.y;
+        packet.inverse_direction_z[lane] = 1.0f / ray->direction.z;
+
+        packet.min_length[lane] = ray->min_length;
+        packet.hit_length[lane] = ray->max_length;
+
+        hit_face_indices[lane] = SCENE_ID_NONE;
+    }
+
+    uint32_t ray_mask = (1u << num_rays) - 1;
+
+    Scene_BVH_PacketStackEntry stack[SCENE_BVH_MAX_DEPTH];
+    uint32_t stack_size = 0;
+
+    if (bvh->num_nodes > 0)
+    {
+        float entry_length;
+        uint32_t root_mask = Scene_BVH_IntersectBoundsPacket(bvh->nodes, &packet, ray_mask, &entry_length);
+
+        if (root_mask != 0)
+            stack[stack_size++] = { 0, root_mask };
+    }
+
+    while (stack_size > 0)
+    {
+        Scene_BVH_PacketStackEntry entry = stack[--stack_size];
+        const Scene_BVH_Node* node = bvh->nodes + entry.node_index;
+
+        if (node->num_faces > 0)
+        {
+            for (uint32_t i = 0; i < node->num_faces; ++i)
+            {
+                uint32_t face_index = bvh->face_indices[node->first + i];
+
+                for (uint32_t lane = 0; lane < num_rays; ++lane)
+                {
+                    if (!(entry.ray_mask & (1u << lane)))
+                        continue;
+
+                    const Scene_Ray* ray = rays + lane;
+
+                    float distance;
+                    if (Scene_FacePlanes_IntersectFace(scene, face_index, ray->origin, ray->direction, ray->min_length, packet.hit_length[lane], &distance))
+                    {
+                        packet.hit_length[lane] = distance;
+                        hit_face_indices[lane] = face_index;
+                    }
+                }
+            }
+
+            continue;
+        }
+
+        uint32_t left_index = node->first;
+        uint32_t right_index = node->first + 1;
+
+        float left_entry_length, right_entry_length;
+        uint32_t left_mask = Scene_BVH_IntersectBoundsPacket(bvh->nodes + left_index, &packet, entry.ray_mask, &left_entry_length);
+        uint32_t right_mask = Scene_BVH_IntersectBoundsPacket(bvh->nodes + right_index, &packet, entry.ray_mask, &right_entry_length);
+
+        // Push the farther child first, so that the nearer one is visited first and shrinks the rays early
+        if (left_mask && right_mask)
+        {
+            // NOTE: Builds stop at SCENE_BVH_MAX_DEPTH levels and the stack holds at most one pending node per level
+            ASSERT(stack_size + 2 <= SCENE_BVH_MAX_DEPTH);
+
+            if (left_entry_length <= right_entry_length)
+            {
+                stack[stack_size++] = { right_index, right_mask };
+                stack[stack_size++] = { left_index, left_mask };
+            }
+            else
+            {
+                stack[stack_size++] = { left_index, left_mask };
+                stack[stack_size++] = { right_index, right_mask };
+            }
+        }
+        else if (left_mask)
+        {
+            stack[stack_size++] = { left_index, left_mask };
+        }
+        else if (right_mask)
+        {
+            stack[stack_size++] = { right_index, right_mask };
+        }
+    }
+
+    for (uint32_t lane = 0; lane < num_rays; ++lane)
+    {
+        Scene_RayHit* hit = out_hits + lane;
+
+        hit->index = hit_face_indices[lane];
+        hit->length = packet.hit_length[lane];
+        hit->intersection = rays[lane].origin + packet.hit_length[lane] * rays[lane].direction;
+    }
+}
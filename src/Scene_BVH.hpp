@@ -0,0 +1,81 @@
+#ifndef SCENE_BVH_HPP_
+#define SCENE_BVH_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+#define SCENE_BVH_MAX_LEAF_SIZE 4
+// Levels of the tree, the build makes leaves of the nodes at the last one
+#define SCENE_BVH_MAX_DEPTH 64
+#define SCENE_BVH_NUM_BINS 12
+
+// The tree is rebuilt once refitting has made its SAH cost this many times worse than right after the build
+#define SCENE_BVH_REBUILD_COST_RATIO 1.5f
+
+struct Scene;
+struct Scene_Ray;
+struct Scene_RayHit;
+
+struct Scene_BVH_Node
+{
+    glm::vec3 bounds_min;
+    uint32_t  first; // Index of the left child (the right one follows it) or of the first face reference for leaves
+
+    glm::vec3 bounds_max;
+    uint32_t  num_faces; // Zero for inner nodes
+};
+
+struct Scene_BVH
+{
+    // Holds every array below, all of them are sized for the faces at build time
+    Arena arena;
+
+    Scene_BVH_Node* nodes;
+    uint32_t*       node_parents;
+    uint32_t        num_nodes;
+
+    // Face references ordered so that every leaf owns a contiguous range
+    uint32_t* face_indices;
+    uint32_t* face_leaves;
+    uint32_t  num_faces;
+
+    uint32_t* dirty_face_indices;
+    bool32_t* face_dirty_flags;
+    uint32_t  num_dirty_faces;
+
+    // SAH cost is tracked as a sum of area weighted node costs, normalized by the root area on demand
+    float build_cost;
+    float weighted_area_sum;
+
+    // Set when faces were removed, the face count alone can not tell that the faces changed
+    bool32_t needs_rebuild;
+};
+
+bool32_t Scene_BVH_Init(Scene_BVH* bvh);
+
+void Scene_BVH_Destroy(Scene_BVH* bvh);
+
+void Scene_BVH_Build(Scene* scene);
+
+void Scene_BVH_MarkFaceDirty(Scene* scene, uint32_t face_index);
+
+// Exchanges the references of two faces that swapped their indices, so that each stays in the leaf it was in
+void Scene_BVH_SwapFaces(Scene* scene, uint32_t face_index_a, uint32_t face_index_b);
+
+// Refits the bounds of dirty faces and rebuilds the tree when it is out of date or its quality got too bad
+void Scene_BVH_Update(Scene* scene);
+
+float Scene_BVH_GetCost(const Scene* scene);
+
+// Finds the nearest face for up to SCENE_RAY_PACKET_SIZE rays, which traverse the tree together
+// NOTE: The tree and the face plane mirror must be up to date
+void Scene_BVH_RayCastPacket(
+    const Scene*     scene,
+    const Scene_Ray* rays,
+    uint32_t         num_rays,
+    Scene_RayHit*    out_hits
+);
+
+#endif // !SCENE_BVH_HPP_
@@ -0,0 +1,365 @@
+#include "Scene.hpp"
+#include "Cpu.hpp"
+#include "Jobs.hpp"
+
+#include <float.h>
+#include <string.h>
+
+#if FPS_ARCH_X86
+#   include <immintrin.h>
+#endif
+
+// A group and an empty mask per lane at worst, and the dirty tracking per cluster
+#define SCENE_CLUSTERS_ARENA_CAPACITY ( \
+    (uint64_t)SCENE_MAX_NUM_CLUSTERS * (sizeof(Scene_Clusters_Group) + 2 * sizeof(uint32_t) + sizeof(bool32_t)) + \
+    ARENA_COMMIT_GRANULARITY \
+)
+
+// Plane of the view frustum, a point is inside when dot(normal, p) + offset >= 0
+struct Scene_Clusters_Plane
+{
+    glm::vec3 normal;
+    float     offset;
+};
+
+static void Scene_Clusters_WriteCluster(Scene_Clusters* clusters, const Scene* scene, uint32_t cluster_index)
+{
+    glm::vec3 bounds_min( FLT_MAX);
+    glm::vec3 bounds_max(-FLT_MAX);
+
+    uint32_t first_face = cluster_index * SCENE_CLUSTER_NUM_FACES;
+    uint32_t end_face = glm::min(first_face + SCENE_CLUSTER_NUM_FACES, scene->num_faces);
+
+    for (uint32_t i = first_face; i < end_face; ++i)
+    {
+        if (Scene_Face_IsDeleted(scene, i))
+            continue;
+
+        glm::vec3 face_bounds_min, face_bounds_max;
+        Scene_Face_GetBounds(scene, i, &face_bounds_min, &face_bounds_max);
+
+        bounds_min = glm::min(bounds_min, face_bounds_min);
+        bounds_max = glm::max(bounds_max, face_bounds_max);
+    }
+
+    Scene_Clusters_Group* group = clusters->groups + cluster_index / SCENE_CLUSTERS_NUM_LANES;
+    uint32_t lane = cluster_index % SCENE_CLUSTERS_NUM_LANES;
+
+    group->min_x[lane] = bounds_min.x;
+    group->min_y[lane] = bounds_min.y;
+    group->min_z[lane] = bounds_min.z;
+    group->max_x[lane] = bounds_max.x;
+    group->max_y[lane] = bounds_max.y;
+    group->max_z[lane] = bounds_max.z;
+
+    // NOTE: Build tasks cover whole groups, so no other thread writes the mask of the group
+    uint32_t* empty_mask = clusters->group_empty_masks + cluster_index / SCENE_CLUSTERS_NUM_LANES;
+
+    if (bounds_min.x > bounds_max.x)
+        *empty_mask |= 1u << lane;
+    else
+        *empty_mask &= ~(1u << lane);
+}
+
+bool32_t Scene_Clusters_Init(Scene_Clusters* clusters)
+{
+    memset(clusters, 0, sizeof(Scene_Clusters));
+    return Arena_CreateReserved(&clusters->arena, SCENE_CLUSTERS_ARENA_CAPACITY);
+}
+
+void Scene_Clusters_Destroy(Scene_Clusters* clusters)
+{
+    Arena_Destroy(&clusters->arena);
+    memset(clusters, 0, sizeof(Scene_Clusters));
+}
+
+static void Scene_Clusters_Build_Task(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene* scene = (Scene*)user_data;
+
+    for (uint32_t i = begin; i < end; ++i)
+        Scene_Clusters_WriteCluster(&scene->clusters, scene, i);
+}
+
+void Scene_Clusters_Build(Scene* scene)
+{
+    Scene_Clusters* clusters = &scene->clusters;
+
+    uint32_t num_clusters = Scene_GetNumClusters(scene);
+    uint32_t num_groups = (num_clusters + SCENE_CLUSTERS_NUM_LANES - 1) / SCENE_CLUSTERS_NUM_LANES;
+
+    Arena_Reset(&clusters->arena);
+
+    clusters->groups                = ARENA_ALLOCATE_ARRAY(&clusters->arena, Scene_Clusters_Group, num_groups);
+    clusters->group_empty_masks     = ARENA_ALLOCATE_ARRAY(&clusters->arena, uint32_t, num_groups);
+    clusters->dirty_cluster_indices = ARENA_ALLOCATE_ARRAY(&clusters->arena, uint32_t, num_clusters);
+    clusters->cluster_dirty_flags   = ARENA_ALLOCATE_ARRAY(&clusters->arena, bool32_t, num_clusters);
+
+    ASSERT(clusters->groups && clusters->group_empty_masks && clusters->dirty_cluster_indices && clusters->cluster_dirty_flags);
+
+    clusters->num_faces = scene->num_faces;
+    clusters->num_clusters = num_clusters;
+    clusters->num_groups = num_groups;
+    clusters->num_dirty_clusters = 0;
+    clusters->needs_rebuild = FALSE;
+
+    memset(clusters->cluster_dirty_flags, 0, num_clusters * sizeof(bool32_t));
+    memset(clusters->group_empty_masks, 0, num_groups * sizeof(uint32_t));
+
+    // Unused lanes of the last group are inverted like clusters without faces
+    for (uint32_t i = num_clusters; i < num_groups * SCENE_CLUSTERS_NUM_LANES; ++i)
+    {
+        Scene_Clusters_Group* group = clusters->groups + i / SCENE_CLUSTERS_NUM_LANES;
+        uint32_t lane = i % SCENE_CLUSTERS_NUM_LANES;
+
+        group->min_x[lane] = group->min_y[lane] = group->min_z[lane] =  FLT_MAX;
+        group->max_x[lane] = group->max_y[lane] = group->max_z[lane] = -FLT_MAX;
+
+        clusters->group_empty_masks[i / SCENE_CLUSTERS_NUM_LANES] |= 1u << lane;
+    }
+
+    Jobs_ParallelFor(num_clusters, SCENE_CLUSTER_BUILD_NUM_CLUSTERS_PER_TASK, Scene_Clusters_Build_Task, scene);
+}
+
+void Scene_Clusters_MarkFaceDirty(Scene* scene, uint32_t face_index)
+{
+    Scene_Clusters* clusters = &scene->clusters;
+
+    // Faces that are not mirrored yet are picked up by the next rebuild
+    if (face_index >= clusters->num_faces)
+        return;
+
+    uint32_t cluster_index = face_index / SCENE_CLUSTER_NUM_FACES;
+
+    if (clusters->cluster_dirty_flags[cluster_index])
+        return;
+
+    clusters->cluster_dirty_flags[cluster_index] = TRUE;
+    clusters->dirty_cluster_indices[clusters->num_dirty_clusters++] = cluster_index;
+}
+
+void Scene_Clusters_Update(Scene* scene)
+{
+    Scene_Clusters* clusters = &scene->clusters;
+
+    if (clusters->needs_rebuild || clusters->num_faces != scene->num_faces)
+    {
+        Scene_Clusters_Build(scene);
+        return;
+    }
+
+    for (uint32_t i = 0; i < clusters->num_dirty_clusters; ++i)
+    {
+        uint32_t cluster_index = clusters->dirty_cluster_indices[i];
+
+        clusters->cluster_dirty_flags[cluster_index] = FALSE;
+        Scene_Clusters_WriteCluster(clusters, scene, cluster_index);
+    }
+
+    clusters->num_dirty_clusters = 0;
+}
+
+uint32_t Scene_Clusters_GetBestKernel(void)
+{
+    if (Cpu_IsAVXSupported()) return SCENE_CLUSTERS_KERNEL_AVX;
+    if (Cpu_IsSSE2Supported()) return SCENE_CLUSTERS_KERNEL_SSE;
+
+    return SCENE_CLUSTERS_KERNEL_SCALAR;
+}
+
+// Left, right, bottom, top, near and far plane from the rows of the matrix, none of them normalized
+static void Scene_Clusters_ExtractPlanes(const glm::mat4* view_projection, Scene_Clusters_Plane* out_planes)
+{
+    const glm::mat4& m = *view_projection;
+
+    glm::vec4 rows[4];
+
+    for (uint32_t i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        glm::vec4 plane = (i % 2 == 0) ? rows[3] + rows[i / 2] : rows[3] - rows[i / 2];
+
+        out_planes[i].normal = glm::vec3(plane);
+        out_planes[i].offset = plane.w;
+    }
+}
+
+// Bounds are outside of a plane when their corner furthest along the normal is, which takes the maximum on every axis where
+// the normal is positive and the minimum on the others
+static inline const float* Scene_Clusters_SelectCorner(const float* mins, const float* maxs, float normal)
+{
+    return (normal > 0.0f) ? maxs : mins;
+}
+
+static uint32_t Scene_Clusters_WriteVisibleLanes(uint32_t group_index, uint32_t mask, uint32_t* out_cluster_indices)
+{
+    uint32_t num_written = 0;
+
+    for (uint32_t lane = 0; lane < SCENE_CLUSTERS_NUM_LANES; ++lane)
+    {
+        if (mask & (1u << lane))
+            out_cluster_indices[num_written++] = group_index * SCENE_CLUSTERS_NUM_LANES + lane;
+    }
+
+    return num_written;
+}
+
+static uint32_t Scene_Clusters_CullFrustum_Scalar(const Scene_Clusters* clusters, const Scene_Clusters_Plane* planes, uint32_t* out_cluster_indices)
+{
+    uint32_t num_visible_clusters = 0;
+
+    for (uint32_t group_index = 0; group_index < clusters->num_groups; ++group_index)
+    {
+        const Scene_Clusters_Group* group = clusters->groups + group_index;
+
+        uint32_t mask = ((1u << SCENE_CLUSTERS_NUM_LANES) - 1) & ~clusters->group_empty_masks[group_index];
+
+        for (uint32_t i = 0; i < 6 && mask != 0; ++i)
+        {
+            const Scene_Clusters_Plane* plane = planes + i;
+
+            const float* x = Scene_Clusters_SelectCorner(group->min_x, group->max_x, plane->normal.x);
+            const float* y = Scene_Clusters_SelectCorner(group->min_y, group->max_y, plane->normal.y);
+            const float* z = Scene_Clusters_SelectCorner(group->min_z, group->max_z, plane->normal.z);
+
+            for (uint32_t lane = 0; lane < SCENE_CLUSTERS_NUM_LANES; ++lane)
+            {
+                float distance = plane->normal.x * x[lane] + plane->normal.y * y[lane] + plane->normal.z * z[lane] + plane->offset;
+
+                // NOTE: Same comparison as the SIMD kernels, so that a NaN distance culls the cluster in all of them
+                if (!(distance >= 0.0f))
+                    mask &= ~(1u << lane);
+            }
+        }
+
+        num_visible_clusters += Scene_Clusters_WriteVisibleLanes(group_index, mask, out_cluster_indices + num_visible_clusters);
+    }
+
+    return num_visible_clusters;
+}
+
+#if FPS_ARCH_X86
+static uint32_t Scene_Clusters_CullFrustum_SSE(const Scene_Clusters* clusters, const Scene_Clusters_Plane* planes, uint32_t* out_cluster_indices)
+{
+    const __m128 zero = _mm_setzero_ps();
+
+    __m128 normal_x[6], normal_y[6], normal_z[6], offset[6];
+
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        normal_x[i] = _mm_set1_ps(planes[i].normal.x);
+        normal_y[i] = _mm_set1_ps(planes[i].normal.y);
+        normal_z[i] = _mm_set1_ps(planes[i].normal.z);
+        offset[i]   = _mm_set1_ps(planes[i].offset);
+    }
+
+    uint32_t num_visible_clusters = 0;
+
+    for (uint32_t group_index = 0; group_index < clusters->num_groups; ++group_index)
+    {
+        const Scene_Clusters_Group* group = clusters->groups + group_index;
+
+        uint32_t mask = 0;
+
+        for (uint32_t half = 0; half < SCENE_CLUSTERS_NUM_LANES; half += 4)
+        {
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+            for (uint32_t i = 0; i < 6; ++i)
+            {
+                const Scene_Clusters_Plane* plane = planes + i;
+
+                __m128 x = _mm_load_ps(Scene_Clusters_SelectCorner(group->min_x, group->max_x, plane->normal.x) + half);
+                __m128 y = _mm_load_ps(Scene_Clusters_SelectCorner(group->min_y, group->max_y, plane->normal.y) + half);
+                __m128 z = _mm_load_ps(Scene_Clusters_SelectCorner(group->min_z, group->max_z, plane->normal.z) + half);
+
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(normal_x[i], x), _mm_mul_ps(normal_y[i], y)),
+                    _mm_add_ps(_mm_mul_ps(normal_z[i], z), offset[i])
+                );
+
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+            }
+
+            mask |= (uint32_t)_mm_movemask_ps(inside) << half;
+        }
+
+        mask &= ~clusters->group_empty_masks[group_index];
+
+        num_visible_clusters += Scene_Clusters_WriteVisibleLanes(group_index, mask, out_cluster_indices + num_visible_clusters);
+    }
+
+    return num_visible_clusters;
+}
+
+FPS_TARGET_AVX static uint32_t Scene_Clusters_CullFrustum_AVX(const Scene_Clusters* clusters, const Scene_Clusters_Plane* planes, uint32_t* out_cluster_indices)
+{
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 normal_x[6], normal_y[6], normal_z[6], offset[6];
+
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        normal_x[i] = _mm256_set1_ps(planes[i].normal.x);
+        normal_y[i] = _mm256_set1_ps(planes[i].normal.y);
+        normal_z[i] = _mm256_set1_ps(planes[i].normal.z);
+        offset[i]   = _mm256_set1_ps(planes[i].offset);
+    }
+
+    uint32_t num_visible_clusters = 0;
+
+    for (uint32_t group_index = 0; group_index < clusters->num_groups; ++group_index)
+    {
+        const Scene_Clusters_Group* group = clusters->groups + group_index;
+
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            const Scene_Clusters_Plane* plane = planes + i;
+
+            __m256 x = _mm256_load_ps(Scene_Clusters_SelectCorner(group->min_x, group->max_x, plane->normal.x));
+            __m256 y = _mm256_load_ps(Scene_Clusters_SelectCorner(group->min_y, group->max_y, plane->normal.y));
+            __m256 z = _mm256_load_ps(Scene_Clusters_SelectCorner(group->min_z, group->max_z, plane->normal.z));
+
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(normal_x[i], x), _mm256_mul_ps(normal_y[i], y)),
+                _mm256_add_ps(_mm256_mul_ps(normal_z[i], z), offset[i])
+            );
+
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(inside) & ~clusters->group_empty_masks[group_index];
+
+        num_visible_clusters += Scene_Clusters_WriteVisibleLanes(group_index, mask, out_cluster_indices + num_visible_clusters);
+    }
+
+    return num_visible_clusters;
+}
+#endif
+
+uint32_t Scene_Clusters_CullFrustum(const Scene* scene, uint32_t kernel, const glm::mat4* view_projection, uint32_t* out_cluster_indices)
+{
+    const Scene_Clusters* clusters = &scene->clusters;
+    ASSERT(clusters->num_faces == scene->num_faces && !clusters->needs_rebuild);
+
+    Scene_Clusters_Plane planes[6];
+    Scene_Clusters_ExtractPlanes(view_projection, planes);
+
+    switch (kernel)
+    {
+#if FPS_ARCH_X86
+        case SCENE_CLUSTERS_KERNEL_AVX:
+            return Scene_Clusters_CullFrustum_AVX(clusters, planes, out_cluster_indices);
+
+        case SCENE_CLUSTERS_KERNEL_SSE:
+            return Scene_Clusters_CullFrustum_SSE(clusters, planes, out_cluster_indices);
+#endif
+
+        default:
+            return Scene_Clusters_CullFrustum_Scalar(clusters, planes, out_cluster_indices);
+    }
+}
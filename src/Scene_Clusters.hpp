@@ -0,0 +1,86 @@
+#ifndef SCENE_CLUSTERS_HPP_
+#define SCENE_CLUSTERS_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+// Faces are culled in clusters of this many consecutive faces, which Scene_Reorder keeps close together in space
+#define SCENE_CLUSTER_NUM_FACES 64
+#define SCENE_MAX_NUM_CLUSTERS ((SCENE_MAX_NUM_FACES + SCENE_CLUSTER_NUM_FACES - 1) / SCENE_CLUSTER_NUM_FACES)
+#define SCENE_CLUSTER_BUILD_NUM_CLUSTERS_PER_TASK 256
+
+#define SCENE_CLUSTERS_NUM_LANES 8
+
+#define SCENE_CLUSTERS_KERNEL_SCALAR 0
+#define SCENE_CLUSTERS_KERNEL_SSE 1
+#define SCENE_CLUSTERS_KERNEL_AVX 2
+
+struct Scene;
+
+// Bounds of SCENE_CLUSTERS_NUM_LANES consecutive clusters, one cluster per lane
+struct alignas(32) Scene_Clusters_Group
+{
+    float min_x[SCENE_CLUSTERS_NUM_LANES];
+    float min_y[SCENE_CLUSTERS_NUM_LANES];
+    float min_z[SCENE_CLUSTERS_NUM_LANES];
+    float max_x[SCENE_CLUSTERS_NUM_LANES];
+    float max_y[SCENE_CLUSTERS_NUM_LANES];
+    float max_z[SCENE_CLUSTERS_NUM_LANES];
+};
+
+// Structure-of-arrays bounds of every run of SCENE_CLUSTER_NUM_FACES consecutive faces, laid out for culling many clusters
+// at once. The triangles of a cluster are one range of the geometry indices (see Scene_Cluster_GetGeometryIndices).
+// Clusters without faces, deleted ones included, and unused lanes have inverted bounds.
+struct Scene_Clusters
+{
+    // Holds the groups, their empty masks and the dirty tracking, sized for the clusters at build time
+    Arena arena;
+
+    Scene_Clusters_Group* groups;
+    uint32_t              num_groups;
+    uint32_t              num_clusters;
+
+    // One bit per lane, set for the clusters with inverted bounds. Every kernel drops them before it tests any plane, so
+    // that the result does not depend on what the plane math makes of the inverted bounds.
+    uint32_t* group_empty_masks;
+
+    uint32_t num_faces;
+
+    uint32_t* dirty_cluster_indices;
+    bool32_t* cluster_dirty_flags;
+    uint32_t  num_dirty_clusters;
+
+    // Set when faces were truncated or renumbered, a cluster is a fixed range of face indices and its bounds would be stale
+    bool32_t needs_rebuild;
+};
+
+bool32_t Scene_Clusters_Init(Scene_Clusters* clusters);
+
+void Scene_Clusters_Destroy(Scene_Clusters* clusters);
+
+void Scene_Clusters_Build(Scene* scene);
+
+void Scene_Clusters_MarkFaceDirty(Scene* scene, uint32_t face_index);
+
+// Refits the bounds of clusters with dirty faces and rebuilds the whole mirror when faces were added
+void Scene_Clusters_Update(Scene* scene);
+
+// Returns the fastest kernel supported by the CPU
+uint32_t Scene_Clusters_GetBestKernel(void);
+
+// Writes the clusters whose bounds are not completely outside of one of the planes of the view frustum in ascending order,
+// out_cluster_indices needs room for every cluster. Returns how many clusters were written.
+// NOTE: The mirror must be up to date (see Scene_Clusters_Update)
+uint32_t Scene_Clusters_CullFrustum(const Scene* scene, uint32_t kernel, const glm::mat4* view_projection, uint32_t* out_cluster_indices);
+
+// Defined in Scene.hpp, they read the scene
+inline uint32_t Scene_GetNumClusters(const Scene* scene);
+
+inline void Scene_Cluster_GetBounds(const Scene* scene, uint32_t cluster_index, glm::vec3* out_bounds_min, glm::vec3* out_bounds_max);
+
+// Range of the triangles of the faces of the cluster in the geometry indices
+inline void Scene_Cluster_GetGeometryIndices(const Scene* scene, uint32_t cluster_index, uint32_t* out_first_index, uint32_t* out_num_indices);
+
+#endif // !SCENE_CLUSTERS_HPP_
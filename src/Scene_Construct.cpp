@@ -0,0 +1,459 @@
+#include "Scene.hpp"
+#include "Jobs.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK ((uint32_t)1 << 16)
+
+// Buckets up to this size are sorted with insertion sort
+#define SCENE_CONSTRUCT_MAX_INSERTION_SORT_SIZE 32
+
+// Up to this many outgoing half-edges per vertex the twins are found by walking the outgoing lists like
+// Scene_ConstructFace does, past it the walks get quadratic and the half-edges are matched in buckets instead
+#define SCENE_CONSTRUCT_MAX_LINKED_VALENCE 32
+
+struct Scene_Construct_Batch
+{
+    Scene* scene;
+
+    const uint32_t*  face_vertex_indices;
+    const uint32_t*  face_num_vertices;
+    const glm::vec4* face_colors;
+    const uint32_t*  face_first_vertex_indices; // Where every face starts in face_vertex_indices
+
+    uint32_t base_face;
+    uint32_t base_half_edge;
+
+    // Existing half-edges whose vertices are both used by the new faces have to take part in the matching too
+    const uint8_t* vertex_marks;
+    uint32_t*      block_counts;
+
+    // Half-edges that take part in the matching, the existing ones first, both in half-edge order.
+    // Only the existing ones are stored, the new ones follow them implicitly.
+    uint32_t* existing_candidates;
+    uint32_t  num_existing_candidates;
+    uint32_t  num_candidates;
+
+    // Candidates bucketed by their smaller vertex, every entry holds the larger vertex in the high bits and the
+    // half-edge in the low bits, so sorting a bucket groups the twin candidates and keeps them in half-edge order
+    uint32_t* candidate_min_vertices;
+    uint64_t* candidate_entries;
+    uint32_t* bucket_offsets;
+    uint64_t* bucket_entries;
+};
+
+static void Scene_Construct_WriteFacesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Scene_Construct_Batch* batch = (const Scene_Construct_Batch*)user_data;
+    Scene* scene = batch->scene;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const uint32_t* vertex_indices = batch->face_vertex_indices + batch->face_first_vertex_indices[i];
+        uint32_t num_vertices = batch->face_num_vertices[i];
+
+        uint32_t face_index = batch->base_face + i;
+        uint32_t half_edge_index_base = batch->base_half_edge + batch->face_first_vertex_indices[i];
+
+        Scene_Face* face = scene->faces + face_index;
+        face->color           = batch->face_colors[i];
+        face->first_half_edge = half_edge_index_base;
+        face->num_half_edges  = num_vertices;
+
+        for (uint32_t j = 0; j < num_vertices; ++j)
+        {
+            ASSERT(vertex_indices[j] < scene->num_vertices);
+
+            Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index_base + j;
+
+            current_half_edge->origin_vertex           = vertex_indices[j];
+            current_half_edge->opposite_half_edge      = SCENE_ID_NONE;
+            current_half_edge->next_half_edge          = half_edge_index_base + ((j + 1 < num_vertices) ? j + 1 : 0);
+            current_half_edge->prev_half_edge          = half_edge_index_base + ((j > 0) ? j - 1 : num_vertices - 1);
+            current_half_edge->face                    = face_index;
+            current_half_edge->next_outgoing_half_edge = SCENE_ID_NONE;
+        }
+
+        Scene_Face_RecomputePlane(scene, face_index);
+    }
+}
+
+// Replays the linking of Scene_ConstructFace for the new half-edges in order
+static void Scene_Construct_LinkHalfEdges(const Scene_Construct_Batch* batch, uint32_t num_faces)
+{
+    Scene* scene = batch->scene;
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        const uint32_t* vertex_indices = batch->face_vertex_indices + batch->face_first_vertex_indices[i];
+        uint32_t num_vertices = batch->face_num_vertices[i];
+
+        uint32_t half_edge_index_base = batch->base_half_edge + batch->face_first_vertex_indices[i];
+
+        for (uint32_t j = 0; j < num_vertices; ++j)
+        {
+            uint32_t v0 = vertex_indices[j];
+            uint32_t v1 = vertex_indices[(j + 1 < num_vertices) ? j + 1 : 0];
+
+            uint32_t current_half_edge_index = half_edge_index_base + j;
+            Scene_HalfEdge* current_half_edge = scene->half_edges + current_half_edge_index;
+
+            for (uint32_t outgoing_half_edge_index = scene->vertices[v1].first_outgoing_half_edge;
+                 outgoing_half_edge_index != SCENE_ID_NONE;
+                 outgoing_half_edge_index = scene->half_edges[outgoing_half_edge_index].next_outgoing_half_edge)
+            {
+                if (Scene_HalfEdge_GetEndVertex(scene, outgoing_half_edge_index) == v0)
+                {
+                    current_half_edge->opposite_half_edge = outgoing_half_edge_index;
+
+                    Scene_PrepareHalfEdgeWrite(scene, outgoing_half_edge_index, 1);
+                    scene->half_edges[outgoing_half_edge_index].opposite_half_edge = current_half_edge_index;
+
+                    break;
+                }
+            }
+
+            current_half_edge->next_outgoing_half_edge = scene->vertices[v0].first_outgoing_half_edge;
+
+            Scene_PrepareVertexWrite(scene, v0, 1);
+            scene->vertices[v0].first_outgoing_half_edge = current_half_edge_index;
+        }
+    }
+}
+
+static bool32_t Scene_Construct_IsExistingCandidate(const Scene_Construct_Batch* batch, uint32_t half_edge_index)
+{
+    const Scene* scene = batch->scene;
+
+    // Half-edges of deleted faces have no vertices anymore
+    if (scene->half_edges[half_edge_index].face == SCENE_ID_DELETED)
+        return FALSE;
+
+    return batch->vertex_marks[scene->half_edges[half_edge_index].origin_vertex] &&
+           batch->vertex_marks[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)];
+}
+
+static void Scene_Construct_CountExistingCandidatesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Construct_Batch* batch = (Scene_Construct_Batch*)user_data;
+
+    // NOTE: Tasks run inline cover several blocks at once, so the blocks are always walked one by one
+    for (uint32_t block_begin = begin; block_begin < end; block_begin += SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK)
+    {
+        uint32_t block_end = block_begin + SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK;
+        if (block_end > end) block_end = end;
+
+        uint32_t num_candidates = 0;
+
+        for (uint32_t i = block_begin; i < block_end; ++i)
+            num_candidates += Scene_Construct_IsExistingCandidate(batch, i);
+
+        batch->block_counts[block_begin / SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK] = num_candidates;
+    }
+}
+
+static void Scene_Construct_WriteExistingCandidatesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Construct_Batch* batch = (Scene_Construct_Batch*)user_data;
+
+    for (uint32_t block_begin = begin; block_begin < end; block_begin += SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK)
+    {
+        uint32_t block_end = block_begin + SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK;
+        if (block_end > end) block_end = end;
+
+        uint32_t candidate_index = batch->block_counts[block_begin / SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK];
+
+        for (uint32_t i = block_begin; i < block_end; ++i)
+        {
+            if (Scene_Construct_IsExistingCandidate(batch, i))
+                batch->existing_candidates[candidate_index++] = i;
+        }
+    }
+}
+
+static void Scene_Construct_WriteEntriesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Construct_Batch* batch = (Scene_Construct_Batch*)user_data;
+    const Scene* scene = batch->scene;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t half_edge_index = (i < batch->num_existing_candidates)
+            ? batch->existing_candidates[i]
+            : batch->base_half_edge + (i - batch->num_existing_candidates);
+
+        uint32_t v0 = scene->half_edges[half_edge_index].origin_vertex;
+        uint32_t v1 = Scene_HalfEdge_GetEndVertex(scene, half_edge_index);
+
+        uint32_t v_min = (v0 < v1) ? v0 : v1;
+        uint32_t v_max = (v0 < v1) ? v1 : v0;
+
+        batch->candidate_min_vertices[i] = v_min;
+        batch->candidate_entries[i] = ((uint64_t)v_max << 32) | half_edge_index;
+    }
+}
+
+static int Scene_Construct_CompareEntries(const void* a, const void* b)
+{
+    uint64_t entry_a = *(const uint64_t*)a;
+    uint64_t entry_b = *(const uint64_t*)b;
+
+    return (entry_a > entry_b) - (entry_a < entry_b);
+}
+
+static void Scene_Construct_MatchTwinsTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Construct_Batch* batch = (Scene_Construct_Batch*)user_data;
+    Scene* scene = batch->scene;
+
+    for (uint32_t vertex_index = begin; vertex_index < end; ++vertex_index)
+    {
+        uint64_t* entries = batch->bucket_entries + batch->bucket_offsets[vertex_index];
+        uint32_t num_entries = batch->bucket_offsets[vertex_index + 1] - batch->bucket_offsets[vertex_index];
+
+        if (num_entries <= SCENE_CONSTRUCT_MAX_INSERTION_SORT_SIZE)
+        {
+            for (uint32_t i = 1; i < num_entries; ++i)
+            {
+                uint64_t entry = entries[i];
+
+                uint32_t j = i;
+                for (; j > 0 && entries[j - 1] > entry; --j)
+                    entries[j] = entries[j - 1];
+
+                entries[j] = entry;
+            }
+        }
+        else
+        {
+            qsort(entries, num_entries, sizeof(uint64_t), Scene_Construct_CompareEntries);
+        }
+
+        uint32_t group_begin = 0;
+
+        while (group_begin < num_entries)
+        {
+            uint32_t group_end = group_begin + 1;
+
+            while (group_end < num_entries && (entries[group_end] >> 32) == (entries[group_begin] >> 32))
+                ++group_end;
+
+            // Replays Scene_ConstructFace for the half-edges of one undirected edge, a new half-edge takes the newest
+            // earlier one running the other way
+            uint32_t newest_half_edges[2] = { SCENE_ID_NONE, SCENE_ID_NONE };
+
+            for (uint32_t i = group_begin; i < group_end; ++i)
+                scene->half_edges[(uint32_t)entries[i]].opposite_half_edge = SCENE_ID_NONE;
+
+            for (uint32_t i = group_begin; i < group_end; ++i)
+            {
+                uint32_t half_edge_index = (uint32_t)entries[i];
+
+                uint32_t max_vertex = (uint32_t)(entries[i] >> 32);
+
+                // Half-edges that start and end at the same vertex are their own opposite direction
+                uint32_t direction = (scene->half_edges[half_edge_index].origin_vertex == vertex_index) ? 0 : 1;
+                uint32_t opposite_direction = (max_vertex == vertex_index) ? direction : 1 - direction;
+
+                uint32_t opposite_half_edge_index = newest_half_edges[opposite_direction];
+
+                if (opposite_half_edge_index != SCENE_ID_NONE)
+                {
+                    scene->half_edges[half_edge_index].opposite_half_edge = opposite_half_edge_index;
+                    scene->half_edges[opposite_half_edge_index].opposite_half_edge = half_edge_index;
+                }
+
+                newest_half_edges[direction] = half_edge_index;
+            }
+
+            group_begin = group_end;
+        }
+    }
+}
+
+uint32_t Scene_ConstructFaces(
+    Scene*           scene,
+    const uint32_t*  face_vertex_indices,
+    const uint32_t*  face_num_vertices,
+    const glm::vec4* face_colors,
+    uint32_t         num_faces
+)
+{
+    if (num_faces == 0 || num_faces > SCENE_MAX_NUM_FACES - scene->num_faces)
+        return SCENE_ID_NONE;
+
+    uint64_t scratch_offset = scene->scratch_arena.offset;
+
+    uint32_t* face_first_vertex_indices = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, num_faces);
+    if (!face_first_vertex_indices)
+        return SCENE_ID_NONE;
+
+    uint64_t num_new_half_edges = 0;
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        ASSERT(face_num_vertices[i] >= 3);
+
+        face_first_vertex_indices[i] = (uint32_t)num_new_half_edges;
+        num_new_half_edges += face_num_vertices[i];
+
+        if (num_new_half_edges > SCENE_MAX_NUM_HALF_EDGES - scene->num_half_edges)
+        {
+            Arena_Rewind(&scene->scratch_arena, scratch_offset);
+            return SCENE_ID_NONE;
+        }
+    }
+
+    Scene_HalfEdge* half_edges = ARENA_ALLOCATE_ARRAY(&scene->half_edge_arena, Scene_HalfEdge, num_new_half_edges);
+    Scene_Face* faces = half_edges ? ARENA_ALLOCATE_ARRAY(&scene->face_arena, Scene_Face, num_faces) : NULL;
+
+    if (!faces)
+    {
+        Arena_Rewind(&scene->half_edge_arena, (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge));
+        Arena_Rewind(&scene->scratch_arena, scratch_offset);
+        return SCENE_ID_NONE;
+    }
+
+    ASSERT(half_edges == scene->half_edges + scene->num_half_edges);
+    ASSERT(faces == scene->faces + scene->num_faces);
+
+    Scene_Construct_Batch batch = {};
+    batch.scene                     = scene;
+    batch.face_vertex_indices       = face_vertex_indices;
+    batch.face_num_vertices         = face_num_vertices;
+    batch.face_colors               = face_colors;
+    batch.face_first_vertex_indices = face_first_vertex_indices;
+    batch.base_face                 = scene->num_faces;
+    batch.base_half_edge            = scene->num_half_edges;
+
+    uint32_t num_existing_half_edges = scene->num_half_edges;
+
+    scene->num_half_edges += (uint32_t)num_new_half_edges;
+    scene->num_faces += num_faces;
+
+    // NOTE: Removed elements may still be part of a snapshot, so even appending has to keep the originals
+    Scene_PrepareHalfEdgeWrite(scene, batch.base_half_edge, (uint32_t)num_new_half_edges);
+    Scene_PrepareFaceWrite(scene, batch.base_face, num_faces);
+
+    Jobs_ParallelFor(num_faces, SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK / 4, Scene_Construct_WriteFacesTask, &batch);
+
+    // Counts how many outgoing half-edges every vertex ends up with, every vertex of the new faces starts one of them
+    uint32_t* valences = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, scene->num_vertices);
+    ASSERT(valences);
+
+    memset(valences, 0, (uint64_t)scene->num_vertices * sizeof(uint32_t));
+
+    uint32_t max_valence = 0;
+
+    for (uint64_t i = 0; i < num_new_half_edges; ++i)
+    {
+        uint32_t vertex_index = face_vertex_indices[i];
+
+        if (valences[vertex_index] == 0)
+        {
+            for (uint32_t half_edge_index = scene->vertices[vertex_index].first_outgoing_half_edge;
+                 half_edge_index != SCENE_ID_NONE;
+                 half_edge_index = scene->half_edges[half_edge_index].next_outgoing_half_edge)
+                ++valences[vertex_index];
+        }
+
+        if (++valences[vertex_index] > max_valence)
+            max_valence = valences[vertex_index];
+    }
+
+    if (max_valence <= SCENE_CONSTRUCT_MAX_LINKED_VALENCE)
+    {
+        Scene_Construct_LinkHalfEdges(&batch, num_faces);
+
+        Arena_Rewind(&scene->scratch_arena, scratch_offset);
+
+        return batch.base_face;
+    }
+
+    // Collect the new half-edges and the existing ones they could be twins of
+
+    uint32_t num_existing_candidates = 0;
+
+    if (num_existing_half_edges > 0)
+    {
+        uint8_t* vertex_marks = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint8_t, scene->num_vertices);
+
+        uint32_t num_blocks = (num_existing_half_edges + SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK - 1) / SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK;
+        batch.block_counts = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, num_blocks);
+
+        ASSERT(vertex_marks && batch.block_counts);
+
+        memset(vertex_marks, 0, scene->num_vertices);
+
+        for (uint64_t i = 0; i < num_new_half_edges; ++i)
+            vertex_marks[face_vertex_indices[i]] = 1;
+
+        batch.vertex_marks = vertex_marks;
+
+        Jobs_ParallelFor(num_existing_half_edges, SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK, Scene_Construct_CountExistingCandidatesTask, &batch);
+
+        for (uint32_t block = 0; block < num_blocks; ++block)
+        {
+            uint32_t count = batch.block_counts[block];
+            batch.block_counts[block] = num_existing_candidates;
+            num_existing_candidates += count;
+        }
+    }
+
+    batch.num_existing_candidates = num_existing_candidates;
+    batch.num_candidates = num_existing_candidates + (uint32_t)num_new_half_edges;
+
+    batch.existing_candidates    = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, num_existing_candidates);
+    batch.candidate_min_vertices = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, batch.num_candidates);
+    batch.candidate_entries      = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint64_t, batch.num_candidates);
+    batch.bucket_offsets         = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, (uint64_t)scene->num_vertices + 1);
+    batch.bucket_entries         = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint64_t, batch.num_candidates);
+
+    ASSERT(batch.existing_candidates && batch.candidate_min_vertices && batch.candidate_entries && batch.bucket_offsets && batch.bucket_entries);
+
+    if (num_existing_candidates > 0)
+        Jobs_ParallelFor(num_existing_half_edges, SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK, Scene_Construct_WriteExistingCandidatesTask, &batch);
+
+    Jobs_ParallelFor(batch.num_candidates, SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK, Scene_Construct_WriteEntriesTask, &batch);
+
+    // Counting sort into the buckets, which keeps every bucket in half-edge order
+
+    memset(batch.bucket_offsets, 0, ((uint64_t)scene->num_vertices + 1) * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < batch.num_candidates; ++i)
+        ++batch.bucket_offsets[batch.candidate_min_vertices[i] + 1];
+
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+        batch.bucket_offsets[i + 1] += batch.bucket_offsets[i];
+
+    for (uint32_t i = 0; i < batch.num_candidates; ++i)
+        batch.bucket_entries[batch.bucket_offsets[batch.candidate_min_vertices[i]]++] = batch.candidate_entries[i];
+
+    // Scattering moved every offset to the end of its bucket, which is the start of the next one
+    memmove(batch.bucket_offsets + 1, batch.bucket_offsets, (uint64_t)scene->num_vertices * sizeof(uint32_t));
+    batch.bucket_offsets[0] = 0;
+
+    // Matching rewrites the opposites of every existing candidate, the tasks cannot keep the originals themselves
+    if (scene->num_snapshots > 0)
+    {
+        for (uint32_t i = 0; i < num_existing_candidates; ++i)
+            Scene_PrepareHalfEdgeWrite(scene, batch.existing_candidates[i], 1);
+    }
+
+    Jobs_ParallelFor(scene->num_vertices, SCENE_CONSTRUCT_NUM_ITEMS_PER_TASK / 16, Scene_Construct_MatchTwinsTask, &batch);
+
+    // Outgoing lists are pushed in half-edge order like in Scene_ConstructFace, this pass is cheap next to the rest
+    for (uint32_t i = batch.base_half_edge; i < scene->num_half_edges; ++i)
+    {
+        Scene_Vertex* origin_vertex = scene->vertices + scene->half_edges[i].origin_vertex;
+        Scene_PrepareVertexWrite(scene, scene->half_edges[i].origin_vertex, 1);
+
+        scene->half_edges[i].next_outgoing_half_edge = origin_vertex->first_outgoing_half_edge;
+        origin_vertex->first_outgoing_half_edge = i;
+    }
+
+    Arena_Rewind(&scene->scratch_arena, scratch_offset);
+
+    return batch.base_face;
+}
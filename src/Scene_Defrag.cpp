@@ -0,0 +1,331 @@
+#include "Scene.hpp"
+
+#include <string.h>
+
+// Link that points at a half-edge in the outgoing list of its origin, either the head in the vertex or the one in the
+// half-edge before it
+struct Scene_Defrag_OutgoingLink
+{
+    uint32_t owner;
+    bool32_t is_vertex;
+};
+
+static bool32_t Scene_Defrag_IsInRange(uint32_t index, uint32_t first, uint32_t count)
+{
+    return index != SCENE_ID_NONE && index - first < count;
+}
+
+// Maps the half-edges of the moved face to their new range and leaves every other index alone
+static uint32_t Scene_Defrag_RemapHalfEdge(uint32_t index, uint32_t old_first, uint32_t new_first, uint32_t count)
+{
+    return Scene_Defrag_IsInRange(index, old_first, count) ? new_first + (index - old_first) : index;
+}
+
+static void Scene_Defrag_StartPass(Scene* scene)
+{
+    Scene_Defrag* defrag = &scene->defrag;
+
+    // Holes are taken from the free lists, which may have lost entries to stack overflows or earlier passes
+    Scene_RebuildFreeLists(scene);
+
+    defrag->is_running = TRUE;
+    defrag->vertex_end = scene->num_vertices;
+
+    uint32_t first_deleted_face = 0;
+    while (first_deleted_face < scene->num_faces && !Scene_Face_IsDeleted(scene, first_deleted_face))
+        ++first_deleted_face;
+
+    defrag->next_face   = first_deleted_face;
+    defrag->source_face = first_deleted_face;
+
+    defrag->next_half_edge   = (first_deleted_face < scene->num_faces) ? scene->faces[first_deleted_face].first_half_edge : scene->num_half_edges;
+    defrag->source_half_edge = defrag->next_half_edge;
+}
+
+static void Scene_Defrag_RecordMove(Scene* scene, uint32_t source, uint32_t target, bool32_t is_face)
+{
+    Scene_Defrag* defrag = &scene->defrag;
+
+    Scene_DefragMove* move = ARENA_ALLOCATE_ARRAY(&defrag->move_arena, Scene_DefragMove, 1);
+    ASSERT(move == defrag->moves + defrag->num_moves);
+
+    move->source  = source;
+    move->target  = target;
+    move->is_face = is_face;
+
+    ++defrag->num_moves;
+}
+
+// Moves the last live vertex into the hole, which comes before it
+static void Scene_Defrag_MoveVertex(Scene* scene, uint32_t source_vertex_index, uint32_t vertex_index)
+{
+    Scene_PrepareVertexWrite(scene, vertex_index, 1);
+    Scene_PrepareVertexWrite(scene, source_vertex_index, 1);
+
+    scene->vertices[vertex_index] = scene->vertices[source_vertex_index];
+    scene->vertices[source_vertex_index].first_outgoing_half_edge = SCENE_ID_DELETED;
+
+    // Corners refer to their vertex in the geometry, so every face around it is written again
+    for (uint32_t half_edge_index = scene->vertices[vertex_index].first_outgoing_half_edge;
+         half_edge_index != SCENE_ID_NONE;
+         half_edge_index = scene->half_edges[half_edge_index].next_outgoing_half_edge)
+    {
+        Scene_PrepareHalfEdgeWrite(scene, half_edge_index, 1);
+        scene->half_edges[half_edge_index].origin_vertex = vertex_index;
+
+        Scene_Geometry_MarkFaceDirty(scene, scene->half_edges[half_edge_index].face);
+    }
+
+    Scene_PickGrid_RemoveVertex(scene, source_vertex_index);
+    Scene_PickGrid_MarkVertexDirty(scene, vertex_index);
+
+    Scene_Defrag_RecordMove(scene, source_vertex_index, vertex_index, FALSE);
+}
+
+static void Scene_Defrag_KillHalfEdges(Scene* scene, uint32_t first_half_edge, uint32_t end_half_edge)
+{
+    for (uint32_t i = first_half_edge; i < end_half_edge; ++i)
+    {
+        Scene_HalfEdge* half_edge = scene->half_edges + i;
+
+        half_edge->origin_vertex           = SCENE_ID_NONE;
+        half_edge->opposite_half_edge      = SCENE_ID_NONE;
+        half_edge->next_half_edge          = SCENE_ID_NONE;
+        half_edge->prev_half_edge          = SCENE_ID_NONE;
+        half_edge->face                    = SCENE_ID_DELETED;
+        half_edge->next_outgoing_half_edge = SCENE_ID_NONE;
+    }
+}
+
+// Moves the face at the source cursor to the front of the gap of deleted faces. The deleted faces behind it are stretched
+// over the half-edges it leaves behind, which keeps every range packed and at least a triangle large.
+static void Scene_Defrag_MoveFace(Scene* scene)
+{
+    Scene_Defrag* defrag = &scene->defrag;
+
+    uint32_t face_index        = defrag->next_face;
+    uint32_t first_half_edge   = defrag->next_half_edge;
+    uint32_t source_face_index = defrag->source_face;
+    uint32_t source_half_edge  = defrag->source_half_edge;
+
+    uint32_t num_half_edges = scene->faces[source_face_index].num_half_edges;
+
+    ASSERT(scene->faces[source_face_index].first_half_edge == source_half_edge);
+
+    // Gap faces and the freed half-edges are rewritten below, the moved ones land in front of them
+    uint32_t end_half_edge = source_half_edge + num_half_edges;
+
+    Scene_PrepareHalfEdgeWrite(scene, first_half_edge, end_half_edge - first_half_edge);
+    Scene_PrepareFaceWrite(scene, face_index, source_face_index + 1 - face_index);
+
+    Scene_PickGrid_RemoveHalfEdges(scene, source_half_edge, num_half_edges);
+
+    uint64_t scratch_offset = scene->scratch_arena.offset;
+
+    Scene_Defrag_OutgoingLink* links = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, Scene_Defrag_OutgoingLink, num_half_edges);
+    Scene_HalfEdge* old_half_edges = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, Scene_HalfEdge, num_half_edges);
+
+    ASSERT(links && old_half_edges);
+
+    memcpy(old_half_edges, scene->half_edges + source_half_edge, (uint64_t)num_half_edges * sizeof(Scene_HalfEdge));
+
+    // The links are all found before any of them changes, faces that touch themselves share outgoing lists
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        uint32_t half_edge_index = source_half_edge + i;
+        uint32_t origin_vertex = old_half_edges[i].origin_vertex;
+
+        links[i].owner = origin_vertex;
+        links[i].is_vertex = TRUE;
+
+        for (uint32_t link = scene->vertices[origin_vertex].first_outgoing_half_edge; link != half_edge_index; link = scene->half_edges[link].next_outgoing_half_edge)
+        {
+            ASSERT(link != SCENE_ID_NONE);
+
+            links[i].owner = link;
+            links[i].is_vertex = FALSE;
+        }
+    }
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        uint32_t new_half_edge_index = first_half_edge + i;
+
+        // Links held by the face itself are remapped with its half-edges
+        if (links[i].is_vertex)
+        {
+            Scene_PrepareVertexWrite(scene, links[i].owner, 1);
+            scene->vertices[links[i].owner].first_outgoing_half_edge = new_half_edge_index;
+        }
+        else if (!Scene_Defrag_IsInRange(links[i].owner, source_half_edge, num_half_edges))
+        {
+            Scene_PrepareHalfEdgeWrite(scene, links[i].owner, 1);
+            scene->half_edges[links[i].owner].next_outgoing_half_edge = new_half_edge_index;
+        }
+
+        uint32_t opposite_half_edge_index = old_half_edges[i].opposite_half_edge;
+
+        if (opposite_half_edge_index != SCENE_ID_NONE && !Scene_Defrag_IsInRange(opposite_half_edge_index, source_half_edge, num_half_edges))
+        {
+            Scene_PrepareHalfEdgeWrite(scene, opposite_half_edge_index, 1);
+            scene->half_edges[opposite_half_edge_index].opposite_half_edge = new_half_edge_index;
+        }
+    }
+
+    // The old range may overlap the new one, everything is written from the copy
+    Scene_Defrag_KillHalfEdges(scene, (first_half_edge + num_half_edges > source_half_edge) ? first_half_edge + num_half_edges : source_half_edge, end_half_edge);
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        const Scene_HalfEdge* old_half_edge = old_half_edges + i;
+        Scene_HalfEdge* half_edge = scene->half_edges + first_half_edge + i;
+
+        half_edge->origin_vertex           = old_half_edge->origin_vertex;
+        half_edge->opposite_half_edge      = Scene_Defrag_RemapHalfEdge(old_half_edge->opposite_half_edge, source_half_edge, first_half_edge, num_half_edges);
+        half_edge->next_half_edge          = Scene_Defrag_RemapHalfEdge(old_half_edge->next_half_edge, source_half_edge, first_half_edge, num_half_edges);
+        half_edge->prev_half_edge          = Scene_Defrag_RemapHalfEdge(old_half_edge->prev_half_edge, source_half_edge, first_half_edge, num_half_edges);
+        half_edge->face                    = face_index;
+        half_edge->next_outgoing_half_edge = Scene_Defrag_RemapHalfEdge(old_half_edge->next_outgoing_half_edge, source_half_edge, first_half_edge, num_half_edges);
+    }
+
+    Arena_Rewind(&scene->scratch_arena, scratch_offset);
+
+    scene->faces[face_index] = scene->faces[source_face_index];
+    scene->faces[face_index].first_half_edge = first_half_edge;
+
+    // Gap faces start right after the face before them and keep their end when they can, so the rewrite usually stops
+    // after a few of them
+    uint32_t gap_half_edge = first_half_edge + num_half_edges;
+
+    for (uint32_t gap_face_index = face_index + 1; gap_face_index <= source_face_index; ++gap_face_index)
+    {
+        Scene_Face* gap_face = scene->faces + gap_face_index;
+
+        uint32_t old_end = gap_face->first_half_edge + gap_face->num_half_edges;
+        uint32_t new_end = (gap_face_index == source_face_index) ? end_half_edge : ((old_end > gap_half_edge + 3) ? old_end : gap_half_edge + 3);
+
+        if (gap_face_index < source_face_index && gap_face->first_half_edge == gap_half_edge && new_end == old_end)
+        {
+            // The rest of the gap is unchanged, only the freed face is left
+            gap_face_index = source_face_index - 1;
+            gap_half_edge = source_half_edge;
+            continue;
+        }
+
+        ASSERT(new_end >= gap_half_edge + 3);
+
+        gap_face->normal          = glm::vec3(0.0f);
+        gap_face->offset          = 0.0f;
+        gap_face->first_half_edge = gap_half_edge;
+        gap_face->num_half_edges  = new_end - gap_half_edge;
+
+        Scene_Geometry_MarkFaceDirty(scene, gap_face_index);
+        Scene_MarkFaceChanged(scene, gap_face_index);
+
+        gap_half_edge = new_end;
+    }
+
+    // Everything indexed by face follows the swap, the planes and bounds moved along with the faces
+    Scene_BVH_SwapFaces(scene, face_index, source_face_index);
+
+    Scene_FacePlanes_MarkFaceDirty(scene, face_index);
+    Scene_FacePlanes_MarkFaceDirty(scene, source_face_index);
+
+    Scene_Geometry_MarkFaceDirty(scene, face_index);
+    Scene_MarkFaceChanged(scene, face_index);
+
+    Scene_Clusters_MarkFaceDirty(scene, face_index);
+    Scene_Clusters_MarkFaceDirty(scene, source_face_index);
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+        Scene_PickGrid_MarkVertexDirty(scene, scene->half_edges[first_half_edge + i].origin_vertex);
+
+    Scene_Defrag_RecordMove(scene, source_face_index, face_index, TRUE);
+
+    defrag->next_face        = face_index + 1;
+    defrag->next_half_edge   = first_half_edge + num_half_edges;
+    defrag->source_face      = source_face_index + 1;
+    defrag->source_half_edge = end_half_edge;
+}
+
+bool32_t Scene_Defragment(Scene* scene, uint32_t max_num_moves)
+{
+    Scene_Defrag* defrag = &scene->defrag;
+
+    Arena_Reset(&defrag->move_arena);
+    defrag->num_moves = 0;
+
+    if (!defrag->is_running)
+    {
+        if (scene->num_deleted_vertices == 0 && scene->num_deleted_faces == 0)
+            return TRUE;
+
+        Scene_Defrag_StartPass(scene);
+    }
+
+    // Faces take their planes along, so none of them may be waiting for a recompute under its old index
+    Scene_UpdateFacePlanes(scene);
+
+    uint32_t num_moves = 0;
+
+    // Vertices, the last live one fills the first hole
+    if (defrag->vertex_end > scene->num_vertices)
+        defrag->vertex_end = scene->num_vertices;
+
+    while (num_moves < max_num_moves)
+    {
+        while (defrag->vertex_end > 0 && Scene_Vertex_IsDeleted(scene, defrag->vertex_end - 1))
+            --defrag->vertex_end;
+
+        uint32_t vertex_index = Scene_PopFreeVertex(scene);
+        if (vertex_index == SCENE_ID_NONE)
+            break;
+
+        // Holes past the end are dropped with it
+        if (vertex_index >= defrag->vertex_end)
+            continue;
+
+        Scene_Defrag_MoveVertex(scene, --defrag->vertex_end, vertex_index);
+        ++num_moves;
+    }
+
+    // Faces, the gap of deleted faces travels towards the end
+    while (num_moves < max_num_moves && defrag->source_face < scene->num_faces)
+    {
+        if (Scene_Face_IsDeleted(scene, defrag->source_face))
+        {
+            defrag->source_half_edge += scene->faces[defrag->source_face].num_half_edges;
+            ++defrag->source_face;
+        }
+        else if (defrag->next_face == defrag->source_face)
+        {
+            defrag->source_half_edge += scene->faces[defrag->source_face].num_half_edges;
+            defrag->next_half_edge = defrag->source_half_edge;
+            defrag->next_face = ++defrag->source_face;
+        }
+        else
+        {
+            Scene_Defrag_MoveFace(scene);
+            ++num_moves;
+        }
+    }
+
+    if (num_moves >= max_num_moves)
+        return FALSE;
+
+    // NOTE: Vertices appended during the pass can come after the freed ones, those are left for the next pass then
+    bool32_t is_vertex_tail_deleted = TRUE;
+
+    for (uint32_t i = defrag->vertex_end; i < scene->num_vertices && is_vertex_tail_deleted; ++i)
+        is_vertex_tail_deleted = Scene_Vertex_IsDeleted(scene, i);
+
+    if (is_vertex_tail_deleted && defrag->vertex_end < scene->num_vertices)
+        Scene_TruncateVertices(scene, defrag->vertex_end);
+
+    if (defrag->next_face < scene->num_faces)
+        Scene_TruncateFaces(scene, defrag->next_face);
+
+    defrag->is_running = FALSE;
+
+    return TRUE;
+}
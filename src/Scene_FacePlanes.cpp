@@ -0,0 +1,628 @@
+#include "Scene.hpp"
+#include "Cpu.hpp"
+
+#include <string.h>
+
+#if FPS_ARCH_X86
+#   include <immintrin.h>
+#endif
+
+// Same threshold as Scene_Face_IntersectRay for rays that are parallel to the face
+#define SCENE_FACE_PLANES_PARALLEL_EPSILON 10e-5f
+
+// A group, the concave flag and mask and the dirty tracking per face, and at worst one edge slot per half-edge when a group holds a single face
+#define SCENE_FACE_PLANES_ARENA_CAPACITY ( \
+    (uint64_t)SCENE_MAX_NUM_FACES * (sizeof(Scene_FacePlanes_Group) + 3 * sizeof(uint32_t) + sizeof(uint32_t) + 2 * sizeof(bool32_t)) + \
+    (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(Scene_FacePlanes_EdgeSlot) + \
+    ARENA_COMMIT_GRANULARITY \
+)
+
+struct Scene_FacePlanes_Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float     min_length;
+};
+
+static void Scene_FacePlanes_WriteFace(Scene_FacePlanes* face_planes, const Scene* scene, uint32_t face_index)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    uint32_t group_index = face_index / SCENE_FACE_PLANES_NUM_LANES;
+    uint32_t lane = face_index % SCENE_FACE_PLANES_NUM_LANES;
+
+    Scene_FacePlanes_Group* group = face_planes->groups + group_index;
+    group->normal_x[lane] = face->normal.x;
+    group->normal_y[lane] = face->normal.y;
+    group->normal_z[lane] = face->normal.z;
+    group->offset[lane]   = face->offset;
+
+    uint32_t first_edge_slot = face_planes->group_first_edge_slots[group_index];
+    uint32_t num_edge_slots = face_planes->group_num_edge_slots[group_index];
+
+    uint32_t edge_index = 0;
+    bool32_t is_concave = FALSE;
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    // Deleted faces only clear their lane, the zero normal rejects every ray
+    if (Scene_Face_IsDeleted(scene, face_index))
+        half_edge_index = SCENE_ID_NONE;
+
+    while (half_edge_index != SCENE_ID_NONE)
+    {
+        ASSERT(edge_index < num_edge_slots);
+
+        const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
+
+        glm::vec3 origin = scene->vertices[current_half_edge->origin_vertex].position;
+        glm::vec3 edge = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)].position - origin;
+
+        // dot(cross(edge, p - origin), normal) == dot(cross(normal, edge), p - origin)
+        glm::vec3 edge_normal = glm::cross(face->normal, edge);
+
+        Scene_FacePlanes_EdgeSlot* slot = face_planes->edge_slots + first_edge_slot + edge_index;
+        slot->plane_x[lane] = edge_normal.x;
+        slot->plane_y[lane] = edge_normal.y;
+        slot->plane_z[lane] = edge_normal.z;
+        slot->plane_w[lane] = -glm::dot(edge_normal, origin);
+
+        // The corner at the end of the edge is reflex when the next corner is on the outer side of the edge
+        glm::vec3 next_end = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, current_half_edge->next_half_edge)].position;
+        is_concave |= (glm::dot(edge_normal, next_end - origin) < 0.0f);
+
+        ++edge_index;
+        half_edge_index = current_half_edge->next_half_edge;
+
+        if (half_edge_index == face->first_half_edge)
+            break;
+    }
+
+    face_planes->face_concave_flags[face_index] = is_concave;
+
+    if (is_concave)
+        face_planes->group_concave_masks[group_index] |= 1u << lane;
+    else
+        face_planes->group_concave_masks[group_index] &= ~(1u << lane);
+
+    for (; edge_index < num_edge_slots; ++edge_index)
+    {
+        Scene_FacePlanes_EdgeSlot* slot = face_planes->edge_slots + first_edge_slot + edge_index;
+        slot->plane_x[lane] = 0.0f;
+        slot->plane_y[lane] = 0.0f;
+        slot->plane_z[lane] = 0.0f;
+        slot->plane_w[lane] = 0.0f;
+    }
+}
+
+bool32_t Scene_FacePlanes_Init(Scene_FacePlanes* face_planes)
+{
+    memset(face_planes, 0, sizeof(Scene_FacePlanes));
+    return Arena_CreateReserved(&face_planes->arena, SCENE_FACE_PLANES_ARENA_CAPACITY);
+}
+
+void Scene_FacePlanes_Destroy(Scene_FacePlanes* face_planes)
+{
+    Arena_Destroy(&face_planes->arena);
+    memset(face_planes, 0, sizeof(Scene_FacePlanes));
+}
+
+void Scene_FacePlanes_Build(Scene* scene)
+{
+    Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    uint32_t num_faces = scene->num_faces;
+    uint32_t num_groups = (num_faces + SCENE_FACE_PLANES_NUM_LANES - 1) / SCENE_FACE_PLANES_NUM_LANES;
+
+    Arena_Reset(&face_planes->arena);
+
+    face_planes->groups                 = ARENA_ALLOCATE_ARRAY(&face_planes->arena, Scene_FacePlanes_Group, num_groups);
+    face_planes->group_first_edge_slots = ARENA_ALLOCATE_ARRAY(&face_planes->arena, uint32_t, num_groups);
+    face_planes->group_num_edge_slots   = ARENA_ALLOCATE_ARRAY(&face_planes->arena, uint32_t, num_groups);
+    face_planes->group_concave_masks    = ARENA_ALLOCATE_ARRAY(&face_planes->arena, uint32_t, num_groups);
+    face_planes->face_concave_flags     = ARENA_ALLOCATE_ARRAY(&face_planes->arena, bool32_t, num_faces);
+    face_planes->dirty_face_indices     = ARENA_ALLOCATE_ARRAY(&face_planes->arena, uint32_t, num_faces);
+    face_planes->face_dirty_flags       = ARENA_ALLOCATE_ARRAY(&face_planes->arena, bool32_t, num_faces);
+
+    ASSERT(face_planes->groups && face_planes->group_first_edge_slots && face_planes->group_num_edge_slots && face_planes->group_concave_masks);
+    ASSERT(face_planes->face_concave_flags && face_planes->dirty_face_indices && face_planes->face_dirty_flags);
+
+    face_planes->num_faces = num_faces;
+    face_planes->num_groups = num_groups;
+    face_planes->num_edge_slots = 0;
+    face_planes->num_dirty_faces = 0;
+    face_planes->needs_rebuild = FALSE;
+
+    for (uint32_t group_index = 0; group_index < num_groups; ++group_index)
+    {
+        uint32_t group_begin = group_index * SCENE_FACE_PLANES_NUM_LANES;
+        uint32_t group_end = group_begin + SCENE_FACE_PLANES_NUM_LANES;
+        if (group_end > num_faces) group_end = num_faces;
+
+        uint32_t max_num_edges = 0;
+
+        for (uint32_t i = group_begin; i < group_end; ++i)
+        {
+            uint32_t num_edges = scene->faces[i].num_half_edges;
+            if (num_edges > max_num_edges) max_num_edges = num_edges;
+        }
+
+        face_planes->group_first_edge_slots[group_index] = face_planes->num_edge_slots;
+        face_planes->group_num_edge_slots[group_index] = max_num_edges;
+        face_planes->num_edge_slots += max_num_edges;
+
+        // Unused lanes get a zero normal, which every kernel rejects as parallel to the ray
+        memset(face_planes->groups + group_index, 0, sizeof(Scene_FacePlanes_Group));
+        face_planes->group_concave_masks[group_index] = 0;
+    }
+
+    face_planes->edge_slots = ARENA_ALLOCATE_ARRAY(&face_planes->arena, Scene_FacePlanes_EdgeSlot, face_planes->num_edge_slots);
+    ASSERT(face_planes->edge_slots);
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        face_planes->face_dirty_flags[i] = FALSE;
+        Scene_FacePlanes_WriteFace(face_planes, scene, i);
+    }
+}
+
+void Scene_FacePlanes_MarkFaceDirty(Scene* scene, uint32_t face_index)
+{
+    Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    // Faces that are not mirrored yet are picked up by the next rebuild
+    if (face_index >= face_planes->num_faces || face_planes->face_dirty_flags[face_index])
+        return;
+
+    face_planes->face_dirty_flags[face_index] = TRUE;
+    face_planes->dirty_face_indices[face_planes->num_dirty_faces++] = face_index;
+}
+
+void Scene_FacePlanes_Update(Scene* scene)
+{
+    Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    if (face_planes->needs_rebuild || face_planes->num_faces != scene->num_faces)
+    {
+        Scene_FacePlanes_Build(scene);
+        return;
+    }
+
+    // Faces moved by Scene_Defragment can have more edges than their group has slots for
+    for (uint32_t i = 0; i < face_planes->num_dirty_faces; ++i)
+    {
+        uint32_t face_index = face_planes->dirty_face_indices[i];
+
+        if (scene->faces[face_index].num_half_edges > face_planes->group_num_edge_slots[face_index / SCENE_FACE_PLANES_NUM_LANES])
+        {
+            Scene_FacePlanes_Build(scene);
+            return;
+        }
+    }
+
+    for (uint32_t i = 0; i < face_planes->num_dirty_faces; ++i)
+    {
+        uint32_t face_index = face_planes->dirty_face_indices[i];
+
+        face_planes->face_dirty_flags[face_index] = FALSE;
+        Scene_FacePlanes_WriteFace(face_planes, scene, face_index);
+    }
+
+    face_planes->num_dirty_faces = 0;
+}
+
+uint32_t Scene_FacePlanes_GetBestKernel(void)
+{
+    if (Cpu_IsAVXSupported()) return SCENE_FACE_PLANES_KERNEL_AVX;
+    if (Cpu_IsSSE2Supported()) return SCENE_FACE_PLANES_KERNEL_SSE;
+
+    return SCENE_FACE_PLANES_KERNEL_SCALAR;
+}
+
+static bool32_t Scene_FacePlanes_IntersectLane(
+    const Scene_FacePlanes*     face_planes,
+    uint32_t                    group_index,
+    uint32_t                    lane,
+    const Scene_FacePlanes_Ray* ray,
+    float                       ray_max_length,
+    float*                      out_ray_length
+)
+{
+    const Scene_FacePlanes_Group* group = face_planes->groups + group_index;
+
+    glm::vec3 normal(group->normal_x[lane], group->normal_y[lane], group->normal_z[lane]);
+
+    float denom = glm::dot(normal, ray->direction);
+
+    if (denom > -SCENE_FACE_PLANES_PARALLEL_EPSILON && denom < SCENE_FACE_PLANES_PARALLEL_EPSILON)
+        return FALSE;
+
+    float t = -(group->offset[lane] + glm::dot(normal, ray->origin)) / denom;
+    if (t < ray->min_length || t > ray_max_length)
+        return FALSE;
+
+    glm::vec3 intersection = ray->origin + t * ray->direction;
+
+    const Scene_FacePlanes_EdgeSlot* slot = face_planes->edge_slots + face_planes->group_first_edge_slots[group_index];
+    const Scene_FacePlanes_EdgeSlot* slots_end = slot + face_planes->group_num_edge_slots[group_index];
+
+    for (; slot < slots_end; ++slot)
+    {
+        float side = slot->plane_x[lane] * intersection.x + slot->plane_y[lane] * intersection.y + slot->plane_z[lane] * intersection.z + slot->plane_w[lane];
+
+        if (side < 0.0f)
+            return FALSE;
+    }
+
+    *out_ray_length = t;
+    return TRUE;
+}
+
+// Even-odd test of the point where the ray meets the plane against the corners, projected along the largest normal axis.
+// NOTE: Inlined so the AVX kernel gets its own copy, calling code compiled without AVX from it stalls on every call.
+static FPS_FORCE_INLINE bool32_t Scene_FacePlanes_IntersectConcaveFace(
+    const Scene*                scene,
+    uint32_t                    face_index,
+    const Scene_FacePlanes_Ray* ray,
+    float                       ray_max_length,
+    float*                      out_ray_length
+)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    float denom = glm::dot(face->normal, ray->direction);
+
+    if (denom > -SCENE_FACE_PLANES_PARALLEL_EPSILON && denom < SCENE_FACE_PLANES_PARALLEL_EPSILON)
+        return FALSE;
+
+    float t = -(face->offset + glm::dot(face->normal, ray->origin)) / denom;
+    if (t < ray->min_length || t > ray_max_length)
+        return FALSE;
+
+    glm::vec3 intersection = ray->origin + t * ray->direction;
+    glm::vec3 abs_normal = glm::abs(face->normal);
+
+    // Ties go to the first axis, so a normal between two axes still drops exactly one of them
+    uint32_t drop_axis = (abs_normal.x >= abs_normal.y && abs_normal.x >= abs_normal.z) ? 0 : ((abs_normal.y >= abs_normal.z) ? 1 : 2);
+
+    uint32_t axis_u = (drop_axis + 1) % 3;
+    uint32_t axis_v = (drop_axis + 2) % 3;
+
+    float point_u = intersection[axis_u];
+    float point_v = intersection[axis_v];
+
+    bool32_t is_inside = FALSE;
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    do
+    {
+        const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
+
+        glm::vec3 a = scene->vertices[current_half_edge->origin_vertex].position;
+        glm::vec3 b = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)].position;
+
+        if ((a[axis_v] > point_v) != (b[axis_v] > point_v) &&
+            point_u < (b[axis_u] - a[axis_u]) * (point_v - a[axis_v]) / (b[axis_v] - a[axis_v]) + a[axis_u])
+        {
+            is_inside = !is_inside;
+        }
+
+        half_edge_index = current_half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
+
+    if (!is_inside)
+        return FALSE;
+
+    *out_ray_length = t;
+    return TRUE;
+}
+
+bool32_t Scene_FacePlanes_IntersectFace(
+    const Scene* scene,
+    uint32_t     face_index,
+    glm::vec3    ray_origin,
+    glm::vec3    ray_direction,
+    float        ray_min_length,
+    float        ray_max_length,
+    float*       out_ray_length
+)
+{
+    const Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    ASSERT(face_index < face_planes->num_faces);
+
+    Scene_FacePlanes_Ray ray = { ray_origin, ray_direction, ray_min_length };
+
+    bool32_t lane_result = Scene_FacePlanes_IntersectLane(
+        face_planes,
+        face_index / SCENE_FACE_PLANES_NUM_LANES,
+        face_index % SCENE_FACE_PLANES_NUM_LANES,
+        &ray,
+        ray_max_length,
+        out_ray_length
+    );
+
+    // The edge planes never pass points outside of the face, so only the rejected points of concave faces are tested again
+    if (lane_result || !face_planes->face_concave_flags[face_index] || Scene_Face_IsDeleted(scene, face_index))
+        return lane_result;
+
+    return Scene_FacePlanes_IntersectConcaveFace(scene, face_index, &ray, ray_max_length, out_ray_length);
+}
+
+// Tests the lanes of concave faces whose plane the ray meets in range but whose edge planes rejected the point
+static FPS_FORCE_INLINE void Scene_FacePlanes_TestConcaveLanes(
+    const Scene*                scene,
+    uint32_t                    first_face,
+    uint32_t                    lane_mask,
+    const Scene_FacePlanes_Ray* ray,
+    float*                      io_hit_distance,
+    uint32_t*                   io_hit_face_index
+)
+{
+    for (uint32_t lane = 0; lane < SCENE_FACE_PLANES_NUM_LANES; ++lane)
+    {
+        float distance;
+        if ((lane_mask & (1u << lane)) && Scene_FacePlanes_IntersectConcaveFace(scene, first_face + lane, ray, *io_hit_distance, &distance))
+        {
+            *io_hit_distance = distance;
+            *io_hit_face_index = first_face + lane;
+        }
+    }
+}
+
+static void Scene_FacePlanes_RayCast_Scalar(
+    const Scene*                scene,
+    const Scene_FacePlanes_Ray* ray,
+    float*                      io_hit_distance,
+    uint32_t*                   io_hit_face_index
+)
+{
+    const Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    for (uint32_t group_index = 0; group_index < face_planes->num_groups; ++group_index)
+    {
+        uint32_t concave_mask = face_planes->group_concave_masks[group_index];
+
+        for (uint32_t lane = 0; lane < SCENE_FACE_PLANES_NUM_LANES; ++lane)
+        {
+            uint32_t face_index = group_index * SCENE_FACE_PLANES_NUM_LANES + lane;
+
+            float distance;
+            if (Scene_FacePlanes_IntersectLane(face_planes, group_index, lane, ray, *io_hit_distance, &distance) ||
+                ((concave_mask & (1u << lane)) && Scene_FacePlanes_IntersectConcaveFace(scene, face_index, ray, *io_hit_distance, &distance)))
+            {
+                *io_hit_distance = distance;
+                *io_hit_face_index = face_index;
+            }
+        }
+    }
+}
+
+#if FPS_ARCH_X86
+static void Scene_FacePlanes_RayCast_SSE(
+    const Scene*                scene,
+    const Scene_FacePlanes_Ray* ray,
+    float*                      io_hit_distance,
+    uint32_t*                   io_hit_face_index
+)
+{
+    const Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 epsilon = _mm_set1_ps(SCENE_FACE_PLANES_PARALLEL_EPSILON);
+    const __m128 zero = _mm_setzero_ps();
+
+    const __m128 origin_x = _mm_set1_ps(ray->origin.x);
+    const __m128 origin_y = _mm_set1_ps(ray->origin.y);
+    const __m128 origin_z = _mm_set1_ps(ray->origin.z);
+
+    const __m128 direction_x = _mm_set1_ps(ray->direction.x);
+    const __m128 direction_y = _mm_set1_ps(ray->direction.y);
+    const __m128 direction_z = _mm_set1_ps(ray->direction.z);
+
+    const __m128 min_length = _mm_set1_ps(ray->min_length);
+
+    for (uint32_t group_index = 0; group_index < face_planes->num_groups; ++group_index)
+    {
+        const Scene_FacePlanes_Group* group = face_planes->groups + group_index;
+
+        const Scene_FacePlanes_EdgeSlot* slots = face_planes->edge_slots + face_planes->group_first_edge_slots[group_index];
+        uint32_t num_slots = face_planes->group_num_edge_slots[group_index];
+
+        for (uint32_t half = 0; half < SCENE_FACE_PLANES_NUM_LANES; half += 4)
+        {
+            __m128 normal_x = _mm_load_ps(group->normal_x + half);
+            __m128 normal_y = _mm_load_ps(group->normal_y + half);
+            __m128 normal_z = _mm_load_ps(group->normal_z + half);
+            __m128 offset   = _mm_load_ps(group->offset + half);
+
+            __m128 denom = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal_x, direction_x), _mm_mul_ps(normal_y, direction_y)), _mm_mul_ps(normal_z, direction_z));
+            __m128 plane_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal_x, origin_x), _mm_mul_ps(normal_y, origin_y)), _mm_mul_ps(normal_z, origin_z));
+
+            __m128 t = _mm_div_ps(_mm_xor_ps(_mm_add_ps(offset, plane_distance), sign_mask), denom);
+
+            __m128 valid = _mm_cmpge_ps(_mm_andnot_ps(sign_mask, denom), epsilon);
+            valid = _mm_and_ps(valid, _mm_cmpge_ps(t, min_length));
+            valid = _mm_and_ps(valid, _mm_cmple_ps(t, _mm_set1_ps(*io_hit_distance)));
+
+            uint32_t plane_mask = (uint32_t)_mm_movemask_ps(valid);
+            if (plane_mask == 0)
+                continue;
+
+            __m128 intersection_x = _mm_add_ps(origin_x, _mm_mul_ps(t, direction_x));
+            __m128 intersection_y = _mm_add_ps(origin_y, _mm_mul_ps(t, direction_y));
+            __m128 intersection_z = _mm_add_ps(origin_z, _mm_mul_ps(t, direction_z));
+
+            for (uint32_t i = 0; i < num_slots; ++i)
+            {
+                const Scene_FacePlanes_EdgeSlot* slot = slots + i;
+
+                __m128 side = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_load_ps(slot->plane_x + half), intersection_x), _mm_mul_ps(_mm_load_ps(slot->plane_y + half), intersection_y)),
+                    _mm_add_ps(_mm_mul_ps(_mm_load_ps(slot->plane_z + half), intersection_z), _mm_load_ps(slot->plane_w + half))
+                );
+
+                valid = _mm_and_ps(valid, _mm_cmpge_ps(side, zero));
+
+                if (_mm_movemask_ps(valid) == 0)
+                    break;
+            }
+
+            uint32_t mask = (uint32_t)_mm_movemask_ps(valid);
+
+            if (mask != 0)
+            {
+                alignas(16) float distances[4];
+                _mm_store_ps(distances, t);
+
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    if ((mask & (1u << lane)) && distances[lane] <= *io_hit_distance)
+                    {
+                        *io_hit_distance = distances[lane];
+                        *io_hit_face_index = group_index * SCENE_FACE_PLANES_NUM_LANES + half + lane;
+                    }
+                }
+            }
+
+            uint32_t concave_mask = plane_mask & ~mask & (face_planes->group_concave_masks[group_index] >> half) & 0xF;
+
+            if (concave_mask != 0)
+                Scene_FacePlanes_TestConcaveLanes(scene, group_index * SCENE_FACE_PLANES_NUM_LANES + half, concave_mask, ray, io_hit_distance, io_hit_face_index);
+        }
+    }
+}
+
+FPS_TARGET_AVX static void Scene_FacePlanes_RayCast_AVX(
+    const Scene*                scene,
+    const Scene_FacePlanes_Ray* ray,
+    float*                      io_hit_distance,
+    uint32_t*                   io_hit_face_index
+)
+{
+    const Scene_FacePlanes* face_planes = &scene->face_planes;
+
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 epsilon = _mm256_set1_ps(SCENE_FACE_PLANES_PARALLEL_EPSILON);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 origin_x = _mm256_set1_ps(ray->origin.x);
+    const __m256 origin_y = _mm256_set1_ps(ray->origin.y);
+    const __m256 origin_z = _mm256_set1_ps(ray->origin.z);
+
+    const __m256 direction_x = _mm256_set1_ps(ray->direction.x);
+    const __m256 direction_y = _mm256_set1_ps(ray->direction.y);
+    const __m256 direction_z = _mm256_set1_ps(ray->direction.z);
+
+    const __m256 min_length = _mm256_set1_ps(ray->min_length);
+
+    for (uint32_t group_index = 0; group_index < face_planes->num_groups; ++group_index)
+    {
+        const Scene_FacePlanes_Group* group = face_planes->groups + group_index;
+
+        __m256 normal_x = _mm256_load_ps(group->normal_x);
+        __m256 normal_y = _mm256_load_ps(group->normal_y);
+        __m256 normal_z = _mm256_load_ps(group->normal_z);
+        __m256 offset   = _mm256_load_ps(group->offset);
+
+        __m256 denom = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal_x, direction_x), _mm256_mul_ps(normal_y, direction_y)), _mm256_mul_ps(normal_z, direction_z));
+        __m256 plane_distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal_x, origin_x), _mm256_mul_ps(normal_y, origin_y)), _mm256_mul_ps(normal_z, origin_z));
+
+        __m256 t = _mm256_div_ps(_mm256_xor_ps(_mm256_add_ps(offset, plane_distance), sign_mask), denom);
+
+        __m256 valid = _mm256_cmp_ps(_mm256_andnot_ps(sign_mask, denom), epsilon, _CMP_GE_OQ);
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, min_length, _CMP_GE_OQ));
+        valid = _mm256_and_ps(valid, _mm256_cmp_ps(t, _mm256_set1_ps(*io_hit_distance), _CMP_LE_OQ));
+
+        uint32_t plane_mask = (uint32_t)_mm256_movemask_ps(valid);
+        if (plane_mask == 0)
+            continue;
+
+        __m256 intersection_x = _mm256_add_ps(origin_x, _mm256_mul_ps(t, direction_x));
+        __m256 intersection_y = _mm256_add_ps(origin_y, _mm256_mul_ps(t, direction_y));
+        __m256 intersection_z = _mm256_add_ps(origin_z, _mm256_mul_ps(t, direction_z));
+
+        const Scene_FacePlanes_EdgeSlot* slot = face_planes->edge_slots + face_planes->group_first_edge_slots[group_index];
+        const Scene_FacePlanes_EdgeSlot* slots_end = slot + face_planes->group_num_edge_slots[group_index];
+
+        for (; slot < slots_end; ++slot)
+        {
+            __m256 side = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(slot->plane_x), intersection_x), _mm256_mul_ps(_mm256_load_ps(slot->plane_y), intersection_y)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(slot->plane_z), intersection_z), _mm256_load_ps(slot->plane_w))
+            );
+
+            valid = _mm256_and_ps(valid, _mm256_cmp_ps(side, zero, _CMP_GE_OQ));
+
+            if (_mm256_movemask_ps(valid) == 0)
+                break;
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(valid);
+
+        if (mask != 0)
+        {
+            alignas(32) float distances[SCENE_FACE_PLANES_NUM_LANES];
+            _mm256_store_ps(distances, t);
+
+            for (uint32_t lane = 0; lane < SCENE_FACE_PLANES_NUM_LANES; ++lane)
+            {
+                if ((mask & (1u << lane)) && distances[lane] <= *io_hit_distance)
+                {
+                    *io_hit_distance = distances[lane];
+                    *io_hit_face_index = group_index * SCENE_FACE_PLANES_NUM_LANES + lane;
+                }
+            }
+        }
+
+        uint32_t concave_mask = plane_mask & ~mask & face_planes->group_concave_masks[group_index];
+
+        if (concave_mask != 0)
+            Scene_FacePlanes_TestConcaveLanes(scene, group_index * SCENE_FACE_PLANES_NUM_LANES, concave_mask, ray, io_hit_distance, io_hit_face_index);
+    }
+}
+#endif
+
+bool32_t Scene_FacePlanes_RayCast(
+    const Scene* scene,
+    uint32_t     kernel,
+    glm::vec3    ray_origin,
+    glm::vec3    ray_direction,
+    float        ray_min_length,
+    float        ray_max_length,
+    uint32_t*    out_face_index,
+    float*       out_ray_length
+)
+{
+    Scene_FacePlanes_Ray ray = { ray_origin, ray_direction, ray_min_length };
+
+    float    hit_distance = ray_max_length;
+    uint32_t hit_face_index = SCENE_ID_NONE;
+
+    switch (kernel)
+    {
+#if FPS_ARCH_X86
+        case SCENE_FACE_PLANES_KERNEL_AVX:
+            Scene_FacePlanes_RayCast_AVX(scene, &ray, &hit_distance, &hit_face_index);
+            break;
+
+        case SCENE_FACE_PLANES_KERNEL_SSE:
+            Scene_FacePlanes_RayCast_SSE(scene, &ray, &hit_distance, &hit_face_index);
+            break;
+#endif
+
+        default:
+            Scene_FacePlanes_RayCast_Scalar(scene, &ray, &hit_distance, &hit_face_index);
+            break;
+    }
+
+    if (hit_face_index == SCENE_ID_NONE)
+        return FALSE;
+
+    *out_face_index = hit_face_index;
+    *out_ray_length = hit_distance;
+
+    return TRUE;
+}
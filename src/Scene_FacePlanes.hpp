@@ -0,0 +1,105 @@
+#ifndef SCENE_FACE_PLANES_HPP_
+#define SCENE_FACE_PLANES_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+#define SCENE_FACE_PLANES_NUM_LANES 8
+
+#define SCENE_FACE_PLANES_KERNEL_SCALAR 0
+#define SCENE_FACE_PLANES_KERNEL_SSE 1
+#define SCENE_FACE_PLANES_KERNEL_AVX 2
+
+struct Scene;
+
+// Face planes of SCENE_FACE_PLANES_NUM_LANES consecutive faces, one face per lane
+struct alignas(32) Scene_FacePlanes_Group
+{
+    float normal_x[SCENE_FACE_PLANES_NUM_LANES];
+    float normal_y[SCENE_FACE_PLANES_NUM_LANES];
+    float normal_z[SCENE_FACE_PLANES_NUM_LANES];
+    float offset[SCENE_FACE_PLANES_NUM_LANES];
+};
+
+// One edge of every face in a group, stored as the plane through the edge that faces the inside of the polygon.
+// Faces with fewer edges than the group has slots are padded with planes that always pass.
+struct alignas(32) Scene_FacePlanes_EdgeSlot
+{
+    float plane_x[SCENE_FACE_PLANES_NUM_LANES];
+    float plane_y[SCENE_FACE_PLANES_NUM_LANES];
+    float plane_z[SCENE_FACE_PLANES_NUM_LANES];
+    float plane_w[SCENE_FACE_PLANES_NUM_LANES];
+};
+
+// Structure-of-arrays mirror of the face planes and edges, laid out for testing many faces at once
+struct Scene_FacePlanes
+{
+    // Holds every array below, all of them are sized for the faces at build time
+    Arena arena;
+
+    Scene_FacePlanes_Group* groups;
+    uint32_t*               group_first_edge_slots;
+    uint32_t*               group_num_edge_slots;
+    uint32_t                num_groups;
+
+    // NOTE: Every group needs as many edge slots as its face with the most edges, so there are never more slots than half-edges
+    Scene_FacePlanes_EdgeSlot* edge_slots;
+    uint32_t                   num_edge_slots;
+
+    uint32_t num_faces;
+
+    // Faces with a reflex corner, their edge planes only pass the points that see every corner of the face
+    bool32_t* face_concave_flags;
+    uint32_t* group_concave_masks; // One bit per lane
+
+    uint32_t* dirty_face_indices;
+    bool32_t* face_dirty_flags;
+    uint32_t  num_dirty_faces;
+
+    // Set when faces were removed, the face count alone can not tell that the faces changed
+    bool32_t needs_rebuild;
+};
+
+bool32_t Scene_FacePlanes_Init(Scene_FacePlanes* face_planes);
+
+void Scene_FacePlanes_Destroy(Scene_FacePlanes* face_planes);
+
+void Scene_FacePlanes_Build(Scene* scene);
+
+void Scene_FacePlanes_MarkFaceDirty(Scene* scene, uint32_t face_index);
+
+// Refreshes the planes of dirty faces and rebuilds the whole mirror when faces were added
+void Scene_FacePlanes_Update(Scene* scene);
+
+// Returns the fastest kernel supported by the CPU
+uint32_t Scene_FacePlanes_GetBestKernel(void);
+
+// Points on concave faces that the edge planes reject are tested against the corners of the face.
+// NOTE: ray_direction must be a unit vector, the mirror must be up to date (see Scene_FacePlanes_Update)
+bool32_t Scene_FacePlanes_IntersectFace(
+    const Scene* scene,
+    uint32_t     face_index,
+    glm::vec3    ray_origin,
+    glm::vec3    ray_direction,
+    float        ray_min_length,
+    float        ray_max_length,
+    float*       out_ray_length
+);
+
+// Tests the ray against all faces, without any acceleration structure. Concave faces are handled like in
+// Scene_FacePlanes_IntersectFace.
+// NOTE: ray_direction must be a unit vector, the mirror must be up to date (see Scene_FacePlanes_Update)
+bool32_t Scene_FacePlanes_RayCast(
+    const Scene* scene,
+    uint32_t     kernel,
+    glm::vec3    ray_origin,
+    glm::vec3    ray_direction,
+    float        ray_min_length,
+    float        ray_max_length,
+    uint32_t*    out_face_index,
+    float*       out_ray_length
+);
+
+#endif // !SCENE_FACE_PLANES_HPP_
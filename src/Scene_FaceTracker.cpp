@@ -0,0 +1,340 @@
+#include "Scene.hpp"
+
+#include <string.h>
+
+// Slot of the table that finds the old faces of the changes by their signature
+struct Scene_FaceTracker_Slot
+{
+    uint32_t signature; // 0 for empty slots
+    uint32_t change_index;
+};
+
+static uint32_t Scene_FaceTracker_MixHash(uint32_t hash, uint32_t value)
+{
+    hash = (hash ^ value) * 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+static uint32_t Scene_FaceTracker_MixHashFloats(uint32_t hash, const float* values, uint32_t num_values)
+{
+    for (uint32_t i = 0; i < num_values; ++i)
+    {
+        uint32_t bits;
+        memcpy(&bits, values + i, sizeof(uint32_t));
+
+        hash = Scene_FaceTracker_MixHash(hash, bits);
+    }
+
+    return hash;
+}
+
+// Hash of the corners and the color of the face, 0 for deleted faces
+static uint32_t Scene_FaceTracker_GetSignature(const Scene* scene, uint32_t face_index)
+{
+    if (Scene_Face_IsDeleted(scene, face_index))
+        return 0;
+
+    const Scene_Face* face = scene->faces + face_index;
+
+    uint32_t hash = Scene_FaceTracker_MixHash(0x9E3779B9u, face->num_half_edges);
+    hash = Scene_FaceTracker_MixHashFloats(hash, (const float*)&face->color, 4);
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    do
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+        hash = Scene_FaceTracker_MixHashFloats(hash, (const float*)&scene->vertices[half_edge->origin_vertex].position, 3);
+
+        half_edge_index = half_edge->next_half_edge;
+    }
+    while (half_edge_index != face->first_half_edge);
+
+    // NOTE: 0 is left for deleted faces
+    return hash | 1;
+}
+
+// Compares the corners and the color of a live face with a tracked one wherever the tracked one is.
+// NOTE: Compares the bits, so that a NaN coordinate does not make a face change every update
+static bool32_t Scene_FaceTracker_IsFaceEqual(const Scene_FaceTracker* tracker, const Scene_TrackedFace* tracked_face, const Scene* scene, uint32_t face_index)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    if (tracked_face->signature == 0 || tracked_face->num_half_edges != face->num_half_edges ||
+        memcmp(&tracked_face->color, &face->color, sizeof(glm::vec4)) != 0)
+    {
+        return FALSE;
+    }
+
+    const glm::vec3* corners = tracker->corners + tracked_face->first_half_edge;
+    uint32_t half_edge_index = face->first_half_edge;
+
+    for (uint32_t i = 0; i < face->num_half_edges; ++i)
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+
+        if (memcmp(corners + i, &scene->vertices[half_edge->origin_vertex].position, sizeof(glm::vec3)) != 0)
+            return FALSE;
+
+        half_edge_index = half_edge->next_half_edge;
+    }
+
+    return TRUE;
+}
+
+// Faces that kept their half-edges and corners are unchanged, deleted ones only need to keep their half-edges
+static bool32_t Scene_FaceTracker_IsFaceChanged(const Scene_FaceTracker* tracker, const Scene* scene, uint32_t face_index)
+{
+    const Scene_TrackedFace* tracked_face = tracker->faces + face_index;
+    const Scene_Face* face = scene->faces + face_index;
+
+    if (tracked_face->first_half_edge != face->first_half_edge || tracked_face->num_half_edges != face->num_half_edges)
+        return TRUE;
+
+    if (Scene_Face_IsDeleted(scene, face_index))
+        return tracked_face->signature != 0;
+
+    return !Scene_FaceTracker_IsFaceEqual(tracker, tracked_face, scene, face_index);
+}
+
+static void Scene_FaceTracker_Resize(Scene_FaceTracker* tracker, uint32_t num_faces, uint32_t num_corners)
+{
+    if (num_faces < tracker->num_faces)
+    {
+        Arena_Rewind(&tracker->face_arena, (uint64_t)num_faces * sizeof(Scene_TrackedFace));
+    }
+    else if (num_faces > tracker->num_faces)
+    {
+        uint32_t num_added_faces = num_faces - tracker->num_faces;
+
+        Scene_TrackedFace* faces = ARENA_ALLOCATE_ARRAY(&tracker->face_arena, Scene_TrackedFace, num_added_faces);
+        ASSERT(faces == tracker->faces + tracker->num_faces);
+
+        memset(faces, 0, (uint64_t)num_added_faces * sizeof(Scene_TrackedFace));
+    }
+
+    if (num_corners < tracker->num_corners)
+    {
+        Arena_Rewind(&tracker->corner_arena, (uint64_t)num_corners * sizeof(glm::vec3));
+    }
+    else if (num_corners > tracker->num_corners)
+    {
+        glm::vec3* corners = ARENA_ALLOCATE_ARRAY(&tracker->corner_arena, glm::vec3, num_corners - tracker->num_corners);
+        ASSERT(corners == tracker->corners + tracker->num_corners);
+        UNUSED(corners);
+    }
+
+    tracker->num_faces = num_faces;
+    tracker->num_corners = num_corners;
+}
+
+bool32_t Scene_FaceTracker_Init(Scene_FaceTracker* tracker)
+{
+    memset(tracker, 0, sizeof(Scene_FaceTracker));
+
+    if (!Arena_CreateReserved(&tracker->face_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(Scene_TrackedFace)) ||
+        !Arena_CreateReserved(&tracker->corner_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(glm::vec3)))
+    {
+        Scene_FaceTracker_Destroy(tracker);
+        return FALSE;
+    }
+
+    tracker->faces = (Scene_TrackedFace*)tracker->face_arena.memory;
+    tracker->corners = (glm::vec3*)tracker->corner_arena.memory;
+
+    // NOTE: Position 0 may be logged already, so a new tracker starts behind the log and compares every face
+    tracker->face_change_position = UINT64_MAX;
+
+    return TRUE;
+}
+
+void Scene_FaceTracker_Destroy(Scene_FaceTracker* tracker)
+{
+    Arena_Destroy(&tracker->corner_arena);
+    Arena_Destroy(&tracker->face_arena);
+
+    memset(tracker, 0, sizeof(Scene_FaceTracker));
+}
+
+Scene_FaceChange* Scene_FaceTracker_Update(Scene_FaceTracker* tracker, Scene* scene, uint32_t* out_num_changes)
+{
+    uint32_t old_num_faces = tracker->num_faces;
+    uint32_t num_faces = scene->num_faces;
+    uint32_t min_num_faces = glm::min(old_num_faces, num_faces);
+    uint32_t max_num_faces = glm::max(old_num_faces, num_faces);
+
+    // Faces that were added or removed are changes, the others are only looked at when they were logged
+    bool32_t is_logged = tracker->face_change_position >= scene->first_face_change && tracker->face_change_position <= scene->end_face_change;
+
+    uint64_t max_num_changes = (uint64_t)(max_num_faces - min_num_faces) + (is_logged ? scene->end_face_change - tracker->face_change_position : min_num_faces);
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    Scene_FaceChange* changes = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_FaceChange, max_num_changes);
+    ASSERT(changes || max_num_changes == 0);
+
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    // Faces logged more than once are looked at once, the serial of the update tells which ones were
+    if (++tracker->serial == 0)
+    {
+        for (uint32_t i = 0; i < old_num_faces; ++i)
+            tracker->faces[i].serial = 0;
+
+        tracker->serial = 1;
+    }
+
+    uint32_t num_changes = 0;
+
+    if (is_logged)
+    {
+        for (uint64_t position = tracker->face_change_position; position < scene->end_face_change; ++position)
+        {
+            uint32_t face_index = scene->face_changes[position - scene->first_face_change];
+
+            if (face_index >= min_num_faces || tracker->faces[face_index].serial == tracker->serial)
+                continue;
+
+            tracker->faces[face_index].serial = tracker->serial;
+
+            if (Scene_FaceTracker_IsFaceChanged(tracker, scene, face_index))
+                changes[num_changes++].face_index = face_index;
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < min_num_faces; ++i)
+        {
+            if (Scene_FaceTracker_IsFaceChanged(tracker, scene, i))
+                changes[num_changes++].face_index = i;
+        }
+    }
+
+    for (uint32_t i = min_num_faces; i < max_num_faces; ++i)
+        changes[num_changes++].face_index = i;
+
+    tracker->face_change_position = scene->end_face_change;
+    *out_num_changes = num_changes;
+
+    if (num_changes == 0)
+        return changes;
+
+    // Old faces go into the table before any face looks for its old one
+    uint32_t num_old_faces = 0;
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        Scene_FaceChange* change = changes + i;
+        uint32_t face_index = change->face_index;
+
+        if (face_index < old_num_faces)
+            change->old_face = tracker->faces[face_index];
+        else
+            memset(&change->old_face, 0, sizeof(Scene_TrackedFace));
+
+        change->signature = (face_index < num_faces) ? Scene_FaceTracker_GetSignature(scene, face_index) : 0;
+        change->matched_change = SCENE_ID_NONE;
+        change->is_old_face_taken = FALSE;
+
+        num_old_faces += (change->old_face.signature != 0);
+    }
+
+    uint32_t table_capacity = 1;
+
+    while (table_capacity < 2 * num_old_faces)
+        table_capacity *= 2;
+
+    Scene_FaceTracker_Slot* table = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_FaceTracker_Slot, table_capacity);
+    ASSERT(table);
+
+    memset(table, 0, (uint64_t)table_capacity * sizeof(Scene_FaceTracker_Slot));
+
+    uint32_t table_mask = table_capacity - 1;
+
+    for (uint32_t i = 0; i < num_changes && num_old_faces > 0; ++i)
+    {
+        uint32_t signature = changes[i].old_face.signature;
+
+        if (signature == 0)
+            continue;
+
+        uint32_t slot = Scene_FaceTracker_MixHash(signature, 0) & table_mask;
+
+        while (table[slot].signature != 0)
+            slot = (slot + 1) & table_mask;
+
+        table[slot].signature = signature;
+        table[slot].change_index = i;
+    }
+
+    // Faces that moved without changing find their old face, a hash collision is told apart by the corners
+    for (uint32_t i = 0; i < num_changes && num_old_faces > 0; ++i)
+    {
+        Scene_FaceChange* change = changes + i;
+
+        if (change->signature == 0)
+            continue;
+
+        for (uint32_t slot = Scene_FaceTracker_MixHash(change->signature, 0) & table_mask; table[slot].signature != 0; slot = (slot + 1) & table_mask)
+        {
+            Scene_FaceChange* old_change = changes + table[slot].change_index;
+
+            if (table[slot].signature != change->signature || old_change->is_old_face_taken ||
+                !Scene_FaceTracker_IsFaceEqual(tracker, &old_change->old_face, scene, change->face_index))
+            {
+                continue;
+            }
+
+            old_change->is_old_face_taken = TRUE;
+            change->matched_change = table[slot].change_index;
+            break;
+        }
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    // Only now the copy is overwritten, the matches above read the old corners
+    Scene_FaceTracker_Resize(tracker, num_faces, scene->num_half_edges);
+
+    for (uint32_t i = 0; i < num_changes; ++i)
+    {
+        const Scene_FaceChange* change = changes + i;
+        uint32_t face_index = change->face_index;
+
+        if (face_index >= num_faces)
+            continue;
+
+        const Scene_Face* face = scene->faces + face_index;
+        Scene_TrackedFace* tracked_face = tracker->faces + face_index;
+
+        tracked_face->first_half_edge = face->first_half_edge;
+        tracked_face->num_half_edges = face->num_half_edges;
+        tracked_face->signature = change->signature;
+        tracked_face->serial = tracker->serial;
+
+        if (change->signature == 0)
+        {
+            tracked_face->color = glm::vec4(0.0f);
+            tracked_face->bounds_min = glm::vec3(0.0f);
+            tracked_face->bounds_max = glm::vec3(0.0f);
+            continue;
+        }
+
+        tracked_face->color = face->color;
+        Scene_Face_GetBounds(scene, face_index, &tracked_face->bounds_min, &tracked_face->bounds_max);
+
+        glm::vec3* corners = tracker->corners + face->first_half_edge;
+        uint32_t half_edge_index = face->first_half_edge;
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+        {
+            const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+            corners[j] = scene->vertices[half_edge->origin_vertex].position;
+
+            half_edge_index = half_edge->next_half_edge;
+        }
+    }
+
+    return changes;
+}
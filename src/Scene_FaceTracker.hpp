@@ -0,0 +1,68 @@
+#ifndef SCENE_FACE_TRACKER_HPP_
+#define SCENE_FACE_TRACKER_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+struct Scene;
+
+// Face as a Scene_FaceTracker saw it in its last update
+struct Scene_TrackedFace
+{
+    glm::vec4 color;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    // Deleted faces keep their half-edges, so that the ranges of the faces still cover every half-edge
+    uint32_t first_half_edge;
+    uint32_t num_half_edges;
+
+    uint32_t signature; // Hash of the corners and the color, 0 for deleted faces and the ones past the end of the scene
+    uint32_t serial;    // Of the last update that looked at the face
+};
+
+// Face whose corners, color or half-edges changed since the last update of a tracker
+struct Scene_FaceChange
+{
+    uint32_t face_index;
+    uint32_t signature; // Of the face as it is now
+
+    // Change whose old face has the same corners and color as the face has now, SCENE_ID_NONE when there is none.
+    // The old face of a change is matched at most once, is_old_face_taken tells whether it was.
+    uint32_t matched_change;
+    bool32_t is_old_face_taken;
+
+    Scene_TrackedFace old_face;
+};
+
+// Copy of the corners and colors of the faces as a consumer of the scene last saw them, for the ones that keep something
+// per face and need to find out which faces changed and which ones only moved to another index
+struct Scene_FaceTracker
+{
+    // Both arrays grow in their own reserved arena, the corners are at the index of their half-edge
+    Arena              face_arena;
+    Scene_TrackedFace* faces;
+    uint32_t           num_faces;
+
+    Arena      corner_arena;
+    glm::vec3* corners;
+    uint32_t   num_corners;
+
+    // Position in the face change log of the scene up to which the changes are known
+    uint64_t face_change_position;
+    uint32_t serial;
+};
+
+bool32_t Scene_FaceTracker_Init(Scene_FaceTracker* tracker);
+
+void Scene_FaceTracker_Destroy(Scene_FaceTracker* tracker);
+
+// Compares the faces that were logged since the last update, or every face after the log was dropped, with the copy of the
+// tracker and updates the copy. Faces whose signature matches the old face of another change are confirmed by comparing
+// their corners and color, and matched with it as a face that only moved to another index.
+// The changes are allocated in the scratch arena of the scene, and are left there for the caller to rewind.
+Scene_FaceChange* Scene_FaceTracker_Update(Scene_FaceTracker* tracker, Scene* scene, uint32_t* out_num_changes);
+
+#endif // !SCENE_FACE_TRACKER_HPP_
@@ -0,0 +1,231 @@
+#include "Scene.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SCENE_FILE_MAGIC 0x4C535046u // "FPSL" read as little endian
+#define SCENE_FILE_VERSION 2
+
+#define SCENE_FILE_SECTION_VERTICES 0
+#define SCENE_FILE_SECTION_HALF_EDGES 1
+#define SCENE_FILE_SECTION_FACES 2
+#define SCENE_FILE_NUM_SECTIONS 3
+
+// Sections start and end on this boundary, so each of them can be mapped straight into its arena
+#define SCENE_FILE_SECTION_ALIGNMENT ARENA_COMMIT_GRANULARITY
+
+struct Scene_File_Section
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+// The sections hold the topology arrays exactly as they are in memory.
+// NOTE: Record sizes are stored so that builds with a different layout reject the file instead of misreading it.
+struct Scene_File_Header
+{
+    uint32_t magic;
+    uint32_t version;
+
+    uint32_t vertex_size;
+    uint32_t half_edge_size;
+    uint32_t face_size;
+
+    uint32_t num_vertices;
+    uint32_t num_half_edges;
+    uint32_t num_faces;
+
+    // Deleted elements are saved like the live ones, so that indices stay the same
+    uint32_t num_deleted_vertices;
+    uint32_t num_deleted_half_edges;
+    uint32_t num_deleted_faces;
+
+    Scene_File_Section sections[SCENE_FILE_NUM_SECTIONS];
+};
+
+static uint64_t Scene_File_AlignSize(uint64_t size)
+{
+    return (size + SCENE_FILE_SECTION_ALIGNMENT - 1) & ~(SCENE_FILE_SECTION_ALIGNMENT - 1);
+}
+
+static bool32_t Scene_File_WritePadding(FILE* file, uint64_t size)
+{
+    static const uint8_t zeros[SCENE_FILE_SECTION_ALIGNMENT] = {};
+
+    uint64_t padding_size = Scene_File_AlignSize(size) - size;
+
+    return padding_size == 0 || fwrite(zeros, 1, padding_size, file) == padding_size;
+}
+
+// Sections of a snapshot are read a chunk at a time, so that the scene can keep changing the parts that are written already
+static bool32_t Scene_File_WriteSection(FILE* file, const Scene_Snapshot* snapshot, uint32_t array, const void* data, uint64_t size)
+{
+    if (!snapshot)
+        return (size == 0 || fwrite(data, 1, size, file) == size) && Scene_File_WritePadding(file, size);
+
+    uint8_t buffer[SCENE_SNAPSHOT_CHUNK_SIZE];
+
+    for (uint64_t offset = 0; offset < size; offset += SCENE_SNAPSHOT_CHUNK_SIZE)
+    {
+        uint64_t piece_size = (size - offset < SCENE_SNAPSHOT_CHUNK_SIZE) ? size - offset : SCENE_SNAPSHOT_CHUNK_SIZE;
+
+        Scene_Snapshot_ReadRange(snapshot, array, offset, piece_size, buffer);
+
+        if (fwrite(buffer, 1, piece_size, file) != piece_size)
+            return FALSE;
+    }
+
+    return Scene_File_WritePadding(file, size);
+}
+
+// Writes either the arrays of the scene or the snapshot, whichever is given
+static bool32_t Scene_File_Write(const Scene* scene, const Scene_Snapshot* snapshot, const char* path)
+{
+    Scene_File_Header header = {};
+    header.magic          = SCENE_FILE_MAGIC;
+    header.version        = SCENE_FILE_VERSION;
+    header.vertex_size    = sizeof(Scene_Vertex);
+    header.half_edge_size = sizeof(Scene_HalfEdge);
+    header.face_size      = sizeof(Scene_Face);
+    header.num_vertices   = snapshot ? snapshot->num_vertices : scene->num_vertices;
+    header.num_half_edges = snapshot ? snapshot->num_half_edges : scene->num_half_edges;
+    header.num_faces      = snapshot ? snapshot->num_faces : scene->num_faces;
+
+    header.num_deleted_vertices   = snapshot ? snapshot->num_deleted_vertices : scene->num_deleted_vertices;
+    header.num_deleted_half_edges = snapshot ? snapshot->num_deleted_half_edges : scene->num_deleted_half_edges;
+    header.num_deleted_faces      = snapshot ? snapshot->num_deleted_faces : scene->num_deleted_faces;
+
+    const void* section_data[SCENE_FILE_NUM_SECTIONS] = {};
+    uint32_t section_arrays[SCENE_FILE_NUM_SECTIONS];
+
+    if (scene)
+    {
+        section_data[SCENE_FILE_SECTION_VERTICES]   = scene->vertices;
+        section_data[SCENE_FILE_SECTION_HALF_EDGES] = scene->half_edges;
+        section_data[SCENE_FILE_SECTION_FACES]      = scene->faces;
+    }
+
+    section_arrays[SCENE_FILE_SECTION_VERTICES]   = SCENE_SNAPSHOT_ARRAY_VERTICES;
+    section_arrays[SCENE_FILE_SECTION_HALF_EDGES] = SCENE_SNAPSHOT_ARRAY_HALF_EDGES;
+    section_arrays[SCENE_FILE_SECTION_FACES]      = SCENE_SNAPSHOT_ARRAY_FACES;
+
+    header.sections[SCENE_FILE_SECTION_VERTICES].size   = (uint64_t)header.num_vertices * sizeof(Scene_Vertex);
+    header.sections[SCENE_FILE_SECTION_HALF_EDGES].size = (uint64_t)header.num_half_edges * sizeof(Scene_HalfEdge);
+    header.sections[SCENE_FILE_SECTION_FACES].size      = (uint64_t)header.num_faces * sizeof(Scene_Face);
+
+    uint64_t offset = Scene_File_AlignSize(sizeof(Scene_File_Header));
+
+    for (uint32_t i = 0; i < SCENE_FILE_NUM_SECTIONS; ++i)
+    {
+        header.sections[i].offset = offset;
+        offset += Scene_File_AlignSize(header.sections[i].size);
+    }
+
+    // NOTE: A loaded scene may still map the old file, so it is only replaced once the new one was written completely
+    char temporary_path[4096];
+    if (snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path) >= (int)sizeof(temporary_path))
+        return FALSE;
+
+    FILE* file = fopen(temporary_path, "wb");
+    if (!file)
+        return FALSE;
+
+    // Everything is written front to back in one pass
+    bool32_t write_result = fwrite(&header, sizeof(header), 1, file) == 1 && Scene_File_WritePadding(file, sizeof(header));
+
+    for (uint32_t i = 0; i < SCENE_FILE_NUM_SECTIONS && write_result; ++i)
+        write_result = Scene_File_WriteSection(file, snapshot, section_arrays[i], section_data[i], header.sections[i].size);
+
+    write_result = (fclose(file) == 0) && write_result;
+
+#if defined(_WIN32)
+    // Windows does not rename onto existing files
+    if (write_result)
+        remove(path);
+#endif
+
+    if (!write_result || rename(temporary_path, path) != 0)
+    {
+        remove(temporary_path);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+bool32_t Scene_Save(Scene* scene, const char* path)
+{
+    // The planes are stored with the faces, so they have to be current
+    Scene_UpdateFacePlanes(scene);
+
+    return Scene_File_Write(scene, NULL, path);
+}
+
+bool32_t Scene_Snapshot_Save(const Scene_Snapshot* snapshot, const char* path)
+{
+    // NOTE: Taking the snapshot brought the planes up to date
+    return Scene_File_Write(NULL, snapshot, path);
+}
+
+bool32_t Scene_Load(Scene* scene, const char* path)
+{
+    Scene_File_Header header;
+
+    FILE* file = fopen(path, "rb");
+    if (!file)
+        return FALSE;
+
+    bool32_t read_result = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+
+    if (!read_result ||
+        header.magic != SCENE_FILE_MAGIC ||
+        header.version != SCENE_FILE_VERSION ||
+        header.vertex_size != sizeof(Scene_Vertex) ||
+        header.half_edge_size != sizeof(Scene_HalfEdge) ||
+        header.face_size != sizeof(Scene_Face) ||
+        header.num_vertices > SCENE_MAX_NUM_VERTICES ||
+        header.num_half_edges > SCENE_MAX_NUM_HALF_EDGES ||
+        header.num_faces > SCENE_MAX_NUM_FACES ||
+        header.num_deleted_vertices > header.num_vertices ||
+        header.num_deleted_half_edges > header.num_half_edges ||
+        header.num_deleted_faces > header.num_faces ||
+        header.sections[SCENE_FILE_SECTION_VERTICES].size != (uint64_t)header.num_vertices * sizeof(Scene_Vertex) ||
+        header.sections[SCENE_FILE_SECTION_HALF_EDGES].size != (uint64_t)header.num_half_edges * sizeof(Scene_HalfEdge) ||
+        header.sections[SCENE_FILE_SECTION_FACES].size != (uint64_t)header.num_faces * sizeof(Scene_Face))
+    {
+        return FALSE;
+    }
+
+    if (!Scene_Init(scene))
+        return FALSE;
+
+    // NOTE: Indices are used as they are, the file is trusted to hold a valid mesh
+    Arena* section_arenas[SCENE_FILE_NUM_SECTIONS];
+    section_arenas[SCENE_FILE_SECTION_VERTICES]   = &scene->vertex_arena;
+    section_arenas[SCENE_FILE_SECTION_HALF_EDGES] = &scene->half_edge_arena;
+    section_arenas[SCENE_FILE_SECTION_FACES]      = &scene->face_arena;
+
+    for (uint32_t i = 0; i < SCENE_FILE_NUM_SECTIONS; ++i)
+    {
+        if ((header.sections[i].offset & (SCENE_FILE_SECTION_ALIGNMENT - 1)) != 0 ||
+            !Arena_MapFile(section_arenas[i], path, header.sections[i].offset, header.sections[i].size))
+        {
+            Scene_Destroy(scene);
+            return FALSE;
+        }
+    }
+
+    scene->num_vertices   = header.num_vertices;
+    scene->num_half_edges = header.num_half_edges;
+    scene->num_faces      = header.num_faces;
+
+    scene->num_deleted_vertices   = header.num_deleted_vertices;
+    scene->num_deleted_half_edges = header.num_deleted_half_edges;
+    scene->num_deleted_faces      = header.num_deleted_faces;
+
+    if (scene->num_deleted_vertices > 0 || scene->num_deleted_faces > 0)
+        Scene_RebuildFreeLists(scene);
+
+    return TRUE;
+}
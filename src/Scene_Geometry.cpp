@@ -0,0 +1,718 @@
+#include "Scene.hpp"
+#include "Jobs.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool32_t Scene_Geometry_Init(Scene_Geometry* geometry)
+{
+    memset(geometry, 0, sizeof(Scene_Geometry));
+
+    // NOTE: A face can be dirty only once, and every run holds at least one face
+    if (!Arena_CreateReserved(&geometry->flag_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(bool32_t)) ||
+        !Arena_CreateReserved(&geometry->dirty_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&geometry->run_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(Scene_Geometry_Run)) ||
+        !Arena_CreateReserved(&geometry->triangle_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * 3 * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&geometry->stale_flag_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(bool32_t)) ||
+        !Arena_CreateReserved(&geometry->stale_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(uint32_t)))
+    {
+        Scene_Geometry_Destroy(geometry);
+        return FALSE;
+    }
+
+    geometry->face_dirty_flags   = (bool32_t*)geometry->flag_arena.memory;
+    geometry->dirty_face_indices = (uint32_t*)geometry->dirty_arena.memory;
+    geometry->runs               = (Scene_Geometry_Run*)geometry->run_arena.memory;
+
+    geometry->triangle_indices               = (uint32_t*)geometry->triangle_arena.memory;
+    geometry->face_triangulation_stale_flags = (bool32_t*)geometry->stale_flag_arena.memory;
+    geometry->stale_face_indices             = (uint32_t*)geometry->stale_arena.memory;
+
+    return TRUE;
+}
+
+void Scene_Geometry_Destroy(Scene_Geometry* geometry)
+{
+    Arena_Destroy(&geometry->stale_arena);
+    Arena_Destroy(&geometry->stale_flag_arena);
+    Arena_Destroy(&geometry->triangle_arena);
+    Arena_Destroy(&geometry->run_arena);
+    Arena_Destroy(&geometry->dirty_arena);
+    Arena_Destroy(&geometry->flag_arena);
+
+    memset(geometry, 0, sizeof(Scene_Geometry));
+}
+
+void Scene_Geometry_MarkFaceDirty(Scene* scene, uint32_t face_index)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    // Faces that were never triangulated get their triangles with the new faces
+    if (face_index < geometry->num_triangulated_faces && !geometry->face_triangulation_stale_flags[face_index])
+    {
+        geometry->face_triangulation_stale_flags[face_index] = TRUE;
+        geometry->stale_face_indices[geometry->num_stale_faces++] = face_index;
+    }
+
+    Scene_Geometry_MarkFaceForUpload(scene, face_index);
+}
+
+void Scene_Geometry_MarkFaceForUpload(Scene* scene, uint32_t face_index)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    // Faces that were never uploaded are picked up with the new faces
+    if (face_index >= geometry->num_uploaded_faces || geometry->face_dirty_flags[face_index])
+        return;
+
+    geometry->face_dirty_flags[face_index] = TRUE;
+    geometry->dirty_face_indices[geometry->num_dirty_faces++] = face_index;
+}
+
+static int Scene_Geometry_CompareFaceIndices(const void* a, const void* b)
+{
+    uint32_t face_index_a = *(const uint32_t*)a;
+    uint32_t face_index_b = *(const uint32_t*)b;
+
+    return (face_index_a > face_index_b) - (face_index_a < face_index_b);
+}
+
+static void Scene_Geometry_PushFaces(Scene* scene, uint32_t first_face, uint32_t num_faces)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    if (geometry->num_runs > 0)
+    {
+        Scene_Geometry_Run* last_run = geometry->runs + geometry->num_runs - 1;
+
+        if (last_run->first_face + last_run->num_faces == first_face)
+        {
+            last_run->num_faces += num_faces;
+            return;
+        }
+    }
+
+    Scene_Geometry_Run* run = ARENA_ALLOCATE_ARRAY(&geometry->run_arena, Scene_Geometry_Run, 1);
+    ASSERT(run == geometry->runs + geometry->num_runs);
+
+    run->first_face = first_face;
+    run->num_faces  = num_faces;
+
+    ++geometry->num_runs;
+}
+
+uint32_t Scene_Geometry_CollectDirtyRuns(Scene* scene)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    // Normals and triangles of moved faces have to be current before they are written
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    Arena_Reset(&geometry->run_arena);
+    geometry->num_runs = 0;
+
+    qsort(geometry->dirty_face_indices, geometry->num_dirty_faces, sizeof(uint32_t), Scene_Geometry_CompareFaceIndices);
+
+    for (uint32_t i = 0; i < geometry->num_dirty_faces; ++i)
+        Scene_Geometry_PushFaces(scene, geometry->dirty_face_indices[i], 1);
+
+    if (geometry->num_uploaded_faces < scene->num_faces)
+        Scene_Geometry_PushFaces(scene, geometry->num_uploaded_faces, scene->num_faces - geometry->num_uploaded_faces);
+
+    for (uint32_t i = 0; i < geometry->num_runs; ++i)
+    {
+        Scene_Geometry_Run* run = geometry->runs + i;
+
+        uint32_t end_face = run->first_face + run->num_faces;
+
+        run->first_vertex = Scene_Face_GetFirstGeometryVertex(scene, run->first_face);
+        run->first_index  = Scene_Face_GetFirstGeometryIndex(scene, run->first_face);
+
+        uint32_t end_vertex = (end_face < scene->num_faces) ? Scene_Face_GetFirstGeometryVertex(scene, end_face) : Scene_GetNumGeometryVertices(scene);
+        uint32_t end_index  = (end_face < scene->num_faces) ? Scene_Face_GetFirstGeometryIndex(scene, end_face) : Scene_GetNumGeometryIndices(scene);
+
+        run->num_vertices = end_vertex - run->first_vertex;
+        run->num_indices  = end_index - run->first_index;
+    }
+
+    return geometry->num_runs;
+}
+
+// Working memory for the triangulation of one face, with one element per corner in every array
+struct Scene_Geometry_TriangulationScratch
+{
+    glm::vec2* points;
+    uint32_t*  prev_corners;
+    uint32_t*  next_corners;
+    bool32_t*  reflex_flags;
+};
+
+// Twice the signed area of the triangle, positive when it turns counterclockwise
+static float Scene_Geometry_Cross(glm::vec2 a, glm::vec2 b, glm::vec2 c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static bool32_t Scene_Geometry_IsPointInTriangle(glm::vec2 point, glm::vec2 a, glm::vec2 b, glm::vec2 c)
+{
+    // Corners that coincide with the point do not block an ear, faces can touch themselves at a corner
+    if (point == a || point == b || point == c)
+        return FALSE;
+
+    return
+        Scene_Geometry_Cross(a, b, point) >= 0.0f &&
+        Scene_Geometry_Cross(b, c, point) >= 0.0f &&
+        Scene_Geometry_Cross(c, a, point) >= 0.0f;
+}
+
+static void Scene_Geometry_TriangulateFace(Scene* scene, uint32_t face_index, const Scene_Geometry_TriangulationScratch* scratch)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    uint32_t num_corners = face->num_half_edges;
+    uint32_t first_vertex = Scene_Face_GetFirstGeometryVertex(scene, face_index);
+    uint32_t* indices = scene->geometry.triangle_indices + Scene_Face_GetFirstGeometryIndex(scene, face_index);
+
+    // Deleted faces keep their range until it is compacted, with triangles that cover nothing
+    if (Scene_Face_IsDeleted(scene, face_index))
+    {
+        for (uint32_t i = 0; i < 3 * (num_corners - 2); ++i)
+            indices[i] = first_vertex;
+
+        return;
+    }
+
+    // Corners are projected onto the plane of the face relative to the first one, so that bent faces are clipped the way
+    // they are seen along their normal
+    glm::vec3 normal = face->normal;
+    glm::vec3 tangent = (fabsf(normal.x) > fabsf(normal.z)) ? glm::vec3(-normal.y, normal.x, 0.0f) : glm::vec3(0.0f, -normal.z, normal.y);
+    tangent = glm::normalize(tangent);
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+
+    glm::vec3 quad_positions[4];
+    glm::vec3 origin = scene->vertices[scene->half_edges[face->first_half_edge].origin_vertex].position;
+
+    uint32_t half_edge_index = face->first_half_edge;
+
+    for (uint32_t corner = 0; corner < num_corners; ++corner)
+    {
+        const Scene_HalfEdge* half_edge = scene->half_edges + half_edge_index;
+        glm::vec3 position = scene->vertices[half_edge->origin_vertex].position - origin;
+
+        if (corner < 4)
+            quad_positions[corner] = position;
+
+        scratch->points[corner] = { glm::dot(position, tangent), glm::dot(position, bitangent) };
+        half_edge_index = half_edge->next_half_edge;
+    }
+
+    uint32_t num_reflex_corners = 0;
+
+    for (uint32_t corner = 0; corner < num_corners; ++corner)
+    {
+        uint32_t prev_corner = (corner + num_corners - 1) % num_corners;
+        uint32_t next_corner = (corner + 1) % num_corners;
+
+        // NOTE: Degenerate faces have no normal, the NaNs make every corner convex and the face a fan
+        scratch->prev_corners[corner] = prev_corner;
+        scratch->next_corners[corner] = next_corner;
+        scratch->reflex_flags[corner] = Scene_Geometry_Cross(scratch->points[prev_corner], scratch->points[corner], scratch->points[next_corner]) < 0.0f;
+
+        num_reflex_corners += scratch->reflex_flags[corner];
+    }
+
+    if (num_reflex_corners == 0)
+    {
+        // Quads that are bent are folded along the shorter diagonal, which keeps them closer to both planes
+        uint32_t first_corner = 0;
+
+        if (num_corners == 4 &&
+            glm::dot(quad_positions[3] - quad_positions[1], quad_positions[3] - quad_positions[1]) <
+            glm::dot(quad_positions[2] - quad_positions[0], quad_positions[2] - quad_positions[0]))
+        {
+            first_corner = 1;
+        }
+
+        for (uint32_t i = 2; i < num_corners; ++i)
+        {
+            *indices++ = first_vertex + first_corner;
+            *indices++ = first_vertex + (first_corner + i - 1) % num_corners;
+            *indices++ = first_vertex + (first_corner + i) % num_corners;
+        }
+
+        return;
+    }
+
+    // Ear clipping, an ear is a convex corner whose triangle contains no reflex corner
+    uint32_t num_remaining_corners = num_corners;
+    uint32_t num_rejected_corners = 0;
+    uint32_t corner = 0;
+
+    while (num_remaining_corners > 3)
+    {
+        uint32_t prev_corner = scratch->prev_corners[corner];
+        uint32_t next_corner = scratch->next_corners[corner];
+
+        glm::vec2 a = scratch->points[prev_corner];
+        glm::vec2 b = scratch->points[corner];
+        glm::vec2 c = scratch->points[next_corner];
+
+        bool32_t is_ear = !scratch->reflex_flags[corner] && Scene_Geometry_Cross(a, b, c) > 0.0f;
+
+        for (uint32_t other_corner = scratch->next_corners[next_corner]; is_ear && other_corner != prev_corner; other_corner = scratch->next_corners[other_corner])
+        {
+            if (scratch->reflex_flags[other_corner] && Scene_Geometry_IsPointInTriangle(scratch->points[other_corner], a, b, c))
+                is_ear = FALSE;
+        }
+
+        // NOTE: Self-intersecting faces can run out of ears, then the corner is clipped after a whole round without one
+        if (!is_ear && num_rejected_corners < num_remaining_corners)
+        {
+            ++num_rejected_corners;
+            corner = next_corner;
+            continue;
+        }
+
+        *indices++ = first_vertex + prev_corner;
+        *indices++ = first_vertex + corner;
+        *indices++ = first_vertex + next_corner;
+
+        scratch->next_corners[prev_corner] = next_corner;
+        scratch->prev_corners[next_corner] = prev_corner;
+
+        scratch->reflex_flags[prev_corner] = Scene_Geometry_Cross(scratch->points[scratch->prev_corners[prev_corner]], a, c) < 0.0f;
+        scratch->reflex_flags[next_corner] = Scene_Geometry_Cross(a, c, scratch->points[scratch->next_corners[next_corner]]) < 0.0f;
+
+        --num_remaining_corners;
+        num_rejected_corners = 0;
+        corner = next_corner;
+    }
+
+    *indices++ = first_vertex + scratch->prev_corners[corner];
+    *indices++ = first_vertex + corner;
+    *indices++ = first_vertex + scratch->next_corners[corner];
+}
+
+struct Scene_Geometry_TriangulationBatch
+{
+    Scene*          scene;
+    const uint32_t* face_indices; // NULL for the faces from first_face on
+    uint32_t        first_face;
+};
+
+static uint32_t Scene_Geometry_GetBatchFace(const Scene_Geometry_TriangulationBatch* batch, uint32_t i)
+{
+    return batch->face_indices ? batch->face_indices[i] : batch->first_face + i;
+}
+
+static void Scene_Geometry_TriangulateTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Scene_Geometry_TriangulationBatch* batch = (const Scene_Geometry_TriangulationBatch*)user_data;
+
+    glm::vec2 points[SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS];
+    uint32_t  prev_corners[SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS];
+    uint32_t  next_corners[SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS];
+    bool32_t  reflex_flags[SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS];
+
+    Scene_Geometry_TriangulationScratch scratch = { points, prev_corners, next_corners, reflex_flags };
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        uint32_t face_index = Scene_Geometry_GetBatchFace(batch, i);
+
+        if (batch->scene->faces[face_index].num_half_edges <= SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS)
+            Scene_Geometry_TriangulateFace(batch->scene, face_index, &scratch);
+    }
+}
+
+static void Scene_Geometry_TriangulateBatch(const Scene_Geometry_TriangulationBatch* batch, uint32_t num_faces)
+{
+    Scene* scene = batch->scene;
+
+    Jobs_ParallelFor(num_faces, SCENE_GEOMETRY_TRIANGULATION_NUM_FACES_PER_TASK, Scene_Geometry_TriangulateTask, (void*)batch);
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        uint32_t face_index = Scene_Geometry_GetBatchFace(batch, i);
+        uint32_t num_corners = scene->faces[face_index].num_half_edges;
+
+        if (num_corners <= SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS)
+            continue;
+
+        uint64_t scratch_offset = scene->scratch_arena.offset;
+
+        Scene_Geometry_TriangulationScratch scratch;
+        scratch.points       = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, glm::vec2, num_corners);
+        scratch.prev_corners = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, num_corners);
+        scratch.next_corners = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, num_corners);
+        scratch.reflex_flags = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, bool32_t, num_corners);
+
+        ASSERT(scratch.points && scratch.prev_corners && scratch.next_corners && scratch.reflex_flags);
+
+        Scene_Geometry_TriangulateFace(scene, face_index, &scratch);
+
+        Arena_Rewind(&scene->scratch_arena, scratch_offset);
+    }
+}
+
+void Scene_Geometry_UpdateTriangulations(Scene* scene)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    // Faces are triangulated in their planes
+    Scene_UpdateFacePlanes(scene);
+
+    ASSERT(geometry->num_triangulated_faces <= scene->num_faces);
+
+    uint32_t first_new_face = geometry->num_triangulated_faces;
+    uint32_t num_new_faces = scene->num_faces - first_new_face;
+
+    if (num_new_faces > 0)
+    {
+        uint32_t first_new_index = Scene_Face_GetFirstGeometryIndex(scene, first_new_face);
+
+        uint32_t* new_indices = ARENA_ALLOCATE_ARRAY(&geometry->triangle_arena, uint32_t, Scene_GetNumGeometryIndices(scene) - first_new_index);
+        bool32_t* new_flags = ARENA_ALLOCATE_ARRAY(&geometry->stale_flag_arena, bool32_t, num_new_faces);
+        uint32_t* new_stale_face_indices = ARENA_ALLOCATE_ARRAY(&geometry->stale_arena, uint32_t, num_new_faces);
+
+        ASSERT(new_indices == geometry->triangle_indices + first_new_index);
+        ASSERT(new_flags == geometry->face_triangulation_stale_flags + first_new_face);
+        ASSERT(new_stale_face_indices == geometry->stale_face_indices + first_new_face);
+        UNUSED(new_indices);
+        UNUSED(new_stale_face_indices);
+
+        memset(new_flags, 0, num_new_faces * sizeof(bool32_t));
+    }
+
+    // Every face writes only its own range of the triangles
+    Scene_Geometry_TriangulationBatch batch = { scene, geometry->stale_face_indices, 0 };
+    Scene_Geometry_TriangulateBatch(&batch, geometry->num_stale_faces);
+
+    batch.face_indices = NULL;
+    batch.first_face = first_new_face;
+    Scene_Geometry_TriangulateBatch(&batch, num_new_faces);
+
+    for (uint32_t i = 0; i < geometry->num_stale_faces; ++i)
+        geometry->face_triangulation_stale_flags[geometry->stale_face_indices[i]] = FALSE;
+
+    geometry->num_stale_faces = 0;
+    geometry->num_triangulated_faces = scene->num_faces;
+}
+
+// Every range of consecutive faces starts at the offsets of its first face in both buffers, which the half-edge numbering
+// gives without any counting (see Scene_Face_GetFirstGeometryVertex/Index)
+static uint32_t Scene_Geometry_GetEndIndex(const Scene* scene, uint32_t end_face)
+{
+    return (end_face < scene->num_faces) ? Scene_Face_GetFirstGeometryIndex(scene, end_face) : Scene_GetNumGeometryIndices(scene);
+}
+
+static void Scene_Geometry_PackPosition(glm::vec3 position, SPackedVertex* packed_vertex)
+{
+    // NOTE: Positions outside of the packed space are clamped to its border
+    const float max_step = GEOMETRY_PACKED_POSITION_NUM_CHUNKS_PER_AXIS * 32768.0f;
+
+    uint32_t chunk = 0;
+
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        // Rounded away from zero by truncation, the offset to the corner of the packed space is added afterwards so the
+        // large values do not cost precision
+        float step = position[axis] * GEOMETRY_PACKED_POSITION_STEPS_PER_UNIT;
+        step = (step > -max_step) ? ((step < max_step - 1.0f) ? step : max_step - 1.0f) : -max_step;
+
+        uint32_t fixed_position = (uint32_t)((int32_t)(step + ((step >= 0.0f) ? 0.5f : -0.5f)) + (int32_t)max_step);
+
+        packed_vertex->position[axis] = (uint16_t)(fixed_position & 0xFFFF);
+        chunk |= (fixed_position >> 16) << (5 * axis);
+    }
+
+    packed_vertex->chunk = (uint16_t)chunk;
+}
+
+static void Scene_Geometry_PackNormal(glm::vec3 normal, SPackedVertex* packed_vertex)
+{
+    // Projected onto the octahedron, whose lower half is folded over the upper one
+    float inverse_length = 1.0f / (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+    glm::vec2 encoded = glm::vec2(normal.x, normal.y) * inverse_length;
+
+    if (normal.z < 0.0f)
+    {
+        encoded = glm::vec2(
+            (1.0f - fabsf(encoded.y)) * ((encoded.x >= 0.0f) ? 1.0f : -1.0f),
+            (1.0f - fabsf(encoded.x)) * ((encoded.y >= 0.0f) ? 1.0f : -1.0f)
+        );
+    }
+
+    // NOTE: Degenerate faces have no normal, NaNs end up as zero
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        float value = glm::clamp(encoded[i], -1.0f, 1.0f) * 32767.0f;
+
+        // Rounded away from zero by truncation, floorf is a library call without SSE4.1
+        packed_vertex->normal[i] = (value == value) ? (int16_t)(value + ((value >= 0.0f) ? 0.5f : -0.5f)) : 0;
+    }
+}
+
+// Exactly one of the vertex arrays is given, depending on the format that is written
+static void Scene_Geometry_WriteFaceRange(
+    const Scene*   scene,
+    uint32_t       first_face,
+    uint32_t       end_face,
+    SVertex*       vertices,
+    SPackedVertex* packed_vertices,
+    uint32_t*      indices
+)
+{
+    uint32_t vertex_index = 0;
+
+    for (uint32_t i = first_face; i < end_face; ++i)
+    {
+        const Scene_Face* current_face = scene->faces + i;
+
+        // NOTE: The half-edges of deleted faces are not linked anymore, their corners are only cleared
+        if (Scene_Face_IsDeleted(scene, i))
+        {
+            for (uint32_t corner = 0; corner < current_face->num_half_edges; ++corner, ++vertex_index)
+            {
+                if (packed_vertices)
+                {
+                    memset(packed_vertices + vertex_index, 0, sizeof(SPackedVertex));
+                }
+                else
+                {
+                    SVertex* geometry_vertex = vertices + vertex_index;
+                    geometry_vertex->position = glm::vec3(0.0f);
+                    geometry_vertex->normal   = glm::vec3(0.0f);
+                    geometry_vertex->color    = glm::vec4(0.0f);
+                    geometry_vertex->cell_ids = glm::uvec3(0);
+                }
+            }
+
+            continue;
+        }
+
+        // Everything but the position is shared by the corners of a face
+        SPackedVertex packed_face_vertex;
+
+        if (packed_vertices)
+        {
+            Scene_Geometry_PackNormal(current_face->normal, &packed_face_vertex);
+
+            for (uint32_t channel = 0; channel < 4; ++channel)
+                packed_face_vertex.color[channel] = (uint8_t)(glm::clamp(current_face->color[channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+            packed_face_vertex.face_id = i;
+        }
+
+        uint32_t half_edge_index = current_face->first_half_edge;
+
+        do
+        {
+            const Scene_HalfEdge* current_half_edge = scene->half_edges + half_edge_index;
+
+            if (packed_vertices)
+            {
+                SPackedVertex* packed_vertex = packed_vertices + vertex_index;
+                *packed_vertex = packed_face_vertex;
+
+                Scene_Geometry_PackPosition(scene->vertices[current_half_edge->origin_vertex].position, packed_vertex);
+                packed_vertex->corner_id = half_edge_index;
+            }
+            else
+            {
+                SVertex* geometry_vertex = vertices + vertex_index;
+                geometry_vertex->position   = scene->vertices[current_half_edge->origin_vertex].position;
+                geometry_vertex->normal     = current_face->normal;
+                geometry_vertex->color      = current_face->color;
+                geometry_vertex->cell_ids.x = current_half_edge->origin_vertex;
+                geometry_vertex->cell_ids.y = half_edge_index;
+                geometry_vertex->cell_ids.z = i;
+            }
+
+            ++vertex_index;
+
+            half_edge_index = current_half_edge->next_half_edge;
+        }
+        while (half_edge_index != current_face->first_half_edge);
+    }
+
+    // Triangles of consecutive faces are consecutive as well, and their indices refer to the whole vertex buffer already
+    uint32_t first_index = Scene_Face_GetFirstGeometryIndex(scene, first_face);
+    uint32_t end_index = Scene_Geometry_GetEndIndex(scene, end_face);
+
+    memcpy(indices, scene->geometry.triangle_indices + first_index, (uint64_t)(end_index - first_index) * sizeof(uint32_t));
+}
+
+struct Scene_Geometry_WriteBatch
+{
+    const Scene*   scene;
+    uint32_t       first_face;
+    SVertex*       vertices;
+    SPackedVertex* packed_vertices;
+    uint32_t*      indices;
+};
+
+static void Scene_Geometry_WriteFacesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    const Scene_Geometry_WriteBatch* batch = (const Scene_Geometry_WriteBatch*)user_data;
+    const Scene* scene = batch->scene;
+
+    uint32_t first_face = batch->first_face + begin;
+
+    // Tasks write disjoint parts of the buffers, so nothing has to be merged afterwards
+    uint32_t vertex_offset = Scene_Face_GetFirstGeometryVertex(scene, first_face) - Scene_Face_GetFirstGeometryVertex(scene, batch->first_face);
+    uint32_t index_offset = Scene_Face_GetFirstGeometryIndex(scene, first_face) - Scene_Face_GetFirstGeometryIndex(scene, batch->first_face);
+
+    Scene_Geometry_WriteFaceRange(
+        scene,
+        first_face,
+        batch->first_face + end,
+        batch->vertices ? batch->vertices + vertex_offset : NULL,
+        batch->packed_vertices ? batch->packed_vertices + vertex_offset : NULL,
+        batch->indices + index_offset
+    );
+}
+
+static void Scene_Geometry_WriteBatchFaces(const Scene_Geometry_WriteBatch* batch, uint32_t num_faces)
+{
+    ASSERT(batch->first_face + num_faces <= batch->scene->geometry.num_triangulated_faces);
+
+    if (num_faces <= SCENE_GEOMETRY_WRITE_NUM_FACES_PER_TASK)
+    {
+        Scene_Geometry_WriteFacesTask((void*)batch, 0, num_faces);
+        return;
+    }
+
+    Jobs_ParallelFor(num_faces, SCENE_GEOMETRY_WRITE_NUM_FACES_PER_TASK, Scene_Geometry_WriteFacesTask, (void*)batch);
+}
+
+void Scene_Geometry_WriteFaces(const Scene* scene, uint32_t first_face, uint32_t num_faces, SVertex* vertices, uint32_t* indices)
+{
+    Scene_Geometry_WriteBatch batch = { scene, first_face, vertices, NULL, indices };
+    Scene_Geometry_WriteBatchFaces(&batch, num_faces);
+}
+
+void Scene_Geometry_WritePackedFaces(const Scene* scene, uint32_t first_face, uint32_t num_faces, SPackedVertex* vertices, uint32_t* indices)
+{
+    Scene_Geometry_WriteBatch batch = { scene, first_face, NULL, vertices, indices };
+    Scene_Geometry_WriteBatchFaces(&batch, num_faces);
+}
+
+void Scene_Geometry_ClearDirty(Scene* scene)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    for (uint32_t i = 0; i < geometry->num_dirty_faces; ++i)
+        geometry->face_dirty_flags[geometry->dirty_face_indices[i]] = FALSE;
+
+    geometry->num_dirty_faces = 0;
+
+    // The tracking arrays only have to cover the faces that were uploaded
+    if (geometry->num_uploaded_faces < scene->num_faces)
+    {
+        uint32_t num_new_faces = scene->num_faces - geometry->num_uploaded_faces;
+
+        bool32_t* new_flags = ARENA_ALLOCATE_ARRAY(&geometry->flag_arena, bool32_t, num_new_faces);
+        uint32_t* new_dirty_face_indices = ARENA_ALLOCATE_ARRAY(&geometry->dirty_arena, uint32_t, num_new_faces);
+
+        ASSERT(new_flags == geometry->face_dirty_flags + geometry->num_uploaded_faces);
+        ASSERT(new_dirty_face_indices == geometry->dirty_face_indices + geometry->num_uploaded_faces);
+        UNUSED(new_dirty_face_indices);
+
+        memset(new_flags, 0, num_new_faces * sizeof(bool32_t));
+
+        geometry->num_uploaded_faces = scene->num_faces;
+    }
+
+    Arena_Reset(&geometry->run_arena);
+    geometry->num_runs = 0;
+}
+
+void Scene_Geometry_RemoveFaces(Scene* scene)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    if (geometry->num_triangulated_faces > scene->num_faces)
+    {
+        uint32_t num_stale_faces = 0;
+
+        for (uint32_t i = 0; i < geometry->num_stale_faces; ++i)
+        {
+            if (geometry->stale_face_indices[i] < scene->num_faces)
+                geometry->stale_face_indices[num_stale_faces++] = geometry->stale_face_indices[i];
+        }
+
+        geometry->num_stale_faces = num_stale_faces;
+        geometry->num_triangulated_faces = scene->num_faces;
+
+        Arena_Rewind(&geometry->triangle_arena, (uint64_t)Scene_GetNumGeometryIndices(scene) * sizeof(uint32_t));
+        Arena_Rewind(&geometry->stale_flag_arena, (uint64_t)scene->num_faces * sizeof(bool32_t));
+        Arena_Rewind(&geometry->stale_arena, (uint64_t)scene->num_faces * sizeof(uint32_t));
+    }
+
+    if (geometry->num_uploaded_faces <= scene->num_faces)
+        return;
+
+    uint32_t num_dirty_faces = 0;
+
+    for (uint32_t i = 0; i < geometry->num_dirty_faces; ++i)
+    {
+        if (geometry->dirty_face_indices[i] < scene->num_faces)
+            geometry->dirty_face_indices[num_dirty_faces++] = geometry->dirty_face_indices[i];
+    }
+
+    geometry->num_dirty_faces = num_dirty_faces;
+
+    // NOTE: Geometry of the removed faces stays in the buffers past the new end, where nothing draws it
+    geometry->num_uploaded_faces = scene->num_faces;
+
+    Arena_Rewind(&geometry->flag_arena, (uint64_t)scene->num_faces * sizeof(bool32_t));
+    Arena_Rewind(&geometry->dirty_arena, (uint64_t)scene->num_faces * sizeof(uint32_t));
+}
+
+void Scene_Geometry_ReorderFaces(Scene* scene, const uint32_t* old_face_indices, const Scene_Face* old_faces, uint32_t num_old_indices)
+{
+    Scene_Geometry* geometry = &scene->geometry;
+
+    ASSERT(geometry->num_triangulated_faces >= scene->num_faces && geometry->num_stale_faces == 0);
+
+    uint64_t scratch_offset = scene->scratch_arena.offset;
+
+    uint32_t* old_triangle_indices = (uint32_t*)Arena_PushRegion(&scene->scratch_arena, geometry->triangle_indices, (uint64_t)num_old_indices * sizeof(uint32_t), alignof(uint32_t));
+    ASSERT(old_triangle_indices || num_old_indices == 0);
+
+    // Corners keep their order within a face, so its triangles only shift by the distance the face moved in the vertices
+    for (uint32_t i = 0; i < scene->num_faces; ++i)
+    {
+        uint32_t old_face_index = old_face_indices[i];
+        const Scene_Face* old_face = old_faces + old_face_index;
+
+        // Same offset as Scene_Face_GetFirstGeometryIndex gives for the face before it moved
+        const uint32_t* old_triangles = old_triangle_indices + 3 * (old_face->first_half_edge - 2 * old_face_index);
+        uint32_t* triangles = geometry->triangle_indices + Scene_Face_GetFirstGeometryIndex(scene, i);
+
+        uint32_t first_vertex = Scene_Face_GetFirstGeometryVertex(scene, i);
+
+        for (uint32_t j = 0; j < 3 * (old_face->num_half_edges - 2); ++j)
+            triangles[j] = old_triangles[j] - old_face->first_half_edge + first_vertex;
+    }
+
+    Arena_Rewind(&scene->scratch_arena, scratch_offset);
+
+    // Deleted faces were dropped, none of the faces that are left is stale
+    geometry->num_triangulated_faces = scene->num_faces;
+
+    Arena_Rewind(&geometry->triangle_arena, (uint64_t)Scene_GetNumGeometryIndices(scene) * sizeof(uint32_t));
+    Arena_Rewind(&geometry->stale_flag_arena, (uint64_t)scene->num_faces * sizeof(bool32_t));
+    Arena_Rewind(&geometry->stale_arena, (uint64_t)scene->num_faces * sizeof(uint32_t));
+
+    // Every face may have moved in the buffers, so all of them are uploaded again like new ones
+    geometry->num_dirty_faces = 0;
+    geometry->num_uploaded_faces = 0;
+    geometry->num_runs = 0;
+
+    Arena_Reset(&geometry->flag_arena);
+    Arena_Reset(&geometry->dirty_arena);
+    Arena_Reset(&geometry->run_arena);
+}
@@ -0,0 +1,112 @@
+#ifndef SCENE_GEOMETRY_HPP_
+#define SCENE_GEOMETRY_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+#include "Geometry.hpp"
+
+// Faces are triangulated across the job threads in tasks of this many faces
+#define SCENE_GEOMETRY_TRIANGULATION_NUM_FACES_PER_TASK 1024
+
+// Geometry of large ranges of faces is written across the job threads in tasks of this many faces
+#define SCENE_GEOMETRY_WRITE_NUM_FACES_PER_TASK 4096
+
+// Faces with more corners are triangulated on the calling thread after the others, in the scratch arena
+#define SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS 64
+
+struct Scene;
+struct Scene_Face;
+
+// Consecutive faces whose render geometry has to be uploaded, with their ranges in the vertex and index buffers
+struct Scene_Geometry_Run
+{
+    uint32_t first_face;
+    uint32_t num_faces;
+
+    uint32_t first_vertex;
+    uint32_t num_vertices;
+
+    uint32_t first_index;
+    uint32_t num_indices;
+};
+
+// Tracks the faces whose render geometry changed since it was last uploaded.
+// NOTE: Geometry vertices follow the half-edges, so every face keeps the same range of the buffers for its whole life.
+struct Scene_Geometry
+{
+    // Every array grows with the faces in its own reserved arena
+    Arena flag_arena;
+    Arena dirty_arena;
+    Arena run_arena;
+
+    bool32_t* face_dirty_flags;
+    uint32_t* dirty_face_indices;
+    uint32_t  num_dirty_faces;
+
+    Scene_Geometry_Run* runs;
+    uint32_t            num_runs;
+
+    // Faces past this one have never been uploaded, so they are dirty without being listed
+    uint32_t num_uploaded_faces;
+
+    // Triangles of every face as indices into the whole vertex buffer, at the range given by Scene_Face_GetFirstGeometryIndex.
+    // A face keeps its triangulation until one of its vertices moves.
+    Arena triangle_arena;
+    Arena stale_flag_arena;
+    Arena stale_arena;
+
+    uint32_t* triangle_indices;
+    bool32_t* face_triangulation_stale_flags;
+    uint32_t* stale_face_indices;
+    uint32_t  num_stale_faces;
+
+    // Faces past this one have not been triangulated yet
+    uint32_t num_triangulated_faces;
+};
+
+// Defined in Scene.hpp, they read the scene
+inline uint32_t Scene_Face_GetFirstGeometryVertex(const Scene* scene, uint32_t face_index);
+inline uint32_t Scene_Face_GetFirstGeometryIndex(const Scene* scene, uint32_t face_index);
+
+// Number of vertices and indices the geometry of all faces needs
+inline uint32_t Scene_GetNumGeometryVertices(const Scene* scene);
+inline uint32_t Scene_GetNumGeometryIndices(const Scene* scene);
+
+bool32_t Scene_Geometry_Init(Scene_Geometry* geometry);
+
+void Scene_Geometry_Destroy(Scene_Geometry* geometry);
+
+void Scene_Geometry_MarkFaceDirty(Scene* scene, uint32_t face_index);
+
+// Uploads the geometry of a face again without triangulating it again, after its triangles were changed in place
+void Scene_Geometry_MarkFaceForUpload(Scene* scene, uint32_t face_index);
+
+// Sorts the dirty faces and the ones added since the last upload into runs of consecutive faces (see Scene_Geometry::runs).
+// Returns the number of runs.
+uint32_t Scene_Geometry_CollectDirtyRuns(Scene* scene);
+
+// Triangulates the faces that were added or had vertices moved since the last update. Convex faces become fans, quads are
+// split along the shorter diagonal, and concave faces are ear clipped in their plane.
+void Scene_Geometry_UpdateTriangulations(Scene* scene);
+
+// Writes the geometry of consecutive faces, vertices and indices point at the range of the first face. Large ranges are split
+// across the job threads, the output is the same either way.
+// NOTE: The indices are copied from the triangulations, which have to be up to date (see Scene_Geometry_UpdateTriangulations)
+void Scene_Geometry_WriteFaces(const Scene* scene, uint32_t first_face, uint32_t num_faces, SVertex* vertices, uint32_t* indices);
+
+// Same as Scene_Geometry_WriteFaces for the packed vertex format. Encoding costs a little more time per vertex than writing
+// the full format, so it only pays off when the upload is bound by bandwidth.
+void Scene_Geometry_WritePackedFaces(const Scene* scene, uint32_t first_face, uint32_t num_faces, SPackedVertex* vertices, uint32_t* indices);
+
+// Has to be called once the collected runs were uploaded
+void Scene_Geometry_ClearDirty(Scene* scene);
+
+// Stops tracking the faces past the end of the scene, after faces were removed from it
+void Scene_Geometry_RemoveFaces(Scene* scene);
+
+// Moves the triangulations along with the faces after Scene_Reorder, old_face_indices gives the old index of every face and
+// num_old_indices the number of triangle indices before deleted faces were dropped.
+// NOTE: The triangulations have to be up to date before the faces are moved
+void Scene_Geometry_ReorderFaces(Scene* scene, const uint32_t* old_face_indices, const Scene_Face* old_faces, uint32_t num_old_indices);
+
+#endif // !SCENE_GEOMETRY_HPP_
@@ -0,0 +1,1258 @@
+#include "Scene.hpp"
+#include "Jobs.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// Bytes of the file that are read and parsed at once, no line or PLY record may be longer
+#define SCENE_IMPORT_CHUNK_SIZE ((uint64_t)1 << 22)
+#define SCENE_IMPORT_NUM_BYTES_PER_TASK ((uint64_t)1 << 16)
+
+// The chunk itself and everything parsed from it, which takes at most a few bytes per byte of the chunk
+#define SCENE_IMPORT_CHUNK_ARENA_CAPACITY (16 * SCENE_IMPORT_CHUNK_SIZE)
+
+// Vertices of the file before welding, triangle soups have several times more than the scene can hold
+#define SCENE_IMPORT_MAX_NUM_INPUT_VERTICES ((uint32_t)1 << 30)
+
+#define SCENE_IMPORT_MIN_WELD_CAPACITY ((uint32_t)1 << 16)
+
+// Faces are collected until they have as many half-edges as the scene (and at least this many), bulk construction walks
+// every earlier half-edge, so this keeps the whole import linear
+#define SCENE_IMPORT_MIN_NUM_PENDING_HALF_EDGES ((uint32_t)1 << 20)
+
+#define SCENE_IMPORT_PLY_TYPE_NONE 0
+#define SCENE_IMPORT_PLY_TYPE_INT8 1
+#define SCENE_IMPORT_PLY_TYPE_UINT8 2
+#define SCENE_IMPORT_PLY_TYPE_INT16 3
+#define SCENE_IMPORT_PLY_TYPE_UINT16 4
+#define SCENE_IMPORT_PLY_TYPE_INT32 5
+#define SCENE_IMPORT_PLY_TYPE_UINT32 6
+#define SCENE_IMPORT_PLY_TYPE_FLOAT32 7
+#define SCENE_IMPORT_PLY_TYPE_FLOAT64 8
+
+#define SCENE_IMPORT_PLY_ELEMENT_OTHER 0
+#define SCENE_IMPORT_PLY_ELEMENT_VERTEX 1
+#define SCENE_IMPORT_PLY_ELEMENT_FACE 2
+
+#define SCENE_IMPORT_PLY_MAX_NUM_ELEMENTS 16
+
+static const uint32_t Scene_Import_PlyTypeSizes[] = { 0, 1, 1, 2, 2, 4, 4, 4, 8 };
+
+struct Scene_Import_WeldSlot
+{
+    float    position[3];
+    uint32_t vertex; // SCENE_ID_NONE for empty slots
+};
+
+// NOTE: Indices of a face follow the ones of the earlier faces of its segment
+struct Scene_Import_ObjFace
+{
+    uint32_t num_indices;
+    uint32_t num_preceding_positions; // Vertices of the segment before the face, relative indices count back from there
+};
+
+// Lines of a chunk that one task parses, every array has room for the most elements that fit into the lines
+struct Scene_Import_ObjSegment
+{
+    const char* begin;
+    const char* end;
+
+    glm::vec3* positions;
+    uint32_t   num_positions;
+
+    int32_t* indices;
+    uint32_t num_indices;
+
+    Scene_Import_ObjFace* faces;
+    uint32_t              num_faces;
+
+    uint32_t num_skipped_faces;
+    bool32_t failed;
+};
+
+struct Scene_Import_PlyElement
+{
+    uint32_t kind;
+    uint32_t count;
+
+    // Size of the scalar properties, lists are only allowed on faces
+    uint32_t scalar_size;
+
+    // Vertex positions
+    uint32_t position_offsets[3];
+    uint32_t position_types[3];
+
+    // Corner list of faces, with the scalar properties split around it
+    uint32_t list_offset;
+    uint32_t list_count_type;
+    uint32_t list_index_type;
+};
+
+struct Scene_Import_PlyVertexBatch
+{
+    const uint8_t*                 records;
+    const Scene_Import_PlyElement* element;
+    bool32_t                       swap_bytes;
+
+    glm::vec3* positions;
+};
+
+struct Scene_Import_State
+{
+    Scene*    scene;
+    FILE*     file;
+    glm::vec4 face_color;
+
+    // Holds the chunk buffer at its start, everything after it is parsed from the current chunk
+    Arena    chunk_arena;
+    uint64_t chunk_arena_base;
+
+    uint8_t* buffer;
+    uint64_t buffer_size;
+    uint64_t num_consumed_bytes; // Bytes at the start of the buffer that were processed already
+    bool32_t is_end_of_file;
+
+    // Scene vertex of every vertex of the file
+    Arena     remap_arena;
+    uint32_t* vertex_remap;
+    uint32_t  num_input_vertices;
+
+    // Open addressing table of the welded positions, it is rebuilt into the other arena when it gets half full
+    Arena                  weld_arenas[2];
+    uint32_t               weld_arena_index;
+    Scene_Import_WeldSlot* weld_slots;
+    uint32_t               weld_capacity;
+
+    // Vertices of the current chunk that did not weld to an earlier one, they are added to the scene in one go
+    Arena      new_vertex_arena;
+    glm::vec3* new_positions;
+    uint32_t   num_new_vertices;
+
+    // Faces waiting for the next bulk construction, in scene vertex indices
+    Arena      pending_index_arena;
+    Arena      pending_face_arena;
+    Arena      pending_color_arena;
+    uint32_t*  pending_indices;
+    uint32_t*  pending_face_num_vertices;
+    glm::vec4* pending_face_colors;
+    uint32_t   num_pending_indices;
+    uint32_t   num_pending_faces;
+
+    Scene_ImportStats stats;
+};
+
+// Number parsing, independent of the locale
+
+static bool32_t Scene_Import_IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* Scene_Import_SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && Scene_Import_IsSpace(*p))
+        ++p;
+
+    return p;
+}
+
+static bool32_t Scene_Import_ParseInt(const char** p_inout, const char* end, int32_t* out_value)
+{
+    const char* p = *p_inout;
+
+    bool32_t is_negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+
+    const char* digits_begin = p;
+    int64_t value = 0;
+
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        value = value * 10 + (*p - '0');
+
+        if (value > INT32_MAX)
+            return FALSE;
+
+        ++p;
+    }
+
+    if (p == digits_begin)
+        return FALSE;
+
+    *out_value = (int32_t)(is_negative ? -value : value);
+    *p_inout = p;
+
+    return TRUE;
+}
+
+// NOTE: Digits past the 19th are dropped, which is far below float precision
+static bool32_t Scene_Import_ParseFloat(const char** p_inout, const char* end, float* out_value)
+{
+    static const double powers_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    const char* p = *p_inout;
+
+    bool32_t is_negative = (p < end && *p == '-');
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+
+    uint64_t mantissa = 0;
+    uint32_t num_digits = 0;
+    uint32_t num_significant_digits = 0;
+    int32_t exponent = 0;
+
+    for (; p < end && *p >= '0' && *p <= '9'; ++p, ++num_digits)
+    {
+        if (num_significant_digits < 19)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            num_significant_digits += (mantissa != 0);
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++num_digits)
+        {
+            if (num_significant_digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                num_significant_digits += (mantissa != 0);
+                --exponent;
+            }
+        }
+    }
+
+    if (num_digits == 0)
+        return FALSE;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        ++p;
+
+        int32_t exponent_value;
+        if (!Scene_Import_ParseInt(&p, end, &exponent_value))
+            return FALSE;
+
+        if (exponent_value > 1000) exponent_value = 1000;
+        if (exponent_value < -1000) exponent_value = -1000;
+
+        exponent += exponent_value;
+    }
+
+    double value = (double)mantissa;
+
+    if (mantissa != 0)
+    {
+        // Powers up to 1e22 are exact, larger ones are applied in steps
+        for (; exponent > 22 && value < 1e300; exponent -= 22) value *= 1e22;
+        for (; exponent < -22 && value > 1e-300; exponent += 22) value /= 1e22;
+
+        if (exponent > 22 || exponent < -22)
+            value = (exponent > 0) ? value * 1e22 : 0.0;
+        else if (exponent >= 0)
+            value *= powers_of_ten[exponent];
+        else
+            value /= powers_of_ten[-exponent];
+    }
+
+    *out_value = (float)(is_negative ? -value : value);
+    *p_inout = p;
+
+    return TRUE;
+}
+
+// Welding
+
+static void Scene_Import_GetPositionBits(glm::vec3 position, uint32_t* out_bits)
+{
+    // Adding zero turns negative zeros into positive ones, so both weld together
+    float components[3] = { position.x + 0.0f, position.y + 0.0f, position.z + 0.0f };
+    memcpy(out_bits, components, sizeof(components));
+}
+
+static uint32_t Scene_Import_HashPosition(const uint32_t* bits)
+{
+    uint32_t hash = bits[0] * 0x8DA6B343u ^ bits[1] * 0xD8163841u ^ bits[2] * 0xCB1AB31Fu;
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+static Scene_Import_WeldSlot* Scene_Import_FindWeldSlot(Scene_Import_WeldSlot* slots, uint32_t capacity, const uint32_t* bits)
+{
+    uint32_t mask = capacity - 1;
+
+    for (uint32_t slot = Scene_Import_HashPosition(bits) & mask; ; slot = (slot + 1) & mask)
+    {
+        Scene_Import_WeldSlot* weld_slot = slots + slot;
+
+        if (weld_slot->vertex == SCENE_ID_NONE || memcmp(weld_slot->position, bits, sizeof(weld_slot->position)) == 0)
+            return weld_slot;
+    }
+}
+
+static bool32_t Scene_Import_GrowWeldTable(Scene_Import_State* state)
+{
+    uint32_t new_capacity = state->weld_capacity ? 2 * state->weld_capacity : SCENE_IMPORT_MIN_WELD_CAPACITY;
+
+    Arena* new_arena = state->weld_arenas + (state->weld_arena_index ^ 1);
+    Arena_Reset(new_arena);
+
+    Scene_Import_WeldSlot* new_slots = ARENA_ALLOCATE_ARRAY(new_arena, Scene_Import_WeldSlot, new_capacity);
+    if (!new_slots)
+        return FALSE;
+
+    memset(new_slots, 0xFF, (uint64_t)new_capacity * sizeof(Scene_Import_WeldSlot));
+
+    for (uint32_t i = 0; i < state->weld_capacity; ++i)
+    {
+        const Scene_Import_WeldSlot* weld_slot = state->weld_slots + i;
+
+        if (weld_slot->vertex != SCENE_ID_NONE)
+            *Scene_Import_FindWeldSlot(new_slots, new_capacity, (const uint32_t*)weld_slot->position) = *weld_slot;
+    }
+
+    state->weld_arena_index ^= 1;
+    state->weld_slots = new_slots;
+    state->weld_capacity = new_capacity;
+
+    return TRUE;
+}
+
+// Maps the next vertices of the file to scene vertices, positions seen before map to the vertex that has them already
+static bool32_t Scene_Import_AddInputVertices(Scene_Import_State* state, const glm::vec3* positions, uint32_t num_positions)
+{
+    Scene* scene = state->scene;
+
+    if (num_positions > SCENE_IMPORT_MAX_NUM_INPUT_VERTICES - state->num_input_vertices)
+        return FALSE;
+
+    uint32_t* remap = ARENA_ALLOCATE_ARRAY(&state->remap_arena, uint32_t, num_positions);
+    if (!remap)
+        return FALSE;
+
+    ASSERT(remap == state->vertex_remap + state->num_input_vertices);
+
+    for (uint32_t i = 0; i < num_positions; ++i)
+    {
+        // Counting the position as new keeps the table at most half full, so probing always ends
+        if ((uint64_t)(state->stats.num_vertices + state->num_new_vertices + 1) * 2 > state->weld_capacity && !Scene_Import_GrowWeldTable(state))
+            return FALSE;
+
+        uint32_t bits[3];
+        Scene_Import_GetPositionBits(positions[i], bits);
+
+        Scene_Import_WeldSlot* weld_slot = Scene_Import_FindWeldSlot(state->weld_slots, state->weld_capacity, bits);
+
+        if (weld_slot->vertex == SCENE_ID_NONE)
+        {
+            if (state->num_new_vertices >= SCENE_MAX_NUM_VERTICES - scene->num_vertices)
+                return FALSE;
+
+            glm::vec3* new_position = ARENA_ALLOCATE_ARRAY(&state->new_vertex_arena, glm::vec3, 1);
+            if (!new_position)
+                return FALSE;
+
+            ASSERT(new_position == state->new_positions + state->num_new_vertices);
+
+            *new_position = positions[i];
+
+            memcpy(weld_slot->position, bits, sizeof(weld_slot->position));
+            weld_slot->vertex = scene->num_vertices + state->num_new_vertices++;
+        }
+
+        remap[i] = weld_slot->vertex;
+    }
+
+    state->num_input_vertices += num_positions;
+    state->stats.num_input_vertices += num_positions;
+
+    return TRUE;
+}
+
+// Face collection
+
+static bool32_t Scene_Import_FlushVertices(Scene_Import_State* state)
+{
+    if (state->num_new_vertices == 0)
+        return TRUE;
+
+    uint32_t first_vertex_index = Scene_AddVertices(state->scene, state->new_positions, state->num_new_vertices);
+    if (first_vertex_index == SCENE_ID_NONE)
+        return FALSE;
+
+    state->stats.num_vertices += state->num_new_vertices;
+
+    Arena_Reset(&state->new_vertex_arena);
+    state->num_new_vertices = 0;
+
+    return TRUE;
+}
+
+static bool32_t Scene_Import_FlushFaces(Scene_Import_State* state)
+{
+    if (state->num_pending_faces == 0)
+        return TRUE;
+
+    // NOTE: Faces may use vertices of the current chunk
+    if (!Scene_Import_FlushVertices(state))
+        return FALSE;
+
+    uint32_t first_face_index = Scene_ConstructFaces(
+        state->scene,
+        state->pending_indices,
+        state->pending_face_num_vertices,
+        state->pending_face_colors,
+        state->num_pending_faces
+    );
+
+    if (first_face_index == SCENE_ID_NONE)
+        return FALSE;
+
+    state->stats.num_faces += state->num_pending_faces;
+
+    Arena_Reset(&state->pending_index_arena);
+    Arena_Reset(&state->pending_face_arena);
+    Arena_Reset(&state->pending_color_arena);
+
+    state->num_pending_indices = 0;
+    state->num_pending_faces = 0;
+
+    return TRUE;
+}
+
+// Returns room for the corners of the next face, which Scene_Import_CommitFace takes over
+static uint32_t* Scene_Import_BeginFace(Scene_Import_State* state, uint32_t num_indices)
+{
+    if (num_indices > SCENE_MAX_NUM_HALF_EDGES - state->num_pending_indices)
+        return NULL;
+
+    uint32_t* indices = ARENA_ALLOCATE_ARRAY(&state->pending_index_arena, uint32_t, num_indices);
+
+    ASSERT(!indices || indices == state->pending_indices + state->num_pending_indices);
+
+    return indices;
+}
+
+// Adds the face that was written after Scene_Import_BeginFace, dropping the corners that welding made repeat
+static bool32_t Scene_Import_CommitFace(Scene_Import_State* state, uint32_t* indices, uint32_t num_indices)
+{
+    uint32_t num_distinct_indices = 0;
+
+    for (uint32_t i = 0; i < num_indices; ++i)
+    {
+        if (num_distinct_indices == 0 || indices[num_distinct_indices - 1] != indices[i])
+            indices[num_distinct_indices++] = indices[i];
+    }
+
+    while (num_distinct_indices > 1 && indices[num_distinct_indices - 1] == indices[0])
+        --num_distinct_indices;
+
+    if (num_distinct_indices < 3)
+    {
+        Arena_Rewind(&state->pending_index_arena, (uint64_t)state->num_pending_indices * sizeof(uint32_t));
+        ++state->stats.num_skipped_faces;
+
+        return TRUE;
+    }
+
+    Arena_Rewind(&state->pending_index_arena, ((uint64_t)state->num_pending_indices + num_distinct_indices) * sizeof(uint32_t));
+
+    uint32_t* face_num_vertices = ARENA_ALLOCATE_ARRAY(&state->pending_face_arena, uint32_t, 1);
+    glm::vec4* face_color = ARENA_ALLOCATE_ARRAY(&state->pending_color_arena, glm::vec4, 1);
+
+    if (!face_num_vertices || !face_color)
+        return FALSE;
+
+    ASSERT(face_num_vertices == state->pending_face_num_vertices + state->num_pending_faces);
+    ASSERT(face_color == state->pending_face_colors + state->num_pending_faces);
+
+    *face_num_vertices = num_distinct_indices;
+    *face_color = state->face_color;
+
+    state->num_pending_indices += num_distinct_indices;
+    ++state->num_pending_faces;
+
+    uint32_t max_num_pending_indices = state->scene->num_half_edges;
+    if (max_num_pending_indices < SCENE_IMPORT_MIN_NUM_PENDING_HALF_EDGES) max_num_pending_indices = SCENE_IMPORT_MIN_NUM_PENDING_HALF_EDGES;
+
+    if (state->num_pending_indices >= max_num_pending_indices || state->num_pending_faces >= SCENE_MAX_NUM_FACES - state->scene->num_faces)
+        return Scene_Import_FlushFaces(state);
+
+    return TRUE;
+}
+
+// Reading
+
+// Drops the consumed bytes and fills the buffer up again, returns FALSE on read errors
+static bool32_t Scene_Import_ReadChunk(Scene_Import_State* state)
+{
+    uint64_t num_remaining_bytes = state->buffer_size - state->num_consumed_bytes;
+
+    memmove(state->buffer, state->buffer + state->num_consumed_bytes, num_remaining_bytes);
+
+    state->buffer_size = num_remaining_bytes;
+    state->num_consumed_bytes = 0;
+
+    if (state->is_end_of_file)
+        return TRUE;
+
+    uint64_t num_requested_bytes = SCENE_IMPORT_CHUNK_SIZE - num_remaining_bytes;
+    uint64_t num_read_bytes = fread(state->buffer + num_remaining_bytes, 1, num_requested_bytes, state->file);
+
+    state->buffer_size += num_read_bytes;
+    state->stats.num_bytes += num_read_bytes;
+
+    if (num_read_bytes < num_requested_bytes)
+    {
+        if (ferror(state->file))
+            return FALSE;
+
+        state->is_end_of_file = TRUE;
+    }
+
+    return TRUE;
+}
+
+// Makes sure that the buffer holds at least this many unconsumed bytes
+static bool32_t Scene_Import_RequireBytes(Scene_Import_State* state, uint64_t num_bytes)
+{
+    if (state->buffer_size - state->num_consumed_bytes >= num_bytes)
+        return TRUE;
+
+    return num_bytes <= SCENE_IMPORT_CHUNK_SIZE &&
+           Scene_Import_ReadChunk(state) &&
+           state->buffer_size >= num_bytes;
+}
+
+// OBJ
+
+static void Scene_Import_ParseObjSegment(Scene_Import_ObjSegment* segment)
+{
+    const char* p = segment->begin;
+    const char* end = segment->end;
+
+    while (p < end)
+    {
+        const char* line_end = (const char*)memchr(p, '\n', end - p);
+        if (!line_end) line_end = end;
+
+        p = Scene_Import_SkipSpaces(p, line_end);
+
+        if (line_end - p >= 2 && p[0] == 'v' && Scene_Import_IsSpace(p[1]))
+        {
+            glm::vec3 position;
+            p += 2;
+
+            // Anything after the position, like vertex colors, is ignored
+            bool32_t parse_result =
+                Scene_Import_ParseFloat(&(p = Scene_Import_SkipSpaces(p, line_end)), line_end, &position.x) &&
+                Scene_Import_ParseFloat(&(p = Scene_Import_SkipSpaces(p, line_end)), line_end, &position.y) &&
+                Scene_Import_ParseFloat(&(p = Scene_Import_SkipSpaces(p, line_end)), line_end, &position.z);
+
+            if (!parse_result)
+            {
+                segment->failed = TRUE;
+                return;
+            }
+
+            segment->positions[segment->num_positions++] = position;
+        }
+        else if (line_end - p >= 2 && p[0] == 'f' && Scene_Import_IsSpace(p[1]))
+        {
+            int32_t* indices = segment->indices + segment->num_indices;
+            uint32_t num_indices = 0;
+
+            for (p += 2; ; )
+            {
+                p = Scene_Import_SkipSpaces(p, line_end);
+                if (p == line_end || *p == '#')
+                    break;
+
+                int32_t index;
+                if (!Scene_Import_ParseInt(&p, line_end, &index) || index == 0)
+                {
+                    segment->failed = TRUE;
+                    return;
+                }
+
+                // Texture coordinate and normal indices are not used
+                while (p < line_end && !Scene_Import_IsSpace(*p))
+                    ++p;
+
+                indices[num_indices++] = index;
+            }
+
+            if (num_indices >= 3)
+            {
+                Scene_Import_ObjFace* face = segment->faces + segment->num_faces++;
+                face->num_indices             = num_indices;
+                face->num_preceding_positions = segment->num_positions;
+
+                segment->num_indices += num_indices;
+            }
+            else
+            {
+                ++segment->num_skipped_faces;
+            }
+        }
+
+        p = line_end + 1;
+    }
+}
+
+static void Scene_Import_ParseObjSegmentsTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Import_ObjSegment* segments = (Scene_Import_ObjSegment*)user_data;
+
+    for (uint32_t i = begin; i < end; ++i)
+        Scene_Import_ParseObjSegment(segments + i);
+}
+
+static bool32_t Scene_Import_ParseObjChunk(Scene_Import_State* state, const char* data, uint64_t size)
+{
+    Arena_Rewind(&state->chunk_arena, state->chunk_arena_base);
+
+    uint32_t num_segments = (uint32_t)((size + SCENE_IMPORT_NUM_BYTES_PER_TASK - 1) / SCENE_IMPORT_NUM_BYTES_PER_TASK);
+
+    Scene_Import_ObjSegment* segments = ARENA_ALLOCATE_ARRAY(&state->chunk_arena, Scene_Import_ObjSegment, num_segments);
+    ASSERT(segments);
+
+    // Segments end after a line break, the shortest vertex and face lines bound how much each of them can hold
+    const char* end = data + size;
+    const char* segment_begin = data;
+
+    uint64_t max_num_positions = 0;
+    uint64_t max_num_indices = 0;
+    uint64_t max_num_faces = 0;
+
+    for (uint32_t i = 0; i < num_segments; ++i)
+    {
+        const char* segment_end = data + (uint64_t)(i + 1) * SCENE_IMPORT_NUM_BYTES_PER_TASK;
+
+        if (segment_end >= end)
+        {
+            segment_end = end;
+        }
+        else if (segment_end <= segment_begin)
+        {
+            segment_end = segment_begin;
+        }
+        else
+        {
+            const char* line_break = (const char*)memchr(segment_end - 1, '\n', end - (segment_end - 1));
+            segment_end = line_break ? line_break + 1 : end;
+        }
+
+        uint64_t segment_size = segment_end - segment_begin;
+
+        Scene_Import_ObjSegment* segment = segments + i;
+        memset(segment, 0, sizeof(Scene_Import_ObjSegment));
+
+        segment->begin = segment_begin;
+        segment->end   = segment_end;
+
+        // NOTE: The arrays are only offsets here, they are placed once the totals are known
+        segment->positions = (glm::vec3*)(uintptr_t)max_num_positions;
+        segment->indices   = (int32_t*)(uintptr_t)max_num_indices;
+        segment->faces     = (Scene_Import_ObjFace*)(uintptr_t)max_num_faces;
+
+        max_num_positions += segment_size / 4 + 1;
+        max_num_indices   += segment_size / 2 + 1;
+        max_num_faces     += segment_size / 4 + 1;
+
+        segment_begin = segment_end;
+    }
+
+    glm::vec3* positions = ARENA_ALLOCATE_ARRAY(&state->chunk_arena, glm::vec3, max_num_positions);
+    int32_t* indices = ARENA_ALLOCATE_ARRAY(&state->chunk_arena, int32_t, max_num_indices);
+    Scene_Import_ObjFace* faces = ARENA_ALLOCATE_ARRAY(&state->chunk_arena, Scene_Import_ObjFace, max_num_faces);
+
+    ASSERT(positions && indices && faces);
+
+    for (uint32_t i = 0; i < num_segments; ++i)
+    {
+        segments[i].positions = positions + (uintptr_t)segments[i].positions;
+        segments[i].indices   = indices + (uintptr_t)segments[i].indices;
+        segments[i].faces     = faces + (uintptr_t)segments[i].faces;
+    }
+
+    Jobs_ParallelFor(num_segments, 1, Scene_Import_ParseObjSegmentsTask, segments);
+
+    // Segments are merged in file order, so the vertex numbering of the file is kept
+    for (uint32_t i = 0; i < num_segments; ++i)
+    {
+        const Scene_Import_ObjSegment* segment = segments + i;
+
+        if (segment->failed)
+            return FALSE;
+
+        uint32_t first_input_vertex = state->num_input_vertices;
+
+        if (!Scene_Import_AddInputVertices(state, segment->positions, segment->num_positions))
+            return FALSE;
+
+        const int32_t* face_indices = segment->indices;
+
+        for (uint32_t j = 0; j < segment->num_faces; ++j)
+        {
+            const Scene_Import_ObjFace* face = segment->faces + j;
+
+            // Faces can only use the vertices above them, negative indices count back from the last of those
+            int64_t num_available_vertices = (int64_t)first_input_vertex + face->num_preceding_positions;
+
+            uint32_t* scene_indices = Scene_Import_BeginFace(state, face->num_indices);
+            if (!scene_indices)
+                return FALSE;
+
+            for (uint32_t k = 0; k < face->num_indices; ++k)
+            {
+                int64_t index = face_indices[k];
+                int64_t input_vertex = (index > 0) ? index - 1 : num_available_vertices + index;
+
+                if (input_vertex < 0 || input_vertex >= num_available_vertices)
+                    return FALSE;
+
+                scene_indices[k] = state->vertex_remap[input_vertex];
+            }
+
+            if (!Scene_Import_CommitFace(state, scene_indices, face->num_indices))
+                return FALSE;
+
+            face_indices += face->num_indices;
+        }
+
+        state->stats.num_skipped_faces += segment->num_skipped_faces;
+    }
+
+    return Scene_Import_FlushVertices(state);
+}
+
+static bool32_t Scene_Import_Obj(Scene_Import_State* state)
+{
+    for (;;)
+    {
+        if (!Scene_Import_ReadChunk(state))
+            return FALSE;
+
+        if (state->buffer_size == 0)
+            return TRUE;
+
+        // Only whole lines are parsed, the rest is kept for the next chunk
+        uint64_t size = state->buffer_size;
+
+        if (!state->is_end_of_file)
+        {
+            while (size > 0 && state->buffer[size - 1] != '\n')
+                --size;
+
+            // A line longer than the whole buffer
+            if (size == 0)
+                return FALSE;
+        }
+
+        if (!Scene_Import_ParseObjChunk(state, (const char*)state->buffer, size))
+            return FALSE;
+
+        state->num_consumed_bytes = size;
+    }
+}
+
+// PLY
+
+static double Scene_Import_ReadPlyScalar(const uint8_t* data, uint32_t type, bool32_t swap_bytes)
+{
+    uint8_t bytes[8];
+    uint32_t size = Scene_Import_PlyTypeSizes[type];
+
+    for (uint32_t i = 0; i < size; ++i)
+        bytes[i] = data[swap_bytes ? size - 1 - i : i];
+
+    switch (type)
+    {
+    case SCENE_IMPORT_PLY_TYPE_INT8:    { int8_t value;   memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_UINT8:   { uint8_t value;  memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_INT16:   { int16_t value;  memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_UINT16:  { uint16_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_INT32:   { int32_t value;  memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_UINT32:  { uint32_t value; memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_FLOAT32: { float value;    memcpy(&value, bytes, sizeof(value)); return value; }
+    case SCENE_IMPORT_PLY_TYPE_FLOAT64: { double value;   memcpy(&value, bytes, sizeof(value)); return value; }
+    }
+
+    UNREACHABLE;
+    return 0.0;
+}
+
+// Splits off the next whitespace separated token of the line
+static bool32_t Scene_Import_NextToken(const char** p_inout, const char* end, const char** out_token, uint32_t* out_length)
+{
+    const char* p = Scene_Import_SkipSpaces(*p_inout, end);
+    const char* token = p;
+
+    while (p < end && !Scene_Import_IsSpace(*p))
+        ++p;
+
+    *out_token = token;
+    *out_length = (uint32_t)(p - token);
+    *p_inout = p;
+
+    return p > token;
+}
+
+static bool32_t Scene_Import_TokenEquals(const char* token, uint32_t length, const char* string)
+{
+    return strlen(string) == length && memcmp(token, string, length) == 0;
+}
+
+static uint32_t Scene_Import_ParsePlyType(const char* token, uint32_t length)
+{
+    static const char* type_names[][2] = {
+        { "", "" },
+        { "char", "int8" },
+        { "uchar", "uint8" },
+        { "short", "int16" },
+        { "ushort", "uint16" },
+        { "int", "int32" },
+        { "uint", "uint32" },
+        { "float", "float32" },
+        { "double", "float64" },
+    };
+
+    for (uint32_t type = SCENE_IMPORT_PLY_TYPE_INT8; type <= SCENE_IMPORT_PLY_TYPE_FLOAT64; ++type)
+    {
+        if (Scene_Import_TokenEquals(token, length, type_names[type][0]) || Scene_Import_TokenEquals(token, length, type_names[type][1]))
+            return type;
+    }
+
+    return SCENE_IMPORT_PLY_TYPE_NONE;
+}
+
+// Reads the elements of the header, returns FALSE for ASCII files and for layouts the importer can not stream
+static bool32_t Scene_Import_ParsePlyHeader(
+    Scene_Import_State*      state,
+    Scene_Import_PlyElement* elements,
+    uint32_t*                out_num_elements,
+    bool32_t*                out_swap_bytes
+)
+{
+    const char* header = (const char*)state->buffer;
+    const char* header_end = NULL;
+
+    for (const char* p = header; p < header + state->buffer_size; )
+    {
+        const char* line_end = (const char*)memchr(p, '\n', header + state->buffer_size - p);
+        if (!line_end)
+            return FALSE;
+
+        if (line_end - p >= 10 && memcmp(p, "end_header", 10) == 0)
+        {
+            header_end = line_end + 1;
+            break;
+        }
+
+        p = line_end + 1;
+    }
+
+    if (!header_end)
+        return FALSE;
+
+    uint16_t endianness_probe = 1;
+    bool32_t is_host_little_endian = (*(const uint8_t*)&endianness_probe == 1);
+
+    uint32_t num_elements = 0;
+    bool32_t has_format = FALSE;
+
+    for (const char* p = header; p < header_end; )
+    {
+        const char* line_end = (const char*)memchr(p, '\n', header_end - p);
+
+        const char* token;
+        uint32_t length;
+
+        if (!Scene_Import_NextToken(&p, line_end, &token, &length))
+        {
+            p = line_end + 1;
+            continue;
+        }
+
+        if (Scene_Import_TokenEquals(token, length, "format"))
+        {
+            Scene_Import_NextToken(&p, line_end, &token, &length);
+
+            if (Scene_Import_TokenEquals(token, length, "binary_little_endian"))
+                *out_swap_bytes = !is_host_little_endian;
+            else if (Scene_Import_TokenEquals(token, length, "binary_big_endian"))
+                *out_swap_bytes = is_host_little_endian;
+            else
+                return FALSE;
+
+            has_format = TRUE;
+        }
+        else if (Scene_Import_TokenEquals(token, length, "element"))
+        {
+            if (num_elements >= SCENE_IMPORT_PLY_MAX_NUM_ELEMENTS)
+                return FALSE;
+
+            Scene_Import_PlyElement* element = elements + num_elements++;
+            memset(element, 0, sizeof(Scene_Import_PlyElement));
+
+            Scene_Import_NextToken(&p, line_end, &token, &length);
+
+            if (Scene_Import_TokenEquals(token, length, "vertex"))
+                element->kind = SCENE_IMPORT_PLY_ELEMENT_VERTEX;
+            else if (Scene_Import_TokenEquals(token, length, "face"))
+                element->kind = SCENE_IMPORT_PLY_ELEMENT_FACE;
+            else
+                element->kind = SCENE_IMPORT_PLY_ELEMENT_OTHER;
+
+            p = Scene_Import_SkipSpaces(p, line_end);
+
+            int32_t count;
+            if (!Scene_Import_ParseInt(&p, line_end, &count) || count < 0)
+                return FALSE;
+
+            element->count = (uint32_t)count;
+            element->list_offset = SCENE_ID_NONE;
+
+            for (uint32_t axis = 0; axis < 3; ++axis)
+                element->position_types[axis] = SCENE_IMPORT_PLY_TYPE_NONE;
+        }
+        else if (Scene_Import_TokenEquals(token, length, "property"))
+        {
+            if (num_elements == 0)
+                return FALSE;
+
+            Scene_Import_PlyElement* element = elements + num_elements - 1;
+
+            Scene_Import_NextToken(&p, line_end, &token, &length);
+
+            if (Scene_Import_TokenEquals(token, length, "list"))
+            {
+                // Only the corner list of faces has a variable size
+                if (element->kind != SCENE_IMPORT_PLY_ELEMENT_FACE || element->list_offset != SCENE_ID_NONE)
+                    return FALSE;
+
+                Scene_Import_NextToken(&p, line_end, &token, &length);
+                element->list_count_type = Scene_Import_ParsePlyType(token, length);
+
+                Scene_Import_NextToken(&p, line_end, &token, &length);
+                element->list_index_type = Scene_Import_ParsePlyType(token, length);
+
+                Scene_Import_NextToken(&p, line_end, &token, &length);
+
+                if (element->list_count_type == SCENE_IMPORT_PLY_TYPE_NONE ||
+                    element->list_count_type == SCENE_IMPORT_PLY_TYPE_FLOAT32 ||
+                    element->list_count_type == SCENE_IMPORT_PLY_TYPE_FLOAT64 ||
+                    element->list_index_type == SCENE_IMPORT_PLY_TYPE_NONE ||
+                    !(Scene_Import_TokenEquals(token, length, "vertex_indices") || Scene_Import_TokenEquals(token, length, "vertex_index")))
+                {
+                    return FALSE;
+                }
+
+                element->list_offset = element->scalar_size;
+            }
+            else
+            {
+                uint32_t type = Scene_Import_ParsePlyType(token, length);
+                if (type == SCENE_IMPORT_PLY_TYPE_NONE)
+                    return FALSE;
+
+                Scene_Import_NextToken(&p, line_end, &token, &length);
+
+                if (element->kind == SCENE_IMPORT_PLY_ELEMENT_VERTEX && length == 1 && token[0] >= 'x' && token[0] <= 'z')
+                {
+                    element->position_offsets[token[0] - 'x'] = element->scalar_size;
+                    element->position_types[token[0] - 'x'] = type;
+                }
+
+                element->scalar_size += Scene_Import_PlyTypeSizes[type];
+            }
+        }
+
+        p = line_end + 1;
+    }
+
+    for (uint32_t i = 0; i < num_elements; ++i)
+    {
+        const Scene_Import_PlyElement* element = elements + i;
+
+        if (element->kind == SCENE_IMPORT_PLY_ELEMENT_VERTEX &&
+            (element->position_types[0] == SCENE_IMPORT_PLY_TYPE_NONE ||
+             element->position_types[1] == SCENE_IMPORT_PLY_TYPE_NONE ||
+             element->position_types[2] == SCENE_IMPORT_PLY_TYPE_NONE))
+        {
+            return FALSE;
+        }
+
+        if (element->kind == SCENE_IMPORT_PLY_ELEMENT_FACE && element->list_offset == SCENE_ID_NONE)
+            return FALSE;
+    }
+
+    *out_num_elements = num_elements;
+    state->num_consumed_bytes = (uint64_t)(header_end - header);
+
+    return has_format;
+}
+
+static void Scene_Import_ReadPlyVerticesTask(void* user_data, uint32_t begin, uint32_t end)
+{
+    Scene_Import_PlyVertexBatch* batch = (Scene_Import_PlyVertexBatch*)user_data;
+    const Scene_Import_PlyElement* element = batch->element;
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const uint8_t* record = batch->records + (uint64_t)i * element->scalar_size;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+            batch->positions[i][axis] = (float)Scene_Import_ReadPlyScalar(record + element->position_offsets[axis], element->position_types[axis], batch->swap_bytes);
+    }
+}
+
+static bool32_t Scene_Import_PlyVertices(Scene_Import_State* state, const Scene_Import_PlyElement* element, bool32_t swap_bytes)
+{
+    for (uint32_t num_remaining = element->count; num_remaining > 0; )
+    {
+        if (!Scene_Import_RequireBytes(state, element->scalar_size))
+            return FALSE;
+
+        uint64_t num_available = (state->buffer_size - state->num_consumed_bytes) / element->scalar_size;
+        uint32_t num_records = (num_available < num_remaining) ? (uint32_t)num_available : num_remaining;
+
+        Arena_Rewind(&state->chunk_arena, state->chunk_arena_base);
+
+        Scene_Import_PlyVertexBatch batch;
+        batch.records    = state->buffer + state->num_consumed_bytes;
+        batch.element    = element;
+        batch.swap_bytes = swap_bytes;
+        batch.positions  = ARENA_ALLOCATE_ARRAY(&state->chunk_arena, glm::vec3, num_records);
+
+        ASSERT(batch.positions);
+
+        uint32_t num_records_per_task = (uint32_t)(SCENE_IMPORT_NUM_BYTES_PER_TASK / element->scalar_size) + 1;
+        Jobs_ParallelFor(num_records, num_records_per_task, Scene_Import_ReadPlyVerticesTask, &batch);
+
+        if (!Scene_Import_AddInputVertices(state, batch.positions, num_records) || !Scene_Import_FlushVertices(state))
+            return FALSE;
+
+        state->num_consumed_bytes += (uint64_t)num_records * element->scalar_size;
+        num_remaining -= num_records;
+    }
+
+    return TRUE;
+}
+
+static bool32_t Scene_Import_PlyFaces(
+    Scene_Import_State*            state,
+    const Scene_Import_PlyElement* element,
+    bool32_t                       swap_bytes,
+    uint32_t                       first_input_vertex,
+    uint32_t                       num_element_vertices
+)
+{
+    uint32_t count_size = Scene_Import_PlyTypeSizes[element->list_count_type];
+    uint32_t index_size = Scene_Import_PlyTypeSizes[element->list_index_type];
+
+    for (uint32_t i = 0; i < element->count; ++i)
+    {
+        if (!Scene_Import_RequireBytes(state, (uint64_t)element->list_offset + count_size))
+            return FALSE;
+
+        const uint8_t* record = state->buffer + state->num_consumed_bytes;
+
+        double count = Scene_Import_ReadPlyScalar(record + element->list_offset, element->list_count_type, swap_bytes);
+        if (count < 0.0 || count > (double)(SCENE_IMPORT_CHUNK_SIZE / 2))
+            return FALSE;
+
+        uint32_t num_indices = (uint32_t)count;
+        uint64_t record_size = (uint64_t)element->scalar_size + count_size + (uint64_t)num_indices * index_size;
+
+        if (!Scene_Import_RequireBytes(state, record_size))
+            return FALSE;
+
+        // Reading more of the file moves the record to the start of the buffer
+        record = state->buffer + state->num_consumed_bytes;
+        state->num_consumed_bytes += record_size;
+
+        if (num_indices < 3)
+        {
+            ++state->stats.num_skipped_faces;
+            continue;
+        }
+
+        uint32_t* scene_indices = Scene_Import_BeginFace(state, num_indices);
+        if (!scene_indices)
+            return FALSE;
+
+        const uint8_t* index_data = record + element->list_offset + count_size;
+
+        for (uint32_t j = 0; j < num_indices; ++j)
+        {
+            double index = Scene_Import_ReadPlyScalar(index_data + (uint64_t)j * index_size, element->list_index_type, swap_bytes);
+
+            if (!(index >= 0.0 && index < (double)num_element_vertices))
+                return FALSE;
+
+            scene_indices[j] = state->vertex_remap[first_input_vertex + (uint32_t)index];
+        }
+
+        if (!Scene_Import_CommitFace(state, scene_indices, num_indices))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static bool32_t Scene_Import_Ply(Scene_Import_State* state)
+{
+    Scene_Import_PlyElement elements[SCENE_IMPORT_PLY_MAX_NUM_ELEMENTS];
+    uint32_t num_elements = 0;
+    bool32_t swap_bytes = FALSE;
+
+    if (!Scene_Import_ParsePlyHeader(state, elements, &num_elements, &swap_bytes))
+        return FALSE;
+
+    // Faces use the vertices of the last vertex element before them
+    uint32_t first_input_vertex = 0;
+    uint32_t num_element_vertices = 0;
+    bool32_t has_vertices = FALSE;
+
+    for (uint32_t i = 0; i < num_elements; ++i)
+    {
+        const Scene_Import_PlyElement* element = elements + i;
+
+        if (element->kind == SCENE_IMPORT_PLY_ELEMENT_VERTEX)
+        {
+            first_input_vertex = state->num_input_vertices;
+            num_element_vertices = element->count;
+            has_vertices = TRUE;
+
+            if (!Scene_Import_PlyVertices(state, element, swap_bytes))
+                return FALSE;
+        }
+        else if (element->kind == SCENE_IMPORT_PLY_ELEMENT_FACE)
+        {
+            if (!has_vertices || !Scene_Import_PlyFaces(state, element, swap_bytes, first_input_vertex, num_element_vertices))
+                return FALSE;
+        }
+        else
+        {
+            // Other elements are skipped record by record
+            for (uint32_t j = 0; j < element->count; ++j)
+            {
+                if (!Scene_Import_RequireBytes(state, element->scalar_size))
+                    return FALSE;
+
+                state->num_consumed_bytes += element->scalar_size;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+// Import
+
+static void Scene_Import_DestroyState(Scene_Import_State* state)
+{
+    Arena_Destroy(&state->pending_color_arena);
+    Arena_Destroy(&state->pending_face_arena);
+    Arena_Destroy(&state->pending_index_arena);
+    Arena_Destroy(&state->new_vertex_arena);
+    Arena_Destroy(&state->weld_arenas[1]);
+    Arena_Destroy(&state->weld_arenas[0]);
+    Arena_Destroy(&state->remap_arena);
+    Arena_Destroy(&state->chunk_arena);
+
+    if (state->file)
+        fclose(state->file);
+}
+
+bool32_t Scene_Import(Scene* scene, const char* path, glm::vec4 face_color, Scene_ImportStats* out_stats)
+{
+    Scene_Import_State state;
+    memset(&state, 0, sizeof(state));
+
+    state.scene      = scene;
+    state.face_color = face_color;
+    state.file       = fopen(path, "rb");
+
+    uint32_t base_num_vertices = scene->num_vertices;
+    uint32_t base_num_half_edges = scene->num_half_edges;
+    uint32_t base_num_faces = scene->num_faces;
+
+    bool32_t import_result =
+        state.file &&
+        Arena_CreateReserved(&state.chunk_arena, SCENE_IMPORT_CHUNK_ARENA_CAPACITY) &&
+        Arena_CreateReserved(&state.remap_arena, (uint64_t)SCENE_IMPORT_MAX_NUM_INPUT_VERTICES * sizeof(uint32_t)) &&
+        Arena_CreateReserved(&state.weld_arenas[0], (uint64_t)2 * SCENE_MAX_NUM_VERTICES * sizeof(Scene_Import_WeldSlot)) &&
+        Arena_CreateReserved(&state.weld_arenas[1], (uint64_t)2 * SCENE_MAX_NUM_VERTICES * sizeof(Scene_Import_WeldSlot)) &&
+        Arena_CreateReserved(&state.new_vertex_arena, (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(glm::vec3)) &&
+        Arena_CreateReserved(&state.pending_index_arena, (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(uint32_t)) &&
+        Arena_CreateReserved(&state.pending_face_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(uint32_t)) &&
+        Arena_CreateReserved(&state.pending_color_arena, (uint64_t)SCENE_MAX_NUM_FACES * sizeof(glm::vec4));
+
+    if (import_result)
+    {
+        state.buffer = ARENA_ALLOCATE_ARRAY(&state.chunk_arena, uint8_t, SCENE_IMPORT_CHUNK_SIZE);
+        state.chunk_arena_base = state.chunk_arena.offset;
+
+        // NOTE: The arrays grow in their own arenas, so they start at the beginning of the reserved memory
+        state.vertex_remap              = (uint32_t*)state.remap_arena.memory;
+        state.new_positions             = (glm::vec3*)state.new_vertex_arena.memory;
+        state.pending_indices           = (uint32_t*)state.pending_index_arena.memory;
+        state.pending_face_num_vertices = (uint32_t*)state.pending_face_arena.memory;
+        state.pending_face_colors       = (glm::vec4*)state.pending_color_arena.memory;
+
+        import_result = state.buffer && Scene_Import_ReadChunk(&state);
+    }
+
+    if (import_result)
+    {
+        bool32_t is_ply = state.buffer_size >= 4 && memcmp(state.buffer, "ply", 3) == 0 && (state.buffer[3] == '\n' || state.buffer[3] == '\r');
+
+        import_result = is_ply ? Scene_Import_Ply(&state) : Scene_Import_Obj(&state);
+        import_result = import_result && Scene_Import_FlushFaces(&state) && Scene_Import_FlushVertices(&state);
+    }
+
+    if (!import_result)
+    {
+        // Imported faces only use imported vertices, so cutting the arrays back leaves the earlier topology untouched
+        scene->num_vertices   = base_num_vertices;
+        scene->num_half_edges = base_num_half_edges;
+        scene->num_faces      = base_num_faces;
+
+        Arena_Rewind(&scene->vertex_arena, (uint64_t)base_num_vertices * sizeof(Scene_Vertex));
+        Arena_Rewind(&scene->half_edge_arena, (uint64_t)base_num_half_edges * sizeof(Scene_HalfEdge));
+        Arena_Rewind(&scene->face_arena, (uint64_t)base_num_faces * sizeof(Scene_Face));
+    }
+
+    state.stats.num_scratch_bytes =
+        state.chunk_arena.committed +
+        state.remap_arena.committed +
+        state.weld_arenas[0].committed +
+        state.weld_arenas[1].committed +
+        state.new_vertex_arena.committed +
+        state.pending_index_arena.committed +
+        state.pending_face_arena.committed +
+        state.pending_color_arena.committed;
+
+    if (out_stats)
+        *out_stats = state.stats;
+
+    Scene_Import_DestroyState(&state);
+
+    return import_result;
+}
@@ -0,0 +1,933 @@
+#include "Scene.hpp"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENE_JOURNAL_RECORD_MOVE_VERTEX 1
+#define SCENE_JOURNAL_RECORD_ADD_VERTEX 2
+#define SCENE_JOURNAL_RECORD_CONSTRUCT_FACE 3
+#define SCENE_JOURNAL_RECORD_DELETE_FACE 4
+#define SCENE_JOURNAL_RECORD_DELETE_VERTEX 5
+
+// Every record is a header, its payload and a footer that repeats the size, so the records can be walked both ways.
+// NOTE: Sizes are multiples of four bytes and include the header and the footer.
+struct Scene_Journal_RecordHeader
+{
+    uint32_t type;
+    uint32_t size;
+};
+
+struct Scene_Journal_MoveVertexRecord
+{
+    uint32_t  vertex;
+    glm::vec3 old_position;
+    glm::vec3 new_position;
+};
+
+// Also used for deleted vertices
+struct Scene_Journal_AddVertexRecord
+{
+    uint32_t  vertex;
+    glm::vec3 position;
+};
+
+// Followed by the vertex indices of the face, also used for deleted faces
+struct Scene_Journal_ConstructFaceRecord
+{
+    uint32_t  face;
+    uint32_t  num_vertices;
+    glm::vec4 color;
+};
+
+bool32_t Scene_Journal_Init(Scene_Journal* journal, uint64_t capacity)
+{
+    ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    memset(journal, 0, sizeof(Scene_Journal));
+
+    if (!Arena_CreateReserved(&journal->arena, capacity + (uint64_t)SCENE_JOURNAL_MAX_NUM_GROUPS * sizeof(uint64_t)) ||
+        !Arena_CreateReserved(&journal->merge_serial_arena, (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(uint32_t)) ||
+        !Arena_CreateReserved(&journal->merge_position_arena, (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(uint64_t)) ||
+        !Arena_CreateReserved(&journal->scratch_arena, capacity) ||
+        !Arena_CreateReserved(&journal->remap_arena, ((uint64_t)SCENE_MAX_NUM_VERTICES + SCENE_MAX_NUM_FACES) * (sizeof(Scene_DefragMove) + 8 * sizeof(uint32_t))))
+    {
+        Scene_Journal_Destroy(journal);
+        return FALSE;
+    }
+
+    journal->group_starts = ARENA_ALLOCATE_ARRAY(&journal->arena, uint64_t, SCENE_JOURNAL_MAX_NUM_GROUPS);
+    journal->buffer       = ARENA_ALLOCATE_ARRAY(&journal->arena, uint8_t, capacity);
+
+    if (!journal->group_starts || !journal->buffer)
+    {
+        Scene_Journal_Destroy(journal);
+        return FALSE;
+    }
+
+    journal->capacity = capacity;
+
+    // NOTE: The arenas only hold their own array, so the arrays start at the beginning of the reserved memory
+    journal->vertex_merge_serials   = (uint32_t*)journal->merge_serial_arena.memory;
+    journal->vertex_merge_positions = (uint64_t*)journal->merge_position_arena.memory;
+
+    Scene_Journal_Clear(journal);
+
+    return TRUE;
+}
+
+void Scene_Journal_Destroy(Scene_Journal* journal)
+{
+    Arena_Destroy(&journal->remap_arena);
+    Arena_Destroy(&journal->scratch_arena);
+    Arena_Destroy(&journal->merge_position_arena);
+    Arena_Destroy(&journal->merge_serial_arena);
+    Arena_Destroy(&journal->arena);
+
+    memset(journal, 0, sizeof(Scene_Journal));
+}
+
+void Scene_Journal_Clear(Scene_Journal* journal)
+{
+    ASSERT(!journal->is_group_open);
+
+    journal->first_group    = 0;
+    journal->current_group  = 0;
+    journal->end_group      = 0;
+    journal->write_position = 0;
+
+    journal->next_virtual_vertex = SCENE_MAX_NUM_VERTICES;
+    journal->next_virtual_face   = SCENE_MAX_NUM_FACES;
+
+    journal->group_starts[0] = 0;
+}
+
+static uint64_t* Scene_Journal_GetGroupStart(Scene_Journal* journal, uint64_t group)
+{
+    return journal->group_starts + group % SCENE_JOURNAL_MAX_NUM_GROUPS;
+}
+
+// Records may wrap around the end of the buffer, so they are copied in up to two pieces
+static void Scene_Journal_Write(Scene_Journal* journal, uint64_t position, const void* data, uint64_t size)
+{
+    uint64_t offset = position & (journal->capacity - 1);
+    uint64_t first_size = (size < journal->capacity - offset) ? size : journal->capacity - offset;
+
+    memcpy(journal->buffer + offset, data, first_size);
+    memcpy(journal->buffer, (const uint8_t*)data + first_size, size - first_size);
+}
+
+static void Scene_Journal_Read(const Scene_Journal* journal, uint64_t position, void* data, uint64_t size)
+{
+    uint64_t offset = position & (journal->capacity - 1);
+    uint64_t first_size = (size < journal->capacity - offset) ? size : journal->capacity - offset;
+
+    memcpy(data, journal->buffer + offset, first_size);
+    memcpy((uint8_t*)data + first_size, journal->buffer, size - first_size);
+}
+
+static void Scene_Journal_OpenGroup(Scene_Journal* journal, bool32_t is_implicit)
+{
+    ASSERT(!journal->is_group_open);
+
+    // New edits take the place of everything that could be redone
+    journal->end_group = journal->current_group;
+    journal->write_position = *Scene_Journal_GetGroupStart(journal, journal->current_group);
+
+    // The table needs the start of every group and the end of the open one
+    if (journal->current_group + 2 - journal->first_group > SCENE_JOURNAL_MAX_NUM_GROUPS)
+        ++journal->first_group;
+
+    // Serials only repeat after four billion groups, the entries that could match again are cleared then
+    if (++journal->group_serial == 0)
+    {
+        memset(journal->vertex_merge_serials, 0, (uint64_t)journal->num_merge_tracked_vertices * sizeof(uint32_t));
+        journal->group_serial = 1;
+    }
+
+    journal->is_group_open        = TRUE;
+    journal->is_group_implicit    = is_implicit;
+    journal->is_group_overflowing = FALSE;
+}
+
+static void Scene_Journal_CloseGroup(Scene_Journal* journal)
+{
+    ASSERT(journal->is_group_open);
+
+    if (journal->is_group_overflowing)
+    {
+        // Steps before the group can not be undone without undoing it first, so the history starts over after it
+        journal->first_group = journal->current_group;
+        *Scene_Journal_GetGroupStart(journal, journal->current_group) = journal->write_position;
+    }
+    else if (journal->write_position != *Scene_Journal_GetGroupStart(journal, journal->current_group))
+    {
+        ++journal->current_group;
+        *Scene_Journal_GetGroupStart(journal, journal->current_group) = journal->write_position;
+    }
+
+    journal->end_group = journal->current_group;
+
+    journal->is_group_open        = FALSE;
+    journal->is_group_implicit    = FALSE;
+    journal->is_group_overflowing = FALSE;
+}
+
+void Scene_Journal_BeginGroup(Scene_Journal* journal)
+{
+    Scene_Journal_OpenGroup(journal, FALSE);
+}
+
+void Scene_Journal_EndGroup(Scene_Journal* journal)
+{
+    ASSERT(!journal->is_group_implicit);
+    Scene_Journal_CloseGroup(journal);
+}
+
+// Opens a group for edits made outside of one
+static void Scene_Journal_BeginEdit(Scene_Journal* journal)
+{
+    if (!journal->is_group_open)
+        Scene_Journal_OpenGroup(journal, TRUE);
+}
+
+static void Scene_Journal_EndEdit(Scene_Journal* journal)
+{
+    if (journal->is_group_implicit)
+        Scene_Journal_CloseGroup(journal);
+}
+
+// Makes room for a record of the given size after the open group, dropping the oldest groups as needed.
+// Returns FALSE when the record is not written because the open group outgrew the buffer.
+static bool32_t Scene_Journal_ReserveRecord(Scene_Journal* journal, uint64_t size)
+{
+    if (journal->is_group_overflowing)
+        return FALSE;
+
+    while (journal->write_position + size - *Scene_Journal_GetGroupStart(journal, journal->first_group) > journal->capacity)
+    {
+        if (journal->first_group == journal->current_group)
+        {
+            journal->is_group_overflowing = TRUE;
+            return FALSE;
+        }
+
+        ++journal->first_group;
+    }
+
+    return TRUE;
+}
+
+static void Scene_Journal_WriteRecord(Scene_Journal* journal, uint32_t type, const void* payload, uint32_t payload_size, const uint32_t* indices, uint32_t num_indices)
+{
+    Scene_Journal_RecordHeader header;
+    header.type = type;
+    header.size = sizeof(Scene_Journal_RecordHeader) + payload_size + num_indices * (uint32_t)sizeof(uint32_t) + (uint32_t)sizeof(uint32_t);
+
+    if (!Scene_Journal_ReserveRecord(journal, header.size))
+        return;
+
+    uint64_t position = journal->write_position;
+
+    Scene_Journal_Write(journal, position, &header, sizeof(header));
+    position += sizeof(header);
+
+    Scene_Journal_Write(journal, position, payload, payload_size);
+    position += payload_size;
+
+    if (num_indices > 0)
+    {
+        Scene_Journal_Write(journal, position, indices, (uint64_t)num_indices * sizeof(uint32_t));
+        position += (uint64_t)num_indices * sizeof(uint32_t);
+    }
+
+    Scene_Journal_Write(journal, position, &header.size, sizeof(header.size));
+    position += sizeof(header.size);
+
+    journal->write_position = position;
+}
+
+uint32_t Scene_Journal_AddVertex(Scene_Journal* journal, Scene* scene, glm::vec3 position)
+{
+    uint32_t vertex_index = Scene_AddVertex(scene, position);
+    if (vertex_index == SCENE_ID_NONE)
+        return SCENE_ID_NONE;
+
+    Scene_Journal_AddVertexRecord record;
+    record.vertex   = vertex_index;
+    record.position = position;
+
+    Scene_Journal_BeginEdit(journal);
+    Scene_Journal_WriteRecord(journal, SCENE_JOURNAL_RECORD_ADD_VERTEX, &record, sizeof(record), NULL, 0);
+    Scene_Journal_EndEdit(journal);
+
+    return vertex_index;
+}
+
+uint32_t Scene_Journal_ConstructFace(Scene_Journal* journal, Scene* scene, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color)
+{
+    uint32_t face_index = Scene_ConstructFace(scene, vertex_indices, num_vertices, color);
+    if (face_index == SCENE_ID_NONE)
+        return SCENE_ID_NONE;
+
+    Scene_Journal_ConstructFaceRecord record;
+    record.face         = face_index;
+    record.num_vertices = num_vertices;
+    record.color        = color;
+
+    Scene_Journal_BeginEdit(journal);
+    Scene_Journal_WriteRecord(journal, SCENE_JOURNAL_RECORD_CONSTRUCT_FACE, &record, sizeof(record), vertex_indices, num_vertices);
+    Scene_Journal_EndEdit(journal);
+
+    return face_index;
+}
+
+// Keeps everything the face needs to be put back, the caller opens the group
+static void Scene_Journal_RecordDeleteFace(Scene_Journal* journal, Scene* scene, uint32_t face_index)
+{
+    const Scene_Face* face = scene->faces + face_index;
+
+    Scene_Journal_ConstructFaceRecord record;
+    record.face         = face_index;
+    record.num_vertices = face->num_half_edges;
+    record.color        = face->color;
+
+    uint32_t* vertex_indices = ARENA_ALLOCATE_ARRAY(&journal->scratch_arena, uint32_t, record.num_vertices);
+    ASSERT(vertex_indices);
+
+    for (uint32_t i = 0; i < record.num_vertices; ++i)
+        vertex_indices[i] = scene->half_edges[face->first_half_edge + i].origin_vertex;
+
+    Scene_DeleteFace(scene, face_index);
+    Scene_Journal_WriteRecord(journal, SCENE_JOURNAL_RECORD_DELETE_FACE, &record, sizeof(record), vertex_indices, record.num_vertices);
+
+    Arena_Reset(&journal->scratch_arena);
+}
+
+void Scene_Journal_DeleteFace(Scene_Journal* journal, Scene* scene, uint32_t face_index)
+{
+    Scene_Journal_BeginEdit(journal);
+    Scene_Journal_RecordDeleteFace(journal, scene, face_index);
+    Scene_Journal_EndEdit(journal);
+}
+
+void Scene_Journal_DeleteEdge(Scene_Journal* journal, Scene* scene, uint32_t half_edge_index)
+{
+    uint32_t opposite_half_edge_index = scene->half_edges[half_edge_index].opposite_half_edge;
+    uint32_t opposite_face_index = (opposite_half_edge_index != SCENE_ID_NONE) ? scene->half_edges[opposite_half_edge_index].face : SCENE_ID_NONE;
+
+    Scene_Journal_BeginEdit(journal);
+
+    Scene_Journal_RecordDeleteFace(journal, scene, scene->half_edges[half_edge_index].face);
+
+    if (opposite_face_index != SCENE_ID_NONE && !Scene_Face_IsDeleted(scene, opposite_face_index))
+        Scene_Journal_RecordDeleteFace(journal, scene, opposite_face_index);
+
+    Scene_Journal_EndEdit(journal);
+}
+
+void Scene_Journal_DeleteVertex(Scene_Journal* journal, Scene* scene, uint32_t vertex_index)
+{
+    Scene_Journal_BeginEdit(journal);
+
+    // Faces are recorded one by one, so that undoing puts the vertex back before any of them
+    while (scene->vertices[vertex_index].first_outgoing_half_edge != SCENE_ID_NONE)
+        Scene_Journal_RecordDeleteFace(journal, scene, scene->half_edges[scene->vertices[vertex_index].first_outgoing_half_edge].face);
+
+    Scene_Journal_AddVertexRecord record;
+    record.vertex   = vertex_index;
+    record.position = scene->vertices[vertex_index].position;
+
+    Scene_DeleteVertex(scene, vertex_index);
+    Scene_Journal_WriteRecord(journal, SCENE_JOURNAL_RECORD_DELETE_VERTEX, &record, sizeof(record), NULL, 0);
+
+    Scene_Journal_EndEdit(journal);
+}
+
+void Scene_Journal_SetVertexPosition(Scene_Journal* journal, Scene* scene, uint32_t vertex_index, glm::vec3 position)
+{
+    glm::vec3 old_position = scene->vertices[vertex_index].position;
+    Scene_SetVertexPosition(scene, vertex_index, position);
+
+    Scene_Journal_BeginEdit(journal);
+
+    // The merge entries grow lazily, like the vertices they belong to
+    if (vertex_index >= journal->num_merge_tracked_vertices)
+    {
+        uint32_t num_new_vertices = scene->num_vertices - journal->num_merge_tracked_vertices;
+
+        uint32_t* new_serials = ARENA_ALLOCATE_ARRAY(&journal->merge_serial_arena, uint32_t, num_new_vertices);
+        uint64_t* new_positions = ARENA_ALLOCATE_ARRAY(&journal->merge_position_arena, uint64_t, num_new_vertices);
+
+        ASSERT(new_serials == journal->vertex_merge_serials + journal->num_merge_tracked_vertices);
+        ASSERT(new_positions == journal->vertex_merge_positions + journal->num_merge_tracked_vertices);
+        UNUSED(new_positions);
+
+        memset(new_serials, 0, (uint64_t)num_new_vertices * sizeof(uint32_t));
+
+        journal->num_merge_tracked_vertices = scene->num_vertices;
+    }
+
+    if (journal->vertex_merge_serials[vertex_index] == journal->group_serial && !journal->is_group_overflowing)
+    {
+        // Only the target of the earlier move changes, its old position is the one from before the group
+        uint64_t record_position = journal->vertex_merge_positions[vertex_index];
+
+        Scene_Journal_Write(
+            journal,
+            record_position + sizeof(Scene_Journal_RecordHeader) + offsetof(Scene_Journal_MoveVertexRecord, new_position),
+            &position,
+            sizeof(position)
+        );
+    }
+    else
+    {
+        Scene_Journal_MoveVertexRecord record;
+        record.vertex       = vertex_index;
+        record.old_position = old_position;
+        record.new_position = position;
+
+        uint64_t record_position = journal->write_position;
+        Scene_Journal_WriteRecord(journal, SCENE_JOURNAL_RECORD_MOVE_VERTEX, &record, sizeof(record), NULL, 0);
+
+        if (journal->write_position != record_position)
+        {
+            journal->vertex_merge_serials[vertex_index] = journal->group_serial;
+            journal->vertex_merge_positions[vertex_index] = record_position;
+        }
+    }
+
+    Scene_Journal_EndEdit(journal);
+}
+
+// Slots sorted by their old index with the one they have now, slots that are not listed keep theirs.
+// Slots from end_slot up to max_num_slots are past the end of the scene and are renamed to the virtual ones from first_virtual_slot
+// in the steps that can be undone.
+struct Scene_Journal_SlotMap
+{
+    const uint32_t* old_slots;
+    const uint32_t* new_slots;
+    uint32_t        num_slots;
+
+    uint32_t end_slot;
+    uint32_t max_num_slots;
+    uint32_t first_virtual_slot;
+    uint32_t end_virtual_slot;
+};
+
+// Elements that come back in a step while the slots around them are counted
+struct Scene_Journal_Placement
+{
+    uint32_t num_vertices;
+    uint32_t num_faces;
+
+    Scene_DefragMove* swaps;
+    uint32_t          num_swaps;
+};
+
+static int Scene_Journal_CompareSlots(const void* a, const void* b)
+{
+    uint32_t slot_a = *(const uint32_t*)a;
+    uint32_t slot_b = *(const uint32_t*)b;
+
+    return (slot_a > slot_b) - (slot_a < slot_b);
+}
+
+// Returns num_slots when the slot is not in the sorted array
+static uint32_t Scene_Journal_FindSlot(const uint32_t* slots, uint32_t num_slots, uint32_t slot)
+{
+    uint32_t first = 0;
+    uint32_t count = num_slots;
+
+    while (count > 0)
+    {
+        uint32_t half = count / 2;
+
+        if (slots[first + half] < slot)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+
+    return (first < num_slots && slots[first] == slot) ? first : num_slots;
+}
+
+static uint32_t Scene_Journal_MapSlot(Scene_Journal_SlotMap* map, uint32_t slot)
+{
+    uint32_t i = Scene_Journal_FindSlot(map->old_slots, map->num_slots, slot);
+
+    if (i < map->num_slots)
+        slot = map->new_slots[i];
+
+    if (slot >= map->end_slot && slot < map->max_num_slots)
+    {
+        slot = map->first_virtual_slot + (slot - map->end_slot);
+
+        if (slot >= map->end_virtual_slot)
+            map->end_virtual_slot = slot + 1;
+    }
+
+    return slot;
+}
+
+// Composes the swaps of one kind of element in the order they were made
+static void Scene_Journal_BuildSlotMap(Scene_Journal* journal, const Scene_DefragMove* swaps, uint32_t num_swaps, bool32_t is_face, Scene_Journal_SlotMap* map)
+{
+    uint32_t* slots = ARENA_ALLOCATE_ARRAY(&journal->remap_arena, uint32_t, 2 * (uint64_t)num_swaps);
+    ASSERT(slots);
+
+    uint32_t num_slots = 0;
+
+    for (uint32_t i = 0; i < num_swaps; ++i)
+    {
+        if (swaps[i].is_face != is_face)
+            continue;
+
+        slots[num_slots++] = swaps[i].source;
+        slots[num_slots++] = swaps[i].target;
+    }
+
+    qsort(slots, num_slots, sizeof(uint32_t), Scene_Journal_CompareSlots);
+
+    uint32_t num_unique_slots = 0;
+
+    for (uint32_t i = 0; i < num_slots; ++i)
+    {
+        if (num_unique_slots == 0 || slots[i] != slots[num_unique_slots - 1])
+            slots[num_unique_slots++] = slots[i];
+    }
+
+    num_slots = num_unique_slots;
+
+    uint32_t* occupants = ARENA_ALLOCATE_ARRAY(&journal->remap_arena, uint32_t, num_slots);
+    uint32_t* new_slots = ARENA_ALLOCATE_ARRAY(&journal->remap_arena, uint32_t, num_slots);
+
+    ASSERT(occupants && new_slots);
+
+    // Every slot starts out with its own element, which the swaps then carry around
+    memcpy(occupants, slots, (uint64_t)num_slots * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < num_swaps; ++i)
+    {
+        if (swaps[i].is_face != is_face)
+            continue;
+
+        uint32_t a = Scene_Journal_FindSlot(slots, num_slots, swaps[i].source);
+        uint32_t b = Scene_Journal_FindSlot(slots, num_slots, swaps[i].target);
+
+        uint32_t occupant = occupants[a];
+        occupants[a] = occupants[b];
+        occupants[b] = occupant;
+    }
+
+    for (uint32_t i = 0; i < num_slots; ++i)
+        new_slots[Scene_Journal_FindSlot(slots, num_slots, occupants[i])] = slots[i];
+
+    map->old_slots = slots;
+    map->new_slots = new_slots;
+    map->num_slots = num_slots;
+
+    // Nothing is renamed unless the caller asks for it
+    map->end_slot           = UINT32_MAX;
+    map->max_num_slots      = 0;
+    map->first_virtual_slot = 0;
+    map->end_virtual_slot   = 0;
+}
+
+// Renumbers every record of the history, the ones that can be redone included
+static void Scene_Journal_RemapSlots(Scene_Journal* journal, Scene_Journal_SlotMap* vertex_map, Scene_Journal_SlotMap* face_map)
+{
+    uint64_t current_position = *Scene_Journal_GetGroupStart(journal, journal->current_group);
+    uint64_t end_position     = *Scene_Journal_GetGroupStart(journal, journal->end_group);
+
+    for (uint64_t position = *Scene_Journal_GetGroupStart(journal, journal->first_group); position < end_position; )
+    {
+        // Slots past the end start over from here, the steps that can be redone were recorded for the scene as it is now
+        if (position == current_position)
+        {
+            vertex_map->end_slot = UINT32_MAX;
+            face_map->end_slot   = UINT32_MAX;
+        }
+
+        Scene_Journal_RecordHeader header;
+        Scene_Journal_Read(journal, position, &header, sizeof(header));
+
+        uint64_t payload_position = position + sizeof(header);
+
+        switch (header.type)
+        {
+        case SCENE_JOURNAL_RECORD_MOVE_VERTEX:
+        {
+            Scene_Journal_MoveVertexRecord record;
+            Scene_Journal_Read(journal, payload_position, &record, sizeof(record));
+
+            record.vertex = Scene_Journal_MapSlot(vertex_map, record.vertex);
+            Scene_Journal_Write(journal, payload_position, &record, sizeof(record));
+        } break;
+
+        case SCENE_JOURNAL_RECORD_ADD_VERTEX:
+        case SCENE_JOURNAL_RECORD_DELETE_VERTEX:
+        {
+            Scene_Journal_AddVertexRecord record;
+            Scene_Journal_Read(journal, payload_position, &record, sizeof(record));
+
+            record.vertex = Scene_Journal_MapSlot(vertex_map, record.vertex);
+            Scene_Journal_Write(journal, payload_position, &record, sizeof(record));
+        } break;
+
+        case SCENE_JOURNAL_RECORD_CONSTRUCT_FACE:
+        case SCENE_JOURNAL_RECORD_DELETE_FACE:
+        {
+            Scene_Journal_ConstructFaceRecord record;
+            Scene_Journal_Read(journal, payload_position, &record, sizeof(record));
+
+            record.face = Scene_Journal_MapSlot(face_map, record.face);
+            Scene_Journal_Write(journal, payload_position, &record, sizeof(record));
+
+            uint64_t index_position = payload_position + sizeof(record);
+
+            for (uint32_t i = 0; i < record.num_vertices; ++i, index_position += sizeof(uint32_t))
+            {
+                uint32_t vertex_index;
+                Scene_Journal_Read(journal, index_position, &vertex_index, sizeof(vertex_index));
+
+                vertex_index = Scene_Journal_MapSlot(vertex_map, vertex_index);
+                Scene_Journal_Write(journal, index_position, &vertex_index, sizeof(vertex_index));
+            }
+        } break;
+
+        default:
+            UNREACHABLE;
+        }
+
+        position += header.size;
+    }
+}
+
+void Scene_Journal_FollowDefrag(Scene_Journal* journal, const Scene* scene)
+{
+    ASSERT(!journal->is_group_open);
+
+    if (journal->first_group == journal->end_group)
+        return;
+
+    // NOTE: A move swaps the live element with the deleted one in its target, so the history of both slots is swapped as a
+    // whole. Slots that end up past the end, the ones the pass dropped among them, are restored there later, see
+    // Scene_Journal_PlaceSlot. Before the current step they have to be kept apart from the slots appended next, a deleted face
+    // slot from before the pass would otherwise get the size of a face appended to it afterwards.
+    Scene_Journal_SlotMap vertex_map;
+    Scene_Journal_SlotMap face_map;
+
+    Scene_Journal_BuildSlotMap(journal, scene->defrag.moves, scene->defrag.num_moves, FALSE, &vertex_map);
+    Scene_Journal_BuildSlotMap(journal, scene->defrag.moves, scene->defrag.num_moves, TRUE, &face_map);
+
+    vertex_map.end_slot           = scene->num_vertices;
+    vertex_map.max_num_slots      = SCENE_MAX_NUM_VERTICES;
+    vertex_map.first_virtual_slot = journal->next_virtual_vertex;
+    vertex_map.end_virtual_slot   = journal->next_virtual_vertex;
+
+    face_map.end_slot           = scene->num_faces;
+    face_map.max_num_slots      = SCENE_MAX_NUM_FACES;
+    face_map.first_virtual_slot = journal->next_virtual_face;
+    face_map.end_virtual_slot   = journal->next_virtual_face;
+
+    Scene_Journal_RemapSlots(journal, &vertex_map, &face_map);
+
+    journal->next_virtual_vertex = vertex_map.end_virtual_slot;
+    journal->next_virtual_face   = face_map.end_virtual_slot;
+
+    ASSERT(journal->next_virtual_vertex < SCENE_ID_DELETED && journal->next_virtual_face < SCENE_ID_DELETED);
+
+    Arena_Reset(&journal->remap_arena);
+}
+
+static void Scene_Journal_FinishDefrag(Scene_Journal* journal, Scene* scene)
+{
+    if (!scene->defrag.is_running)
+        return;
+
+    bool32_t defrag_result = Scene_Defragment(scene, UINT32_MAX);
+    ASSERT(defrag_result == TRUE);
+    UNUSED(defrag_result);
+
+    Scene_Journal_FollowDefrag(journal, scene);
+}
+
+static uint32_t Scene_Journal_SwapSlot(const Scene_Journal_Placement* placement, uint32_t slot, bool32_t is_face)
+{
+    for (uint32_t i = 0; i < placement->num_swaps; ++i)
+    {
+        const Scene_DefragMove* swap = placement->swaps + i;
+
+        if (swap->is_face != is_face)
+            continue;
+
+        if (slot == swap->source)
+            slot = swap->target;
+        else if (slot == swap->target)
+            slot = swap->source;
+    }
+
+    return slot;
+}
+
+// Slots past the end are all as good as deleted, one that is restored is swapped with the next one to be appended, so the
+// scene never has to make up elements in between.
+// NOTE: The swap renames the slots in the whole history, so both have to be past the end before the step as well. That holds
+// because undone elements keep their slots, the count never drops during a step.
+static void Scene_Journal_PlaceSlot(Scene_Journal* journal, Scene_Journal_Placement* placement, uint32_t slot, uint32_t* num_slots, bool32_t is_face)
+{
+    if (slot > *num_slots)
+    {
+        Scene_DefragMove* swap = ARENA_ALLOCATE_ARRAY(&journal->remap_arena, Scene_DefragMove, 1);
+        ASSERT(swap == placement->swaps + placement->num_swaps);
+
+        swap->source  = slot;
+        swap->target  = *num_slots;
+        swap->is_face = is_face;
+
+        ++placement->num_swaps;
+        slot = *num_slots;
+    }
+
+    if (slot == *num_slots)
+        ++*num_slots;
+}
+
+// Follows the counts of the scene through a record like Scene_Journal_ApplyRecord changes them
+static void Scene_Journal_PlaceRecord(Scene_Journal* journal, Scene_Journal_Placement* placement, uint64_t position, bool32_t is_redo)
+{
+    Scene_Journal_RecordHeader header;
+    Scene_Journal_Read(journal, position, &header, sizeof(header));
+    position += sizeof(header);
+
+    switch (header.type)
+    {
+    case SCENE_JOURNAL_RECORD_ADD_VERTEX:
+    case SCENE_JOURNAL_RECORD_DELETE_VERTEX:
+    {
+        Scene_Journal_AddVertexRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        uint32_t vertex_index = Scene_Journal_SwapSlot(placement, record.vertex, FALSE);
+
+        if ((header.type == SCENE_JOURNAL_RECORD_ADD_VERTEX) == is_redo)
+            Scene_Journal_PlaceSlot(journal, placement, vertex_index, &placement->num_vertices, FALSE);
+    } break;
+
+    case SCENE_JOURNAL_RECORD_CONSTRUCT_FACE:
+    case SCENE_JOURNAL_RECORD_DELETE_FACE:
+    {
+        Scene_Journal_ConstructFaceRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        uint32_t face_index = Scene_Journal_SwapSlot(placement, record.face, TRUE);
+
+        if ((header.type == SCENE_JOURNAL_RECORD_CONSTRUCT_FACE) == is_redo)
+            Scene_Journal_PlaceSlot(journal, placement, face_index, &placement->num_faces, TRUE);
+    } break;
+
+    default:
+        break;
+    }
+}
+
+static void Scene_Journal_PlaceRecords(Scene_Journal* journal, Scene_Journal_Placement* placement, uint64_t first_position, uint64_t end_position, bool32_t is_redo)
+{
+    if (is_redo)
+    {
+        for (uint64_t position = first_position; position < end_position; )
+        {
+            Scene_Journal_RecordHeader header;
+            Scene_Journal_Read(journal, position, &header, sizeof(header));
+
+            Scene_Journal_PlaceRecord(journal, placement, position, TRUE);
+            position += header.size;
+        }
+    }
+    else
+    {
+        for (uint64_t position = end_position; position > first_position; )
+        {
+            uint32_t size;
+            Scene_Journal_Read(journal, position - sizeof(size), &size, sizeof(size));
+
+            position -= size;
+            Scene_Journal_PlaceRecord(journal, placement, position, FALSE);
+        }
+    }
+}
+
+// Renumbers the history before a step is applied, in case it restores elements past the end of the scene
+// NOTE: Every swap is looked up for every record, which is fine for the few elements that come back past the end
+static void Scene_Journal_PlaceStep(Scene_Journal* journal, const Scene* scene, uint64_t first_position, uint64_t end_position, bool32_t is_redo)
+{
+    ASSERT(journal->remap_arena.offset == 0);
+
+    Scene_Journal_Placement placement;
+    placement.num_vertices = scene->num_vertices;
+    placement.num_faces    = scene->num_faces;
+    placement.swaps        = (Scene_DefragMove*)journal->remap_arena.memory;
+    placement.num_swaps    = 0;
+
+    Scene_Journal_PlaceRecords(journal, &placement, first_position, end_position, is_redo);
+
+    if (placement.num_swaps > 0)
+    {
+        Scene_Journal_SlotMap vertex_map;
+        Scene_Journal_SlotMap face_map;
+
+        Scene_Journal_BuildSlotMap(journal, placement.swaps, placement.num_swaps, FALSE, &vertex_map);
+        Scene_Journal_BuildSlotMap(journal, placement.swaps, placement.num_swaps, TRUE, &face_map);
+
+        Scene_Journal_RemapSlots(journal, &vertex_map, &face_map);
+    }
+
+    Arena_Reset(&journal->remap_arena);
+}
+
+static void Scene_Journal_ApplyRecord(Scene_Journal* journal, Scene* scene, uint64_t position, bool32_t is_redo)
+{
+    Scene_Journal_RecordHeader header;
+    Scene_Journal_Read(journal, position, &header, sizeof(header));
+    position += sizeof(header);
+
+    // NOTE: Undone elements are deleted in their slot, even the last ones. Dropping those would start the slot over while
+    // older steps still expect the deleted element in it, the defragmenter compacts them instead. Redone elements go back into
+    // the exact slot they had, which is either deleted with their size or the next one to be appended, so the scene has room
+    // for them. Scene_Journal_PlaceStep renumbered the slots past the end.
+    switch (header.type)
+    {
+    case SCENE_JOURNAL_RECORD_MOVE_VERTEX:
+    {
+        Scene_Journal_MoveVertexRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        Scene_SetVertexPosition(scene, record.vertex, is_redo ? record.new_position : record.old_position);
+    } break;
+
+    case SCENE_JOURNAL_RECORD_ADD_VERTEX:
+    {
+        Scene_Journal_AddVertexRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        if (is_redo)
+            Scene_RestoreVertex(scene, record.vertex, record.position);
+        else
+            Scene_DeleteVertex(scene, record.vertex);
+    } break;
+
+    case SCENE_JOURNAL_RECORD_DELETE_VERTEX:
+    {
+        Scene_Journal_AddVertexRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        if (is_redo)
+            Scene_DeleteVertex(scene, record.vertex);
+        else
+            Scene_RestoreVertex(scene, record.vertex, record.position);
+    } break;
+
+    case SCENE_JOURNAL_RECORD_CONSTRUCT_FACE:
+    case SCENE_JOURNAL_RECORD_DELETE_FACE:
+    {
+        Scene_Journal_ConstructFaceRecord record;
+        Scene_Journal_Read(journal, position, &record, sizeof(record));
+
+        // Deleting is constructing undone
+        bool32_t is_construct = (header.type == SCENE_JOURNAL_RECORD_CONSTRUCT_FACE) == is_redo;
+
+        if (is_construct)
+        {
+            uint32_t* vertex_indices = ARENA_ALLOCATE_ARRAY(&journal->scratch_arena, uint32_t, record.num_vertices);
+            ASSERT(vertex_indices);
+
+            Scene_Journal_Read(journal, position + sizeof(record), vertex_indices, (uint64_t)record.num_vertices * sizeof(uint32_t));
+
+            Scene_RestoreFace(scene, record.face, vertex_indices, record.num_vertices, record.color);
+
+            Arena_Reset(&journal->scratch_arena);
+        }
+        else
+        {
+            Scene_DeleteFace(scene, record.face);
+        }
+    } break;
+
+    default:
+        UNREACHABLE;
+    }
+}
+
+bool32_t Scene_Journal_Undo(Scene_Journal* journal, Scene* scene)
+{
+    ASSERT(!journal->is_group_open);
+
+    if (journal->current_group == journal->first_group)
+        return FALSE;
+
+    Scene_Journal_FinishDefrag(journal, scene);
+
+    uint64_t group_start = *Scene_Journal_GetGroupStart(journal, journal->current_group - 1);
+    uint64_t group_end   = *Scene_Journal_GetGroupStart(journal, journal->current_group);
+
+    Scene_Journal_PlaceStep(journal, scene, group_start, group_end, FALSE);
+
+    // Records are undone from the last one, following the sizes in their footers
+    for (uint64_t position = group_end; position > group_start; )
+    {
+        uint32_t size;
+        Scene_Journal_Read(journal, position - sizeof(size), &size, sizeof(size));
+
+        position -= size;
+        Scene_Journal_ApplyRecord(journal, scene, position, FALSE);
+    }
+
+    --journal->current_group;
+
+    return TRUE;
+}
+
+bool32_t Scene_Journal_Redo(Scene_Journal* journal, Scene* scene)
+{
+    ASSERT(!journal->is_group_open);
+
+    if (journal->current_group == journal->end_group)
+        return FALSE;
+
+    Scene_Journal_FinishDefrag(journal, scene);
+
+    uint64_t group_start = *Scene_Journal_GetGroupStart(journal, journal->current_group);
+    uint64_t group_end   = *Scene_Journal_GetGroupStart(journal, journal->current_group + 1);
+
+    Scene_Journal_PlaceStep(journal, scene, group_start, group_end, TRUE);
+
+    for (uint64_t position = group_start; position < group_end; )
+    {
+        Scene_Journal_RecordHeader header;
+        Scene_Journal_Read(journal, position, &header, sizeof(header));
+
+        Scene_Journal_ApplyRecord(journal, scene, position, TRUE);
+        position += header.size;
+    }
+
+    ++journal->current_group;
+
+    return TRUE;
+}
+
+void Scene_Journal_Seek(Scene_Journal* journal, Scene* scene, uint64_t group)
+{
+    ASSERT(group >= journal->first_group && group <= journal->end_group);
+
+    while (journal->current_group > group)
+        Scene_Journal_Undo(journal, scene);
+
+    while (journal->current_group < group)
+        Scene_Journal_Redo(journal, scene);
+}
@@ -0,0 +1,95 @@
+#ifndef SCENE_JOURNAL_HPP_
+#define SCENE_JOURNAL_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+// Bytes of edit records the journal keeps, a drag of a thousand vertices takes about 36 KB
+#define SCENE_JOURNAL_DEFAULT_CAPACITY ((uint64_t)1 << 24)
+
+// Undo steps the journal keeps at most, whichever limit is hit first drops the oldest ones
+#define SCENE_JOURNAL_MAX_NUM_GROUPS ((uint32_t)1 << 16)
+
+struct Scene;
+
+// Undo history of scene edits, kept as compact records of what changed instead of copies of the scene.
+// Records are grouped into undo steps and live in a ring buffer, once it is full the oldest steps are dropped.
+struct Scene_Journal
+{
+    // Holds the ring buffer and the group table, positions in the buffer count every byte ever written
+    Arena    arena;
+    uint8_t* buffer;
+    uint64_t capacity;
+
+    // Group g holds the records from group_starts[g % SCENE_JOURNAL_MAX_NUM_GROUPS] up to the start of group g + 1.
+    // The groups before current_group are applied to the scene, the ones from there to end_group can be redone.
+    uint64_t* group_starts;
+    uint64_t  first_group;
+    uint64_t  current_group;
+    uint64_t  end_group;
+
+    // End of the records of the open group
+    uint64_t write_position;
+
+    bool32_t is_group_open;
+    bool32_t is_group_implicit;   // Opened for a single edit outside of Scene_Journal_BeginGroup
+    bool32_t is_group_overflowing; // The open group does not fit into the buffer, it is dropped with the whole history
+
+    // Position of the move record of every vertex in the open group, entries with an older serial are stale
+    Arena     merge_serial_arena;
+    Arena     merge_position_arena;
+    uint32_t* vertex_merge_serials;
+    uint64_t* vertex_merge_positions;
+    uint32_t  num_merge_tracked_vertices;
+    uint32_t  group_serial;
+
+    // Vertex indices of a face record while it is redone
+    Arena scratch_arena;
+
+    // Slot swaps and their lookup tables while the records are renumbered
+    Arena remap_arena;
+
+    // Elements that were past the end of the scene when it was compacted are renamed to slots from these on, which no scene
+    // reaches, so that they never share a slot with the elements appended afterwards
+    uint32_t next_virtual_vertex;
+    uint32_t next_virtual_face;
+};
+
+// NOTE: The capacity must be a power of two
+bool32_t Scene_Journal_Init(Scene_Journal* journal, uint64_t capacity);
+
+void Scene_Journal_Destroy(Scene_Journal* journal);
+
+// Forgets the whole history, has to be called when the scene was changed without going through the journal
+void Scene_Journal_Clear(Scene_Journal* journal);
+
+// Edits between these calls are undone and redone as one step, and repeated moves of a vertex are merged into one record.
+// Edits outside of a group are a step of their own.
+void Scene_Journal_BeginGroup(Scene_Journal* journal);
+void Scene_Journal_EndGroup(Scene_Journal* journal);
+
+// Same as the scene functions, but recorded
+uint32_t Scene_Journal_AddVertex(Scene_Journal* journal, Scene* scene, glm::vec3 position);
+uint32_t Scene_Journal_ConstructFace(Scene_Journal* journal, Scene* scene, const uint32_t* vertex_indices, uint32_t num_vertices, glm::vec4 color);
+void Scene_Journal_SetVertexPosition(Scene_Journal* journal, Scene* scene, uint32_t vertex_index, glm::vec3 position);
+void Scene_Journal_DeleteFace(Scene_Journal* journal, Scene* scene, uint32_t face_index);
+void Scene_Journal_DeleteEdge(Scene_Journal* journal, Scene* scene, uint32_t half_edge_index);
+void Scene_Journal_DeleteVertex(Scene_Journal* journal, Scene* scene, uint32_t vertex_index);
+
+// Renumbers the records through the moves of the last call of Scene_Defragment, so the history survives the compaction.
+// NOTE: No group may be open
+void Scene_Journal_FollowDefrag(Scene_Journal* journal, const Scene* scene);
+
+// Return FALSE when there is nothing to undo or redo.
+// A defragmentation that is running is finished first, the deleted slots in its gap do not keep their size.
+// NOTE: No group may be open
+bool32_t Scene_Journal_Undo(Scene_Journal* journal, Scene* scene);
+bool32_t Scene_Journal_Redo(Scene_Journal* journal, Scene* scene);
+
+// Undoes or redoes steps until the given number of them is applied, which only touches the records in between.
+// NOTE: The group has to be between first_group and end_group
+void Scene_Journal_Seek(Scene_Journal* journal, Scene* scene, uint64_t group);
+
+#endif // !SCENE_JOURNAL_HPP_
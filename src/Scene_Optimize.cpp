@@ -0,0 +1,689 @@
+#include "Scene.hpp"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Merged faces get at most this many corners, so that they are still triangulated on the job threads and ray tests against
+// them stay cheap
+#define SCENE_OPTIMIZE_MAX_MERGED_CORNERS SCENE_GEOMETRY_TRIANGULATION_MAX_TASK_CORNERS
+
+// Faces whose normals are further apart are not merged, no matter how close their corners are to the plane
+#define SCENE_OPTIMIZE_MIN_NORMAL_COSINE 0.9998f
+
+#define SCENE_OPTIMIZE_MIN_CELL_CAPACITY ((uint32_t)1 << 6)
+
+// Cell coordinates are clamped to this range, far away vertices then share the outermost cells
+#define SCENE_OPTIMIZE_MAX_CELL_COORDINATE (1 << 28)
+
+// Buckets up to this size are sorted with insertion sort
+#define SCENE_OPTIMIZE_MAX_INSERTION_SORT_SIZE 32
+
+struct Scene_Optimize_WeldCell
+{
+    int32_t  x;
+    int32_t  y;
+    int32_t  z;
+    uint32_t first_vertex; // Head of the vertices that were kept in the cell, SCENE_ID_NONE for empty slots
+};
+
+// Faces as lists of corners, face i uses the num_corners[i] entries of corner_vertices from first_corners[i] on
+struct Scene_Optimize_Faces
+{
+    uint32_t*  first_corners;
+    uint32_t*  num_corners;
+    glm::vec4* colors;
+    uint32_t   num_faces;
+
+    uint32_t* corner_vertices;
+    uint32_t  num_total_corners;
+};
+
+// Everything the merge looks up per corner and per face
+struct Scene_Optimize_Merge
+{
+    const Scene_Optimize_Faces* faces;
+
+    uint32_t*  corner_faces;
+    uint32_t*  corner_twins; // SCENE_ID_NONE on boundary and non-manifold edges
+    glm::vec4* face_planes;  // Zero for faces that can not be merged
+    uint32_t*  face_regions;
+    uint32_t*  vertex_regions;
+
+    float plane_distance;
+};
+
+// Welding
+
+static int32_t Scene_Optimize_GetCellCoordinate(float position, float inverse_cell_size)
+{
+    float coordinate = floorf(position * inverse_cell_size);
+
+    if (!(coordinate > (float)-SCENE_OPTIMIZE_MAX_CELL_COORDINATE)) return -SCENE_OPTIMIZE_MAX_CELL_COORDINATE;
+    if (!(coordinate < (float)SCENE_OPTIMIZE_MAX_CELL_COORDINATE)) return SCENE_OPTIMIZE_MAX_CELL_COORDINATE;
+
+    return (int32_t)coordinate;
+}
+
+static uint32_t Scene_Optimize_HashCell(int32_t x, int32_t y, int32_t z)
+{
+    uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+// Returns the slot of the cell or the empty slot where it would go
+static Scene_Optimize_WeldCell* Scene_Optimize_FindWeldCell(Scene_Optimize_WeldCell* cells, uint32_t capacity, int32_t x, int32_t y, int32_t z)
+{
+    uint32_t mask = capacity - 1;
+
+    for (uint32_t slot = Scene_Optimize_HashCell(x, y, z) & mask; ; slot = (slot + 1) & mask)
+    {
+        Scene_Optimize_WeldCell* cell = cells + slot;
+
+        if (cell->first_vertex == SCENE_ID_NONE || (cell->x == x && cell->y == y && cell->z == z))
+            return cell;
+    }
+}
+
+// Maps every live vertex to the nearest earlier vertex within weld_distance that was kept, or to itself.
+// Returns the number of vertices that were welded.
+static uint32_t Scene_Optimize_WeldVertices(Scene* scene, float weld_distance, uint32_t* vertex_remap)
+{
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t num_vertices = scene->num_vertices;
+
+    // Cells are as large as the weld distance, so every vertex in reach is in one of the 27 cells around.
+    // NOTE: Without a distance only identical positions are welded, the cell size does not matter then
+    float inverse_cell_size = (weld_distance > 0.0f) ? 1.0f / weld_distance : 1.0f;
+    float max_distance_squared = (weld_distance > 0.0f) ? weld_distance * weld_distance : 0.0f;
+
+    // Kept at most half full, so probing always ends
+    uint32_t capacity = SCENE_OPTIMIZE_MIN_CELL_CAPACITY;
+    while (capacity < 2 * num_vertices)
+        capacity *= 2;
+
+    Scene_Optimize_WeldCell* cells = ARENA_ALLOCATE_ARRAY(scratch_arena, Scene_Optimize_WeldCell, capacity);
+    uint32_t* next_vertices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_vertices);
+
+    ASSERT(cells && (next_vertices || num_vertices == 0));
+
+    memset(cells, 0xFF, (uint64_t)capacity * sizeof(Scene_Optimize_WeldCell));
+
+    uint32_t num_welded_vertices = 0;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (Scene_Vertex_IsDeleted(scene, i))
+        {
+            vertex_remap[i] = SCENE_ID_NONE;
+            continue;
+        }
+
+        glm::vec3 position = scene->vertices[i].position;
+
+        int32_t x = Scene_Optimize_GetCellCoordinate(position.x, inverse_cell_size);
+        int32_t y = Scene_Optimize_GetCellCoordinate(position.y, inverse_cell_size);
+        int32_t z = Scene_Optimize_GetCellCoordinate(position.z, inverse_cell_size);
+
+        uint32_t nearest_vertex = SCENE_ID_NONE;
+        float nearest_distance_squared = max_distance_squared;
+
+        for (int32_t dx = -1; dx <= 1; ++dx)
+        {
+            for (int32_t dy = -1; dy <= 1; ++dy)
+            {
+                for (int32_t dz = -1; dz <= 1; ++dz)
+                {
+                    const Scene_Optimize_WeldCell* cell = Scene_Optimize_FindWeldCell(cells, capacity, x + dx, y + dy, z + dz);
+
+                    for (uint32_t vertex_index = cell->first_vertex; vertex_index != SCENE_ID_NONE; vertex_index = next_vertices[vertex_index])
+                    {
+                        glm::vec3 offset = scene->vertices[vertex_index].position - position;
+                        float distance_squared = glm::dot(offset, offset);
+
+                        if (distance_squared <= nearest_distance_squared &&
+                            (nearest_vertex == SCENE_ID_NONE || distance_squared < nearest_distance_squared))
+                        {
+                            nearest_vertex = vertex_index;
+                            nearest_distance_squared = distance_squared;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (nearest_vertex != SCENE_ID_NONE)
+        {
+            vertex_remap[i] = nearest_vertex;
+            ++num_welded_vertices;
+            continue;
+        }
+
+        Scene_Optimize_WeldCell* cell = Scene_Optimize_FindWeldCell(cells, capacity, x, y, z);
+
+        cell->x = x;
+        cell->y = y;
+        cell->z = z;
+
+        next_vertices[i] = cell->first_vertex;
+        cell->first_vertex = i;
+
+        vertex_remap[i] = i;
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+
+    return num_welded_vertices;
+}
+
+// Merging
+
+static int Scene_Optimize_CompareEntries(const void* a, const void* b)
+{
+    uint64_t entry_a = *(const uint64_t*)a;
+    uint64_t entry_b = *(const uint64_t*)b;
+
+    return (entry_a > entry_b) - (entry_a < entry_b);
+}
+
+static uint32_t Scene_Optimize_GetNextCorner(const Scene_Optimize_Merge* merge, uint32_t corner)
+{
+    const Scene_Optimize_Faces* faces = merge->faces;
+    uint32_t face = merge->corner_faces[corner];
+
+    return (corner + 1 < faces->first_corners[face] + faces->num_corners[face]) ? corner + 1 : faces->first_corners[face];
+}
+
+static uint32_t Scene_Optimize_GetEndVertex(const Scene_Optimize_Merge* merge, uint32_t corner)
+{
+    return merge->faces->corner_vertices[Scene_Optimize_GetNextCorner(merge, corner)];
+}
+
+// Whether the edge from the corner leads into a face of the region
+static bool32_t Scene_Optimize_IsInnerEdge(const Scene_Optimize_Merge* merge, uint32_t corner, uint32_t region)
+{
+    uint32_t twin = merge->corner_twins[corner];
+
+    return twin != SCENE_ID_NONE && merge->face_regions[merge->corner_faces[twin]] == region;
+}
+
+// Pairs the corners whose edges run between the same two vertices in opposite directions. Edges with more than two corners
+// are not paired, faces are never merged across them.
+static void Scene_Optimize_MatchTwins(Scene* scene, Scene_Optimize_Merge* merge)
+{
+    const Scene_Optimize_Faces* faces = merge->faces;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    uint32_t num_corners = faces->num_total_corners;
+
+    uint32_t* bucket_offsets = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, (uint64_t)scene->num_vertices + 1);
+    uint64_t* bucket_entries = ARENA_ALLOCATE_ARRAY(scratch_arena, uint64_t, num_corners);
+    ASSERT(bucket_offsets && (bucket_entries || num_corners == 0));
+
+    // Counting sort by the smaller vertex, every entry holds the larger vertex in the high bits and the corner in the low bits
+    memset(bucket_offsets, 0, ((uint64_t)scene->num_vertices + 1) * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < num_corners; ++i)
+    {
+        uint32_t v0 = faces->corner_vertices[i];
+        uint32_t v1 = Scene_Optimize_GetEndVertex(merge, i);
+
+        ++bucket_offsets[((v0 < v1) ? v0 : v1) + 1];
+        merge->corner_twins[i] = SCENE_ID_NONE;
+    }
+
+    for (uint32_t i = 0; i < scene->num_vertices; ++i)
+        bucket_offsets[i + 1] += bucket_offsets[i];
+
+    for (uint32_t i = 0; i < num_corners; ++i)
+    {
+        uint32_t v0 = faces->corner_vertices[i];
+        uint32_t v1 = Scene_Optimize_GetEndVertex(merge, i);
+
+        uint32_t v_min = (v0 < v1) ? v0 : v1;
+        uint32_t v_max = (v0 < v1) ? v1 : v0;
+
+        bucket_entries[bucket_offsets[v_min]++] = ((uint64_t)v_max << 32) | i;
+    }
+
+    // Scattering moved every offset to the end of its bucket, which is the start of the next one
+    memmove(bucket_offsets + 1, bucket_offsets, (uint64_t)scene->num_vertices * sizeof(uint32_t));
+    bucket_offsets[0] = 0;
+
+    for (uint32_t vertex_index = 0; vertex_index < scene->num_vertices; ++vertex_index)
+    {
+        uint64_t* entries = bucket_entries + bucket_offsets[vertex_index];
+        uint32_t num_entries = bucket_offsets[vertex_index + 1] - bucket_offsets[vertex_index];
+
+        if (num_entries <= SCENE_OPTIMIZE_MAX_INSERTION_SORT_SIZE)
+        {
+            for (uint32_t i = 1; i < num_entries; ++i)
+            {
+                uint64_t entry = entries[i];
+
+                uint32_t j = i;
+                for (; j > 0 && entries[j - 1] > entry; --j)
+                    entries[j] = entries[j - 1];
+
+                entries[j] = entry;
+            }
+        }
+        else
+        {
+            qsort(entries, num_entries, sizeof(uint64_t), Scene_Optimize_CompareEntries);
+        }
+
+        for (uint32_t i = 0; i + 1 < num_entries; ++i)
+        {
+            bool32_t is_single_pair =
+                (entries[i] >> 32) == (entries[i + 1] >> 32) &&
+                (i == 0 || (entries[i - 1] >> 32) != (entries[i] >> 32)) &&
+                (i + 2 == num_entries || (entries[i + 2] >> 32) != (entries[i] >> 32));
+
+            uint32_t corner_a = (uint32_t)entries[i];
+            uint32_t corner_b = (uint32_t)entries[i + 1];
+
+            if (is_single_pair && faces->corner_vertices[corner_a] != faces->corner_vertices[corner_b])
+            {
+                merge->corner_twins[corner_a] = corner_b;
+                merge->corner_twins[corner_b] = corner_a;
+            }
+        }
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+}
+
+// Planes with Newell's method like Scene_Face_RecomputePlane. Faces that visit a vertex twice would make the merged outline
+// touch itself, so they get no plane and stay as they are.
+static void Scene_Optimize_ComputePlanes(const Scene* scene, Scene_Optimize_Merge* merge)
+{
+    const Scene_Optimize_Faces* faces = merge->faces;
+
+    for (uint32_t i = 0; i < faces->num_faces; ++i)
+    {
+        const uint32_t* corner_vertices = faces->corner_vertices + faces->first_corners[i];
+        uint32_t num_corners = faces->num_corners[i];
+
+        glm::vec3 origin = scene->vertices[corner_vertices[0]].position;
+
+        glm::vec3 normal_sum(0.0f);
+        glm::vec3 corner_sum(0.0f);
+
+        bool32_t is_simple = TRUE;
+
+        for (uint32_t j = 0; j < num_corners; ++j)
+        {
+            glm::vec3 current_corner = scene->vertices[corner_vertices[j]].position - origin;
+            glm::vec3 next_corner = scene->vertices[corner_vertices[(j + 1 < num_corners) ? j + 1 : 0]].position - origin;
+
+            normal_sum += glm::cross(current_corner, next_corner);
+            corner_sum += current_corner;
+
+            is_simple &= merge->vertex_regions[corner_vertices[j]] != i;
+            merge->vertex_regions[corner_vertices[j]] = i;
+        }
+
+        float normal_length = glm::length(normal_sum);
+
+        if (!is_simple || !(normal_length > 0.0f))
+        {
+            merge->face_planes[i] = glm::vec4(0.0f);
+            continue;
+        }
+
+        glm::vec3 normal = normal_sum / normal_length;
+        merge->face_planes[i] = glm::vec4(normal, -glm::dot(normal, origin + corner_sum / (float)num_corners));
+    }
+}
+
+// Whether adding the face keeps the region a single polygon without holes, which is the case when the face shares one
+// contiguous chain of edges with it and touches it nowhere else
+static bool32_t Scene_Optimize_CanMerge(const Scene* scene, const Scene_Optimize_Merge* merge, uint32_t region, uint32_t face, uint32_t num_region_corners)
+{
+    const Scene_Optimize_Faces* faces = merge->faces;
+
+    glm::vec4 region_plane = merge->face_planes[region];
+    glm::vec4 face_plane = merge->face_planes[face];
+
+    if (faces->colors[face] != faces->colors[region])
+        return FALSE;
+
+    if (glm::dot(glm::vec3(face_plane), glm::vec3(region_plane)) < SCENE_OPTIMIZE_MIN_NORMAL_COSINE)
+        return FALSE;
+
+    uint32_t first_corner = faces->first_corners[face];
+    uint32_t num_corners = faces->num_corners[face];
+
+    uint32_t num_inner_edges = 0;
+    uint32_t num_chains = 0;
+
+    for (uint32_t j = 0; j < num_corners; ++j)
+    {
+        uint32_t corner = first_corner + j;
+        uint32_t prev_corner = first_corner + ((j > 0) ? j - 1 : num_corners - 1);
+
+        glm::vec3 position = scene->vertices[faces->corner_vertices[corner]].position;
+
+        if (fabsf(glm::dot(glm::vec3(region_plane), position) + region_plane.w) > merge->plane_distance)
+            return FALSE;
+
+        bool32_t is_inner = Scene_Optimize_IsInnerEdge(merge, corner, region);
+        bool32_t is_prev_inner = Scene_Optimize_IsInnerEdge(merge, prev_corner, region);
+
+        num_inner_edges += is_inner;
+        num_chains += is_inner && !is_prev_inner;
+
+        // Corners away from the chain have to be new to the region, or the outline would touch itself
+        if (!is_inner && !is_prev_inner && merge->vertex_regions[faces->corner_vertices[corner]] == region)
+            return FALSE;
+    }
+
+    // The chain is replaced by the other edges of the face
+    return num_chains == 1 && num_inner_edges < num_corners &&
+           num_region_corners + num_corners - 2 * num_inner_edges <= SCENE_OPTIMIZE_MAX_MERGED_CORNERS;
+}
+
+static void Scene_Optimize_AddToRegion(Scene_Optimize_Merge* merge, uint32_t region, uint32_t face)
+{
+    const Scene_Optimize_Faces* faces = merge->faces;
+
+    merge->face_regions[face] = region;
+
+    for (uint32_t j = 0; j < faces->num_corners[face]; ++j)
+        merge->vertex_regions[faces->corner_vertices[faces->first_corners[face] + j]] = region;
+}
+
+// Grows a region from every face that is not part of one yet and writes its outline as a face
+static void Scene_Optimize_MergeFaces(Scene* scene, const Scene_Optimize_Faces* faces, float plane_distance, Scene_Optimize_Faces* out_faces)
+{
+    Arena* scratch_arena = &scene->scratch_arena;
+    uint64_t scratch_offset = scratch_arena->offset;
+
+    Scene_Optimize_Merge merge = {};
+    merge.faces          = faces;
+    merge.corner_faces   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, faces->num_total_corners);
+    merge.corner_twins   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, faces->num_total_corners);
+    merge.face_planes    = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec4, faces->num_faces);
+    merge.face_regions   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, faces->num_faces);
+    merge.vertex_regions = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, scene->num_vertices);
+    merge.plane_distance = plane_distance;
+
+    // Faces of the region that is grown, in the order they were added
+    uint32_t* region_faces = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, faces->num_faces);
+
+    ASSERT(merge.corner_faces && merge.corner_twins && merge.face_planes && merge.face_regions && merge.vertex_regions && region_faces);
+
+    for (uint32_t i = 0; i < faces->num_faces; ++i)
+    {
+        for (uint32_t j = 0; j < faces->num_corners[i]; ++j)
+            merge.corner_faces[faces->first_corners[i] + j] = i;
+    }
+
+    Scene_Optimize_MatchTwins(scene, &merge);
+
+    memset(merge.vertex_regions, 0xFF, (uint64_t)scene->num_vertices * sizeof(uint32_t));
+    Scene_Optimize_ComputePlanes(scene, &merge);
+
+    memset(merge.face_regions, 0xFF, (uint64_t)faces->num_faces * sizeof(uint32_t));
+    memset(merge.vertex_regions, 0xFF, (uint64_t)scene->num_vertices * sizeof(uint32_t));
+
+    out_faces->num_faces = 0;
+    out_faces->num_total_corners = 0;
+
+    for (uint32_t seed_face = 0; seed_face < faces->num_faces; ++seed_face)
+    {
+        if (merge.face_regions[seed_face] != SCENE_ID_NONE)
+            continue;
+
+        // Regions are named after their first face, which gives them their plane and color
+        uint32_t region = seed_face;
+
+        Scene_Optimize_AddToRegion(&merge, region, seed_face);
+
+        region_faces[0] = seed_face;
+        uint32_t num_region_faces = 1;
+        uint32_t num_region_corners = faces->num_corners[seed_face];
+
+        // Faces are looked at again from every region face next to them, so one that touches the region in two places
+        // can still join once the gap between them is filled
+        bool32_t can_grow = merge.face_planes[seed_face] != glm::vec4(0.0f);
+
+        for (uint32_t i = 0; can_grow && i < num_region_faces; ++i)
+        {
+            uint32_t region_face = region_faces[i];
+
+            for (uint32_t j = 0; j < faces->num_corners[region_face]; ++j)
+            {
+                uint32_t twin = merge.corner_twins[faces->first_corners[region_face] + j];
+                if (twin == SCENE_ID_NONE)
+                    continue;
+
+                uint32_t face = merge.corner_faces[twin];
+
+                if (merge.face_regions[face] != SCENE_ID_NONE || merge.face_planes[face] == glm::vec4(0.0f) ||
+                    !Scene_Optimize_CanMerge(scene, &merge, region, face, num_region_corners))
+                {
+                    continue;
+                }
+
+                uint32_t num_inner_edges = 0;
+
+                for (uint32_t k = 0; k < faces->num_corners[face]; ++k)
+                    num_inner_edges += Scene_Optimize_IsInnerEdge(&merge, faces->first_corners[face] + k, region);
+
+                num_region_corners += faces->num_corners[face] - 2 * num_inner_edges;
+
+                Scene_Optimize_AddToRegion(&merge, region, face);
+                region_faces[num_region_faces++] = face;
+            }
+        }
+
+        uint32_t out_face = out_faces->num_faces++;
+        uint32_t* out_corner_vertices = out_faces->corner_vertices + out_faces->num_total_corners;
+
+        out_faces->first_corners[out_face] = out_faces->num_total_corners;
+        out_faces->num_corners[out_face]   = num_region_corners;
+        out_faces->colors[out_face]        = faces->colors[seed_face];
+
+        out_faces->num_total_corners += num_region_corners;
+
+        if (num_region_faces == 1)
+        {
+            memcpy(out_corner_vertices, faces->corner_vertices + faces->first_corners[seed_face], (uint64_t)num_region_corners * sizeof(uint32_t));
+            continue;
+        }
+
+        // The outline starts at any outer edge, the seed face may be surrounded by the region by now
+        uint32_t start_corner = SCENE_ID_NONE;
+
+        for (uint32_t i = 0; start_corner == SCENE_ID_NONE && i < num_region_faces; ++i)
+        {
+            uint32_t region_face = region_faces[i];
+
+            for (uint32_t j = 0; start_corner == SCENE_ID_NONE && j < faces->num_corners[region_face]; ++j)
+            {
+                if (!Scene_Optimize_IsInnerEdge(&merge, faces->first_corners[region_face] + j, region))
+                    start_corner = faces->first_corners[region_face] + j;
+            }
+        }
+
+        ASSERT(start_corner != SCENE_ID_NONE);
+
+        uint32_t num_outline_corners = 0;
+        uint32_t corner = start_corner;
+
+        do
+        {
+            ASSERT(num_outline_corners < num_region_corners);
+            out_corner_vertices[num_outline_corners++] = faces->corner_vertices[corner];
+
+            // Inner edges are crossed into the face on their other side, until the next outer edge comes up
+            corner = Scene_Optimize_GetNextCorner(&merge, corner);
+
+            while (Scene_Optimize_IsInnerEdge(&merge, corner, region))
+                corner = Scene_Optimize_GetNextCorner(&merge, merge.corner_twins[corner]);
+        }
+        while (corner != start_corner);
+
+        ASSERT(num_outline_corners == num_region_corners);
+    }
+
+    Arena_Rewind(scratch_arena, scratch_offset);
+}
+
+bool32_t Scene_Optimize(Scene* scene, float weld_distance, float plane_distance, Scene_OptimizeStats* out_stats)
+{
+    Scene_OptimizeStats stats = {};
+
+    uint32_t num_vertices = scene->num_vertices;
+    uint32_t num_faces = scene->num_faces;
+
+    uint32_t num_live_half_edges = scene->num_half_edges - scene->num_deleted_half_edges;
+    uint32_t num_live_faces = num_faces - scene->num_deleted_faces;
+
+    stats.num_input_vertices          = num_vertices - scene->num_deleted_vertices;
+    stats.num_input_faces             = num_live_faces;
+    stats.num_input_geometry_vertices = num_live_half_edges;
+    stats.num_input_triangles         = num_live_half_edges - 2 * num_live_faces;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+
+    uint32_t* vertex_remap       = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_vertices);
+    uint32_t* vertex_new_indices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_vertices);
+
+    // Faces after welding and after merging, merging never adds corners
+    Scene_Optimize_Faces faces = {};
+    faces.first_corners   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+    faces.num_corners     = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+    faces.colors          = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec4, num_faces);
+    faces.corner_vertices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, scene->num_half_edges);
+
+    Scene_Optimize_Faces merged_faces = {};
+    merged_faces.first_corners   = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+    merged_faces.num_corners     = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+    merged_faces.colors          = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec4, num_faces);
+    merged_faces.corner_vertices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, scene->num_half_edges);
+
+    ASSERT((vertex_remap && vertex_new_indices) || num_vertices == 0);
+    ASSERT((faces.first_corners && faces.num_corners && faces.colors && faces.corner_vertices) || num_faces == 0);
+    ASSERT((merged_faces.first_corners && merged_faces.num_corners && merged_faces.colors && merged_faces.corner_vertices) || num_faces == 0);
+
+    stats.num_welded_vertices = Scene_Optimize_WeldVertices(scene, weld_distance, vertex_remap);
+
+    // Corners that welding made repeat are dropped like on import
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        if (Scene_Face_IsDeleted(scene, i))
+            continue;
+
+        const Scene_Face* face = scene->faces + i;
+        uint32_t* corner_vertices = faces.corner_vertices + faces.num_total_corners;
+
+        uint32_t num_distinct_corners = 0;
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+        {
+            uint32_t vertex_index = vertex_remap[scene->half_edges[face->first_half_edge + j].origin_vertex];
+
+            if (num_distinct_corners == 0 || corner_vertices[num_distinct_corners - 1] != vertex_index)
+                corner_vertices[num_distinct_corners++] = vertex_index;
+        }
+
+        while (num_distinct_corners > 1 && corner_vertices[num_distinct_corners - 1] == corner_vertices[0])
+            --num_distinct_corners;
+
+        if (num_distinct_corners < 3)
+        {
+            ++stats.num_skipped_faces;
+            continue;
+        }
+
+        faces.first_corners[faces.num_faces] = faces.num_total_corners;
+        faces.num_corners[faces.num_faces]   = num_distinct_corners;
+        faces.colors[faces.num_faces]        = face->color;
+
+        ++faces.num_faces;
+        faces.num_total_corners += num_distinct_corners;
+    }
+
+    Scene_Optimize_MergeFaces(scene, &faces, plane_distance, &merged_faces);
+
+    stats.num_merged_faces = faces.num_faces - merged_faces.num_faces;
+
+    // Vertices that are used by a face are kept, and so are the ones that no face used before
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        bool32_t is_loose = !Scene_Vertex_IsDeleted(scene, i) && vertex_remap[i] == i && scene->vertices[i].first_outgoing_half_edge == SCENE_ID_NONE;
+        vertex_new_indices[i] = is_loose ? 0 : SCENE_ID_NONE;
+    }
+
+    for (uint32_t i = 0; i < merged_faces.num_total_corners; ++i)
+        vertex_new_indices[merged_faces.corner_vertices[i]] = 0;
+
+    uint32_t new_num_vertices = 0;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (vertex_new_indices[i] != SCENE_ID_NONE)
+            vertex_new_indices[i] = new_num_vertices++;
+    }
+
+    stats.num_vertices          = new_num_vertices;
+    stats.num_faces             = merged_faces.num_faces;
+    stats.num_geometry_vertices = merged_faces.num_total_corners;
+    stats.num_triangles         = merged_faces.num_total_corners - 2 * merged_faces.num_faces;
+
+    if (out_stats)
+        *out_stats = stats;
+
+    // Nothing is rebuilt when every element would stay where it is
+    if (stats.num_welded_vertices == 0 && stats.num_merged_faces == 0 && stats.num_skipped_faces == 0 &&
+        new_num_vertices == num_vertices && merged_faces.num_faces == num_faces)
+    {
+        Arena_Reset(scratch_arena);
+        return FALSE;
+    }
+
+    glm::vec3* positions = ARENA_ALLOCATE_ARRAY(scratch_arena, glm::vec3, new_num_vertices);
+    ASSERT(positions || new_num_vertices == 0);
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (vertex_new_indices[i] != SCENE_ID_NONE)
+            positions[vertex_new_indices[i]] = scene->vertices[i].position;
+    }
+
+    for (uint32_t i = 0; i < merged_faces.num_total_corners; ++i)
+        merged_faces.corner_vertices[i] = vertex_new_indices[merged_faces.corner_vertices[i]];
+
+    // Everything is dropped and constructed again
+    Scene_Clear(scene);
+
+    if (new_num_vertices > 0)
+    {
+        uint32_t first_vertex_index = Scene_AddVertices(scene, positions, new_num_vertices);
+        ASSERT(first_vertex_index == 0);
+        UNUSED(first_vertex_index);
+    }
+
+    if (merged_faces.num_faces > 0)
+    {
+        uint32_t first_face_index = Scene_ConstructFaces(scene, merged_faces.corner_vertices, merged_faces.num_corners, merged_faces.colors, merged_faces.num_faces);
+        ASSERT(first_face_index == 0);
+        UNUSED(first_face_index);
+    }
+
+    Arena_Reset(scratch_arena);
+
+    return TRUE;
+}
@@ -0,0 +1,626 @@
+#include "Scene.hpp"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#define SCENE_PICK_GRID_MIN_CELL_SIZE 0.01f
+
+#define SCENE_PICK_GRID_MIN_CELL_CAPACITY ((uint32_t)1 << 6)
+#define SCENE_PICK_GRID_MAX_CELL_CAPACITY ((uint32_t)1 << 31)
+
+// Cell coordinates are clamped to this range, far away elements then share the outermost cells
+#define SCENE_PICK_GRID_MAX_CELL_COORDINATE (1 << 28)
+
+// Links of every vertex and half-edge, the cell table at its largest and the dirty tracking of vertices
+#define SCENE_PICK_GRID_ARENA_CAPACITY ( \
+    (uint64_t)SCENE_MAX_NUM_VERTICES * (sizeof(Scene_PickGrid_Link) + sizeof(uint32_t) + sizeof(bool32_t)) + \
+    (uint64_t)SCENE_MAX_NUM_HALF_EDGES * (sizeof(Scene_PickGrid_Link) + sizeof(uint32_t)) + \
+    (uint64_t)SCENE_PICK_GRID_MAX_CELL_CAPACITY * sizeof(Scene_PickGrid_Cell) + \
+    ARENA_COMMIT_GRANULARITY \
+)
+
+struct Scene_Pick_Query
+{
+    glm::vec3 ray_origin;
+    glm::vec3 ray_direction;
+    float     ray_max_length;
+    float     radius_per_length;
+    bool32_t  find_edges;
+
+    uint32_t  nearest_element;
+    float     nearest_length;
+    float     nearest_distance_squared;
+    glm::vec3 nearest_point;
+};
+
+bool32_t Scene_PickGrid_Init(Scene_PickGrid* pick_grid)
+{
+    memset(pick_grid, 0, sizeof(Scene_PickGrid));
+
+    if (!Arena_CreateReserved(&pick_grid->arena, SCENE_PICK_GRID_ARENA_CAPACITY))
+        return FALSE;
+
+    pick_grid->needs_rebuild = TRUE;
+
+    return TRUE;
+}
+
+void Scene_PickGrid_Destroy(Scene_PickGrid* pick_grid)
+{
+    Arena_Destroy(&pick_grid->arena);
+    memset(pick_grid, 0, sizeof(Scene_PickGrid));
+}
+
+static Scene_PickGrid_Link* Scene_PickGrid_GetElementLink(Scene_PickGrid* pick_grid, uint32_t element)
+{
+    if (element & SCENE_PICK_GRID_EDGE_BIT)
+        return pick_grid->half_edge_links + (element & ~SCENE_PICK_GRID_EDGE_BIT);
+
+    return pick_grid->vertex_links + element;
+}
+
+// Non-manifold edges can have one-sided opposites, which at worst links such an edge twice
+static uint32_t Scene_PickGrid_GetEdgeHalfEdge(const Scene* scene, uint32_t half_edge_index)
+{
+    uint32_t opposite_half_edge_index = scene->half_edges[half_edge_index].opposite_half_edge;
+
+    return (opposite_half_edge_index != SCENE_ID_NONE && opposite_half_edge_index < half_edge_index) ? opposite_half_edge_index : half_edge_index;
+}
+
+static int32_t Scene_PickGrid_GetCellCoordinate(const Scene_PickGrid* pick_grid, float position)
+{
+    float coordinate = floorf(position * pick_grid->inverse_cell_size);
+
+    if (!(coordinate > (float)-SCENE_PICK_GRID_MAX_CELL_COORDINATE)) return -SCENE_PICK_GRID_MAX_CELL_COORDINATE;
+    if (!(coordinate < (float)SCENE_PICK_GRID_MAX_CELL_COORDINATE)) return SCENE_PICK_GRID_MAX_CELL_COORDINATE;
+
+    return (int32_t)coordinate;
+}
+
+static uint32_t Scene_PickGrid_HashCell(int32_t x, int32_t y, int32_t z)
+{
+    uint32_t hash = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u;
+
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+
+    return hash;
+}
+
+static uint32_t Scene_PickGrid_FindCell(const Scene_PickGrid* pick_grid, int32_t x, int32_t y, int32_t z)
+{
+    uint32_t mask = pick_grid->cell_capacity - 1;
+
+    for (uint32_t slot = Scene_PickGrid_HashCell(x, y, z) & mask; ; slot = (slot + 1) & mask)
+    {
+        const Scene_PickGrid_Cell* cell = pick_grid->cells + slot;
+
+        if (!cell->is_used)
+            return SCENE_ID_NONE;
+
+        if (cell->x == x && cell->y == y && cell->z == z)
+            return slot;
+    }
+}
+
+// Returns SCENE_ID_NONE when the table is too full, the grid has to be rebuilt then
+static uint32_t Scene_PickGrid_FindOrAddCell(Scene_PickGrid* pick_grid, int32_t x, int32_t y, int32_t z)
+{
+    uint32_t mask = pick_grid->cell_capacity - 1;
+
+    for (uint32_t slot = Scene_PickGrid_HashCell(x, y, z) & mask; ; slot = (slot + 1) & mask)
+    {
+        Scene_PickGrid_Cell* cell = pick_grid->cells + slot;
+
+        if (cell->is_used)
+        {
+            if (cell->x == x && cell->y == y && cell->z == z)
+                return slot;
+
+            continue;
+        }
+
+        // NOTE: Keeping the table at most half full keeps the probe sequences short
+        if ((pick_grid->num_cells + 1) * 2 > pick_grid->cell_capacity)
+            return SCENE_ID_NONE;
+
+        cell->x             = x;
+        cell->y             = y;
+        cell->z             = z;
+        cell->first_vertex  = SCENE_ID_NONE;
+        cell->first_edge    = SCENE_ID_NONE;
+        cell->is_used       = TRUE;
+
+        ++pick_grid->num_cells;
+
+        return slot;
+    }
+}
+
+static void Scene_PickGrid_UnlinkElement(Scene_PickGrid* pick_grid, uint32_t element)
+{
+    Scene_PickGrid_Link* link = Scene_PickGrid_GetElementLink(pick_grid, element);
+
+    if (link->cell == SCENE_ID_NONE)
+        return;
+
+    if (link->cell == SCENE_PICK_GRID_LONG_EDGE)
+    {
+        // Swap with the last long edge, whose link stores its position in the list
+        uint32_t last_element = pick_grid->long_edges[--pick_grid->num_long_edges];
+
+        pick_grid->long_edges[link->next] = last_element;
+        Scene_PickGrid_GetElementLink(pick_grid, last_element)->next = link->next;
+    }
+    else
+    {
+        Scene_PickGrid_Cell* cell = pick_grid->cells + link->cell;
+
+        if (link->prev != SCENE_ID_NONE)
+            Scene_PickGrid_GetElementLink(pick_grid, link->prev)->next = link->next;
+        else if (element & SCENE_PICK_GRID_EDGE_BIT)
+            cell->first_edge = link->next;
+        else
+            cell->first_vertex = link->next;
+
+        if (link->next != SCENE_ID_NONE)
+            Scene_PickGrid_GetElementLink(pick_grid, link->next)->prev = link->prev;
+    }
+
+    link->cell = SCENE_ID_NONE;
+    link->next = SCENE_ID_NONE;
+    link->prev = SCENE_ID_NONE;
+}
+
+// Returns FALSE when the cell table is too full
+static bool32_t Scene_PickGrid_LinkElement(Scene_PickGrid* pick_grid, uint32_t element, glm::vec3 anchor)
+{
+    uint32_t slot = Scene_PickGrid_FindOrAddCell(
+        pick_grid,
+        Scene_PickGrid_GetCellCoordinate(pick_grid, anchor.x),
+        Scene_PickGrid_GetCellCoordinate(pick_grid, anchor.y),
+        Scene_PickGrid_GetCellCoordinate(pick_grid, anchor.z)
+    );
+
+    if (slot == SCENE_ID_NONE)
+        return FALSE;
+
+    Scene_PickGrid_Cell* cell = pick_grid->cells + slot;
+    uint32_t* first_element = (element & SCENE_PICK_GRID_EDGE_BIT) ? &cell->first_edge : &cell->first_vertex;
+
+    Scene_PickGrid_Link* link = Scene_PickGrid_GetElementLink(pick_grid, element);
+    link->cell = slot;
+    link->next = *first_element;
+    link->prev = SCENE_ID_NONE;
+
+    if (*first_element != SCENE_ID_NONE)
+        Scene_PickGrid_GetElementLink(pick_grid, *first_element)->prev = element;
+
+    *first_element = element;
+
+    pick_grid->bounds_min = glm::min(pick_grid->bounds_min, anchor);
+    pick_grid->bounds_max = glm::max(pick_grid->bounds_max, anchor);
+
+    return TRUE;
+}
+
+static bool32_t Scene_PickGrid_RelinkVertex(Scene_PickGrid* pick_grid, const Scene* scene, uint32_t vertex_index)
+{
+    Scene_PickGrid_UnlinkElement(pick_grid, vertex_index);
+    return Scene_PickGrid_LinkElement(pick_grid, vertex_index, scene->vertices[vertex_index].position);
+}
+
+static bool32_t Scene_PickGrid_RelinkEdge(Scene_PickGrid* pick_grid, const Scene* scene, uint32_t half_edge_index)
+{
+    uint32_t element = Scene_PickGrid_GetEdgeHalfEdge(scene, half_edge_index) | SCENE_PICK_GRID_EDGE_BIT;
+
+    // Faces put back into a deleted slot can come before their twins, which then stop representing the edge
+    uint32_t opposite_half_edge_index = scene->half_edges[half_edge_index].opposite_half_edge;
+
+    Scene_PickGrid_UnlinkElement(pick_grid, half_edge_index | SCENE_PICK_GRID_EDGE_BIT);
+    if (opposite_half_edge_index != SCENE_ID_NONE)
+        Scene_PickGrid_UnlinkElement(pick_grid, opposite_half_edge_index | SCENE_PICK_GRID_EDGE_BIT);
+
+    glm::vec3 start = scene->vertices[scene->half_edges[half_edge_index].origin_vertex].position;
+    glm::vec3 end = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)].position;
+
+    if (glm::length(end - start) > SCENE_PICK_GRID_MAX_EDGE_LENGTH_IN_CELLS * pick_grid->cell_size)
+    {
+        Scene_PickGrid_Link* link = Scene_PickGrid_GetElementLink(pick_grid, element);
+        link->cell = SCENE_PICK_GRID_LONG_EDGE;
+        link->next = pick_grid->num_long_edges;
+
+        pick_grid->long_edges[pick_grid->num_long_edges++] = element;
+
+        return TRUE;
+    }
+
+    return Scene_PickGrid_LinkElement(pick_grid, element, 0.5f * (start + end));
+}
+
+void Scene_PickGrid_Build(Scene* scene)
+{
+    Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    Arena_Reset(&pick_grid->arena);
+
+    uint32_t num_vertices = scene->num_vertices;
+    uint32_t num_half_edges = scene->num_half_edges;
+
+    // The cells follow the average edge, so nearly every edge fits into the cells
+    double edge_length_sum = 0.0;
+    uint32_t num_edges = 0;
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        if (scene->half_edges[i].face == SCENE_ID_DELETED || Scene_PickGrid_GetEdgeHalfEdge(scene, i) != i)
+            continue;
+
+        glm::vec3 start = scene->vertices[scene->half_edges[i].origin_vertex].position;
+        glm::vec3 end = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, i)].position;
+
+        edge_length_sum += glm::length(end - start);
+        ++num_edges;
+    }
+
+    float cell_size = (num_edges > 0) ? (float)(edge_length_sum / num_edges) : 1.0f;
+    if (!(cell_size > SCENE_PICK_GRID_MIN_CELL_SIZE)) cell_size = SCENE_PICK_GRID_MIN_CELL_SIZE;
+
+    // Every element adds at most one cell
+    uint64_t num_required_cells = 2 * ((uint64_t)num_vertices + num_edges);
+
+    uint32_t cell_capacity = SCENE_PICK_GRID_MIN_CELL_CAPACITY;
+    while (cell_capacity < num_required_cells && cell_capacity < SCENE_PICK_GRID_MAX_CELL_CAPACITY)
+        cell_capacity *= 2;
+
+    pick_grid->cells                = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, Scene_PickGrid_Cell, cell_capacity);
+    pick_grid->vertex_links         = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, Scene_PickGrid_Link, num_vertices);
+    pick_grid->half_edge_links      = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, Scene_PickGrid_Link, num_half_edges);
+    pick_grid->long_edges           = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, uint32_t, num_half_edges);
+    pick_grid->dirty_vertex_indices = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, uint32_t, num_vertices);
+    pick_grid->vertex_dirty_flags   = ARENA_ALLOCATE_ARRAY(&pick_grid->arena, bool32_t, num_vertices);
+
+    ASSERT(pick_grid->cells && pick_grid->vertex_links && pick_grid->half_edge_links);
+    ASSERT(pick_grid->long_edges && pick_grid->dirty_vertex_indices && pick_grid->vertex_dirty_flags);
+
+    memset(pick_grid->cells, 0, (uint64_t)cell_capacity * sizeof(Scene_PickGrid_Cell));
+    memset(pick_grid->vertex_links, 0xFF, (uint64_t)num_vertices * sizeof(Scene_PickGrid_Link));
+    memset(pick_grid->half_edge_links, 0xFF, (uint64_t)num_half_edges * sizeof(Scene_PickGrid_Link));
+    memset(pick_grid->vertex_dirty_flags, 0, (uint64_t)num_vertices * sizeof(bool32_t));
+
+    pick_grid->cell_size         = cell_size;
+    pick_grid->inverse_cell_size = 1.0f / cell_size;
+    pick_grid->cell_capacity     = cell_capacity;
+    pick_grid->num_cells         = 0;
+
+    pick_grid->bounds_min = glm::vec3(FLT_MAX);
+    pick_grid->bounds_max = glm::vec3(-FLT_MAX);
+
+    pick_grid->num_vertices       = num_vertices;
+    pick_grid->num_half_edges     = num_half_edges;
+    pick_grid->num_long_edges     = 0;
+    pick_grid->num_dirty_vertices = 0;
+    pick_grid->needs_rebuild      = FALSE;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (Scene_Vertex_IsDeleted(scene, i))
+            continue;
+
+        bool32_t link_result = Scene_PickGrid_RelinkVertex(pick_grid, scene, i);
+        ASSERT(link_result == TRUE);
+        UNUSED(link_result);
+    }
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        if (scene->half_edges[i].face == SCENE_ID_DELETED || Scene_PickGrid_GetEdgeHalfEdge(scene, i) != i)
+            continue;
+
+        bool32_t link_result = Scene_PickGrid_RelinkEdge(pick_grid, scene, i);
+        ASSERT(link_result == TRUE);
+        UNUSED(link_result);
+    }
+    pick_grid->num_built_long_edges = pick_grid->num_long_edges;
+}
+
+void Scene_PickGrid_MarkVertexDirty(Scene* scene, uint32_t vertex_index)
+{
+    Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    // Vertices that are not in the grid yet are picked up by the next rebuild
+    if (vertex_index >= pick_grid->num_vertices || pick_grid->vertex_dirty_flags[vertex_index])
+        return;
+
+    pick_grid->vertex_dirty_flags[vertex_index] = TRUE;
+    pick_grid->dirty_vertex_indices[pick_grid->num_dirty_vertices++] = vertex_index;
+}
+
+void Scene_PickGrid_RemoveVertex(Scene* scene, uint32_t vertex_index)
+{
+    Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    if (pick_grid->needs_rebuild || vertex_index >= pick_grid->num_vertices)
+        return;
+
+    Scene_PickGrid_UnlinkElement(pick_grid, vertex_index);
+}
+
+void Scene_PickGrid_RemoveHalfEdges(Scene* scene, uint32_t first_half_edge, uint32_t num_half_edges)
+{
+    Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    if (pick_grid->needs_rebuild)
+        return;
+
+    // Only the half-edges that represent their edge are linked, unlinking the others does nothing
+    for (uint32_t i = first_half_edge; i < first_half_edge + num_half_edges && i < pick_grid->num_half_edges; ++i)
+        Scene_PickGrid_UnlinkElement(pick_grid, i | SCENE_PICK_GRID_EDGE_BIT);
+}
+
+void Scene_PickGrid_Update(Scene* scene)
+{
+    Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    if (pick_grid->needs_rebuild || pick_grid->num_vertices != scene->num_vertices || pick_grid->num_half_edges != scene->num_half_edges)
+    {
+        Scene_PickGrid_Build(scene);
+        return;
+    }
+
+    for (uint32_t i = 0; i < pick_grid->num_dirty_vertices; ++i)
+    {
+        uint32_t vertex_index = pick_grid->dirty_vertex_indices[i];
+        pick_grid->vertex_dirty_flags[vertex_index] = FALSE;
+
+        // Deleted vertices were unlinked already
+        if (Scene_Vertex_IsDeleted(scene, vertex_index))
+            continue;
+
+        bool32_t relink_result = Scene_PickGrid_RelinkVertex(pick_grid, scene, vertex_index);
+
+        // Every edge at the vertex either starts there or is the previous one of an edge that does
+        for (uint32_t half_edge_index = scene->vertices[vertex_index].first_outgoing_half_edge;
+             half_edge_index != SCENE_ID_NONE && relink_result;
+             half_edge_index = scene->half_edges[half_edge_index].next_outgoing_half_edge)
+        {
+            relink_result = Scene_PickGrid_RelinkEdge(pick_grid, scene, half_edge_index) &&
+                            Scene_PickGrid_RelinkEdge(pick_grid, scene, scene->half_edges[half_edge_index].prev_half_edge);
+        }
+
+        if (!relink_result)
+        {
+            Scene_PickGrid_Build(scene);
+            return;
+        }
+    }
+
+    pick_grid->num_dirty_vertices = 0;
+
+    // Every query scans the long edges, once edits made them grow a rebuild picks a cell size that fits the current edges.
+    // Some slack keeps single edits in large scenes from rebuilding, and the scenes with many long edges to begin with
+    // are not rebuilt again and again.
+    if (pick_grid->num_long_edges > 2 * pick_grid->num_built_long_edges + pick_grid->num_half_edges / 1024 + 16)
+        pick_grid->needs_rebuild = TRUE;
+}
+
+static void Scene_Pick_TestElement(const Scene* scene, Scene_Pick_Query* query, uint32_t element)
+{
+    glm::vec3 point;
+
+    if (element & SCENE_PICK_GRID_EDGE_BIT)
+    {
+        uint32_t half_edge_index = element & ~SCENE_PICK_GRID_EDGE_BIT;
+
+        glm::vec3 start = scene->vertices[scene->half_edges[half_edge_index].origin_vertex].position;
+        glm::vec3 edge = scene->vertices[Scene_HalfEdge_GetEndVertex(scene, half_edge_index)].position - start;
+
+        // The point of the edge closest to the ray line, found with both taken perpendicular to the ray
+        glm::vec3 start_offset = start - query->ray_origin;
+        glm::vec3 start_perpendicular = start_offset - glm::dot(start_offset, query->ray_direction) * query->ray_direction;
+        glm::vec3 edge_perpendicular = edge - glm::dot(edge, query->ray_direction) * query->ray_direction;
+
+        float edge_perpendicular_length_squared = glm::dot(edge_perpendicular, edge_perpendicular);
+
+        float s = 0.5f;
+        if (edge_perpendicular_length_squared > FLT_EPSILON * glm::dot(edge, edge))
+            s = glm::clamp(-glm::dot(start_perpendicular, edge_perpendicular) / edge_perpendicular_length_squared, 0.0f, 1.0f);
+
+        point = start + s * edge;
+    }
+    else
+    {
+        point = scene->vertices[element].position;
+    }
+
+    glm::vec3 offset = point - query->ray_origin;
+
+    float length = glm::dot(offset, query->ray_direction);
+    if (length <= 0.0f || length > query->ray_max_length || length > query->nearest_length)
+        return;
+
+    float distance_squared = glm::dot(offset, offset) - length * length;
+    float radius = length * query->radius_per_length;
+
+    if (distance_squared > radius * radius)
+        return;
+
+    if (length == query->nearest_length && distance_squared >= query->nearest_distance_squared)
+        return;
+
+    query->nearest_element          = element;
+    query->nearest_length           = length;
+    query->nearest_distance_squared = distance_squared;
+    query->nearest_point            = point;
+}
+
+static bool32_t Scene_Pick_Run(Scene* scene, Scene_Pick_Query* query, Scene_RayHit* out_hit)
+{
+    Scene_PickGrid_Update(scene);
+
+    const Scene_PickGrid* pick_grid = &scene->pick_grid;
+
+    query->nearest_element          = SCENE_ID_NONE;
+    query->nearest_length           = FLT_MAX;
+    query->nearest_distance_squared = FLT_MAX;
+
+    if (query->find_edges)
+    {
+        for (uint32_t i = 0; i < pick_grid->num_long_edges; ++i)
+            Scene_Pick_TestElement(scene, query, pick_grid->long_edges[i]);
+    }
+
+    // Edges are linked at their midpoint, so their cells can be this far from the point that gets picked
+    float looseness = query->find_edges ? 0.5f * SCENE_PICK_GRID_MAX_EDGE_LENGTH_IN_CELLS * pick_grid->cell_size : 0.0f;
+
+    // Only the part of the ray that can reach the linked elements is walked
+    float max_radius = query->ray_max_length * query->radius_per_length + looseness;
+
+    float min_length = 0.0f;
+    float max_length = (pick_grid->num_cells > 0) ? query->ray_max_length : -1.0f;
+
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        float slab_min = pick_grid->bounds_min[axis] - max_radius;
+        float slab_max = pick_grid->bounds_max[axis] + max_radius;
+
+        if (query->ray_direction[axis] == 0.0f)
+        {
+            if (query->ray_origin[axis] < slab_min || query->ray_origin[axis] > slab_max)
+                max_length = -1.0f;
+
+            continue;
+        }
+
+        float inverse_direction = 1.0f / query->ray_direction[axis];
+        float t0 = (slab_min - query->ray_origin[axis]) * inverse_direction;
+        float t1 = (slab_max - query->ray_origin[axis]) * inverse_direction;
+
+        if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+
+        if (t0 > min_length) min_length = t0;
+        if (t1 < max_length) max_length = t1;
+    }
+
+    // Cells of the previous slab, consecutive slabs overlap and those cells were tested completely already
+    int32_t previous_cell_min[3] = { 1, 1, 1 };
+    int32_t previous_cell_max[3] = { 0, 0, 0 };
+
+    // Walks slabs of the ray front to back, every slab visits the cells that the cone can reach in it.
+    // Everything nearer than a slab was visited already, so the walk ends as soon as an element was found before it.
+    for (float slab_begin = min_length; slab_begin <= max_length && slab_begin < query->nearest_length; )
+    {
+        float slab_end = slab_begin + pick_grid->cell_size;
+        if (slab_end > max_length) slab_end = max_length;
+
+        float radius = slab_end * query->radius_per_length + looseness;
+
+        glm::vec3 a = query->ray_origin + slab_begin * query->ray_direction;
+        glm::vec3 b = query->ray_origin + slab_end * query->ray_direction;
+
+        glm::vec3 box_min = glm::max(glm::min(a, b) - radius, pick_grid->bounds_min - looseness);
+        glm::vec3 box_max = glm::min(glm::max(a, b) + radius, pick_grid->bounds_max + looseness);
+
+        int32_t cell_min[3], cell_max[3];
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            cell_min[axis] = Scene_PickGrid_GetCellCoordinate(pick_grid, box_min[axis]);
+            cell_max[axis] = Scene_PickGrid_GetCellCoordinate(pick_grid, box_max[axis]);
+        }
+
+        for (int32_t x = cell_min[0]; x <= cell_max[0]; ++x)
+        {
+            for (int32_t y = cell_min[1]; y <= cell_max[1]; ++y)
+            {
+                bool32_t is_previous_column =
+                    x >= previous_cell_min[0] && x <= previous_cell_max[0] &&
+                    y >= previous_cell_min[1] && y <= previous_cell_max[1];
+
+                for (int32_t z = cell_min[2]; z <= cell_max[2]; ++z)
+                {
+                    if (is_previous_column && z >= previous_cell_min[2] && z <= previous_cell_max[2])
+                    {
+                        z = previous_cell_max[2];
+                        continue;
+                    }
+
+                    uint32_t slot = Scene_PickGrid_FindCell(pick_grid, x, y, z);
+                    if (slot == SCENE_ID_NONE)
+                        continue;
+
+                    const Scene_PickGrid_Cell* cell = pick_grid->cells + slot;
+
+                    for (uint32_t element = query->find_edges ? cell->first_edge : cell->first_vertex;
+                         element != SCENE_ID_NONE;
+                         element = ((element & SCENE_PICK_GRID_EDGE_BIT) ? pick_grid->half_edge_links[element & ~SCENE_PICK_GRID_EDGE_BIT] : pick_grid->vertex_links[element]).next)
+                    {
+                        Scene_Pick_TestElement(scene, query, element);
+                    }
+                }
+            }
+        }
+
+        if (slab_end >= max_length)
+            break;
+
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            previous_cell_min[axis] = cell_min[axis];
+            previous_cell_max[axis] = cell_max[axis];
+        }
+
+        slab_begin = slab_end;
+    }
+
+    out_hit->index = SCENE_ID_NONE;
+
+    if (query->nearest_element == SCENE_ID_NONE)
+        return FALSE;
+
+    out_hit->index        = query->nearest_element & ~SCENE_PICK_GRID_EDGE_BIT;
+    out_hit->length       = query->nearest_length;
+    out_hit->intersection = query->nearest_point;
+
+    return TRUE;
+}
+
+bool32_t Scene_Pick_FindNearestVertex(
+    Scene*        scene,
+    glm::vec3     ray_origin,
+    glm::vec3     ray_direction,
+    float         ray_max_length,
+    float         radius_per_length,
+    Scene_RayHit* out_hit
+)
+{
+    Scene_Pick_Query query = {};
+    query.ray_origin        = ray_origin;
+    query.ray_direction     = ray_direction;
+    query.ray_max_length    = ray_max_length;
+    query.radius_per_length = radius_per_length;
+    query.find_edges        = FALSE;
+
+    return Scene_Pick_Run(scene, &query, out_hit);
+}
+
+bool32_t Scene_Pick_FindNearestEdge(
+    Scene*        scene,
+    glm::vec3     ray_origin,
+    glm::vec3     ray_direction,
+    float         ray_max_length,
+    float         radius_per_length,
+    Scene_RayHit* out_hit
+)
+{
+    Scene_Pick_Query query = {};
+    query.ray_origin        = ray_origin;
+    query.ray_direction     = ray_direction;
+    query.ray_max_length    = ray_max_length;
+    query.radius_per_length = radius_per_length;
+    query.find_edges        = TRUE;
+
+    return Scene_Pick_Run(scene, &query, out_hit);
+}
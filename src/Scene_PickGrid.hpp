@@ -0,0 +1,112 @@
+#ifndef SCENE_PICK_GRID_HPP_
+#define SCENE_PICK_GRID_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <glm/glm.hpp>
+
+// Edges longer than this many cells of the pick grid are kept in a list that every pick query scans
+#define SCENE_PICK_GRID_MAX_EDGE_LENGTH_IN_CELLS 2.0f
+
+#define SCENE_PICK_GRID_EDGE_BIT ((uint32_t)1 << 31)
+#define SCENE_PICK_GRID_LONG_EDGE ((uint32_t)-2)
+
+struct Scene;
+struct Scene_RayHit;
+
+// Position of a vertex or an edge in the pick grid, edges are linked through the half-edge that represents them
+struct Scene_PickGrid_Link
+{
+    uint32_t cell; // Slot in the cell table, SCENE_PICK_GRID_LONG_EDGE or SCENE_ID_NONE when not linked
+    uint32_t next; // Index in the long edge list for long edges
+    uint32_t prev;
+};
+
+struct Scene_PickGrid_Cell
+{
+    int32_t  x;
+    int32_t  y;
+    int32_t  z;
+    // Heads of the lists of vertices and edges in the cell, emptied cells keep their slot until the next rebuild
+    uint32_t first_vertex;
+    uint32_t first_edge;
+    bool32_t is_used;
+};
+
+// Sparse uniform grid over vertices and edges for picking near a ray.
+// Vertices are linked into the cell they are in and edges into the cell of their midpoint, so no edge reaches more than
+// one cell out of its own.
+struct Scene_PickGrid
+{
+    // Holds every array below, all of them are sized for the elements at build time
+    Arena arena;
+
+    float cell_size;
+    float inverse_cell_size;
+
+    // Open addressing table, the capacity is a power of two
+    Scene_PickGrid_Cell* cells;
+    uint32_t             cell_capacity;
+    uint32_t             num_cells;
+
+    // Bounds of everything linked into the cells
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+
+    // Element links use the vertex index or the half-edge index with SCENE_PICK_GRID_EDGE_BIT set
+    Scene_PickGrid_Link* vertex_links;
+    Scene_PickGrid_Link* half_edge_links;
+    uint32_t             num_vertices;
+    uint32_t             num_half_edges;
+
+    uint32_t* long_edges;
+    uint32_t  num_long_edges;
+    uint32_t  num_built_long_edges; // Right after the last build
+
+    uint32_t* dirty_vertex_indices;
+    bool32_t* vertex_dirty_flags;
+    uint32_t  num_dirty_vertices;
+
+    bool32_t needs_rebuild;
+};
+
+bool32_t Scene_PickGrid_Init(Scene_PickGrid* pick_grid);
+
+void Scene_PickGrid_Destroy(Scene_PickGrid* pick_grid);
+
+void Scene_PickGrid_Build(Scene* scene);
+
+void Scene_PickGrid_MarkVertexDirty(Scene* scene, uint32_t vertex_index);
+
+// Unlink elements that are deleted or about to move, queries would look at them otherwise
+void Scene_PickGrid_RemoveVertex(Scene* scene, uint32_t vertex_index);
+void Scene_PickGrid_RemoveHalfEdges(Scene* scene, uint32_t first_half_edge, uint32_t num_half_edges);
+
+// Relinks the elements around moved vertices and rebuilds the grid when vertices or faces were added
+void Scene_PickGrid_Update(Scene* scene);
+
+// Finds the vertex nearest to the ray origin among the ones inside the cone around the ray, whose radius grows by
+// radius_per_length with the distance along the ray.
+// NOTE: ray_direction must be a unit vector
+bool32_t Scene_Pick_FindNearestVertex(
+    Scene*        scene,
+    glm::vec3     ray_origin,
+    glm::vec3     ray_direction,
+    float         ray_max_length,
+    float         radius_per_length,
+    Scene_RayHit* out_hit
+);
+
+// Same as Scene_Pick_FindNearestVertex for edges, the hit index is one of the half-edges of the edge
+// NOTE: ray_direction must be a unit vector
+bool32_t Scene_Pick_FindNearestEdge(
+    Scene*        scene,
+    glm::vec3     ray_origin,
+    glm::vec3     ray_direction,
+    float         ray_max_length,
+    float         radius_per_length,
+    Scene_RayHit* out_hit
+);
+
+#endif // !SCENE_PICK_GRID_HPP_
@@ -0,0 +1,250 @@
+#include "Scene.hpp"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Positions are quantized to this many bits per axis, so that the curve key fits into the upper half of a sort entry
+#define SCENE_REORDER_NUM_KEY_BITS_PER_AXIS 10
+
+// Moves bit i of a 10 bit value to bit 3 * i
+static uint32_t Scene_Reorder_SpreadBits(uint32_t value)
+{
+    value = (value | (value << 16)) & 0x030000FFu;
+    value = (value | (value << 8))  & 0x0300F00Fu;
+    value = (value | (value << 4))  & 0x030C30C3u;
+    value = (value | (value << 2))  & 0x09249249u;
+
+    return value;
+}
+
+// Entries hold the Morton code of the position in the high bits and the element index in the low bits, so sorting them
+// orders the elements along the curve and keeps elements in the same cell in their old order
+static uint64_t Scene_Reorder_MakeEntry(glm::vec3 position, glm::vec3 bounds_min, float scale, uint32_t index)
+{
+    const float max_cell = (float)((1u << SCENE_REORDER_NUM_KEY_BITS_PER_AXIS) - 1);
+
+    glm::vec3 cell = glm::clamp((position - bounds_min) * scale, glm::vec3(0.0f), glm::vec3(max_cell));
+
+    uint32_t key =
+        Scene_Reorder_SpreadBits((uint32_t)cell.x) |
+        (Scene_Reorder_SpreadBits((uint32_t)cell.y) << 1) |
+        (Scene_Reorder_SpreadBits((uint32_t)cell.z) << 2);
+
+    return ((uint64_t)key << 32) | index;
+}
+
+static int Scene_Reorder_CompareEntries(const void* a, const void* b)
+{
+    uint64_t entry_a = *(const uint64_t*)a;
+    uint64_t entry_b = *(const uint64_t*)b;
+
+    return (entry_a > entry_b) - (entry_a < entry_b);
+}
+
+static uint32_t Scene_Reorder_Remap(const uint32_t* new_indices, uint32_t index)
+{
+    return (index != SCENE_ID_NONE) ? new_indices[index] : SCENE_ID_NONE;
+}
+
+void Scene_Reorder(Scene* scene)
+{
+    // Triangles and planes move with their faces instead of being recomputed, so they have to be current
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    uint32_t num_vertices   = scene->num_vertices;
+    uint32_t num_half_edges = scene->num_half_edges;
+    uint32_t num_faces      = scene->num_faces;
+
+    // Every element may move, so snapshots have to keep the originals of everything
+    Scene_PrepareVertexWrite(scene, 0, num_vertices);
+    Scene_PrepareHalfEdgeWrite(scene, 0, num_half_edges);
+    Scene_PrepareFaceWrite(scene, 0, num_faces);
+
+    glm::vec3 bounds_min = glm::vec3(FLT_MAX);
+    glm::vec3 bounds_max = glm::vec3(-FLT_MAX);
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (Scene_Vertex_IsDeleted(scene, i))
+            continue;
+
+        bounds_min = glm::min(bounds_min, scene->vertices[i].position);
+        bounds_max = glm::max(bounds_max, scene->vertices[i].position);
+    }
+
+    // NOTE: The cells are cubes, so flat scenes do not spend key bits on their thin axis
+    glm::vec3 extent = bounds_max - bounds_min;
+    float max_extent = glm::max(extent.x, glm::max(extent.y, extent.z));
+    float scale = (max_extent > 0.0f) ? (float)(1u << SCENE_REORDER_NUM_KEY_BITS_PER_AXIS) / max_extent : 0.0f;
+
+    Arena* scratch_arena = &scene->scratch_arena;
+
+    uint32_t* vertex_new_indices    = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_vertices);
+    uint32_t* half_edge_new_indices = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_half_edges);
+    uint32_t* face_new_indices      = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+    uint32_t* face_old_indices      = ARENA_ALLOCATE_ARRAY(scratch_arena, uint32_t, num_faces);
+
+    uint64_t maps_end = scratch_arena->offset;
+
+    uint64_t* entries = ARENA_ALLOCATE_ARRAY(scratch_arena, uint64_t, glm::max(num_vertices, num_faces));
+
+    ASSERT(vertex_new_indices && half_edge_new_indices && face_new_indices && face_old_indices && entries);
+
+    // Vertices along the curve through their positions, deleted ones are dropped
+
+    uint32_t new_num_vertices = 0;
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        vertex_new_indices[i] = SCENE_ID_NONE;
+
+        if (!Scene_Vertex_IsDeleted(scene, i))
+            entries[new_num_vertices++] = Scene_Reorder_MakeEntry(scene->vertices[i].position, bounds_min, scale, i);
+    }
+
+    qsort(entries, new_num_vertices, sizeof(uint64_t), Scene_Reorder_CompareEntries);
+
+    for (uint32_t i = 0; i < new_num_vertices; ++i)
+        vertex_new_indices[(uint32_t)entries[i]] = i;
+
+    // Faces along the curve through their centroids, every face takes its half-edges along in their old order, so they stay
+    // consecutive and the geometry ranges keep following the half-edge numbering
+
+    uint32_t new_num_faces = 0;
+
+    for (uint32_t i = 0; i < num_faces; ++i)
+    {
+        const Scene_Face* face = scene->faces + i;
+
+        if (Scene_Face_IsDeleted(scene, i))
+        {
+            for (uint32_t j = 0; j < face->num_half_edges; ++j)
+                half_edge_new_indices[face->first_half_edge + j] = SCENE_ID_NONE;
+
+            continue;
+        }
+
+        glm::vec3 centroid = glm::vec3(0.0f);
+
+        for (uint32_t j = 0; j < face->num_half_edges; ++j)
+            centroid += scene->vertices[scene->half_edges[face->first_half_edge + j].origin_vertex].position;
+
+        entries[new_num_faces++] = Scene_Reorder_MakeEntry(centroid / (float)face->num_half_edges, bounds_min, scale, i);
+    }
+
+    qsort(entries, new_num_faces, sizeof(uint64_t), Scene_Reorder_CompareEntries);
+
+    uint32_t half_edge_index = 0;
+
+    for (uint32_t i = 0; i < new_num_faces; ++i)
+    {
+        uint32_t old_face_index = (uint32_t)entries[i];
+        const Scene_Face* old_face = scene->faces + old_face_index;
+
+        face_old_indices[i] = old_face_index;
+        face_new_indices[old_face_index] = i;
+
+        for (uint32_t j = 0; j < old_face->num_half_edges; ++j)
+            half_edge_new_indices[old_face->first_half_edge + j] = half_edge_index + j;
+
+        half_edge_index += old_face->num_half_edges;
+    }
+
+    // Every half-edge belongs to exactly one face
+    uint32_t new_num_half_edges = half_edge_index;
+    ASSERT(new_num_half_edges == num_half_edges - scene->num_deleted_half_edges);
+
+    Arena_Rewind(scratch_arena, maps_end);
+
+    // Each array is moved through a copy of its old contents
+
+    Scene_Vertex* old_vertices = (Scene_Vertex*)Arena_PushRegion(scratch_arena, scene->vertices, (uint64_t)num_vertices * sizeof(Scene_Vertex), alignof(Scene_Vertex));
+    ASSERT(old_vertices || num_vertices == 0);
+
+    for (uint32_t i = 0; i < num_vertices; ++i)
+    {
+        if (vertex_new_indices[i] == SCENE_ID_NONE)
+            continue;
+
+        Scene_Vertex* vertex = scene->vertices + vertex_new_indices[i];
+
+        vertex->position                 = old_vertices[i].position;
+        vertex->first_outgoing_half_edge = Scene_Reorder_Remap(half_edge_new_indices, old_vertices[i].first_outgoing_half_edge);
+    }
+
+    Arena_Rewind(scratch_arena, maps_end);
+
+    Scene_HalfEdge* old_half_edges = (Scene_HalfEdge*)Arena_PushRegion(scratch_arena, scene->half_edges, (uint64_t)num_half_edges * sizeof(Scene_HalfEdge), alignof(Scene_HalfEdge));
+    ASSERT(old_half_edges || num_half_edges == 0);
+
+    for (uint32_t i = 0; i < num_half_edges; ++i)
+    {
+        if (half_edge_new_indices[i] == SCENE_ID_NONE)
+            continue;
+
+        const Scene_HalfEdge* old_half_edge = old_half_edges + i;
+        Scene_HalfEdge* half_edge = scene->half_edges + half_edge_new_indices[i];
+
+        half_edge->origin_vertex           = vertex_new_indices[old_half_edge->origin_vertex];
+        half_edge->opposite_half_edge      = Scene_Reorder_Remap(half_edge_new_indices, old_half_edge->opposite_half_edge);
+        half_edge->next_half_edge          = half_edge_new_indices[old_half_edge->next_half_edge];
+        half_edge->prev_half_edge          = half_edge_new_indices[old_half_edge->prev_half_edge];
+        half_edge->face                    = face_new_indices[old_half_edge->face];
+        half_edge->next_outgoing_half_edge = Scene_Reorder_Remap(half_edge_new_indices, old_half_edge->next_outgoing_half_edge);
+    }
+
+    Arena_Rewind(scratch_arena, maps_end);
+
+    Scene_Face* old_faces = (Scene_Face*)Arena_PushRegion(scratch_arena, scene->faces, (uint64_t)num_faces * sizeof(Scene_Face), alignof(Scene_Face));
+    ASSERT(old_faces || num_faces == 0);
+
+    for (uint32_t i = 0; i < new_num_faces; ++i)
+    {
+        Scene_Face* face = scene->faces + i;
+
+        *face = old_faces[face_old_indices[i]];
+        face->first_half_edge = half_edge_new_indices[face->first_half_edge];
+    }
+
+    uint32_t num_old_geometry_indices = Scene_GetNumGeometryIndices(scene);
+
+    // The freed tails are dropped like after Scene_TruncateVertices and Scene_TruncateFaces
+    scene->num_vertices   = new_num_vertices;
+    scene->num_half_edges = new_num_half_edges;
+    scene->num_faces      = new_num_faces;
+
+    scene->num_deleted_vertices   = 0;
+    scene->num_deleted_half_edges = 0;
+    scene->num_deleted_faces      = 0;
+
+    Arena_Rewind(&scene->vertex_arena, (uint64_t)new_num_vertices * sizeof(Scene_Vertex));
+    Arena_Rewind(&scene->half_edge_arena, (uint64_t)new_num_half_edges * sizeof(Scene_HalfEdge));
+    Arena_Rewind(&scene->face_arena, (uint64_t)new_num_faces * sizeof(Scene_Face));
+
+    Scene_RebuildFreeLists(scene);
+    scene->defrag.is_running = FALSE;
+
+    Scene_Geometry_ReorderFaces(scene, face_old_indices, old_faces, num_old_geometry_indices);
+
+    Arena_Reset(scratch_arena);
+
+    // The planes were current and moved with their faces, so there is nothing to track anymore.
+    // NOTE: The derived structures are indexed by element, they are rebuilt on their next update
+    ASSERT(scene->num_dirty_plane_faces == 0);
+
+    if (scene->num_plane_tracked_faces > new_num_faces)
+    {
+        scene->num_plane_tracked_faces = new_num_faces;
+
+        Arena_Rewind(&scene->plane_flag_arena, (uint64_t)new_num_faces * sizeof(bool32_t));
+        Arena_Rewind(&scene->plane_dirty_arena, (uint64_t)new_num_faces * sizeof(uint32_t));
+    }
+
+    scene->bvh.needs_rebuild = TRUE;
+    scene->face_planes.needs_rebuild = TRUE;
+    scene->pick_grid.needs_rebuild = TRUE;
+    scene->clusters.needs_rebuild = TRUE;
+
+    Scene_DropFaceChanges(scene);
+}
@@ -0,0 +1,198 @@
+#include "Scene.hpp"
+
+#include <string.h>
+
+static const uint64_t Scene_Snapshot_MaxArraySizes[SCENE_SNAPSHOT_NUM_ARRAYS] = {
+    (uint64_t)SCENE_MAX_NUM_VERTICES * sizeof(Scene_Vertex),
+    (uint64_t)SCENE_MAX_NUM_HALF_EDGES * sizeof(Scene_HalfEdge),
+    (uint64_t)SCENE_MAX_NUM_FACES * sizeof(Scene_Face),
+};
+
+static uint64_t Scene_Snapshot_GetNumChunks(uint64_t size)
+{
+    return (size + SCENE_SNAPSHOT_CHUNK_SIZE - 1) / SCENE_SNAPSHOT_CHUNK_SIZE;
+}
+
+bool32_t Scene_Snapshot_Init(Scene_Snapshot* snapshot)
+{
+    memset(snapshot, 0, sizeof(Scene_Snapshot));
+
+    uint64_t max_num_chunks = 0;
+    uint64_t max_copy_size = 0;
+
+    for (uint32_t array = 0; array < SCENE_SNAPSHOT_NUM_ARRAYS; ++array)
+    {
+        max_num_chunks += Scene_Snapshot_GetNumChunks(Scene_Snapshot_MaxArraySizes[array]);
+        max_copy_size += Scene_Snapshot_MaxArraySizes[array] + Scene_Snapshot_GetNumChunks(Scene_Snapshot_MaxArraySizes[array]) * 16;
+    }
+
+    if (!Arena_CreateReserved(&snapshot->table_arena, max_num_chunks * sizeof(std::atomic<const uint8_t*>)) ||
+        !Arena_CreateReserved(&snapshot->copy_arena, max_copy_size))
+    {
+        Scene_Snapshot_Destroy(snapshot);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void Scene_Snapshot_Destroy(Scene_Snapshot* snapshot)
+{
+    ASSERT(!snapshot->scene);
+
+    Arena_Destroy(&snapshot->copy_arena);
+    Arena_Destroy(&snapshot->table_arena);
+
+    memset(snapshot, 0, sizeof(Scene_Snapshot));
+}
+
+bool32_t Scene_Snapshot_Take(Scene_Snapshot* snapshot, Scene* scene)
+{
+    ASSERT(!snapshot->scene);
+
+    if (scene->num_snapshots >= SCENE_MAX_NUM_SNAPSHOTS)
+        return FALSE;
+
+    // Readers get the planes without any way to recompute them
+    Scene_UpdateFacePlanes(scene);
+
+    snapshot->num_vertices   = scene->num_vertices;
+    snapshot->num_half_edges = scene->num_half_edges;
+    snapshot->num_faces      = scene->num_faces;
+
+    snapshot->num_deleted_vertices   = scene->num_deleted_vertices;
+    snapshot->num_deleted_half_edges = scene->num_deleted_half_edges;
+    snapshot->num_deleted_faces      = scene->num_deleted_faces;
+
+    snapshot->arrays[SCENE_SNAPSHOT_ARRAY_VERTICES]   = (const uint8_t*)scene->vertices;
+    snapshot->arrays[SCENE_SNAPSHOT_ARRAY_HALF_EDGES] = (const uint8_t*)scene->half_edges;
+    snapshot->arrays[SCENE_SNAPSHOT_ARRAY_FACES]      = (const uint8_t*)scene->faces;
+
+    snapshot->array_sizes[SCENE_SNAPSHOT_ARRAY_VERTICES]   = (uint64_t)scene->num_vertices * sizeof(Scene_Vertex);
+    snapshot->array_sizes[SCENE_SNAPSHOT_ARRAY_HALF_EDGES] = (uint64_t)scene->num_half_edges * sizeof(Scene_HalfEdge);
+    snapshot->array_sizes[SCENE_SNAPSHOT_ARRAY_FACES]      = (uint64_t)scene->num_faces * sizeof(Scene_Face);
+
+    // Release clears every table it used, so the tables come out of the arena zeroed like the memory the system commits
+    Arena_Reset(&snapshot->table_arena);
+
+    for (uint32_t array = 0; array < SCENE_SNAPSHOT_NUM_ARRAYS; ++array)
+    {
+        snapshot->chunk_copies[array] = ARENA_ALLOCATE_ARRAY(&snapshot->table_arena, std::atomic<const uint8_t*>, Scene_Snapshot_GetNumChunks(snapshot->array_sizes[array]));
+
+        ASSERT(snapshot->chunk_copies[array]);
+    }
+
+    snapshot->scene = scene;
+    scene->snapshots[scene->num_snapshots++] = snapshot;
+
+    return TRUE;
+}
+
+void Scene_Snapshot_Release(Scene_Snapshot* snapshot)
+{
+    Scene* scene = snapshot->scene;
+    ASSERT(scene);
+
+    for (uint32_t i = 0; i < scene->num_snapshots; ++i)
+    {
+        if (scene->snapshots[i] == snapshot)
+        {
+            scene->snapshots[i] = scene->snapshots[--scene->num_snapshots];
+            break;
+        }
+    }
+
+    for (uint32_t array = 0; array < SCENE_SNAPSHOT_NUM_ARRAYS; ++array)
+        memset((void*)snapshot->chunk_copies[array], 0, Scene_Snapshot_GetNumChunks(snapshot->array_sizes[array]) * sizeof(std::atomic<const uint8_t*>));
+
+    Arena_Reset(&snapshot->copy_arena);
+
+    snapshot->scene = NULL;
+}
+
+void Scene_Snapshot_PreserveRange(Scene* scene, uint32_t array, uint64_t offset, uint64_t size)
+{
+    for (uint32_t i = 0; i < scene->num_snapshots; ++i)
+    {
+        Scene_Snapshot* snapshot = scene->snapshots[i];
+
+        // Elements past the end of the snapshot are not part of it, no matter how they change
+        uint64_t array_size = snapshot->array_sizes[array];
+        if (offset >= array_size || size == 0)
+            continue;
+
+        uint64_t end = (offset + size < array_size) ? offset + size : array_size;
+
+        for (uint64_t chunk = offset / SCENE_SNAPSHOT_CHUNK_SIZE; chunk <= (end - 1) / SCENE_SNAPSHOT_CHUNK_SIZE; ++chunk)
+        {
+            std::atomic<const uint8_t*>* chunk_copy = snapshot->chunk_copies[array] + chunk;
+
+            // Only the editing thread sets the copies, so it sees its own stores without ordering
+            if (chunk_copy->load(std::memory_order_relaxed))
+                continue;
+
+            uint64_t chunk_offset = chunk * SCENE_SNAPSHOT_CHUNK_SIZE;
+            uint64_t chunk_size = (array_size - chunk_offset < SCENE_SNAPSHOT_CHUNK_SIZE) ? array_size - chunk_offset : SCENE_SNAPSHOT_CHUNK_SIZE;
+
+            uint8_t* copy = (uint8_t*)Arena_AllocateRegion(&snapshot->copy_arena, chunk_size, 16);
+
+            ASSERT(copy);
+
+            memcpy(copy, snapshot->arrays[array] + chunk_offset, chunk_size);
+            chunk_copy->store(copy, std::memory_order_release);
+        }
+    }
+
+    // The copies have to be visible before anything the caller changes next, readers rely on it (see Scene_Snapshot_ReadRange)
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void Scene_Snapshot_ReadRange(const Scene_Snapshot* snapshot, uint32_t array, uint64_t offset, uint64_t size, void* out_data)
+{
+    ASSERT(offset + size <= snapshot->array_sizes[array]);
+
+    uint8_t* out = (uint8_t*)out_data;
+
+    while (size > 0)
+    {
+        uint64_t chunk = offset / SCENE_SNAPSHOT_CHUNK_SIZE;
+        uint64_t chunk_offset = offset - chunk * SCENE_SNAPSHOT_CHUNK_SIZE;
+        uint64_t piece_size = SCENE_SNAPSHOT_CHUNK_SIZE - chunk_offset;
+        if (piece_size > size) piece_size = size;
+
+        const std::atomic<const uint8_t*>* chunk_copy = snapshot->chunk_copies[array] + chunk;
+        const uint8_t* copy = chunk_copy->load(std::memory_order_acquire);
+
+        if (!copy)
+        {
+            // The scene may start changing the chunk while it is read, but it copies the chunk first. If the copy is still
+            // missing after the read, nothing written after it can have been seen.
+            memcpy(out, snapshot->arrays[array] + offset, piece_size);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            copy = chunk_copy->load(std::memory_order_relaxed);
+        }
+
+        if (copy)
+            memcpy(out, copy + chunk_offset, piece_size);
+
+        offset += piece_size;
+        size -= piece_size;
+        out += piece_size;
+    }
+}
+
+void Scene_Snapshot_ReadVertices(const Scene_Snapshot* snapshot, uint32_t first_vertex, uint32_t num_vertices, Scene_Vertex* out_vertices)
+{
+    Scene_Snapshot_ReadRange(snapshot, SCENE_SNAPSHOT_ARRAY_VERTICES, (uint64_t)first_vertex * sizeof(Scene_Vertex), (uint64_t)num_vertices * sizeof(Scene_Vertex), out_vertices);
+}
+
+void Scene_Snapshot_ReadHalfEdges(const Scene_Snapshot* snapshot, uint32_t first_half_edge, uint32_t num_half_edges, Scene_HalfEdge* out_half_edges)
+{
+    Scene_Snapshot_ReadRange(snapshot, SCENE_SNAPSHOT_ARRAY_HALF_EDGES, (uint64_t)first_half_edge * sizeof(Scene_HalfEdge), (uint64_t)num_half_edges * sizeof(Scene_HalfEdge), out_half_edges);
+}
+
+void Scene_Snapshot_ReadFaces(const Scene_Snapshot* snapshot, uint32_t first_face, uint32_t num_faces, Scene_Face* out_faces)
+{
+    Scene_Snapshot_ReadRange(snapshot, SCENE_SNAPSHOT_ARRAY_FACES, (uint64_t)first_face * sizeof(Scene_Face), (uint64_t)num_faces * sizeof(Scene_Face), out_faces);
+}
@@ -0,0 +1,76 @@
+#ifndef SCENE_SNAPSHOT_HPP_
+#define SCENE_SNAPSHOT_HPP_
+
+#include "Common.hpp"
+#include "Arena.hpp"
+
+#include <atomic>
+
+// Snapshots keep the original of a topology array chunk of this many bytes once the scene changes something in it
+#define SCENE_SNAPSHOT_CHUNK_SIZE ((uint64_t)1 << 16)
+#define SCENE_MAX_NUM_SNAPSHOTS 4
+
+#define SCENE_SNAPSHOT_ARRAY_VERTICES 0
+#define SCENE_SNAPSHOT_ARRAY_HALF_EDGES 1
+#define SCENE_SNAPSHOT_ARRAY_FACES 2
+#define SCENE_SNAPSHOT_NUM_ARRAYS 3
+
+struct Scene;
+struct Scene_Vertex;
+struct Scene_HalfEdge;
+struct Scene_Face;
+
+// Consistent view of the topology of a scene at the time it was taken, which other threads can read while the scene is edited.
+// Taking it copies nothing, instead the scene copies every chunk of an array before it first changes something in it, and
+// readers take the chunks that were copied from the copies and all others from the scene.
+struct Scene_Snapshot
+{
+    Scene* scene; // NULL while the snapshot is not taken
+
+    uint32_t num_vertices;
+    uint32_t num_half_edges;
+    uint32_t num_faces;
+
+    uint32_t num_deleted_vertices;
+    uint32_t num_deleted_half_edges;
+    uint32_t num_deleted_faces;
+
+    // Arrays of the scene and how many of their bytes belong to the snapshot
+    const uint8_t* arrays[SCENE_SNAPSHOT_NUM_ARRAYS];
+    uint64_t       array_sizes[SCENE_SNAPSHOT_NUM_ARRAYS];
+
+    // Copy of every chunk of the arrays, NULL until the scene changed the chunk.
+    // NOTE: The tables are kept zeroed while the snapshot is not taken, so taking it does not have to clear them
+    std::atomic<const uint8_t*>* chunk_copies[SCENE_SNAPSHOT_NUM_ARRAYS];
+
+    Arena table_arena;
+    Arena copy_arena;
+};
+
+// Same as Scene_Save, but can run on another thread while the scene is edited
+bool32_t Scene_Snapshot_Save(const Scene_Snapshot* snapshot, const char* path);
+
+bool32_t Scene_Snapshot_Init(Scene_Snapshot* snapshot);
+
+void Scene_Snapshot_Destroy(Scene_Snapshot* snapshot);
+
+// Costs the same no matter how large the scene is, apart from recomputing face planes that are out of date.
+// Returns FALSE when SCENE_MAX_NUM_SNAPSHOTS snapshots are taken already.
+// NOTE: Taking and releasing have to happen on the thread that edits the scene, and the scene has to stay alive in between
+bool32_t Scene_Snapshot_Take(Scene_Snapshot* snapshot, Scene* scene);
+
+// NOTE: Nothing may read the snapshot anymore
+void Scene_Snapshot_Release(Scene_Snapshot* snapshot);
+
+// Copy elements of the snapshot out, any thread can call these while the scene is edited
+void Scene_Snapshot_ReadVertices(const Scene_Snapshot* snapshot, uint32_t first_vertex, uint32_t num_vertices, Scene_Vertex* out_vertices);
+void Scene_Snapshot_ReadHalfEdges(const Scene_Snapshot* snapshot, uint32_t first_half_edge, uint32_t num_half_edges, Scene_HalfEdge* out_half_edges);
+void Scene_Snapshot_ReadFaces(const Scene_Snapshot* snapshot, uint32_t first_face, uint32_t num_faces, Scene_Face* out_faces);
+
+// Copies size bytes of one of the arrays of the snapshot out, starting at the byte offset
+void Scene_Snapshot_ReadRange(const Scene_Snapshot* snapshot, uint32_t array, uint64_t offset, uint64_t size, void* out_data);
+
+// Copies the chunks of the byte range that the snapshots of the scene still need, see Scene_PrepareVertexWrite and friends
+void Scene_Snapshot_PreserveRange(Scene* scene, uint32_t array, uint64_t offset, uint64_t size);
+
+#endif // !SCENE_SNAPSHOT_HPP_
@@ -0,0 +1,317 @@
+#include "Scene.hpp"
+
+#include <math.h>
+#include <string.h>
+
+// Vertex scores of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+#define SCENE_VERTEX_CACHE_DECAY_POWER 1.5f
+#define SCENE_VERTEX_CACHE_LAST_TRIANGLE_SCORE 0.75f
+#define SCENE_VERTEX_CACHE_VALENCE_BOOST_SCALE 2.0f
+#define SCENE_VERTEX_CACHE_VALENCE_BOOST_POWER 0.5f
+
+// Valence boosts are looked up for corners with fewer triangles left than this
+#define SCENE_VERTEX_CACHE_NUM_VALENCE_SCORES 64
+
+struct Scene_VertexCache_Scratch
+{
+    // Per corner of the face
+    uint32_t* first_triangles;         // Start of the triangles that use the corner in corner_triangles
+    uint32_t* num_remaining_triangles; // Triangles that use the corner and were not emitted yet
+    uint32_t* cache_positions;         // Position in the modeled cache, SCENE_ID_NONE when not in it
+    float*    scores;
+
+    uint32_t* corner_triangles;
+    float*    triangle_scores; // Negative once the triangle was emitted
+    uint32_t* indices;         // Triangles in their new order
+
+    // The scores of Scene_VertexCache_GetVertexScore for every cache position and the first valences
+    float cache_scores[SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE];
+    float valence_scores[SCENE_VERTEX_CACHE_NUM_VALENCE_SCORES];
+};
+
+// Runs the triangles through a FIFO cache, every miss transforms a vertex. A vertex stays in the cache until
+// SCENE_VERTEX_CACHE_SIZE others were put in after it, so it is enough to remember when it was put in.
+static uint32_t Scene_VertexCache_CountTransforms(
+    const uint32_t* indices,
+    uint32_t        num_triangles,
+    uint32_t        first_vertex,
+    uint32_t        num_corners,
+    uint32_t*       insert_times,
+    uint32_t*       out_num_used_corners
+)
+{
+    for (uint32_t i = 0; i < num_corners; ++i)
+        insert_times[i] = SCENE_ID_NONE;
+
+    uint32_t num_transforms = 0;
+    uint32_t num_used_corners = 0;
+
+    for (uint32_t i = 0; i < 3 * num_triangles; ++i)
+    {
+        uint32_t corner = indices[i] - first_vertex;
+
+        if (insert_times[corner] != SCENE_ID_NONE && num_transforms - insert_times[corner] < SCENE_VERTEX_CACHE_SIZE)
+            continue;
+
+        num_used_corners += (insert_times[corner] == SCENE_ID_NONE);
+        insert_times[corner] = num_transforms++;
+    }
+
+    *out_num_used_corners = num_used_corners;
+    return num_transforms;
+}
+
+static float Scene_VertexCache_GetCacheScore(uint32_t cache_position)
+{
+    // The corners of the last triangle get a fixed score, so that the next triangle does not simply take the same two again
+    if (cache_position < 3)
+        return SCENE_VERTEX_CACHE_LAST_TRIANGLE_SCORE;
+
+    float scale = 1.0f / (float)(SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE - 3);
+    return powf(1.0f - (float)(cache_position - 3) * scale, SCENE_VERTEX_CACHE_DECAY_POWER);
+}
+
+// Corners with few triangles left are finished first, so that they do not have to be transformed again later
+static float Scene_VertexCache_GetValenceScore(uint32_t num_remaining_triangles)
+{
+    return SCENE_VERTEX_CACHE_VALENCE_BOOST_SCALE * powf((float)num_remaining_triangles, -SCENE_VERTEX_CACHE_VALENCE_BOOST_POWER);
+}
+
+static float Scene_VertexCache_GetVertexScore(const Scene_VertexCache_Scratch* scratch, uint32_t cache_position, uint32_t num_remaining_triangles)
+{
+    if (num_remaining_triangles == 0)
+        return -1.0f;
+
+    float score = (cache_position < SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE) ? scratch->cache_scores[cache_position] : 0.0f;
+
+    if (num_remaining_triangles < SCENE_VERTEX_CACHE_NUM_VALENCE_SCORES)
+        return score + scratch->valence_scores[num_remaining_triangles];
+
+    return score + Scene_VertexCache_GetValenceScore(num_remaining_triangles);
+}
+
+static float Scene_VertexCache_GetTriangleScore(const uint32_t* triangle, uint32_t first_vertex, const float* scores)
+{
+    return scores[triangle[0] - first_vertex] + scores[triangle[1] - first_vertex] + scores[triangle[2] - first_vertex];
+}
+
+// Emits the triangles greedily, always the one with the best score, and returns FALSE when the old order was not worse
+static bool32_t Scene_VertexCache_OptimizeFace(Scene* scene, uint32_t face_index, Scene_VertexCache_Scratch* scratch, Scene_VertexCacheStats* stats)
+{
+    uint32_t num_corners = scene->faces[face_index].num_half_edges;
+    uint32_t num_triangles = num_corners - 2;
+    uint32_t first_vertex = Scene_Face_GetFirstGeometryVertex(scene, face_index);
+    uint32_t* triangles = scene->geometry.triangle_indices + Scene_Face_GetFirstGeometryIndex(scene, face_index);
+
+    uint32_t num_used_corners;
+    uint32_t num_input_transforms = Scene_VertexCache_CountTransforms(triangles, num_triangles, first_vertex, num_corners, scratch->cache_positions, &num_used_corners);
+
+    stats->num_triangles += num_triangles;
+    stats->num_vertices += num_used_corners;
+    stats->num_input_transforms += num_input_transforms;
+
+    // Faces whose vertices are all transformed only once cannot get better, which is every face that fits into the cache
+    if (num_input_transforms == num_used_corners || num_corners > SCENE_VERTEX_CACHE_MAX_FACE_CORNERS)
+    {
+        stats->num_transforms += num_input_transforms;
+        return FALSE;
+    }
+
+    // Triangles of every corner, grouped by corner. The cache positions count the triangles added so far in the meantime.
+    memset(scratch->num_remaining_triangles, 0, num_corners * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < 3 * num_triangles; ++i)
+        ++scratch->num_remaining_triangles[triangles[i] - first_vertex];
+
+    uint32_t num_corner_triangles = 0;
+
+    for (uint32_t i = 0; i < num_corners; ++i)
+    {
+        scratch->first_triangles[i] = num_corner_triangles;
+        scratch->cache_positions[i] = 0;
+
+        num_corner_triangles += scratch->num_remaining_triangles[i];
+    }
+
+    for (uint32_t i = 0; i < 3 * num_triangles; ++i)
+    {
+        uint32_t corner = triangles[i] - first_vertex;
+        scratch->corner_triangles[scratch->first_triangles[corner] + scratch->cache_positions[corner]++] = i / 3;
+    }
+
+    for (uint32_t i = 0; i < num_corners; ++i)
+    {
+        scratch->cache_positions[i] = SCENE_ID_NONE;
+        scratch->scores[i] = Scene_VertexCache_GetVertexScore(scratch, SCENE_ID_NONE, scratch->num_remaining_triangles[i]);
+    }
+
+    uint32_t best_triangle = SCENE_ID_NONE;
+    float best_score = -1.0f;
+
+    for (uint32_t i = 0; i < num_triangles; ++i)
+    {
+        scratch->triangle_scores[i] = Scene_VertexCache_GetTriangleScore(triangles + 3 * i, first_vertex, scratch->scores);
+
+        if (scratch->triangle_scores[i] > best_score)
+        {
+            best_triangle = i;
+            best_score = scratch->triangle_scores[i];
+        }
+    }
+
+    uint32_t cache[SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE + 3];
+    uint32_t num_cached = 0;
+
+    for (uint32_t i = 0; i < num_triangles; ++i)
+    {
+        // NOTE: Only the triangles of corners that were in the cache are looked at after every step, when none of them is left
+        // the next triangle is searched among all
+        if (best_triangle == SCENE_ID_NONE)
+        {
+            for (uint32_t j = 0; j < num_triangles; ++j)
+            {
+                if (scratch->triangle_scores[j] > best_score)
+                {
+                    best_triangle = j;
+                    best_score = scratch->triangle_scores[j];
+                }
+            }
+        }
+
+        ASSERT(best_triangle != SCENE_ID_NONE);
+
+        const uint32_t* triangle = triangles + 3 * best_triangle;
+        memcpy(scratch->indices + 3 * i, triangle, 3 * sizeof(uint32_t));
+
+        scratch->triangle_scores[best_triangle] = -1.0f;
+
+        // The corners of the triangle go to the front of the cache and the others move back behind them
+        uint32_t new_cache[SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE + 3];
+        uint32_t num_new_cached = 0;
+
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            uint32_t corner = triangle[j] - first_vertex;
+            new_cache[num_new_cached++] = corner;
+
+            uint32_t* corner_triangles = scratch->corner_triangles + scratch->first_triangles[corner];
+            uint32_t num_remaining_triangles = scratch->num_remaining_triangles[corner];
+
+            for (uint32_t k = 0; k < num_remaining_triangles; ++k)
+            {
+                if (corner_triangles[k] == best_triangle)
+                {
+                    corner_triangles[k] = corner_triangles[num_remaining_triangles - 1];
+                    break;
+                }
+            }
+
+            --scratch->num_remaining_triangles[corner];
+        }
+
+        for (uint32_t j = 0; j < num_cached; ++j)
+        {
+            uint32_t corner = cache[j];
+
+            if (corner != new_cache[0] && corner != new_cache[1] && corner != new_cache[2])
+                new_cache[num_new_cached++] = corner;
+        }
+
+        // Corners that fell out of the cache are scored again as well
+        for (uint32_t j = 0; j < num_new_cached; ++j)
+        {
+            uint32_t corner = new_cache[j];
+
+            scratch->cache_positions[corner] = (j < SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE) ? j : SCENE_ID_NONE;
+            scratch->scores[corner] = Scene_VertexCache_GetVertexScore(scratch, scratch->cache_positions[corner], scratch->num_remaining_triangles[corner]);
+        }
+
+        best_triangle = SCENE_ID_NONE;
+        best_score = -1.0f;
+
+        for (uint32_t j = 0; j < num_new_cached; ++j)
+        {
+            uint32_t corner = new_cache[j];
+            const uint32_t* corner_triangles = scratch->corner_triangles + scratch->first_triangles[corner];
+
+            for (uint32_t k = 0; k < scratch->num_remaining_triangles[corner]; ++k)
+            {
+                uint32_t triangle_index = corner_triangles[k];
+                float score = Scene_VertexCache_GetTriangleScore(triangles + 3 * triangle_index, first_vertex, scratch->scores);
+
+                scratch->triangle_scores[triangle_index] = score;
+
+                if (score > best_score)
+                {
+                    best_triangle = triangle_index;
+                    best_score = score;
+                }
+            }
+        }
+
+        num_cached = (num_new_cached < SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE) ? num_new_cached : SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE;
+        memcpy(cache, new_cache, num_cached * sizeof(uint32_t));
+    }
+
+    uint32_t num_transforms = Scene_VertexCache_CountTransforms(scratch->indices, num_triangles, first_vertex, num_corners, scratch->cache_positions, &num_used_corners);
+
+    if (num_transforms >= num_input_transforms)
+    {
+        stats->num_transforms += num_input_transforms;
+        return FALSE;
+    }
+
+    memcpy(triangles, scratch->indices, 3 * num_triangles * sizeof(uint32_t));
+    stats->num_transforms += num_transforms;
+
+    return TRUE;
+}
+
+void Scene_OptimizeVertexCache(Scene* scene, uint32_t first_face, uint32_t num_faces, Scene_VertexCacheStats* stats)
+{
+    ASSERT(first_face + num_faces <= scene->num_faces);
+
+    // The triangles are reordered where they are cached
+    Scene_Geometry_UpdateTriangulations(scene);
+
+    const uint32_t max_num_corners = SCENE_VERTEX_CACHE_MAX_FACE_CORNERS;
+    const uint32_t max_num_triangles = max_num_corners - 2;
+
+    uint64_t scratch_offset = scene->scratch_arena.offset;
+
+    Scene_VertexCache_Scratch scratch;
+    scratch.first_triangles         = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, max_num_corners);
+    scratch.num_remaining_triangles = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, max_num_corners);
+    scratch.cache_positions         = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, max_num_corners);
+    scratch.scores                  = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, float, max_num_corners);
+    scratch.corner_triangles        = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, 3 * max_num_triangles);
+    scratch.triangle_scores         = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, float, max_num_triangles);
+    scratch.indices                 = ARENA_ALLOCATE_ARRAY(&scene->scratch_arena, uint32_t, 3 * max_num_triangles);
+
+    ASSERT(scratch.first_triangles && scratch.num_remaining_triangles && scratch.cache_positions && scratch.scores &&
+           scratch.corner_triangles && scratch.triangle_scores && scratch.indices);
+
+    for (uint32_t i = 0; i < SCENE_VERTEX_CACHE_SCORE_CACHE_SIZE; ++i)
+        scratch.cache_scores[i] = Scene_VertexCache_GetCacheScore(i);
+
+    // NOTE: Corners without triangles left never look up their valence
+    scratch.valence_scores[0] = 0.0f;
+
+    for (uint32_t i = 1; i < SCENE_VERTEX_CACHE_NUM_VALENCE_SCORES; ++i)
+        scratch.valence_scores[i] = Scene_VertexCache_GetValenceScore(i);
+
+    for (uint32_t face_index = first_face; face_index < first_face + num_faces; ++face_index)
+    {
+        if (Scene_Face_IsDeleted(scene, face_index))
+            continue;
+
+        // The triangles of a flat face never cover each other, so their order changes nothing but the cache
+        if (Scene_VertexCache_OptimizeFace(scene, face_index, &scratch, stats))
+        {
+            Scene_Geometry_MarkFaceForUpload(scene, face_index);
+            ++stats->num_reordered_faces;
+        }
+    }
+
+    Arena_Rewind(&scene->scratch_arena, scratch_offset);
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
 
 #include "Common.hpp"
 #include "OpenGL.hpp"
@@ -7,15 +8,26 @@
 #include "Geometry.hpp"
 #include "Arena.hpp"
 #include "Scene.hpp"
+#include "PVS.hpp"
+#include "Lightmap.hpp"
+#include "AO.hpp"
 #include "Camera.hpp"
+#include "Benchmark.hpp"
+#include "Jobs.hpp"
 
 #include <GLFW/glfw3.h>
 
+#include <atomic>
+#include <thread>
+
 #define EDITOR_GEOMETRY_PERMANENT_MAX_NUM_VERTICES 1024
 #define EDITOR_GEOMETRY_PERMANENT_MAX_NUM_INDICES 1024
 
-#define EDITOR_GEOMETRY_SCENE_MAX_NUM_VERTICES 1024
-#define EDITOR_GEOMETRY_SCENE_MAX_NUM_INDICES 1024
+// The scene buffers are sized for the scene they show, but never smaller than this
+#define EDITOR_GEOMETRY_SCENE_MIN_NUM_VERTICES 1024
+#define EDITOR_GEOMETRY_SCENE_MIN_NUM_INDICES 1024
+
+#define EDITOR_DEFAULT_LEVEL_PATH "level.fpsl"
 
 struct Editor_Geometry_Permanent_VertexBufferLayout
 {
@@ -27,15 +39,33 @@ struct Editor_Geometry_Permanent_IndexBufferLayout
     uint32_t indices[EDITOR_GEOMETRY_PERMANENT_MAX_NUM_INDICES];
 };
 
-struct Editor_Geometry_Scene_VertexBufferLayout
-{
-    SVertex vertices[EDITOR_GEOMETRY_SCENE_MAX_NUM_VERTICES];
-};
+#define EDITOR_PICK_RADIUS_IN_PIXELS 8.0f
 
-struct Editor_Geometry_Scene_IndexBufferLayout
-{  
-    uint32_t indices[EDITOR_GEOMETRY_SCENE_MAX_NUM_INDICES];
-};
+// Vertices closer than this are welded and faces whose corners are this close to a common plane are merged
+#define EDITOR_OPTIMIZE_WELD_DISTANCE 0.0001f
+#define EDITOR_OPTIMIZE_PLANE_DISTANCE 0.001f
+
+// The defragmenter starts on its own once this much of the scene is deleted, or on F12, and spreads its moves over the frames
+#define EDITOR_DEFRAG_MIN_DELETED_FRACTION 0.25f
+#define EDITOR_DEFRAG_NUM_MOVES_PER_FRAME 4096
+
+// Triangles are reordered for the vertex cache over the frames, this many faces at a time
+#define EDITOR_VERTEX_CACHE_NUM_FACES_PER_FRAME 16384
+
+// The potentially visible set samples this many rays from every cell of this size
+#define EDITOR_PVS_CELL_SIZE 4.0f
+#define EDITOR_PVS_NUM_RAYS_PER_CELL 256
+
+// The lightmap bakes this many tiles per frame while it is on, until every texel has its samples
+#define EDITOR_LIGHTMAP_TEXEL_SIZE 0.25f
+#define EDITOR_LIGHTMAP_NUM_SAMPLES 64
+#define EDITOR_LIGHTMAP_NUM_TILES_PER_FRAME 16
+#define EDITOR_LIGHTMAP_INFLUENCE_DISTANCE 4.0f
+
+// The ambient occlusion bakes this many vertices per frame while it is on
+#define EDITOR_AO_RADIUS 2.0f
+#define EDITOR_AO_NUM_RAYS 32
+#define EDITOR_AO_NUM_VERTICES_PER_FRAME 4096
 
 #define EDITOR_GEOMETRY_MAX_NUM_POINTS 128
 #define EDITOR_GEOMETRY_MAX_NUM_GRIDS 8
@@ -69,8 +99,15 @@ struct Editor_Geometry_Scene
     GLuint vbo;
     GLuint ebo;
 
+    uint32_t max_num_vertices;
+    uint32_t max_num_indices;
+
     uint32_t num_vertices;
     uint32_t num_indices;
+
+    // SPackedVertex instead of SVertex, which needs OpenGL_Shader_Scene_Packed_VertexSource
+    bool32_t use_packed_vertices;
+    uint32_t vertex_size;
 };
 
 struct Editor_Geometry
@@ -203,10 +240,15 @@ bool32_t Editor_Geometry_Permanent_Init(Editor_Geometry_Permanent* geometry)
     return TRUE;
 }
 
-bool32_t Editor_Geometry_Scene_Init(Editor_Geometry_Scene* geometry)
+bool32_t Editor_Geometry_Scene_Init(Editor_Geometry_Scene* geometry, uint32_t max_num_vertices, uint32_t max_num_indices, bool32_t use_packed_vertices)
 {
-    constexpr uint32_t vertex_buffer_size = sizeof(Editor_Geometry_Scene_VertexBufferLayout);
-    constexpr uint32_t index_buffer_size = sizeof(Editor_Geometry_Scene_IndexBufferLayout);
+    if (max_num_vertices < EDITOR_GEOMETRY_SCENE_MIN_NUM_VERTICES) max_num_vertices = EDITOR_GEOMETRY_SCENE_MIN_NUM_VERTICES;
+    if (max_num_indices < EDITOR_GEOMETRY_SCENE_MIN_NUM_INDICES) max_num_indices = EDITOR_GEOMETRY_SCENE_MIN_NUM_INDICES;
+
+    uint32_t vertex_size = use_packed_vertices ? sizeof(SPackedVertex) : sizeof(SVertex);
+
+    GLsizeiptr vertex_buffer_size = (GLsizeiptr)max_num_vertices * vertex_size;
+    GLsizeiptr index_buffer_size = (GLsizeiptr)max_num_indices * sizeof(uint32_t);
 
     GLuint buffers[2];
     glCreateBuffers(ARRAY_SIZE_U32(buffers), buffers);
@@ -248,10 +290,21 @@ bool32_t Editor_Geometry_Scene_Init(Editor_Geometry_Scene* geometry)
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, position));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, normal));
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, color));
-    glVertexAttribIPointer(3, 3, GL_UNSIGNED_INT, sizeof(SVertex), (const void*)offsetof(SVertex, cell_ids));
+    if (use_packed_vertices)
+    {
+        // The chunk follows the offset, so both come in as one attribute
+        glVertexAttribIPointer(0, 4, GL_UNSIGNED_SHORT, sizeof(SPackedVertex), (const void*)offsetof(SPackedVertex, position));
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(SPackedVertex), (const void*)offsetof(SPackedVertex, normal));
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SPackedVertex), (const void*)offsetof(SPackedVertex, color));
+        glVertexAttribIPointer(3, 2, GL_UNSIGNED_INT, sizeof(SPackedVertex), (const void*)offsetof(SPackedVertex, corner_id));
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, position));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, normal));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SVertex), (const void*)offsetof(SVertex, color));
+        glVertexAttribIPointer(3, 3, GL_UNSIGNED_INT, sizeof(SVertex), (const void*)offsetof(SVertex, cell_ids));
+    }
 
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
@@ -262,17 +315,26 @@ bool32_t Editor_Geometry_Scene_Init(Editor_Geometry_Scene* geometry)
     geometry->vao = vao;
     geometry->vbo = vbo;
     geometry->ebo = ebo;
+    geometry->max_num_vertices = max_num_vertices;
+    geometry->max_num_indices = max_num_indices;
     geometry->num_indices = 0;
+    geometry->use_packed_vertices = use_packed_vertices;
+    geometry->vertex_size = vertex_size;
 
     return TRUE;
 }
 
-bool32_t Editor_Geometry_Init(Editor_Geometry* geometry)
+bool32_t Editor_Geometry_Init(Editor_Geometry* geometry, const Scene* scene, bool32_t use_packed_vertices)
 {
     bool32_t init_permanent_geometry_result = Editor_Geometry_Permanent_Init(&geometry->permanent_geometry);
     ASSERT(init_permanent_geometry_result == TRUE);
 
-    bool32_t init_scene_geometry_result = Editor_Geometry_Scene_Init(&geometry->scene_geometry);
+    bool32_t init_scene_geometry_result = Editor_Geometry_Scene_Init(
+        &geometry->scene_geometry,
+        Scene_GetNumGeometryVertices(scene),
+        Scene_GetNumGeometryIndices(scene),
+        use_packed_vertices
+    );
     ASSERT(init_scene_geometry_result == TRUE);
 
     GLuint data_ssbo;
@@ -299,45 +361,85 @@ bool32_t Editor_Geometry_Init(Editor_Geometry* geometry)
     return TRUE;
 }
 
-bool32_t Editor_Geometry_Update(Editor_Geometry* geometry, const Scene* scene)
+bool32_t Editor_Geometry_Update(Editor_Geometry* geometry, Scene* scene)
 {
-    // Update the scene geometry first
+    // Update the scene geometry first, only the faces that changed are written and uploaded
     {
-        Editor_Geometry_Scene_VertexBufferLayout* vertex_buffer_data = (Editor_Geometry_Scene_VertexBufferLayout*)glMapNamedBuffer(
-            geometry->scene_geometry.vbo,
-            GL_WRITE_ONLY
-        );
+        Editor_Geometry_Scene* scene_geometry = &geometry->scene_geometry;
 
-        ASSERT(vertex_buffer_data != NULL);
+        uint32_t num_runs = Scene_Geometry_CollectDirtyRuns(scene);
 
-        Editor_Geometry_Scene_IndexBufferLayout* index_buffer_data = (Editor_Geometry_Scene_IndexBufferLayout*)glMapNamedBuffer(
-            geometry->scene_geometry.ebo,
-            GL_WRITE_ONLY
-        );
+        if (num_runs > 0)
+        {
+            const Scene_Geometry_Run* first_run = scene->geometry.runs;
+            const Scene_Geometry_Run* last_run = scene->geometry.runs + num_runs - 1;
 
-        ASSERT(index_buffer_data != NULL);
-
-        uint32_t num_vertices, num_indices;
-        bool32_t generate_geometry_result = Scene_GenerateGeometry(
-            scene,
-            vertex_buffer_data->vertices,
-            EDITOR_GEOMETRY_SCENE_MAX_NUM_VERTICES,
-            index_buffer_data->indices,
-            EDITOR_GEOMETRY_SCENE_MAX_NUM_INDICES,
-            &num_vertices,
-            &num_indices
-        );
-        
-        ASSERT(generate_geometry_result == TRUE);
+            // One range covering all runs is mapped, but only the runs themselves are flushed
+            uint32_t first_vertex = first_run->first_vertex;
+            uint32_t end_vertex = last_run->first_vertex + last_run->num_vertices;
+
+            uint32_t first_index = first_run->first_index;
+            uint32_t end_index = last_run->first_index + last_run->num_indices;
 
-        bool32_t unmap_vbo_result = glUnmapNamedBuffer(geometry->scene_geometry.vbo);
-        ASSERT(unmap_vbo_result == TRUE);
+            ASSERT(end_vertex <= scene_geometry->max_num_vertices);
+            ASSERT(end_index <= scene_geometry->max_num_indices);
 
-        bool32_t unmap_ebo_result = glUnmapNamedBuffer(geometry->scene_geometry.ebo);
-        ASSERT(unmap_ebo_result == TRUE);
+            uint8_t* vertex_buffer_data = (uint8_t*)glMapNamedBufferRange(
+                scene_geometry->vbo,
+                (GLintptr)first_vertex * scene_geometry->vertex_size,
+                (GLsizeiptr)(end_vertex - first_vertex) * scene_geometry->vertex_size,
+                GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+            );
+
+            ASSERT(vertex_buffer_data != NULL);
+
+            uint32_t* index_buffer_data = (uint32_t*)glMapNamedBufferRange(
+                scene_geometry->ebo,
+                (GLintptr)first_index * sizeof(uint32_t),
+                (GLsizeiptr)(end_index - first_index) * sizeof(uint32_t),
+                GL_MAP_WRITE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT
+            );
+
+            ASSERT(index_buffer_data != NULL);
+
+            for (uint32_t i = 0; i < num_runs; ++i)
+            {
+                const Scene_Geometry_Run* run = scene->geometry.runs + i;
+
+                uint32_t mapped_vertex_offset = run->first_vertex - first_vertex;
+                uint32_t mapped_index_offset = run->first_index - first_index;
+
+                void* run_vertices = vertex_buffer_data + (uint64_t)mapped_vertex_offset * scene_geometry->vertex_size;
+
+                if (scene_geometry->use_packed_vertices)
+                    Scene_Geometry_WritePackedFaces(scene, run->first_face, run->num_faces, (SPackedVertex*)run_vertices, index_buffer_data + mapped_index_offset);
+                else
+                    Scene_Geometry_WriteFaces(scene, run->first_face, run->num_faces, (SVertex*)run_vertices, index_buffer_data + mapped_index_offset);
+
+                glFlushMappedNamedBufferRange(
+                    scene_geometry->vbo,
+                    (GLintptr)mapped_vertex_offset * scene_geometry->vertex_size,
+                    (GLsizeiptr)run->num_vertices * scene_geometry->vertex_size
+                );
+
+                glFlushMappedNamedBufferRange(
+                    scene_geometry->ebo,
+                    (GLintptr)mapped_index_offset * sizeof(uint32_t),
+                    (GLsizeiptr)run->num_indices * sizeof(uint32_t)
+                );
+            }
 
-        geometry->scene_geometry.num_vertices = num_vertices;
-        geometry->scene_geometry.num_indices = num_indices;
+            bool32_t unmap_vbo_result = glUnmapNamedBuffer(scene_geometry->vbo);
+            ASSERT(unmap_vbo_result == TRUE);
+
+            bool32_t unmap_ebo_result = glUnmapNamedBuffer(scene_geometry->ebo);
+            ASSERT(unmap_ebo_result == TRUE);
+        }
+
+        Scene_Geometry_ClearDirty(scene);
+
+        scene_geometry->num_vertices = Scene_GetNumGeometryVertices(scene);
+        scene_geometry->num_indices = Scene_GetNumGeometryIndices(scene);
     }
 
     // Set the SSBO data
@@ -345,14 +447,19 @@ bool32_t Editor_Geometry_Update(Editor_Geometry* geometry, const Scene* scene)
         Editor_Geometry_DataSSBOLayout* data = (Editor_Geometry_DataSSBOLayout*)glMapNamedBuffer(geometry->data_ssbo, GL_WRITE_ONLY);
         ASSERT(data != NULL);
 
-        for (uint32_t i = 0; i < scene->num_vertices; ++i)
+        // NOTE: The scene can grow past the SSBO, the extra vertices are not drawn as points
+        uint32_t num_points = scene->num_vertices;
+        if (num_points > EDITOR_GEOMETRY_MAX_NUM_POINTS) num_points = EDITOR_GEOMETRY_MAX_NUM_POINTS;
+
+        for (uint32_t i = 0; i < num_points; ++i)
         {
             const Scene_Vertex* vertex = scene->vertices + i;
 
-            data->point_positions[i] = glm::vec4(vertex->position, 1.0f);
+            // NOTE: Deleted vertices are marked with a zero w, the point shader moves them out of view
+            data->point_positions[i] = glm::vec4(vertex->position, Scene_Vertex_IsDeleted(scene, i) ? 0.0f : 1.0f);
         }
 
-        geometry->num_points = scene->num_vertices;
+        geometry->num_points = num_points;
 
         GLboolean unmap_result = glUnmapNamedBuffer(geometry->data_ssbo);
         ASSERT(unmap_result == GL_TRUE);
@@ -370,10 +477,21 @@ static bool32_t Input_Key_Pressed_D;
 static bool32_t Input_Key_Pressed_Space;
 static bool32_t Input_Key_Pressed_Shift;
 
+static bool32_t Input_SaveRequested;
+static bool32_t Input_ReorderRequested;
+static bool32_t Input_DeleteRequested;
+static bool32_t Input_OptimizeRequested;
+static bool32_t Input_VertexCacheRequested;
+static bool32_t Input_PVSRequested;
+static bool32_t Input_LightmapToggleRequested;
+static bool32_t Input_AOToggleRequested;
+static bool32_t Input_DefragRequested;
+static uint32_t Input_NumUndoRequests;
+static uint32_t Input_NumRedoRequests;
+
 static void Input_KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     UNUSED(window);
-    UNUSED(mods);
     UNUSED(scancode);
 
     if (action == GLFW_PRESS || action == GLFW_RELEASE)
@@ -390,6 +508,55 @@ static void Input_KeyCallback(GLFWwindow* window, int key, int scancode, int act
         case GLFW_KEY_LEFT_SHIFT:
             Input_Key_Pressed_Shift = (action == GLFW_PRESS);
             break;
+
+        case GLFW_KEY_F5:
+            if (action == GLFW_PRESS) Input_SaveRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F6:
+            if (action == GLFW_PRESS) Input_ReorderRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F7:
+            if (action == GLFW_PRESS) Input_OptimizeRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F8:
+            if (action == GLFW_PRESS) Input_VertexCacheRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F9:
+            if (action == GLFW_PRESS) Input_PVSRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F10:
+            if (action == GLFW_PRESS) Input_LightmapToggleRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F11:
+            if (action == GLFW_PRESS) Input_AOToggleRequested = TRUE;
+            break;
+
+        case GLFW_KEY_F12:
+            if (action == GLFW_PRESS) Input_DefragRequested = TRUE;
+            break;
+
+        case GLFW_KEY_DELETE:
+            if (action == GLFW_PRESS) Input_DeleteRequested = TRUE;
+            break;
+
+        // Ctrl+Z undoes, Ctrl+Y and Ctrl+Shift+Z redo
+        case GLFW_KEY_Z:
+            if (action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL))
+            {
+                if (mods & GLFW_MOD_SHIFT) ++Input_NumRedoRequests;
+                else ++Input_NumUndoRequests;
+            }
+            break;
+
+        case GLFW_KEY_Y:
+            if (action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL)) ++Input_NumRedoRequests;
+            break;
         }
     }
 }
@@ -444,14 +611,575 @@ static void Input_MouseButtonCallback(GLFWwindow* window, int button, int action
     }
 }
 
-int main(int, char**)
+static bool32_t Editor_HasExtension(const char* path, const char* extension)
+{
+    size_t path_length = strlen(path);
+    size_t extension_length = strlen(extension);
+
+    if (path_length < extension_length)
+        return FALSE;
+
+    for (size_t i = 0; i < extension_length; ++i)
+    {
+        char c = path[path_length - extension_length + i];
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+
+        if (c != extension[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Levels are written from a snapshot on a thread of their own, so editing goes on while the file is written
+struct Editor_Save
+{
+    Scene_Snapshot snapshot;
+    const char* path;
+
+    std::thread thread;
+    std::atomic<bool32_t> is_done;
+    bool32_t is_running;
+    bool32_t result;
+};
+
+static void Editor_Save_Run(Editor_Save* save)
+{
+    save->result = Scene_Snapshot_Save(&save->snapshot, save->path);
+    save->is_done.store(TRUE, std::memory_order_release);
+}
+
+// Returns FALSE while the last save is still running
+static bool32_t Editor_Save_Start(Editor_Save* save, Scene* scene, const char* path)
+{
+    if (save->is_running)
+        return FALSE;
+
+    bool32_t take_result = Scene_Snapshot_Take(&save->snapshot, scene);
+    ASSERT(take_result == TRUE);
+
+    save->path = path;
+    save->is_done.store(FALSE, std::memory_order_relaxed);
+    save->is_running = TRUE;
+    save->thread = std::thread(Editor_Save_Run, save);
+
+    return TRUE;
+}
+
+static void Editor_Save_Finish(Editor_Save* save, bool32_t wait)
+{
+    if (!save->is_running || (!wait && !save->is_done.load(std::memory_order_acquire)))
+        return;
+
+    save->thread.join();
+    Scene_Snapshot_Release(&save->snapshot);
+    save->is_running = FALSE;
+
+    if (save->result)
+        printf("Saved the level to %s.\n", save->path);
+    else
+        fprintf(stderr, "Could not save the level to %s.\n", save->path);
+}
+
+// Returns FALSE when the scene was left alone
+static bool32_t Editor_Optimize(Scene* scene)
+{
+    Scene_OptimizeStats stats;
+
+    double start_time = glfwGetTime();
+    bool32_t optimize_result = Scene_Optimize(scene, EDITOR_OPTIMIZE_WELD_DISTANCE, EDITOR_OPTIMIZE_PLANE_DISTANCE, &stats);
+    double seconds = glfwGetTime() - start_time;
+
+    printf(
+        "Optimized the level in %.1f ms: %u -> %u vertices (%u welded), %u -> %u faces (%u merged, %u skipped), %u -> %u triangles, %u -> %u geometry vertices.\n",
+        seconds * 1e3,
+        stats.num_input_vertices,
+        stats.num_vertices,
+        stats.num_welded_vertices,
+        stats.num_input_faces,
+        stats.num_faces,
+        stats.num_merged_faces,
+        stats.num_skipped_faces,
+        stats.num_input_triangles,
+        stats.num_triangles,
+        stats.num_input_geometry_vertices,
+        stats.num_geometry_vertices
+    );
+
+    return optimize_result;
+}
+
+// Pass of Scene_OptimizeVertexCache over the whole scene, spread over the frames
+struct Editor_VertexCachePass
+{
+    bool32_t is_running;
+    uint32_t next_face;
+    double   seconds;
+
+    Scene_VertexCacheStats stats;
+};
+
+static void Editor_VertexCachePass_Start(Editor_VertexCachePass* pass)
+{
+    memset(pass, 0, sizeof(Editor_VertexCachePass));
+    pass->is_running = TRUE;
+}
+
+static void Editor_VertexCachePass_Step(Editor_VertexCachePass* pass, Scene* scene, uint32_t max_num_faces)
+{
+    if (!pass->is_running)
+        return;
+
+    // Faces removed in the meantime are simply not looked at
+    uint32_t num_faces = (pass->next_face < scene->num_faces) ? scene->num_faces - pass->next_face : 0;
+    if (num_faces > max_num_faces) num_faces = max_num_faces;
+
+    double start_time = glfwGetTime();
+    Scene_OptimizeVertexCache(scene, pass->next_face, num_faces, &pass->stats);
+    pass->seconds += glfwGetTime() - start_time;
+
+    pass->next_face += num_faces;
+
+    if (pass->next_face < scene->num_faces)
+        return;
+
+    pass->is_running = FALSE;
+
+    const Scene_VertexCacheStats* stats = &pass->stats;
+    double num_triangles = (stats->num_triangles > 0) ? (double)stats->num_triangles : 1.0;
+    double num_vertices = (stats->num_vertices > 0) ? (double)stats->num_vertices : 1.0;
+
+    printf(
+        "Reordered the triangles of %u faces for the vertex cache in %.1f ms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f.\n",
+        stats->num_reordered_faces,
+        pass->seconds * 1e3,
+        (double)stats->num_input_transforms / num_triangles,
+        (double)stats->num_transforms / num_triangles,
+        (double)stats->num_input_transforms / num_vertices,
+        (double)stats->num_transforms / num_vertices
+    );
+}
+
+static void Editor_BuildPVS(PVS* pvs, Scene* scene)
+{
+    PVS_BuildStats stats;
+
+    double start_time = glfwGetTime();
+    bool32_t build_result = PVS_Build(pvs, scene, EDITOR_PVS_CELL_SIZE, EDITOR_PVS_NUM_RAYS_PER_CELL, &stats);
+    double seconds = glfwGetTime() - start_time;
+
+    if (!build_result)
+    {
+        fprintf(stderr, "Could not build the potentially visible set.\n");
+        return;
+    }
+
+    printf(
+        "Built the potentially visible set in %.1f ms: %u cells of size %.2f, %u clusters, %.1f%% visible on average, %.1f KB (%.1f KB uncompressed).\n",
+        seconds * 1e3,
+        stats.num_cells,
+        stats.cell_size,
+        stats.num_clusters,
+        100.0 * (double)stats.num_visible_clusters / ((double)stats.num_cells * (double)stats.num_clusters),
+        stats.num_data_bytes / 1024.0,
+        stats.num_row_bytes / 1024.0
+    );
+}
+
+// Storage buffer of a baker, it is created again once the elements do not fit anymore
+struct Editor_BakeBuffer
+{
+    GLuint   ssbo;
+    uint32_t max_num_elements;
+};
+
+static void Editor_BakeBuffer_Destroy(Editor_BakeBuffer* buffer)
+{
+    if (buffer->ssbo != 0)
+        glDeleteBuffers(1, &buffer->ssbo);
+}
+
+// Uploads the elements from dirty_begin to dirty_end, or all of them when the buffer had to be created again
+static void Editor_BakeBuffer_Upload(
+    Editor_BakeBuffer* buffer,
+    const void*        elements,
+    uint64_t           element_size,
+    uint32_t           num_elements,
+    uint32_t           dirty_begin,
+    uint32_t           dirty_end
+)
+{
+    if (num_elements > buffer->max_num_elements)
+    {
+        Editor_BakeBuffer_Destroy(buffer);
+
+        // Doubled, so that adding faces one by one does not create the buffer every time
+        uint32_t max_num_elements = buffer->max_num_elements * 2;
+        if (max_num_elements < num_elements) max_num_elements = num_elements;
+
+        glCreateBuffers(1, &buffer->ssbo);
+        glNamedBufferStorage(buffer->ssbo, (GLsizeiptr)(max_num_elements * element_size), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+        buffer->max_num_elements = max_num_elements;
+
+        dirty_begin = 0;
+        dirty_end = num_elements;
+    }
+
+    if (dirty_end > num_elements)
+        dirty_end = num_elements;
+
+    if (dirty_begin < dirty_end)
+    {
+        glNamedBufferSubData(
+            buffer->ssbo,
+            (GLintptr)(dirty_begin * element_size),
+            (GLsizeiptr)((dirty_end - dirty_begin) * element_size),
+            (const uint8_t*)elements + dirty_begin * element_size
+        );
+    }
+}
+
+// Of the bake that is running, printed when it is done
+struct Editor_BakeProgress
+{
+    bool32_t is_baking;
+    double   seconds;
+    uint64_t num_rays;
+    uint32_t num_reset_elements;
+};
+
+// Adds a step that reset or baked anything to the bake, and prints the bake once nothing is pending anymore
+static void Editor_BakeProgress_Step(
+    Editor_BakeProgress* progress,
+    const char*          name,
+    const char*          element_name,
+    double               seconds,
+    uint64_t             num_rays,
+    uint32_t             num_baked_elements,
+    uint32_t             num_reset_elements,
+    uint32_t             num_pending_elements
+)
+{
+    if (num_baked_elements > 0 || num_reset_elements > 0)
+    {
+        progress->is_baking = TRUE;
+        progress->seconds += seconds;
+        progress->num_rays += num_rays;
+        progress->num_reset_elements += num_reset_elements;
+    }
+
+    if (!progress->is_baking || num_pending_elements > 0)
+        return;
+
+    double rate_seconds = (progress->seconds > 0.0) ? progress->seconds : 1.0;
+
+    printf(
+        "Baked the %s in %.1f ms: %u %s baked, %.2f M rays/s.\n",
+        name,
+        progress->seconds * 1e3,
+        progress->num_reset_elements,
+        element_name,
+        (double)progress->num_rays / rate_seconds * 1e-6
+    );
+
+    memset(progress, 0, sizeof(Editor_BakeProgress));
+}
+
+// Lightmap of the scene and the texture and chart planes the scene shader reads it from
+struct Editor_Lightmap
+{
+    Lightmap lightmap;
+
+    GLuint            texture;
+    Editor_BakeBuffer chart_buffer; // Two planes per face
+
+    bool32_t            is_enabled;
+    Editor_BakeProgress bake_progress;
+};
+
+static bool32_t Editor_Lightmap_Init(Editor_Lightmap* editor_lightmap)
+{
+    memset(editor_lightmap, 0, sizeof(Editor_Lightmap));
+
+    Lightmap_Settings settings;
+    settings.texel_size = EDITOR_LIGHTMAP_TEXEL_SIZE;
+    settings.num_samples = EDITOR_LIGHTMAP_NUM_SAMPLES;
+    settings.sun_direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f));
+    settings.sun_color = { 1.0f, 0.95f, 0.85f };
+    settings.sky_color = { 0.3f, 0.35f, 0.45f };
+    settings.bounce_albedo = 0.8f;
+    settings.influence_distance = EDITOR_LIGHTMAP_INFLUENCE_DISTANCE;
+
+    if (!Lightmap_Init(&editor_lightmap->lightmap, &settings))
+        return FALSE;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &editor_lightmap->texture);
+    glTextureStorage2D(editor_lightmap->texture, 1, GL_RGBA8, LIGHTMAP_ATLAS_SIZE, LIGHTMAP_ATLAS_SIZE);
+
+    glTextureParameteri(editor_lightmap->texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(editor_lightmap->texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(editor_lightmap->texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(editor_lightmap->texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    return TRUE;
+}
+
+static void Editor_Lightmap_Destroy(Editor_Lightmap* editor_lightmap)
+{
+    Editor_BakeBuffer_Destroy(&editor_lightmap->chart_buffer);
+
+    glDeleteTextures(1, &editor_lightmap->texture);
+
+    Lightmap_Destroy(&editor_lightmap->lightmap);
+}
+
+// Uploads the texel rows and chart planes that changed since the last upload
+static void Editor_Lightmap_Upload(Editor_Lightmap* editor_lightmap)
+{
+    Lightmap* lightmap = &editor_lightmap->lightmap;
+
+    if (lightmap->dirty_row_begin < lightmap->dirty_row_end)
+    {
+        glTextureSubImage2D(
+            editor_lightmap->texture,
+            0,
+            0,
+            (GLint)lightmap->dirty_row_begin,
+            LIGHTMAP_ATLAS_SIZE,
+            (GLsizei)(lightmap->dirty_row_end - lightmap->dirty_row_begin),
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            lightmap->texel_colors + (uint64_t)lightmap->dirty_row_begin * LIGHTMAP_ATLAS_SIZE
+        );
+    }
+
+    Editor_BakeBuffer_Upload(
+        &editor_lightmap->chart_buffer,
+        lightmap->chart_planes,
+        2 * sizeof(glm::vec4),
+        lightmap->num_faces,
+        lightmap->dirty_face_begin,
+        lightmap->dirty_face_end
+    );
+
+    Lightmap_ClearDirty(lightmap);
+}
+
+// Updates the charts to the edits of the scene and bakes a few tiles, the lightmap fills in over the frames
+static void Editor_Lightmap_Step(Editor_Lightmap* editor_lightmap, Scene* scene)
 {
+    if (!editor_lightmap->is_enabled)
+        return;
+
+    Lightmap* lightmap = &editor_lightmap->lightmap;
+
+    double start_time = glfwGetTime();
+
+    Lightmap_UpdateStats update_stats;
+    if (!Lightmap_Update(lightmap, scene, &update_stats))
+    {
+        fprintf(stderr, "The lightmap charts of %u faces do not fit into the atlas, turning the lightmap off.\n", scene->num_faces);
+
+        editor_lightmap->is_enabled = FALSE;
+        memset(&editor_lightmap->bake_progress, 0, sizeof(Editor_BakeProgress));
+        return;
+    }
+
+    Lightmap_BakeStats bake_stats;
+    uint32_t num_pending_tiles = Lightmap_Bake(lightmap, scene, EDITOR_LIGHTMAP_NUM_TILES_PER_FRAME, &bake_stats);
+
+    Editor_BakeProgress_Step(
+        &editor_lightmap->bake_progress,
+        "lightmap",
+        "charts",
+        glfwGetTime() - start_time,
+        bake_stats.num_rays,
+        bake_stats.num_tiles,
+        update_stats.num_reset_charts,
+        num_pending_tiles
+    );
+
+    Editor_Lightmap_Upload(editor_lightmap);
+}
+
+// Ambient occlusion of the scene vertices and the buffer the scene shader reads it from
+struct Editor_AO
+{
+    AO ao;
+
+    Editor_BakeBuffer value_buffer; // One value per vertex
+
+    bool32_t            is_enabled;
+    Editor_BakeProgress bake_progress;
+};
+
+static bool32_t Editor_AO_Init(Editor_AO* editor_ao)
+{
+    memset(editor_ao, 0, sizeof(Editor_AO));
+
+    AO_Settings settings;
+    settings.radius = EDITOR_AO_RADIUS;
+    settings.num_rays = EDITOR_AO_NUM_RAYS;
+
+    return AO_Init(&editor_ao->ao, &settings);
+}
+
+static void Editor_AO_Destroy(Editor_AO* editor_ao)
+{
+    Editor_BakeBuffer_Destroy(&editor_ao->value_buffer);
+
+    AO_Destroy(&editor_ao->ao);
+}
+
+// Follows the edits of the scene and bakes a few vertices, the occlusion fills in over the frames. Unlike the lightmap
+// there is no atlas to run out of, so it stays on.
+static void Editor_AO_Step(Editor_AO* editor_ao, Scene* scene)
+{
+    if (!editor_ao->is_enabled)
+        return;
+
+    AO* ao = &editor_ao->ao;
+
+    double start_time = glfwGetTime();
+
+    AO_UpdateStats update_stats;
+    AO_Update(ao, scene, &update_stats);
+
+    AO_BakeStats bake_stats;
+    uint32_t num_pending_vertices = AO_Bake(ao, scene, EDITOR_AO_NUM_VERTICES_PER_FRAME, &bake_stats);
+
+    Editor_BakeProgress_Step(
+        &editor_ao->bake_progress,
+        "ambient occlusion",
+        "vertices",
+        glfwGetTime() - start_time,
+        bake_stats.num_rays,
+        bake_stats.num_vertices,
+        update_stats.num_reset_vertices,
+        num_pending_vertices
+    );
+
+    Editor_BakeBuffer_Upload(&editor_ao->value_buffer, ao->values, sizeof(float), ao->num_vertices, ao->dirty_vertex_begin, ao->dirty_vertex_end);
+    AO_ClearDirty(ao);
+}
+
+// Clusters that are drawn in a frame and the draws they are merged into
+struct Editor_ClusterDraw
+{
+    // Empty between frames
+    Arena arena;
+
+    uint32_t kernel;
+};
+
+static bool32_t Editor_ClusterDraw_Init(Editor_ClusterDraw* draw)
+{
+    memset(draw, 0, sizeof(Editor_ClusterDraw));
+    draw->kernel = Scene_Clusters_GetBestKernel();
+
+    return Arena_CreateReserved(&draw->arena, (uint64_t)SCENE_MAX_NUM_CLUSTERS * (sizeof(uint32_t) + sizeof(GLsizei) + sizeof(const void*)) + ARENA_COMMIT_GRANULARITY);
+}
+
+static void Editor_ClusterDraw_Destroy(Editor_ClusterDraw* draw)
+{
+    Arena_Destroy(&draw->arena);
+}
+
+// Draws the triangles of the clusters in the view frustum that the potentially visible set lets through, when there is one.
+// Runs of consecutive clusters are merged into one draw.
+static void Editor_ClusterDraw_Draw(Editor_ClusterDraw* draw, Scene* scene, const glm::mat4* view_projection, const uint8_t* pvs_visible_clusters)
+{
+    Scene_Clusters_Update(scene);
+
+    uint32_t num_clusters = Scene_GetNumClusters(scene);
+
+    Arena_Reset(&draw->arena);
+
+    uint32_t* cluster_indices = ARENA_ALLOCATE_ARRAY(&draw->arena, uint32_t, num_clusters);
+    GLsizei* counts = ARENA_ALLOCATE_ARRAY(&draw->arena, GLsizei, num_clusters);
+    const void** offsets = ARENA_ALLOCATE_ARRAY(&draw->arena, const void*, num_clusters);
+
+    ASSERT(cluster_indices && counts && offsets);
+
+    uint32_t num_visible_clusters = Scene_Clusters_CullFrustum(scene, draw->kernel, view_projection, cluster_indices);
+
+    GLsizei num_draws = 0;
+    uint32_t end_index = UINT32_MAX;
+
+    for (uint32_t i = 0; i < num_visible_clusters; ++i)
+    {
+        uint32_t cluster_index = cluster_indices[i];
+
+        if (pvs_visible_clusters && (pvs_visible_clusters[cluster_index / 8] & (1 << (cluster_index % 8))) == 0)
+            continue;
+
+        uint32_t first_index, num_indices;
+        Scene_Cluster_GetGeometryIndices(scene, cluster_index, &first_index, &num_indices);
+
+        if (first_index == end_index)
+        {
+            counts[num_draws - 1] += num_indices;
+        }
+        else
+        {
+            counts[num_draws] = num_indices;
+            offsets[num_draws] = (const void*)((uint64_t)first_index * sizeof(uint32_t));
+            ++num_draws;
+        }
+
+        end_index = first_index + num_indices;
+    }
+
+    if (num_draws > 0)
+        glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, num_draws);
+
+    Arena_Reset(&draw->arena);
+}
+
+int main(int argc, char** argv)
+{
+    bool32_t jobs_init_result = Jobs_Init(0);
+    ASSERT(jobs_init_result == TRUE);
+
+    if (argc >= 2 && strcmp(argv[1], "--benchmark") == 0)
+    {
+        bool32_t benchmark_result = (argc >= 3) && Benchmark_Run(argv[2]);
+        if (!benchmark_result)
+            Benchmark_PrintAvailable();
+
+        Jobs_Shutdown();
+        return benchmark_result ? 0 : 1;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "--check") == 0)
+    {
+        bool32_t check_result = Benchmark_Check((argc >= 3) ? argv[2] : NULL);
+
+        Jobs_Shutdown();
+        return check_result ? 0 : 1;
+    }
+
+    // Options may come before or after the path of the level or mesh
+    const char* input_path = NULL;
+    bool32_t use_packed_vertices = FALSE;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--packed-vertices") == 0)
+            use_packed_vertices = TRUE;
+        else if (!input_path)
+            input_path = argv[i];
+    }
+
     const int window_width = 1280;
     const int window_height = 720;
 
     if (!glfwInit())
     {
         fprintf(stderr, "glfwInit failed.\n");
+
+        Jobs_Shutdown();
         return 1;
     }
 
@@ -471,6 +1199,7 @@ int main(int, char**)
         fprintf(stderr, "glfwCreateWindow failed.\n");
 
         glfwTerminate();
+        Jobs_Shutdown();
         return 1;
     }
 
@@ -488,6 +1217,7 @@ int main(int, char**)
         fprintf(stderr, "Extension \"GL_ARB_shader_draw_parameters\" is not available.");
 
         glfwTerminate();
+        Jobs_Shutdown();
         return 1;
     }
 
@@ -522,7 +1252,10 @@ int main(int, char**)
         }
     }
 
-    GLuint program_scene = OpenGL_Shader_CreateProgramFromSources(OpenGL_Shader_Scene_VertexSource, OpenGL_Shader_Scene_FragmentSource);
+    GLuint program_scene = OpenGL_Shader_CreateProgramFromSources(
+        use_packed_vertices ? OpenGL_Shader_Scene_Packed_VertexSource : OpenGL_Shader_Scene_VertexSource,
+        OpenGL_Shader_Scene_FragmentSource
+    );
     ASSERT(program_scene != 0);
 
     GLuint program_editor_geometry;
@@ -550,40 +1283,141 @@ int main(int, char**)
         glDeleteShader(shaders[2]);
     }
 
-    Scene scene = {};
+    // A level given on the command line is opened and saved back to with F5, otherwise a small demo scene is built.
+    // Meshes from other tools are imported instead and saved to the default level.
+    bool32_t is_mesh_path = input_path && (Editor_HasExtension(input_path, ".obj") || Editor_HasExtension(input_path, ".ply"));
+    const char* level_path = (input_path && !is_mesh_path) ? input_path : EDITOR_DEFAULT_LEVEL_PATH;
+
+    Scene scene;
+    if (is_mesh_path)
     {
-        Scene_Vertex* scene_vertices[6];
+        bool32_t scene_init_result = Scene_Init(&scene);
+        ASSERT(scene_init_result == TRUE);
+
+        Scene_ImportStats import_stats;
+
+        double import_start_time = glfwGetTime();
+        bool32_t import_result = Scene_Import(&scene, input_path, { 0.8f, 0.8f, 0.8f, 1.0f }, &import_stats);
+        double import_seconds = glfwGetTime() - import_start_time;
+
+        if (!import_result)
+        {
+            fprintf(stderr, "Could not import the mesh %s.\n", input_path);
+
+            Scene_Destroy(&scene);
+            glfwTerminate();
+            Jobs_Shutdown();
+            return 1;
+        }
+
+        printf(
+            "Imported %s: %u vertices (%u before welding), %u faces, %u skipped faces, %.1f MB/s.\n",
+            input_path,
+            import_stats.num_vertices,
+            import_stats.num_input_vertices,
+            import_stats.num_faces,
+            import_stats.num_skipped_faces,
+            import_stats.num_bytes / (1024.0 * 1024.0) / import_seconds
+        );
+
+        // Imported meshes are mostly triangles, many of which lie in the same plane
+        Editor_Optimize(&scene);
+    }
+    else if (input_path)
+    {
+        if (!Scene_Load(&scene, level_path))
+        {
+            fprintf(stderr, "Could not load the level %s.\n", level_path);
+
+            glfwTerminate();
+            Jobs_Shutdown();
+            return 1;
+        }
+    }
+    else
+    {
+        bool32_t scene_init_result = Scene_Init(&scene);
+        ASSERT(scene_init_result == TRUE);
+
+        uint32_t scene_vertices[6];
 
         scene_vertices[0] = Scene_AddVertex(&scene, { -3.0f, 0.0f, 0.0f });
-        ASSERT(scene_vertices[0] != NULL);
+        ASSERT(scene_vertices[0] != SCENE_ID_NONE);
 
         scene_vertices[1] = Scene_AddVertex(&scene, { 3.0f, 0.0f, 0.0f });
-        ASSERT(scene_vertices[1] != NULL);
+        ASSERT(scene_vertices[1] != SCENE_ID_NONE);
 
         scene_vertices[2] = Scene_AddVertex(&scene, { 3.0f, 1.0f, 0.0f });
-        ASSERT(scene_vertices[2] != NULL);
+        ASSERT(scene_vertices[2] != SCENE_ID_NONE);
 
         scene_vertices[3] = Scene_AddVertex(&scene, { -3.0f, 1.0f, 0.0f });
-        ASSERT(scene_vertices[3] != NULL);
+        ASSERT(scene_vertices[3] != SCENE_ID_NONE);
 
         scene_vertices[4] = Scene_AddVertex(&scene, { 6.0f, 0.0f, 0.0f });
-        ASSERT(scene_vertices[4] != NULL);
+        ASSERT(scene_vertices[4] != SCENE_ID_NONE);
 
         scene_vertices[5] = Scene_AddVertex(&scene, { 6.0f, 1.0f, 0.0f });
-        ASSERT(scene_vertices[5] != NULL);
+        ASSERT(scene_vertices[5] != SCENE_ID_NONE);
+
+        uint32_t f0v[4] = { scene_vertices[0], scene_vertices[1] ,scene_vertices[2], scene_vertices[3] };
+        uint32_t f1v[4] = { scene_vertices[1], scene_vertices[4], scene_vertices[5], scene_vertices[2] };
 
-        Scene_Vertex* f0v[4] = { scene_vertices[0], scene_vertices[1] ,scene_vertices[2], scene_vertices[3] };
-        Scene_Vertex* f1v[4] = { scene_vertices[1], scene_vertices[4], scene_vertices[5], scene_vertices[2] };
+        uint32_t f0 = Scene_ConstructFace(&scene, f0v, ARRAY_SIZE_U32(f0v), { 1.0f, 0.0f, 0.0f, 1.0f });
+        ASSERT(f0 != SCENE_ID_NONE);
 
-        Scene_Face* f0 = Scene_ConstructFace(&scene, f0v, ARRAY_SIZE_U32(f0v), { 1.0f, 0.0f, 0.0f, 1.0f });
-        ASSERT(f0 != NULL);
+        uint32_t f1 = Scene_ConstructFace(&scene, f1v, ARRAY_SIZE_U32(f1v), { 0.0f, 1.0f, 0.0f, 1.0f });
+        ASSERT(f1 != SCENE_ID_NONE);
+    }
+
+    // Files from disk come in whatever order they were built in, the whole geometry is uploaded right after anyway
+    if (input_path)
+    {
+        double reorder_start_time = glfwGetTime();
+        Scene_Reorder(&scene);
 
-        Scene_Face* f1 = Scene_ConstructFace(&scene, f1v, ARRAY_SIZE_U32(f1v), { 0.0f, 1.0f, 0.0f, 1.0f });
-        ASSERT(f1 != NULL);
+        printf("Reordered %u faces in %.1f ms.\n", scene.num_faces, (glfwGetTime() - reorder_start_time) * 1e3);
     }
 
+    Editor_VertexCachePass vertex_cache_pass;
+    vertex_cache_pass.is_running = FALSE;
+
+    // Levels from disk are static geometry for the most part, so their triangles are reordered right away
+    if (input_path)
+    {
+        Editor_VertexCachePass_Start(&vertex_cache_pass);
+        Editor_VertexCachePass_Step(&vertex_cache_pass, &scene, SCENE_MAX_NUM_FACES);
+    }
+
+    // Edits of the editor go through the journal, every drag is one undo step
+    Scene_Journal journal;
+    bool32_t journal_init_result = Scene_Journal_Init(&journal, SCENE_JOURNAL_DEFAULT_CAPACITY);
+    ASSERT(journal_init_result == TRUE);
+
+    Editor_Save save;
+    save.is_running = FALSE;
+    bool32_t save_init_result = Scene_Snapshot_Init(&save.snapshot);
+    ASSERT(save_init_result == TRUE);
+
+    Editor_ClusterDraw cluster_draw;
+    bool32_t cluster_draw_init_result = Editor_ClusterDraw_Init(&cluster_draw);
+    ASSERT(cluster_draw_init_result == TRUE);
+
+    // Built on request, any edit drops it again
+    PVS pvs;
+    bool32_t pvs_init_result = PVS_Init(&pvs);
+    ASSERT(pvs_init_result == TRUE);
+
+    // Both bakers are off until toggled, then they follow the edits
+    Editor_Lightmap editor_lightmap;
+    bool32_t editor_lightmap_init_result = Editor_Lightmap_Init(&editor_lightmap);
+    ASSERT(editor_lightmap_init_result == TRUE);
+
+    Editor_AO editor_ao;
+    bool32_t editor_ao_init_result = Editor_AO_Init(&editor_ao);
+    ASSERT(editor_ao_init_result == TRUE);
+
     Editor_Geometry editor_geometry;
-    bool32_t editor_geometry_init_result = Editor_Geometry_Init(&editor_geometry);
+    bool32_t editor_geometry_init_result = Editor_Geometry_Init(&editor_geometry, &scene, use_packed_vertices);
     ASSERT(editor_geometry_init_result == TRUE);
 
     constexpr float fovy = glm::radians(45.0f);
@@ -621,6 +1455,9 @@ int main(int, char**)
 
         uint32_t picked_face_id = SCENE_ID_NONE;
         uint32_t picked_vertex_id = SCENE_ID_NONE;
+        uint32_t picked_edge_corner_ids[4] = { SCENE_ID_NONE, SCENE_ID_NONE, SCENE_ID_NONE, SCENE_ID_NONE };
+
+        bool32_t is_dragging = FALSE;
 
         if (last_time != 0.0f)
         {
@@ -658,39 +1495,201 @@ int main(int, char**)
                 bool32_t vertex_shift_up = Input_Key_Pressed_A;
                 bool32_t vertex_shift_down = Input_Key_Pressed_D;
 
-                Scene_Face* hit_face;
-                if (Scene_RayCast_FindNearestIntersectingFace(&scene, camera.position, pick_direction, 0.01f, 100.0f, &hit_face, NULL))
-                {
-                    picked_face_id = hit_face->id;
+                // Everything moved while the keys are held is undone at once
+                is_dragging = face_shift_down || face_shift_up || vertex_shift_up || vertex_shift_down;
 
-                    Scene_HalfEdge* current_half_edge = hit_face->half_edge;
-                    Scene_Vertex* current_vertex = current_half_edge->origin_vertex;
+                if (is_dragging && !journal.is_group_open)
+                    Scene_Journal_BeginGroup(&journal);
 
-                    Scene_Vertex* start_vertex = current_vertex;
+                uint32_t hit_face_index;
+                if (Scene_RayCast_FindNearestIntersectingFace(&scene, camera.position, pick_direction, 0.01f, 100.0f, &hit_face_index, NULL))
+                {
+                    picked_face_id = hit_face_index;
+
+                    const Scene_Face* hit_face = scene.faces + hit_face_index;
+                    uint32_t half_edge_index = hit_face->first_half_edge;
 
                     do
                     {
-                        if (face_shift_up) current_vertex->position.y += delta_time;
-                        if (face_shift_down) current_vertex->position.y -= delta_time;
+                        const Scene_HalfEdge* current_half_edge = scene.half_edges + half_edge_index;
+                        glm::vec3 position = scene.vertices[current_half_edge->origin_vertex].position;
+
+                        if (face_shift_up) position.y += delta_time;
+                        if (face_shift_down) position.y -= delta_time;
+
+                        if (face_shift_up || face_shift_down)
+                        {
+                            Scene_Journal_SetVertexPosition(&journal, &scene, current_half_edge->origin_vertex, position);
+                            PVS_Clear(&pvs);
+                        }
+
+                        half_edge_index = current_half_edge->next_half_edge;
+                    } while (half_edge_index != hit_face->first_half_edge);
+                }
+
+                // Vertices and edges are picked within a few pixels of the cursor
+                float pick_radius_per_length = EDITOR_PICK_RADIUS_IN_PIXELS * 2.0f * near_half_height / (near * window_height);
+
+                Scene_RayHit vertex_hit;
+                if (Scene_Pick_FindNearestVertex(&scene, camera.position, pick_direction, 100.0f, pick_radius_per_length, &vertex_hit))
+                {
+                    uint32_t hit_vertex_index = vertex_hit.index;
+                    picked_vertex_id = hit_vertex_index;
+
+                    glm::vec3 position = scene.vertices[hit_vertex_index].position;
+
+                    if (vertex_shift_up) position.y += delta_time;
+                    if (vertex_shift_down) position.y -= delta_time;
+
+                    if (vertex_shift_up || vertex_shift_down)
+                    {
+                        Scene_Journal_SetVertexPosition(&journal, &scene, hit_vertex_index, position);
+                        PVS_Clear(&pvs);
+                    }
+                }
+
+                Scene_RayHit edge_hit;
+                if (picked_vertex_id == SCENE_ID_NONE &&
+                    Scene_Pick_FindNearestEdge(&scene, camera.position, pick_direction, 100.0f, pick_radius_per_length, &edge_hit))
+                {
+                    // Geometry corners are numbered like the half-edges that start at them
+                    const Scene_HalfEdge* hit_half_edge = scene.half_edges + edge_hit.index;
 
-                        current_vertex = current_half_edge->end_vertex;
-                        current_half_edge = current_half_edge->next_half_edge;
-                    } while (current_vertex != start_vertex);
+                    picked_edge_corner_ids[0] = edge_hit.index;
+                    picked_edge_corner_ids[1] = hit_half_edge->next_half_edge;
+
+                    if (hit_half_edge->opposite_half_edge != SCENE_ID_NONE)
+                    {
+                        picked_edge_corner_ids[2] = hit_half_edge->opposite_half_edge;
+                        picked_edge_corner_ids[3] = scene.half_edges[hit_half_edge->opposite_half_edge].next_half_edge;
+                    }
                 }
 
-                Scene_Vertex* hit_vertex = Scene_RayCast_FindNearestVertex(&scene, camera.position, pick_direction, 100.0f);
-                if (hit_vertex)
+                // The picked vertex goes first, then the picked edge and the face under the cursor last
+                if (Input_DeleteRequested && !is_dragging && !journal.is_group_open)
                 {
-                    picked_vertex_id = hit_vertex->id;
+                    Scene_Journal_BeginGroup(&journal);
+
+                    if (picked_vertex_id != SCENE_ID_NONE)
+                        Scene_Journal_DeleteVertex(&journal, &scene, picked_vertex_id);
+                    else if (picked_edge_corner_ids[0] != SCENE_ID_NONE)
+                        Scene_Journal_DeleteEdge(&journal, &scene, picked_edge_corner_ids[0]);
+                    else if (picked_face_id != SCENE_ID_NONE)
+                        Scene_Journal_DeleteFace(&journal, &scene, picked_face_id);
 
-                    if (vertex_shift_up) hit_vertex->position.y += delta_time;
-                    if (vertex_shift_down) hit_vertex->position.y -= delta_time;
+                    Scene_Journal_EndGroup(&journal);
+                    PVS_Clear(&pvs);
+
+                    // Nothing is highlighted until the next frame picks again
+                    picked_face_id = SCENE_ID_NONE;
+                    picked_vertex_id = SCENE_ID_NONE;
+
+                    for (uint32_t i = 0; i < 4; ++i)
+                        picked_edge_corner_ids[i] = SCENE_ID_NONE;
                 }
             }
         }
 
         last_time = current_time;
 
+        // A delete applies to what is picked in the frame of the request
+        Input_DeleteRequested = FALSE;
+
+        if (!is_dragging && journal.is_group_open)
+            Scene_Journal_EndGroup(&journal);
+
+        // Requests during a drag wait until it ends
+        if (!journal.is_group_open)
+        {
+            if (Input_NumUndoRequests > 0 || Input_NumRedoRequests > 0)
+                PVS_Clear(&pvs);
+
+            for (; Input_NumUndoRequests > 0; --Input_NumUndoRequests)
+                Scene_Journal_Undo(&journal, &scene);
+
+            for (; Input_NumRedoRequests > 0; --Input_NumRedoRequests)
+                Scene_Journal_Redo(&journal, &scene);
+        }
+
+        // Undo steps refer to the old indices, so reordering drops the history. A save that is running keeps its snapshot.
+        if (Input_ReorderRequested && !journal.is_group_open)
+        {
+            Scene_Reorder(&scene);
+            Scene_Journal_Clear(&journal);
+            PVS_Clear(&pvs);
+
+            Input_ReorderRequested = FALSE;
+        }
+
+        // Optimizing rebuilds the scene, which renumbers everything like reordering
+        if (Input_OptimizeRequested && !journal.is_group_open)
+        {
+            // Rebuilt faces are triangulated again in their plain order
+            if (Editor_Optimize(&scene))
+            {
+                Scene_Journal_Clear(&journal);
+                PVS_Clear(&pvs);
+                Editor_VertexCachePass_Start(&vertex_cache_pass);
+            }
+
+            Input_OptimizeRequested = FALSE;
+        }
+
+        // Deleted elements are compacted a few at a time, the history follows the moved elements
+        if (!journal.is_group_open)
+        {
+            uint32_t num_elements = scene.num_vertices + scene.num_faces;
+            uint32_t num_deleted_elements = scene.num_deleted_vertices + scene.num_deleted_faces;
+
+            if (scene.defrag.is_running || Input_DefragRequested ||
+                (num_elements > 0 && (float)num_deleted_elements >= EDITOR_DEFRAG_MIN_DELETED_FRACTION * (float)num_elements))
+            {
+                Scene_Defragment(&scene, EDITOR_DEFRAG_NUM_MOVES_PER_FRAME);
+                Scene_Journal_FollowDefrag(&journal, &scene);
+                PVS_Clear(&pvs);
+            }
+
+            Input_DefragRequested = FALSE;
+        }
+
+        // Reordering triangles changes no index, the journal stays valid
+        if (Input_VertexCacheRequested)
+        {
+            Editor_VertexCachePass_Start(&vertex_cache_pass);
+            Input_VertexCacheRequested = FALSE;
+        }
+
+        Editor_VertexCachePass_Step(&vertex_cache_pass, &scene, EDITOR_VERTEX_CACHE_NUM_FACES_PER_FRAME);
+
+        // Triangles only move within their faces, so the clusters of the set keep their index ranges while they are reordered
+        if (Input_PVSRequested && !journal.is_group_open)
+        {
+            Editor_BuildPVS(&pvs, &scene);
+            Input_PVSRequested = FALSE;
+        }
+
+        if (Input_LightmapToggleRequested)
+        {
+            editor_lightmap.is_enabled = !editor_lightmap.is_enabled;
+            Input_LightmapToggleRequested = FALSE;
+        }
+
+        Editor_Lightmap_Step(&editor_lightmap, &scene);
+
+        if (Input_AOToggleRequested)
+        {
+            editor_ao.is_enabled = !editor_ao.is_enabled;
+            Input_AOToggleRequested = FALSE;
+        }
+
+        Editor_AO_Step(&editor_ao, &scene);
+
+        Editor_Save_Finish(&save, FALSE);
+
+        // A request during a save waits until it is done
+        if (Input_SaveRequested && Editor_Save_Start(&save, &scene, level_path))
+            Input_SaveRequested = FALSE;
+
         // Update the editor geometry
 
         bool32_t editor_geometry_update_result = Editor_Geometry_Update(&editor_geometry, &scene);
@@ -708,9 +1707,36 @@ int main(int, char**)
         glUniformMatrix4fv(1, 1, GL_FALSE, (float*)&camera.view);
         glUniformMatrix4fv(2, 1, GL_FALSE, (float*)&identity);
         glUniform1ui(3, picked_face_id);
+        glUniform4uiv(4, 1, picked_edge_corner_ids);
+
+        if (editor_lightmap.is_enabled && editor_lightmap.chart_buffer.ssbo != 0)
+        {
+            glBindTextureUnit(0, editor_lightmap.texture);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, editor_lightmap.chart_buffer.ssbo);
+            glUniform1ui(5, editor_lightmap.lightmap.num_faces);
+        }
+        else
+        {
+            glUniform1ui(5, 0);
+        }
+
+        if (editor_ao.is_enabled && editor_ao.value_buffer.ssbo != 0)
+        {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, editor_ao.value_buffer.ssbo);
+            glUniform1ui(6, editor_ao.ao.num_vertices);
+        }
+        else
+        {
+            glUniform1ui(6, 0);
+        }
     
         glBindVertexArray(editor_geometry.scene_geometry.vao);
-        glDrawElements(GL_TRIANGLES, editor_geometry.scene_geometry.num_indices, GL_UNSIGNED_INT, (const void*)0);
+
+        // Without a set for the camera position only the view frustum culls, a set built for other faces would mark the wrong clusters
+        const uint8_t* pvs_visible_clusters = (pvs.num_faces == scene.num_faces) ? PVS_GetVisibleClusters(&pvs, camera.position) : NULL;
+
+        glm::mat4 view_projection = projection * camera.view;
+        Editor_ClusterDraw_Draw(&cluster_draw, &scene, &view_projection, pvs_visible_clusters);
         
         // Grid
 
@@ -753,6 +1779,19 @@ int main(int, char**)
         glfwPollEvents();
     }
 
+    Editor_Save_Finish(&save, TRUE);
+    Scene_Snapshot_Destroy(&save.snapshot);
+
+    Editor_AO_Destroy(&editor_ao);
+    Editor_Lightmap_Destroy(&editor_lightmap);
+    PVS_Destroy(&pvs);
+    Editor_ClusterDraw_Destroy(&cluster_draw);
+
+    Scene_Journal_Destroy(&journal);
+    Scene_Destroy(&scene);
+
     glfwTerminate();
+    Jobs_Shutdown();
+
     return 0;
 }
\ No newline at end of file